@@ -0,0 +1,929 @@
+#include "BlockCompression.h"
+#include "DDSFile.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_COMPRESSION_SSE 1
+#include <emmintrin.h>
+#endif
+
+// A block's texels one array per channel, so four texels fill an SSE register. Channels a block format doesn't store are 0,
+// in the texels and in the palettes they are fitted to, and add nothing to the error.
+struct BlockTexels
+{
+	float R[16];
+	float G[16];
+	float B[16];
+	float A[16];
+};
+
+#define CHANNEL_R 1
+#define CHANNEL_G 2
+#define CHANNEL_B 4
+#define CHANNEL_A 8
+
+static void LoadTexels(const uint8_t* pixels, uint32_t channels, BlockTexels& texels)
+{
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		texels.R[n] = (channels & CHANNEL_R) ? pixels[n * 4 + 0] : 0.0f;
+		texels.G[n] = (channels & CHANNEL_G) ? pixels[n * 4 + 1] : 0.0f;
+		texels.B[n] = (channels & CHANNEL_B) ? pixels[n * 4 + 2] : 0.0f;
+		texels.A[n] = (channels & CHANNEL_A) ? pixels[n * 4 + 3] : 0.0f;
+	}
+}
+
+// Nearest palette entry of every texel and the summed squared error. Palettes hold whole numbers like the texels, so every
+// distance and the sum are exact in float and both paths pick the same indices, the first of equally near entries.
+static float FitPalette(const BlockTexels& texels, const float (*palette)[4], uint32_t paletteSize, uint8_t* indices)
+{
+	float total = 0.0f;
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		float best = FLT_MAX;
+		uint8_t bestIndex = 0;
+		for (uint32_t entry = 0; entry < paletteSize; ++entry)
+		{
+			const float dr = texels.R[n] - palette[entry][0];
+			const float dg = texels.G[n] - palette[entry][1];
+			const float db = texels.B[n] - palette[entry][2];
+			const float da = texels.A[n] - palette[entry][3];
+			const float distance = (dr * dr + dg * dg) + (db * db + da * da);
+			if (distance < best)
+			{
+				best = distance;
+				bestIndex = static_cast<uint8_t>(entry);
+			}
+		}
+		indices[n] = bestIndex;
+		total += best;
+	}
+	return total;
+}
+
+static float FitPaletteSIMD(const BlockTexels& texels, const float (*palette)[4], uint32_t paletteSize, uint8_t* indices)
+{
+#if BLOCK_COMPRESSION_SSE
+	__m128 total = _mm_setzero_ps();
+	for (uint32_t n = 0; n < 16; n += 4)
+	{
+		const __m128 r = _mm_loadu_ps(texels.R + n);
+		const __m128 g = _mm_loadu_ps(texels.G + n);
+		const __m128 b = _mm_loadu_ps(texels.B + n);
+		const __m128 a = _mm_loadu_ps(texels.A + n);
+
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (uint32_t entry = 0; entry < paletteSize; ++entry)
+		{
+			const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[entry][0]));
+			const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[entry][1]));
+			const __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[entry][2]));
+			const __m128 da = _mm_sub_ps(a, _mm_set1_ps(palette[entry][3]));
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+
+			const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+			bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(static_cast<int>(entry))), _mm_andnot_si128(closer, bestIndex));
+			best = _mm_min_ps(distance, best);
+		}
+		total = _mm_add_ps(total, best);
+
+		alignas(16) int32_t lanes[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+		for (uint32_t lane = 0; lane < 4; ++lane)
+		{
+			indices[n + lane] = static_cast<uint8_t>(lanes[lane]);
+		}
+	}
+
+	alignas(16) float sums[4];
+	_mm_store_ps(sums, total);
+	return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#else
+	return FitPalette(texels, palette, paletteSize, indices);
+#endif
+}
+
+static float Fit(const BlockTexels& texels, const float (*palette)[4], uint32_t paletteSize, uint8_t* indices, bool simd)
+{
+	return simd ? FitPaletteSIMD(texels, palette, paletteSize, indices) : FitPalette(texels, palette, paletteSize, indices);
+}
+
+// Mean and principal axis of the texels, the covariance's dominant eigenvector by power iteration. The axis is 0 for flat blocks.
+static void PrincipalAxis(const BlockTexels& texels, float* mean, float* axis)
+{
+	const float* channels[4] = { texels.R, texels.G, texels.B, texels.A };
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		float sum = 0.0f;
+		for (uint32_t n = 0; n < 16; ++n)
+		{
+			sum += channels[c][n];
+		}
+		mean[c] = sum / 16.0f;
+	}
+
+	float covariance[4][4] = {};
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			for (uint32_t j = 0; j < 4; ++j)
+			{
+				covariance[i][j] += (channels[i][n] - mean[i]) * (channels[j][n] - mean[j]);
+			}
+		}
+	}
+
+	// Starting from the row of the most varying channel, which can't be orthogonal to the dominant eigenvector unless the block is flat
+	uint32_t start = 0;
+	for (uint32_t c = 1; c < 4; ++c)
+	{
+		if (covariance[c][c] > covariance[start][start])
+		{
+			start = c;
+		}
+	}
+	float vector[4] = { covariance[start][0], covariance[start][1], covariance[start][2], covariance[start][3] };
+	for (uint32_t iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[4] = {};
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			for (uint32_t j = 0; j < 4; ++j)
+			{
+				next[i] += covariance[i][j] * vector[j];
+			}
+		}
+		const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+		if (length < 1e-6f)
+		{
+			memset(axis, 0, sizeof(float) * 4);
+			return;
+		}
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			vector[c] = next[c] / length;
+		}
+	}
+	memcpy(axis, vector, sizeof(vector));
+}
+
+// The extremes of the texels projected onto the principal axis, high is the end the axis points to
+static void AxisEndpoints(const BlockTexels& texels, float* high, float* low)
+{
+	float mean[4];
+	float axis[4];
+	PrincipalAxis(texels, mean, axis);
+
+	float minimum = FLT_MAX;
+	float maximum = -FLT_MAX;
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		const float t = (texels.R[n] - mean[0]) * axis[0] + (texels.G[n] - mean[1]) * axis[1] + (texels.B[n] - mean[2]) * axis[2] + (texels.A[n] - mean[3]) * axis[3];
+		minimum = (std::min)(minimum, t);
+		maximum = (std::max)(maximum, t);
+	}
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		high[c] = std::clamp(mean[c] + maximum * axis[c], 0.0f, 255.0f);
+		low[c] = std::clamp(mean[c] + minimum * axis[c], 0.0f, 255.0f);
+	}
+}
+
+// Least squares endpoints for texels fixed at their weights, texel n sits at (1 - weights[n]) * e0 + weights[n] * e1.
+// Fails when every texel has the same weight, the system is singular then.
+static bool FitEndpoints(const BlockTexels& texels, const float* weights, float* e0, float* e1)
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		const float t = weights[n];
+		aa += (1.0f - t) * (1.0f - t);
+		ab += (1.0f - t) * t;
+		bb += t * t;
+	}
+	const float determinant = aa * bb - ab * ab;
+	if (determinant < 1e-6f)
+	{
+		return false;
+	}
+
+	const float* channels[4] = { texels.R, texels.G, texels.B, texels.A };
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		float ax = 0.0f, bx = 0.0f;
+		for (uint32_t n = 0; n < 16; ++n)
+		{
+			ax += (1.0f - weights[n]) * channels[c][n];
+			bx += weights[n] * channels[c][n];
+		}
+		e0[c] = std::clamp((bb * ax - ab * bx) / determinant, 0.0f, 255.0f);
+		e1[c] = std::clamp((aa * bx - ab * ax) / determinant, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+// BC1
+
+static uint16_t Pack565(const float* color)
+{
+	const uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+	const uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+	const uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void Unpack565(uint16_t packed, uint32_t* color)
+{
+	const uint32_t r = packed >> 11;
+	const uint32_t g = (packed >> 5) & 63;
+	const uint32_t b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// Four colors when c0 > c1 or the block is BC3's, else three and transparent black
+static void BC1Palette(uint16_t c0, uint16_t c1, bool fourColors, uint32_t (*palette)[4])
+{
+	Unpack565(c0, palette[0]);
+	Unpack565(c1, palette[1]);
+	palette[0][3] = palette[1][3] = 255;
+	fourColors = fourColors || c0 > c1;
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		if (fourColors)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = fourColors ? 255 : 0;
+}
+
+// Endpoint 1 weight of each BC1 index in four color mode
+static const float BC1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+// Fits the texels to the endpoints in four color mode, or to the one color when they are equal
+static float TryBC1(const BlockTexels& texels, uint16_t c0, uint16_t c1, bool simd, uint8_t* block, uint8_t* indices)
+{
+	if (c0 < c1)
+	{
+		std::swap(c0, c1);
+	}
+	uint32_t colors[4][4];
+	BC1Palette(c0, c1, true, colors);
+	float palette[4][4];
+	for (uint32_t entry = 0; entry < 4; ++entry)
+	{
+		palette[entry][0] = static_cast<float>(colors[entry][0]);
+		palette[entry][1] = static_cast<float>(colors[entry][1]);
+		palette[entry][2] = static_cast<float>(colors[entry][2]);
+		palette[entry][3] = 0.0f;
+	}
+	const float error = Fit(texels, palette, c0 == c1 ? 1 : 4, indices, simd);
+
+	uint32_t bits = 0;
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		bits |= static_cast<uint32_t>(indices[n]) << (n * 2);
+	}
+	block[0] = static_cast<uint8_t>(c0);
+	block[1] = static_cast<uint8_t>(c0 >> 8);
+	block[2] = static_cast<uint8_t>(c1);
+	block[3] = static_cast<uint8_t>(c1 >> 8);
+	memcpy(block + 4, &bits, 4);
+	return error;
+}
+
+void EncodeBC1Block(const uint8_t* pixels, uint8_t* block, bool simd)
+{
+	BlockTexels texels;
+	LoadTexels(pixels, CHANNEL_R | CHANNEL_G | CHANNEL_B, texels);
+	float high[4];
+	float low[4];
+	AxisEndpoints(texels, high, low);
+
+	uint8_t indices[16];
+	float bestError = TryBC1(texels, Pack565(high), Pack565(low), simd, block, indices);
+	for (uint32_t iteration = 0; iteration < 2 && bestError > 0.0f; ++iteration)
+	{
+		float weights[16];
+		for (uint32_t n = 0; n < 16; ++n)
+		{
+			weights[n] = BC1Weights[indices[n]];
+		}
+		if (!FitEndpoints(texels, weights, high, low))
+		{
+			break;
+		}
+		uint8_t candidate[8];
+		uint8_t candidateIndices[16];
+		const float error = TryBC1(texels, Pack565(high), Pack565(low), simd, candidate, candidateIndices);
+		if (error >= bestError)
+		{
+			break;
+		}
+		bestError = error;
+		memcpy(block, candidate, sizeof(candidate));
+		memcpy(indices, candidateIndices, sizeof(candidateIndices));
+	}
+}
+
+static void DecodeBC1Colors(const uint8_t* block, bool fourColors, uint8_t* pixels)
+{
+	const uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+	const uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+	uint32_t palette[4][4];
+	BC1Palette(c0, c1, fourColors, palette);
+	uint32_t bits;
+	memcpy(&bits, block + 4, 4);
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		const uint32_t* color = palette[(bits >> (n * 2)) & 3];
+		pixels[n * 4 + 0] = static_cast<uint8_t>(color[0]);
+		pixels[n * 4 + 1] = static_cast<uint8_t>(color[1]);
+		pixels[n * 4 + 2] = static_cast<uint8_t>(color[2]);
+		pixels[n * 4 + 3] = static_cast<uint8_t>(color[3]);
+	}
+}
+
+void DecodeBC1Block(const uint8_t* block, uint8_t* pixels)
+{
+	DecodeBC1Colors(block, false, pixels);
+}
+
+// BC4, also BC3's alpha
+
+// Eight levels when r0 > r1, else six and 0 and 255
+static void BC4Palette(uint32_t r0, uint32_t r1, uint32_t* palette)
+{
+	palette[0] = r0;
+	palette[1] = r1;
+	if (r0 > r1)
+	{
+		for (uint32_t n = 2; n < 8; ++n)
+		{
+			palette[n] = ((8 - n) * r0 + (n - 1) * r1 + 3) / 7;
+		}
+	}
+	else
+	{
+		for (uint32_t n = 2; n < 6; ++n)
+		{
+			palette[n] = ((6 - n) * r0 + (n - 1) * r1 + 2) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+// Endpoint 1 weight of each BC4 index in eight level mode
+static const float BC4Weights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+// texels hold the channel in R
+static float TryBC4(const BlockTexels& texels, uint32_t r0, uint32_t r1, bool simd, uint8_t* block, uint8_t* indices)
+{
+	uint32_t levels[8];
+	BC4Palette(r0, r1, levels);
+	float palette[8][4] = {};
+	for (uint32_t entry = 0; entry < 8; ++entry)
+	{
+		palette[entry][0] = static_cast<float>(levels[entry]);
+	}
+	const float error = Fit(texels, palette, 8, indices, simd);
+
+	uint64_t bits = 0;
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		bits |= static_cast<uint64_t>(indices[n]) << (n * 3);
+	}
+	block[0] = static_cast<uint8_t>(r0);
+	block[1] = static_cast<uint8_t>(r1);
+	for (uint32_t n = 0; n < 6; ++n)
+	{
+		block[2 + n] = static_cast<uint8_t>(bits >> (n * 8));
+	}
+	return error;
+}
+
+static void EncodeBC4Channel(const uint8_t* pixels, uint32_t channel, uint8_t* block, bool simd)
+{
+	BlockTexels texels;
+	LoadTexels(pixels, 0, texels);
+	uint32_t minimum = 255, maximum = 0;
+	uint32_t innerMinimum = 255, innerMaximum = 0;
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		const uint32_t value = pixels[n * 4 + channel];
+		texels.R[n] = static_cast<float>(value);
+		minimum = (std::min)(minimum, value);
+		maximum = (std::max)(maximum, value);
+		if (value != 0 && value != 255)
+		{
+			innerMinimum = (std::min)(innerMinimum, value);
+			innerMaximum = (std::max)(innerMaximum, value);
+		}
+	}
+
+	uint8_t indices[16];
+	float bestError = TryBC4(texels, maximum, minimum, simd, block, indices);
+	for (uint32_t iteration = 0; iteration < 2 && bestError > 0.0f && maximum > minimum; ++iteration)
+	{
+		float weights[16];
+		for (uint32_t n = 0; n < 16; ++n)
+		{
+			weights[n] = BC4Weights[indices[n]];
+		}
+		float e0[4];
+		float e1[4];
+		if (!FitEndpoints(texels, weights, e0, e1))
+		{
+			break;
+		}
+		uint32_t r0 = static_cast<uint32_t>(e0[0] + 0.5f);
+		uint32_t r1 = static_cast<uint32_t>(e1[0] + 0.5f);
+		if (r0 <= r1)
+		{
+			break;
+		}
+		uint8_t candidate[8];
+		uint8_t candidateIndices[16];
+		const float error = TryBC4(texels, r0, r1, simd, candidate, candidateIndices);
+		if (error >= bestError)
+		{
+			break;
+		}
+		bestError = error;
+		memcpy(block, candidate, sizeof(candidate));
+		memcpy(indices, candidateIndices, sizeof(candidateIndices));
+	}
+
+	// Blocks with fully dark or fully bright texels keep those exact with the six level mode, the levels span the others
+	if (innerMinimum < innerMaximum && (minimum == 0 || maximum == 255) && bestError > 0.0f)
+	{
+		uint8_t candidate[8];
+		uint8_t candidateIndices[16];
+		if (TryBC4(texels, innerMinimum, innerMaximum, simd, candidate, candidateIndices) < bestError)
+		{
+			memcpy(block, candidate, sizeof(candidate));
+		}
+	}
+}
+
+void EncodeBC4Block(const uint8_t* pixels, uint8_t* block, bool simd)
+{
+	EncodeBC4Channel(pixels, 0, block, simd);
+}
+
+static void DecodeBC4Channel(const uint8_t* block, uint32_t channel, uint8_t* pixels)
+{
+	uint32_t palette[8];
+	BC4Palette(block[0], block[1], palette);
+	uint64_t bits = 0;
+	for (uint32_t n = 0; n < 6; ++n)
+	{
+		bits |= static_cast<uint64_t>(block[2 + n]) << (n * 8);
+	}
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		pixels[n * 4 + channel] = static_cast<uint8_t>(palette[(bits >> (n * 3)) & 7]);
+	}
+}
+
+void DecodeBC4Block(const uint8_t* block, uint8_t* pixels)
+{
+	DecodeBC4Channel(block, 0, pixels);
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		pixels[n * 4 + 1] = 0;
+		pixels[n * 4 + 2] = 0;
+		pixels[n * 4 + 3] = 255;
+	}
+}
+
+// BC3
+
+void EncodeBC3Block(const uint8_t* pixels, uint8_t* block, bool simd)
+{
+	EncodeBC4Channel(pixels, 3, block, simd);
+	EncodeBC1Block(pixels, block + 8, simd);
+
+	// BC3's color block is always read with four colors, BC1 only writes c0 < c1 for one color blocks, where that makes no difference
+}
+
+void DecodeBC3Block(const uint8_t* block, uint8_t* pixels)
+{
+	DecodeBC1Colors(block + 8, true, pixels);
+	DecodeBC4Channel(block, 3, pixels);
+}
+
+// BC7 mode 6
+
+static const uint32_t BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static void PutBits(uint8_t* block, uint32_t& offset, uint32_t value, uint32_t count)
+{
+	for (uint32_t n = 0; n < count; ++n, ++offset)
+	{
+		block[offset / 8] |= static_cast<uint8_t>(((value >> n) & 1) << (offset % 8));
+	}
+}
+
+static uint32_t GetBits(const uint8_t* block, uint32_t& offset, uint32_t count)
+{
+	uint32_t value = 0;
+	for (uint32_t n = 0; n < count; ++n, ++offset)
+	{
+		value |= static_cast<uint32_t>((block[offset / 8] >> (offset % 8)) & 1) << n;
+	}
+	return value;
+}
+
+// 8 bit endpoints, 7 bits each channel and the endpoint's p-bit below them
+static void BC7Palette(const uint32_t* e0, const uint32_t* e1, uint32_t (*palette)[4])
+{
+	for (uint32_t entry = 0; entry < 16; ++entry)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			palette[entry][c] = ((64 - BC7Weights[entry]) * e0[c] + BC7Weights[entry] * e1[c] + 32) >> 6;
+		}
+	}
+}
+
+struct BC7Endpoints
+{
+	uint32_t E0[4];
+	uint32_t E1[4];
+};
+
+// Quantizes the endpoints with each of the four p-bit pairs and keeps the pair that fits best
+static float TryBC7(const BlockTexels& texels, const float* high, const float* low, bool simd, BC7Endpoints& endpoints, uint8_t* indices)
+{
+	float bestError = FLT_MAX;
+	for (uint32_t p = 0; p < 4; ++p)
+	{
+		BC7Endpoints candidate;
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			const uint32_t p0 = p & 1;
+			const uint32_t p1 = p >> 1;
+			candidate.E0[c] = std::clamp(static_cast<int>((high[c] - p0) * 0.5f + 0.5f), 0, 127) * 2 + p0;
+			candidate.E1[c] = std::clamp(static_cast<int>((low[c] - p1) * 0.5f + 0.5f), 0, 127) * 2 + p1;
+		}
+		uint32_t colors[16][4];
+		BC7Palette(candidate.E0, candidate.E1, colors);
+		float palette[16][4];
+		for (uint32_t entry = 0; entry < 16; ++entry)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				palette[entry][c] = static_cast<float>(colors[entry][c]);
+			}
+		}
+		uint8_t candidateIndices[16];
+		const float error = Fit(texels, palette, 16, candidateIndices, simd);
+		if (error < bestError)
+		{
+			bestError = error;
+			endpoints = candidate;
+			memcpy(indices, candidateIndices, sizeof(candidateIndices));
+		}
+	}
+	return bestError;
+}
+
+// Always writes mode 6: one subset, 7 bit RGBA endpoints with a p-bit each and 4 bit indices. The other modes partition the block
+// or code alpha apart from color, each would need its own endpoint search, and DecodeBC7Block zeroes them.
+void EncodeBC7Block(const uint8_t* pixels, uint8_t* block, bool simd)
+{
+	BlockTexels texels;
+	LoadTexels(pixels, CHANNEL_R | CHANNEL_G | CHANNEL_B | CHANNEL_A, texels);
+	float high[4];
+	float low[4];
+	AxisEndpoints(texels, high, low);
+
+	BC7Endpoints endpoints;
+	uint8_t indices[16];
+	float bestError = TryBC7(texels, high, low, simd, endpoints, indices);
+	for (uint32_t iteration = 0; iteration < 2 && bestError > 0.0f; ++iteration)
+	{
+		float weights[16];
+		for (uint32_t n = 0; n < 16; ++n)
+		{
+			weights[n] = BC7Weights[indices[n]] / 64.0f;
+		}
+		if (!FitEndpoints(texels, weights, high, low))
+		{
+			break;
+		}
+		BC7Endpoints candidate;
+		uint8_t candidateIndices[16];
+		const float error = TryBC7(texels, high, low, simd, candidate, candidateIndices);
+		if (error >= bestError)
+		{
+			break;
+		}
+		bestError = error;
+		endpoints = candidate;
+		memcpy(indices, candidateIndices, sizeof(candidateIndices));
+	}
+
+	// Texel 0's index drops its top bit, so it has to be in the lower half. Swapping the endpoints mirrors the weights exactly.
+	if (indices[0] & 8)
+	{
+		std::swap(endpoints.E0, endpoints.E1);
+		for (uint32_t n = 0; n < 16; ++n)
+		{
+			indices[n] = static_cast<uint8_t>(15 - indices[n]);
+		}
+	}
+
+	memset(block, 0, 16);
+	uint32_t offset = 0;
+	PutBits(block, offset, 1 << 6, 7);
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		PutBits(block, offset, endpoints.E0[c] >> 1, 7);
+		PutBits(block, offset, endpoints.E1[c] >> 1, 7);
+	}
+	PutBits(block, offset, endpoints.E0[0] & 1, 1);
+	PutBits(block, offset, endpoints.E1[0] & 1, 1);
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		PutBits(block, offset, indices[n], n == 0 ? 3 : 4);
+	}
+}
+
+void DecodeBC7Block(const uint8_t* block, uint8_t* pixels)
+{
+	if ((block[0] & 0x7f) != 1 << 6)
+	{
+		memset(pixels, 0, 64);
+		return;
+	}
+
+	uint32_t offset = 7;
+	BC7Endpoints endpoints;
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		endpoints.E0[c] = GetBits(block, offset, 7) << 1;
+		endpoints.E1[c] = GetBits(block, offset, 7) << 1;
+	}
+	const uint32_t p0 = GetBits(block, offset, 1);
+	const uint32_t p1 = GetBits(block, offset, 1);
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		endpoints.E0[c] |= p0;
+		endpoints.E1[c] |= p1;
+	}
+	uint32_t palette[16][4];
+	BC7Palette(endpoints.E0, endpoints.E1, palette);
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		const uint32_t* color = palette[GetBits(block, offset, n == 0 ? 3 : 4)];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			pixels[n * 4 + c] = static_cast<uint8_t>(color[c]);
+		}
+	}
+}
+
+// Images
+
+uint32_t ChooseBlockFormat(const Image& image)
+{
+	bool gray = true;
+	for (size_t n = 0; n < image.Pixels.size(); n += 4)
+	{
+		if (image.Pixels[n + 3] != 255)
+		{
+			return BLOCK_FORMAT_BC7;
+		}
+		gray = gray && image.Pixels[n] == image.Pixels[n + 1] && image.Pixels[n] == image.Pixels[n + 2];
+	}
+	return gray ? BLOCK_FORMAT_BC4 : BLOCK_FORMAT_BC1;
+}
+
+uint32_t GetBlockFormatChannels(uint32_t format)
+{
+	switch (format)
+	{
+	case BLOCK_FORMAT_BC1: return 3;
+	case BLOCK_FORMAT_BC4: return 1;
+	default: return 4;
+	}
+}
+
+void DownsampleImage(const Image& source, Image& destination)
+{
+	destination.Width = (std::max)(source.Width / 2, 1u);
+	destination.Height = (std::max)(source.Height / 2, 1u);
+	destination.Pixels.resize(static_cast<size_t>(destination.Width) * destination.Height * 4);
+	for (uint32_t y = 0; y < destination.Height; ++y)
+	{
+		const uint8_t* row0 = source.Pixels.data() + static_cast<size_t>((std::min)(y * 2, source.Height - 1)) * source.Width * 4;
+		const uint8_t* row1 = source.Pixels.data() + static_cast<size_t>((std::min)(y * 2 + 1, source.Height - 1)) * source.Width * 4;
+		uint8_t* pixel = destination.Pixels.data() + static_cast<size_t>(y) * destination.Width * 4;
+		for (uint32_t x = 0; x < destination.Width; ++x, pixel += 4)
+		{
+			const size_t x0 = (std::min)(x * 2, source.Width - 1) * 4;
+			const size_t x1 = (std::min)(x * 2 + 1, source.Width - 1) * 4;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				pixel[c] = static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+			}
+		}
+	}
+}
+
+uint32_t GetFullMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t mipCount = 1;
+	while (width > 1 || height > 1)
+	{
+		width = (std::max)(width / 2, 1u);
+		height = (std::max)(height / 2, 1u);
+		++mipCount;
+	}
+	return mipCount;
+}
+
+typedef void (*BlockEncoder)(const uint8_t* pixels, uint8_t* block, bool simd);
+typedef void (*BlockDecoder)(const uint8_t* block, uint8_t* pixels);
+
+static size_t GetBlockSize(uint32_t format)
+{
+	return format == BLOCK_FORMAT_BC1 || format == BLOCK_FORMAT_BC4 ? 8 : 16;
+}
+
+void CompressImage(const Image& image, uint32_t format, ThreadPool& pool, bool simd, std::vector<uint8_t>& blocks)
+{
+	BlockEncoder encode = EncodeBC7Block;
+	switch (format)
+	{
+	case BLOCK_FORMAT_BC1: encode = EncodeBC1Block; break;
+	case BLOCK_FORMAT_BC3: encode = EncodeBC3Block; break;
+	case BLOCK_FORMAT_BC4: encode = EncodeBC4Block; break;
+	}
+
+	size_t rowPitch;
+	uint32_t rowCount;
+	blocks.resize(GetDDSSurfaceSize(format, image.Width, image.Height, &rowPitch, &rowCount));
+	const size_t blockSize = GetBlockSize(format);
+	const uint32_t blocksWide = static_cast<uint32_t>(rowPitch / blockSize);
+	pool.ParallelFor(rowCount, [&](size_t begin, size_t end, uint32_t)
+	{
+		uint8_t pixels[64];
+		for (size_t blockY = begin; blockY < end; ++blockY)
+		{
+			for (uint32_t blockX = 0; blockX < blocksWide; ++blockX)
+			{
+				for (uint32_t n = 0; n < 16; ++n)
+				{
+					const size_t x = (std::min)(blockX * 4 + n % 4, image.Width - 1);
+					const size_t y = (std::min)(static_cast<uint32_t>(blockY) * 4 + n / 4, image.Height - 1);
+					memcpy(pixels + n * 4, image.Pixels.data() + (y * image.Width + x) * 4, 4);
+				}
+				encode(pixels, blocks.data() + blockY * rowPitch + blockX * blockSize, simd);
+			}
+		}
+	});
+}
+
+void DecompressImage(const uint8_t* blocks, uint32_t format, uint32_t width, uint32_t height, Image& image)
+{
+	BlockDecoder decode = DecodeBC7Block;
+	switch (format)
+	{
+	case BLOCK_FORMAT_BC1: decode = DecodeBC1Block; break;
+	case BLOCK_FORMAT_BC3: decode = DecodeBC3Block; break;
+	case BLOCK_FORMAT_BC4: decode = DecodeBC4Block; break;
+	}
+
+	size_t rowPitch;
+	uint32_t rowCount;
+	GetDDSSurfaceSize(format, width, height, &rowPitch, &rowCount);
+	const size_t blockSize = GetBlockSize(format);
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(static_cast<size_t>(width) * height * 4);
+	uint8_t pixels[64];
+	for (uint32_t blockY = 0; blockY < rowCount; ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < rowPitch / blockSize; ++blockX)
+		{
+			decode(blocks + blockY * rowPitch + blockX * blockSize, pixels);
+			for (uint32_t n = 0; n < 16; ++n)
+			{
+				const uint32_t x = blockX * 4 + n % 4;
+				const uint32_t y = blockY * 4 + n / 4;
+				if (x < width && y < height)
+				{
+					memcpy(image.Pixels.data() + (static_cast<size_t>(y) * width + x) * 4, pixels + n * 4, 4);
+				}
+			}
+		}
+	}
+}
+
+double ComputePSNR(const Image& a, const Image& b, uint32_t channelCount)
+{
+	double sum = 0.0;
+	for (size_t n = 0; n < a.Pixels.size(); n += 4)
+	{
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			const double difference = static_cast<double>(a.Pixels[n + c]) - b.Pixels[n + c];
+			sum += difference * difference;
+		}
+	}
+	if (sum == 0.0)
+	{
+		return std::numeric_limits<double>::infinity();
+	}
+	const double meanSquared = sum / (static_cast<double>(a.Pixels.size() / 4) * channelCount);
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquared);
+}
+
+bool BuildCompressedDDS(const Image& image, uint32_t format, uint32_t mipCount, ThreadPool& pool, bool simd, std::vector<uint8_t>& dds, std::string& error)
+{
+	if (image.Width % 4 != 0 || image.Height % 4 != 0)
+	{
+		error = "block compressed textures need a width and height that are multiples of 4";
+		return false;
+	}
+	const uint32_t fullMipCount = GetFullMipCount(image.Width, image.Height);
+	mipCount = mipCount == 0 ? fullMipCount : (std::min)(mipCount, fullMipCount);
+
+	dds.clear();
+	WriteDDSHeader(format, image.Width, image.Height, 1, mipCount, dds);
+	Image mip = image;
+	std::vector<uint8_t> blocks;
+	for (uint32_t level = 0; level < mipCount; ++level)
+	{
+		if (level > 0)
+		{
+			Image next;
+			DownsampleImage(mip, next);
+			mip.Width = next.Width;
+			mip.Height = next.Height;
+			mip.Pixels.swap(next.Pixels);
+		}
+		CompressImage(mip, format, pool, simd, blocks);
+		dds.insert(dds.end(), blocks.begin(), blocks.end());
+	}
+	return true;
+}
+
+bool UpdateCompressedTexture(const std::filesystem::path& sourcePath, const std::filesystem::path& ddsPath, uint32_t format, ThreadPool& pool, std::string& error)
+{
+	error.clear();
+	std::error_code code;
+	const std::filesystem::file_time_type ddsWriteTime = std::filesystem::last_write_time(ddsPath, code);
+	if (!code)
+	{
+		const std::filesystem::file_time_type sourceWriteTime = std::filesystem::last_write_time(sourcePath, code);
+		if (!code && sourceWriteTime <= ddsWriteTime)
+		{
+			return true;
+		}
+	}
+
+	Image image;
+	if (!LoadImageFile(sourcePath, image, error))
+	{
+		error = "can't read " + sourcePath.filename().string() + ", " + error;
+		return false;
+	}
+	std::vector<uint8_t> dds;
+	if (!BuildCompressedDDS(image, format == 0 ? ChooseBlockFormat(image) : format, 0, pool, true, dds, error))
+	{
+		error = sourcePath.filename().string() + ": " + error;
+		return false;
+	}
+
+	std::ofstream file(ddsPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(dds.data()), dds.size());
+	file.close();
+	if (!file)
+	{
+		error = "can't write " + ddsPath.filename().string();
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ImageFile.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Block compression of authored images into DDS files DDSTextureLoader12 and ParseDDS read. Formats are the DXGI_FORMAT values below.
+// BC1 and BC4 fit endpoints along the principal axis and refine them by least squares, BC3 is a BC1 color block after a BC4 alpha block,
+// and BC7 writes mode 6 only, one RGBA endpoint pair with p-bits and 16 index levels, which suits smooth particle sprites best of the
+// single subset modes. Index searches run on four texels at a time with SSE2, the scalar path gives the same bytes.
+#define BLOCK_FORMAT_BC1 71 // DXGI_FORMAT_BC1_UNORM
+#define BLOCK_FORMAT_BC3 77 // DXGI_FORMAT_BC3_UNORM
+#define BLOCK_FORMAT_BC4 80 // DXGI_FORMAT_BC4_UNORM
+#define BLOCK_FORMAT_BC7 98 // DXGI_FORMAT_BC7_UNORM
+
+// One 4x4 block, pixels are its 16 RGBA texels row by row
+void EncodeBC1Block(const uint8_t* pixels, uint8_t* block, bool simd);
+void EncodeBC3Block(const uint8_t* pixels, uint8_t* block, bool simd);
+void EncodeBC4Block(const uint8_t* pixels, uint8_t* block, bool simd); // Red only
+void EncodeBC7Block(const uint8_t* pixels, uint8_t* block, bool simd);
+
+// BC4 decodes to red with green and blue 0 and alpha 255, like the sampler returns it. BC7 blocks in other modes than 6 decode to 0.
+void DecodeBC1Block(const uint8_t* block, uint8_t* pixels);
+void DecodeBC3Block(const uint8_t* block, uint8_t* pixels);
+void DecodeBC4Block(const uint8_t* block, uint8_t* pixels);
+void DecodeBC7Block(const uint8_t* block, uint8_t* pixels);
+
+// BC1 for opaque color, BC4 for opaque gray and BC7 as soon as a texel isn't opaque, the particle shaders blend with alpha
+uint32_t ChooseBlockFormat(const Image& image);
+
+// Channels that carry data in format, the ones PSNR is measured over
+uint32_t GetBlockFormatChannels(uint32_t format);
+
+// Half size with a 2x2 box filter, the last row and column of odd sizes are clamped to the edge
+void DownsampleImage(const Image& source, Image& destination);
+
+// Levels down to 1x1
+uint32_t GetFullMipCount(uint32_t width, uint32_t height);
+
+// Compresses image at GetDDSSurfaceSize's pitch into blocks, rows of blocks split over pool. Edge blocks repeat the last row and column.
+void CompressImage(const Image& image, uint32_t format, ThreadPool& pool, bool simd, std::vector<uint8_t>& blocks);
+void DecompressImage(const uint8_t* blocks, uint32_t format, uint32_t width, uint32_t height, Image& image);
+
+// PSNR in dB over the first channelCount channels, infinity for identical images
+double ComputePSNR(const Image& a, const Image& b, uint32_t channelCount);
+
+// DDS file image of image and mipCount - 1 downsampled mips, 0 for the full chain. D3D12 wants the top level of BC textures
+// in multiples of 4 texels, other sizes fail.
+bool BuildCompressedDDS(const Image& image, uint32_t format, uint32_t mipCount, ThreadPool& pool, bool simd, std::vector<uint8_t>& dds, std::string& error);
+
+// Compresses the PNG or TGA at sourcePath into ddsPath with the full mip chain when ddsPath is missing or older.
+// format 0 picks one with ChooseBlockFormat.
+bool UpdateCompressedTexture(const std::filesystem::path& sourcePath, const std::filesystem::path& ddsPath, uint32_t format, ThreadPool& pool, std::string& error);
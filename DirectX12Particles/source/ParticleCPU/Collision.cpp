@@ -0,0 +1,221 @@
+#include "Collision.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLLISION_SSE 1
+#include <emmintrin.h>
+#endif
+
+std::vector<uint> BuildCollisionGrid(const std::vector<CollisionPlane>& planes, float margin, CollisionConstants& constants)
+{
+	float3 boundsMin(1e30f, 1e30f, 1e30f);
+	float3 boundsMax(-1e30f, -1e30f, -1e30f);
+	for (const CollisionPlane& plane : planes)
+	{
+		const float3 center(plane.Center.x, plane.Center.y, plane.Center.z);
+		const float3 u = float3(plane.AxisU.x, plane.AxisU.y, plane.AxisU.z) * plane.AxisU.w;
+		const float3 v = float3(plane.AxisV.x, plane.AxisV.y, plane.AxisV.z) * plane.AxisV.w;
+		const float3 extent = abs(u) + abs(v);
+		boundsMin = (min)(boundsMin, center - extent);
+		boundsMax = (max)(boundsMax, center + extent);
+	}
+	boundsMin -= float3(margin, margin, margin);
+	boundsMax += float3(margin, margin, margin);
+
+	const float3 size = boundsMax - boundsMin;
+	constants.GridMin = boundsMin;
+	constants.CellSize = (max)(size.x, (max)(size.y, size.z)) / COLLISION_GRID_SIZE;
+	constants.PlaneCount = static_cast<uint>(planes.size());
+
+	// Conservative box test, the cell is treated as a sphere around its center
+	const float reach = constants.CellSize * 0.8660254f + margin;
+	std::vector<uint> grid(COLLISION_GRID_SIZE * COLLISION_GRID_SIZE * COLLISION_GRID_SIZE, 0u);
+	for (uint z = 0; z < COLLISION_GRID_SIZE; ++z)
+	{
+		for (uint y = 0; y < COLLISION_GRID_SIZE; ++y)
+		{
+			for (uint x = 0; x < COLLISION_GRID_SIZE; ++x)
+			{
+				const float3 cellCenter = boundsMin + float3(x + 0.5f, y + 0.5f, z + 0.5f) * constants.CellSize;
+				uint mask = 0;
+				for (uint p = 0; p < planes.size() && p < COLLISION_MAX_PLANES; ++p)
+				{
+					const CollisionPlane& plane = planes[p];
+					const float3 offset = cellCenter - float3(plane.Center.x, plane.Center.y, plane.Center.z);
+					const float distance = dot(offset, float3(plane.Plane.x, plane.Plane.y, plane.Plane.z));
+					const float u = dot(offset, float3(plane.AxisU.x, plane.AxisU.y, plane.AxisU.z));
+					const float v = dot(offset, float3(plane.AxisV.x, plane.AxisV.y, plane.AxisV.z));
+					if (abs(distance) <= reach && abs(u) <= plane.AxisU.w + reach && abs(v) <= plane.AxisV.w + reach)
+					{
+						mask |= 1u << p;
+					}
+				}
+				grid[(z * COLLISION_GRID_SIZE + y) * COLLISION_GRID_SIZE + x] = mask;
+			}
+		}
+	}
+	return grid;
+}
+
+static uint CellMask(const std::vector<uint>& grid, float3 position, const CollisionConstants& constants)
+{
+	const uint cell = CollisionGridCell(position, constants);
+	return cell < grid.size() ? grid[cell] : 0u;
+}
+
+float FindCollision(const std::vector<CollisionPlane>& planes, const std::vector<uint>& grid, const CollisionConstants& constants,
+	float3 from, float3 to, float radius, uint& hitPlane)
+{
+	float nearest = COLLISION_NO_HIT;
+	uint mask = CellMask(grid, to, constants);
+	while (mask)
+	{
+		uint p = 0;
+		while (!(mask & (1u << p)))
+		{
+			++p;
+		}
+		mask &= mask - 1;
+
+		const float t = CollisionPlaneHit(planes[p], from, to, radius);
+		if (t < nearest)
+		{
+			nearest = t;
+			hitPlane = p;
+		}
+	}
+	return nearest;
+}
+
+// Runs the shared response on one particle of the arrays
+static void RespondParticle(CollideParticlesSoA& particles, size_t n, const CollisionPlane& plane, float t, const CollisionConstants& constants)
+{
+	Particle particle;
+	particle.position = float4(particles.positionX[n], particles.positionY[n], particles.positionZ[n], 1);
+	particle.velocity = float4(particles.velocityX[n], particles.velocityY[n], particles.velocityZ[n], 0);
+	particle.lifeTimeLeft = particles.lifeTimeLeft[n];
+
+	particle = CollisionResponse(particle, CollisionPlaneNormal(plane), float3(particles.previousX[n], particles.previousY[n], particles.previousZ[n]), t, constants);
+
+	particles.positionX[n] = particle.position.x;
+	particles.positionY[n] = particle.position.y;
+	particles.positionZ[n] = particle.position.z;
+	particles.velocityX[n] = particle.velocity.x;
+	particles.velocityY[n] = particle.velocity.y;
+	particles.velocityZ[n] = particle.velocity.z;
+	particles.lifeTimeLeft[n] = particle.lifeTimeLeft;
+}
+
+static void CollideParticle(CollideParticlesSoA& particles, size_t n, const std::vector<CollisionPlane>& planes, const std::vector<uint>& grid, const CollisionConstants& constants)
+{
+	const float3 from(particles.previousX[n], particles.previousY[n], particles.previousZ[n]);
+	const float3 to(particles.positionX[n], particles.positionY[n], particles.positionZ[n]);
+	uint hitPlane = 0;
+	const float t = FindCollision(planes, grid, constants, from, to, particles.scale[n] * constants.RadiusScale, hitPlane);
+	if (t <= 1.0f)
+	{
+		RespondParticle(particles, n, planes[hitPlane], t, constants);
+	}
+}
+
+void CollideParticles(CollideParticlesSoA& particles, const std::vector<CollisionPlane>& planes, const std::vector<uint>& grid, const CollisionConstants& constants)
+{
+	for (size_t n = 0; n < particles.Size(); ++n)
+	{
+		CollideParticle(particles, n, planes, grid, constants);
+	}
+}
+
+void CollideParticlesSIMD(CollideParticlesSoA& particles, const std::vector<CollisionPlane>& planes, const std::vector<uint>& grid, const CollisionConstants& constants)
+{
+#if COLLISION_SSE
+	const size_t count = particles.Size();
+	const size_t simdCount = count & ~size_t(3);
+	const __m128 radiusScale = _mm_set1_ps(constants.RadiusScale);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (size_t n = 0; n < simdCount; n += 4)
+	{
+		const __m128 fromX = _mm_loadu_ps(&particles.previousX[n]);
+		const __m128 fromY = _mm_loadu_ps(&particles.previousY[n]);
+		const __m128 fromZ = _mm_loadu_ps(&particles.previousZ[n]);
+		const __m128 toX = _mm_loadu_ps(&particles.positionX[n]);
+		const __m128 toY = _mm_loadu_ps(&particles.positionY[n]);
+		const __m128 toZ = _mm_loadu_ps(&particles.positionZ[n]);
+		const __m128 radius = _mm_mul_ps(_mm_loadu_ps(&particles.scale[n]), radiusScale);
+
+		// Lane i tests plane p only when bit p is set in its own cell mask
+		alignas(16) uint laneMasks[4];
+		uint unionMask = 0;
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			laneMasks[lane] = CellMask(grid, float3(particles.positionX[n + lane], particles.positionY[n + lane], particles.positionZ[n + lane]), constants);
+			unionMask |= laneMasks[lane];
+		}
+		if (!unionMask)
+		{
+			continue;
+		}
+		const __m128i masks = _mm_load_si128(reinterpret_cast<const __m128i*>(laneMasks));
+
+		__m128 nearest = _mm_set1_ps(COLLISION_NO_HIT);
+		__m128i nearestPlane = _mm_setzero_si128();
+		while (unionMask)
+		{
+			uint p = 0;
+			while (!(unionMask & (1u << p)))
+			{
+				++p;
+			}
+			unionMask &= unionMask - 1;
+			const CollisionPlane& plane = planes[p];
+
+			// Same operation order as CollisionPlaneHit so lanes agree with the scalar reference
+			const __m128 normalX = _mm_set1_ps(plane.Plane.x);
+			const __m128 normalY = _mm_set1_ps(plane.Plane.y);
+			const __m128 normalZ = _mm_set1_ps(plane.Plane.z);
+			const __m128 planeW = _mm_set1_ps(plane.Plane.w);
+			__m128 distanceFrom = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, fromX), _mm_mul_ps(normalY, fromY)), _mm_mul_ps(normalZ, fromZ)), planeW);
+			__m128 distanceTo = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, toX), _mm_mul_ps(normalY, toY)), _mm_mul_ps(normalZ, toZ)), planeW);
+			const __m128 flip = _mm_and_ps(_mm_cmplt_ps(distanceFrom, zero), signBit);
+			distanceFrom = _mm_xor_ps(distanceFrom, flip);
+			distanceTo = _mm_xor_ps(distanceTo, flip);
+
+			const __m128 t = _mm_div_ps(_mm_sub_ps(distanceFrom, radius), _mm_sub_ps(distanceFrom, distanceTo));
+			const __m128 offsetX = _mm_sub_ps(_mm_add_ps(fromX, _mm_mul_ps(_mm_sub_ps(toX, fromX), t)), _mm_set1_ps(plane.Center.x));
+			const __m128 offsetY = _mm_sub_ps(_mm_add_ps(fromY, _mm_mul_ps(_mm_sub_ps(toY, fromY), t)), _mm_set1_ps(plane.Center.y));
+			const __m128 offsetZ = _mm_sub_ps(_mm_add_ps(fromZ, _mm_mul_ps(_mm_sub_ps(toZ, fromZ), t)), _mm_set1_ps(plane.Center.z));
+			const __m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(offsetX, _mm_set1_ps(plane.AxisU.x)), _mm_mul_ps(offsetY, _mm_set1_ps(plane.AxisU.y))), _mm_mul_ps(offsetZ, _mm_set1_ps(plane.AxisU.z)));
+			const __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(offsetX, _mm_set1_ps(plane.AxisV.x)), _mm_mul_ps(offsetY, _mm_set1_ps(plane.AxisV.y))), _mm_mul_ps(offsetZ, _mm_set1_ps(plane.AxisV.z)));
+
+			__m128 hit = _mm_and_ps(_mm_cmpge_ps(distanceFrom, radius), _mm_cmplt_ps(distanceTo, radius));
+			hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_andnot_ps(signBit, u), _mm_set1_ps(plane.AxisU.w)));
+			hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_andnot_ps(signBit, v), _mm_set1_ps(plane.AxisV.w)));
+			hit = _mm_and_ps(hit, _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(masks, _mm_set1_epi32(static_cast<int>(1u << p))), _mm_set1_epi32(static_cast<int>(1u << p)))));
+			hit = _mm_and_ps(hit, _mm_cmplt_ps(t, nearest));
+
+			nearest = _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, nearest));
+			nearestPlane = _mm_or_si128(_mm_and_si128(_mm_castps_si128(hit), _mm_set1_epi32(static_cast<int>(p))), _mm_andnot_si128(_mm_castps_si128(hit), nearestPlane));
+		}
+
+		alignas(16) float laneT[4];
+		alignas(16) uint lanePlane[4];
+		_mm_store_ps(laneT, nearest);
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanePlane), nearestPlane);
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			if (laneT[lane] <= 1.0f)
+			{
+				RespondParticle(particles, n + lane, planes[lanePlane[lane]], laneT[lane], constants);
+			}
+		}
+	}
+
+	for (size_t n = simdCount; n < count; ++n)
+	{
+		CollideParticle(particles, n, planes, grid, constants);
+	}
+#else
+	CollideParticles(particles, planes, grid, constants);
+#endif
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../ParticleGame/Collision.hlsli"
+
+#include <vector>
+
+// Cell masks of the broadphase grid, COLLISION_GRID_SIZE^3 entries in CollisionGridCell order.
+// Fills the grid placement of constants, a plane is added to every cell within margin of its rectangle,
+// so margin has to cover the largest particle radius plus the furthest a particle moves in one step.
+std::vector<uint> BuildCollisionGrid(const std::vector<CollisionPlane>& planes, float margin, CollisionConstants& constants);
+
+// Broadphase mask lookup plus the nearest hit of one step, COLLISION_NO_HIT if nothing is hit.
+// This is the loop ComputeSimulator.hlsl runs per particle.
+float FindCollision(const std::vector<CollisionPlane>& planes, const std::vector<uint>& grid, const CollisionConstants& constants,
+	float3 from, float3 to, float radius, uint& hitPlane);
+
+// The particle fields collision reads and writes, one array per component so four particles fill an SSE register
+struct CollideParticlesSoA
+{
+	std::vector<float> previousX; // Position before the step
+	std::vector<float> previousY;
+	std::vector<float> previousZ;
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> velocityX;
+	std::vector<float> velocityY;
+	std::vector<float> velocityZ;
+	std::vector<float> scale;
+	std::vector<float> lifeTimeLeft;
+
+	size_t Size() const { return positionX.size(); }
+};
+
+// CPU reference of the plane collision in ComputeSimulator.hlsl, resolves the nearest hit of every particle's step
+void CollideParticles(CollideParticlesSoA& particles, const std::vector<CollisionPlane>& planes, const std::vector<uint>& grid, const CollisionConstants& constants);
+
+// Same result as CollideParticles, each plane in the union of four particles' cell masks is tested against all four at once.
+// Builds without SSE fall back to CollideParticles.
+void CollideParticlesSIMD(CollideParticlesSoA& particles, const std::vector<CollisionPlane>& planes, const std::vector<uint>& grid, const CollisionConstants& constants);
@@ -0,0 +1,102 @@
+#include "Culling.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Occlusion half of the test, the particle is already known to be inside the frustum
+static bool PassesHiZ(float3 center, float radius, const CullConstants& cull, const std::vector<HiZLevel>& hiZ)
+{
+	if (!cull.HiZEnabled)
+	{
+		return true;
+	}
+
+	const HiZBounds bounds = ProjectSphereToHiZ(center, radius, cull);
+	const uint mip = HiZCullMip(bounds, cull);
+	const uint4 texels = HiZCullTexels(bounds, cull, mip);
+	const HiZLevel& level = hiZ[mip];
+	const float2 furthest = HiZReduce(level.Load(texels.x, texels.y), level.Load(texels.z, texels.y),
+		level.Load(texels.x, texels.w), level.Load(texels.z, texels.w));
+	return !HiZOccluded(bounds, furthest);
+}
+
+void CullParticles(const CullParticlesSoA& particles, const CullConstants& cull, const std::vector<HiZLevel>& hiZ, std::vector<uint>& visible)
+{
+	for (size_t n = 0; n < particles.Size(); ++n)
+	{
+		const float3 center(particles.positionX[n], particles.positionY[n], particles.positionZ[n]);
+		const float radius = particles.scale[n] * CULL_BILLBOARD_RADIUS;
+
+		if (SphereInFrustum(center, radius, cull) && PassesHiZ(center, radius, cull, hiZ))
+		{
+			visible.push_back(static_cast<uint>(n));
+		}
+	}
+}
+
+void CullParticlesSIMD(const CullParticlesSoA& particles, const CullConstants& cull, const std::vector<HiZLevel>& hiZ, std::vector<uint>& visible)
+{
+#if CULLING_SSE
+	const size_t count = particles.Size();
+	const size_t simdCount = count & ~size_t(3);
+
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int plane = 0; plane < 6; ++plane)
+	{
+		planeX[plane] = _mm_set1_ps(cull.FrustumPlanes[plane].x);
+		planeY[plane] = _mm_set1_ps(cull.FrustumPlanes[plane].y);
+		planeZ[plane] = _mm_set1_ps(cull.FrustumPlanes[plane].z);
+		planeW[plane] = _mm_set1_ps(cull.FrustumPlanes[plane].w);
+	}
+	const __m128 radiusScale = _mm_set1_ps(-CULL_BILLBOARD_RADIUS);
+
+	for (size_t n = 0; n < simdCount; n += 4)
+	{
+		const __m128 x = _mm_loadu_ps(&particles.positionX[n]);
+		const __m128 y = _mm_loadu_ps(&particles.positionY[n]);
+		const __m128 z = _mm_loadu_ps(&particles.positionZ[n]);
+		const __m128 negativeRadius = _mm_mul_ps(_mm_loadu_ps(&particles.scale[n]), radiusScale);
+
+		// A lane survives while its distance to every plane is at least -radius
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			// Same summation order as dot() so lanes agree with the scalar test on the boundary
+			__m128 distance = _mm_mul_ps(x, planeX[plane]);
+			distance = _mm_add_ps(distance, _mm_mul_ps(y, planeY[plane]));
+			distance = _mm_add_ps(distance, _mm_mul_ps(z, planeZ[plane]));
+			distance = _mm_add_ps(distance, planeW[plane]);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		while (mask)
+		{
+			const int lane = mask & -mask;
+			const size_t index = n + (lane == 1 ? 0 : lane == 2 ? 1 : lane == 4 ? 2 : 3);
+			mask &= mask - 1;
+
+			const float3 center(particles.positionX[index], particles.positionY[index], particles.positionZ[index]);
+			if (PassesHiZ(center, particles.scale[index] * CULL_BILLBOARD_RADIUS, cull, hiZ))
+			{
+				visible.push_back(static_cast<uint>(index));
+			}
+		}
+	}
+
+	for (size_t n = simdCount; n < count; ++n)
+	{
+		const float3 center(particles.positionX[n], particles.positionY[n], particles.positionZ[n]);
+		const float radius = particles.scale[n] * CULL_BILLBOARD_RADIUS;
+
+		if (SphereInFrustum(center, radius, cull) && PassesHiZ(center, radius, cull, hiZ))
+		{
+			visible.push_back(static_cast<uint>(n));
+		}
+	}
+#else
+	CullParticles(particles, cull, hiZ, visible);
+#endif
+}
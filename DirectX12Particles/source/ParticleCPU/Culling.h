@@ -0,0 +1,25 @@
+#pragma once
+
+#include "../ParticleGame/Culling.hlsli"
+#include "HiZ.h"
+
+#include <vector>
+
+// The particle fields the culling test reads, one array per component so four particles fill an SSE register
+struct CullParticlesSoA
+{
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> scale;
+
+	size_t Size() const { return positionX.size(); }
+};
+
+// CPU reference of the frustum and Hi-Z test in ComputeSimulator.hlsl, appends the indices of visible particles.
+// hiZ is the pyramid from BuildHiZ the cull constants describe, it is ignored when HiZEnabled is 0.
+void CullParticles(const CullParticlesSoA& particles, const CullConstants& cull, const std::vector<HiZLevel>& hiZ, std::vector<uint>& visible);
+
+// Same result as CullParticles, the frustum planes are tested against four particles at a time.
+// Builds without SSE fall back to CullParticles.
+void CullParticlesSIMD(const CullParticlesSoA& particles, const CullConstants& cull, const std::vector<HiZLevel>& hiZ, std::vector<uint>& visible);
@@ -0,0 +1,244 @@
+#include "CurlNoise.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+static const uint CurlNoiseMagic = 0x4c525543; // "CURL"
+static const uint CurlNoiseVersion = 1;
+
+// Everything the cache has to match before its texels are used
+struct CurlNoiseFileHeader
+{
+	uint Magic;
+	uint Version;
+	uint Size;
+	uint Period;
+	uint Octaves;
+	uint Seed;
+};
+
+static uint HashLattice(uint x, uint y, uint z, uint seed)
+{
+	uint hash = seed * 0x9e3779b9u;
+	hash ^= x * 0x85ebca6bu;
+	hash = (hash << 13) | (hash >> 19);
+	hash ^= y * 0xc2b2ae35u;
+	hash = (hash << 13) | (hash >> 19);
+	hash ^= z * 0x27d4eb2fu;
+	hash ^= hash >> 16;
+	hash *= 0x7feb352du;
+	hash ^= hash >> 15;
+	return hash;
+}
+
+// One of the 12 cube edge directions of improved Perlin noise
+static float GradientDot(uint hash, float x, float y, float z)
+{
+	switch (hash % 12)
+	{
+	case 0: return x + y;
+	case 1: return -x + y;
+	case 2: return x - y;
+	case 3: return -x - y;
+	case 4: return x + z;
+	case 5: return -x + z;
+	case 6: return x - z;
+	case 7: return -x - z;
+	case 8: return y + z;
+	case 9: return -y + z;
+	case 10: return y - z;
+	default: return -y - z;
+	}
+}
+
+static float Fade(float t)
+{
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+// Gradient noise whose lattice wraps every period cells, so it tiles over [0, period)
+static float PeriodicNoise(float x, float y, float z, uint period, uint seed)
+{
+	const float floorX = std::floor(x);
+	const float floorY = std::floor(y);
+	const float floorZ = std::floor(z);
+	const float fx = x - floorX;
+	const float fy = y - floorY;
+	const float fz = z - floorZ;
+	const uint x0 = static_cast<uint>(static_cast<int>(floorX)) % period;
+	const uint y0 = static_cast<uint>(static_cast<int>(floorY)) % period;
+	const uint z0 = static_cast<uint>(static_cast<int>(floorZ)) % period;
+	const uint x1 = (x0 + 1) % period;
+	const uint y1 = (y0 + 1) % period;
+	const uint z1 = (z0 + 1) % period;
+
+	const float u = Fade(fx);
+	const float v = Fade(fy);
+	const float w = Fade(fz);
+	const float c000 = GradientDot(HashLattice(x0, y0, z0, seed), fx, fy, fz);
+	const float c100 = GradientDot(HashLattice(x1, y0, z0, seed), fx - 1.0f, fy, fz);
+	const float c010 = GradientDot(HashLattice(x0, y1, z0, seed), fx, fy - 1.0f, fz);
+	const float c110 = GradientDot(HashLattice(x1, y1, z0, seed), fx - 1.0f, fy - 1.0f, fz);
+	const float c001 = GradientDot(HashLattice(x0, y0, z1, seed), fx, fy, fz - 1.0f);
+	const float c101 = GradientDot(HashLattice(x1, y0, z1, seed), fx - 1.0f, fy, fz - 1.0f);
+	const float c011 = GradientDot(HashLattice(x0, y1, z1, seed), fx, fy - 1.0f, fz - 1.0f);
+	const float c111 = GradientDot(HashLattice(x1, y1, z1, seed), fx - 1.0f, fy - 1.0f, fz - 1.0f);
+	return lerp(lerp(lerp(c000, c100, u), lerp(c010, c110, u), v), lerp(lerp(c001, c101, u), lerp(c011, c111, u), v), w);
+}
+
+static size_t TexelIndex(uint x, uint y, uint z, uint size)
+{
+	return (static_cast<size_t>(z) * size + y) * size + x;
+}
+CurlNoiseVolume BakeCurlNoise(const CurlNoiseSettings& settings, ThreadPool& pool)
+{
+	const uint size = settings.Size;
+	CurlNoiseVolume volume;
+	volume.Size = size;
+	volume.Texels.resize(static_cast<size_t>(size) * size * size);
+
+	// Vector potential at every texel center, one independent noise per component
+	std::vector<float3> potential(volume.Texels.size());
+	pool.ParallelFor(size, [&](size_t begin, size_t end, uint32_t)
+	{
+		for (uint z = static_cast<uint>(begin); z < end; ++z)
+		{
+			for (uint y = 0; y < size; ++y)
+			{
+				for (uint x = 0; x < size; ++x)
+				{
+					float3 sum;
+					float amplitude = 1.0f;
+					uint period = settings.Period;
+					for (uint octave = 0; octave < settings.Octaves; ++octave)
+					{
+						const float scale = static_cast<float>(period) / size;
+						const float px = (x + 0.5f) * scale;
+						const float py = (y + 0.5f) * scale;
+						const float pz = (z + 0.5f) * scale;
+						const uint seed = settings.Seed * 3 + octave * 0x10000;
+						sum += float3(PeriodicNoise(px, py, pz, period, seed), PeriodicNoise(px, py, pz, period, seed + 1),
+							PeriodicNoise(px, py, pz, period, seed + 2)) * amplitude;
+						amplitude *= 0.5f;
+						period *= 2;
+					}
+					potential[TexelIndex(x, y, z, size)] = sum;
+				}
+			}
+		}
+	});
+
+	// curl = (dPz/dy - dPy/dz, dPx/dz - dPz/dx, dPy/dx - dPx/dy), each slice also collects its squared lengths for the RMS
+	std::vector<double> sliceEnergy(size, 0.0);
+	pool.ParallelFor(size, [&](size_t begin, size_t end, uint32_t)
+	{
+		for (uint z = static_cast<uint>(begin); z < end; ++z)
+		{
+			const uint zm = (z + size - 1) % size;
+			const uint zp = (z + 1) % size;
+			double energy = 0.0;
+			for (uint y = 0; y < size; ++y)
+			{
+				const uint ym = (y + size - 1) % size;
+				const uint yp = (y + 1) % size;
+				for (uint x = 0; x < size; ++x)
+				{
+					const uint xm = (x + size - 1) % size;
+					const uint xp = (x + 1) % size;
+					const float3 dx = potential[TexelIndex(xp, y, z, size)] - potential[TexelIndex(xm, y, z, size)];
+					const float3 dy = potential[TexelIndex(x, yp, z, size)] - potential[TexelIndex(x, ym, z, size)];
+					const float3 dz = potential[TexelIndex(x, y, zp, size)] - potential[TexelIndex(x, y, zm, size)];
+					const float3 curl(dy.z - dz.y, dz.x - dx.z, dx.y - dy.x);
+					volume.Texels[TexelIndex(x, y, z, size)] = float4(curl, 0.0f);
+					energy += dot(curl, curl);
+				}
+			}
+			sliceEnergy[z] = energy;
+		}
+	});
+
+	double energy = 0.0;
+	for (double slice : sliceEnergy)
+	{
+		energy += slice;
+	}
+	const float rmsScale = energy > 0.0 ? static_cast<float>(1.0 / std::sqrt(energy / volume.Texels.size())) : 0.0f;
+	pool.ParallelFor(volume.Texels.size(), [&](size_t begin, size_t end, uint32_t)
+	{
+		for (size_t n = begin; n < end; ++n)
+		{
+			volume.Texels[n] = volume.Texels[n] * rmsScale;
+		}
+	});
+	return volume;
+}
+
+CurlNoiseVolume LoadOrBakeCurlNoise(const std::filesystem::path& cachePath, const CurlNoiseSettings& settings, ThreadPool& pool)
+{
+	const CurlNoiseFileHeader expected = { CurlNoiseMagic, CurlNoiseVersion, settings.Size, settings.Period, settings.Octaves, settings.Seed };
+
+	std::ifstream cacheFile(cachePath, std::ios::in | std::ios::binary);
+	if (cacheFile)
+	{
+		CurlNoiseFileHeader header = {};
+		cacheFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (cacheFile && memcmp(&header, &expected, sizeof(header)) == 0)
+		{
+			CurlNoiseVolume volume;
+			volume.Size = settings.Size;
+			volume.Texels.resize(static_cast<size_t>(settings.Size) * settings.Size * settings.Size);
+			cacheFile.read(reinterpret_cast<char*>(volume.Texels.data()), volume.Texels.size() * sizeof(float4));
+			if (cacheFile)
+			{
+				return volume;
+			}
+		}
+	}
+	cacheFile.close();
+
+	CurlNoiseVolume volume = BakeCurlNoise(settings, pool);
+	std::ofstream outFile(cachePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (outFile)
+	{
+		outFile.write(reinterpret_cast<const char*>(&expected), sizeof(expected));
+		outFile.write(reinterpret_cast<const char*>(volume.Texels.data()), volume.Texels.size() * sizeof(float4));
+	}
+	return volume;
+}
+
+float3 SampleCurlNoise(const CurlNoiseVolume& volume, float3 uvw)
+{
+	// Texel centers sit at (i + 0.5) / size, like the hardware filter
+	const int size = static_cast<int>(volume.Size);
+	const float x = uvw.x * size - 0.5f;
+	const float y = uvw.y * size - 0.5f;
+	const float z = uvw.z * size - 0.5f;
+	const float floorX = std::floor(x);
+	const float floorY = std::floor(y);
+	const float floorZ = std::floor(z);
+	const float fx = x - floorX;
+	const float fy = y - floorY;
+	const float fz = z - floorZ;
+
+	auto wrap = [size](float coordinate)
+	{
+		const int index = static_cast<int>(coordinate) % size;
+		return static_cast<uint>(index < 0 ? index + size : index);
+	};
+	const uint x0 = wrap(floorX);
+	const uint y0 = wrap(floorY);
+	const uint z0 = wrap(floorZ);
+	const uint x1 = (x0 + 1) % volume.Size;
+	const uint y1 = (y0 + 1) % volume.Size;
+	const uint z1 = (z0 + 1) % volume.Size;
+
+	auto texel = [&](uint tx, uint ty, uint tz)
+	{
+		const float4& value = volume.Texels[TexelIndex(tx, ty, tz, volume.Size)];
+		return float3(value.x, value.y, value.z);
+	};
+	const float3 front = lerp(lerp(texel(x0, y0, z0), texel(x1, y0, z0), fx), lerp(texel(x0, y1, z0), texel(x1, y1, z0), fx), fy);
+	const float3 back = lerp(lerp(texel(x0, y0, z1), texel(x1, y0, z1), fx), lerp(texel(x0, y1, z1), texel(x1, y1, z1), fx), fy);
+	return lerp(front, back, fz);
+}
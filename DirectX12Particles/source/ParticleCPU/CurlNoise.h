@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../ParticleGame/CurlNoise.hlsli"
+#include "ThreadPool.h"
+
+#include <filesystem>
+#include <vector>
+
+// Bake inputs, all of them are part of the cache file header so changing any one rebakes
+struct CurlNoiseSettings
+{
+	uint Size = CURL_NOISE_SIZE;
+	uint Period = 4; // Noise lattice cells across the volume in the first octave, every octave doubles it so the result still tiles
+	uint Octaves = 3;
+	uint Seed = 1;
+};
+
+// Tiling divergence-free velocity field, x fastest then y then z like a D3D12 3D subresource.
+// The w channel is unused, it keeps texels the size of an R32G32B32A32_FLOAT texel.
+struct CurlNoiseVolume
+{
+	uint Size = 0;
+	std::vector<float4> Texels;
+
+	bool Empty() const { return Texels.empty(); }
+};
+
+// Bakes three periodic gradient noise potentials and takes their curl with wrapped central differences,
+// which keeps the discrete field divergence-free. The result is scaled to an RMS length of 1. Slices are split over the pool.
+CurlNoiseVolume BakeCurlNoise(const CurlNoiseSettings& settings, ThreadPool& pool);
+
+// Reads the volume from the cache file, or bakes it and writes the file when it is missing or was baked with other settings.
+// A cache that can't be written is not an error, the next load just bakes again.
+CurlNoiseVolume LoadOrBakeCurlNoise(const std::filesystem::path& cachePath, const CurlNoiseSettings& settings, ThreadPool& pool);
+
+// CPU version of SampleLevel with a trilinear wrap sampler at texture coordinates uvw
+float3 SampleCurlNoise(const CurlNoiseVolume& volume, float3 uvw);
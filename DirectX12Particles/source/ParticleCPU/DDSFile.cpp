@@ -0,0 +1,367 @@
+#include "DDSFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const uint32_t DDSMagic = 0x20534444; // "DDS "
+
+// Header flags
+static const uint32_t DDSCaps = 0x1;
+static const uint32_t DDSHeight = 0x2;
+static const uint32_t DDSWidth = 0x4;
+static const uint32_t DDSPixelFormatFlag = 0x1000;
+static const uint32_t DDSMipMapCount = 0x20000;
+static const uint32_t DDSDepth = 0x800000;
+
+// Caps
+static const uint32_t DDSCapsComplex = 0x8;
+static const uint32_t DDSCapsTexture = 0x1000;
+static const uint32_t DDSCapsMipMap = 0x400000;
+
+// Pixel format flags
+static const uint32_t DDSAlphaOnly = 0x2;
+static const uint32_t DDSFourCC = 0x4;
+static const uint32_t DDSRGB = 0x40;
+static const uint32_t DDSLuminance = 0x20000;
+
+// Caps2 and DX10 misc flags
+static const uint32_t DDSCubeMap = 0x200;
+static const uint32_t DDSCubeMapAllFaces = 0xfc00;
+static const uint32_t DDSDX10TextureCube = 0x4;
+
+// D3D12 resource limits
+static const uint32_t DDSMaxMipCount = 15;
+static const uint32_t DDSMaxArraySize = 2048;
+static const uint32_t DDSMaxTexture1DSize = 16384;
+static const uint32_t DDSMaxTexture2DSize = 16384;
+static const uint32_t DDSMaxTexture3DSize = 2048;
+static const uint32_t DDSMaxCubeSize = 16384;
+
+struct DDSPixelFormat
+{
+	uint32_t Size;
+	uint32_t Flags;
+	uint32_t FourCC;
+	uint32_t RGBBitCount;
+	uint32_t RBitMask;
+	uint32_t GBitMask;
+	uint32_t BBitMask;
+	uint32_t ABitMask;
+};
+
+struct DDSHeader
+{
+	uint32_t Size;
+	uint32_t Flags;
+	uint32_t Height;
+	uint32_t Width;
+	uint32_t PitchOrLinearSize;
+	uint32_t Depth;
+	uint32_t MipMapCount;
+	uint32_t Reserved1[11];
+	DDSPixelFormat PixelFormat;
+	uint32_t Caps;
+	uint32_t Caps2;
+	uint32_t Caps3;
+	uint32_t Caps4;
+	uint32_t Reserved2;
+};
+
+struct DDSHeaderDX10
+{
+	uint32_t Format;
+	uint32_t Dimension;
+	uint32_t MiscFlag;
+	uint32_t ArraySize;
+	uint32_t MiscFlags2;
+};
+
+static_assert(sizeof(DDSHeader) == 124 && sizeof(DDSHeaderDX10) == 20, "DDS header layout");
+
+static constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+{
+	return static_cast<uint32_t>(static_cast<uint8_t>(a)) | (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8) |
+		(static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+}
+
+// Bits per pixel of the formats this parser slices, BC formats count a block's bytes spread over its 16 pixels
+static uint32_t GetBitsPerPixel(uint32_t format)
+{
+	if (format >= 1 && format <= 4) return 128; // R32G32B32A32
+	if (format >= 5 && format <= 8) return 96; // R32G32B32
+	if (format >= 9 && format <= 18) return 64; // R16G16B16A16, R32G32
+	if (format >= 23 && format <= 43) return 32; // R10G10B10A2, R11G11B10, R8G8B8A8, R16G16, R32
+	if (format >= 48 && format <= 59) return 16; // R8G8, R16
+	if (format >= 60 && format <= 65) return 8; // R8, A8
+	if (format >= 70 && format <= 72) return 4; // BC1
+	if (format >= 73 && format <= 78) return 8; // BC2, BC3
+	if (format >= 79 && format <= 81) return 4; // BC4
+	if (format >= 82 && format <= 84) return 8; // BC5
+	if (format == 85 || format == 86) return 16; // B5G6R5, B5G5R5A1
+	if (format >= 87 && format <= 93) return 32; // B8G8R8A8, B8G8R8X8
+	if (format >= 94 && format <= 99) return 8; // BC6H, BC7
+	return 0;
+}
+
+bool IsDDSBlockCompressed(uint32_t format)
+{
+	return (format >= 70 && format <= 84) || (format >= 94 && format <= 99);
+}
+
+static bool HasMasks(const DDSPixelFormat& pixelFormat, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+	return pixelFormat.RBitMask == r && pixelFormat.GBitMask == g && pixelFormat.BBitMask == b && pixelFormat.ABitMask == a;
+}
+
+// DXGI format of a header without the DX10 extension, the same mapping DDSTextureLoader12 uses for the formats above
+static uint32_t GetLegacyFormat(const DDSPixelFormat& pixelFormat)
+{
+	if (pixelFormat.Flags & DDSFourCC)
+	{
+		switch (pixelFormat.FourCC)
+		{
+		case MakeFourCC('D', 'X', 'T', '1'): return 71;
+		case MakeFourCC('D', 'X', 'T', '2'):
+		case MakeFourCC('D', 'X', 'T', '3'): return 74;
+		case MakeFourCC('D', 'X', 'T', '4'):
+		case MakeFourCC('D', 'X', 'T', '5'): return 77;
+		case MakeFourCC('A', 'T', 'I', '1'):
+		case MakeFourCC('B', 'C', '4', 'U'): return 80;
+		case MakeFourCC('B', 'C', '4', 'S'): return 81;
+		case MakeFourCC('A', 'T', 'I', '2'):
+		case MakeFourCC('B', 'C', '5', 'U'): return 83;
+		case MakeFourCC('B', 'C', '5', 'S'): return 84;
+		case 36: return 11; // D3DFMT_A16B16G16R16
+		case 110: return 13; // D3DFMT_Q16W16V16U16
+		case 111: return 54; // D3DFMT_R16F
+		case 112: return 34; // D3DFMT_G16R16F
+		case 113: return 10; // D3DFMT_A16B16G16R16F
+		case 114: return 41; // D3DFMT_R32F
+		case 115: return 16; // D3DFMT_G32R32F
+		case 116: return 2; // D3DFMT_A32B32G32R32F
+		default: return 0;
+		}
+	}
+	if (pixelFormat.Flags & DDSRGB)
+	{
+		if (pixelFormat.RGBBitCount == 32)
+		{
+			if (HasMasks(pixelFormat, 0xff, 0xff00, 0xff0000, 0xff000000)) return 28;
+			if (HasMasks(pixelFormat, 0xff0000, 0xff00, 0xff, 0xff000000)) return 87;
+			if (HasMasks(pixelFormat, 0xff0000, 0xff00, 0xff, 0)) return 88;
+			if (HasMasks(pixelFormat, 0x3ff, 0xffc00, 0x3ff00000, 0xc0000000)) return 24;
+			if (HasMasks(pixelFormat, 0xffff, 0xffff0000, 0, 0)) return 35;
+			if (HasMasks(pixelFormat, 0xffffffff, 0, 0, 0)) return 41;
+		}
+		else if (pixelFormat.RGBBitCount == 16)
+		{
+			if (HasMasks(pixelFormat, 0x7c00, 0x3e0, 0x1f, 0x8000)) return 86;
+			if (HasMasks(pixelFormat, 0xf800, 0x7e0, 0x1f, 0)) return 85;
+		}
+		return 0;
+	}
+	if (pixelFormat.Flags & DDSLuminance)
+	{
+		if (pixelFormat.RGBBitCount == 8 && HasMasks(pixelFormat, 0xff, 0, 0, 0)) return 61;
+		if (pixelFormat.RGBBitCount == 16 && HasMasks(pixelFormat, 0xffff, 0, 0, 0)) return 56;
+		if (pixelFormat.RGBBitCount == 16 && HasMasks(pixelFormat, 0xff, 0, 0, 0xff00)) return 49;
+		return 0;
+	}
+	if ((pixelFormat.Flags & DDSAlphaOnly) && pixelFormat.RGBBitCount == 8)
+	{
+		return 65;
+	}
+	return 0;
+}
+
+size_t GetDDSSurfaceSize(uint32_t format, uint32_t width, uint32_t height, size_t* rowPitch, uint32_t* rowCount)
+{
+	const uint32_t bitsPerPixel = GetBitsPerPixel(format);
+	if (bitsPerPixel == 0)
+	{
+		return 0;
+	}
+	size_t pitch;
+	uint32_t rows;
+	if (IsDDSBlockCompressed(format))
+	{
+		pitch = static_cast<size_t>(std::max(1u, (width + 3) / 4)) * bitsPerPixel * 2;
+		rows = std::max(1u, (height + 3) / 4);
+	}
+	else
+	{
+		pitch = (static_cast<size_t>(width) * bitsPerPixel + 7) / 8;
+		rows = height;
+	}
+	if (rowPitch)
+	{
+		*rowPitch = pitch;
+	}
+	if (rowCount)
+	{
+		*rowCount = rows;
+	}
+	return pitch * rows;
+}
+
+bool ParseDDS(const void* data, size_t size, DDSTexture& texture)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	const uint8_t* end = bytes + size;
+	texture.Subresources.clear();
+	if (size < sizeof(uint32_t) + sizeof(DDSHeader))
+	{
+		return false;
+	}
+	uint32_t magic;
+	DDSHeader header;
+	memcpy(&magic, bytes, sizeof(magic));
+	memcpy(&header, bytes + sizeof(magic), sizeof(header));
+	if (magic != DDSMagic || header.Size != sizeof(DDSHeader) || header.PixelFormat.Size != sizeof(DDSPixelFormat))
+	{
+		return false;
+	}
+	const uint8_t* bits = bytes + sizeof(uint32_t) + sizeof(DDSHeader);
+
+	texture.Width = header.Width;
+	texture.Height = header.Height;
+	texture.Depth = header.Depth;
+	texture.MipCount = std::max(1u, header.MipMapCount);
+	texture.ArraySize = 1;
+	texture.Cube = false;
+
+	if ((header.PixelFormat.Flags & DDSFourCC) && header.PixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (static_cast<size_t>(end - bits) < sizeof(DDSHeaderDX10))
+		{
+			return false;
+		}
+		DDSHeaderDX10 extension;
+		memcpy(&extension, bits, sizeof(extension));
+		bits += sizeof(DDSHeaderDX10);
+
+		texture.Format = extension.Format;
+		texture.Dimension = extension.Dimension;
+		texture.ArraySize = extension.ArraySize;
+		if (texture.ArraySize == 0)
+		{
+			return false;
+		}
+		switch (texture.Dimension)
+		{
+		case DDS_DIMENSION_TEXTURE1D:
+			if ((header.Flags & DDSHeight) && texture.Height != 1)
+			{
+				return false;
+			}
+			texture.Height = 1;
+			texture.Depth = 1;
+			break;
+		case DDS_DIMENSION_TEXTURE2D:
+			if (extension.MiscFlag & DDSDX10TextureCube)
+			{
+				texture.ArraySize *= 6;
+				texture.Cube = true;
+			}
+			texture.Depth = 1;
+			break;
+		case DDS_DIMENSION_TEXTURE3D:
+			if (!(header.Flags & DDSDepth) || texture.ArraySize > 1)
+			{
+				return false;
+			}
+			break;
+		default:
+			return false;
+		}
+	}
+	else
+	{
+		texture.Format = GetLegacyFormat(header.PixelFormat);
+		if (header.Flags & DDSDepth)
+		{
+			texture.Dimension = DDS_DIMENSION_TEXTURE3D;
+		}
+		else
+		{
+			if (header.Caps2 & DDSCubeMap)
+			{
+				// Partial cube maps aren't supported by D3D12
+				if ((header.Caps2 & DDSCubeMapAllFaces) != DDSCubeMapAllFaces)
+				{
+					return false;
+				}
+				texture.ArraySize = 6;
+				texture.Cube = true;
+			}
+			texture.Depth = 1;
+			texture.Dimension = DDS_DIMENSION_TEXTURE2D;
+		}
+	}
+
+	if (GetBitsPerPixel(texture.Format) == 0 || texture.Width == 0 || texture.Height == 0 || texture.Depth == 0 ||
+		texture.MipCount > DDSMaxMipCount || texture.ArraySize > DDSMaxArraySize)
+	{
+		return false;
+	}
+	const uint32_t largest = std::max(texture.Width, texture.Height);
+	if ((texture.Dimension == DDS_DIMENSION_TEXTURE1D && texture.Width > DDSMaxTexture1DSize) ||
+		(texture.Dimension == DDS_DIMENSION_TEXTURE2D && largest > (texture.Cube ? DDSMaxCubeSize : DDSMaxTexture2DSize)) ||
+		(texture.Dimension == DDS_DIMENSION_TEXTURE3D && std::max(largest, texture.Depth) > DDSMaxTexture3DSize))
+	{
+		return false;
+	}
+
+	// Every array slice holds its whole mip chain before the next one starts, volume mips store their depth slices back to back
+	texture.Subresources.reserve(static_cast<size_t>(texture.ArraySize) * texture.MipCount);
+	for (uint32_t item = 0; item < texture.ArraySize; item++)
+	{
+		uint32_t width = texture.Width;
+		uint32_t height = texture.Height;
+		uint32_t depth = texture.Depth;
+		for (uint32_t mip = 0; mip < texture.MipCount; mip++)
+		{
+			size_t rowPitch;
+			const size_t slicePitch = GetDDSSurfaceSize(texture.Format, width, height, &rowPitch);
+			const size_t mipSize = slicePitch * depth;
+			if (static_cast<size_t>(end - bits) < mipSize)
+			{
+				texture.Subresources.clear();
+				return false;
+			}
+			texture.Subresources.push_back({ bits, static_cast<intptr_t>(rowPitch), static_cast<intptr_t>(slicePitch) });
+			bits += mipSize;
+
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+			depth = std::max(1u, depth / 2);
+		}
+	}
+	return true;
+}
+
+void WriteDDSHeader(uint32_t format, uint32_t width, uint32_t height, uint32_t arraySize, uint32_t mipCount, std::vector<uint8_t>& file)
+{
+	DDSHeader header = {};
+	header.Size = sizeof(DDSHeader);
+	header.Flags = DDSCaps | DDSHeight | DDSWidth | DDSPixelFormatFlag | DDSMipMapCount;
+	header.Height = height;
+	header.Width = width;
+	header.Depth = 1;
+	header.MipMapCount = mipCount;
+	header.PixelFormat.Size = sizeof(DDSPixelFormat);
+	header.PixelFormat.Flags = DDSFourCC;
+	header.PixelFormat.FourCC = MakeFourCC('D', 'X', '1', '0');
+	header.Caps = DDSCapsTexture | (mipCount > 1 ? DDSCapsComplex | DDSCapsMipMap : 0);
+
+	DDSHeaderDX10 extension = {};
+	extension.Format = format;
+	extension.Dimension = DDS_DIMENSION_TEXTURE2D;
+	extension.ArraySize = arraySize;
+
+	const size_t offset = file.size();
+	file.resize(offset + sizeof(DDSMagic) + sizeof(header) + sizeof(extension));
+	memcpy(file.data() + offset, &DDSMagic, sizeof(DDSMagic));
+	memcpy(file.data() + offset + sizeof(DDSMagic), &header, sizeof(header));
+	memcpy(file.data() + offset + sizeof(DDSMagic) + sizeof(header), &extension, sizeof(extension));
+}
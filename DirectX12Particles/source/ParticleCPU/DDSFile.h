@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// DDS parsing without D3D, the header is read and every subresource is sliced in place so uploads copy straight out of the file's bytes,
+// usually a MappedFile. Formats are DXGI_FORMAT values and dimensions D3D12_RESOURCE_DIMENSION values, both can be cast as they are.
+// Knows the plain color formats and BC1-BC7, with a DX10 header or the legacy DXTn, ATIn, BCnU/S, float and RGB mask ones.
+// Anything else fails to parse and is left to DirectX::LoadDDSTextureFromMemory.
+#define DDS_DIMENSION_TEXTURE1D 2
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_DIMENSION_TEXTURE3D 4
+
+// Same members and layout as D3D12_SUBRESOURCE_DATA
+struct DDSSubresource
+{
+	const void* Data;
+	intptr_t RowPitch; // Bytes per row of pixels, per row of 4x4 blocks for BC formats
+	intptr_t SlicePitch; // Bytes per depth slice
+};
+
+struct DDSTexture
+{
+	uint32_t Format = 0;
+	uint32_t Dimension = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t Depth = 0;
+	uint32_t ArraySize = 0; // Counts faces, six per cube
+	uint32_t MipCount = 0;
+	bool Cube = false;
+	std::vector<DDSSubresource> Subresources; // D3D12 order, all mips of the first array slice, then the next
+};
+
+// Validates the header and that every subresource lies inside the size bytes at data, and slices them into texture.
+// Subresources is left empty on failure, so nothing points into a file that didn't parse.
+bool ParseDDS(const void* data, size_t size, DDSTexture& texture);
+
+// Bytes of one mip level of a format ParseDDS knows, 0 for anything else. rowCount is in blocks for BC formats.
+size_t GetDDSSurfaceSize(uint32_t format, uint32_t width, uint32_t height, size_t* rowPitch = nullptr, uint32_t* rowCount = nullptr);
+
+// BC1-BC7, whose rows are rows of 4x4 blocks
+bool IsDDSBlockCompressed(uint32_t format);
+
+// Appends the magic, header and DX10 header of a 2D texture array to file. The subresources follow in D3D12 order, packed at
+// GetDDSSurfaceSize's pitches, which is what ParseDDS reads back.
+void WriteDDSHeader(uint32_t format, uint32_t width, uint32_t height, uint32_t arraySize, uint32_t mipCount, std::vector<uint8_t>& file);
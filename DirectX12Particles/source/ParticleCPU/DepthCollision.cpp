@@ -0,0 +1,15 @@
+#include "DepthCollision.h"
+
+Particle CollideDepth(Particle particle, float3 from, const HiZLevel& depth, const CullConstants& cull, const CollisionConstants& collision)
+{
+	const DepthCollisionSample depthSample = DepthCollisionProject(float3(particle.position.x, particle.position.y, particle.position.z), cull);
+	if (!depthSample.Valid)
+	{
+		return particle;
+	}
+
+	const int x = static_cast<int>(depthSample.Texel.x);
+	const int y = static_cast<int>(depthSample.Texel.y);
+	const float3 depths(depth.Load(x, y).y, depth.Load(x + 1, y).y, depth.Load(x, y + 1).y);
+	return DepthCollide(particle, from, depthSample, depths, cull, collision);
+}
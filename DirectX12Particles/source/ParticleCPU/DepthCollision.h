@@ -0,0 +1,8 @@
+#pragma once
+
+#include "../ParticleGame/DepthCollision.hlsli"
+#include "HiZ.h"
+
+// CPU reference of the depth buffer collision in ComputeSimulator.hlsl, for checks against synthetic depth maps.
+// depth is mip 0 of the pyramid cull describes, from is the particle's position before this step.
+Particle CollideDepth(Particle particle, float3 from, const HiZLevel& depth, const CullConstants& cull, const CollisionConstants& collision);
@@ -0,0 +1,525 @@
+#include "EmitterLibrary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+static const uint EmitterLibraryMagic = 0x544d4550; // "PEMT"
+static const uint EmitterLibraryVersion = 2;
+
+struct EmitterLibraryHeader
+{
+	uint Magic;
+	uint Version;
+	uint Count;
+	uint RecordSize; // sizeof(EmitterRecord), catches binaries from a build with a different layout
+};
+
+// Just enough JSON for emitter files: objects, arrays, numbers, strings without escapes other than \" and \\, and null
+struct JSONCursor
+{
+	const char* Position;
+	const char* End;
+	const char* Begin;
+	std::string& Error;
+
+	bool Fail(const char* message)
+	{
+		if (Error.empty())
+		{
+			int line = 1;
+			for (const char* c = Begin; c < Position && c < End; ++c)
+			{
+				line += *c == '\n' ? 1 : 0;
+			}
+			char buffer[256];
+			snprintf(buffer, sizeof(buffer), "line %d: %s", line, message);
+			Error = buffer;
+		}
+		return false;
+	}
+
+	void SkipWhitespace()
+	{
+		while (Position < End && (*Position == ' ' || *Position == '\t' || *Position == '\r' || *Position == '\n'))
+		{
+			++Position;
+		}
+	}
+
+	// Consumes c after any whitespace, returns false without failing when the next character is something else
+	bool Accept(char c)
+	{
+		SkipWhitespace();
+		if (Position < End && *Position == c)
+		{
+			++Position;
+			return true;
+		}
+		return false;
+	}
+
+	bool Expect(char c)
+	{
+		if (Accept(c))
+		{
+			return true;
+		}
+		char message[32];
+		snprintf(message, sizeof(message), "expected '%c'", c);
+		return Fail(message);
+	}
+
+	bool ParseString(std::string_view& value)
+	{
+		if (!Expect('"'))
+		{
+			return false;
+		}
+		const char* begin = Position;
+		while (Position < End && *Position != '"')
+		{
+			Position += *Position == '\\' ? 2 : 1;
+		}
+		if (Position >= End)
+		{
+			return Fail("unterminated string");
+		}
+		value = std::string_view(begin, Position - begin);
+		++Position;
+		return true;
+	}
+
+	bool ParseNumber(float& value)
+	{
+		SkipWhitespace();
+		// strtof needs a terminator, numbers are short so a stack copy does
+		char digits[64];
+		size_t length = 0;
+		while (Position + length < End && length < sizeof(digits) - 1 && strchr("+-.0123456789eE", Position[length]))
+		{
+			digits[length] = Position[length];
+			++length;
+		}
+		digits[length] = '\0';
+		char* end = nullptr;
+		value = strtof(digits, &end);
+		if (length == 0 || end != digits + length)
+		{
+			return Fail("expected a number");
+		}
+		Position += length;
+		return true;
+	}
+
+	bool ParseFloat3(float4& value)
+	{
+		float components[3];
+		for (int n = 0; n < 3; ++n)
+		{
+			if ((n == 0 ? !Expect('[') : !Expect(',')) || !ParseNumber(components[n]))
+			{
+				return false;
+			}
+		}
+		value = float4(components[0], components[1], components[2], 0);
+		return Expect(']');
+	}
+
+	bool AcceptNull()
+	{
+		SkipWhitespace();
+		if (End - Position >= 4 && strncmp(Position, "null", 4) == 0)
+		{
+			Position += 4;
+			return true;
+		}
+		return false;
+	}
+};
+
+static EmitterRecord DefaultEmitterRecord()
+{
+	EmitterRecord record = {};
+	record.ParticleLifetime = 1.0f;
+	record.StartScale = 0.1f;
+	record.EndScale = 0.1f;
+	record.CurveSet = CURVE_SET_NONE;
+	return record;
+}
+
+// What the JSON and binary loaders both require of a record, the names fit with their terminator and the curve set is baked.
+// message is left alone when the record is fine.
+static bool ValidateEmitterRecord(const EmitterRecord& record, uint curveSetCount, char (&message)[96])
+{
+	const size_t nameLength = strnlen(record.Name, EMITTER_NAME_LENGTH);
+	if (nameLength == 0 || nameLength == EMITTER_NAME_LENGTH)
+	{
+		snprintf(message, sizeof(message), "names need 1 to %d characters", EMITTER_NAME_LENGTH - 1);
+		return false;
+	}
+	if (strnlen(record.Texture, EMITTER_NAME_LENGTH) == EMITTER_NAME_LENGTH)
+	{
+		snprintf(message, sizeof(message), "texture names need at most %d characters", EMITTER_NAME_LENGTH - 1);
+		return false;
+	}
+	// Written so NaN fails too
+	if (!(record.ParticleLifetime > 0.0f))
+	{
+		snprintf(message, sizeof(message), "lifetime has to be positive");
+		return false;
+	}
+	if (record.CurveSet != CURVE_SET_NONE && record.CurveSet >= curveSetCount)
+	{
+		snprintf(message, sizeof(message), "curveSet %u is past the %u baked curve sets", record.CurveSet, curveSetCount);
+		return false;
+	}
+	return true;
+}
+
+static bool ParseEmitter(JSONCursor& cursor, uint curveSetCount, EmitterRecord& record)
+{
+	record = DefaultEmitterRecord();
+	if (!cursor.Expect('{'))
+	{
+		return false;
+	}
+	bool named = false;
+	if (!cursor.Accept('}'))
+	{
+		do
+		{
+			std::string_view key;
+			if (!cursor.ParseString(key) || !cursor.Expect(':'))
+			{
+				return false;
+			}
+
+			float number = 0.0f;
+			bool parsed = true;
+			if (key == "name")
+			{
+				std::string_view name;
+				parsed = cursor.ParseString(name);
+				if (parsed && (name.empty() || name.size() >= EMITTER_NAME_LENGTH))
+				{
+					return cursor.Fail("names need 1 to 31 characters");
+				}
+				memcpy(record.Name, name.data(), name.size());
+				named = true;
+			}
+			else if (key == "texture")
+			{
+				std::string_view texture;
+				parsed = cursor.ParseString(texture);
+				if (parsed && texture.size() >= EMITTER_NAME_LENGTH)
+				{
+					return cursor.Fail("texture names need at most 31 characters");
+				}
+				memcpy(record.Texture, texture.data(), texture.size());
+			}
+			else if (key == "lifetime") { parsed = cursor.ParseNumber(record.ParticleLifetime); }
+			else if (key == "emitCount") { parsed = cursor.ParseNumber(number); record.EmitCount = static_cast<uint>(number < 0.0f ? 0.0f : number); }
+			else if (key == "startScale") { parsed = cursor.ParseNumber(record.StartScale); }
+			else if (key == "endScale") { parsed = cursor.ParseNumber(record.EndScale); }
+			else if (key == "aabbMin") { parsed = cursor.ParseFloat3(record.AABBMin); }
+			else if (key == "aabbMax") { parsed = cursor.ParseFloat3(record.AABBMax); }
+			else if (key == "velocityMin") { parsed = cursor.ParseFloat3(record.VelocityMin); }
+			else if (key == "velocityMax") { parsed = cursor.ParseFloat3(record.VelocityMax); }
+			else if (key == "accelerationMin") { parsed = cursor.ParseFloat3(record.AccelerationMin); }
+			else if (key == "accelerationMax") { parsed = cursor.ParseFloat3(record.AccelerationMax); }
+			else if (key == "curveSet")
+			{
+				if (!cursor.AcceptNull())
+				{
+					parsed = cursor.ParseNumber(number);
+					if (parsed && (number < 0.0f || number != std::floor(number) || number >= static_cast<float>(CURVE_SET_NONE)))
+					{
+						return cursor.Fail("curveSet has to be a curve set index or null");
+					}
+					record.CurveSet = static_cast<uint>(number);
+				}
+			}
+			else
+			{
+				char message[96];
+				snprintf(message, sizeof(message), "unknown emitter key \"%.*s\"", static_cast<int>((std::min)(key.size(), size_t(48))), key.data());
+				return cursor.Fail(message);
+			}
+			if (!parsed)
+			{
+				return false;
+			}
+		} while (cursor.Accept(','));
+
+		if (!cursor.Expect('}'))
+		{
+			return false;
+		}
+	}
+	if (!named)
+	{
+		return cursor.Fail("emitter without a name");
+	}
+	char message[96];
+	if (!ValidateEmitterRecord(record, curveSetCount, message))
+	{
+		return cursor.Fail(message);
+	}
+	return true;
+}
+
+bool CompileEmitterJSON(std::string_view text, uint curveSetCount, std::vector<uint8_t>& binary, std::string& error)
+{
+	error.clear();
+	JSONCursor cursor = { text.data(), text.data() + text.size(), text.data(), error };
+
+	std::vector<EmitterRecord> records;
+	std::string_view key;
+	if (!cursor.Expect('{') || !cursor.ParseString(key) || !cursor.Expect(':'))
+	{
+		return false;
+	}
+	if (key != "emitters")
+	{
+		return cursor.Fail("expected \"emitters\"");
+	}
+	if (!cursor.Expect('['))
+	{
+		return false;
+	}
+	if (!cursor.Accept(']'))
+	{
+		do
+		{
+			EmitterRecord record;
+			if (!ParseEmitter(cursor, curveSetCount, record))
+			{
+				return false;
+			}
+			records.push_back(record);
+		} while (cursor.Accept(','));
+
+		if (!cursor.Expect(']'))
+		{
+			return false;
+		}
+	}
+	if (!cursor.Expect('}'))
+	{
+		return false;
+	}
+	cursor.SkipWhitespace();
+	if (cursor.Position != cursor.End)
+	{
+		return cursor.Fail("text after the library");
+	}
+
+	// Sorted names put duplicates next to each other, comparing every pair is too slow for thousands of emitters
+	std::vector<const char*> names(records.size());
+	for (size_t n = 0; n < records.size(); ++n)
+	{
+		names[n] = records[n].Name;
+	}
+	std::sort(names.begin(), names.end(), [](const char* a, const char* b) { return strncmp(a, b, EMITTER_NAME_LENGTH) < 0; });
+	for (size_t n = 1; n < names.size(); ++n)
+	{
+		if (strncmp(names[n - 1], names[n], EMITTER_NAME_LENGTH) == 0)
+		{
+			error = "duplicate emitter name \"" + std::string(names[n], strnlen(names[n], EMITTER_NAME_LENGTH)) + "\"";
+			return false;
+		}
+	}
+
+	const EmitterLibraryHeader header = { EmitterLibraryMagic, EmitterLibraryVersion, static_cast<uint>(records.size()), sizeof(EmitterRecord) };
+	binary.resize(sizeof(header) + records.size() * sizeof(EmitterRecord));
+	memcpy(binary.data(), &header, sizeof(header));
+	if (!records.empty())
+	{
+		memcpy(binary.data() + sizeof(header), records.data(), records.size() * sizeof(EmitterRecord));
+	}
+	return true;
+}
+
+bool ParseEmitterBinary(const void* data, size_t size, uint curveSetCount, EmitterLibraryView& view)
+{
+	if (size < sizeof(EmitterLibraryHeader) || reinterpret_cast<uintptr_t>(data) % alignof(EmitterRecord) != 0)
+	{
+		return false;
+	}
+	const EmitterLibraryHeader* header = static_cast<const EmitterLibraryHeader*>(data);
+	if (header->Magic != EmitterLibraryMagic || header->Version != EmitterLibraryVersion || header->RecordSize != sizeof(EmitterRecord) ||
+		(size - sizeof(EmitterLibraryHeader)) / sizeof(EmitterRecord) < header->Count)
+	{
+		return false;
+	}
+
+	// The binary is a cache anyone can overwrite, its records get the checks the JSON ones got when it was compiled
+	const EmitterRecord* records = reinterpret_cast<const EmitterRecord*>(header + 1);
+	char message[96];
+	for (uint n = 0; n < header->Count; ++n)
+	{
+		if (!ValidateEmitterRecord(records[n], curveSetCount, message))
+		{
+			return false;
+		}
+	}
+	view.Records = records;
+	view.Count = header->Count;
+	return true;
+}
+
+static void AppendFloat3(std::string& text, const char* key, const float4& value)
+{
+	char buffer[128];
+	snprintf(buffer, sizeof(buffer), ",\n\t\t\t\"%s\": [%.9g, %.9g, %.9g]", key, value.x, value.y, value.z);
+	text += buffer;
+}
+
+std::string WriteEmitterJSON(const EmitterRecord* records, uint count)
+{
+	std::string text = "{\n\t\"emitters\": [";
+	for (uint n = 0; n < count; ++n)
+	{
+		const EmitterRecord& record = records[n];
+		char buffer[320];
+		snprintf(buffer, sizeof(buffer), "%s\n\t\t{\n\t\t\t\"name\": \"%.*s\",\n\t\t\t\"texture\": \"%.*s\",\n\t\t\t\"lifetime\": %.9g,\n\t\t\t\"emitCount\": %u,\n\t\t\t\"startScale\": %.9g,\n\t\t\t\"endScale\": %.9g",
+			n > 0 ? "," : "", EMITTER_NAME_LENGTH - 1, record.Name, EMITTER_NAME_LENGTH - 1, record.Texture, record.ParticleLifetime, record.EmitCount, record.StartScale, record.EndScale);
+		text += buffer;
+		AppendFloat3(text, "aabbMin", record.AABBMin);
+		AppendFloat3(text, "aabbMax", record.AABBMax);
+		AppendFloat3(text, "velocityMin", record.VelocityMin);
+		AppendFloat3(text, "velocityMax", record.VelocityMax);
+		AppendFloat3(text, "accelerationMin", record.AccelerationMin);
+		AppendFloat3(text, "accelerationMax", record.AccelerationMax);
+		if (record.CurveSet == CURVE_SET_NONE)
+		{
+			text += ",\n\t\t\t\"curveSet\": null\n\t\t}";
+		}
+		else
+		{
+			snprintf(buffer, sizeof(buffer), ",\n\t\t\t\"curveSet\": %u\n\t\t}", record.CurveSet);
+			text += buffer;
+		}
+	}
+	text += "\n\t]\n}\n";
+	return text;
+}
+
+bool SaveEmitterJSON(const std::filesystem::path& path, const EmitterRecord* records, uint count)
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	file << WriteEmitterJSON(records, count);
+	return static_cast<bool>(file);
+}
+
+EmitterRecord MakeEmitterRecord(const char* name, const EmitterConstants& emitter)
+{
+	EmitterRecord record = {};
+	memcpy(record.Name, name, strnlen(name, EMITTER_NAME_LENGTH - 1));
+	record.ParticleLifetime = emitter.particleLifetime;
+	record.EmitCount = emitter.emitCount;
+	record.StartScale = emitter.particleStartScale;
+	record.EndScale = emitter.particleEndScale;
+	record.AABBMin = emitter.emitAABBMin;
+	record.AABBMax = emitter.emitAABBMax;
+	record.VelocityMin = emitter.emitVelocityMin;
+	record.VelocityMax = emitter.emitVelocityMax;
+	record.AccelerationMin = emitter.emitAccelerationMin;
+	record.AccelerationMax = emitter.emitAccelerationMax;
+	record.CurveSet = emitter.curveSet;
+	return record;
+}
+
+void ApplyEmitterRecord(const EmitterRecord& record, EmitterConstants& emitter)
+{
+	emitter.particleLifetime = record.ParticleLifetime;
+	emitter.emitCount = record.EmitCount;
+	emitter.particleStartScale = record.StartScale;
+	emitter.particleEndScale = record.EndScale;
+	emitter.emitAABBMin = record.AABBMin;
+	emitter.emitAABBMax = record.AABBMax;
+	emitter.emitVelocityMin = record.VelocityMin;
+	emitter.emitVelocityMax = record.VelocityMax;
+	emitter.emitAccelerationMin = record.AccelerationMin;
+	emitter.emitAccelerationMax = record.AccelerationMax;
+	emitter.curveSet = record.CurveSet;
+}
+
+bool EmitterLibrary::Load(const std::filesystem::path& jsonPath, const std::filesystem::path& binaryPath, uint curveSetCount, std::string& error)
+{
+	JSONPath = jsonPath;
+	BinaryPath = binaryPath;
+	CurveSetCount = curveSetCount;
+	error.clear();
+
+	std::error_code code;
+	JSONWriteTime = std::filesystem::last_write_time(JSONPath, code);
+	const std::filesystem::file_time_type binaryWriteTime = std::filesystem::last_write_time(BinaryPath, code);
+	if (!code && binaryWriteTime >= JSONWriteTime)
+	{
+		std::ifstream file(BinaryPath, std::ios::in | std::ios::binary);
+		Binary.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		if (ParseEmitterBinary(Binary.data(), Binary.size(), CurveSetCount, View))
+		{
+			return true;
+		}
+	}
+	return Compile(error);
+}
+
+bool EmitterLibrary::Poll(std::string& error)
+{
+	std::error_code code;
+	const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(JSONPath, code);
+	if (code || writeTime == JSONWriteTime)
+	{
+		return false;
+	}
+	JSONWriteTime = writeTime;
+	return Compile(error);
+}
+
+uint EmitterLibrary::Find(std::string_view name) const
+{
+	for (uint n = 0; n < View.Count; ++n)
+	{
+		if (name == std::string_view(View.Records[n].Name))
+		{
+			return n;
+		}
+	}
+	return View.Count;
+}
+
+bool EmitterLibrary::Compile(std::string& error)
+{
+	std::ifstream file(JSONPath, std::ios::in | std::ios::binary);
+	if (!file)
+	{
+		error = "can't open " + JSONPath.string();
+		return false;
+	}
+	const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	// The old records stay in place until the new ones parsed
+	std::vector<uint8_t> binary;
+	if (!CompileEmitterJSON(text, CurveSetCount, binary, error))
+	{
+		error = JSONPath.filename().string() + " " + error;
+		return false;
+	}
+	Binary.swap(binary);
+	ParseEmitterBinary(Binary.data(), Binary.size(), CurveSetCount, View);
+
+	std::ofstream outFile(BinaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (outFile)
+	{
+		outFile.write(reinterpret_cast<const char*>(Binary.data()), Binary.size());
+	}
+	return true;
+}
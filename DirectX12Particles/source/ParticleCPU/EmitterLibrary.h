@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../ParticleGame/Particle.hlsli"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Emitters are authored as JSON and compiled to a binary library, a header followed by fixed size records.
+// The JSON is an object with an "emitters" array, every emitter an object with these keys, all optional but name:
+//   "name": "Rising", "texture": "Smoke", "lifetime": 35, "emitCount": 100, "startScale": 0.3, "endScale": 0.3, "curveSet": 0 or null,
+//   "aabbMin", "aabbMax", "velocityMin", "velocityMax", "accelerationMin", "accelerationMax": [x, y, z]
+#define EMITTER_NAME_LENGTH 32
+
+// The authored part of EmitterConstants, deltaTime and maxParticleCount come from the game
+struct EmitterRecord
+{
+	char Name[EMITTER_NAME_LENGTH]; // Zero padded, at most EMITTER_NAME_LENGTH - 1 characters
+	char Texture[EMITTER_NAME_LENGTH]; // Particle atlas entry the particles draw with, empty for the first one
+	float ParticleLifetime;
+	uint EmitCount;
+	float StartScale;
+	float EndScale;
+	float4 AABBMin;
+	float4 AABBMax;
+	float4 VelocityMin;
+	float4 VelocityMax;
+	float4 AccelerationMin;
+	float4 AccelerationMax;
+	uint CurveSet; // CURVE_SET_NONE for null
+	uint Padding[3];
+};
+
+// Records of a binary library, pointing into the bytes it was parsed from
+struct EmitterLibraryView
+{
+	const EmitterRecord* Records = nullptr;
+	uint Count = 0;
+};
+
+// Every emitter in text compiled to a binary library. On failure error holds the line and what was wrong.
+// Curve sets have to be CURVE_SET_NONE or below curveSetCount, the number of sets baked into the curve atlas.
+bool CompileEmitterJSON(std::string_view text, uint curveSetCount, std::vector<uint8_t>& binary, std::string& error);
+
+// Validates the header and size, and every record the way CompileEmitterJSON does, and points view at the records,
+// nothing is copied or allocated
+bool ParseEmitterBinary(const void* data, size_t size, uint curveSetCount, EmitterLibraryView& view);
+
+// JSON that compiles back to the same records
+std::string WriteEmitterJSON(const EmitterRecord* records, uint count);
+bool SaveEmitterJSON(const std::filesystem::path& path, const EmitterRecord* records, uint count);
+
+EmitterRecord MakeEmitterRecord(const char* name, const EmitterConstants& emitter);
+
+// Overwrites the authored fields of emitter and keeps its deltaTime and maxParticleCount
+void ApplyEmitterRecord(const EmitterRecord& record, EmitterConstants& emitter);
+
+// A JSON library and its compiled binary next to it. The binary is rebuilt whenever the JSON is newer and
+// Poll picks up edits to the JSON while the game runs.
+class EmitterLibrary
+{
+public:
+
+	// Compiles jsonPath into binaryPath when the binary is missing, older or invalid, then loads the binary.
+	// curveSetCount is the number of sets in the curve atlas the records' curve sets index, see CompileEmitterJSON.
+	bool Load(const std::filesystem::path& jsonPath, const std::filesystem::path& binaryPath, uint curveSetCount, std::string& error);
+
+	// Checks the JSON's write time and recompiles and reloads it when it changed. Returns true when the records changed.
+	// A JSON that fails to compile keeps the old records and reports the error once per edit.
+	bool Poll(std::string& error);
+
+	uint GetCount() const { return View.Count; }
+	const EmitterRecord& Get(uint index) const { return View.Records[index]; }
+
+	// Index of the emitter called name, or GetCount() if there is none
+	uint Find(std::string_view name) const;
+
+private:
+
+	bool Compile(std::string& error);
+
+	std::filesystem::path JSONPath;
+	std::filesystem::path BinaryPath;
+	std::filesystem::file_time_type JSONWriteTime;
+	uint CurveSetCount = 0;
+	std::vector<uint8_t> Binary;
+	EmitterLibraryView View;
+};
@@ -0,0 +1,171 @@
+#include "ForceField.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FORCE_FIELD_SSE 1
+#include <emmintrin.h>
+#endif
+
+void CullForceFields(const std::vector<ForceField>& fields, float3 boundsMin, float3 boundsMax, std::vector<uint>& culled)
+{
+	for (uint n = 0; n < fields.size(); ++n)
+	{
+		if (ForceFieldOverlaps(fields[n], boundsMin, boundsMax))
+		{
+			culled.push_back(n);
+		}
+	}
+}
+
+static void CullBlock(const ForceFieldSoA& particles, size_t begin, size_t end, const std::vector<ForceField>& fields, std::vector<uint>& culled)
+{
+	float3 boundsMin(1e30f, 1e30f, 1e30f);
+	float3 boundsMax(-1e30f, -1e30f, -1e30f);
+	for (size_t n = begin; n < end; ++n)
+	{
+		const float3 position(particles.positionX[n], particles.positionY[n], particles.positionZ[n]);
+		boundsMin = (min)(boundsMin, position);
+		boundsMax = (max)(boundsMax, position);
+	}
+	culled.clear();
+	CullForceFields(fields, boundsMin, boundsMax, culled);
+}
+
+static void EvaluateParticle(ForceFieldSoA& particles, size_t n, const std::vector<ForceField>& fields, const std::vector<uint>& culled)
+{
+	const float3 position(particles.positionX[n], particles.positionY[n], particles.positionZ[n]);
+	const float3 velocity(particles.velocityX[n], particles.velocityY[n], particles.velocityZ[n]);
+	float3 acceleration;
+	for (uint field : culled)
+	{
+		acceleration += ForceFieldAcceleration(fields[field], position, velocity);
+	}
+	particles.accelerationX[n] = acceleration.x;
+	particles.accelerationY[n] = acceleration.y;
+	particles.accelerationZ[n] = acceleration.z;
+}
+
+void EvaluateForceFields(ForceFieldSoA& particles, const std::vector<ForceField>& fields)
+{
+	std::vector<uint> culled;
+	culled.reserve(fields.size());
+	for (size_t begin = 0; begin < particles.Size(); begin += FORCE_FIELD_BLOCK_SIZE)
+	{
+		const size_t end = (std::min)(begin + FORCE_FIELD_BLOCK_SIZE, particles.Size());
+		CullBlock(particles, begin, end, fields, culled);
+		for (size_t n = begin; n < end; ++n)
+		{
+			EvaluateParticle(particles, n, fields, culled);
+		}
+	}
+}
+
+#if FORCE_FIELD_SSE
+// saturate(1 - distance / radius)
+static __m128 FalloffSSE(__m128 distance, float radius)
+{
+	const __m128 falloff = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_div_ps(distance, _mm_set1_ps(radius)));
+	return _mm_min_ps(_mm_max_ps(falloff, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+
+// Adds one field's acceleration of four particles to accX/Y/Z, same branches as ForceFieldAcceleration
+static void AccumulateFieldSSE(const ForceField& field, __m128 positionX, __m128 positionY, __m128 positionZ,
+	__m128 velocityX, __m128 velocityY, __m128 velocityZ, __m128& accX, __m128& accY, __m128& accZ)
+{
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	const __m128 offsetX = _mm_sub_ps(_mm_set1_ps(field.Position.x), positionX);
+	const __m128 offsetY = _mm_sub_ps(_mm_set1_ps(field.Position.y), positionY);
+	const __m128 offsetZ = _mm_sub_ps(_mm_set1_ps(field.Position.z), positionZ);
+
+	if (field.Type == FORCE_FIELD_WIND)
+	{
+		__m128 inside = _mm_cmple_ps(_mm_andnot_ps(signBit, offsetX), _mm_set1_ps(field.Extents.x));
+		inside = _mm_and_ps(inside, _mm_cmple_ps(_mm_andnot_ps(signBit, offsetY), _mm_set1_ps(field.Extents.y)));
+		inside = _mm_and_ps(inside, _mm_cmple_ps(_mm_andnot_ps(signBit, offsetZ), _mm_set1_ps(field.Extents.z)));
+		accX = _mm_add_ps(accX, _mm_and_ps(inside, _mm_set1_ps(field.Axis.x * field.Strength)));
+		accY = _mm_add_ps(accY, _mm_and_ps(inside, _mm_set1_ps(field.Axis.y * field.Strength)));
+		accZ = _mm_add_ps(accZ, _mm_and_ps(inside, _mm_set1_ps(field.Axis.z * field.Strength)));
+		return;
+	}
+
+	const __m128 axisX = _mm_set1_ps(field.Axis.x);
+	const __m128 axisY = _mm_set1_ps(field.Axis.y);
+	const __m128 axisZ = _mm_set1_ps(field.Axis.z);
+	const __m128 strength = _mm_set1_ps(field.Strength);
+	const __m128 epsilon = _mm_set1_ps(0.0001f);
+
+	if (field.Type == FORCE_FIELD_VORTEX)
+	{
+		const __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(offsetX, axisX), _mm_mul_ps(offsetY, axisY)), _mm_mul_ps(offsetZ, axisZ));
+		const __m128 radialX = _mm_sub_ps(offsetX, _mm_mul_ps(axisX, along));
+		const __m128 radialY = _mm_sub_ps(offsetY, _mm_mul_ps(axisY, along));
+		const __m128 radialZ = _mm_sub_ps(offsetZ, _mm_mul_ps(axisZ, along));
+		const __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(radialX, radialX), _mm_mul_ps(radialY, radialY)), _mm_mul_ps(radialZ, radialZ)));
+		const __m128 valid = _mm_and_ps(_mm_cmpgt_ps(distance, epsilon), _mm_cmple_ps(_mm_andnot_ps(signBit, along), _mm_set1_ps(field.Radius)));
+		// Lanes on the axis divide by epsilon instead of zero and are masked off afterwards, like lanes past the column's ends
+		const __m128 scale = _mm_and_ps(valid, _mm_div_ps(_mm_mul_ps(strength, FalloffSSE(distance, field.Radius)), _mm_max_ps(distance, epsilon)));
+		accX = _mm_add_ps(accX, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(axisY, radialZ), _mm_mul_ps(axisZ, radialY)), scale));
+		accY = _mm_add_ps(accY, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(axisZ, radialX), _mm_mul_ps(axisX, radialZ)), scale));
+		accZ = _mm_add_ps(accZ, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(axisX, radialY), _mm_mul_ps(axisY, radialX)), scale));
+		return;
+	}
+
+	const __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(offsetX, offsetX), _mm_mul_ps(offsetY, offsetY)), _mm_mul_ps(offsetZ, offsetZ)));
+	if (field.Type == FORCE_FIELD_DRAG)
+	{
+		const __m128 scale = _mm_xor_ps(_mm_mul_ps(strength, FalloffSSE(distance, field.Radius)), signBit);
+		accX = _mm_add_ps(accX, _mm_mul_ps(velocityX, scale));
+		accY = _mm_add_ps(accY, _mm_mul_ps(velocityY, scale));
+		accZ = _mm_add_ps(accZ, _mm_mul_ps(velocityZ, scale));
+		return;
+	}
+
+	const __m128 valid = _mm_cmpgt_ps(distance, epsilon);
+	const __m128 scale = _mm_and_ps(valid, _mm_div_ps(_mm_mul_ps(strength, FalloffSSE(distance, field.Radius)), _mm_max_ps(distance, epsilon)));
+	accX = _mm_add_ps(accX, _mm_mul_ps(offsetX, scale));
+	accY = _mm_add_ps(accY, _mm_mul_ps(offsetY, scale));
+	accZ = _mm_add_ps(accZ, _mm_mul_ps(offsetZ, scale));
+}
+#endif
+
+void EvaluateForceFieldsSIMD(ForceFieldSoA& particles, const std::vector<ForceField>& fields)
+{
+#if FORCE_FIELD_SSE
+	std::vector<uint> culled;
+	culled.reserve(fields.size());
+	for (size_t begin = 0; begin < particles.Size(); begin += FORCE_FIELD_BLOCK_SIZE)
+	{
+		const size_t end = (std::min)(begin + FORCE_FIELD_BLOCK_SIZE, particles.Size());
+		CullBlock(particles, begin, end, fields, culled);
+
+		const size_t simdEnd = begin + ((end - begin) & ~size_t(3));
+		for (size_t n = begin; n < simdEnd; n += 4)
+		{
+			const __m128 positionX = _mm_loadu_ps(&particles.positionX[n]);
+			const __m128 positionY = _mm_loadu_ps(&particles.positionY[n]);
+			const __m128 positionZ = _mm_loadu_ps(&particles.positionZ[n]);
+			const __m128 velocityX = _mm_loadu_ps(&particles.velocityX[n]);
+			const __m128 velocityY = _mm_loadu_ps(&particles.velocityY[n]);
+			const __m128 velocityZ = _mm_loadu_ps(&particles.velocityZ[n]);
+			__m128 accX = _mm_setzero_ps();
+			__m128 accY = _mm_setzero_ps();
+			__m128 accZ = _mm_setzero_ps();
+			for (uint field : culled)
+			{
+				AccumulateFieldSSE(fields[field], positionX, positionY, positionZ, velocityX, velocityY, velocityZ, accX, accY, accZ);
+			}
+			_mm_storeu_ps(&particles.accelerationX[n], accX);
+			_mm_storeu_ps(&particles.accelerationY[n], accY);
+			_mm_storeu_ps(&particles.accelerationZ[n], accZ);
+		}
+
+		for (size_t n = simdEnd; n < end; ++n)
+		{
+			EvaluateParticle(particles, n, fields, culled);
+		}
+	}
+#else
+	EvaluateForceFields(particles, fields);
+#endif
+}
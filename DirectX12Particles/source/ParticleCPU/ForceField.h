@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../ParticleGame/ForceField.hlsli"
+
+#include <vector>
+
+// Particles that share one culled field list, the thread group size of ComputeSimulator.hlsl
+#define FORCE_FIELD_BLOCK_SIZE 128
+
+// Appends the index of every field whose bounds overlap the box, what each thread group of ComputeSimulator.hlsl keeps
+void CullForceFields(const std::vector<ForceField>& fields, float3 boundsMin, float3 boundsMax, std::vector<uint>& culled);
+
+// The particle fields the evaluation reads and writes, one array per component so four particles fill an SSE register
+struct ForceFieldSoA
+{
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> velocityX;
+	std::vector<float> velocityY;
+	std::vector<float> velocityZ;
+	std::vector<float> accelerationX; // Output, the summed acceleration of all fields
+	std::vector<float> accelerationY;
+	std::vector<float> accelerationZ;
+
+	size_t Size() const { return positionX.size(); }
+};
+
+// CPU reference of the force fields in ComputeSimulator.hlsl, culls the fields per FORCE_FIELD_BLOCK_SIZE particles
+// and sums ForceFieldAcceleration of the remaining ones
+void EvaluateForceFields(ForceFieldSoA& particles, const std::vector<ForceField>& fields);
+
+// Same as EvaluateForceFields with each field applied to four particles at once, the field type is uniform so the lanes never diverge.
+// Builds without SSE fall back to EvaluateForceFields.
+void EvaluateForceFieldsSIMD(ForceFieldSoA& particles, const std::vector<ForceField>& fields);
@@ -0,0 +1,164 @@
+#pragma once
+
+// Minimal HLSL-style vector types and intrinsics so the shared .hlsli headers in ParticleGame
+// compile as C++. Only what the shared kernels use is provided, swizzles are not supported.
+// Matrices follow the XMMATRIX layout the game uploads, mul(M, v) matches the shaders.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+typedef uint32_t uint;
+
+// Scalar math comes from <cmath>, re-declared here so shared code can call it unqualified
+using std::abs;
+using std::exp;
+using std::floor;
+using std::ceil;
+using std::sqrt;
+using std::pow;
+using std::log2;
+using std::sin;
+using std::cos;
+
+struct float2
+{
+	float x, y;
+
+	float2() : x(0), y(0) {}
+	float2(float x, float y) : x(x), y(y) {}
+
+	float& operator[](int i) { return (&x)[i]; }
+	float operator[](int i) const { return (&x)[i]; }
+};
+
+struct float3
+{
+	float x, y, z;
+
+	float3() : x(0), y(0), z(0) {}
+	float3(float x, float y, float z) : x(x), y(y), z(z) {}
+
+	float& operator[](int i) { return (&x)[i]; }
+	float operator[](int i) const { return (&x)[i]; }
+};
+
+struct float4
+{
+	float x, y, z, w;
+
+	float4() : x(0), y(0), z(0), w(0) {}
+	float4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	float4(const float3& v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+
+	float& operator[](int i) { return (&x)[i]; }
+	float operator[](int i) const { return (&x)[i]; }
+};
+
+struct int2
+{
+	int x, y;
+
+	int2() : x(0), y(0) {}
+	int2(int x, int y) : x(x), y(y) {}
+};
+
+struct int3
+{
+	int x, y, z;
+
+	int3() : x(0), y(0), z(0) {}
+	int3(int x, int y, int z) : x(x), y(y), z(z) {}
+};
+
+struct uint2
+{
+	uint x, y;
+
+	uint2() : x(0), y(0) {}
+	uint2(uint x, uint y) : x(x), y(y) {}
+};
+
+struct uint4
+{
+	uint x, y, z, w;
+
+	uint4() : x(0), y(0), z(0), w(0) {}
+	uint4(uint x, uint y, uint z, uint w) : x(x), y(y), z(z), w(w) {}
+};
+
+// Rows as stored by XMMATRIX
+struct float4x4
+{
+	float4 r[4];
+};
+
+// Component-wise operators
+#define HLSLMATH_VECTOR_OPERATORS(T, N)                                                                              \
+	inline T operator+(const T& a, const T& b) { T o; for (int i = 0; i < N; ++i) o[i] = a[i] + b[i]; return o; } \
+	inline T operator-(const T& a, const T& b) { T o; for (int i = 0; i < N; ++i) o[i] = a[i] - b[i]; return o; } \
+	inline T operator*(const T& a, const T& b) { T o; for (int i = 0; i < N; ++i) o[i] = a[i] * b[i]; return o; } \
+	inline T operator/(const T& a, const T& b) { T o; for (int i = 0; i < N; ++i) o[i] = a[i] / b[i]; return o; } \
+	inline T operator*(const T& a, float s) { T o; for (int i = 0; i < N; ++i) o[i] = a[i] * s; return o; }       \
+	inline T operator*(float s, const T& a) { return a * s; }                                                      \
+	inline T operator/(const T& a, float s) { T o; for (int i = 0; i < N; ++i) o[i] = a[i] / s; return o; }       \
+	inline T operator-(const T& a) { T o; for (int i = 0; i < N; ++i) o[i] = -a[i]; return o; }                   \
+	inline T& operator+=(T& a, const T& b) { a = a + b; return a; }                                               \
+	inline T& operator-=(T& a, const T& b) { a = a - b; return a; }                                               \
+	inline T& operator*=(T& a, const T& b) { a = a * b; return a; }                                               \
+	inline T& operator*=(T& a, float s) { a = a * s; return a; }                                                  \
+	inline T& operator/=(T& a, float s) { a = a / s; return a; }                                                  \
+	inline float dot(const T& a, const T& b) { float d = 0; for (int i = 0; i < N; ++i) d += a[i] * b[i]; return d; } \
+	inline T (min)(const T& a, const T& b) { T o; for (int i = 0; i < N; ++i) o[i] = a[i] < b[i] ? a[i] : b[i]; return o; } \
+	inline T (max)(const T& a, const T& b) { T o; for (int i = 0; i < N; ++i) o[i] = a[i] > b[i] ? a[i] : b[i]; return o; } \
+	inline T abs(const T& a) { T o; for (int i = 0; i < N; ++i) o[i] = std::fabs(a[i]); return o; }             \
+	inline T floor(const T& a) { T o; for (int i = 0; i < N; ++i) o[i] = std::floor(a[i]); return o; }         \
+	inline T frac(const T& a) { T o; for (int i = 0; i < N; ++i) o[i] = a[i] - std::floor(a[i]); return o; }   \
+	inline T lerp(const T& a, const T& b, float t) { return a + (b - a) * t; }                                    \
+	inline T lerp(const T& a, const T& b, const T& t) { return a + (b - a) * t; }                                 \
+	inline T saturate(const T& a) { T o; for (int i = 0; i < N; ++i) o[i] = a[i] < 0 ? 0 : (a[i] > 1 ? 1 : a[i]); return o; } \
+	inline T clamp(const T& a, const T& lo, const T& hi) { return (min)((max)(a, lo), hi); }                      \
+	inline float length(const T& a) { return std::sqrt(dot(a, a)); }                                              \
+	inline T normalize(const T& a) { return a * (1.0f / length(a)); }
+
+HLSLMATH_VECTOR_OPERATORS(float2, 2)
+HLSLMATH_VECTOR_OPERATORS(float3, 3)
+HLSLMATH_VECTOR_OPERATORS(float4, 4)
+
+#undef HLSLMATH_VECTOR_OPERATORS
+
+// Scalar intrinsics, min/max are parenthesized so the Windows macros can't expand them
+inline float (min)(float a, float b) { return a < b ? a : b; }
+inline float (max)(float a, float b) { return a > b ? a : b; }
+inline int (min)(int a, int b) { return a < b ? a : b; }
+inline int (max)(int a, int b) { return a > b ? a : b; }
+inline uint (min)(uint a, uint b) { return a < b ? a : b; }
+inline uint (max)(uint a, uint b) { return a > b ? a : b; }
+inline float frac(float a) { return a - std::floor(a); }
+inline float lerp(float a, float b, float t) { return a + (b - a) * t; }
+inline float saturate(float a) { return a < 0 ? 0 : (a > 1 ? 1 : a); }
+inline float clamp(float a, float lo, float hi) { return a < lo ? lo : (a > hi ? hi : a); }
+inline int clamp(int a, int lo, int hi) { return a < lo ? lo : (a > hi ? hi : a); }
+inline float rsqrt(float a) { return 1.0f / std::sqrt(a); }
+inline float sign(float a) { return a > 0 ? 1.0f : (a < 0 ? -1.0f : 0.0f); }
+inline float step(float edge, float a) { return a >= edge ? 1.0f : 0.0f; }
+inline float smoothstep(float lo, float hi, float a) { float t = saturate((a - lo) / (hi - lo)); return t * t * (3.0f - 2.0f * t); }
+
+inline uint asuint(float f) { uint u; std::memcpy(&u, &f, sizeof(u)); return u; }
+inline float asfloat(uint u) { float f; std::memcpy(&f, &u, sizeof(f)); return f; }
+
+inline float3 cross(const float3& a, const float3& b)
+{
+	return float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+inline float3 reflect(const float3& i, const float3& n)
+{
+	return i - 2.0f * dot(i, n) * n;
+}
+
+// Row vector times XMMATRIX rows, equivalent to mul(M, v) in the shaders
+inline float4 mul(const float4x4& m, const float4& v)
+{
+	return m.r[0] * v.x + m.r[1] * v.y + m.r[2] * v.z + m.r[3] * v.w;
+}
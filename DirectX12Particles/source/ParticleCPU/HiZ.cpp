@@ -0,0 +1,44 @@
+#include "HiZ.h"
+
+float2 HiZLevel::Load(int x, int y) const
+{
+	x = clamp(x, 0, static_cast<int>(width) - 1);
+	y = clamp(y, 0, static_cast<int>(height) - 1);
+	return texels[y * width + x];
+}
+
+std::vector<HiZLevel> BuildHiZ(const std::vector<float>& depth, uint width, uint height)
+{
+	const uint mipCount = HiZMipCount(width, height);
+	std::vector<HiZLevel> levels(mipCount);
+
+	levels[0].width = width;
+	levels[0].height = height;
+	levels[0].texels.resize(static_cast<size_t>(width) * height);
+	for (size_t n = 0; n < levels[0].texels.size(); ++n)
+	{
+		levels[0].texels[n] = float2(depth[n], depth[n]);
+	}
+
+	for (uint mip = 1; mip < mipCount; ++mip)
+	{
+		const HiZLevel& source = levels[mip - 1];
+		HiZLevel& level = levels[mip];
+		level.width = HiZMipDimension(width, mip);
+		level.height = HiZMipDimension(height, mip);
+		level.texels.resize(static_cast<size_t>(level.width) * level.height);
+
+		for (uint y = 0; y < level.height; ++y)
+		{
+			for (uint x = 0; x < level.width; ++x)
+			{
+				const int sx = x * 2;
+				const int sy = y * 2;
+				level.texels[y * level.width + x] = HiZReduce(source.Load(sx, sy), source.Load(sx + 1, sy),
+					source.Load(sx, sy + 1), source.Load(sx + 1, sy + 1));
+			}
+		}
+	}
+
+	return levels;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../ParticleGame/HiZ.hlsli"
+
+#include <vector>
+
+// One level of the min/max depth pyramid, texels hold (closest, furthest) depth
+struct HiZLevel
+{
+	uint width;
+	uint height;
+	std::vector<float2> texels;
+
+	float2 Load(int x, int y) const;
+};
+
+// CPU reference of ComputeHiZ.hlsl, builds every level from a width * height row-major depth image
+std::vector<HiZLevel> BuildHiZ(const std::vector<float>& depth, uint width, uint height);
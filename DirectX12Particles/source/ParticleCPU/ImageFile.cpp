@@ -0,0 +1,678 @@
+#include "ImageFile.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static const uint8_t PNGSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+// D3D12's largest 2D texture, anything larger can't be a texture anyway
+static const uint32_t ImageMaxSize = 16384;
+
+// Deflate reads bits from the least significant end of each byte
+struct BitReader
+{
+	const uint8_t* Position;
+	const uint8_t* End;
+	uint32_t Buffer = 0;
+	uint32_t Count = 0;
+
+	bool Read(uint32_t bits, uint32_t& value)
+	{
+		while (Count < bits)
+		{
+			if (Position == End)
+			{
+				return false;
+			}
+			Buffer |= static_cast<uint32_t>(*Position++) << Count;
+			Count += 8;
+		}
+		value = Buffer & ((1u << bits) - 1);
+		Buffer >>= bits;
+		Count -= bits;
+		return true;
+	}
+
+	void AlignToByte()
+	{
+		Buffer >>= Count % 8;
+		Count -= Count % 8;
+	}
+};
+
+// Canonical Huffman code as counts of codes per length and the symbols ordered by code
+struct Huffman
+{
+	uint16_t Counts[16];
+	uint16_t Symbols[288];
+
+	// Fails for over-subscribed codes, incomplete ones are fine since a single distance code is allowed
+	bool Build(const uint8_t* lengths, uint32_t count)
+	{
+		memset(Counts, 0, sizeof(Counts));
+		for (uint32_t symbol = 0; symbol < count; ++symbol)
+		{
+			Counts[lengths[symbol]]++;
+		}
+		Counts[0] = 0;
+		int left = 1;
+		for (uint32_t length = 1; length < 16; ++length)
+		{
+			left = left * 2 - Counts[length];
+			if (left < 0)
+			{
+				return false;
+			}
+		}
+
+		uint16_t offsets[16];
+		offsets[1] = 0;
+		for (uint32_t length = 1; length < 15; ++length)
+		{
+			offsets[length + 1] = offsets[length] + Counts[length];
+		}
+		for (uint32_t symbol = 0; symbol < count; ++symbol)
+		{
+			if (lengths[symbol] != 0)
+			{
+				Symbols[offsets[lengths[symbol]]++] = static_cast<uint16_t>(symbol);
+			}
+		}
+		return true;
+	}
+
+	bool Decode(BitReader& bits, uint32_t& symbol) const
+	{
+		int code = 0;
+		int first = 0;
+		int index = 0;
+		for (uint32_t length = 1; length < 16; ++length)
+		{
+			uint32_t bit;
+			if (!bits.Read(1, bit))
+			{
+				return false;
+			}
+			code |= static_cast<int>(bit);
+			const int count = Counts[length];
+			if (code - first < count)
+			{
+				symbol = Symbols[index + code - first];
+				return true;
+			}
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+		return false;
+	}
+};
+
+static const uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+	6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static bool InflateBlock(BitReader& bits, const Huffman& lengthCodes, const Huffman& distanceCodes, uint8_t* output, size_t size, size_t& written)
+{
+	for (;;)
+	{
+		uint32_t symbol;
+		if (!lengthCodes.Decode(bits, symbol))
+		{
+			return false;
+		}
+		if (symbol < 256)
+		{
+			if (written == size)
+			{
+				return false;
+			}
+			output[written++] = static_cast<uint8_t>(symbol);
+			continue;
+		}
+		if (symbol == 256)
+		{
+			return true;
+		}
+
+		symbol -= 257;
+		uint32_t extra;
+		if (symbol >= 29 || !bits.Read(LengthExtra[symbol], extra))
+		{
+			return false;
+		}
+		const size_t length = LengthBase[symbol] + extra;
+		if (!distanceCodes.Decode(bits, symbol) || symbol >= 30 || !bits.Read(DistanceExtra[symbol], extra))
+		{
+			return false;
+		}
+		const size_t distance = DistanceBase[symbol] + extra;
+		if (distance > written || length > size - written)
+		{
+			return false;
+		}
+		// Overlapping copies repeat what they just wrote, byte by byte
+		for (size_t n = 0; n < length; ++n, ++written)
+		{
+			output[written] = output[written - distance];
+		}
+	}
+}
+
+static bool ReadDynamicCodes(BitReader& bits, Huffman& lengthCodes, Huffman& distanceCodes)
+{
+	static const uint8_t Order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+	uint32_t lengthCount, distanceCount, codeCount;
+	if (!bits.Read(5, lengthCount) || !bits.Read(5, distanceCount) || !bits.Read(4, codeCount))
+	{
+		return false;
+	}
+	lengthCount += 257;
+	distanceCount += 1;
+	codeCount += 4;
+	if (lengthCount > 286 || distanceCount > 30)
+	{
+		return false;
+	}
+
+	uint8_t lengths[320] = {};
+	for (uint32_t n = 0; n < codeCount; ++n)
+	{
+		uint32_t length;
+		if (!bits.Read(3, length))
+		{
+			return false;
+		}
+		lengths[Order[n]] = static_cast<uint8_t>(length);
+	}
+	Huffman codeLengthCodes;
+	if (!codeLengthCodes.Build(lengths, 19))
+	{
+		return false;
+	}
+
+	memset(lengths, 0, sizeof(lengths));
+	for (uint32_t n = 0; n < lengthCount + distanceCount;)
+	{
+		uint32_t symbol;
+		if (!codeLengthCodes.Decode(bits, symbol))
+		{
+			return false;
+		}
+		if (symbol < 16)
+		{
+			lengths[n++] = static_cast<uint8_t>(symbol);
+			continue;
+		}
+		uint32_t repeat;
+		uint8_t value = 0;
+		if (symbol == 16)
+		{
+			if (n == 0 || !bits.Read(2, repeat))
+			{
+				return false;
+			}
+			value = lengths[n - 1];
+			repeat += 3;
+		}
+		else if (symbol == 17)
+		{
+			if (!bits.Read(3, repeat))
+			{
+				return false;
+			}
+			repeat += 3;
+		}
+		else
+		{
+			if (!bits.Read(7, repeat))
+			{
+				return false;
+			}
+			repeat += 11;
+		}
+		if (n + repeat > lengthCount + distanceCount)
+		{
+			return false;
+		}
+		for (; repeat > 0; --repeat)
+		{
+			lengths[n++] = value;
+		}
+	}
+	return lengths[256] != 0 && lengthCodes.Build(lengths, lengthCount) && distanceCodes.Build(lengths + lengthCount, distanceCount);
+}
+
+bool Inflate(const void* data, size_t size, std::vector<uint8_t>& output)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	// Deflate with a window up to 32 KB and no preset dictionary
+	if (size < 6 || (bytes[0] & 0x0f) != 8 || (bytes[0] >> 4) > 7 || ((bytes[0] << 8) | bytes[1]) % 31 != 0 || (bytes[1] & 0x20))
+	{
+		return false;
+	}
+	BitReader bits = { bytes + 2, bytes + size - 4 };
+	size_t written = 0;
+
+	uint32_t last;
+	do
+	{
+		uint32_t type;
+		if (!bits.Read(1, last) || !bits.Read(2, type))
+		{
+			return false;
+		}
+		if (type == 0)
+		{
+			bits.AlignToByte();
+			uint32_t length, complement;
+			if (!bits.Read(16, length) || !bits.Read(16, complement) || (length ^ 0xffff) != complement)
+			{
+				return false;
+			}
+			// Whole bytes after the alignment, the bit buffer is empty
+			if (static_cast<size_t>(bits.End - bits.Position) < length || output.size() - written < length)
+			{
+				return false;
+			}
+			memcpy(output.data() + written, bits.Position, length);
+			bits.Position += length;
+			written += length;
+		}
+		else if (type == 1)
+		{
+			static Huffman fixedLengthCodes;
+			static Huffman fixedDistanceCodes;
+			static const bool built = []()
+			{
+				uint8_t lengths[288];
+				memset(lengths, 8, 144);
+				memset(lengths + 144, 9, 112);
+				memset(lengths + 256, 7, 24);
+				memset(lengths + 280, 8, 8);
+				fixedLengthCodes.Build(lengths, 288);
+				memset(lengths, 5, 30);
+				fixedDistanceCodes.Build(lengths, 30);
+				return true;
+			}();
+			(void)built;
+			if (!InflateBlock(bits, fixedLengthCodes, fixedDistanceCodes, output.data(), output.size(), written))
+			{
+				return false;
+			}
+		}
+		else if (type == 2)
+		{
+			Huffman lengthCodes;
+			Huffman distanceCodes;
+			if (!ReadDynamicCodes(bits, lengthCodes, distanceCodes) ||
+				!InflateBlock(bits, lengthCodes, distanceCodes, output.data(), output.size(), written))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			return false;
+		}
+	} while (!last);
+
+	if (written != output.size())
+	{
+		return false;
+	}
+	uint32_t a = 1, b = 0;
+	for (size_t n = 0; n < written; ++n)
+	{
+		a = (a + output[n]) % 65521;
+		b = (b + a) % 65521;
+	}
+	const uint8_t* trailer = bytes + size - 4;
+	return ((b << 16) | a) == ((static_cast<uint32_t>(trailer[0]) << 24) | (trailer[1] << 16) | (trailer[2] << 8) | trailer[3]);
+}
+
+static uint32_t ReadBigEndian32(const uint8_t* bytes)
+{
+	return (static_cast<uint32_t>(bytes[0]) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+static uint8_t PaethPredictor(int a, int b, int c)
+{
+	const int p = a + b - c;
+	const int pa = abs(p - a);
+	const int pb = abs(p - b);
+	const int pc = abs(p - c);
+	return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+}
+
+static bool Fail(std::string& error, const char* message)
+{
+	error = message;
+	return false;
+}
+
+bool DecodePNG(const void* data, size_t size, Image& image, std::string& error)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	const uint8_t* end = bytes + size;
+	if (size < sizeof(PNGSignature) || memcmp(bytes, PNGSignature, sizeof(PNGSignature)) != 0)
+	{
+		return Fail(error, "not a PNG");
+	}
+
+	uint32_t width = 0, height = 0, bitDepth = 0, colorType = 0;
+	uint8_t palette[256][4];
+	uint32_t paletteSize = 0;
+	bool transparentKey = false;
+	uint16_t key[3] = {};
+	std::vector<uint8_t> compressed;
+	for (const uint8_t* chunk = bytes + sizeof(PNGSignature);; )
+	{
+		if (end - chunk < 12)
+		{
+			return Fail(error, "truncated PNG");
+		}
+		const uint32_t length = ReadBigEndian32(chunk);
+		const uint8_t* type = chunk + 4;
+		const uint8_t* body = chunk + 8;
+		if (static_cast<size_t>(end - body) < static_cast<size_t>(length) + 4)
+		{
+			return Fail(error, "truncated PNG");
+		}
+		chunk = body + length + 4;
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length != 13)
+			{
+				return Fail(error, "bad PNG header");
+			}
+			width = ReadBigEndian32(body);
+			height = ReadBigEndian32(body + 4);
+			bitDepth = body[8];
+			colorType = body[9];
+			if (body[10] != 0 || body[11] != 0)
+			{
+				return Fail(error, "unknown PNG compression or filter method");
+			}
+			if (body[12] != 0)
+			{
+				return Fail(error, "interlaced PNGs aren't supported");
+			}
+			const bool validDepth = (colorType == 0 && (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16)) ||
+				(colorType == 3 && (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8)) ||
+				((colorType == 2 || colorType == 4 || colorType == 6) && (bitDepth == 8 || bitDepth == 16));
+			if (!validDepth || width == 0 || height == 0 || width > ImageMaxSize || height > ImageMaxSize)
+			{
+				return Fail(error, "unsupported PNG size, color type or bit depth");
+			}
+			for (uint32_t n = 0; n < 256; ++n)
+			{
+				palette[n][0] = palette[n][1] = palette[n][2] = 0;
+				palette[n][3] = 255;
+			}
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			if (length % 3 != 0 || length / 3 > 256)
+			{
+				return Fail(error, "bad PNG palette");
+			}
+			paletteSize = length / 3;
+			for (uint32_t n = 0; n < paletteSize; ++n)
+			{
+				memcpy(palette[n], body + n * 3, 3);
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (colorType == 3)
+			{
+				for (uint32_t n = 0; n < length && n < 256; ++n)
+				{
+					palette[n][3] = body[n];
+				}
+			}
+			else if ((colorType == 0 && length == 2) || (colorType == 2 && length == 6))
+			{
+				transparentKey = true;
+				for (uint32_t n = 0; n < length / 2; ++n)
+				{
+					key[n] = static_cast<uint16_t>((body[n * 2] << 8) | body[n * 2 + 1]);
+				}
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), body, body + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			break;
+		}
+		else if (!(type[0] & 0x20))
+		{
+			return Fail(error, "unknown critical PNG chunk");
+		}
+	}
+	if (width == 0 || (colorType == 3 && paletteSize == 0))
+	{
+		return Fail(error, "PNG without header or palette");
+	}
+
+	// Every row is a filter byte followed by the packed samples
+	static const uint32_t ChannelCounts[7] = { 1, 0, 3, 1, 2, 0, 4 };
+	const uint32_t channels = ChannelCounts[colorType];
+	const size_t rowBytes = (static_cast<size_t>(width) * channels * bitDepth + 7) / 8;
+	const size_t pixelBytes = (std::max)(static_cast<size_t>(1), static_cast<size_t>(channels * bitDepth / 8));
+	std::vector<uint8_t> filtered((rowBytes + 1) * height);
+	if (!Inflate(compressed.data(), compressed.size(), filtered))
+	{
+		return Fail(error, "corrupt PNG image data");
+	}
+
+	std::vector<uint8_t> previous(rowBytes, 0);
+	std::vector<uint8_t> row(rowBytes);
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(static_cast<size_t>(width) * height * 4);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* source = filtered.data() + y * (rowBytes + 1);
+		const uint8_t filter = source[0];
+		++source;
+		for (size_t n = 0; n < rowBytes; ++n)
+		{
+			const int a = n >= pixelBytes ? row[n - pixelBytes] : 0;
+			const int b = previous[n];
+			const int c = n >= pixelBytes ? previous[n - pixelBytes] : 0;
+			switch (filter)
+			{
+			case 0: row[n] = source[n]; break;
+			case 1: row[n] = static_cast<uint8_t>(source[n] + a); break;
+			case 2: row[n] = static_cast<uint8_t>(source[n] + b); break;
+			case 3: row[n] = static_cast<uint8_t>(source[n] + ((a + b) >> 1)); break;
+			case 4: row[n] = static_cast<uint8_t>(source[n] + PaethPredictor(a, b, c)); break;
+			default: return Fail(error, "bad PNG filter");
+			}
+		}
+
+		uint8_t* pixel = image.Pixels.data() + static_cast<size_t>(y) * width * 4;
+		for (uint32_t x = 0; x < width; ++x, pixel += 4)
+		{
+			// Samples as stored, then reduced to 8 bits
+			uint16_t samples[4] = {};
+			for (uint32_t channel = 0; channel < channels; ++channel)
+			{
+				const size_t bit = (static_cast<size_t>(x) * channels + channel) * bitDepth;
+				if (bitDepth == 16)
+				{
+					samples[channel] = static_cast<uint16_t>((row[bit / 8] << 8) | row[bit / 8 + 1]);
+				}
+				else
+				{
+					samples[channel] = static_cast<uint16_t>((row[bit / 8] >> (8 - bitDepth - bit % 8)) & ((1u << bitDepth) - 1));
+				}
+			}
+			const auto scale = [bitDepth](uint32_t sample)
+			{
+				return static_cast<uint8_t>(bitDepth == 16 ? sample >> 8 : sample * 255 / ((1u << bitDepth) - 1));
+			};
+
+			switch (colorType)
+			{
+			case 0:
+				pixel[0] = pixel[1] = pixel[2] = scale(samples[0]);
+				pixel[3] = transparentKey && samples[0] == key[0] ? 0 : 255;
+				break;
+			case 2:
+				pixel[0] = scale(samples[0]);
+				pixel[1] = scale(samples[1]);
+				pixel[2] = scale(samples[2]);
+				pixel[3] = transparentKey && samples[0] == key[0] && samples[1] == key[1] && samples[2] == key[2] ? 0 : 255;
+				break;
+			case 3:
+				if (samples[0] >= paletteSize)
+				{
+					return Fail(error, "PNG palette index out of range");
+				}
+				memcpy(pixel, palette[samples[0]], 4);
+				break;
+			case 4:
+				pixel[0] = pixel[1] = pixel[2] = scale(samples[0]);
+				pixel[3] = scale(samples[1]);
+				break;
+			default:
+				pixel[0] = scale(samples[0]);
+				pixel[1] = scale(samples[1]);
+				pixel[2] = scale(samples[2]);
+				pixel[3] = scale(samples[3]);
+				break;
+			}
+		}
+		previous.swap(row);
+	}
+	return true;
+}
+
+bool DecodeTGA(const void* data, size_t size, Image& image, std::string& error)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	if (size < 18)
+	{
+		return Fail(error, "truncated TGA");
+	}
+	const uint32_t idLength = bytes[0];
+	const uint32_t colorMapType = bytes[1];
+	const uint32_t imageType = bytes[2];
+	const uint32_t width = bytes[12] | (bytes[13] << 8);
+	const uint32_t height = bytes[14] | (bytes[15] << 8);
+	const uint32_t pixelDepth = bytes[16];
+	const uint32_t descriptor = bytes[17];
+
+	const bool gray = imageType == 3 || imageType == 11;
+	const bool rle = imageType >= 9;
+	if (colorMapType != 0 || (imageType != 2 && imageType != 3 && imageType != 10 && imageType != 11))
+	{
+		return Fail(error, "only true color and grayscale TGAs are supported");
+	}
+	if ((gray && pixelDepth != 8) || (!gray && pixelDepth != 15 && pixelDepth != 16 && pixelDepth != 24 && pixelDepth != 32) ||
+		width == 0 || height == 0 || width > ImageMaxSize || height > ImageMaxSize)
+	{
+		return Fail(error, "unsupported TGA size or pixel depth");
+	}
+
+	const uint32_t pixelBytes = (pixelDepth + 7) / 8;
+	const bool alpha = pixelDepth == 32 || (pixelDepth == 16 && (descriptor & 0x0f) != 0);
+	const uint8_t* source = bytes + 18 + idLength;
+	const uint8_t* end = bytes + size;
+	if (source > end)
+	{
+		return Fail(error, "truncated TGA");
+	}
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(static_cast<size_t>(width) * height * 4);
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	uint8_t value[4] = {};
+	size_t runLeft = 0;
+	bool repeat = false;
+	for (size_t n = 0; n < pixelCount; ++n)
+	{
+		if (rle && runLeft == 0)
+		{
+			if (source == end)
+			{
+				return Fail(error, "truncated TGA");
+			}
+			repeat = (*source & 0x80) != 0;
+			runLeft = (*source++ & 0x7f) + 1;
+			if (repeat)
+			{
+				if (static_cast<size_t>(end - source) < pixelBytes)
+				{
+					return Fail(error, "truncated TGA");
+				}
+				memcpy(value, source, pixelBytes);
+				source += pixelBytes;
+			}
+		}
+		if (!rle || !repeat)
+		{
+			if (static_cast<size_t>(end - source) < pixelBytes)
+			{
+				return Fail(error, "truncated TGA");
+			}
+			memcpy(value, source, pixelBytes);
+			source += pixelBytes;
+		}
+		--runLeft;
+
+		// Rows are stored bottom up unless the descriptor says otherwise, and right to left with bit 4
+		const size_t x = n % width;
+		const size_t y = n / width;
+		const size_t row = (descriptor & 0x20) ? y : height - 1 - y;
+		const size_t column = (descriptor & 0x10) ? width - 1 - x : x;
+		uint8_t* pixel = image.Pixels.data() + (row * width + column) * 4;
+		if (gray)
+		{
+			pixel[0] = pixel[1] = pixel[2] = value[0];
+			pixel[3] = 255;
+		}
+		else if (pixelBytes == 2)
+		{
+			const uint32_t packed = value[0] | (value[1] << 8);
+			pixel[0] = static_cast<uint8_t>(((packed >> 10) & 31) * 255 / 31);
+			pixel[1] = static_cast<uint8_t>(((packed >> 5) & 31) * 255 / 31);
+			pixel[2] = static_cast<uint8_t>((packed & 31) * 255 / 31);
+			pixel[3] = alpha && !(packed & 0x8000) ? 0 : 255;
+		}
+		else
+		{
+			pixel[0] = value[2];
+			pixel[1] = value[1];
+			pixel[2] = value[0];
+			pixel[3] = alpha ? value[3] : 255;
+		}
+	}
+	return true;
+}
+
+bool LoadImageFile(const std::filesystem::path& path, Image& image, std::string& error)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		return Fail(error, "can't open the file");
+	}
+	if (file.GetSize() >= sizeof(PNGSignature) && memcmp(file.GetData(), PNGSignature, sizeof(PNGSignature)) == 0)
+	{
+		return DecodePNG(file.GetData(), file.GetSize(), image, error);
+	}
+	return DecodeTGA(file.GetData(), file.GetSize(), image, error);
+}
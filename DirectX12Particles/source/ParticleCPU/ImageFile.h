@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Authored source images for the texture build, decoded to 8 bit RGBA without any library.
+// PNG: every color type at every bit depth, 16 bit channels keep their high byte, palettes with tRNS alpha. Interlaced files fail.
+// TGA: uncompressed and RLE true color (15/16, 24 and 32 bit) and grayscale (8 bit), either origin. Color mapped files fail.
+struct Image
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<uint8_t> Pixels; // RGBA, rows top to bottom without padding
+};
+
+// zlib stream into output, which has to come out exactly output.size() bytes. Checks the Adler-32 trailer.
+bool Inflate(const void* data, size_t size, std::vector<uint8_t>& output);
+
+bool DecodePNG(const void* data, size_t size, Image& image, std::string& error);
+bool DecodeTGA(const void* data, size_t size, Image& image, std::string& error);
+
+// Maps path and decodes it as PNG when it starts with the PNG signature, as TGA otherwise
+bool LoadImageFile(const std::filesystem::path& path, Image& image, std::string& error);
@@ -0,0 +1,221 @@
+#include "LZ4.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+static const size_t LZ4MinMatch = 4;
+static const size_t LZ4LastLiterals = 5; // The last bytes of a block are always literals
+static const size_t LZ4MatchFindLimit = 12; // No match starts closer than this to the end of a block
+static const size_t LZ4MaxOffset = 65535;
+static const unsigned LZ4HashBits = 16;
+
+static uint32_t Read32(const uint8_t* data)
+{
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static uint32_t Hash4(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - LZ4HashBits);
+}
+
+// Lengths from 15 up continue in bytes of 255 and a final byte below 255
+static bool WriteLength(uint8_t*& output, const uint8_t* outputEnd, size_t length)
+{
+	for (; length >= 255; length -= 255)
+	{
+		if (output >= outputEnd)
+		{
+			return false;
+		}
+		*output++ = 255;
+	}
+	if (output >= outputEnd)
+	{
+		return false;
+	}
+	*output++ = static_cast<uint8_t>(length);
+	return true;
+}
+
+static bool ReadLength(const uint8_t*& input, const uint8_t* inputEnd, size_t& length)
+{
+	uint8_t byte;
+	do
+	{
+		if (input >= inputEnd)
+		{
+			return false;
+		}
+		byte = *input++;
+		length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+static bool WriteSequence(uint8_t*& output, const uint8_t* outputEnd, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+	if (output >= outputEnd)
+	{
+		return false;
+	}
+	uint8_t* token = output++;
+	*token = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+	if (literalLength >= 15 && !WriteLength(output, outputEnd, literalLength - 15))
+	{
+		return false;
+	}
+	if (static_cast<size_t>(outputEnd - output) < literalLength)
+	{
+		return false;
+	}
+	memcpy(output, literals, literalLength);
+	output += literalLength;
+
+	// The last sequence of a block has literals only
+	if (matchLength == 0)
+	{
+		return true;
+	}
+	if (outputEnd - output < 2)
+	{
+		return false;
+	}
+	*output++ = static_cast<uint8_t>(offset);
+	*output++ = static_cast<uint8_t>(offset >> 8);
+	matchLength -= LZ4MinMatch;
+	*token |= static_cast<uint8_t>(matchLength >= 15 ? 15 : matchLength);
+	return matchLength < 15 || WriteLength(output, outputEnd, matchLength - 15);
+}
+
+size_t LZ4CompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t LZ4CompressBlock(const void* source, size_t sourceSize, void* destination, size_t destinationCapacity)
+{
+	const uint8_t* input = static_cast<const uint8_t*>(source);
+	const uint8_t* inputEnd = input + sourceSize;
+	uint8_t* output = static_cast<uint8_t*>(destination);
+	const uint8_t* outputEnd = output + destinationCapacity;
+	const uint8_t* anchor = input;
+
+	if (sourceSize > LZ4MatchFindLimit)
+	{
+		// Positions relative to input, every slot starts out pointing at the first byte which the byte compare rejects when it doesn't match
+		std::vector<uint32_t> table(size_t(1) << LZ4HashBits, 0);
+		const uint8_t* matchStartLimit = inputEnd - LZ4MatchFindLimit;
+		const uint8_t* matchEndLimit = inputEnd - LZ4LastLiterals;
+
+		const uint8_t* position = input;
+		while (position <= matchStartLimit)
+		{
+			const uint32_t sequence = Read32(position);
+			uint32_t& slot = table[Hash4(sequence)];
+			const uint8_t* candidate = input + slot;
+			slot = static_cast<uint32_t>(position - input);
+			if (candidate >= position || static_cast<size_t>(position - candidate) > LZ4MaxOffset || Read32(candidate) != sequence)
+			{
+				// Data without matches is skipped faster the longer the run of misses gets
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			while (position > anchor && candidate > input && position[-1] == candidate[-1])
+			{
+				--position;
+				--candidate;
+			}
+			size_t matchLength = LZ4MinMatch;
+			while (position + matchLength < matchEndLimit && position[matchLength] == candidate[matchLength])
+			{
+				++matchLength;
+			}
+
+			if (!WriteSequence(output, outputEnd, anchor, position - anchor, position - candidate, matchLength))
+			{
+				return 0;
+			}
+			position += matchLength;
+			anchor = position;
+			if (position <= matchStartLimit)
+			{
+				table[Hash4(Read32(position - 2))] = static_cast<uint32_t>(position - 2 - input);
+			}
+		}
+	}
+
+	if (!WriteSequence(output, outputEnd, anchor, inputEnd - anchor, 0, 0))
+	{
+		return 0;
+	}
+	return output - static_cast<uint8_t*>(destination);
+}
+
+bool LZ4DecompressBlock(const void* source, size_t sourceSize, void* destination, size_t destinationSize)
+{
+	const uint8_t* input = static_cast<const uint8_t*>(source);
+	const uint8_t* inputEnd = input + sourceSize;
+	uint8_t* outputBegin = static_cast<uint8_t*>(destination);
+	uint8_t* output = outputBegin;
+	const uint8_t* outputEnd = output + destinationSize;
+
+	while (input < inputEnd)
+	{
+		const uint8_t token = *input++;
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(input, inputEnd, literalLength))
+		{
+			return false;
+		}
+		if (literalLength > static_cast<size_t>(inputEnd - input) || literalLength > static_cast<size_t>(outputEnd - output))
+		{
+			return false;
+		}
+		memcpy(output, input, literalLength);
+		input += literalLength;
+		output += literalLength;
+
+		if (input == inputEnd)
+		{
+			return output == outputEnd;
+		}
+
+		if (inputEnd - input < 2)
+		{
+			return false;
+		}
+		const size_t offset = input[0] | (static_cast<size_t>(input[1]) << 8);
+		input += 2;
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(input, inputEnd, matchLength))
+		{
+			return false;
+		}
+		matchLength += LZ4MinMatch;
+		if (offset == 0 || offset > static_cast<size_t>(output - outputBegin) || matchLength > static_cast<size_t>(outputEnd - output))
+		{
+			return false;
+		}
+
+		// Matches closer than their length repeat the bytes they are writing, those have to go one at a time
+		const uint8_t* match = output - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(output, match, matchLength);
+			output += matchLength;
+		}
+		else
+		{
+			for (size_t n = 0; n < matchLength; ++n)
+			{
+				*output++ = *match++;
+			}
+		}
+	}
+	return false;
+}
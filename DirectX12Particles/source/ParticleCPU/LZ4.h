@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// LZ4 block format, the raw blocks of the reference library without its frame header, so blocks from either side decode on the other.
+// The caller keeps the uncompressed size, a block doesn't store it.
+
+// Largest block LZ4CompressBlock can produce from size bytes, incompressible data grows by a little under 0.4%
+size_t LZ4CompressBound(size_t size);
+
+// Greedy single pass compressor with a hash table of recent 4 byte sequences. Returns the block size, or 0 when it doesn't fit into destinationCapacity.
+size_t LZ4CompressBlock(const void* source, size_t sourceSize, void* destination, size_t destinationCapacity);
+
+// Decodes a block into exactly destinationSize bytes. Every length and offset is bounds checked, a damaged block returns false
+// and never reads or writes outside the two buffers.
+bool LZ4DecompressBlock(const void* source, size_t sourceSize, void* destination, size_t destinationSize);
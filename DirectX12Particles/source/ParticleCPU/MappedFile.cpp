@@ -0,0 +1,118 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: Data(std::exchange(other.Data, nullptr))
+	, Size(std::exchange(other.Size, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		Data = std::exchange(other.Data, nullptr);
+		Size = std::exchange(other.Size, 0);
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+// The view keeps the mapping and the file open, both handles can go as soon as it exists
+bool MappedFile::Open(const std::filesystem::path& path)
+{
+	Close();
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER size;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && static_cast<uint64_t>(size.QuadPart) <= SIZE_MAX)
+	{
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	CloseHandle(file);
+	if (!mapping)
+	{
+		return false;
+	}
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view)
+	{
+		return false;
+	}
+	Data = static_cast<const uint8_t*>(view);
+	Size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (Data)
+	{
+		UnmapViewOfFile(Data);
+	}
+	Data = nullptr;
+	Size = 0;
+}
+
+#else
+
+// The mapping holds its own reference to the file, the descriptor is closed right away
+bool MappedFile::Open(const std::filesystem::path& path)
+{
+	Close();
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+	struct stat status;
+	void* view = MAP_FAILED;
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+	{
+		view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	close(file);
+	if (view == MAP_FAILED)
+	{
+		return false;
+	}
+	Data = static_cast<const uint8_t*>(view);
+	Size = static_cast<size_t>(status.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (Data)
+	{
+		munmap(const_cast<uint8_t*>(Data), Size);
+	}
+	Data = nullptr;
+	Size = 0;
+}
+
+#endif
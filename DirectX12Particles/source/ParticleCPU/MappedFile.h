@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Read only view of a whole file, mmap on POSIX and a file mapping on Windows. Pages are read in from the page cache the first time
+// they are touched, so parsing a header costs a page and the rest is only read by whoever copies it out.
+class MappedFile
+{
+public:
+
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Maps path, closing whatever was mapped before. Empty files fail, there is nothing to map.
+	bool Open(const std::filesystem::path& path);
+	void Close();
+
+	const uint8_t* GetData() const { return Data; }
+	size_t GetSize() const { return Size; }
+
+private:
+
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+};
@@ -0,0 +1,415 @@
+#include "ParticleAtlas.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+
+static const uint ParticleAtlasMagic = 0x4c544150; // "PATL"
+static const uint ParticleAtlasVersion = 1;
+
+struct ParticleAtlasTableHeader
+{
+	uint Magic;
+	uint Version;
+	uint Count;
+	uint EntrySize; // sizeof(ParticleAtlasEntry), catches tables from a build with a different layout
+};
+
+SkylinePacker::SkylinePacker(uint size)
+	: Size(size)
+{
+	Skyline.push_back({ 0, 0, size });
+}
+
+bool SkylinePacker::Insert(uint width, uint height, uint& x, uint& y)
+{
+	size_t best = Skyline.size();
+	uint bestY = Size;
+	for (size_t n = 0; n < Skyline.size() && width <= Size - Skyline[n].X; ++n)
+	{
+		// The rect rests on the lowest point of the skyline under it
+		const uint right = Skyline[n].X + width;
+		uint top = 0;
+		for (size_t covered = n; covered < Skyline.size() && Skyline[covered].X < right; ++covered)
+		{
+			top = (std::max)(top, Skyline[covered].Y);
+		}
+		if (height <= Size - top && top < bestY)
+		{
+			best = n;
+			bestY = top;
+		}
+	}
+	if (best == Skyline.size())
+	{
+		return false;
+	}
+	x = Skyline[best].X;
+	y = bestY;
+
+	// The rect's bottom edge replaces the segments it covers, one it covers in part keeps the rest
+	const uint right = x + width;
+	size_t end = best;
+	while (end < Skyline.size() && Skyline[end].X + Skyline[end].Width <= right)
+	{
+		++end;
+	}
+	if (end < Skyline.size() && Skyline[end].X < right)
+	{
+		Skyline[end].Width -= right - Skyline[end].X;
+		Skyline[end].X = right;
+	}
+	Skyline.erase(Skyline.begin() + best, Skyline.begin() + end);
+	Skyline.insert(Skyline.begin() + best, { x, y + height, width });
+
+	if (best + 1 < Skyline.size() && Skyline[best + 1].Y == Skyline[best].Y)
+	{
+		Skyline[best].Width += Skyline[best + 1].Width;
+		Skyline.erase(Skyline.begin() + best + 1);
+	}
+	if (best > 0 && Skyline[best - 1].Y == Skyline[best].Y)
+	{
+		Skyline[best - 1].Width += Skyline[best].Width;
+		Skyline.erase(Skyline.begin() + best);
+	}
+	return true;
+}
+
+// Packs the rects in order into at most maxSlices slices of size, each rect into the first slice with room
+static bool PackSlices(const uint2* sizes, const std::vector<uint>& order, uint size, uint maxSlices, uint& sliceCount, std::vector<AtlasPlacement>& placements)
+{
+	std::vector<SkylinePacker> slices;
+	for (uint index : order)
+	{
+		AtlasPlacement& placement = placements[index];
+		uint slice = 0;
+		while (slice < slices.size() && !slices[slice].Insert(sizes[index].x, sizes[index].y, placement.X, placement.Y))
+		{
+			++slice;
+		}
+		if (slice == slices.size())
+		{
+			if (slices.size() == maxSlices)
+			{
+				return false;
+			}
+			slices.emplace_back(size);
+			if (!slices.back().Insert(sizes[index].x, sizes[index].y, placement.X, placement.Y))
+			{
+				return false;
+			}
+		}
+		placement.Slice = slice;
+	}
+	sliceCount = static_cast<uint>(slices.size());
+	return true;
+}
+
+bool PackAtlas(const uint2* sizes, uint count, uint minSize, uint maxSize, uint& size, uint& sliceCount, std::vector<AtlasPlacement>& placements)
+{
+	placements.assign(count, AtlasPlacement{});
+	std::vector<uint> order(count);
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [sizes](uint a, uint b)
+	{
+		return sizes[a].y != sizes[b].y ? sizes[a].y > sizes[b].y : sizes[a].x > sizes[b].x;
+	});
+
+	uint64_t area = 0;
+	uint largest = minSize;
+	for (uint n = 0; n < count; ++n)
+	{
+		if (sizes[n].x > maxSize || sizes[n].y > maxSize)
+		{
+			return false;
+		}
+		area += static_cast<uint64_t>(sizes[n].x) * sizes[n].y;
+		largest = (std::max)(largest, (std::max)(sizes[n].x, sizes[n].y));
+	}
+
+	// Slices smaller than the largest rect or the total area can't work, the first one that might is where the search starts
+	size = 1;
+	while (size < maxSize && (size < largest || static_cast<uint64_t>(size) * size < area))
+	{
+		size *= 2;
+	}
+	for (; size < maxSize; size *= 2)
+	{
+		if (PackSlices(sizes, order, size, 1, sliceCount, placements))
+		{
+			return true;
+		}
+	}
+	size = maxSize;
+	return PackSlices(sizes, order, size, UINT32_MAX, sliceCount, placements);
+}
+
+bool BuildParticleAtlas(const ParticleAtlasSource* sources, uint count, std::vector<uint8_t>& dds, std::vector<ParticleAtlasEntry>& entries, std::string& error)
+{
+	error.clear();
+	dds.clear();
+	entries.clear();
+	if (count == 0)
+	{
+		error = "no sources";
+		return false;
+	}
+
+	const uint32_t format = sources[0].Texture->Format;
+	uint mipCount = PARTICLE_ATLAS_MAX_MIPS;
+	for (uint n = 0; n < count; ++n)
+	{
+		const ParticleAtlasSource& source = sources[n];
+		const DDSTexture& texture = *source.Texture;
+		if (texture.Dimension != DDS_DIMENSION_TEXTURE2D || texture.ArraySize != 1 || texture.Format != format)
+		{
+			error = source.Name + " isn't a 2D texture in the format of " + sources[0].Name;
+			return false;
+		}
+		if (source.Name.empty() || source.Name.size() >= PARTICLE_ATLAS_NAME_LENGTH || source.Columns == 0 || source.Rows == 0 ||
+			source.FrameCount == 0 || source.FrameCount > source.Columns * source.Rows)
+		{
+			error = "bad name or flipbook grid of " + source.Name;
+			return false;
+		}
+		mipCount = (std::min)(mipCount, texture.MipCount);
+	}
+
+	// Padding every rect to whole blocks of the coarsest mip puts every mip of every source at a whole block offset
+	const uint blockSize = IsDDSBlockCompressed(format) ? 4 : 1;
+	const uint alignment = blockSize << (mipCount - 1);
+	std::vector<uint2> sizes(count);
+	for (uint n = 0; n < count; ++n)
+	{
+		sizes[n] = uint2((sources[n].Texture->Width + alignment - 1) / alignment * alignment, (sources[n].Texture->Height + alignment - 1) / alignment * alignment);
+	}
+	uint size;
+	uint sliceCount;
+	std::vector<AtlasPlacement> placements;
+	if (!PackAtlas(sizes.data(), count, alignment, PARTICLE_ATLAS_MAX_SIZE, size, sliceCount, placements))
+	{
+		const uint n = static_cast<uint>(std::find_if(sizes.begin(), sizes.end(), [](const uint2& s) { return (std::max)(s.x, s.y) > PARTICLE_ATLAS_MAX_SIZE; }) - sizes.begin());
+		error = (n < count ? sources[n].Name : sources[0].Name) + " is larger than an atlas slice";
+		return false;
+	}
+
+	// Offsets of every subresource in D3D12 order, the padding and the space between rects stay zero
+	WriteDDSHeader(format, size, size, sliceCount, mipCount, dds);
+	std::vector<size_t> offsets;
+	std::vector<size_t> rowPitches;
+	size_t fileSize = dds.size();
+	for (uint slice = 0; slice < sliceCount; ++slice)
+	{
+		for (uint mip = 0; mip < mipCount; ++mip)
+		{
+			size_t rowPitch;
+			offsets.push_back(fileSize);
+			fileSize += GetDDSSurfaceSize(format, size >> mip, size >> mip, &rowPitch);
+			rowPitches.push_back(rowPitch);
+		}
+	}
+	dds.resize(fileSize, 0);
+
+	size_t blockBytes;
+	GetDDSSurfaceSize(format, blockSize, blockSize, &blockBytes);
+	for (uint n = 0; n < count; ++n)
+	{
+		const ParticleAtlasSource& source = sources[n];
+		const DDSTexture& texture = *source.Texture;
+		const AtlasPlacement& placement = placements[n];
+		for (uint mip = 0; mip < mipCount; ++mip)
+		{
+			const DDSSubresource& subresource = texture.Subresources[mip];
+			size_t rowBytes;
+			uint32_t rowCount;
+			GetDDSSurfaceSize(format, (std::max)(texture.Width >> mip, 1u), (std::max)(texture.Height >> mip, 1u), &rowBytes, &rowCount);
+
+			const size_t subresourceIndex = static_cast<size_t>(placement.Slice) * mipCount + mip;
+			uint8_t* destination = dds.data() + offsets[subresourceIndex] + static_cast<size_t>((placement.Y >> mip) / blockSize) * rowPitches[subresourceIndex] +
+				static_cast<size_t>((placement.X >> mip) / blockSize) * blockBytes;
+			const uint8_t* bits = static_cast<const uint8_t*>(subresource.Data);
+			for (uint32_t row = 0; row < rowCount; ++row)
+			{
+				memcpy(destination + row * rowPitches[subresourceIndex], bits + row * subresource.RowPitch, rowBytes);
+			}
+		}
+
+		ParticleAtlasEntry entry = {};
+		memcpy(entry.Name, source.Name.data(), source.Name.size());
+		entry.Rect = float4(static_cast<float>(placement.X) / size, static_cast<float>(placement.Y) / size,
+			static_cast<float>(placement.X + texture.Width) / size, static_cast<float>(placement.Y + texture.Height) / size);
+		entry.Slice = placement.Slice;
+		entry.Columns = source.Columns;
+		entry.Rows = source.Rows;
+		entry.FrameCount = source.FrameCount;
+		entries.push_back(entry);
+	}
+	return true;
+}
+
+bool SaveParticleAtlasTable(const std::filesystem::path& path, const std::vector<ParticleAtlasEntry>& entries)
+{
+	const ParticleAtlasTableHeader header = { ParticleAtlasMagic, ParticleAtlasVersion, static_cast<uint>(entries.size()), sizeof(ParticleAtlasEntry) };
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries.data()), sizeof(ParticleAtlasEntry) * entries.size());
+	return static_cast<bool>(file);
+}
+
+bool LoadParticleAtlasTable(const std::filesystem::path& path, std::vector<ParticleAtlasEntry>& entries)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	ParticleAtlasTableHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.Magic != ParticleAtlasMagic || header.Version != ParticleAtlasVersion ||
+		header.EntrySize != sizeof(ParticleAtlasEntry))
+	{
+		return false;
+	}
+	entries.resize(header.Count);
+	if (!file.read(reinterpret_cast<char*>(entries.data()), sizeof(ParticleAtlasEntry) * entries.size()))
+	{
+		entries.clear();
+		return false;
+	}
+	for (const ParticleAtlasEntry& entry : entries)
+	{
+		if (entry.Name[PARTICLE_ATLAS_NAME_LENGTH - 1] != 0 || entry.Columns == 0 || entry.Rows == 0 || entry.FrameCount == 0 ||
+			entry.FrameCount > entry.Columns * entry.Rows)
+		{
+			entries.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+void ParseParticleAtlasName(const std::filesystem::path& path, std::string& name, uint& columns, uint& rows)
+{
+	name = path.stem().string();
+	columns = 1;
+	rows = 1;
+
+	const size_t separator = name.find_last_of('_');
+	if (separator == std::string::npos)
+	{
+		return;
+	}
+	const char* grid = name.c_str() + separator + 1;
+	char* end;
+	const unsigned long gridColumns = strtoul(grid, &end, 10);
+	if (end == grid || *end != 'x')
+	{
+		return;
+	}
+	const char* rowText = end + 1;
+	const unsigned long gridRows = strtoul(rowText, &end, 10);
+	if (end == rowText || *end != 0 || gridColumns == 0 || gridRows == 0 || gridColumns * gridRows > 4096)
+	{
+		return;
+	}
+	columns = static_cast<uint>(gridColumns);
+	rows = static_cast<uint>(gridRows);
+	name.resize(separator);
+}
+
+bool UpdateParticleAtlas(const std::vector<std::filesystem::path>& sourcePaths, const std::filesystem::path& ddsPath, const std::filesystem::path& tablePath,
+	std::vector<ParticleAtlasEntry>& entries, std::string& error)
+{
+	error.clear();
+	std::vector<ParticleAtlasSource> sources(sourcePaths.size());
+	for (size_t n = 0; n < sourcePaths.size(); ++n)
+	{
+		ParseParticleAtlasName(sourcePaths[n], sources[n].Name, sources[n].Columns, sources[n].Rows);
+		sources[n].FrameCount = sources[n].Columns * sources[n].Rows;
+	}
+
+	// The built atlas stays when it is newer than every source and holds the same names in the same order
+	std::error_code code;
+	const std::filesystem::file_time_type ddsWriteTime = std::filesystem::last_write_time(ddsPath, code);
+	bool stale = static_cast<bool>(code);
+	const std::filesystem::file_time_type tableWriteTime = std::filesystem::last_write_time(tablePath, code);
+	stale = stale || code;
+	for (size_t n = 0; n < sourcePaths.size() && !stale; ++n)
+	{
+		const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(sourcePaths[n], code);
+		stale = code || writeTime > ddsWriteTime || writeTime > tableWriteTime;
+	}
+	if (!stale && LoadParticleAtlasTable(tablePath, entries) && entries.size() == sources.size())
+	{
+		size_t n = 0;
+		while (n < sources.size() && sources[n].Name == entries[n].Name)
+		{
+			++n;
+		}
+		if (n == sources.size())
+		{
+			return true;
+		}
+	}
+
+	std::vector<MappedFile> files(sourcePaths.size());
+	std::vector<DDSTexture> textures(sourcePaths.size());
+	for (size_t n = 0; n < sourcePaths.size(); ++n)
+	{
+		if (!files[n].Open(sourcePaths[n]) || !ParseDDS(files[n].GetData(), files[n].GetSize(), textures[n]))
+		{
+			error = "can't read " + sourcePaths[n].filename().string();
+			return false;
+		}
+		sources[n].Texture = &textures[n];
+	}
+	std::vector<uint8_t> dds;
+	if (!BuildParticleAtlas(sources.data(), static_cast<uint>(sources.size()), dds, entries, error))
+	{
+		return false;
+	}
+
+	std::ofstream file(ddsPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(dds.data()), dds.size());
+	file.close();
+	if (!file || !SaveParticleAtlasTable(tablePath, entries))
+	{
+		error = "can't write " + ddsPath.filename().string();
+		return false;
+	}
+	return true;
+}
+
+size_t FindParticleAtlasEntry(const std::vector<ParticleAtlasEntry>& entries, std::string_view name)
+{
+	for (size_t n = 0; n < entries.size(); ++n)
+	{
+		if (name == std::string_view(entries[n].Name))
+		{
+			return n;
+		}
+	}
+	return entries.size();
+}
+
+ParticleAtlasEntry MakeParticleAtlasEntry(const char* name)
+{
+	ParticleAtlasEntry entry = {};
+	memcpy(entry.Name, name, strnlen(name, PARTICLE_ATLAS_NAME_LENGTH - 1));
+	entry.Rect = float4(0, 0, 1, 1);
+	entry.Columns = 1;
+	entry.Rows = 1;
+	entry.FrameCount = 1;
+	return entry;
+}
+
+ParticleAtlasConstants MakeParticleAtlasConstants(const ParticleAtlasEntry& entry, float lifetime)
+{
+	ParticleAtlasConstants constants = {};
+	constants.Rect = entry.Rect;
+	constants.Slice = entry.Slice;
+	constants.Columns = entry.Columns;
+	constants.Rows = entry.Rows;
+	constants.FrameCount = entry.FrameCount;
+	constants.Lifetime = lifetime;
+	return constants;
+}
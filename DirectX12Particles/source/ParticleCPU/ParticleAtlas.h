@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../ParticleGame/ParticleAtlas.hlsli"
+#include "DDSFile.h"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Particle textures and flipbook sheets packed into the slices of one texture array. The sources share a format and their blocks are
+// copied as they are, BC data is never decoded. Every rect is padded to a multiple of 4 << (mips - 1) texels so each atlas mip holds
+// the sources' mips at whole block offsets, which caps the atlas at PARTICLE_ATLAS_MAX_MIPS mips and the coarsest mip every source has.
+// Packing only depends on the sources' sizes and order, the same sources always give the same bytes.
+#define PARTICLE_ATLAS_MAX_MIPS 4
+#define PARTICLE_ATLAS_MAX_SIZE 4096
+
+struct AtlasPlacement
+{
+	uint Slice;
+	uint X;
+	uint Y;
+};
+
+// Skyline packer over one square slice, rects go as close to the slice's top edge as they fit and the skyline is the
+// bottom edge of what was placed so far
+class SkylinePacker
+{
+public:
+
+	explicit SkylinePacker(uint size);
+
+	// Places the rect at the smallest y it fits at, the leftmost of those. Fails when it fits nowhere.
+	bool Insert(uint width, uint height, uint& x, uint& y);
+
+private:
+
+	struct Segment
+	{
+		uint X;
+		uint Y;
+		uint Width;
+	};
+
+	uint Size;
+	std::vector<Segment> Skyline; // Left to right, covers [0, Size)
+};
+
+// Packs the rects tallest first, then widest, then in the order given, into the smallest power of two slice from
+// minSize up that holds all of them. Past maxSize they spill into more maxSize slices, each rect into the first slice
+// with room. Fails when a rect is larger than maxSize.
+bool PackAtlas(const uint2* sizes, uint count, uint minSize, uint maxSize, uint& size, uint& sliceCount, std::vector<AtlasPlacement>& placements);
+
+// One texture of the atlas, a flipbook when it has more than one frame
+struct ParticleAtlasSource
+{
+	std::string Name;
+	const DDSTexture* Texture;
+	uint Columns;
+	uint Rows;
+	uint FrameCount;
+};
+
+// A source's place in the atlas, named like the source. The table file is a header followed by these.
+struct ParticleAtlasEntry
+{
+	char Name[PARTICLE_ATLAS_NAME_LENGTH]; // Zero padded, at most PARTICLE_ATLAS_NAME_LENGTH - 1 characters
+	float4 Rect; // uMin, vMin, uMax, vMax of the source's texels, without the padding
+	uint Slice;
+	uint Columns;
+	uint Rows;
+	uint FrameCount;
+};
+
+// Packs sources, 2D textures without array slices all in one format, into the DDS file image dds and one entry per source in the same order.
+// On failure error names the source that didn't fit in.
+bool BuildParticleAtlas(const ParticleAtlasSource* sources, uint count, std::vector<uint8_t>& dds, std::vector<ParticleAtlasEntry>& entries, std::string& error);
+
+bool SaveParticleAtlasTable(const std::filesystem::path& path, const std::vector<ParticleAtlasEntry>& entries);
+bool LoadParticleAtlasTable(const std::filesystem::path& path, std::vector<ParticleAtlasEntry>& entries);
+
+// A source's name and grid from its file name, "Smoke_8x4.dds" is an 8 by 4 flipbook called Smoke and "Spark.dds" a still texture called Spark
+void ParseParticleAtlasName(const std::filesystem::path& path, std::string& name, uint& columns, uint& rows);
+
+// Builds ddsPath and tablePath from the source files when either is missing or older than a source, then loads the table.
+// Sources are named by ParseParticleAtlasName and keep the order given.
+bool UpdateParticleAtlas(const std::vector<std::filesystem::path>& sourcePaths, const std::filesystem::path& ddsPath, const std::filesystem::path& tablePath,
+	std::vector<ParticleAtlasEntry>& entries, std::string& error);
+
+// Index of the entry called name, or entries.size() if there is none
+size_t FindParticleAtlasEntry(const std::vector<ParticleAtlasEntry>& entries, std::string_view name);
+
+// One frame over the whole of slice 0, for a single texture streamed without an atlas
+ParticleAtlasEntry MakeParticleAtlasEntry(const char* name);
+
+ParticleAtlasConstants MakeParticleAtlasConstants(const ParticleAtlasEntry& entry, float lifetime);
@@ -0,0 +1,85 @@
+#include "ParticleCurves.h"
+
+template<typename Key, typename Value>
+static Value EvaluateKeys(const std::vector<Key>& keys, float age, Value defaultValue, Value Key::* member)
+{
+	if (keys.empty())
+	{
+		return defaultValue;
+	}
+	if (age <= keys.front().Age)
+	{
+		return keys.front().*member;
+	}
+
+	// Curves have a handful of keys, a linear walk beats a binary search
+	for (size_t n = 1; n < keys.size(); ++n)
+	{
+		if (age <= keys[n].Age)
+		{
+			const Key& a = keys[n - 1];
+			const Key& b = keys[n];
+			const float span = b.Age - a.Age;
+			return span > 0.0f ? lerp(a.*member, b.*member, (age - a.Age) / span) : b.*member;
+		}
+	}
+	return keys.back().*member;
+}
+
+float EvaluateCurve(const std::vector<CurveKey>& keys, float age, float defaultValue)
+{
+	return EvaluateKeys(keys, age, defaultValue, &CurveKey::Value);
+}
+
+float3 EvaluateGradient(const std::vector<GradientKey>& keys, float age, float3 defaultColor)
+{
+	return EvaluateKeys(keys, age, defaultColor, &GradientKey::Color);
+}
+
+ParticleCurveSample EvaluateParticleCurves(const ParticleCurves& curves, float age)
+{
+	const float3 color = EvaluateGradient(curves.Color, age, float3(1, 1, 1));
+
+	ParticleCurveSample sample;
+	sample.Color = float4(color.x, color.y, color.z, EvaluateCurve(curves.Alpha, age, 1.0f));
+	sample.Scale = EvaluateCurve(curves.Scale, age, 1.0f);
+	sample.Drag = EvaluateCurve(curves.Drag, age, 0.0f);
+	sample.Rotation = EvaluateCurve(curves.Rotation, age, 0.0f);
+	return sample;
+}
+
+CurveAtlas BakeCurveAtlas(const std::vector<ParticleCurves>& curveSets)
+{
+	CurveAtlas atlas;
+	atlas.SliceCount = static_cast<uint>(curveSets.size()) * CURVE_ATLAS_SLICES;
+	atlas.Texels.resize(static_cast<size_t>(atlas.SliceCount) * CURVE_ATLAS_WIDTH);
+
+	for (uint set = 0; set < curveSets.size(); ++set)
+	{
+		float4* colorSlice = &atlas.Texels[static_cast<size_t>(CurveAtlasSlice(set, CURVE_ATLAS_COLOR_SLICE)) * CURVE_ATLAS_WIDTH];
+		float4* motionSlice = &atlas.Texels[static_cast<size_t>(CurveAtlasSlice(set, CURVE_ATLAS_MOTION_SLICE)) * CURVE_ATLAS_WIDTH];
+		for (uint texel = 0; texel < CURVE_ATLAS_WIDTH; ++texel)
+		{
+			// Texel centers sit at the ages CurveAtlasU maps to them
+			const ParticleCurveSample sample = EvaluateParticleCurves(curveSets[set], texel / static_cast<float>(CURVE_ATLAS_WIDTH - 1));
+			colorSlice[texel] = sample.Color;
+			motionSlice[texel] = float4(sample.Scale, sample.Drag, sample.Rotation, 0.0f);
+		}
+	}
+	return atlas;
+}
+
+static float4 SampleCurveSlice(const CurveAtlas& atlas, uint slice, float u)
+{
+	const float4* texels = &atlas.Texels[static_cast<size_t>(slice) * CURVE_ATLAS_WIDTH];
+	const float x = clamp(u * CURVE_ATLAS_WIDTH - 0.5f, 0.0f, static_cast<float>(CURVE_ATLAS_WIDTH - 1));
+	const uint x0 = (min)(static_cast<uint>(x), static_cast<uint>(CURVE_ATLAS_WIDTH - 2));
+	return lerp(texels[x0], texels[x0 + 1], x - x0);
+}
+
+ParticleCurveSample SampleCurveAtlas(const CurveAtlas& atlas, uint curveSet, float age)
+{
+	const float u = CurveAtlasU(age);
+	return MakeParticleCurveSample(SampleCurveSlice(atlas, static_cast<uint>(CurveAtlasSlice(curveSet, CURVE_ATLAS_COLOR_SLICE)), u),
+		SampleCurveSlice(atlas, static_cast<uint>(CurveAtlasSlice(curveSet, CURVE_ATLAS_MOTION_SLICE)), u));
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../ParticleGame/ParticleCurves.hlsli"
+
+#include <vector>
+
+// One key of a float curve over normalized particle age
+struct CurveKey
+{
+	float Age;
+	float Value;
+};
+
+// One key of a color gradient over normalized particle age
+struct GradientKey
+{
+	float Age;
+	float3 Color;
+};
+
+// Over-lifetime curves of one emitter. Keys are sorted by age, values are held flat before the first and after the last key.
+// An empty curve evaluates to its neutral value: white, opaque, scale 1, no drag, no rotation.
+struct ParticleCurves
+{
+	std::vector<GradientKey> Color;
+	std::vector<CurveKey> Alpha;
+	std::vector<CurveKey> Scale;
+	std::vector<CurveKey> Drag;
+	std::vector<CurveKey> Rotation;
+};
+
+// Piecewise linear, defaultValue when there are no keys
+float EvaluateCurve(const std::vector<CurveKey>& keys, float age, float defaultValue);
+float3 EvaluateGradient(const std::vector<GradientKey>& keys, float age, float3 defaultColor);
+
+// Exact curve values at age, what the atlas approximates
+ParticleCurveSample EvaluateParticleCurves(const ParticleCurves& curves, float age);
+
+// CURVE_ATLAS_SLICES slices of CURVE_ATLAS_WIDTH texels per curve set, laid out like the subresources of a Texture1DArray
+struct CurveAtlas
+{
+	uint SliceCount = 0;
+	std::vector<float4> Texels;
+
+	bool Empty() const { return Texels.empty(); }
+};
+
+// Curve set n of the atlas is curveSets[n], EmitterConstants.curveSet picks one
+CurveAtlas BakeCurveAtlas(const std::vector<ParticleCurves>& curveSets);
+
+// CPU version of the two SampleLevel calls in ComputeSimulator.hlsl, linear clamp filtering along the age axis
+ParticleCurveSample SampleCurveAtlas(const CurveAtlas& atlas, uint curveSet, float age);
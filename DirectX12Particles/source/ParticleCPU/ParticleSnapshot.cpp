@@ -0,0 +1,145 @@
+#include "ParticleSnapshot.h"
+#include "LZ4.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+static const uint ParticleSnapshotMagic = 0x50414e53; // "SNAP"
+static const uint ParticleSnapshotVersion = 1;
+
+// Everything but the counts and the compression, which differ between snapshots of the same pool
+static bool CheckSnapshotHeader(const ParticleSnapshotHeader& header)
+{
+	return header.Magic == ParticleSnapshotMagic && header.Version == ParticleSnapshotVersion && header.ParticleSize == sizeof(Particle) &&
+		header.AliveCount <= header.Capacity && header.DeadCount <= header.Capacity;
+}
+
+ParticleSnapshotLayout GetParticleSnapshotLayout(uint capacity)
+{
+	ParticleSnapshotLayout layout;
+	layout.Particles = sizeof(ParticleSnapshotHeader);
+	layout.AliveIndices = layout.Particles + sizeof(Particle) * static_cast<size_t>(capacity);
+	layout.DeadIndices = layout.AliveIndices + sizeof(uint) * static_cast<size_t>(capacity);
+	layout.Size = layout.DeadIndices + sizeof(uint) * static_cast<size_t>(capacity);
+	return layout;
+}
+
+ParticleSnapshotHeader MakeParticleSnapshotHeader(uint capacity, uint aliveCount, uint deadCount)
+{
+	ParticleSnapshotHeader header = {};
+	header.Magic = ParticleSnapshotMagic;
+	header.Version = ParticleSnapshotVersion;
+	header.Capacity = capacity;
+	header.ParticleSize = sizeof(Particle);
+	header.AliveCount = aliveCount;
+	header.DeadCount = deadCount;
+	header.Compression = PARTICLE_SNAPSHOT_COMPRESSION_NONE;
+	header.StoredSize = static_cast<uint>(GetParticleSnapshotLayout(capacity).Size - sizeof(ParticleSnapshotHeader));
+	return header;
+}
+
+void WriteParticleSnapshotImage(void* image, uint capacity, const Particle* particles, const uint* aliveIndices, uint aliveCount,
+	const uint* deadIndices, uint deadCount)
+{
+	const ParticleSnapshotLayout layout = GetParticleSnapshotLayout(capacity);
+	uint8_t* bytes = static_cast<uint8_t*>(image);
+	const ParticleSnapshotHeader header = MakeParticleSnapshotHeader(capacity, aliveCount, deadCount);
+	memcpy(bytes, &header, sizeof(header));
+	memcpy(bytes + layout.Particles, particles, sizeof(Particle) * static_cast<size_t>(capacity));
+
+	memcpy(bytes + layout.AliveIndices, aliveIndices, sizeof(uint) * static_cast<size_t>(aliveCount));
+	memset(bytes + layout.AliveIndices + sizeof(uint) * aliveCount, 0, sizeof(uint) * static_cast<size_t>(capacity - aliveCount));
+	memcpy(bytes + layout.DeadIndices, deadIndices, sizeof(uint) * static_cast<size_t>(deadCount));
+	memset(bytes + layout.DeadIndices + sizeof(uint) * deadCount, 0, sizeof(uint) * static_cast<size_t>(capacity - deadCount));
+}
+
+bool ParseParticleSnapshot(const void* image, size_t size, ParticleSnapshotView& view)
+{
+	if (size < sizeof(ParticleSnapshotHeader) || reinterpret_cast<uintptr_t>(image) % alignof(Particle) != 0)
+	{
+		return false;
+	}
+	const ParticleSnapshotHeader* header = static_cast<const ParticleSnapshotHeader*>(image);
+	const ParticleSnapshotLayout layout = GetParticleSnapshotLayout(header->Capacity);
+	if (!CheckSnapshotHeader(*header) || header->Compression != PARTICLE_SNAPSHOT_COMPRESSION_NONE || size < layout.Size)
+	{
+		return false;
+	}
+	const uint8_t* bytes = static_cast<const uint8_t*>(image);
+	view.Header = header;
+	view.Particles = reinterpret_cast<const Particle*>(bytes + layout.Particles);
+	view.AliveIndices = reinterpret_cast<const uint*>(bytes + layout.AliveIndices);
+	view.DeadIndices = reinterpret_cast<const uint*>(bytes + layout.DeadIndices);
+	return true;
+}
+
+bool SaveParticleSnapshot(const std::filesystem::path& path, const void* image, size_t size, bool compress)
+{
+	ParticleSnapshotView view;
+	if (!ParseParticleSnapshot(image, size, view))
+	{
+		return false;
+	}
+	const size_t payloadSize = GetParticleSnapshotLayout(view.Header->Capacity).Size - sizeof(ParticleSnapshotHeader);
+	const uint8_t* payload = static_cast<const uint8_t*>(image) + sizeof(ParticleSnapshotHeader);
+
+	ParticleSnapshotHeader header = *view.Header;
+	std::vector<uint8_t> block;
+	if (compress)
+	{
+		block.resize(LZ4CompressBound(payloadSize));
+		const size_t blockSize = LZ4CompressBlock(payload, payloadSize, block.data(), block.size());
+		if (blockSize > 0 && blockSize < payloadSize)
+		{
+			block.resize(blockSize);
+			header.Compression = PARTICLE_SNAPSHOT_COMPRESSION_LZ4;
+			header.StoredSize = static_cast<uint>(blockSize);
+			payload = block.data();
+		}
+	}
+
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(payload), header.StoredSize);
+	return static_cast<bool>(file);
+}
+
+bool LoadParticleSnapshot(const std::filesystem::path& path, void* image, uint capacity)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	ParticleSnapshotHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !CheckSnapshotHeader(header) || header.Capacity != capacity)
+	{
+		return false;
+	}
+
+	const ParticleSnapshotLayout layout = GetParticleSnapshotLayout(capacity);
+	const size_t payloadSize = layout.Size - sizeof(ParticleSnapshotHeader);
+	uint8_t* payload = static_cast<uint8_t*>(image) + sizeof(ParticleSnapshotHeader);
+	if (header.Compression == PARTICLE_SNAPSHOT_COMPRESSION_NONE)
+	{
+		if (header.StoredSize != payloadSize || !file.read(reinterpret_cast<char*>(payload), payloadSize))
+		{
+			return false;
+		}
+	}
+	else if (header.Compression == PARTICLE_SNAPSHOT_COMPRESSION_LZ4)
+	{
+		std::vector<uint8_t> block(header.StoredSize);
+		if (!file.read(reinterpret_cast<char*>(block.data()), block.size()) || !LZ4DecompressBlock(block.data(), block.size(), payload, payloadSize))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	// The image is uncompressed whatever the file was
+	header.Compression = PARTICLE_SNAPSHOT_COMPRESSION_NONE;
+	header.StoredSize = static_cast<uint>(payloadSize);
+	memcpy(image, &header, sizeof(header));
+	return true;
+}
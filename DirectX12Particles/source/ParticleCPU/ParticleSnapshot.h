@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../ParticleGame/Particle.hlsli"
+
+#include <filesystem>
+
+// Pool state between two steps: every particle slot, the alive list the next emit appends to and the dead list it consumes from the back of.
+// An image is the snapshot header followed by the three arrays at fixed offsets, sized for the whole pool so the layout only depends on
+// the capacity. The counts live in the header and the unused tails of the lists are zero.
+//
+// An uncompressed file is the image byte for byte, so it can be memory mapped and used in place, or read straight into an upload buffer
+// the GPU copies each section out of. A compressed file keeps the header as is and stores the arrays as one LZ4 block.
+#define PARTICLE_SNAPSHOT_COMPRESSION_NONE 0
+#define PARTICLE_SNAPSHOT_COMPRESSION_LZ4 1
+
+struct ParticleSnapshotHeader
+{
+	uint Magic;
+	uint Version;
+	uint Capacity; // Particle slots of the pool, the lists hold up to this many indices too
+	uint ParticleSize; // sizeof(Particle), catches snapshots from a build with a different layout
+	uint AliveCount; // The alive list counter
+	uint DeadCount; // The dead list counter
+	uint Compression;
+	uint StoredSize; // Bytes after the header in the file, the uncompressed size for images and uncompressed files
+};
+
+// Offsets of the sections from the start of an image
+struct ParticleSnapshotLayout
+{
+	size_t Particles;
+	size_t AliveIndices;
+	size_t DeadIndices;
+	size_t Size; // The whole image
+};
+
+// Points into an image, nothing is copied
+struct ParticleSnapshotView
+{
+	const ParticleSnapshotHeader* Header = nullptr;
+	const Particle* Particles = nullptr;
+	const uint* AliveIndices = nullptr;
+	const uint* DeadIndices = nullptr;
+};
+
+ParticleSnapshotLayout GetParticleSnapshotLayout(uint capacity);
+
+// Fills image, GetParticleSnapshotLayout(capacity).Size bytes, with an uncompressed snapshot of the given lists
+void WriteParticleSnapshotImage(void* image, uint capacity, const Particle* particles, const uint* aliveIndices, uint aliveCount,
+	const uint* deadIndices, uint deadCount);
+
+// Header for an image whose sections were written by someone else, like a GPU copy into a readback buffer
+ParticleSnapshotHeader MakeParticleSnapshotHeader(uint capacity, uint aliveCount, uint deadCount);
+
+// Validates the header, the counts and the size of an uncompressed image and points view at its sections
+bool ParseParticleSnapshot(const void* image, size_t size, ParticleSnapshotView& view);
+
+// Writes an image to path, compressed into one LZ4 block with compress. A block that doesn't come out smaller is stored uncompressed.
+bool SaveParticleSnapshot(const std::filesystem::path& path, const void* image, size_t size, bool compress);
+
+// Reads the snapshot at path into image, GetParticleSnapshotLayout(capacity).Size bytes. LZ4 blocks decompress straight into image.
+// Fails when the snapshot was taken of a pool with another capacity or doesn't parse.
+bool LoadParticleSnapshot(const std::filesystem::path& path, void* image, uint capacity);
@@ -0,0 +1,354 @@
+#include "ParticleSystemCPU.h"
+#include "RadixSort.h"
+
+#include <algorithm>
+
+ParticleSystemCPU::ParticleSystemCPU(uint maxParticleCount, ThreadPool& pool)
+	: Pool(pool)
+	, Particles(maxParticleCount)
+	, Hash(pool)
+	, FluidAccelerations(maxParticleCount)
+	, TrailHistory(static_cast<size_t>(maxParticleCount) * TRAIL_LENGTH)
+{
+	AliveIndices.reserve(maxParticleCount);
+	DeadIndices.resize(maxParticleCount);
+	for (uint n = 0; n < maxParticleCount; ++n)
+	{
+		DeadIndices[n] = n;
+	}
+}
+
+void ParticleSystemCPU::Update(const EmitterConstants& emitter, const CullConstants& cull, const SPHConstants& fluid, const SpatialHashConstants& hash,
+	const CollisionConstants& collision, const std::vector<ForceField>& forceFields, const CurlNoiseConstants& turbulence,
+	const VectorFieldConstants& vectorFields, uint trailHead, const SubEmitterConstants& subEmitter, bool sortByDepth)
+{
+	const uint eventMask = SubEmitterEventMask(subEmitter);
+	Emit(emitter);
+	if (fluid.Enabled)
+	{
+		ComputeFluid(fluid, hash);
+	}
+	Simulate(emitter, fluid.Enabled != 0, collision, forceFields, turbulence, vectorFields, trailHead, eventMask);
+	BuildDrawList(cull, sortByDepth);
+	if (eventMask)
+	{
+		SpawnSubEmitters(emitter, subEmitter);
+	}
+}
+
+void ParticleSystemCPU::Prewarm(const EmitterConstants& emitter, float seconds, float stepTime, float frameTime, const CollisionConstants& collision,
+	const std::vector<ForceField>& forceFields, const CurlNoiseConstants& turbulence, const VectorFieldConstants& vectorFields)
+{
+	EmitterConstants step = emitter;
+	step.deltaTime = stepTime;
+	const uint stepCount = static_cast<uint>(seconds / stepTime + 0.5f);
+	const float framesPerStep = stepTime / frameTime;
+	float emitDebt = 0.0f;
+	for (uint n = 0; n < stepCount; ++n)
+	{
+		// Fractional frames carry over, so steps that aren't a whole number of frames still emit at the frame rate
+		emitDebt += emitter.emitCount * framesPerStep;
+		step.emitCount = static_cast<uint>(emitDebt);
+		emitDebt -= step.emitCount;
+
+		const size_t firstEmitted = AliveIndices.size();
+		Emit(step);
+
+		// Particles born later in the step have lived less of it. The step takes a full stepTime off all of them,
+		// so the birth time is added on top of the lifetime. Integration still covers the whole step, a small error the big steps accept.
+		const size_t emitted = AliveIndices.size() - firstEmitted;
+		for (size_t e = 0; e < emitted; ++e)
+		{
+			Particles[AliveIndices[firstEmitted + e]].lifeTimeLeft += stepTime * (e + 0.5f) / emitted;
+		}
+
+		Simulate(step, false, collision, forceFields, turbulence, vectorFields, TRAIL_HEAD_NONE, 0);
+	}
+}
+
+void ParticleSystemCPU::SetCollisionScene(const std::vector<CollisionPlane>& planes, const std::vector<uint>& grid)
+{
+	CollisionPlanes = planes;
+	CollisionGrid = grid;
+}
+
+void ParticleSystemCPU::SetCurlNoise(const CurlNoiseVolume& volume)
+{
+	CurlNoise = volume;
+}
+
+void ParticleSystemCPU::SetVectorField(uint slot, const VectorFieldVolume* volume)
+{
+	VectorFieldVolumes[slot] = volume;
+}
+
+void ParticleSystemCPU::SetCurveAtlas(const CurveAtlas& atlas)
+{
+	Curves = atlas;
+}
+
+void ParticleSystemCPU::WriteSnapshot(void* image) const
+{
+	WriteParticleSnapshotImage(image, static_cast<uint>(Particles.size()), Particles.data(), AliveIndices.data(), static_cast<uint>(AliveIndices.size()),
+		DeadIndices.data(), static_cast<uint>(DeadIndices.size()));
+}
+
+bool ParticleSystemCPU::RestoreSnapshot(const ParticleSnapshotView& snapshot)
+{
+	const ParticleSnapshotHeader& header = *snapshot.Header;
+	if (header.Capacity != Particles.size())
+	{
+		return false;
+	}
+	for (uint n = 0; n < header.AliveCount; ++n)
+	{
+		if (snapshot.AliveIndices[n] >= header.Capacity)
+		{
+			return false;
+		}
+	}
+	for (uint n = 0; n < header.DeadCount; ++n)
+	{
+		if (snapshot.DeadIndices[n] >= header.Capacity)
+		{
+			return false;
+		}
+	}
+
+	Particles.assign(snapshot.Particles, snapshot.Particles + header.Capacity);
+	AliveIndices.assign(snapshot.AliveIndices, snapshot.AliveIndices + header.AliveCount);
+	DeadIndices.assign(snapshot.DeadIndices, snapshot.DeadIndices + header.DeadCount);
+	return true;
+}
+
+void ParticleSystemCPU::Emit(const EmitterConstants& emitter)
+{
+	const uint realEmitCount = (min)(static_cast<uint>(DeadIndices.size()), emitter.emitCount);
+	for (uint index = 0; index < realEmitCount; ++index)
+	{
+		const uint particleIndex = DeadIndices.back();
+		DeadIndices.pop_back();
+
+		Particles[particleIndex] = EmitParticle(index, particleIndex, realEmitCount, emitter);
+		AliveIndices.push_back(particleIndex);
+	}
+}
+
+// Density then forces, the same two passes as ComputeSPH.hlsl with a join in between.
+// Both passes walk the hash order, so consecutive particles mostly share neighbor cells.
+void ParticleSystemCPU::ComputeFluid(const SPHConstants& fluid, const SpatialHashConstants& hash)
+{
+	Hash.Build(Particles, AliveIndices, hash);
+
+	const std::vector<uint>& sortedIndices = Hash.GetSortedIndices();
+	const size_t count = sortedIndices.size();
+	FluidPositions.resize(count);
+	FluidVelocities.resize(count);
+	DensityPressure.resize(count);
+
+	Pool.ParallelFor(count, [&](size_t begin, size_t end, uint32_t)
+	{
+		for (size_t slot = begin; slot < end; ++slot)
+		{
+			const Particle& particle = Particles[sortedIndices[slot]];
+			FluidPositions[slot] = float3(particle.position.x, particle.position.y, particle.position.z);
+			FluidVelocities[slot] = float3(particle.velocity.x, particle.velocity.y, particle.velocity.z);
+		}
+	});
+
+	Pool.ParallelFor(count, [&](size_t begin, size_t end, uint32_t)
+	{
+		for (size_t slot = begin; slot < end; ++slot)
+		{
+			const float3 center = FluidPositions[slot];
+			float density = 0.0f;
+			Hash.ForEachNeighborSlot(center, [&](uint neighbor)
+			{
+				density += SPHDensityTerm(center - FluidPositions[neighbor], fluid);
+			});
+			DensityPressure[slot] = float2(density, SPHPressure(density, fluid));
+		}
+	});
+
+	Pool.ParallelFor(count, [&](size_t begin, size_t end, uint32_t)
+	{
+		for (size_t slot = begin; slot < end; ++slot)
+		{
+			const float3 center = FluidPositions[slot];
+			const float3 velocity = FluidVelocities[slot];
+			float3 forceDensity;
+			Hash.ForEachNeighborSlot(center, [&](uint neighbor)
+			{
+				forceDensity += SPHForceTerm(center - FluidPositions[neighbor], FluidVelocities[neighbor] - velocity,
+					DensityPressure[slot], DensityPressure[neighbor], fluid);
+			});
+			FluidAccelerations[sortedIndices[slot]] = SPHAcceleration(forceDensity, DensityPressure[slot].x, fluid);
+		}
+	});
+}
+
+void ParticleSystemCPU::Simulate(const EmitterConstants& emitter, bool applyFluid, const CollisionConstants& collision, const std::vector<ForceField>& forceFields,
+	const CurlNoiseConstants& turbulence, const VectorFieldConstants& vectorFields, uint trailHead, uint eventMask)
+{
+	const bool collide = collision.Enabled && !CollisionGrid.empty();
+	const bool turbulent = turbulence.Enabled && !CurlNoise.Empty();
+	const bool curved = emitter.curveSet != CURVE_SET_NONE && (emitter.curveSet + 1) * CURVE_ATLAS_SLICES <= Curves.SliceCount;
+	Pool.ParallelFor(AliveIndices.size(), [&](size_t begin, size_t end, uint32_t)
+	{
+		std::vector<uint> culledFields;
+		size_t blockEnd = begin;
+		for (size_t n = begin; n < end; ++n)
+		{
+			// Blocks of alive list entries stand in for the thread groups, each culls the fields once against its bounds
+			if (!forceFields.empty() && n == blockEnd)
+			{
+				blockEnd = (std::min)(n + FORCE_FIELD_BLOCK_SIZE, end);
+				float3 boundsMin(1e30f, 1e30f, 1e30f);
+				float3 boundsMax(-1e30f, -1e30f, -1e30f);
+				for (size_t b = n; b < blockEnd; ++b)
+				{
+					const float4& position = Particles[AliveIndices[b]].position;
+					boundsMin = (min)(boundsMin, float3(position.x, position.y, position.z));
+					boundsMax = (max)(boundsMax, float3(position.x, position.y, position.z));
+				}
+				culledFields.clear();
+				CullForceFields(forceFields, boundsMin, boundsMax, culledFields);
+			}
+
+			const uint particleIndex = AliveIndices[n];
+			Particle& particle = Particles[particleIndex];
+			if (applyFluid)
+			{
+				particle = ApplySPHAcceleration(particle, FluidAccelerations[particleIndex], emitter.deltaTime);
+			}
+			if (!culledFields.empty())
+			{
+				const float3 position(particle.position.x, particle.position.y, particle.position.z);
+				const float3 velocity(particle.velocity.x, particle.velocity.y, particle.velocity.z);
+				float3 acceleration;
+				for (uint field : culledFields)
+				{
+					acceleration += ForceFieldAcceleration(forceFields[field], position, velocity);
+				}
+				particle.velocity = float4(velocity + acceleration * emitter.deltaTime, particle.velocity.w);
+			}
+			if (turbulent)
+			{
+				const float3 position(particle.position.x, particle.position.y, particle.position.z);
+				const float3 curl = SampleCurlNoise(CurlNoise, CurlNoiseCoordinates(position, turbulence));
+				particle.velocity = float4(float3(particle.velocity.x, particle.velocity.y, particle.velocity.z) + curl * (turbulence.Strength * emitter.deltaTime), particle.velocity.w);
+			}
+			for (uint field = 0; field < vectorFields.Count && field < VECTOR_FIELD_MAX_COUNT; ++field)
+			{
+				const VectorFieldVolume* volume = VectorFieldVolumes[field];
+				const float3 uvw = VectorFieldCoordinates(float3(particle.position.x, particle.position.y, particle.position.z), vectorFields.Fields[field]);
+				if (volume && !volume->Empty() && VectorFieldInside(uvw))
+				{
+					const float3 velocity = VectorFieldApply(SampleVectorField(*volume, uvw), float3(particle.velocity.x, particle.velocity.y, particle.velocity.z),
+						vectorFields.Fields[field], emitter.deltaTime);
+					particle.velocity = float4(velocity, particle.velocity.w);
+				}
+			}
+			const float3 from(particle.position.x, particle.position.y, particle.position.z);
+			const bool spawned = particle.lifeTimeLeft >= emitter.particleLifetime;
+			particle = SimulateParticle(particle, emitter);
+			if (curved)
+			{
+				particle = ApplyParticleCurves(particle, SampleCurveAtlas(Curves, emitter.curveSet, ParticleAge(particle, emitter)), emitter.deltaTime);
+			}
+			const Particle beforeCollision = particle;
+			if (collide)
+			{
+				uint hitPlane = 0;
+				const float3 to(particle.position.x, particle.position.y, particle.position.z);
+				const float t = FindCollision(CollisionPlanes, CollisionGrid, collision, from, to, particle.scale * collision.RadiusScale, hitPlane);
+				if (t <= 1.0f)
+				{
+					particle = CollisionResponse(particle, CollisionPlaneNormal(CollisionPlanes[hitPlane]), from, t, collision);
+				}
+			}
+			if (eventMask && SubEmitterRaisesEvents(particle))
+			{
+				if ((eventMask & (1u << SUB_EMITTER_EVENT_COLLISION)) && SubEmitterCollided(beforeCollision, particle))
+				{
+					SubEmitterEvents.Append(SUB_EMITTER_EVENT_COLLISION, MakeSubEmitterEvent(particle));
+				}
+				if ((eventMask & (1u << SUB_EMITTER_EVENT_DEATH)) && particle.lifeTimeLeft <= 0)
+				{
+					SubEmitterEvents.Append(SUB_EMITTER_EVENT_DEATH, MakeSubEmitterEvent(particle));
+				}
+			}
+			if (trailHead != TRAIL_HEAD_NONE && particle.lifeTimeLeft > 0)
+			{
+				WriteTrailHistory(TrailHistory, trailHead & ~TRAIL_HEAD_RESET, particleIndex, static_cast<uint>(Particles.size()), particle,
+					spawned || (trailHead & TRAIL_HEAD_RESET) != 0);
+			}
+		}
+	});
+
+	// Compaction is serial, it only touches the index lists
+	size_t aliveCount = 0;
+	for (size_t n = 0; n < AliveIndices.size(); ++n)
+	{
+		const uint particleIndex = AliveIndices[n];
+		if (Particles[particleIndex].lifeTimeLeft <= 0)
+		{
+			DeadIndices.push_back(particleIndex);
+		}
+		else
+		{
+			AliveIndices[aliveCount++] = particleIndex;
+		}
+	}
+	AliveIndices.resize(aliveCount);
+}
+
+void ParticleSystemCPU::BuildDrawList(const CullConstants& cull, bool sortByDepth)
+{
+	Visible.resize(AliveIndices.size());
+	Pool.ParallelFor(AliveIndices.size(), [&](size_t begin, size_t end, uint32_t)
+	{
+		for (size_t n = begin; n < end; ++n)
+		{
+			const Particle& particle = Particles[AliveIndices[n]];
+			const float3 center(particle.position.x, particle.position.y, particle.position.z);
+			Visible[n] = SphereInFrustum(center, particle.scale * CULL_BILLBOARD_RADIUS, cull) ? 1 : 0;
+		}
+	});
+
+	DrawIndices.clear();
+	DrawKeys.clear();
+	for (size_t n = 0; n < AliveIndices.size(); ++n)
+	{
+		if (Visible[n])
+		{
+			const uint particleIndex = AliveIndices[n];
+			DrawIndices.push_back(particleIndex);
+			if (sortByDepth)
+			{
+				DrawKeys.push_back(DepthSortKey(dot(Particles[particleIndex].position, cull.ViewDepthAxis)));
+			}
+		}
+	}
+
+	if (sortByDepth)
+	{
+		RadixSortPairs(DrawKeys, DrawIndices, Pool);
+	}
+}
+
+// The GPU's args and spawn passes in one, children take dead slots and join the alive list for the next step
+void ParticleSystemCPU::SpawnSubEmitters(const EmitterConstants& emitter, const SubEmitterConstants& subEmitter)
+{
+	const uint spawns = SubEmitterEvents.GenerateArgs(static_cast<uint>(DeadIndices.size()), subEmitter);
+	const uint deathEvents = SubEmitterEvents.GetCounter(SUB_EMITTER_COUNTER_DEATH_EVENTS);
+	for (uint spawnIndex = 0; spawnIndex < spawns; ++spawnIndex)
+	{
+		const uint2 child = SubEmitterLocateChild(spawnIndex, deathEvents, subEmitter);
+		const uint particleIndex = DeadIndices.back();
+		DeadIndices.pop_back();
+
+		Particles[particleIndex] = SpawnSubEmitterParticle(SubEmitterEvents.GetEvent(child.x), child.x, child.y, subEmitter, emitter);
+		AliveIndices.push_back(particleIndex);
+	}
+}
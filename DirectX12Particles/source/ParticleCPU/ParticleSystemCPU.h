@@ -0,0 +1,108 @@
+#pragma once
+
+#include "../ParticleGame/Particle.hlsli"
+#include "../ParticleGame/Culling.hlsli"
+#include "../ParticleGame/SPH.hlsli"
+#include "Collision.h"
+#include "CurlNoise.h"
+#include "ForceField.h"
+#include "ParticleCurves.h"
+#include "ParticleSnapshot.h"
+#include "SpatialHash.h"
+#include "SubEmitter.h"
+#include "Trail.h"
+#include "VectorField.h"
+#include "ThreadPool.h"
+
+#include <vector>
+
+// CPU backend of the particle sim, used when the compute path is off.
+// Mirrors the emit and simulate passes and produces the same back to front draw list the GPU builds.
+class ParticleSystemCPU
+{
+public:
+
+	ParticleSystemCPU(uint maxParticleCount, ThreadPool& pool);
+
+	// Emits, simulates and culls one step. Hi-Z occlusion needs the GPU's depth, so only the frustum test runs.
+	// With sortByDepth the draw list is ordered back to front, otherwise it keeps alive list order.
+	// When fluid.Enabled is set the SPH passes run first over a hash grid with hash.CellSize cells.
+	// forceFields are culled per FORCE_FIELD_BLOCK_SIZE alive particles like the thread groups of the simulate pass.
+	// turbulence.Enabled samples the volume from SetCurlNoise, the first vectorFields.Count fields sample the volumes from SetVectorField.
+	// trailHead is the history slot this step writes, or TRAIL_HEAD_NONE, with the same TRAIL_HEAD_RESET bit the simulate pass takes.
+	// Deaths and collisions raise the events subEmitter has bursts for, their children spawn after the draw list like the GPU's spawn pass.
+	void Update(const EmitterConstants& emitter, const CullConstants& cull, const SPHConstants& fluid, const SpatialHashConstants& hash,
+		const CollisionConstants& collision, const std::vector<ForceField>& forceFields, const CurlNoiseConstants& turbulence,
+		const VectorFieldConstants& vectorFields, uint trailHead, const SubEmitterConstants& subEmitter, bool sortByDepth);
+
+	// Fast-forwards seconds of a running emitter in steps of stepTime, so an effect starts out in its steady state.
+	// emitter.emitCount is per frame of frameTime, a step emits stepTime / frameTime frames worth spread over the step by birth time.
+	// Only the passes that shape the steady state run: emit and simulate with collision, force fields, turbulence and vector fields.
+	// Particles move up to stepTime times their speed per step, the collision margin of the grid has to cover that.
+	void Prewarm(const EmitterConstants& emitter, float seconds, float stepTime, float frameTime, const CollisionConstants& collision,
+		const std::vector<ForceField>& forceFields, const CurlNoiseConstants& turbulence, const VectorFieldConstants& vectorFields);
+
+	// Planes and broadphase grid from BuildCollisionGrid, collision.Enabled in Update turns the test on
+	void SetCollisionScene(const std::vector<CollisionPlane>& planes, const std::vector<uint>& grid);
+
+	// The same baked volume the GPU samples, turbulence stays off until one is set
+	void SetCurlNoise(const CurlNoiseVolume& volume);
+
+	// Not copied, animated fields swap frames too often. The volume has to stay alive until it is replaced or set to nullptr.
+	void SetVectorField(uint slot, const VectorFieldVolume* volume);
+
+	// The atlas the GPU samples, emitter.curveSet in Update picks a curve set. Copied, it only changes on load.
+	void SetCurveAtlas(const CurveAtlas& atlas);
+
+	// Indexed by particle slot, like the GPU particle buffer
+	const std::vector<Particle>& GetParticles() const { return Particles; }
+	const std::vector<uint>& GetDrawIndices() const { return DrawIndices; }
+	uint GetAliveCount() const { return static_cast<uint>(AliveIndices.size()); }
+
+	// TRAIL_LENGTH slots of one float4 per particle slot, laid out like the GPU trail history
+	const std::vector<float4>& GetTrailHistory() const { return TrailHistory; }
+
+	// The pool as a snapshot image of GetParticleSnapshotLayout(capacity).Size bytes, in the same state the GPU buffers are in between frames
+	void WriteSnapshot(void* image) const;
+
+	// Replaces the pool with a snapshot of one with the same capacity. A snapshot with another capacity or an index out of range
+	// leaves the pool as it was and returns false. The trail history is left alone, it needs a TRAIL_HEAD_RESET step.
+	bool RestoreSnapshot(const ParticleSnapshotView& snapshot);
+
+private:
+
+	void Emit(const EmitterConstants& emitter);
+	void ComputeFluid(const SPHConstants& fluid, const SpatialHashConstants& hash);
+	void Simulate(const EmitterConstants& emitter, bool applyFluid, const CollisionConstants& collision, const std::vector<ForceField>& forceFields,
+		const CurlNoiseConstants& turbulence, const VectorFieldConstants& vectorFields, uint trailHead, uint eventMask);
+	void BuildDrawList(const CullConstants& cull, bool sortByDepth);
+	void SpawnSubEmitters(const EmitterConstants& emitter, const SubEmitterConstants& subEmitter);
+
+	ThreadPool& Pool;
+
+	std::vector<Particle> Particles;
+	std::vector<uint> AliveIndices;
+	std::vector<uint> DeadIndices; // Consumed from the back like the GPU consume buffer
+	std::vector<uint> DrawIndices;
+	std::vector<uint> DrawKeys;
+	std::vector<uint8_t> Visible;
+
+	// SPH state. Positions, velocities and densities are gathered in hash order so neighbors sit close in memory,
+	// the accelerations are indexed by particle slot like Particles.
+	SpatialHashCPU Hash;
+	std::vector<float3> FluidPositions;
+	std::vector<float3> FluidVelocities;
+	std::vector<float2> DensityPressure;
+	std::vector<float3> FluidAccelerations;
+
+	std::vector<CollisionPlane> CollisionPlanes;
+	std::vector<uint> CollisionGrid;
+
+	CurlNoiseVolume CurlNoise;
+	const VectorFieldVolume* VectorFieldVolumes[VECTOR_FIELD_MAX_COUNT] = {};
+	CurveAtlas Curves;
+
+	std::vector<float4> TrailHistory;
+
+	SubEmitterEventBuffer SubEmitterEvents;
+};
@@ -0,0 +1,228 @@
+#include "PipelineCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+static const uint32_t PipelineCacheMagic = 0x4c4f5350; // "PSOL"
+static const uint32_t PipelineCacheVersion = 1;
+
+// Stored field by field, little endian like the hashed words, so the file doesn't depend on the host's byte order or padding
+struct PipelineCacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t LibrarySize;
+	uint64_t LibraryHash; // HashContent of the library bytes, a torn or truncated write never reaches the driver
+};
+
+static const size_t PipelineCacheHeaderSize = 24;
+
+static const uint64_t Prime1 = 11400714785074694791ull;
+static const uint64_t Prime2 = 14029467366897019727ull;
+static const uint64_t Prime3 = 1609587929392839161ull;
+static const uint64_t Prime4 = 9650029242287828579ull;
+static const uint64_t Prime5 = 2870177450012600261ull;
+
+static uint64_t RotateLeft(uint64_t value, uint32_t bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t Read64(const uint8_t* bytes)
+{
+	uint64_t value = 0;
+	for (uint32_t n = 0; n < 8; ++n)
+	{
+		value |= static_cast<uint64_t>(bytes[n]) << (n * 8);
+	}
+	return value;
+}
+
+static uint32_t Read32(const uint8_t* bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+static void Write64(uint8_t* bytes, uint64_t value)
+{
+	for (uint32_t n = 0; n < 8; ++n)
+	{
+		bytes[n] = static_cast<uint8_t>(value >> (n * 8));
+	}
+}
+
+static void Write32(uint8_t* bytes, uint32_t value)
+{
+	for (uint32_t n = 0; n < 4; ++n)
+	{
+		bytes[n] = static_cast<uint8_t>(value >> (n * 8));
+	}
+}
+
+static uint64_t Round(uint64_t accumulator, uint64_t input)
+{
+	return RotateLeft(accumulator + input * Prime2, 31) * Prime1;
+}
+
+static uint64_t MergeRound(uint64_t hash, uint64_t accumulator)
+{
+	return (hash ^ Round(0, accumulator)) * Prime1 + Prime4;
+}
+
+ContentHash::ContentHash(uint64_t seed)
+	: Accumulators{ seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1 }
+	, Seed(seed)
+{
+}
+
+ContentHash& ContentHash::Add(const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	TotalSize += size;
+
+	// Top up a partial stripe first, then whole stripes straight from data
+	if (BufferSize > 0)
+	{
+		const size_t count = (std::min)(size, static_cast<size_t>(32 - BufferSize));
+		memcpy(Buffer + BufferSize, bytes, count);
+		BufferSize += static_cast<uint32_t>(count);
+		bytes += count;
+		size -= count;
+		if (BufferSize < 32)
+		{
+			return *this;
+		}
+		for (uint32_t lane = 0; lane < 4; ++lane)
+		{
+			Accumulators[lane] = Round(Accumulators[lane], Read64(Buffer + lane * 8));
+		}
+		BufferSize = 0;
+	}
+
+	// In locals, data is bytes and could alias the members, which would keep them in memory
+	uint64_t accumulator0 = Accumulators[0], accumulator1 = Accumulators[1], accumulator2 = Accumulators[2], accumulator3 = Accumulators[3];
+	for (; size >= 32; bytes += 32, size -= 32)
+	{
+		accumulator0 = Round(accumulator0, Read64(bytes));
+		accumulator1 = Round(accumulator1, Read64(bytes + 8));
+		accumulator2 = Round(accumulator2, Read64(bytes + 16));
+		accumulator3 = Round(accumulator3, Read64(bytes + 24));
+	}
+	Accumulators[0] = accumulator0;
+	Accumulators[1] = accumulator1;
+	Accumulators[2] = accumulator2;
+	Accumulators[3] = accumulator3;
+
+	memcpy(Buffer, bytes, size);
+	BufferSize = static_cast<uint32_t>(size);
+	return *this;
+}
+
+ContentHash& ContentHash::AddString(const char* text)
+{
+	return Add(text, strlen(text) + 1);
+}
+
+uint64_t ContentHash::Get() const
+{
+	uint64_t hash;
+	if (TotalSize >= 32)
+	{
+		hash = RotateLeft(Accumulators[0], 1) + RotateLeft(Accumulators[1], 7) + RotateLeft(Accumulators[2], 12) + RotateLeft(Accumulators[3], 18);
+		for (uint32_t lane = 0; lane < 4; ++lane)
+		{
+			hash = MergeRound(hash, Accumulators[lane]);
+		}
+	}
+	else
+	{
+		hash = Seed + Prime5;
+	}
+	hash += TotalSize;
+
+	const uint8_t* bytes = Buffer;
+	uint32_t size = BufferSize;
+	for (; size >= 8; bytes += 8, size -= 8)
+	{
+		hash = RotateLeft(hash ^ Round(0, Read64(bytes)), 27) * Prime1 + Prime4;
+	}
+	if (size >= 4)
+	{
+		hash = RotateLeft(hash ^ (Read32(bytes) * Prime1), 23) * Prime2 + Prime3;
+		bytes += 4;
+		size -= 4;
+	}
+	for (; size > 0; ++bytes, --size)
+	{
+		hash = RotateLeft(hash ^ (*bytes * Prime5), 11) * Prime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+uint64_t HashContent(const void* data, size_t size, uint64_t seed)
+{
+	return ContentHash(seed).Add(data, size).Get();
+}
+
+std::wstring GetPipelineName(uint64_t key)
+{
+	static const wchar_t Digits[] = L"0123456789abcdef";
+	std::wstring name(16, L'0');
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		name[15 - n] = Digits[(key >> (n * 4)) & 15];
+	}
+	return name;
+}
+
+bool SavePipelineCache(const std::filesystem::path& path, const void* library, size_t size)
+{
+	const PipelineCacheHeader header = { PipelineCacheMagic, PipelineCacheVersion, size, HashContent(library, size) };
+	uint8_t bytes[PipelineCacheHeaderSize];
+	Write32(bytes, header.Magic);
+	Write32(bytes + 4, header.Version);
+	Write64(bytes + 8, header.LibrarySize);
+	Write64(bytes + 16, header.LibraryHash);
+
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+	file.write(static_cast<const char*>(library), size);
+	return static_cast<bool>(file);
+}
+
+bool LoadPipelineCache(const std::filesystem::path& path, std::vector<uint8_t>& library)
+{
+	library.clear();
+	std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		return false;
+	}
+	const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+	file.seekg(0);
+
+	uint8_t bytes[PipelineCacheHeaderSize];
+	if (fileSize < sizeof(bytes) || !file.read(reinterpret_cast<char*>(bytes), sizeof(bytes)))
+	{
+		return false;
+	}
+	const PipelineCacheHeader header = { Read32(bytes), Read32(bytes + 4), Read64(bytes + 8), Read64(bytes + 16) };
+	if (header.Magic != PipelineCacheMagic || header.Version != PipelineCacheVersion || header.LibrarySize != fileSize - sizeof(bytes))
+	{
+		return false;
+	}
+	library.resize(static_cast<size_t>(header.LibrarySize));
+	if (!file.read(reinterpret_cast<char*>(library.data()), library.size()) || HashContent(library.data(), library.size()) != header.LibraryHash)
+	{
+		library.clear();
+		return false;
+	}
+	return true;
+}
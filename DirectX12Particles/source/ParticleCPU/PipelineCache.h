@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Keys and file format of the pipeline cache. LoadContent names every PSO after a hash of what it's built from, shader bytecode
+// and serialized root signature by content and the fixed function state by value, and stores them in an ID3D12PipelineLibrary
+// whose serialized bytes go into PipelineCache.bin behind a checksummed header. The library itself is opaque and only valid on
+// the driver that wrote it, D3D refuses it anywhere else and LoadContent starts over with an empty one.
+
+// XXH64 of everything added so far, the same bytes give the same hash whether they're added at once or in pieces.
+// Words are read little endian on every platform.
+class ContentHash
+{
+public:
+
+	explicit ContentHash(uint64_t seed = 0);
+
+	ContentHash& Add(const void* data, size_t size);
+
+	// Raw bytes of value, only for types without padding or pointers
+	template<typename T>
+	ContentHash& AddValue(const T& value) { return Add(&value, sizeof(value)); }
+
+	// With its terminator, so "ab" then "c" differs from "a" then "bc"
+	ContentHash& AddString(const char* text);
+
+	uint64_t Get() const;
+
+private:
+
+	uint64_t Accumulators[4];
+	uint8_t Buffer[32];
+	uint32_t BufferSize = 0;
+	uint64_t TotalSize = 0;
+	uint64_t Seed;
+};
+
+uint64_t HashContent(const void* data, size_t size, uint64_t seed = 0);
+
+// Library name of the pipeline with key, its 16 hex digits
+std::wstring GetPipelineName(uint64_t key);
+
+// Writes the header and the library's serialized bytes
+bool SavePipelineCache(const std::filesystem::path& path, const void* library, size_t size);
+
+// The library bytes of path, if the header is this version's and the checksum matches. D3D reads pipelines out of library
+// for as long as the ID3D12PipelineLibrary made from it lives.
+bool LoadPipelineCache(const std::filesystem::path& path, std::vector<uint8_t>& library);
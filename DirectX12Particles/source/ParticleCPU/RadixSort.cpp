@@ -0,0 +1,61 @@
+#include "RadixSort.h"
+
+#include <algorithm>
+
+void RadixSortPairs(std::vector<uint>& keys, std::vector<uint>& values, ThreadPool& pool)
+{
+	const size_t count = keys.size();
+	const uint chunkCount = pool.GetThreadCount();
+
+	std::vector<uint> scratchKeys(count);
+	std::vector<uint> scratchValues(count);
+	std::vector<uint> offsets(static_cast<size_t>(chunkCount) * RADIX_BINS);
+
+	std::vector<uint>* sourceKeys = &keys;
+	std::vector<uint>* sourceValues = &values;
+	std::vector<uint>* destinationKeys = &scratchKeys;
+	std::vector<uint>* destinationValues = &scratchValues;
+
+	// RADIX_PASSES is even so the last pass writes back into keys and values
+	for (uint pass = 0; pass < RADIX_PASSES; ++pass)
+	{
+		std::fill(offsets.begin(), offsets.end(), 0u);
+
+		pool.ParallelFor(count, [&](size_t begin, size_t end, uint32_t chunk)
+		{
+			uint* histogram = &offsets[static_cast<size_t>(chunk) * RADIX_BINS];
+			for (size_t n = begin; n < end; ++n)
+			{
+				++histogram[RadixDigit((*sourceKeys)[n], pass)];
+			}
+		});
+
+		// Digit major, chunk minor, so lower chunks of a digit land first and the pass stays stable
+		uint sum = 0;
+		for (uint digit = 0; digit < RADIX_BINS; ++digit)
+		{
+			for (uint chunk = 0; chunk < chunkCount; ++chunk)
+			{
+				uint& offset = offsets[static_cast<size_t>(chunk) * RADIX_BINS + digit];
+				const uint digitCount = offset;
+				offset = sum;
+				sum += digitCount;
+			}
+		}
+
+		pool.ParallelFor(count, [&](size_t begin, size_t end, uint32_t chunk)
+		{
+			uint* offset = &offsets[static_cast<size_t>(chunk) * RADIX_BINS];
+			for (size_t n = begin; n < end; ++n)
+			{
+				const uint key = (*sourceKeys)[n];
+				const uint destination = offset[RadixDigit(key, pass)]++;
+				(*destinationKeys)[destination] = key;
+				(*destinationValues)[destination] = (*sourceValues)[n];
+			}
+		});
+
+		std::swap(sourceKeys, destinationKeys);
+		std::swap(sourceValues, destinationValues);
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../ParticleGame/RadixSort.hlsli"
+#include "ThreadPool.h"
+
+#include <vector>
+
+// Stable LSD sort of keys with their values, the same 8 bit digits as ComputeSortOnesweep.hlsl so the results
+// match the GPU sort element for element. Each pass histograms and scatters one contiguous chunk per thread.
+void RadixSortPairs(std::vector<uint>& keys, std::vector<uint>& values, ThreadPool& pool);
@@ -0,0 +1,50 @@
+#include "SSAOBlur.h"
+
+#include "../ParticleGame/SSAOBlur.hlsli"
+
+// One pass along x (vertical = false) or y, clamping taps to the image edge like the groupshared tile loads do
+static void BlurPass(const std::vector<float>& source, const std::vector<float>& linearDepth, int width, int height,
+	bool vertical, float sharpness, std::vector<float>& destination)
+{
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			const float centerDepth = linearDepth[y * width + x];
+			float sum = 0.0f;
+			float weightSum = 0.0f;
+
+			for (int offset = -SSAO_BLUR_RADIUS; offset <= SSAO_BLUR_RADIUS; ++offset)
+			{
+				const int tapX = vertical ? x : clamp(x + offset, 0, width - 1);
+				const int tapY = vertical ? clamp(y + offset, 0, height - 1) : y;
+				const int tap = tapY * width + tapX;
+
+				const float weight = SSAOBlurWeight(offset, centerDepth, linearDepth[tap], sharpness);
+				sum += source[tap] * weight;
+				weightSum += weight;
+			}
+
+			destination[y * width + x] = sum / weightSum;
+		}
+	}
+}
+
+std::vector<float> BlurAmbientOcclusion(const std::vector<float>& ao, const std::vector<float>& depth, int width, int height,
+	float nearPlane, float farPlane, float sharpness)
+{
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+
+	std::vector<float> linearDepth(pixelCount);
+	for (size_t n = 0; n < pixelCount; ++n)
+	{
+		linearDepth[n] = LinearizeDepth(depth[n], nearPlane, farPlane);
+	}
+
+	std::vector<float> horizontal(pixelCount);
+	std::vector<float> result(pixelCount);
+	BlurPass(ao, linearDepth, width, height, false, sharpness, horizontal);
+	BlurPass(horizontal, linearDepth, width, height, true, sharpness, result);
+
+	return result;
+}
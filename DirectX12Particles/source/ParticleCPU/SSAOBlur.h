@@ -0,0 +1,9 @@
+#pragma once
+
+#include <vector>
+
+// CPU reference of the separable bilateral blur in ComputeSSAOBlur.hlsl.
+// ao and depth are width * height row-major images, depth holds raw [0, 1] depth buffer values.
+// Returns the blurred occlusion the vertical pass lerps the scene with.
+std::vector<float> BlurAmbientOcclusion(const std::vector<float>& ao, const std::vector<float>& depth, int width, int height,
+	float nearPlane, float farPlane, float sharpness);
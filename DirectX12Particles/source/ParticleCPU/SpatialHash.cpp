@@ -0,0 +1,145 @@
+#include "SpatialHash.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPATIAL_HASH_SSE 1
+#include <emmintrin.h>
+#endif
+
+#if SPATIAL_HASH_SSE
+// Low 32 bits of a 32x32 multiply per lane, SSE2 only has the unsigned 32x32->64 multiply of even lanes
+static __m128i MultiplyLow32(__m128i a, __m128i b)
+{
+	const __m128i even = _mm_mul_epu32(a, b);
+	const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Matches (int)floor(x), truncation rounds negative values up so those lanes subtract one
+static __m128i FloorToInt(__m128 x)
+{
+	const __m128i truncated = _mm_cvttps_epi32(x);
+	const __m128 roundedUp = _mm_cmplt_ps(x, _mm_cvtepi32_ps(truncated));
+	return _mm_add_epi32(truncated, _mm_castps_si128(roundedUp));
+}
+#endif
+
+SpatialHashCPU::SpatialHashCPU(ThreadPool& pool)
+	: Pool(pool)
+{
+}
+
+void SpatialHashCPU::ComputeKeys(size_t begin, size_t end)
+{
+	size_t n = begin;
+
+#if SPATIAL_HASH_SSE
+	const __m128 cellSize = _mm_set1_ps(Constants.CellSize);
+	const __m128i primeX = _mm_set1_epi32(73856093);
+	const __m128i primeY = _mm_set1_epi32(19349663);
+	const __m128i primeZ = _mm_set1_epi32(83492791);
+	const __m128i mask = _mm_set1_epi32(static_cast<int>(Constants.TableSize - 1u));
+
+	for (; n + 4 <= end; n += 4)
+	{
+		const __m128i x = MultiplyLow32(FloorToInt(_mm_div_ps(_mm_loadu_ps(&PositionX[n]), cellSize)), primeX);
+		const __m128i y = MultiplyLow32(FloorToInt(_mm_div_ps(_mm_loadu_ps(&PositionY[n]), cellSize)), primeY);
+		const __m128i z = MultiplyLow32(FloorToInt(_mm_div_ps(_mm_loadu_ps(&PositionZ[n]), cellSize)), primeZ);
+		const __m128i key = _mm_and_si128(_mm_xor_si128(_mm_xor_si128(x, y), z), mask);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&Keys[n]), key);
+	}
+#endif
+
+	for (; n < end; ++n)
+	{
+		const float3 position(PositionX[n], PositionY[n], PositionZ[n]);
+		Keys[n] = SpatialHashKey(SpatialHashCell(position, Constants.CellSize), Constants.TableSize);
+	}
+}
+
+void SpatialHashCPU::Build(const std::vector<Particle>& particles, const std::vector<uint>& particleIndices, const SpatialHashConstants& constants)
+{
+	const size_t count = particleIndices.size();
+	const uint chunkCount = Pool.GetThreadCount();
+
+	if (!AtomicCounts || Constants.TableSize != constants.TableSize)
+	{
+		AtomicCounts.reset(new std::atomic<uint>[constants.TableSize]);
+		CellCounts.resize(constants.TableSize);
+		CellStarts.resize(constants.TableSize);
+	}
+	Constants = constants;
+
+	PositionX.resize(count);
+	PositionY.resize(count);
+	PositionZ.resize(count);
+	Keys.resize(count);
+	Ranks.resize(count);
+	SortedIndices.resize(count);
+
+	Pool.ParallelFor(count, [&](size_t begin, size_t end, uint32_t)
+	{
+		for (size_t n = begin; n < end; ++n)
+		{
+			const float4& position = particles[particleIndices[n]].position;
+			PositionX[n] = position.x;
+			PositionY[n] = position.y;
+			PositionZ[n] = position.z;
+		}
+		ComputeKeys(begin, end);
+	});
+
+	Pool.ParallelFor(Constants.TableSize, [&](size_t begin, size_t end, uint32_t)
+	{
+		for (size_t key = begin; key < end; ++key)
+		{
+			AtomicCounts[key].store(0, std::memory_order_relaxed);
+		}
+	});
+
+	Pool.ParallelFor(count, [&](size_t begin, size_t end, uint32_t)
+	{
+		for (size_t n = begin; n < end; ++n)
+		{
+			Ranks[n] = AtomicCounts[Keys[n]].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	// Exclusive scan of the counts, per chunk totals first, then every chunk scans from its offset
+	std::vector<uint> chunkTotals(chunkCount, 0u);
+	Pool.ParallelFor(Constants.TableSize, [&](size_t begin, size_t end, uint32_t chunk)
+	{
+		uint total = 0;
+		for (size_t key = begin; key < end; ++key)
+		{
+			CellCounts[key] = AtomicCounts[key].load(std::memory_order_relaxed);
+			total += CellCounts[key];
+		}
+		chunkTotals[chunk] = total;
+	});
+
+	uint sum = 0;
+	for (uint chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		const uint total = chunkTotals[chunk];
+		chunkTotals[chunk] = sum;
+		sum += total;
+	}
+
+	Pool.ParallelFor(Constants.TableSize, [&](size_t begin, size_t end, uint32_t chunk)
+	{
+		uint offset = chunkTotals[chunk];
+		for (size_t key = begin; key < end; ++key)
+		{
+			CellStarts[key] = offset;
+			offset += CellCounts[key];
+		}
+	});
+
+	Pool.ParallelFor(count, [&](size_t begin, size_t end, uint32_t)
+	{
+		for (size_t n = begin; n < end; ++n)
+		{
+			SortedIndices[CellStarts[Keys[n]] + Ranks[n]] = particleIndices[n];
+		}
+	});
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../ParticleGame/Particle.hlsli"
+#include "../ParticleGame/SpatialHash.hlsli"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <vector>
+
+// Power of two table with about 3 buckets per particle, which keeps collisions rare. Clamped to the sizes the two level scan
+// of ComputeSpatialHash.hlsl handles, past about 350k particles the buckets just get fuller.
+constexpr uint GetSpatialHashTableSize(uint particleCount)
+{
+	return std::clamp<uint>(std::bit_ceil(particleCount * 3u), SPATIAL_HASH_SCAN_BLOCK, SPATIAL_HASH_MAX_TABLE_SIZE);
+}
+
+// CPU version of ComputeSpatialHash.hlsl, the same count, scan and scatter counting sort over hashed cells.
+// Like the GPU build, the order of particles inside a cell depends on thread timing.
+class SpatialHashCPU
+{
+public:
+
+	explicit SpatialHashCPU(ThreadPool& pool);
+
+	// Hashes particles[particleIndices[n]] and sorts the particle indices by bucket, cell keys are computed four at a time
+	void Build(const std::vector<Particle>& particles, const std::vector<uint>& particleIndices, const SpatialHashConstants& constants);
+
+	// Calls visitor(particleIndex) for every particle in the 27 cells around position
+	template<typename Visitor>
+	void ForEachNeighbor(float3 position, Visitor&& visitor) const
+	{
+		ForEachNeighborSlot(position, [&](uint slot) { visitor(SortedIndices[slot]); });
+	}
+
+	// Same walk, but passes the position in the sorted order so callers can read data they gathered in that order
+	template<typename Visitor>
+	void ForEachNeighborSlot(float3 position, Visitor&& visitor) const
+	{
+		for (uint n = 0; n < SPATIAL_HASH_NEIGHBOR_CELLS; ++n)
+		{
+			const uint key = SpatialHashNeighborKey(position, n, Constants);
+			const uint end = CellStarts[key] + CellCounts[key];
+			for (uint slot = CellStarts[key]; slot < end; ++slot)
+			{
+				visitor(slot);
+			}
+		}
+	}
+
+	const SpatialHashConstants& GetConstants() const { return Constants; }
+	const std::vector<uint>& GetSortedIndices() const { return SortedIndices; }
+
+private:
+
+	void ComputeKeys(size_t begin, size_t end);
+
+	ThreadPool& Pool;
+	SpatialHashConstants Constants;
+
+	std::vector<float> PositionX; // Gathered so keys can be hashed four at a time
+	std::vector<float> PositionY;
+	std::vector<float> PositionZ;
+	std::vector<uint> Keys;
+	std::vector<uint> Ranks;
+
+	std::unique_ptr<std::atomic<uint>[]> AtomicCounts;
+	std::vector<uint> CellCounts;
+	std::vector<uint> CellStarts;
+	std::vector<uint> SortedIndices;
+};
@@ -0,0 +1,32 @@
+#include "SubEmitter.h"
+
+SubEmitterEventBuffer::SubEmitterEventBuffer()
+	: Events(SUB_EMITTER_EVENT_TYPES * SUB_EMITTER_MAX_EVENTS)
+{
+	for (std::atomic<uint>& counter : Counters)
+	{
+		counter.store(0, std::memory_order_relaxed);
+	}
+}
+
+bool SubEmitterEventBuffer::Append(uint type, const SubEmitterEvent& event)
+{
+	// Counters keep counting past the end so the claim stays a single add, readers clamp them
+	const uint slot = Counters[type].fetch_add(1, std::memory_order_relaxed);
+	if (slot >= SUB_EMITTER_MAX_EVENTS)
+	{
+		return false;
+	}
+	Events[SubEmitterEventIndex(type, slot)] = event;
+	return true;
+}
+
+uint SubEmitterEventBuffer::GenerateArgs(uint deadCount, const SubEmitterConstants& constants)
+{
+	const uint deathEvents = (min)(Counters[SUB_EMITTER_COUNTER_DEATH].exchange(0, std::memory_order_relaxed), static_cast<uint>(SUB_EMITTER_MAX_EVENTS));
+	const uint collisionEvents = (min)(Counters[SUB_EMITTER_COUNTER_COLLISION].exchange(0, std::memory_order_relaxed), static_cast<uint>(SUB_EMITTER_MAX_EVENTS));
+	const uint spawns = SubEmitterSpawnCount(deathEvents, collisionEvents, deadCount, constants);
+	Counters[SUB_EMITTER_COUNTER_DEATH_EVENTS].store(deathEvents, std::memory_order_relaxed);
+	Counters[SUB_EMITTER_COUNTER_SPAWNS].store(spawns, std::memory_order_relaxed);
+	return spawns;
+}
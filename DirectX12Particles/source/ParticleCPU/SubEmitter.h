@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../ParticleGame/SubEmitter.hlsli"
+
+#include <atomic>
+#include <vector>
+
+// CPU twin of the sub-emitter event and counter buffers, laid out like the GPU ones
+class SubEmitterEventBuffer
+{
+public:
+
+	SubEmitterEventBuffer();
+
+	// The append ComputeSimulator.hlsl does, one atomic add claims a slot so any number of threads can append at once.
+	// Returns false when the type's SUB_EMITTER_MAX_EVENTS slots are taken and the event was dropped.
+	bool Append(uint type, const SubEmitterEvent& event);
+
+	// CPU reference of ComputeGenerateArgs.hlsl. Clamps the append counters into the spawn counters, zeroes them for the next step
+	// and returns the number of children to spawn.
+	uint GenerateArgs(uint deadCount, const SubEmitterConstants& constants);
+
+	uint GetCounter(uint counter) const { return Counters[counter].load(std::memory_order_relaxed); }
+	const SubEmitterEvent& GetEvent(uint eventIndex) const { return Events[eventIndex]; }
+
+private:
+
+	std::atomic<uint> Counters[SUB_EMITTER_COUNTER_COUNT];
+	std::vector<SubEmitterEvent> Events;
+};
@@ -0,0 +1,180 @@
+#include "TaskGraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+
+TaskGraph::Task TaskGraph::Add(std::string name, std::function<void()> function, const std::vector<Task>& dependencies)
+{
+	const Task task = static_cast<Task>(Nodes.size());
+
+	// Later tasks could close a cycle and aren't there yet anyway, dropping one would run the task too early.
+	// Checked before anything changes, so a throw leaves the graph as it was.
+	for (Task dependency : dependencies)
+	{
+		if (dependency >= task)
+		{
+			throw std::invalid_argument("Task " + name + " depends on task " + std::to_string(dependency) + " that isn't added yet");
+		}
+	}
+
+	Node node;
+	node.Name = std::move(name);
+	node.Function = std::move(function);
+	for (Task dependency : dependencies)
+	{
+		// Duplicates would be waited for twice
+		if (std::find(node.Dependencies.begin(), node.Dependencies.end(), dependency) == node.Dependencies.end())
+		{
+			node.Dependencies.push_back(dependency);
+			Nodes[dependency].Dependents.push_back(task);
+		}
+	}
+	Nodes.push_back(std::move(node));
+	return task;
+}
+
+void TaskGraph::Run(uint32_t threadCount)
+{
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point start = Clock::now();
+	auto milliseconds = [start]() { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<Task> ready;
+	std::vector<uint32_t> pendingDependencies(Nodes.size());
+	size_t remaining = Nodes.size();
+	std::exception_ptr failure;
+
+	for (Task task = 0; task < Nodes.size(); ++task)
+	{
+		pendingDependencies[task] = static_cast<uint32_t>(Nodes[task].Dependencies.size());
+		if (pendingDependencies[task] == 0)
+		{
+			ready.push_back(task);
+		}
+	}
+
+	// Ready tasks are taken in the order they became ready, the ones added first go first among the initial ones.
+	// An empty queue with tasks left means some are running and will either ready more or finish the graph.
+	auto worker = [&]()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;)
+		{
+			changed.wait(lock, [&] { return failure || remaining == 0 || !ready.empty(); });
+			if (failure || remaining == 0)
+			{
+				return;
+			}
+			const Task task = ready.front();
+			ready.pop_front();
+			Node& node = Nodes[task];
+			lock.unlock();
+
+			node.Start = milliseconds();
+			std::exception_ptr exception;
+			try
+			{
+				node.Function();
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+			}
+			node.End = milliseconds();
+
+			lock.lock();
+			if (exception && !failure)
+			{
+				failure = exception;
+			}
+			for (Task dependent : node.Dependents)
+			{
+				if (--pendingDependencies[dependent] == 0)
+				{
+					ready.push_back(dependent);
+				}
+			}
+			--remaining;
+			changed.notify_all();
+		}
+	};
+
+	// No more threads than tasks, the caller is one of them
+	const size_t usedThreadCount = (std::min)(static_cast<size_t>((std::max)(threadCount, 1u)), (std::max)(Nodes.size(), static_cast<size_t>(1)));
+	std::vector<std::thread> workers;
+	for (size_t n = 1; n < usedThreadCount; ++n)
+	{
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : workers)
+	{
+		thread.join();
+	}
+
+	WallMilliseconds = milliseconds();
+	if (failure)
+	{
+		std::rethrow_exception(failure);
+	}
+}
+
+double TaskGraph::GetSerialMilliseconds() const
+{
+	double milliseconds = 0.0;
+	for (Task task = 0; task < Nodes.size(); ++task)
+	{
+		milliseconds += GetMilliseconds(task);
+	}
+	return milliseconds;
+}
+
+std::vector<TaskGraph::Task> TaskGraph::GetCriticalPath(double& milliseconds) const
+{
+	// Dependencies always come first, one pass in order has every chain's length ready before it's extended
+	std::vector<double> longest(Nodes.size());
+	std::vector<Task> previous(Nodes.size());
+	Task last = 0;
+	milliseconds = 0.0;
+	for (Task task = 0; task < Nodes.size(); ++task)
+	{
+		double before = 0.0;
+		previous[task] = task;
+		for (Task dependency : Nodes[task].Dependencies)
+		{
+			if (longest[dependency] > before)
+			{
+				before = longest[dependency];
+				previous[task] = dependency;
+			}
+		}
+		longest[task] = before + GetMilliseconds(task);
+		if (longest[task] > milliseconds)
+		{
+			milliseconds = longest[task];
+			last = task;
+		}
+	}
+
+	std::vector<Task> path;
+	if (Nodes.empty())
+	{
+		return path;
+	}
+	for (Task task = last;; task = previous[task])
+	{
+		path.push_back(task);
+		if (previous[task] == task)
+		{
+			break;
+		}
+	}
+	std::reverse(path.begin(), path.end());
+	return path;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Tasks with explicit dependencies, run on as many threads as can be kept busy and timed. LoadContent builds one out of its
+// root signatures, shader reads, PSOs and texture builds, anything that doesn't wait on another runs next to it.
+// A task can only depend on tasks added before it, so the graph never has a cycle.
+class TaskGraph
+{
+public:
+
+	typedef uint32_t Task;
+
+	// Throws std::invalid_argument for a dependency that isn't added yet and leaves the graph as it was
+	Task Add(std::string name, std::function<void()> function, const std::vector<Task>& dependencies = {});
+
+	// Runs every task once its dependencies are done, on threadCount threads counting the caller, and returns when all are.
+	// After a task throws no other one starts, the ones already running finish and the first exception is rethrown.
+	// A graph runs once.
+	void Run(uint32_t threadCount = std::thread::hardware_concurrency());
+
+	size_t GetTaskCount() const { return Nodes.size(); }
+	const std::string& GetName(Task task) const { return Nodes[task].Name; }
+
+	// Times of the last Run, in milliseconds since it started. Tasks that never ran start and end at 0.
+	double GetStartMilliseconds(Task task) const { return Nodes[task].Start; }
+	double GetMilliseconds(Task task) const { return Nodes[task].End - Nodes[task].Start; }
+	double GetWallMilliseconds() const { return WallMilliseconds; }
+
+	// Sum of every task's time, what Run takes on one thread
+	double GetSerialMilliseconds() const;
+
+	// The chain of dependencies with the longest total time, first task first, and that time. No number of threads
+	// gets Run below it, what's left to shorten is on this chain.
+	std::vector<Task> GetCriticalPath(double& milliseconds) const;
+
+private:
+
+	struct Node
+	{
+		std::string Name;
+		std::function<void()> Function;
+		std::vector<Task> Dependencies;
+		std::vector<Task> Dependents;
+		double Start = 0.0;
+		double End = 0.0;
+	};
+
+	std::vector<Node> Nodes;
+	double WallMilliseconds = 0.0;
+};
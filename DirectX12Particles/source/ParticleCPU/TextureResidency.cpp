@@ -0,0 +1,113 @@
+#include "TextureResidency.h"
+
+#include <algorithm>
+
+uint32_t TextureResidency::Add()
+{
+	Textures.push_back({ {}, 0, 0, 0, 0 });
+	return static_cast<uint32_t>(Textures.size() - 1);
+}
+
+void TextureResidency::SetMipSizes(uint32_t texture, const size_t* mipSizes, uint32_t mipCount)
+{
+	Entry& entry = Textures[texture];
+	entry.MipSizes.assign(mipSizes, mipSizes + mipCount);
+	entry.UsedMip = mipCount;
+	entry.WantedMip = mipCount - 1;
+	entry.TargetMip = mipCount - 1;
+}
+
+void TextureResidency::Use(uint32_t texture, uint32_t finestMip)
+{
+	// Mips below the coarsest one are all the coarsest one
+	Entry& entry = Textures[texture];
+	if (!entry.MipSizes.empty())
+	{
+		entry.UsedMip = (std::min)(entry.UsedMip, (std::min)(finestMip, static_cast<uint32_t>(entry.MipSizes.size() - 1)));
+	}
+}
+
+template <typename Pick>
+void TextureResidency::Evict(size_t budget, size_t& bytes, Pick pick)
+{
+	while (bytes > budget)
+	{
+		Entry* entry = pick();
+		if (!entry)
+		{
+			return;
+		}
+		bytes -= entry->MipSizes[entry->TargetMip];
+		entry->TargetMip++;
+	}
+}
+
+void TextureResidency::Update(size_t budget)
+{
+	Frame++;
+	for (Entry& entry : Textures)
+	{
+		const uint32_t mipCount = static_cast<uint32_t>(entry.MipSizes.size());
+		if (mipCount == 0)
+		{
+			continue;
+		}
+		if (entry.UsedMip < mipCount)
+		{
+			entry.WantedMip = entry.UsedMip;
+			entry.LastUse = Frame;
+			if (entry.WantedMip < entry.TargetMip)
+			{
+				entry.TargetMip = entry.WantedMip;
+			}
+		}
+		entry.UsedMip = mipCount;
+	}
+
+	size_t bytes = GetTargetBytes();
+	auto evictable = [](const Entry& entry) { return !entry.MipSizes.empty() && entry.TargetMip + 1 < entry.MipSizes.size(); };
+
+	Evict(budget, bytes, [&]() -> Entry*
+	{
+		Entry* oldest = nullptr;
+		for (Entry& entry : Textures)
+		{
+			if (evictable(entry) && entry.LastUse != Frame && (!oldest || entry.LastUse < oldest->LastUse))
+			{
+				oldest = &entry;
+			}
+		}
+		return oldest;
+	});
+
+	// Used textures, first the surplus above what they sample and then what they need
+	for (const bool surplus : { true, false })
+	{
+		Evict(budget, bytes, [&]() -> Entry*
+		{
+			Entry* largest = nullptr;
+			for (Entry& entry : Textures)
+			{
+				if (evictable(entry) && (!surplus || entry.TargetMip < entry.WantedMip) &&
+					(!largest || entry.MipSizes[entry.TargetMip] > largest->MipSizes[largest->TargetMip]))
+				{
+					largest = &entry;
+				}
+			}
+			return largest;
+		});
+	}
+}
+
+size_t TextureResidency::GetTargetBytes() const
+{
+	size_t bytes = 0;
+	for (const Entry& entry : Textures)
+	{
+		for (uint32_t mip = entry.TargetMip; mip < entry.MipSizes.size(); mip++)
+		{
+			bytes += entry.MipSizes[mip];
+		}
+	}
+	return bytes;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Which mips of every texture stay in memory under a byte budget. Draws report the finest mip they sample each frame and Update
+// turns that into a target per texture, the finest mip that should be resident. Without pressure a texture keeps what it has,
+// coarser views don't evict anything. Over budget, top mips go in this order:
+//   textures nobody used this frame, least recently used first,
+//   then mips used textures hold but no longer sample,
+//   then the mips used textures need, always the largest top mip next so the resolutions even out.
+// The coarsest mip is never evicted, a texture always has something to sample.
+class TextureResidency
+{
+public:
+
+	// A texture whose mip chain isn't known yet, it takes no part before SetMipSizes
+	uint32_t Add();
+
+	// mipSizes[0] is the largest level. The target starts at the coarsest mip until a draw asks for more.
+	void SetMipSizes(uint32_t texture, const size_t* mipSizes, uint32_t mipCount);
+
+	// A draw samples texture down to finestMip this frame, several draws keep the finest. Ignored before SetMipSizes.
+	void Use(uint32_t texture, uint32_t finestMip);
+
+	// Ends the frame, picks every target and forgets the frame's uses
+	void Update(size_t budget);
+
+	uint32_t GetTargetMip(uint32_t texture) const { return Textures[texture].TargetMip; }
+
+	// Bytes of every texture's targets, over budget only when the coarsest mips alone are
+	size_t GetTargetBytes() const;
+
+private:
+
+	struct Entry
+	{
+		std::vector<size_t> MipSizes;
+		uint32_t UsedMip; // Finest mip used this frame, the mip count when unused
+		uint32_t WantedMip; // UsedMip of the last frame it was used in
+		uint32_t TargetMip;
+		uint64_t LastUse;
+	};
+
+	// Drops top mips of the textures pick returns, nullptr when none is left, until the targets fit budget
+	template <typename Pick>
+	void Evict(size_t budget, size_t& bytes, Pick pick);
+
+	std::vector<Entry> Textures;
+	uint64_t Frame = 0;
+};
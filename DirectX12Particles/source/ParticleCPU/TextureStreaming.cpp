@@ -0,0 +1,281 @@
+#include "TextureStreaming.h"
+
+#include <algorithm>
+
+uint32_t TextureStreamScheduler::Add(float priority)
+{
+	Textures.push_back({ priority, {}, 0, 0, 0, false });
+	return static_cast<uint32_t>(Textures.size() - 1);
+}
+
+void TextureStreamScheduler::SetPriority(uint32_t texture, float priority)
+{
+	Textures[texture].Priority = priority;
+}
+
+void TextureStreamScheduler::SetMipSizes(uint32_t texture, const size_t* mipSizes, uint32_t mipCount)
+{
+	Entry& entry = Textures[texture];
+	entry.MipSizes.assign(mipSizes, mipSizes + mipCount);
+	entry.ScheduledMip = mipCount;
+	entry.ResidentMip = mipCount;
+}
+
+void TextureStreamScheduler::SetTargetMip(uint32_t texture, uint32_t mip)
+{
+	Textures[texture].TargetMip = mip;
+}
+
+void TextureStreamScheduler::Schedule(size_t budget, std::vector<TextureStreamUpload>& uploads)
+{
+	// Busy only turns on for this call's textures once it is done, they can take several mips in one batch
+	const size_t firstUpload = uploads.size();
+	size_t scheduled = 0;
+	bool first = true;
+	for (;;)
+	{
+		const Entry* best = nullptr;
+		uint32_t bestTexture = 0;
+		for (uint32_t texture = 0; texture < Textures.size(); texture++)
+		{
+			const Entry& entry = Textures[texture];
+			if (entry.Busy || entry.ScheduledMip <= entry.TargetMip)
+			{
+				continue;
+			}
+			if (best)
+			{
+				const bool untouched = entry.ScheduledMip == entry.MipSizes.size();
+				const bool bestUntouched = best->ScheduledMip == best->MipSizes.size();
+				if (untouched != bestUntouched)
+				{
+					if (!untouched)
+					{
+						continue;
+					}
+				}
+				else if (entry.Priority != best->Priority)
+				{
+					if (entry.Priority < best->Priority)
+					{
+						continue;
+					}
+				}
+				else if (entry.MipSizes[entry.ScheduledMip - 1] >= best->MipSizes[best->ScheduledMip - 1])
+				{
+					continue;
+				}
+			}
+			best = &entry;
+			bestTexture = texture;
+		}
+		const size_t size = best ? best->MipSizes[best->ScheduledMip - 1] : 0;
+		if (!best || (!first && scheduled + size > budget))
+		{
+			break;
+		}
+
+		const uint32_t mip = best->ScheduledMip - 1;
+		uploads.push_back({ bestTexture, mip, size });
+		Textures[bestTexture].ScheduledMip = mip;
+		scheduled += size;
+		first = false;
+	}
+
+	for (size_t n = firstUpload; n < uploads.size(); n++)
+	{
+		Textures[uploads[n].Texture].Busy = true;
+	}
+}
+
+void TextureStreamScheduler::ScheduleEvictions(std::vector<TextureStreamEviction>& evictions)
+{
+	for (uint32_t texture = 0; texture < Textures.size(); texture++)
+	{
+		Entry& entry = Textures[texture];
+		if (!entry.Busy && entry.ResidentMip < entry.TargetMip && entry.TargetMip < entry.MipSizes.size())
+		{
+			evictions.push_back({ texture, entry.TargetMip });
+			entry.ScheduledMip = entry.TargetMip;
+			entry.Busy = true;
+		}
+	}
+}
+
+void TextureStreamScheduler::Complete(const TextureStreamUpload& upload)
+{
+	Entry& entry = Textures[upload.Texture];
+	entry.ResidentMip = (std::min)(entry.ResidentMip, upload.Mip);
+	// The batch's uploads complete in order, only its last one ends it
+	if (upload.Mip == entry.ScheduledMip)
+	{
+		entry.Busy = false;
+	}
+}
+
+void TextureStreamScheduler::Complete(const TextureStreamEviction& eviction)
+{
+	Entry& entry = Textures[eviction.Texture];
+	entry.ResidentMip = eviction.Mip;
+	entry.Busy = false;
+}
+
+size_t TextureStreamScheduler::GetPendingBytes() const
+{
+	size_t bytes = 0;
+	for (const Entry& entry : Textures)
+	{
+		for (uint32_t mip = entry.TargetMip; mip < entry.ScheduledMip; mip++)
+		{
+			bytes += entry.MipSizes[mip];
+		}
+	}
+	return bytes;
+}
+
+TextureStreamer::TextureStreamer(uint32_t threadCount)
+	: Pool(threadCount)
+	, Parsing(0)
+	, Stopping(false)
+{
+	Worker = std::thread(&TextureStreamer::WorkerLoop, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Stopping = true;
+	}
+	WorkReady.notify_all();
+	Worker.join();
+}
+
+uint32_t TextureStreamer::Request(const std::filesystem::path& path, float priority)
+{
+	const uint32_t texture = Scheduler.Add(priority);
+	Residency.Add();
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		std::unique_ptr<Source> source = std::make_unique<Source>();
+		source->Path = path;
+		source->Priority = priority;
+		Sources.push_back(std::move(source));
+		Pending.push_back(texture);
+	}
+	WorkReady.notify_all();
+	return texture;
+}
+
+void TextureStreamer::SetPriority(uint32_t texture, float priority)
+{
+	Scheduler.SetPriority(texture, priority);
+	std::lock_guard<std::mutex> lock(Mutex);
+	Sources[texture]->Priority = priority;
+}
+
+void TextureStreamer::Update(size_t uploadBudget, size_t residencyBudget, std::vector<uint32_t>& parsed, std::vector<TextureStreamUpload>& uploads,
+	std::vector<TextureStreamEviction>& evictions)
+{
+	std::vector<uint32_t> published;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		published.swap(Parsed);
+	}
+
+	std::vector<size_t> mipSizes;
+	for (uint32_t texture : published)
+	{
+		Source& source = *Sources[texture];
+		source.Published = true;
+		if (source.Failed)
+		{
+			continue;
+		}
+
+		// A level's upload covers that mip of every array slice, volume mips hold all their depth slices
+		const DDSTexture& dds = source.Texture;
+		mipSizes.assign(dds.MipCount, 0);
+		for (uint32_t item = 0; item < dds.ArraySize; item++)
+		{
+			for (uint32_t mip = 0; mip < dds.MipCount; mip++)
+			{
+				const size_t depth = (std::max)(1u, dds.Depth >> mip);
+				mipSizes[mip] += static_cast<size_t>(dds.Subresources[item * dds.MipCount + mip].SlicePitch) * depth;
+			}
+		}
+		Scheduler.SetMipSizes(texture, mipSizes.data(), dds.MipCount);
+		Residency.SetMipSizes(texture, mipSizes.data(), dds.MipCount);
+		parsed.push_back(texture);
+	}
+
+	Residency.Update(residencyBudget);
+	for (uint32_t texture = 0; texture < Sources.size(); texture++)
+	{
+		if (Scheduler.GetMipCount(texture) > 0)
+		{
+			Scheduler.SetTargetMip(texture, Residency.GetTargetMip(texture));
+		}
+	}
+	Scheduler.ScheduleEvictions(evictions);
+	Scheduler.Schedule(uploadBudget, uploads);
+}
+
+bool TextureStreamer::HasFailed(uint32_t texture) const
+{
+	return Sources[texture]->Published && Sources[texture]->Failed;
+}
+
+bool TextureStreamer::IsIdle() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return Pending.empty() && Parsing == 0 && Parsed.empty() && Scheduler.GetPendingBytes() == 0;
+}
+
+// Batches are as large as the pool so the highest priorities still waiting go first whenever a batch finishes
+void TextureStreamer::WorkerLoop()
+{
+	std::vector<uint32_t> batch;
+	std::vector<Source*> sources;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			WorkReady.wait(lock, [this] { return Stopping || !Pending.empty(); });
+			if (Stopping)
+			{
+				return;
+			}
+
+			std::stable_sort(Pending.begin(), Pending.end(), [this](uint32_t a, uint32_t b) { return Sources[a]->Priority > Sources[b]->Priority; });
+			const size_t count = (std::min)(Pending.size(), static_cast<size_t>(Pool.GetThreadCount()));
+			batch.assign(Pending.begin(), Pending.begin() + count);
+			Pending.erase(Pending.begin(), Pending.begin() + count);
+			sources.clear();
+			for (uint32_t texture : batch)
+			{
+				sources.push_back(Sources[texture].get());
+			}
+			Parsing = static_cast<uint32_t>(count);
+		}
+
+		Pool.ParallelFor(sources.size(), [&sources](size_t begin, size_t end, uint32_t)
+		{
+			for (size_t n = begin; n < end; n++)
+			{
+				Source& source = *sources[n];
+				source.Failed = !source.File.Open(source.Path) || !ParseDDS(source.File.GetData(), source.File.GetSize(), source.Texture);
+				if (source.Failed)
+				{
+					source.File.Close();
+				}
+			}
+		});
+
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			Parsed.insert(Parsed.end(), batch.begin(), batch.end());
+			Parsing = 0;
+		}
+	}
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "DDSFile.h"
+#include "MappedFile.h"
+#include "TextureResidency.h"
+#include "ThreadPool.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Texture streaming without D3D: a worker thread maps and parses requested DDS files and a scheduler hands out mip uploads
+// under a per frame byte budget. The game records the uploads on the copy queue and reports them back once their fence passed.
+// Mips go coarsest first so a texture is usable after its first tiny upload and sharpens from there, down to the target mip
+// TextureResidency picks. Textures whose target got coarser than what they hold are evicted down to it.
+
+// One mip level of one texture, every array slice of it
+struct TextureStreamUpload
+{
+	uint32_t Texture;
+	uint32_t Mip;
+	size_t Size; // Source bytes across all slices
+};
+
+// The top mips of a texture above Mip leave memory
+struct TextureStreamEviction
+{
+	uint32_t Texture;
+	uint32_t Mip;
+};
+
+// Which mip goes next. Textures with nothing uploaded yet come first, so every texture shows up before any gets sharper,
+// then higher priority, then the cheaper upload, then the order they were added in. A texture has one batch of work in flight
+// at a time, its uploads or eviction are skipped until the last one completed.
+class TextureStreamScheduler
+{
+public:
+
+	// A texture whose mip chain isn't known yet, it isn't scheduled before SetMipSizes
+	uint32_t Add(float priority);
+	void SetPriority(uint32_t texture, float priority);
+
+	// mipSizes[0] is the largest level
+	void SetMipSizes(uint32_t texture, const size_t* mipSizes, uint32_t mipCount);
+
+	// Finest mip to stream in, 0 until set
+	void SetTargetMip(uint32_t texture, uint32_t mip);
+
+	// Appends uploads until the next one would go over budget. The first upload of a call always goes, however large,
+	// so a mip bigger than the budget doesn't stall the queue.
+	void Schedule(size_t budget, std::vector<TextureStreamUpload>& uploads);
+
+	// Appends an eviction for every idle texture holding mips finer than its target
+	void ScheduleEvictions(std::vector<TextureStreamEviction>& evictions);
+
+	// Uploads of a texture complete in the order they were scheduled in
+	void Complete(const TextureStreamUpload& upload);
+	void Complete(const TextureStreamEviction& eviction);
+
+	// Finest mip whose upload completed, GetMipCount when none has
+	uint32_t GetResidentMip(uint32_t texture) const { return Textures[texture].ResidentMip; }
+	uint32_t GetMipCount(uint32_t texture) const { return static_cast<uint32_t>(Textures[texture].MipSizes.size()); }
+
+	// Bytes not scheduled yet down to the targets of every texture with a known mip chain
+	size_t GetPendingBytes() const;
+
+private:
+
+	struct Entry
+	{
+		float Priority;
+		std::vector<size_t> MipSizes;
+		uint32_t ScheduledMip; // Next upload is ScheduledMip - 1
+		uint32_t ResidentMip;
+		uint32_t TargetMip;
+		bool Busy; // Uploads or an eviction in flight
+	};
+
+	std::vector<Entry> Textures;
+};
+
+// Mapping and parsing run on a worker thread which spreads each batch of requests over its own ThreadPool,
+// highest priority first. Everything else, Update, Complete and the getters, belongs to the thread that made the requests.
+class TextureStreamer
+{
+public:
+
+	explicit TextureStreamer(uint32_t threadCount = 2);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	uint32_t Request(const std::filesystem::path& path, float priority);
+	void SetPriority(uint32_t texture, float priority);
+
+	// A draw samples a parsed texture down to finestMip this frame, see TextureResidency::Use
+	void Use(uint32_t texture, uint32_t finestMip) { Residency.Use(texture, finestMip); }
+
+	// Once a frame: appends the textures parsed since the last call to parsed, picks the residency targets under
+	// residencyBudget bytes, and schedules evictions and up to uploadBudget bytes of uploads
+	void Update(size_t uploadBudget, size_t residencyBudget, std::vector<uint32_t>& parsed, std::vector<TextureStreamUpload>& uploads,
+		std::vector<TextureStreamEviction>& evictions);
+
+	// The upload's copy or the eviction finished
+	void Complete(const TextureStreamUpload& upload) { Scheduler.Complete(upload); }
+	void Complete(const TextureStreamEviction& eviction) { Scheduler.Complete(eviction); }
+
+	// Valid once the texture was reported as parsed. The file stays mapped and the subresources point into it,
+	// evicted mips are uploaded from there again when they are needed back.
+	const DDSTexture& GetTexture(uint32_t texture) const { return Sources[texture]->Texture; }
+
+	// Failed textures are never reported as parsed
+	bool HasFailed(uint32_t texture) const;
+	uint32_t GetResidentMip(uint32_t texture) const { return Scheduler.GetResidentMip(texture); }
+	uint32_t GetTargetMip(uint32_t texture) const { return Residency.GetTargetMip(texture); }
+	uint32_t GetMipCount(uint32_t texture) const { return Scheduler.GetMipCount(texture); }
+	size_t GetTargetBytes() const { return Residency.GetTargetBytes(); }
+
+	// Nothing waiting to be parsed or scheduled
+	bool IsIdle() const;
+
+private:
+
+	void WorkerLoop();
+
+	struct Source
+	{
+		std::filesystem::path Path;
+		float Priority;
+		MappedFile File;
+		DDSTexture Texture;
+		bool Failed = false;
+		bool Published = false; // Set by Update, only then the worker is done with the rest
+	};
+
+	TextureStreamScheduler Scheduler;
+	TextureResidency Residency;
+	ThreadPool Pool;
+	std::thread Worker;
+
+	// Guards everything below. Only the requesting thread grows Sources, a Source's file and texture belong to the worker until Update publishes it.
+	mutable std::mutex Mutex;
+	std::condition_variable WorkReady;
+	std::vector<std::unique_ptr<Source>> Sources;
+	std::vector<uint32_t> Pending;
+	std::vector<uint32_t> Parsed;
+	uint32_t Parsing;
+	bool Stopping;
+};
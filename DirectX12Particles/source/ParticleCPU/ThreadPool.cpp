@@ -0,0 +1,95 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+	: Function(nullptr)
+	, Count(0)
+	, Generation(0)
+	, PendingWorkers(0)
+	, Stopping(false)
+{
+	threadCount = threadCount > 0 ? threadCount : 1;
+	for (uint32_t worker = 1; worker < threadCount; ++worker)
+	{
+		Workers.emplace_back(&ThreadPool::WorkerLoop, this, worker);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Stopping = true;
+	}
+	WorkReady.notify_all();
+
+	for (std::thread& worker : Workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t begin, size_t end, uint32_t chunk)>& function)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (Workers.empty())
+	{
+		function(0, count, 0);
+		return;
+	}
+
+	std::lock_guard<std::mutex> callerLock(CallerMutex);
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Function = &function;
+		Count = count;
+		PendingWorkers = static_cast<uint32_t>(Workers.size());
+		++Generation;
+	}
+	WorkReady.notify_all();
+
+	RunChunk(0);
+
+	std::unique_lock<std::mutex> lock(Mutex);
+	WorkDone.wait(lock, [this] { return PendingWorkers == 0; });
+	Function = nullptr;
+}
+
+void ThreadPool::WorkerLoop(uint32_t worker)
+{
+	uint64_t seenGeneration = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			WorkReady.wait(lock, [&] { return Stopping || Generation != seenGeneration; });
+			if (Stopping)
+			{
+				return;
+			}
+			seenGeneration = Generation;
+		}
+
+		RunChunk(worker);
+
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			--PendingWorkers;
+		}
+		WorkDone.notify_one();
+	}
+}
+
+void ThreadPool::RunChunk(uint32_t chunk)
+{
+	const size_t chunkCount = GetThreadCount();
+	const size_t begin = Count * chunk / chunkCount;
+	const size_t end = Count * (chunk + 1) / chunkCount;
+	if (begin < end)
+	{
+		(*Function)(begin, end, chunk);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for the CPU particle backend, the calling thread always takes part in the work
+class ThreadPool
+{
+public:
+
+	explicit ThreadPool(uint32_t threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(Workers.size()) + 1; }
+
+	// Splits [0, count) into one contiguous range per thread and blocks until every range has run.
+	// Ranges are ordered, range n goes to the function with chunk = n, empty ranges are skipped.
+	// Calls from several threads take turns on the workers, a call from inside function deadlocks.
+	void ParallelFor(size_t count, const std::function<void(size_t begin, size_t end, uint32_t chunk)>& function);
+
+private:
+
+	void WorkerLoop(uint32_t worker);
+	void RunChunk(uint32_t chunk);
+
+	std::vector<std::thread> Workers;
+	std::mutex CallerMutex; // Held for a whole ParallelFor
+	std::mutex Mutex;
+	std::condition_variable WorkReady;
+	std::condition_variable WorkDone;
+
+	const std::function<void(size_t, size_t, uint32_t)>* Function;
+	size_t Count;
+	uint64_t Generation;
+	uint32_t PendingWorkers;
+	bool Stopping;
+};
@@ -0,0 +1,131 @@
+#include "TiledRaster.h"
+
+#include <algorithm>
+
+TiledRasterCPU::TiledRasterCPU(ThreadPool& pool)
+	: Pool(pool)
+{
+}
+
+size_t TiledRasterCPU::Bin(const std::vector<Particle>& particles, const std::vector<uint>& drawList, const TileRasterConstants& constants)
+{
+	const uint tileCount = constants.TileCount.x * constants.TileCount.y;
+	const uint chunkCount = Pool.GetThreadCount();
+
+	Constants = constants;
+	Footprints.resize(drawList.size());
+	ChunkOffsets.assign(static_cast<size_t>(chunkCount) * tileCount, 0u);
+	TileOffsets.resize(static_cast<size_t>(tileCount) + 1);
+
+	Pool.ParallelFor(drawList.size(), [&](size_t begin, size_t end, uint32_t chunk)
+	{
+		uint* counts = &ChunkOffsets[static_cast<size_t>(chunk) * tileCount];
+		for (size_t n = begin; n < end; ++n)
+		{
+			const ParticleFootprint footprint = ProjectParticle(particles[drawList[n]], constants);
+			Footprints[n] = footprint;
+			if (!footprint.Valid)
+			{
+				continue;
+			}
+
+			const uint4 tiles = FootprintTiles(footprint, constants);
+			for (uint y = tiles.y; y <= tiles.w; ++y)
+			{
+				for (uint x = tiles.x; x <= tiles.z; ++x)
+				{
+					++counts[y * constants.TileCount.x + x];
+				}
+			}
+		}
+	});
+
+	uint sum = 0;
+	for (uint tile = 0; tile < tileCount; ++tile)
+	{
+		TileOffsets[tile] = sum;
+		for (uint chunk = 0; chunk < chunkCount; ++chunk)
+		{
+			uint& offset = ChunkOffsets[static_cast<size_t>(chunk) * tileCount + tile];
+			const uint chunkEntries = offset;
+			offset = sum;
+			sum += chunkEntries;
+		}
+	}
+	TileOffsets[tileCount] = sum;
+	TileEntries.resize(sum);
+
+	Pool.ParallelFor(drawList.size(), [&](size_t begin, size_t end, uint32_t chunk)
+	{
+		uint* offsets = &ChunkOffsets[static_cast<size_t>(chunk) * tileCount];
+		for (size_t n = begin; n < end; ++n)
+		{
+			const ParticleFootprint& footprint = Footprints[n];
+			if (!footprint.Valid)
+			{
+				continue;
+			}
+
+			const uint4 tiles = FootprintTiles(footprint, constants);
+			for (uint y = tiles.y; y <= tiles.w; ++y)
+			{
+				for (uint x = tiles.x; x <= tiles.z; ++x)
+				{
+					TileEntries[offsets[y * constants.TileCount.x + x]++] = static_cast<uint>(n);
+				}
+			}
+		}
+	});
+
+	return sum;
+}
+
+uint TiledRasterCPU::GetTileEntryCount(uint tile) const
+{
+	const uint count = TileOffsets[tile + 1] - TileOffsets[tile];
+	if (!TileListFits(TileOffsets[tile], count, Constants))
+	{
+		return 0;
+	}
+	return (std::min)(count, static_cast<uint>(TILE_RASTER_MAX_ENTRIES));
+}
+
+void TiledRasterCPU::Composite(const std::vector<Particle>& particles, const std::vector<uint>& drawList, const TileRasterConstants& constants,
+	const std::vector<float>& depth, const std::vector<float>& textureAlpha, uint2 textureSize, std::vector<float4>& color)
+{
+	const uint tileCount = constants.TileCount.x * constants.TileCount.y;
+
+	Pool.ParallelFor(tileCount, [&](size_t begin, size_t end, uint32_t)
+	{
+		for (size_t tile = begin; tile < end; ++tile)
+		{
+			const uint tileX = static_cast<uint>(tile % constants.TileCount.x) * TILE_RASTER_SIZE;
+			const uint tileY = static_cast<uint>(tile / constants.TileCount.x) * TILE_RASTER_SIZE;
+			const uint* entries = GetTileEntries(static_cast<uint>(tile));
+			const uint entryCount = GetTileEntryCount(static_cast<uint>(tile));
+
+			for (uint y = tileY; y < (std::min)(tileY + TILE_RASTER_SIZE, constants.Dimensions.y); ++y)
+			{
+				for (uint x = tileX; x < (std::min)(tileX + TILE_RASTER_SIZE, constants.Dimensions.x); ++x)
+				{
+					const size_t pixel = static_cast<size_t>(y) * constants.Dimensions.x + x;
+					const float2 pixelCenter(x + 0.5f, y + 0.5f);
+					float4 pixelColor = color[pixel];
+
+					for (uint n = 0; n < entryCount; ++n)
+					{
+						const ParticleFootprint& footprint = Footprints[entries[n]];
+						if (footprint.Depth < depth[pixel] && FootprintCovers(footprint, pixelCenter))
+						{
+							const int2 texel = FootprintTexel(footprint, pixelCenter, textureSize);
+							const float alpha = textureAlpha[static_cast<size_t>(texel.y) * textureSize.x + texel.x];
+							pixelColor = TileRasterBlend(pixelColor, alpha * particles[drawList[entries[n]]].color, constants.AlphaBlend);
+						}
+					}
+
+					color[pixel] = pixelColor;
+				}
+			}
+		}
+	});
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../ParticleGame/TiledRaster.hlsli"
+#include "ThreadPool.h"
+
+#include <vector>
+
+// CPU reference of ComputeTileBin.hlsl and ComputeTileRaster.hlsl, runs headless so binning throughput can be timed on its own.
+// Images are Dimensions.x * Dimensions.y row-major, depth holds raw depth buffer values.
+class TiledRasterCPU
+{
+public:
+
+	explicit TiledRasterCPU(ThreadPool& pool);
+
+	// Bins draw list positions into tiles and returns the number of tile entries, including ones past a full tile.
+	// Per chunk counts are scanned tile major, chunk minor, so every tile list comes out in draw order without the GPU's sort.
+	size_t Bin(const std::vector<Particle>& particles, const std::vector<uint>& drawList, const TileRasterConstants& constants);
+
+	// Blends the binned particles over color, textureAlpha is the particle texture's alpha channel
+	void Composite(const std::vector<Particle>& particles, const std::vector<uint>& drawList, const TileRasterConstants& constants,
+		const std::vector<float>& depth, const std::vector<float>& textureAlpha, uint2 textureSize, std::vector<float4>& color);
+
+	// Binned draw positions of a tile, the first TILE_RASTER_MAX_ENTRIES in draw order like the composite pass keeps them.
+	// A tile whose list runs past TileListFits' capacity has none, like on the GPU.
+	uint GetTileEntryCount(uint tile) const;
+	const uint* GetTileEntries(uint tile) const { return &TileEntries[TileOffsets[tile]]; }
+
+private:
+
+	ThreadPool& Pool;
+
+	std::vector<ParticleFootprint> Footprints; // Per draw list position
+	std::vector<uint> ChunkOffsets; // Chunk major, one entry per tile
+	std::vector<uint> TileOffsets; // Tile count + 1 prefix sums into TileEntries
+	std::vector<uint> TileEntries;
+	TileRasterConstants Constants = {};
+};
@@ -0,0 +1,55 @@
+#include "Trail.h"
+
+std::vector<uint> BuildTrailIndices(uint maxTrailCount)
+{
+	std::vector<uint> indices;
+	indices.reserve(static_cast<size_t>(maxTrailCount) * TRAIL_INDICES_PER_PARTICLE);
+	for (uint trail = 0; trail < maxTrailCount; ++trail)
+	{
+		const uint firstVertex = trail * TRAIL_VERTICES_PER_PARTICLE;
+		for (uint segment = 0; segment < TRAIL_LENGTH - 1; ++segment)
+		{
+			// Vertices 2 * age and 2 * age + 1 are the two sides at one sample
+			const uint v0 = firstVertex + 2 * segment;
+			indices.insert(indices.end(), { v0, v0 + 1, v0 + 2, v0 + 2, v0 + 1, v0 + 3 });
+		}
+	}
+	return indices;
+}
+
+void WriteTrailHistory(std::vector<float4>& history, uint head, uint particleIndex, uint maxParticleCount, const Particle& particle, bool restart)
+{
+	const float4 trailSample = TrailSample(particle);
+	if (!restart)
+	{
+		history[TrailHistoryIndex(head, particleIndex, maxParticleCount)] = trailSample;
+		return;
+	}
+	for (uint slot = 0; slot < TRAIL_LENGTH; ++slot)
+	{
+		history[TrailHistoryIndex(slot, particleIndex, maxParticleCount)] = trailSample;
+	}
+}
+
+void GenerateTrailStrips(const std::vector<Particle>& particles, const std::vector<uint>& drawIndices, const std::vector<float4>& history,
+	const TrailConstants& constants, std::vector<TrailVertex>& vertices)
+{
+	vertices.resize(drawIndices.size() * TRAIL_VERTICES_PER_PARTICLE);
+	for (size_t n = 0; n < drawIndices.size(); ++n)
+	{
+		const uint particleIndex = drawIndices[n];
+		float4 samples[TRAIL_LENGTH];
+		for (uint age = 0; age < TRAIL_LENGTH; ++age)
+		{
+			samples[age] = history[TrailHistoryIndex(TrailSlot(constants.Head, age), particleIndex, constants.MaxParticleCount)];
+		}
+
+		TrailVertex* trail = &vertices[n * TRAIL_VERTICES_PER_PARTICLE];
+		for (uint age = 0; age < TRAIL_LENGTH; ++age)
+		{
+			const float3 tangent = TrailTangent(samples[age == 0 ? 0 : age - 1], samples[(min)(age + 1, static_cast<uint>(TRAIL_LENGTH - 1))]);
+			trail[2 * age] = MakeTrailVertex(samples[age], tangent, -1.0f, age, particles[particleIndex].color, constants);
+			trail[2 * age + 1] = MakeTrailVertex(samples[age], tangent, 1.0f, age, particles[particleIndex].color, constants);
+		}
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../ParticleGame/Trail.hlsli"
+
+#include <vector>
+
+// Indices of maxTrailCount ribbons, trail n uses vertices n * TRAIL_VERTICES_PER_PARTICLE onwards and every segment is two triangles.
+// The game draws the first visibleCount * TRAIL_INDICES_PER_PARTICLE of them.
+std::vector<uint> BuildTrailIndices(uint maxTrailCount);
+
+// Stores the particle's position in slot head of its history, or in every slot when the trail restarts
+void WriteTrailHistory(std::vector<float4>& history, uint head, uint particleIndex, uint maxParticleCount, const Particle& particle, bool restart);
+
+// CPU reference of ComputeTrails.hlsl, the ribbons of every particle in drawIndices in draw list order
+void GenerateTrailStrips(const std::vector<Particle>& particles, const std::vector<uint>& drawIndices, const std::vector<float4>& history,
+	const TrailConstants& constants, std::vector<TrailVertex>& vertices);
@@ -0,0 +1,296 @@
+#include "VectorField.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+static size_t VoxelCount(const uint resolution[3])
+{
+	return static_cast<size_t>(resolution[0]) * resolution[1] * resolution[2];
+}
+
+// Next number of a comma or whitespace separated list, false at the end of the text or on anything that isn't a number
+static bool NextNumber(const char*& cursor, float& value)
+{
+	while (*cursor == ',' || *cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')
+	{
+		++cursor;
+	}
+	char* end = nullptr;
+	value = strtof(cursor, &end);
+	if (end == cursor)
+	{
+		return false;
+	}
+	cursor = end;
+	return true;
+}
+
+bool LoadFGA(const std::filesystem::path& path, VectorFieldVolume& volume)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	const char* cursor = text.c_str();
+
+	float header[9];
+	for (float& value : header)
+	{
+		if (!NextNumber(cursor, value))
+		{
+			return false;
+		}
+	}
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (header[axis] < 1.0f)
+		{
+			return false;
+		}
+		volume.Resolution[axis] = static_cast<uint>(header[axis]);
+	}
+	volume.BoundsMin = float3(header[3], header[4], header[5]);
+	volume.BoundsMax = float3(header[6], header[7], header[8]);
+
+	volume.Texels.resize(VoxelCount(volume.Resolution));
+	for (float4& texel : volume.Texels)
+	{
+		if (!NextNumber(cursor, texel.x) || !NextNumber(cursor, texel.y) || !NextNumber(cursor, texel.z))
+		{
+			volume.Texels.clear();
+			return false;
+		}
+		texel.w = 0.0f;
+	}
+	return true;
+}
+
+bool LoadRawVectorField(const std::filesystem::path& path, const uint resolution[3], float3 boundsMin, float3 boundsMax, VectorFieldVolume& volume)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::vector<float> vectors(VoxelCount(resolution) * 3);
+	file.read(reinterpret_cast<char*>(vectors.data()), vectors.size() * sizeof(float));
+	if (!file || vectors.empty())
+	{
+		return false;
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		volume.Resolution[axis] = resolution[axis];
+	}
+	volume.BoundsMin = boundsMin;
+	volume.BoundsMax = boundsMax;
+	volume.Texels.resize(VoxelCount(resolution));
+	for (size_t n = 0; n < volume.Texels.size(); ++n)
+	{
+		volume.Texels[n] = float4(vectors[n * 3], vectors[n * 3 + 1], vectors[n * 3 + 2], 0.0f);
+	}
+	return true;
+}
+
+float3 SampleVectorField(const VectorFieldVolume& volume, float3 uvw)
+{
+	// Texel centers sit at (i + 0.5) / resolution, clamp addressing repeats the edge texels
+	const float coordinates[3] = { uvw.x, uvw.y, uvw.z };
+	uint lower[3];
+	uint upper[3];
+	float weight[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float size = static_cast<float>(volume.Resolution[axis]);
+		const float texel = (min)((max)(coordinates[axis] * size - 0.5f, 0.0f), size - 1.0f);
+		const float base = std::floor(texel);
+		lower[axis] = static_cast<uint>(base);
+		upper[axis] = (min)(lower[axis] + 1, volume.Resolution[axis] - 1);
+		weight[axis] = texel - base;
+	}
+
+	auto texel = [&](uint x, uint y, uint z)
+	{
+		const float4& value = volume.Texels[(static_cast<size_t>(z) * volume.Resolution[1] + y) * volume.Resolution[0] + x];
+		return float3(value.x, value.y, value.z);
+	};
+	const float3 front = lerp(lerp(texel(lower[0], lower[1], lower[2]), texel(upper[0], lower[1], lower[2]), weight[0]),
+		lerp(texel(lower[0], upper[1], lower[2]), texel(upper[0], upper[1], lower[2]), weight[0]), weight[1]);
+	const float3 back = lerp(lerp(texel(lower[0], lower[1], upper[2]), texel(upper[0], lower[1], upper[2]), weight[0]),
+		lerp(texel(lower[0], upper[1], upper[2]), texel(upper[0], upper[1], upper[2]), weight[0]), weight[1]);
+	return lerp(front, back, weight[2]);
+}
+
+VectorFieldStream::VectorFieldStream(std::vector<std::filesystem::path> frames, float framesPerSecond, Loader loader, uint lookahead)
+	: Frames(std::move(frames))
+	, FramesPerSecond(framesPerSecond)
+	, LoadFrame(std::move(loader))
+	, Lookahead(lookahead)
+	, FrameIndex(0)
+	, Time(0)
+	, Playhead(0)
+	, Stopping(false)
+{
+	if (Frames.empty() || !LoadFrame(Frames[0], Frame))
+	{
+		Frame = VectorFieldVolume();
+		return;
+	}
+	if (Frames.size() > 1)
+	{
+		Worker = std::thread(&VectorFieldStream::WorkerLoop, this);
+	}
+}
+
+VectorFieldStream::~VectorFieldStream()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Stopping = true;
+	}
+	WorkReady.notify_all();
+	if (Worker.joinable())
+	{
+		Worker.join();
+	}
+}
+
+std::vector<std::filesystem::path> VectorFieldStream::FindSequence(const std::filesystem::path& first)
+{
+	std::vector<std::filesystem::path> frames;
+	if (!std::filesystem::exists(first))
+	{
+		return frames;
+	}
+	frames.push_back(first);
+
+	// The digits right before the extension are the frame number, their count is the zero padding
+	const std::string stem = first.stem().string();
+	size_t digits = 0;
+	while (digits < stem.size() && isdigit(static_cast<unsigned char>(stem[stem.size() - 1 - digits])))
+	{
+		++digits;
+	}
+	if (digits == 0)
+	{
+		return frames;
+	}
+
+	const std::string prefix = stem.substr(0, stem.size() - digits);
+	const std::string extension = first.extension().string();
+	for (unsigned long number = strtoul(stem.c_str() + prefix.size(), nullptr, 10) + 1;; ++number)
+	{
+		std::string numbered = std::to_string(number);
+		if (numbered.size() < digits)
+		{
+			numbered.insert(0, digits - numbered.size(), '0');
+		}
+		const std::filesystem::path next = first.parent_path() / (prefix + numbered + extension);
+		if (!std::filesystem::exists(next))
+		{
+			break;
+		}
+		frames.push_back(next);
+	}
+	return frames;
+}
+
+bool VectorFieldStream::Advance(float deltaTime)
+{
+	if (Frames.size() <= 1 || FramesPerSecond <= 0.0f)
+	{
+		return false;
+	}
+
+	Time = fmodf(Time + deltaTime, Frames.size() / FramesPerSecond);
+	const uint wanted = (min)(static_cast<uint>(Time * FramesPerSecond), static_cast<uint>(Frames.size()) - 1);
+	if (wanted == FrameIndex)
+	{
+		return false;
+	}
+
+	bool changed = false;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		auto frame = Loaded.find(wanted);
+		if (frame != Loaded.end())
+		{
+			// An empty entry is a frame that failed to load, the previous frame stays up over it
+			if (!frame->second.Empty())
+			{
+				Frame = std::move(frame->second);
+				changed = true;
+			}
+			FrameIndex = wanted;
+		}
+		// Loaded frames the playhead passed are dropped, the worker reloads them next loop
+		Playhead = wanted;
+		for (auto loaded = Loaded.begin(); loaded != Loaded.end();)
+		{
+			const uint ahead = (loaded->first + static_cast<uint>(Frames.size()) - wanted) % static_cast<uint>(Frames.size());
+			loaded = ahead == 0 || ahead > Lookahead ? Loaded.erase(loaded) : std::next(loaded);
+		}
+	}
+	WorkReady.notify_one();
+	return changed;
+}
+
+void VectorFieldStream::WorkerLoop()
+{
+	const uint frameCount = static_cast<uint>(Frames.size());
+	for (;;)
+	{
+		// Nearest frame from the playhead on that isn't loaded yet, the playhead's own frame too when Advance got there first
+		uint next = frameCount;
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			WorkReady.wait(lock, [&]()
+			{
+				if (Stopping)
+				{
+					return true;
+				}
+				for (uint ahead = Playhead == FrameIndex ? 1 : 0; ahead <= Lookahead && ahead < frameCount; ++ahead)
+				{
+					const uint frame = (Playhead + ahead) % frameCount;
+					if (Loaded.find(frame) == Loaded.end())
+					{
+						next = frame;
+						return true;
+					}
+				}
+				return false;
+			});
+			if (Stopping)
+			{
+				return;
+			}
+		}
+
+		// Parsing runs unlocked, Advance keeps going with the frames it already has
+		VectorFieldVolume volume;
+		const bool loaded = LoadFrame(Frames[next], volume);
+		const bool matches = loaded && volume.Resolution[0] == Frame.Resolution[0] && volume.Resolution[1] == Frame.Resolution[1] &&
+			volume.Resolution[2] == Frame.Resolution[2];
+		if (!matches)
+		{
+			// An unusable frame is replaced with an empty one, Advance then holds the previous frame over it
+			volume = VectorFieldVolume();
+		}
+
+		std::lock_guard<std::mutex> lock(Mutex);
+		const uint ahead = (next + frameCount - Playhead) % frameCount;
+		if ((ahead != 0 || Playhead != FrameIndex) && ahead <= Lookahead)
+		{
+			Loaded[next] = std::move(volume);
+		}
+	}
+}
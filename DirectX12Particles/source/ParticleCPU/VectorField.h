@@ -0,0 +1,82 @@
+#pragma once
+
+#include "../ParticleGame/VectorField.hlsli"
+
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A grid of vectors over an axis aligned box in the field's own space, x fastest then y then z like a D3D12 3D subresource.
+// The w channel is unused, it keeps texels the size of an R32G32B32A32_FLOAT texel.
+struct VectorFieldVolume
+{
+	uint Resolution[3] = {};
+	float3 BoundsMin;
+	float3 BoundsMax;
+	std::vector<float4> Texels;
+
+	bool Empty() const { return Texels.empty(); }
+};
+
+// FGA text, as written by Maya and Houdini exporters: resolution, bounds min, bounds max, then one vector per voxel, comma separated
+bool LoadFGA(const std::filesystem::path& path, VectorFieldVolume& volume);
+
+// Headerless little endian float3 per voxel, the resolution and bounds come from the caller
+bool LoadRawVectorField(const std::filesystem::path& path, const uint resolution[3], float3 boundsMin, float3 boundsMax, VectorFieldVolume& volume);
+
+// CPU version of SampleLevel with a trilinear clamp sampler at texture coordinates uvw.
+// The GPU filter weights only have 8 fractional bits, so results agree to about 1/256 of the difference between neighboring texels.
+float3 SampleVectorField(const VectorFieldVolume& volume, float3 uvw);
+
+// Plays back a numbered sequence of field files, a worker thread loads the frames ahead of the playhead so Advance never parses.
+// A single file is a one frame sequence and starts no thread.
+class VectorFieldStream
+{
+public:
+
+	using Loader = std::function<bool(const std::filesystem::path& path, VectorFieldVolume& volume)>;
+
+	// Frame 0 is loaded before returning so the resolution is known up front. Frames with a different resolution than frame 0 are skipped.
+	VectorFieldStream(std::vector<std::filesystem::path> frames, float framesPerSecond, Loader loader = LoadFGA, uint lookahead = 3);
+	~VectorFieldStream();
+
+	VectorFieldStream(const VectorFieldStream&) = delete;
+	VectorFieldStream& operator=(const VectorFieldStream&) = delete;
+
+	// first and the files numbered after it, "Wind_0000.fga" finds "Wind_0001.fga" and so on until one is missing
+	static std::vector<std::filesystem::path> FindSequence(const std::filesystem::path& first);
+
+	bool Valid() const { return !Frame.Empty(); }
+	uint GetFrameCount() const { return static_cast<uint>(Frames.size()); }
+
+	// Moves the looping playhead. Returns true when the shown frame changed, a frame the worker hasn't loaded yet keeps the old one.
+	bool Advance(float deltaTime);
+
+	// The shown frame, stays valid until the next Advance
+	const VectorFieldVolume& Current() const { return Frame; }
+
+private:
+
+	void WorkerLoop();
+
+	std::vector<std::filesystem::path> Frames;
+	float FramesPerSecond;
+	Loader LoadFrame;
+	uint Lookahead;
+
+	VectorFieldVolume Frame;
+	uint FrameIndex; // Written by Advance under Mutex, the worker compares it with Playhead
+	float Time;
+
+	std::thread Worker;
+	std::mutex Mutex;
+	std::condition_variable WorkReady;
+	std::map<uint, VectorFieldVolume> Loaded; // Frames the worker finished, guarded by Mutex
+	uint Playhead; // Frame the worker loads ahead of, guarded by Mutex
+	bool Stopping;
+};
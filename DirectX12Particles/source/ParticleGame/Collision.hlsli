@@ -0,0 +1,120 @@
+#ifndef COLLISION_HLSLI
+#define COLLISION_HLSLI
+
+#include "Particle.hlsli"
+
+// Broadphase grid cells per axis, every cell stores a bit mask of the planes that can be hit from inside it
+#define COLLISION_GRID_SIZE 16
+#define COLLISION_MAX_PLANES 32
+#define COLLISION_NO_HIT 2.0f
+
+// World space rectangle of one room plane, built from the same data VertexPlane.hlsl draws
+struct CollisionPlane
+{
+    float4 Plane; // Unit normal and -dot(normal, center)
+    float4 AxisU; // Unit edge direction and half extent along it
+    float4 AxisV;
+    float4 Center;
+};
+
+struct CollisionConstants
+{
+    float3 GridMin;
+    float CellSize;
+    uint PlaneCount;
+    float Restitution; // Fraction of the normal velocity kept after a bounce
+    float Friction; // Fraction of the tangential velocity lost per hit
+    float RadiusScale; // Collision radius = particle scale * RadiusScale
+    uint KillOnHit;
+    uint Enabled;
+    uint DepthEnabled; // Also collide with the previous frame's depth buffer, see DepthCollision.hlsli
+    float DepthThickness; // How far behind the depth buffer surface a particle still counts as touching it
+};
+
+// Rodrigues rotation, matches AngleAxis3x3 in VertexPlane.hlsl. A zero axis with a zero angle is the identity.
+SHARED_INLINE float3 CollisionRotate(float3 v, float3 axis, float angle)
+{
+    float s = sin(angle);
+    float c = cos(angle);
+    return v * c + cross(axis, v) * s + axis * (dot(axis, v) * (1.0f - c));
+}
+
+// scale is the half extent of the [-1, 1] plane quad along its local x and y
+SHARED_INLINE CollisionPlane MakeCollisionPlane(float3 position, float3 axisOfRotation, float2 scale, float rotation)
+{
+    float3 u = CollisionRotate(float3(1, 0, 0), axisOfRotation, rotation);
+    float3 v = CollisionRotate(float3(0, 1, 0), axisOfRotation, rotation);
+    float3 normal = cross(u, v);
+
+    CollisionPlane plane;
+    plane.Plane = float4(normal, -dot(normal, position));
+    plane.AxisU = float4(u, scale.x);
+    plane.AxisV = float4(v, scale.y);
+    plane.Center = float4(position, 1);
+    return plane;
+}
+
+// Index into the broadphase mask grid, or COLLISION_GRID_SIZE^3 outside of it
+SHARED_INLINE uint CollisionGridCell(float3 position, CollisionConstants constants)
+{
+    float3 cell = floor((position - constants.GridMin) / constants.CellSize);
+    if (cell.x < 0 || cell.y < 0 || cell.z < 0 || cell.x >= COLLISION_GRID_SIZE || cell.y >= COLLISION_GRID_SIZE || cell.z >= COLLISION_GRID_SIZE)
+    {
+        return COLLISION_GRID_SIZE * COLLISION_GRID_SIZE * COLLISION_GRID_SIZE;
+    }
+    return (uint(cell.z) * COLLISION_GRID_SIZE + uint(cell.y)) * COLLISION_GRID_SIZE + uint(cell.x);
+}
+
+SHARED_INLINE float3 CollisionPlaneNormal(CollisionPlane plane)
+{
+    return float3(plane.Plane.x, plane.Plane.y, plane.Plane.z);
+}
+
+// Fraction of the step from -> to at which a sphere of the given radius touches the rectangle, COLLISION_NO_HIT if it doesn't.
+// Planes are two sided, a particle that starts within radius of a plane passes through it so it can never get stuck.
+SHARED_INLINE float CollisionPlaneHit(CollisionPlane plane, float3 from, float3 to, float radius)
+{
+    float3 normal = CollisionPlaneNormal(plane);
+    float distanceFrom = dot(normal, from) + plane.Plane.w;
+    float distanceTo = dot(normal, to) + plane.Plane.w;
+    float side = distanceFrom < 0.0f ? -1.0f : 1.0f;
+    distanceFrom *= side;
+    distanceTo *= side;
+    if (distanceFrom < radius || distanceTo >= radius)
+    {
+        return COLLISION_NO_HIT;
+    }
+
+    float t = (distanceFrom - radius) / (distanceFrom - distanceTo);
+    float3 offset = lerp(from, to, t) - float3(plane.Center.x, plane.Center.y, plane.Center.z);
+    float u = dot(offset, float3(plane.AxisU.x, plane.AxisU.y, plane.AxisU.z));
+    float v = dot(offset, float3(plane.AxisV.x, plane.AxisV.y, plane.AxisV.z));
+    if (abs(u) > plane.AxisU.w || abs(v) > plane.AxisV.w)
+    {
+        return COLLISION_NO_HIT;
+    }
+    return t;
+}
+
+// Moves the particle back to the contact point, t along the step from -> particle.position,
+// and splits its velocity into a bounced part along the surface normal and a damped tangential part
+SHARED_INLINE Particle CollisionResponse(Particle particle, float3 normal, float3 from, float t, CollisionConstants constants)
+{
+    if (constants.KillOnHit)
+    {
+        particle.lifeTimeLeft = 0;
+        return particle;
+    }
+
+    float3 to = float3(particle.position.x, particle.position.y, particle.position.z);
+    float3 velocity = float3(particle.velocity.x, particle.velocity.y, particle.velocity.z);
+    float3 normalVelocity = normal * dot(velocity, normal);
+    float3 tangentVelocity = velocity - normalVelocity;
+    velocity = tangentVelocity * (1.0f - constants.Friction) - normalVelocity * constants.Restitution;
+
+    particle.position = float4(lerp(from, to, t), particle.position.w);
+    particle.velocity = float4(velocity, particle.velocity.w);
+    return particle;
+}
+
+#endif
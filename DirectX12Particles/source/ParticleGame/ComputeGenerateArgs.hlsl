@@ -1,29 +1,22 @@
-cbuffer RootConstants : register(b0)
-{
-	float deltaTime;
-	float particleLifetime;
-	uint emitCount;
-	uint maxParticleCount;
-	float3 emitPosition;
-	float3 emitVelocity;
-};
+#include "SubEmitter.hlsli"
 
-struct Particle
-{
-	float3 position;
-	float3 velocity;
-	float age;
+// One thread between simulate and the spawn pass. Turns this frame's sub-emitter events into the spawn pass's
+// dispatch arguments and zeroes the append counters for the next frame's simulate, see SubEmitter.hlsli.
 
-	float padding[57];
-};
+ConstantBuffer<SubEmitterConstants> SubEmitter : register(b1);
 
-RWStructuredBuffer<Particle> Particles : register(u0);
-RWBuffer<uint> AliveIndices0 : register(u1);
-RWBuffer<uint> AliveIndices1 : register(u2);
-RWBuffer<uint> DeadIndices : register(u3);
+Buffer<uint> DeadIndicesCounter : register(t0);
+RWByteAddressBuffer SubEmitterCounters : register(u5);
+RWByteAddressBuffer SubEmitterDispatchArgs : register(u6);
 
 [numthreads(1, 1, 1)]
 void CSMain()
 {
-	
+    // Simulate's counters keep counting past the end of the event buffer
+    uint deathEvents = min(SubEmitterCounters.Load(SUB_EMITTER_COUNTER_DEATH * 4), SUB_EMITTER_MAX_EVENTS);
+    uint collisionEvents = min(SubEmitterCounters.Load(SUB_EMITTER_COUNTER_COLLISION * 4), SUB_EMITTER_MAX_EVENTS);
+    uint spawns = SubEmitterSpawnCount(deathEvents, collisionEvents, DeadIndicesCounter[0], SubEmitter);
+
+    SubEmitterCounters.Store4(0, uint4(0, 0, deathEvents, spawns));
+    SubEmitterDispatchArgs.Store3(0, uint3((spawns + SUB_EMITTER_THREADS - 1) / SUB_EMITTER_THREADS, 1, 1));
 }
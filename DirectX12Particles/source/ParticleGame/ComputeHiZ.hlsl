@@ -0,0 +1,143 @@
+#include "HiZ.hlsli"
+
+cbuffer RootConstants : register(b0)
+{
+    uint2 DepthDimensions;
+    uint MipCount;
+    uint GroupCount;
+};
+
+Texture2D<float> DepthBuffer : register(t0);
+
+globallycoherent RWTexture2D<float2> HiZMips[HIZ_MAX_MIPS] : register(u0);
+globallycoherent RWStructuredBuffer<uint> HiZCounter : register(u13);
+
+groupshared float2 Reduced[16][16];
+groupshared uint IsLastGroup;
+
+float2 LoadDepth(int2 pixel)
+{
+    float depth = DepthBuffer.Load(int3(min(pixel, int2(DepthDimensions) - 1), 0));
+    return float2(depth, depth);
+}
+
+float2 LoadMip(uint mip, int2 texel)
+{
+    int2 dimensions = int2(HiZMipDimension(DepthDimensions.x, mip), HiZMipDimension(DepthDimensions.y, mip));
+    return HiZMips[mip][min(texel, dimensions - 1)];
+}
+
+void StoreMip(uint mip, uint2 texel, float2 value)
+{
+    if (mip < MipCount && texel.x < HiZMipDimension(DepthDimensions.x, mip) && texel.y < HiZMipDimension(DepthDimensions.y, mip))
+    {
+        HiZMips[mip][texel] = value;
+    }
+}
+
+[numthreads(HIZ_THREADS, 1, 1)]
+void CSMain(uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    // Mips 0-2, each thread reduces a 4x4 block of depth in registers
+    uint2 block = uint2(groupIndex % 16, groupIndex / 16);
+    uint2 tileOrigin = groupId.xy * HIZ_TILE_SIZE;
+    uint2 blockOrigin = tileOrigin + block * 4;
+
+    float2 mip1[2][2];
+    [unroll]
+    for (uint y = 0; y < 2; ++y)
+    {
+        [unroll]
+        for (uint x = 0; x < 2; ++x)
+        {
+            int2 pixel = int2(blockOrigin + uint2(x, y) * 2);
+            float2 d0 = LoadDepth(pixel);
+            float2 d1 = LoadDepth(pixel + int2(1, 0));
+            float2 d2 = LoadDepth(pixel + int2(0, 1));
+            float2 d3 = LoadDepth(pixel + int2(1, 1));
+
+            StoreMip(0, pixel, d0);
+            StoreMip(0, pixel + int2(1, 0), d1);
+            StoreMip(0, pixel + int2(0, 1), d2);
+            StoreMip(0, pixel + int2(1, 1), d3);
+
+            mip1[y][x] = HiZReduce(d0, d1, d2, d3);
+            StoreMip(1, blockOrigin / 2 + uint2(x, y), mip1[y][x]);
+        }
+    }
+
+    float2 mip2 = HiZReduce(mip1[0][0], mip1[0][1], mip1[1][0], mip1[1][1]);
+    StoreMip(2, blockOrigin / 4, mip2);
+    Reduced[block.y][block.x] = mip2;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // Mips 3-6 from groupshared, halving the active threads each level
+    [unroll]
+    for (uint mip = 3; mip < HIZ_GROUP_MIPS; ++mip)
+    {
+        uint size = 16 >> (mip - 2);
+        uint2 texel = uint2(groupIndex % size, groupIndex / size);
+        bool active = groupIndex < size * size;
+
+        float2 value = float2(0, 0);
+        if (active)
+        {
+            value = HiZReduce(Reduced[texel.y * 2][texel.x * 2], Reduced[texel.y * 2][texel.x * 2 + 1],
+                Reduced[texel.y * 2 + 1][texel.x * 2], Reduced[texel.y * 2 + 1][texel.x * 2 + 1]);
+            StoreMip(mip, (tileOrigin >> mip) + texel, value);
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+
+        if (active)
+        {
+            Reduced[texel.y][texel.x] = value;
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (MipCount <= HIZ_GROUP_MIPS)
+    {
+        return;
+    }
+
+    // Make this group's mip 6 texel visible before counting it as done
+    DeviceMemoryBarrierWithGroupSync();
+
+    if (groupIndex == 0)
+    {
+        uint finishedGroups;
+        InterlockedAdd(HiZCounter[0], 1, finishedGroups);
+        IsLastGroup = finishedGroups == GroupCount - 1;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (!IsLastGroup)
+    {
+        return;
+    }
+
+    // The last group reduces the remaining mips straight from the pyramid
+    if (groupIndex == 0)
+    {
+        HiZCounter[0] = 0;
+    }
+
+    for (uint level = HIZ_GROUP_MIPS; level < MipCount; ++level)
+    {
+        uint2 dimensions = uint2(HiZMipDimension(DepthDimensions.x, level), HiZMipDimension(DepthDimensions.y, level));
+
+        for (uint index = groupIndex; index < dimensions.x * dimensions.y; index += HIZ_THREADS)
+        {
+            int2 texel = int2(index % dimensions.x, index / dimensions.x);
+            float2 value = HiZReduce(LoadMip(level - 1, texel * 2), LoadMip(level - 1, texel * 2 + int2(1, 0)),
+                LoadMip(level - 1, texel * 2 + int2(0, 1)), LoadMip(level - 1, texel * 2 + int2(1, 1)));
+            HiZMips[level][texel] = value;
+        }
+
+        DeviceMemoryBarrierWithGroupSync();
+    }
+}
@@ -17,6 +17,9 @@ Texture2D DepthBuffer : register(t0);
 StructuredBuffer<float4> SSAOKernel : register(t1);
 Texture2D SSAONoise : register(t2);
 
+// Raw occlusion, denoised and applied to SceneCap by ComputeSSAOBlur
+RWTexture2D<float> AO : register(u1);
+
 SamplerState PointSampler : register(s0);
 
 float ReconstructDepth(in float z)
@@ -67,6 +70,7 @@ void CSMain(uint3 id : SV_DispatchThreadID)
         if (d0 == 1.0f)
         {
             SceneCap[id.xy] = float4(0, 0, 0, 1.0f);
+            AO[id.xy] = 1.0f;
             return;
         }
         
@@ -157,7 +161,7 @@ void CSMain(uint3 id : SV_DispatchThreadID)
         
         //SceneCap[id.xy] -= (1.0f - (occlusion / KernelSize)) / 12;
         //SceneCap[id.xy] = 1.0f - (occlusion / KernelSize);
-        SceneCap[id.xy] = lerp(float4(0.1f, 0.1f, 0.1f, 0.1f), SceneCap[id.xy], 1.0f - (occlusion / KernelSize));
+        AO[id.xy] = 1.0f - (occlusion / KernelSize);
         
         //SceneCap[id.xy] = float4(normal, 1.0f);
         //SceneCap[id.xy] = float4(normal * .5 + .5, 1.0f);
@@ -0,0 +1,67 @@
+#include "SPH.hlsli"
+#include "SpatialHash.hlsli"
+
+cbuffer RootConstants : register(b0)
+{
+    SPHConstants Fluid;
+    SpatialHashConstants Hash;
+    uint Phase;
+};
+
+RWStructuredBuffer<uint> CellCounts : register(u0);
+RWStructuredBuffer<uint> CellStarts : register(u1);
+RWStructuredBuffer<uint> SortedIndices : register(u2);
+RWStructuredBuffer<Particle> Particles : register(u3);
+RWStructuredBuffer<float2> DensityPressure : register(u4);
+RWStructuredBuffer<float4> Accelerations : register(u5);
+
+// One thread per particle slot, the density phase fills DensityPressure and the force phase reads it back for every neighbor
+[numthreads(SPATIAL_HASH_THREADS, 1, 1)]
+void CSMain(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    uint particleIndex = dispatchThreadId.x;
+    if (particleIndex >= Hash.ParticleCount)
+    {
+        return;
+    }
+
+    Particle particle = Particles[particleIndex];
+    if (particle.lifeTimeLeft <= 0)
+    {
+        return;
+    }
+
+    float3 position = particle.position.xyz;
+    if (Phase == SPH_PHASE_DENSITY)
+    {
+        float density = 0.0f;
+        for (uint n = 0; n < SPATIAL_HASH_NEIGHBOR_CELLS; ++n)
+        {
+            uint key = SpatialHashNeighborKey(position, n, Hash);
+            uint end = CellStarts[key] + CellCounts[key];
+            for (uint slot = CellStarts[key]; slot < end; ++slot)
+            {
+                density += SPHDensityTerm(position - Particles[SortedIndices[slot]].position.xyz, Fluid);
+            }
+        }
+        DensityPressure[particleIndex] = float2(density, SPHPressure(density, Fluid));
+    }
+    else
+    {
+        float2 densityPressure = DensityPressure[particleIndex];
+        float3 forceDensity = float3(0, 0, 0);
+        for (uint n = 0; n < SPATIAL_HASH_NEIGHBOR_CELLS; ++n)
+        {
+            uint key = SpatialHashNeighborKey(position, n, Hash);
+            uint end = CellStarts[key] + CellCounts[key];
+            for (uint slot = CellStarts[key]; slot < end; ++slot)
+            {
+                uint neighborIndex = SortedIndices[slot];
+                Particle neighbor = Particles[neighborIndex];
+                forceDensity += SPHForceTerm(position - neighbor.position.xyz, neighbor.velocity.xyz - particle.velocity.xyz,
+                    densityPressure, DensityPressure[neighborIndex], Fluid);
+            }
+        }
+        Accelerations[particleIndex] = float4(SPHAcceleration(forceDensity, densityPressure.x, Fluid), 0);
+    }
+}
@@ -0,0 +1,84 @@
+#include "SSAOBlur.hlsli"
+
+cbuffer RootConstants : register(b0)
+{
+    int2 WindowDimensions;
+    float NearPlane;
+    float FarPlane;
+    float Sharpness;
+    uint Vertical; // 0 blurs AO into AOBlur along x, 1 blurs AOBlur along y and composites onto the scene
+};
+
+RWTexture2D<float4> SceneCap : register(u0);
+Texture2D DepthBuffer : register(t0);
+
+RWTexture2D<float> AO : register(u1);
+RWTexture2D<float> AOBlur : register(u2);
+
+// AO and linear depth of the row/column segment this group works on
+groupshared float2 Tile[SSAO_BLUR_TILE + 2 * SSAO_BLUR_RADIUS];
+
+int2 TilePixel(int axisCoord, int otherCoord)
+{
+    return Vertical ? int2(otherCoord, axisCoord) : int2(axisCoord, otherCoord);
+}
+
+void LoadTileEntry(uint entry, int tileStart, int otherCoord, int axisLength)
+{
+    int axisCoord = clamp(tileStart + (int)entry - SSAO_BLUR_RADIUS, 0, axisLength - 1);
+    int2 pixel = TilePixel(axisCoord, otherCoord);
+
+    float ao = Vertical ? AOBlur[pixel] : AO[pixel];
+    float depth = LinearizeDepth(DepthBuffer.Load(int3(pixel, 0)).r, NearPlane, FarPlane);
+    Tile[entry] = float2(ao, depth);
+}
+
+[numthreads(SSAO_BLUR_TILE, 1, 1)]
+void CSMain(uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    int axisLength = Vertical ? WindowDimensions.y : WindowDimensions.x;
+    int otherLength = Vertical ? WindowDimensions.x : WindowDimensions.y;
+    int tileStart = groupId.x * SSAO_BLUR_TILE;
+    int otherCoord = groupId.y;
+
+    // Every thread loads its own pixel, the first 2 * radius threads also load the apron
+    LoadTileEntry(groupIndex, tileStart, otherCoord, axisLength);
+    if (groupIndex < 2 * SSAO_BLUR_RADIUS)
+    {
+        LoadTileEntry(groupIndex + SSAO_BLUR_TILE, tileStart, otherCoord, axisLength);
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    int axisCoord = tileStart + groupIndex;
+    if (axisCoord >= axisLength || otherCoord >= otherLength)
+    {
+        return;
+    }
+
+    uint center = groupIndex + SSAO_BLUR_RADIUS;
+    float centerDepth = Tile[center].y;
+    float sum = 0.0f;
+    float weightSum = 0.0f;
+
+    [unroll]
+    for (int offset = -SSAO_BLUR_RADIUS; offset <= SSAO_BLUR_RADIUS; ++offset)
+    {
+        float2 tap = Tile[center + offset];
+        float weight = SSAOBlurWeight(offset, centerDepth, tap.y, Sharpness);
+        sum += tap.x * weight;
+        weightSum += weight;
+    }
+
+    float ao = sum / weightSum;
+    int2 pixel = TilePixel(axisCoord, otherCoord);
+
+    if (!Vertical)
+    {
+        AOBlur[pixel] = ao;
+    }
+    else if (DepthBuffer.Load(int3(pixel, 0)).r < 1.0f)
+    {
+        SceneCap[pixel] = lerp(float4(0.1f, 0.1f, 0.1f, 0.1f), SceneCap[pixel], ao);
+    }
+}
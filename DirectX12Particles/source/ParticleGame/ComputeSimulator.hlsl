@@ -1,29 +1,21 @@
+#include "Particle.hlsli"
+#include "Culling.hlsli"
+#include "SpatialHash.hlsli"
+#include "SPH.hlsli"
+#include "Collision.hlsli"
+#include "DepthCollision.hlsli"
+#include "ForceField.hlsli"
+#include "CurlNoise.hlsli"
+#include "VectorField.hlsli"
+#include "ParticleCurves.hlsli"
+#include "Trail.hlsli"
+#include "SubEmitter.hlsli"
+
 #define threadGroupSize 128
 
 cbuffer RootConstants : register(b0)
 {
-    float deltaTime;
-    float particleLifetime;
-    uint emitCount;
-    uint maxParticleCount;
-    float4 emitAABBMin;
-    float4 emitAABBMax;
-    float4 emitVelocityMin;
-    float4 emitVelocityMax;
-    float4 emitAccelerationMin;
-    float4 emitAccelerationMax;
-    float particleStartScale;
-    float particleEndScale;
-};
-
-struct Particle
-{
-    float4 position;
-    float4 velocity;
-    float4 acceleration;
-    float4 color;
-    float lifeTimeLeft;
-    float scale;
+    EmitterConstants Emitter;
 };
 
 RWStructuredBuffer<Particle> Particles : register(u0);
@@ -32,23 +24,269 @@ AppendStructuredBuffer<uint> AliveIndices1 : register(u2);
 AppendStructuredBuffer<uint> DeadIndices : register(u3);
 Buffer<uint> DeadIndicesCounter : register(t0);
 
+// Particles that pass the frustum and Hi-Z tests, drawn with ExecuteIndirect
+AppendStructuredBuffer<uint> VisibleIndices : register(u4);
+ConstantBuffer<CullConstants> Cull : register(b1);
+Texture2D<float2> HiZ : register(t1);
+
+// Neighbor grid ComputeSpatialHash.hlsl builds before this pass, see SpatialHashNeighborKey for the query loop
+RWStructuredBuffer<uint> CellCounts : register(u5);
+RWStructuredBuffer<uint> CellStarts : register(u6);
+RWStructuredBuffer<uint> SortedIndices : register(u7);
+ConstantBuffer<SpatialHashConstants> Hash : register(b2);
+
+// Fluid accelerations from ComputeSPH.hlsl, only read in SPH mode
+RWStructuredBuffer<float4> SPHAccelerations : register(u8);
+ConstantBuffer<SPHConstants> Fluid : register(b3);
+
+// Room planes and the broadphase cell masks BuildCollisionGrid made from them
+StructuredBuffer<CollisionPlane> CollisionPlanes : register(t2);
+StructuredBuffer<uint> CollisionGrid : register(t3);
+ConstantBuffer<CollisionConstants> Collision : register(b4);
+
+// Force fields of this frame, each group only evaluates the ones overlapping its particles
+StructuredBuffer<ForceField> ForceFields : register(t4);
+cbuffer ForceFieldConstants : register(b5)
+{
+    uint ForceFieldCount;
+};
+
+// Baked divergence-free turbulence, tiles so the sampler wraps
+Texture3D<float4> CurlNoise : register(t5);
+SamplerState CurlNoiseSampler : register(s0);
+ConstantBuffer<CurlNoiseConstants> Turbulence : register(b6);
+
+// Imported vector fields, slot n of the textures belongs to VectorFields.Fields[n]
+Texture3D<float4> VectorFieldTextures[VECTOR_FIELD_MAX_COUNT] : register(t6);
+SamplerState LinearClampSampler : register(s1);
+ConstantBuffer<VectorFieldConstants> VectorFields : register(b7);
+
+// Over-lifetime curves of every emitter, Emitter.curveSet picks the slices
+Texture1DArray<float4> CurveAtlas : register(t10);
+
+// Trail history ring, see Trail.hlsli
+RWStructuredBuffer<float4> TrailHistory : register(u9);
+
+// Death and collision events for the sub-emitter spawn pass, see SubEmitter.hlsli
+RWStructuredBuffer<SubEmitterEvent> SubEmitterEvents : register(u10);
+RWByteAddressBuffer SubEmitterCounters : register(u11);
+
+cbuffer FrameConstants : register(b8)
+{
+    uint TrailHead;
+    uint EventMask; // Sub-emitter event types to raise, see SubEmitterEventMask
+};
+
+groupshared uint GroupBounds[6]; // Min then max corner of the group's live particles, as ordered uints
+groupshared uint GroupFieldCount;
+groupshared uint GroupFields[FORCE_FIELD_MAX_COUNT];
+
+// Flips the bits of a float so unsigned integer order matches float order, lets InterlockedMin/Max reduce positions
+uint OrderedUint(float value)
+{
+    uint bits = asuint(value);
+    return (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+}
+
+float OrderedFloat(uint bits)
+{
+    return asfloat((bits & 0x80000000) ? bits & 0x7fffffff : ~bits);
+}
+
+// Builds GroupFields from the fields whose bounds overlap the group's live particles. Every thread of the group has to call it.
+void CullForceFields(bool alive, float3 position, uint groupIndex)
+{
+    if (groupIndex < 3)
+    {
+        GroupBounds[groupIndex] = 0xffffffff;
+        GroupBounds[groupIndex + 3] = 0;
+    }
+    if (groupIndex == 0)
+    {
+        GroupFieldCount = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (alive)
+    {
+        InterlockedMin(GroupBounds[0], OrderedUint(position.x));
+        InterlockedMin(GroupBounds[1], OrderedUint(position.y));
+        InterlockedMin(GroupBounds[2], OrderedUint(position.z));
+        InterlockedMax(GroupBounds[3], OrderedUint(position.x));
+        InterlockedMax(GroupBounds[4], OrderedUint(position.y));
+        InterlockedMax(GroupBounds[5], OrderedUint(position.z));
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // A group without live particles keeps its bounds inverted, the overlap test then rejects every field
+    float3 boundsMin = float3(OrderedFloat(GroupBounds[0]), OrderedFloat(GroupBounds[1]), OrderedFloat(GroupBounds[2]));
+    float3 boundsMax = float3(OrderedFloat(GroupBounds[3]), OrderedFloat(GroupBounds[4]), OrderedFloat(GroupBounds[5]));
+    for (uint field = groupIndex; field < ForceFieldCount; field += threadGroupSize)
+    {
+        if (ForceFieldOverlaps(ForceFields[field], boundsMin, boundsMax))
+        {
+            uint slot;
+            InterlockedAdd(GroupFieldCount, 1, slot);
+            GroupFields[slot] = field;
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+}
+
+// Resolves the nearest plane hit of the step from -> particle.position, only planes in the end cell's mask are tested
+Particle CollidePlanes(Particle particle, float3 from)
+{
+    float3 to = particle.position.xyz;
+    uint cell = CollisionGridCell(to, Collision);
+    uint mask = cell < COLLISION_GRID_SIZE * COLLISION_GRID_SIZE * COLLISION_GRID_SIZE ? CollisionGrid[cell] : 0;
+
+    float nearest = COLLISION_NO_HIT;
+    uint hitPlane = 0;
+    while (mask)
+    {
+        uint plane = firstbitlow(mask);
+        mask &= mask - 1;
+
+        float t = CollisionPlaneHit(CollisionPlanes[plane], from, to, particle.scale * Collision.RadiusScale);
+        if (t < nearest)
+        {
+            nearest = t;
+            hitPlane = plane;
+        }
+    }
+
+    if (nearest <= 1.0f)
+    {
+        particle = CollisionResponse(particle, CollisionPlaneNormal(CollisionPlanes[hitPlane]), from, nearest, Collision);
+    }
+    return particle;
+}
+
+// Lock-free and bounded, the add claims a slot and events past the end of the type's slots are dropped
+void AppendSubEmitterEvent(uint type, Particle particle)
+{
+    uint slot;
+    SubEmitterCounters.InterlockedAdd(type * 4, 1, slot);
+    if (slot < SUB_EMITTER_MAX_EVENTS)
+    {
+        SubEmitterEvents[SubEmitterEventIndex(type, slot)] = MakeSubEmitterEvent(particle);
+    }
+}
+
+bool IsVisible(float3 center, float radius)
+{
+    if (!SphereInFrustum(center, radius, Cull))
+    {
+        return false;
+    }
+    
+    if (!Cull.HiZEnabled)
+    {
+        return true;
+    }
+    
+    HiZBounds bounds = ProjectSphereToHiZ(center, radius, Cull);
+    uint mip = HiZCullMip(bounds, Cull);
+    uint4 texels = HiZCullTexels(bounds, Cull, mip);
+    float2 furthest = HiZReduce(HiZ.Load(int3(texels.xy, mip)), HiZ.Load(int3(texels.zy, mip)),
+                                HiZ.Load(int3(texels.xw, mip)), HiZ.Load(int3(texels.zw, mip)));
+    return !HiZOccluded(bounds, furthest);
+}
+
 [numthreads(threadGroupSize, 1, 1)]
 void CSMain(uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
 {
     uint index = (groupId.x * threadGroupSize) + groupIndex;
-    uint aliveParticleCount = maxParticleCount - DeadIndicesCounter[0];
+    uint aliveParticleCount = Emitter.maxParticleCount - DeadIndicesCounter[0];
     
     GroupMemoryBarrierWithGroupSync();
     
-    if (index < aliveParticleCount)
+    bool alive = index < aliveParticleCount;
+    uint particleIndex = 0;
+    Particle particle = (Particle)0;
+    if (alive)
     {
-        uint particleIndex = AliveIndices0.Consume();
-        Particle particle = Particles[particleIndex];
-
-        particle.velocity += particle.acceleration * deltaTime;
-        particle.position += particle.velocity * deltaTime;
-        particle.lifeTimeLeft -= deltaTime;
-        particle.scale = lerp(particleEndScale, particleStartScale, particle.lifeTimeLeft / particleLifetime);
+        particleIndex = AliveIndices0.Consume();
+        particle = Particles[particleIndex];
+    }
+    
+    if (ForceFieldCount > 0)
+    {
+        CullForceFields(alive, particle.position.xyz, groupIndex);
+    }
+    
+    if (alive)
+    {
+        if (Fluid.Enabled)
+        {
+            particle = ApplySPHAcceleration(particle, SPHAccelerations[particleIndex].xyz, Emitter.deltaTime);
+        }
+        
+        if (ForceFieldCount > 0)
+        {
+            float3 fieldAcceleration = float3(0, 0, 0);
+            for (uint n = 0; n < GroupFieldCount; ++n)
+            {
+                fieldAcceleration += ForceFieldAcceleration(ForceFields[GroupFields[n]], particle.position.xyz, particle.velocity.xyz);
+            }
+            particle.velocity.xyz += fieldAcceleration * Emitter.deltaTime;
+        }
+        
+        if (Turbulence.Enabled)
+        {
+            float3 curl = CurlNoise.SampleLevel(CurlNoiseSampler, CurlNoiseCoordinates(particle.position.xyz, Turbulence), 0).xyz;
+            particle.velocity.xyz += curl * (Turbulence.Strength * Emitter.deltaTime);
+        }
+        
+        for (uint field = 0; field < VectorFields.Count; ++field)
+        {
+            float3 uvw = VectorFieldCoordinates(particle.position.xyz, VectorFields.Fields[field]);
+            if (VectorFieldInside(uvw))
+            {
+                float3 value = VectorFieldTextures[field].SampleLevel(LinearClampSampler, uvw, 0).xyz;
+                particle.velocity.xyz = VectorFieldApply(value, particle.velocity.xyz, VectorFields.Fields[field], Emitter.deltaTime);
+            }
+        }
+        
+        float3 previousPosition = particle.position.xyz;
+        bool spawned = particle.lifeTimeLeft >= Emitter.particleLifetime;
+        particle = SimulateParticle(particle, Emitter);
+        if (Emitter.curveSet != CURVE_SET_NONE)
+        {
+            float u = CurveAtlasU(ParticleAge(particle, Emitter));
+            float4 colorTexel = CurveAtlas.SampleLevel(LinearClampSampler, float2(u, CurveAtlasSlice(Emitter.curveSet, CURVE_ATLAS_COLOR_SLICE)), 0);
+            float4 motionTexel = CurveAtlas.SampleLevel(LinearClampSampler, float2(u, CurveAtlasSlice(Emitter.curveSet, CURVE_ATLAS_MOTION_SLICE)), 0);
+            particle = ApplyParticleCurves(particle, MakeParticleCurveSample(colorTexel, motionTexel), Emitter.deltaTime);
+        }
+        Particle beforeCollision = particle;
+        if (Collision.Enabled)
+        {
+            particle = CollidePlanes(particle, previousPosition);
+        }
+        
+        // Scene geometry from last frame's depth, mip 0 of the Hi-Z pyramid
+        if (Collision.DepthEnabled && Cull.HiZEnabled)
+        {
+            DepthCollisionSample depthSample = DepthCollisionProject(particle.position.xyz, Cull);
+            if (depthSample.Valid)
+            {
+                int3 texel = int3(depthSample.Texel, 0);
+                float3 depths = float3(HiZ.Load(texel).y, HiZ.Load(texel + int3(1, 0, 0)).y, HiZ.Load(texel + int3(0, 1, 0)).y);
+                particle = DepthCollide(particle, previousPosition, depthSample, depths, Cull, Collision);
+            }
+        }
+        
+        if (EventMask && SubEmitterRaisesEvents(particle))
+        {
+            if ((EventMask & (1u << SUB_EMITTER_EVENT_COLLISION)) && SubEmitterCollided(beforeCollision, particle))
+            {
+                AppendSubEmitterEvent(SUB_EMITTER_EVENT_COLLISION, particle);
+            }
+            if ((EventMask & (1u << SUB_EMITTER_EVENT_DEATH)) && particle.lifeTimeLeft <= 0)
+            {
+                AppendSubEmitterEvent(SUB_EMITTER_EVENT_DEATH, particle);
+            }
+        }
         
         if (particle.lifeTimeLeft <= 0)
         {
@@ -57,8 +295,30 @@ void CSMain(uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
         else
         {
             AliveIndices1.Append(particleIndex);
+            
+            if (IsVisible(particle.position.xyz, particle.scale * CULL_BILLBOARD_RADIUS))
+            {
+                VisibleIndices.Append(particleIndex);
+            }
         }
         
         Particles[particleIndex] = particle;
+        
+        // A new particle or a restarted trail fills every slot, so its ribbon starts collapsed at the particle
+        if (TrailHead != TRAIL_HEAD_NONE && particle.lifeTimeLeft > 0)
+        {
+            float4 trailSample = TrailSample(particle);
+            if (spawned || (TrailHead & TRAIL_HEAD_RESET))
+            {
+                for (uint slot = 0; slot < TRAIL_LENGTH; ++slot)
+                {
+                    TrailHistory[TrailHistoryIndex(slot, particleIndex, Emitter.maxParticleCount)] = trailSample;
+                }
+            }
+            else
+            {
+                TrailHistory[TrailHistoryIndex(TrailHead, particleIndex, Emitter.maxParticleCount)] = trailSample;
+            }
+        }
     }
 }
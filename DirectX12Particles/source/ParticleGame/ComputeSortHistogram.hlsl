@@ -0,0 +1,75 @@
+#include "Particle.hlsli"
+#include "Culling.hlsli"
+#include "RadixSort.hlsli"
+
+cbuffer RootConstants : register(b0)
+{
+    uint Pass;
+    uint PartitionCount;
+};
+
+// Keys and values are two back to back halves each, the onesweep passes ping-pong between them
+RWStructuredBuffer<uint> SortKeys : register(u0);
+RWStructuredBuffer<uint> SortValues : register(u1);
+RWStructuredBuffer<uint> SortHistogram : register(u2); // RADIX_PASSES * RADIX_BINS digit counts, cleared by a copy before this pass
+RWStructuredBuffer<uint> SortStatus : register(u3);
+RWStructuredBuffer<uint> SortCounter : register(u4); // Key count, then one partition counter per pass
+
+RWStructuredBuffer<Particle> Particles : register(u5);
+RWStructuredBuffer<uint> VisibleIndices : register(u6);
+
+ConstantBuffer<CullConstants> Cull : register(b1);
+
+groupshared uint Histogram[RADIX_PASSES][RADIX_BINS];
+
+// Writes the keys and values for the first onesweep pass and counts every digit of every pass in one read
+[numthreads(RADIX_THREADS, 1, 1)]
+void CSMain(uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    uint keyCount = SortCounter[0];
+
+    // Reset this partition's lookback status for every pass and the partition counters
+    [unroll]
+    for (uint pass = 0; pass < RADIX_PASSES; ++pass)
+    {
+        SortStatus[(pass * PartitionCount + groupId.x) * RADIX_BINS + groupIndex] = 0;
+        Histogram[pass][groupIndex] = 0;
+    }
+    if (groupId.x == 0 && groupIndex < RADIX_PASSES)
+    {
+        SortCounter[1 + groupIndex] = 0;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint k = 0; k < RADIX_KEYS_PER_THREAD; ++k)
+    {
+        uint index = groupId.x * RADIX_TILE_SIZE + k * RADIX_THREADS + groupIndex;
+        if (index < keyCount)
+        {
+            uint particleIndex = VisibleIndices[index];
+            uint key = DepthSortKey(dot(Particles[particleIndex].position, Cull.ViewDepthAxis));
+
+            SortKeys[index] = key;
+            SortValues[index] = particleIndex;
+
+            [unroll]
+            for (uint pass = 0; pass < RADIX_PASSES; ++pass)
+            {
+                InterlockedAdd(Histogram[pass][RadixDigit(key, pass)], 1);
+            }
+        }
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint pass = 0; pass < RADIX_PASSES; ++pass)
+    {
+        if (Histogram[pass][groupIndex] != 0)
+        {
+            InterlockedAdd(SortHistogram[pass * RADIX_BINS + groupIndex], Histogram[pass][groupIndex]);
+        }
+    }
+}
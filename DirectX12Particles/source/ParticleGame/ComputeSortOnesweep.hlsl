@@ -0,0 +1,204 @@
+#include "RadixSort.hlsli"
+
+cbuffer RootConstants : register(b0)
+{
+    uint Pass;
+    uint PartitionCount;
+};
+
+RWStructuredBuffer<uint> SortKeys : register(u0);
+RWStructuredBuffer<uint> SortValues : register(u1);
+RWStructuredBuffer<uint> SortHistogram : register(u2);
+globallycoherent RWStructuredBuffer<uint> SortStatus : register(u3); // RADIX_PASSES * PartitionCount * RADIX_BINS status words
+globallycoherent RWStructuredBuffer<uint> SortCounter : register(u4);
+
+groupshared uint TileKeys[RADIX_TILE_SIZE];
+groupshared uint TileValues[RADIX_TILE_SIZE];
+groupshared uint DigitCounts[RADIX_BINS];
+groupshared uint DigitTileStart[RADIX_BINS];
+groupshared uint DigitGlobalStart[RADIX_BINS];
+groupshared uint WaveTotals[RADIX_THREADS / 4];
+groupshared uint BlockTotal;
+groupshared uint PartitionIndex;
+
+// Exclusive prefix sum of one value per thread across the group
+uint BlockExclusiveScan(uint value, uint groupIndex)
+{
+    uint laneCount = WaveGetLaneCount();
+    uint waveIndex = groupIndex / laneCount;
+    uint wavePrefix = WavePrefixSum(value);
+
+    if (WaveGetLaneIndex() == laneCount - 1)
+    {
+        WaveTotals[waveIndex] = wavePrefix + value;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // At most RADIX_THREADS / 4 wave totals, a serial scan keeps this independent of the lane count
+    if (groupIndex == 0)
+    {
+        uint sum = 0;
+        for (uint wave = 0; wave < RADIX_THREADS / laneCount; ++wave)
+        {
+            uint total = WaveTotals[wave];
+            WaveTotals[wave] = sum;
+            sum += total;
+        }
+        BlockTotal = sum;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    uint result = wavePrefix + WaveTotals[waveIndex];
+
+    GroupMemoryBarrierWithGroupSync();
+
+    return result;
+}
+
+// One LSD pass: rank the tile by digit in groupshared, find each digit's global offset with a decoupled lookback, scatter
+[numthreads(RADIX_THREADS, 1, 1)]
+void CSMain(uint groupIndex : SV_GroupIndex)
+{
+    // Partitions are handed out in launch order so every lookback only waits on groups that are already running
+    if (groupIndex == 0)
+    {
+        uint partition;
+        InterlockedAdd(SortCounter[1 + Pass], 1, partition);
+        PartitionIndex = partition;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    uint partition = PartitionIndex;
+    uint keyCount = SortCounter[0];
+    uint tileStart = partition * RADIX_TILE_SIZE;
+    if (tileStart >= keyCount)
+    {
+        return;
+    }
+
+    uint validCount = min(keyCount - tileStart, (uint)RADIX_TILE_SIZE);
+    uint inputBase = (Pass & 1) * PartitionCount * RADIX_TILE_SIZE;
+    uint outputBase = ((Pass + 1) & 1) * PartitionCount * RADIX_TILE_SIZE;
+
+    // Blocked load, each thread owns RADIX_KEYS_PER_THREAD consecutive keys so the splits below stay stable.
+    // Keys past the end sort behind every real key of the same digit and are never scattered.
+    uint keys[RADIX_KEYS_PER_THREAD];
+    uint values[RADIX_KEYS_PER_THREAD];
+    [unroll]
+    for (uint k = 0; k < RADIX_KEYS_PER_THREAD; ++k)
+    {
+        uint tileIndex = groupIndex * RADIX_KEYS_PER_THREAD + k;
+        bool valid = tileIndex < validCount;
+        keys[k] = valid ? SortKeys[inputBase + tileStart + tileIndex] : 0xFFFFFFFFu;
+        values[k] = valid ? SortValues[inputBase + tileStart + tileIndex] : 0u;
+    }
+
+    // Stable 1 bit splits over the digit's bits leave the tile ordered by digit
+    [unroll]
+    for (uint bit = 0; bit < RADIX_BITS; ++bit)
+    {
+        uint shift = Pass * RADIX_BITS + bit;
+        uint zeros = 0;
+        [unroll]
+        for (uint k = 0; k < RADIX_KEYS_PER_THREAD; ++k)
+        {
+            zeros += ((keys[k] >> shift) & 1u) ^ 1u;
+        }
+
+        uint zerosBefore = BlockExclusiveScan(zeros, groupIndex);
+        uint totalZeros = BlockTotal;
+
+        [unroll]
+        for (uint k = 0; k < RADIX_KEYS_PER_THREAD; ++k)
+        {
+            uint position = groupIndex * RADIX_KEYS_PER_THREAD + k;
+            uint destination = ((keys[k] >> shift) & 1u) == 0u ? zerosBefore : totalZeros + position - zerosBefore;
+            zerosBefore += ((keys[k] >> shift) & 1u) ^ 1u;
+            TileKeys[destination] = keys[k];
+            TileValues[destination] = values[k];
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+
+        [unroll]
+        for (uint k = 0; k < RADIX_KEYS_PER_THREAD; ++k)
+        {
+            keys[k] = TileKeys[groupIndex * RADIX_KEYS_PER_THREAD + k];
+            values[k] = TileValues[groupIndex * RADIX_KEYS_PER_THREAD + k];
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    // Count each digit in the tile
+    DigitCounts[groupIndex] = 0;
+    GroupMemoryBarrierWithGroupSync();
+    [unroll]
+    for (uint k = 0; k < RADIX_KEYS_PER_THREAD; ++k)
+    {
+        if (groupIndex * RADIX_KEYS_PER_THREAD + k < validCount)
+        {
+            InterlockedAdd(DigitCounts[RadixDigit(keys[k], Pass)], 1);
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // From here on thread n looks after digit n
+    uint digit = groupIndex;
+    uint localCount = DigitCounts[digit];
+    uint statusBase = Pass * PartitionCount * RADIX_BINS;
+    uint statusIndex = statusBase + partition * RADIX_BINS + digit;
+
+    // Publish this tile's count, then walk back until a partition with an inclusive prefix
+    uint exclusivePrefix = 0;
+    if (partition == 0)
+    {
+        SortStatus[statusIndex] = RADIX_STATUS_INCLUSIVE | localCount;
+    }
+    else
+    {
+        SortStatus[statusIndex] = RADIX_STATUS_AGGREGATE | localCount;
+
+        int lookback = (int)partition - 1;
+        while (lookback >= 0)
+        {
+            uint status = SortStatus[statusBase + lookback * RADIX_BINS + digit];
+            if ((status & RADIX_STATUS_FLAGS) == 0)
+            {
+                continue;
+            }
+
+            exclusivePrefix += status & RADIX_STATUS_COUNT;
+            if ((status & RADIX_STATUS_INCLUSIVE) != 0)
+            {
+                break;
+            }
+            --lookback;
+        }
+
+        SortStatus[statusIndex] = RADIX_STATUS_INCLUSIVE | (exclusivePrefix + localCount);
+    }
+
+    uint histogramPrefix = BlockExclusiveScan(SortHistogram[Pass * RADIX_BINS + digit], groupIndex);
+    uint tilePrefix = BlockExclusiveScan(localCount, groupIndex);
+    DigitGlobalStart[digit] = histogramPrefix + exclusivePrefix;
+    DigitTileStart[digit] = tilePrefix;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint k = 0; k < RADIX_KEYS_PER_THREAD; ++k)
+    {
+        uint position = groupIndex * RADIX_KEYS_PER_THREAD + k;
+        if (position < validCount)
+        {
+            uint keyDigit = RadixDigit(keys[k], Pass);
+            uint destination = outputBase + DigitGlobalStart[keyDigit] + position - DigitTileStart[keyDigit];
+            SortKeys[destination] = keys[k];
+            SortValues[destination] = values[k];
+        }
+    }
+}
@@ -0,0 +1,128 @@
+#include "Particle.hlsli"
+#include "SpatialHash.hlsli"
+
+cbuffer RootConstants : register(b0)
+{
+    SpatialHashConstants Hash;
+    uint Phase;
+};
+
+RWStructuredBuffer<uint> CellCounts : register(u0);
+RWStructuredBuffer<uint> CellStarts : register(u1);
+RWStructuredBuffer<uint> SortedIndices : register(u2);
+RWStructuredBuffer<uint> BlockSums : register(u3);
+RWStructuredBuffer<uint> ParticleKeys : register(u4);
+RWStructuredBuffer<uint> ParticleRanks : register(u5);
+RWStructuredBuffer<Particle> Particles : register(u6);
+
+groupshared uint ScanTotals[SPATIAL_HASH_THREADS];
+
+// Exclusive scan of a block of SPATIAL_HASH_SCAN_BLOCK values, 4 per thread, returns the block's total
+uint ScanBlock(inout uint4 values, uint groupIndex)
+{
+    uint4 inclusive = uint4(values.x, values.x + values.y, values.x + values.y + values.z, values.x + values.y + values.z + values.w);
+    ScanTotals[groupIndex] = inclusive.w;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Hillis-Steele over the per thread totals
+    for (uint offset = 1; offset < SPATIAL_HASH_THREADS; offset <<= 1)
+    {
+        uint sum = ScanTotals[groupIndex] + (groupIndex >= offset ? ScanTotals[groupIndex - offset] : 0);
+        GroupMemoryBarrierWithGroupSync();
+        ScanTotals[groupIndex] = sum;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint threadOffset = ScanTotals[groupIndex] - inclusive.w;
+    values = threadOffset + uint4(0, inclusive.x, inclusive.y, inclusive.z);
+    return ScanTotals[SPATIAL_HASH_THREADS - 1];
+}
+
+// Counting sort of live particles by hashed cell, one dispatch per phase with a UAV barrier in between
+[numthreads(SPATIAL_HASH_THREADS, 1, 1)]
+void CSMain(uint3 groupId : SV_GroupID, uint3 dispatchThreadId : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+    uint index = dispatchThreadId.x;
+
+    if (Phase == SPATIAL_HASH_PHASE_CLEAR)
+    {
+        if (index < Hash.TableSize)
+        {
+            CellCounts[index] = 0;
+        }
+    }
+    else if (Phase == SPATIAL_HASH_PHASE_COUNT)
+    {
+        if (index < Hash.ParticleCount)
+        {
+            Particle particle = Particles[index];
+            uint key = SPATIAL_HASH_INVALID_KEY;
+            if (particle.lifeTimeLeft > 0)
+            {
+                key = SpatialHashKey(SpatialHashCell(particle.position.xyz, Hash.CellSize), Hash.TableSize);
+                uint rank;
+                InterlockedAdd(CellCounts[key], 1, rank);
+                ParticleRanks[index] = rank;
+            }
+            ParticleKeys[index] = key;
+        }
+    }
+    else if (Phase == SPATIAL_HASH_PHASE_SCAN_CELLS || Phase == SPATIAL_HASH_PHASE_SCAN_BLOCKS)
+    {
+        // Cells scan one block per group, the block sums then fit in the single group of the second phase
+        bool cells = Phase == SPATIAL_HASH_PHASE_SCAN_CELLS;
+        uint count = cells ? Hash.TableSize : Hash.TableSize / SPATIAL_HASH_SCAN_BLOCK;
+        uint first = groupId.x * SPATIAL_HASH_SCAN_BLOCK + groupIndex * 4;
+
+        uint4 values = uint4(0, 0, 0, 0);
+        [unroll]
+        for (uint n = 0; n < 4; ++n)
+        {
+            if (first + n < count)
+            {
+                values[n] = cells ? CellCounts[first + n] : BlockSums[first + n];
+            }
+        }
+
+        uint total = ScanBlock(values, groupIndex);
+
+        [unroll]
+        for (uint m = 0; m < 4; ++m)
+        {
+            if (first + m < count)
+            {
+                if (cells)
+                {
+                    CellStarts[first + m] = values[m];
+                }
+                else
+                {
+                    BlockSums[first + m] = values[m];
+                }
+            }
+        }
+
+        if (cells && groupIndex == 0)
+        {
+            BlockSums[groupId.x] = total;
+        }
+    }
+    else if (Phase == SPATIAL_HASH_PHASE_ADD_BLOCKS)
+    {
+        if (index < Hash.TableSize)
+        {
+            CellStarts[index] += BlockSums[index / SPATIAL_HASH_SCAN_BLOCK];
+        }
+    }
+    else if (Phase == SPATIAL_HASH_PHASE_SCATTER)
+    {
+        if (index < Hash.ParticleCount)
+        {
+            uint key = ParticleKeys[index];
+            if (key != SPATIAL_HASH_INVALID_KEY)
+            {
+                SortedIndices[CellStarts[key] + ParticleRanks[index]] = index;
+            }
+        }
+    }
+}
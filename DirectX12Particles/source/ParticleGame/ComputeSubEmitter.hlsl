@@ -0,0 +1,34 @@
+#include "SubEmitter.hlsli"
+
+// Spawns the children of this frame's sub-emitter events, dispatched indirectly with the group count ComputeGenerateArgs.hlsl wrote.
+// Children join the alive list simulate just filled, so they are simulated and drawn from the next frame on.
+
+cbuffer RootConstants : register(b0)
+{
+    EmitterConstants Emitter;
+};
+
+ConstantBuffer<SubEmitterConstants> SubEmitter : register(b1);
+
+RWStructuredBuffer<Particle> Particles : register(u0);
+AppendStructuredBuffer<uint> AliveIndices1 : register(u2);
+ConsumeStructuredBuffer<uint> DeadIndices : register(u3);
+
+RWStructuredBuffer<SubEmitterEvent> SubEmitterEvents : register(u4);
+RWByteAddressBuffer SubEmitterCounters : register(u5);
+
+[numthreads(SUB_EMITTER_THREADS, 1, 1)]
+void CSMain(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+    // The spawn count is already clamped to the dead count, every thread below it gets a slot
+    uint spawnIndex = dispatchThreadId.x;
+    if (spawnIndex >= SubEmitterCounters.Load(SUB_EMITTER_COUNTER_SPAWNS * 4))
+    {
+        return;
+    }
+
+    uint2 child = SubEmitterLocateChild(spawnIndex, SubEmitterCounters.Load(SUB_EMITTER_COUNTER_DEATH_EVENTS * 4), SubEmitter);
+    uint particleIndex = DeadIndices.Consume();
+    Particles[particleIndex] = SpawnSubEmitterParticle(SubEmitterEvents[child.x], child.x, child.y, SubEmitter, Emitter);
+    AliveIndices1.Append(particleIndex);
+}
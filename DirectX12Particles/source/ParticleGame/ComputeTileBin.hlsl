@@ -0,0 +1,126 @@
+#include "TiledRaster.hlsli"
+
+cbuffer RootConstants : register(b0)
+{
+    TileRasterConstants Raster;
+};
+
+StructuredBuffer<Particle> Particles : register(t0);
+StructuredBuffer<uint> DrawList : register(t1);
+ByteAddressBuffer DrawArgs : register(t2);
+
+RWStructuredBuffer<uint> TileLists : register(u0);
+RWStructuredBuffer<uint> TileEntries : register(u1);
+
+groupshared uint ScanTotals[TILE_RASTER_THREADS];
+
+// Exclusive scan of a block of TILE_RASTER_SCAN_BLOCK values, 4 per thread, returns the block's total
+uint ScanBlock(inout uint4 values, uint groupIndex)
+{
+    uint4 inclusive = uint4(values.x, values.x + values.y, values.x + values.y + values.z, values.x + values.y + values.z + values.w);
+    ScanTotals[groupIndex] = inclusive.w;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Hillis-Steele over the per thread totals
+    for (uint offset = 1; offset < TILE_RASTER_THREADS; offset <<= 1)
+    {
+        uint sum = ScanTotals[groupIndex] + (groupIndex >= offset ? ScanTotals[groupIndex - offset] : 0);
+        GroupMemoryBarrierWithGroupSync();
+        ScanTotals[groupIndex] = sum;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint threadOffset = ScanTotals[groupIndex] - inclusive.w;
+    values = threadOffset + uint4(0, inclusive.x, inclusive.y, inclusive.z);
+    return ScanTotals[TILE_RASTER_THREADS - 1];
+}
+
+// Bins draw list positions into exact per tile lists, one dispatch per phase with a UAV barrier in between.
+// The position is binned rather than the particle index so the composite pass can restore draw order.
+[numthreads(TILE_RASTER_THREADS, 1, 1)]
+void CSMain(uint3 groupId : SV_GroupID, uint3 dispatchThreadId : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+    uint index = dispatchThreadId.x;
+    uint tileCount = Raster.TileCount.x * Raster.TileCount.y;
+
+    if (Raster.Phase == TILE_RASTER_PHASE_COUNT || Raster.Phase == TILE_RASTER_PHASE_SCATTER)
+    {
+        if (index >= DrawArgs.Load(Raster.DrawArgsOffset))
+        {
+            return;
+        }
+
+        ParticleFootprint footprint = ProjectParticle(Particles[DrawList[index]], Raster);
+        if (!footprint.Valid)
+        {
+            return;
+        }
+
+        uint4 tiles = FootprintTiles(footprint, Raster);
+        for (uint y = tiles.y; y <= tiles.w; ++y)
+        {
+            for (uint x = tiles.x; x <= tiles.z; ++x)
+            {
+                uint tile = y * Raster.TileCount.x + x;
+                if (Raster.Phase == TILE_RASTER_PHASE_COUNT)
+                {
+                    InterlockedAdd(TileLists[TileListIndex(TILE_LIST_COUNT, tile, Raster)], 1);
+                }
+                else
+                {
+                    // Slots within the list land in any order, the composite pass sorts them
+                    uint start = TileLists[TileListIndex(TILE_LIST_START, tile, Raster)];
+                    if (TileListFits(start, TileLists[TileListIndex(TILE_LIST_COUNT, tile, Raster)], Raster))
+                    {
+                        uint slot;
+                        InterlockedAdd(TileLists[TileListIndex(TILE_LIST_CURSOR, tile, Raster)], 1, slot);
+                        TileEntries[start + slot] = index;
+                    }
+                }
+            }
+        }
+    }
+    else if (Raster.Phase == TILE_RASTER_PHASE_SCAN_TILES || Raster.Phase == TILE_RASTER_PHASE_SCAN_BLOCKS)
+    {
+        // Tiles scan one block per group, the block sums then fit in the single group of the second phase
+        bool tilePhase = Raster.Phase == TILE_RASTER_PHASE_SCAN_TILES;
+        uint count = tilePhase ? tileCount : (tileCount + TILE_RASTER_SCAN_BLOCK - 1) / TILE_RASTER_SCAN_BLOCK;
+        uint source = tilePhase ? TileListIndex(TILE_LIST_COUNT, 0, Raster) : TileListIndex(TILE_LIST_BLOCK_SUMS, 0, Raster);
+        uint destination = tilePhase ? TileListIndex(TILE_LIST_START, 0, Raster) : source;
+        uint first = groupId.x * TILE_RASTER_SCAN_BLOCK + groupIndex * 4;
+
+        uint4 values = uint4(0, 0, 0, 0);
+        [unroll]
+        for (uint n = 0; n < 4; ++n)
+        {
+            if (first + n < count)
+            {
+                values[n] = TileLists[source + first + n];
+            }
+        }
+
+        uint total = ScanBlock(values, groupIndex);
+
+        [unroll]
+        for (uint m = 0; m < 4; ++m)
+        {
+            if (first + m < count)
+            {
+                TileLists[destination + first + m] = values[m];
+            }
+        }
+
+        if (tilePhase && groupIndex == 0)
+        {
+            TileLists[TileListIndex(TILE_LIST_BLOCK_SUMS, groupId.x, Raster)] = total;
+        }
+    }
+    else if (Raster.Phase == TILE_RASTER_PHASE_ADD_BLOCKS)
+    {
+        if (index < tileCount)
+        {
+            TileLists[TileListIndex(TILE_LIST_START, index, Raster)] += TileLists[TileListIndex(TILE_LIST_BLOCK_SUMS, index / TILE_RASTER_SCAN_BLOCK, Raster)];
+            TileLists[TileListIndex(TILE_LIST_CURSOR, index, Raster)] = 0;
+        }
+    }
+}
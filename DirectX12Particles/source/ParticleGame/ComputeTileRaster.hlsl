@@ -0,0 +1,181 @@
+#include "TiledRaster.hlsli"
+#include "ParticleAtlas.hlsli"
+
+cbuffer RootConstants : register(b0)
+{
+    TileRasterConstants Raster;
+};
+
+ConstantBuffer<ParticleAtlasConstants> Atlas : register(b1);
+
+StructuredBuffer<Particle> Particles : register(t0);
+StructuredBuffer<uint> DrawList : register(t1);
+
+RWStructuredBuffer<uint> TileLists : register(u0);
+RWStructuredBuffer<uint> TileEntries : register(u1);
+RWTexture2D<float4> SceneColor : register(u2);
+
+Texture2D DepthBuffer : register(t3);
+Texture2DArray ParticleTexture : register(t4);
+
+// The tile's lowest draw positions so far, the second half takes the next block of its list
+groupshared uint Entries[TILE_RASTER_MAX_ENTRIES * 2];
+groupshared uint EntryStart;
+groupshared uint EntryCount;
+
+// Footprints of the batch of particles every pixel of the tile blends next
+groupshared float4 BatchUVAxes[TILE_RASTER_THREADS];
+groupshared float2 BatchCenter[TILE_RASTER_THREADS];
+groupshared float4 BatchColor[TILE_RASTER_THREADS];
+groupshared float BatchDepth[TILE_RASTER_THREADS];
+groupshared uint BatchFrame[TILE_RASTER_THREADS];
+
+// Copies count draw positions of the tile list from first into Entries at destination, padded to size with the highest position
+void LoadEntries(uint destination, uint first, uint count, uint size, uint groupIndex)
+{
+    for (uint n = groupIndex; n < size; n += TILE_RASTER_THREADS)
+    {
+        Entries[destination + n] = n < count ? TileEntries[first + n] : 0xFFFFFFFF;
+    }
+    GroupMemoryBarrierWithGroupSync();
+}
+
+// Bitonic sort of the sortSize entries from first, sortSize is a power of two
+void SortEntries(uint first, uint sortSize, uint groupIndex)
+{
+    for (uint k = 2; k <= sortSize; k <<= 1)
+    {
+        for (uint j = k >> 1; j > 0; j >>= 1)
+        {
+            for (uint n = groupIndex; n < sortSize; n += TILE_RASTER_THREADS)
+            {
+                uint partner = n ^ j;
+                if (partner > n)
+                {
+                    uint a = Entries[first + n];
+                    uint b = Entries[first + partner];
+                    if ((a > b) == ((n & k) == 0))
+                    {
+                        Entries[first + n] = b;
+                        Entries[first + partner] = a;
+                    }
+                }
+            }
+            GroupMemoryBarrierWithGroupSync();
+        }
+    }
+}
+
+// Sorts the bitonic sequence in the first TILE_RASTER_MAX_ENTRIES entries
+void MergeEntries(uint groupIndex)
+{
+    for (uint j = TILE_RASTER_MAX_ENTRIES >> 1; j > 0; j >>= 1)
+    {
+        for (uint n = groupIndex; n < TILE_RASTER_MAX_ENTRIES; n += TILE_RASTER_THREADS)
+        {
+            uint partner = n ^ j;
+            if (partner > n && Entries[n] > Entries[partner])
+            {
+                uint a = Entries[n];
+                Entries[n] = Entries[partner];
+                Entries[partner] = a;
+            }
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
+
+// One group per screen tile, every thread owns one pixel and blends the tile's particles in draw order
+[numthreads(TILE_RASTER_SIZE, TILE_RASTER_SIZE, 1)]
+void CSMain(uint3 groupId : SV_GroupID, uint3 dispatchThreadId : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+    uint tile = groupId.y * Raster.TileCount.x + groupId.x;
+    if (groupIndex == 0)
+    {
+        uint listIndex = TileListIndex(TILE_LIST_COUNT, tile, Raster);
+        EntryStart = TileLists[TileListIndex(TILE_LIST_START, tile, Raster)];
+        EntryCount = TileListFits(EntryStart, TileLists[listIndex], Raster) ? TileLists[listIndex] : 0;
+        TileLists[listIndex] = 0; // Ready for next frame's bin pass
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    uint start = EntryStart;
+    uint count = EntryCount;
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Scattered entries land in any order, sorting the draw positions restores the draw list's order. Longer lists merge every
+    // further block in and keep the lowest positions, the same TILE_RASTER_MAX_ENTRIES TiledRasterCPU draws.
+    uint sortSize = 1;
+    while (sortSize < min(count, TILE_RASTER_MAX_ENTRIES))
+    {
+        sortSize <<= 1;
+    }
+    LoadEntries(0, start, min(count, TILE_RASTER_MAX_ENTRIES), sortSize, groupIndex);
+    SortEntries(0, sortSize, groupIndex);
+    for (uint block = TILE_RASTER_MAX_ENTRIES; block < count; block += TILE_RASTER_MAX_ENTRIES)
+    {
+        LoadEntries(TILE_RASTER_MAX_ENTRIES, start + block, min(count - block, TILE_RASTER_MAX_ENTRIES), TILE_RASTER_MAX_ENTRIES, groupIndex);
+        SortEntries(TILE_RASTER_MAX_ENTRIES, TILE_RASTER_MAX_ENTRIES, groupIndex);
+
+        // Both halves ascend, the lower of each entry and its mirror in the other half is a bitonic sequence of the lowest ones
+        for (uint n = groupIndex; n < TILE_RASTER_MAX_ENTRIES; n += TILE_RASTER_THREADS)
+        {
+            Entries[n] = min(Entries[n], Entries[TILE_RASTER_MAX_ENTRIES * 2 - 1 - n]);
+        }
+        GroupMemoryBarrierWithGroupSync();
+        MergeEntries(groupIndex);
+    }
+    count = min(count, TILE_RASTER_MAX_ENTRIES);
+
+    uint2 pixel = dispatchThreadId.xy;
+    bool inside = pixel.x < Raster.Dimensions.x && pixel.y < Raster.Dimensions.y;
+    float2 pixelCenter = float2(pixel.x + 0.5f, pixel.y + 0.5f);
+    float sceneDepth = inside ? DepthBuffer.Load(int3(pixel, 0)).r : 0.0f;
+    float4 color = inside ? SceneColor[pixel] : float4(0, 0, 0, 0);
+
+    uint3 textureSize;
+    ParticleTexture.GetDimensions(textureSize.x, textureSize.y, textureSize.z);
+
+    for (uint batch = 0; batch < count; batch += TILE_RASTER_THREADS)
+    {
+        uint entry = batch + groupIndex;
+        if (entry < count)
+        {
+            Particle particle = Particles[DrawList[Entries[entry]]];
+            ParticleFootprint footprint = ProjectParticle(particle, Raster);
+            BatchUVAxes[groupIndex] = footprint.UVAxes;
+            BatchCenter[groupIndex] = footprint.Center;
+            BatchDepth[groupIndex] = footprint.Depth;
+            BatchColor[groupIndex] = particle.color;
+            BatchFrame[groupIndex] = ParticleAtlasFrame(particle.lifeTimeLeft, Atlas);
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        uint batchCount = min(count - batch, TILE_RASTER_THREADS);
+        for (uint n = 0; n < batchCount; ++n)
+        {
+            ParticleFootprint footprint;
+            footprint.Rect = float4(0, 0, 0, 0); // Only binning reads the rect
+            footprint.UVAxes = BatchUVAxes[n];
+            footprint.Center = BatchCenter[n];
+            footprint.Depth = BatchDepth[n];
+            footprint.Valid = 1;
+
+            if (inside && footprint.Depth < sceneDepth && FootprintCovers(footprint, pixelCenter))
+            {
+                float3 uv = ParticleAtlasUV(FootprintUV(footprint, pixelCenter), BatchFrame[n], Atlas);
+                float alpha = ParticleTexture.Load(int4(UVTexel(uv.xy, textureSize.xy), Atlas.Slice, 0)).a;
+                color = TileRasterBlend(color, alpha * BatchColor[n], Raster.AlphaBlend);
+            }
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (inside)
+    {
+        SceneColor[pixel] = color;
+    }
+}
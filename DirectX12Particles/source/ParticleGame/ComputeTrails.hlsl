@@ -0,0 +1,50 @@
+#include "Trail.hlsli"
+
+cbuffer RootConstants : register(b0)
+{
+    TrailConstants Trail;
+};
+
+StructuredBuffer<Particle> Particles : register(t0);
+StructuredBuffer<uint> VisibleIndices : register(t1);
+ByteAddressBuffer DrawArgs : register(t2);
+StructuredBuffer<float4> TrailHistory : register(t3);
+
+RWStructuredBuffer<TrailVertex> TrailVertices : register(u0);
+RWByteAddressBuffer TrailDrawArgs : register(u1);
+
+// One thread per entry of the draw list, writes TRAIL_VERTICES_PER_PARTICLE vertices at its draw list position
+[numthreads(TRAIL_THREADS, 1, 1)]
+void CSMain(uint3 dispatchId : SV_DispatchThreadID)
+{
+    uint visibleCount = DrawArgs.Load(Trail.DrawArgsOffset);
+    if (dispatchId.x == 0)
+    {
+        // DrawIndexedInstanced(visibleCount * TRAIL_INDICES_PER_PARTICLE, 1, 0, 0, 0) over the static trail index buffer
+        TrailDrawArgs.Store4(0, uint4(visibleCount * TRAIL_INDICES_PER_PARTICLE, 1, 0, 0));
+        TrailDrawArgs.Store(16, 0);
+    }
+    if (dispatchId.x >= visibleCount)
+    {
+        return;
+    }
+
+    uint particleIndex = VisibleIndices[dispatchId.x];
+    Particle particle = Particles[particleIndex];
+
+    float4 samples[TRAIL_LENGTH];
+    [unroll]
+    for (uint age = 0; age < TRAIL_LENGTH; ++age)
+    {
+        samples[age] = TrailHistory[TrailHistoryIndex(TrailSlot(Trail.Head, age), particleIndex, Trail.MaxParticleCount)];
+    }
+
+    uint firstVertex = dispatchId.x * TRAIL_VERTICES_PER_PARTICLE;
+    [unroll]
+    for (uint age = 0; age < TRAIL_LENGTH; ++age)
+    {
+        float3 tangent = TrailTangent(samples[age == 0 ? 0 : age - 1], samples[min(age + 1, TRAIL_LENGTH - 1)]);
+        TrailVertices[firstVertex + 2 * age] = MakeTrailVertex(samples[age], tangent, -1.0f, age, particle.color, Trail);
+        TrailVertices[firstVertex + 2 * age + 1] = MakeTrailVertex(samples[age], tangent, 1.0f, age, particle.color, Trail);
+    }
+}
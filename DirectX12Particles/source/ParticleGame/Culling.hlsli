@@ -0,0 +1,93 @@
+#ifndef CULLING_HLSLI
+#define CULLING_HLSLI
+
+#include "SharedCommon.hlsli"
+#include "HiZ.hlsli"
+
+// Billboard corners sit at +-scale on the view space x and y axes, the bounding sphere radius is scale * sqrt(2)
+#define CULL_BILLBOARD_RADIUS 1.41421356f
+
+// Per-frame culling inputs, bound to the simulate pass as a root CBV
+struct CullConstants
+{
+    float4 FrustumPlanes[6]; // World space, normals point inwards
+    float4 ViewDepthAxis; // Third column of the current view matrix, dot with a world position gives its view depth
+    float4x4 HiZView; // View the Hi-Z pyramid was rendered with, the previous frame's
+    float4 HiZProjection; // _11, _22, _33 and _43 of the previous frame's projection
+    uint2 HiZDimensions;
+    uint HiZMipCount;
+    uint HiZEnabled; // 0 until a pyramid has been built for the current depth buffer
+};
+
+// Screen space rectangle of a sphere in Hi-Z UVs (min x, min y, max x, max y) and the depth of its closest point
+struct HiZBounds
+{
+    float4 Rect;
+    float NearestDepth;
+    uint Valid; // 0 when the sphere crosses the camera plane, such spheres are never occluded
+};
+
+SHARED_INLINE bool SphereInFrustum(float3 center, float radius, CullConstants cull)
+{
+    for (int plane = 0; plane < 6; ++plane)
+    {
+        if (dot(cull.FrustumPlanes[plane], float4(center, 1.0f)) < -radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Conservative bounds of the sphere's view space box, each edge is projected from whichever box depth pushes it outwards
+SHARED_INLINE HiZBounds ProjectSphereToHiZ(float3 center, float radius, CullConstants cull)
+{
+    float4 viewCenter = mul(cull.HiZView, float4(center, 1.0f));
+    float nearZ = viewCenter.z - radius;
+    float farZ = viewCenter.z + radius;
+
+    HiZBounds bounds;
+    bounds.Valid = nearZ > 0.0001f ? 1u : 0u;
+    nearZ = max(nearZ, 0.0001f);
+
+    float minX = viewCenter.x - radius;
+    float maxX = viewCenter.x + radius;
+    float minY = viewCenter.y - radius;
+    float maxY = viewCenter.y + radius;
+    minX = minX / (minX < 0.0f ? nearZ : farZ) * cull.HiZProjection.x;
+    maxX = maxX / (maxX > 0.0f ? nearZ : farZ) * cull.HiZProjection.x;
+    minY = minY / (minY < 0.0f ? nearZ : farZ) * cull.HiZProjection.y;
+    maxY = maxY / (maxY > 0.0f ? nearZ : farZ) * cull.HiZProjection.y;
+
+    // NDC y points up, texture rows go down
+    bounds.Rect = saturate(float4(minX * 0.5f + 0.5f, 0.5f - maxY * 0.5f, maxX * 0.5f + 0.5f, 0.5f - minY * 0.5f));
+    bounds.NearestDepth = cull.HiZProjection.z + cull.HiZProjection.w / nearZ;
+    return bounds;
+}
+
+// Lowest mip where the rectangle spans at most 2x2 texels
+SHARED_INLINE uint HiZCullMip(HiZBounds bounds, CullConstants cull)
+{
+    float width = (bounds.Rect.z - bounds.Rect.x) * cull.HiZDimensions.x;
+    float height = (bounds.Rect.w - bounds.Rect.y) * cull.HiZDimensions.y;
+    float mip = ceil(log2(max(max(width, height), 1.0f)));
+    return min((uint)mip, cull.HiZMipCount - 1u);
+}
+
+// Texel corners (min x, min y, max x, max y) of the rectangle at mip, texel i of a mip covers mip 0 pixels [i << mip, (i + 1) << mip)
+SHARED_INLINE uint4 HiZCullTexels(HiZBounds bounds, CullConstants cull, uint mip)
+{
+    uint minX = min((uint)(bounds.Rect.x * cull.HiZDimensions.x), cull.HiZDimensions.x - 1u);
+    uint minY = min((uint)(bounds.Rect.y * cull.HiZDimensions.y), cull.HiZDimensions.y - 1u);
+    uint maxX = min((uint)(bounds.Rect.z * cull.HiZDimensions.x), cull.HiZDimensions.x - 1u);
+    uint maxY = min((uint)(bounds.Rect.w * cull.HiZDimensions.y), cull.HiZDimensions.y - 1u);
+    return uint4(minX >> mip, minY >> mip, maxX >> mip, maxY >> mip);
+}
+
+// furthest is HiZReduce of the four texels from HiZCullTexels
+SHARED_INLINE bool HiZOccluded(HiZBounds bounds, float2 furthest)
+{
+    return bounds.Valid != 0u && bounds.NearestDepth > furthest.y;
+}
+
+#endif
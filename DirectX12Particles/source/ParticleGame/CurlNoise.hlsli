@@ -0,0 +1,24 @@
+#ifndef CURL_NOISE_HLSLI
+#define CURL_NOISE_HLSLI
+
+#include "SharedCommon.hlsli"
+
+// Texels per side of the baked turbulence volume, see ParticleCPU/CurlNoise.h for the bake
+#define CURL_NOISE_SIZE 64
+
+struct CurlNoiseConstants
+{
+    float3 Offset; // Texture space scroll, the game moves it every frame so the flow keeps changing
+    float Frequency; // Texture repeats per world unit
+    float Strength; // Acceleration of an average length curl sample
+    uint Enabled;
+    uint2 Padding;
+};
+
+// Texture coordinates of a world position, the volume tiles so these are sampled with wrap addressing
+SHARED_INLINE float3 CurlNoiseCoordinates(float3 position, CurlNoiseConstants constants)
+{
+    return position * constants.Frequency + constants.Offset;
+}
+
+#endif
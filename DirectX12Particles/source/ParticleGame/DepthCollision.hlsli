@@ -0,0 +1,106 @@
+#ifndef DEPTH_COLLISION_HLSLI
+#define DEPTH_COLLISION_HLSLI
+
+#include "Culling.hlsli"
+#include "Collision.hlsli"
+
+// Screen space collision against the depth the Hi-Z pyramid was built from. Mip 0 of the pyramid is a full
+// resolution copy of last frame's depth and CullConstants carries the matching view and projection.
+
+// Where a particle lands in the previous frame's depth buffer
+struct DepthCollisionSample
+{
+    uint2 Texel; // Clamped so the +x and +y neighbors used for the normal exist
+    float ViewZ;
+    uint Valid; // 0 behind the camera or outside the screen
+};
+
+SHARED_INLINE DepthCollisionSample DepthCollisionProject(float3 position, CullConstants cull)
+{
+    float4 viewPosition = mul(cull.HiZView, float4(position, 1.0f));
+
+    DepthCollisionSample depthSample;
+    depthSample.ViewZ = viewPosition.z;
+    depthSample.Valid = 0;
+    depthSample.Texel = uint2(0, 0);
+    if (viewPosition.z <= 0.0001f)
+    {
+        return depthSample;
+    }
+
+    float u = viewPosition.x / viewPosition.z * cull.HiZProjection.x * 0.5f + 0.5f;
+    float v = 0.5f - viewPosition.y / viewPosition.z * cull.HiZProjection.y * 0.5f;
+    if (u < 0.0f || v < 0.0f || u >= 1.0f || v >= 1.0f)
+    {
+        return depthSample;
+    }
+
+    depthSample.Texel = uint2(min((uint)(u * cull.HiZDimensions.x), cull.HiZDimensions.x - 2u),
+                              min((uint)(v * cull.HiZDimensions.y), cull.HiZDimensions.y - 2u));
+    depthSample.Valid = 1;
+    return depthSample;
+}
+
+// Inverse of the NearestDepth projection in ProjectSphereToHiZ
+SHARED_INLINE float DepthCollisionViewZ(float depth, CullConstants cull)
+{
+    return cull.HiZProjection.w / (depth - cull.HiZProjection.z);
+}
+
+// View space position of the surface at a texel center
+SHARED_INLINE float3 DepthCollisionViewPosition(uint2 texel, float depth, CullConstants cull)
+{
+    float viewZ = DepthCollisionViewZ(depth, cull);
+    float x = ((texel.x + 0.5f) / cull.HiZDimensions.x * 2.0f - 1.0f) * viewZ / cull.HiZProjection.x;
+    float y = (1.0f - (texel.y + 0.5f) / cull.HiZDimensions.y * 2.0f) * viewZ / cull.HiZProjection.y;
+    return float3(x, y, viewZ);
+}
+
+// World space normal from the depth gradients, like the SSAO pass in ComputePostProcess.hlsl, flipped to face the camera.
+// depths holds the depth at the texel, one texel right and one texel down.
+SHARED_INLINE float3 DepthCollisionNormal(uint2 texel, float3 depths, CullConstants cull)
+{
+    float3 center = DepthCollisionViewPosition(texel, depths.x, cull);
+    float3 right = DepthCollisionViewPosition(uint2(texel.x + 1u, texel.y), depths.y, cull);
+    float3 down = DepthCollisionViewPosition(uint2(texel.x, texel.y + 1u), depths.z, cull);
+    float3 normal = normalize(cross(right - center, down - center));
+    if (dot(normal, center) > 0.0f)
+    {
+        normal = -normal;
+    }
+
+    // The view rotation is orthonormal, so world axis i in view space dotted with the normal gives world component i
+    float4 axisX = mul(cull.HiZView, float4(1, 0, 0, 0));
+    float4 axisY = mul(cull.HiZView, float4(0, 1, 0, 0));
+    float4 axisZ = mul(cull.HiZView, float4(0, 0, 1, 0));
+    return float3(dot(normal, float3(axisX.x, axisX.y, axisX.z)),
+                  dot(normal, float3(axisY.x, axisY.y, axisY.z)),
+                  dot(normal, float3(axisZ.x, axisZ.y, axisZ.z)));
+}
+
+// Bounces the particle off the depth buffer surface when its sphere reaches into the surface's thickness while moving into it.
+// The particle returns to from, its position before this step, which was still in front of the surface.
+SHARED_INLINE Particle DepthCollide(Particle particle, float3 from, DepthCollisionSample depthSample, float3 depths, CullConstants cull, CollisionConstants collision)
+{
+    // Far plane depth is empty sky
+    if (depthSample.Valid == 0u || depths.x >= 1.0f)
+    {
+        return particle;
+    }
+
+    float radius = particle.scale * collision.RadiusScale;
+    float surfaceZ = DepthCollisionViewZ(depths.x, cull);
+    if (depthSample.ViewZ + radius < surfaceZ || depthSample.ViewZ - radius > surfaceZ + collision.DepthThickness)
+    {
+        return particle;
+    }
+
+    float3 normal = DepthCollisionNormal(depthSample.Texel, depths, cull);
+    if (dot(float3(particle.velocity.x, particle.velocity.y, particle.velocity.z), normal) >= 0.0f)
+    {
+        return particle;
+    }
+    return CollisionResponse(particle, normal, from, 0.0f, collision);
+}
+
+#endif
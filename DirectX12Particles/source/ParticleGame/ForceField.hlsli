@@ -0,0 +1,86 @@
+#ifndef FORCE_FIELD_HLSLI
+#define FORCE_FIELD_HLSLI
+
+#include "SharedCommon.hlsli"
+
+#define FORCE_FIELD_ATTRACTOR 0 // Pulls towards Position, a negative Strength repels
+#define FORCE_FIELD_VORTEX 1 // Swirls around the line through Position along Axis, in a column reaching Radius either way along it
+#define FORCE_FIELD_WIND 2 // Constant push along Axis inside the box Position +- Extents
+#define FORCE_FIELD_DRAG 3 // Slows particles down inside Radius
+
+// Upper bound of the per group list in ComputeSimulator.hlsl, the game never uploads more
+#define FORCE_FIELD_MAX_COUNT 64
+
+struct ForceField
+{
+    float3 Position;
+    uint Type;
+    float3 Axis; // Unit vortex axis or wind direction
+    float Strength; // Acceleration at full influence, drag is 1/s
+    float3 Extents; // Wind box half size, the other types use Radius
+    float Radius;
+};
+
+// Attractors, vortices and drag fade out linearly towards Radius
+SHARED_INLINE float ForceFieldFalloff(float distance, float radius)
+{
+    return saturate(1.0f - distance / radius);
+}
+
+SHARED_INLINE float3 ForceFieldBoundsMin(ForceField field)
+{
+    return field.Type == FORCE_FIELD_WIND ? field.Position - field.Extents : field.Position - float3(field.Radius, field.Radius, field.Radius);
+}
+
+SHARED_INLINE float3 ForceFieldBoundsMax(ForceField field)
+{
+    return field.Type == FORCE_FIELD_WIND ? field.Position + field.Extents : field.Position + float3(field.Radius, field.Radius, field.Radius);
+}
+
+// Box test used to cull fields against the bounds of a group of particles
+SHARED_INLINE bool ForceFieldOverlaps(ForceField field, float3 boundsMin, float3 boundsMax)
+{
+    float3 fieldMin = ForceFieldBoundsMin(field);
+    float3 fieldMax = ForceFieldBoundsMax(field);
+    return fieldMin.x <= boundsMax.x && fieldMin.y <= boundsMax.y && fieldMin.z <= boundsMax.z &&
+           fieldMax.x >= boundsMin.x && fieldMax.y >= boundsMin.y && fieldMax.z >= boundsMin.z;
+}
+
+SHARED_INLINE float3 ForceFieldAcceleration(ForceField field, float3 position, float3 velocity)
+{
+    float3 offset = field.Position - position;
+    if (field.Type == FORCE_FIELD_WIND)
+    {
+        float3 distance = abs(offset);
+        bool inside = distance.x <= field.Extents.x && distance.y <= field.Extents.y && distance.z <= field.Extents.z;
+        return inside ? field.Axis * field.Strength : float3(0, 0, 0);
+    }
+
+    if (field.Type == FORCE_FIELD_VORTEX)
+    {
+        // Distance to the axis line, the swirl is tangential so it doesn't pull particles in.
+        // The column ends Radius along the axis so the field stays inside the bounds it's culled by.
+        float along = dot(offset, field.Axis);
+        float3 radial = offset - field.Axis * along;
+        float distance = length(radial);
+        if (distance <= 0.0001f || abs(along) > field.Radius)
+        {
+            return float3(0, 0, 0);
+        }
+        return cross(field.Axis, radial / distance) * (field.Strength * ForceFieldFalloff(distance, field.Radius));
+    }
+
+    float distance = length(offset);
+    if (field.Type == FORCE_FIELD_DRAG)
+    {
+        return velocity * (-field.Strength * ForceFieldFalloff(distance, field.Radius));
+    }
+
+    if (distance <= 0.0001f)
+    {
+        return float3(0, 0, 0);
+    }
+    return offset * (field.Strength * ForceFieldFalloff(distance, field.Radius) / distance);
+}
+
+#endif
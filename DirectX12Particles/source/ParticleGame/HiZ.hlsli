@@ -0,0 +1,36 @@
+#ifndef HIZ_HLSLI
+#define HIZ_HLSLI
+
+#include "SharedCommon.hlsli"
+
+// Enough levels for a 4096 wide depth buffer, mip 0 is a full resolution copy of the depth
+#define HIZ_MAX_MIPS 13
+
+// Each SPD group reduces a 64x64 tile of mip 0 down to one texel of mip 6, the last group to finish builds the rest
+#define HIZ_TILE_SIZE 64
+#define HIZ_GROUP_MIPS 7
+#define HIZ_THREADS 256
+
+// Mips round up so the pyramid stays conservative for odd sizes, reads past the edge clamp to the last texel
+SHARED_INLINE uint HiZMipDimension(uint size, uint mip)
+{
+    return max(1u, (size + (1u << mip) - 1u) >> mip);
+}
+
+SHARED_INLINE uint HiZMipCount(uint width, uint height)
+{
+    uint count = 1;
+    while ((HiZMipDimension(width, count - 1) > 1 || HiZMipDimension(height, count - 1) > 1) && count < HIZ_MAX_MIPS)
+    {
+        ++count;
+    }
+    return count;
+}
+
+// x holds the closest depth and y the furthest
+SHARED_INLINE float2 HiZReduce(float2 a, float2 b, float2 c, float2 d)
+{
+    return float2(min(min(a.x, b.x), min(c.x, d.x)), max(max(a.y, b.y), max(c.y, d.y)));
+}
+
+#endif
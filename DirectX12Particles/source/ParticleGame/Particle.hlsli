@@ -0,0 +1,98 @@
+#ifndef PARTICLE_HLSLI
+#define PARTICLE_HLSLI
+
+#include "SharedCommon.hlsli"
+
+struct Particle
+{
+    float4 position;
+    float4 velocity;
+    float4 acceleration;
+    float4 color; // What gets drawn, the spawn tint times the emitter's color curves when it has them
+    float lifeTimeLeft;
+    float scale;
+    float rotation; // Billboard roll in radians
+    uint tint; // Spawn color, RGBA8
+    uint generation; // Sub-emitter generation, see SubEmitter.hlsli
+};
+
+// Sentinel for EmitterConstants.curveSet, the emitter keeps the linear scale and its spawn colors
+#define CURVE_SET_NONE 0xffffffff
+
+// Emitter root constants of the emit and simulate passes, VertexAABB.hlsl reads the same layout
+struct EmitterConstants
+{
+    float deltaTime;
+    float particleLifetime;
+    uint emitCount;
+    uint maxParticleCount;
+    float4 emitAABBMin;
+    float4 emitAABBMax;
+    float4 emitVelocityMin;
+    float4 emitVelocityMax;
+    float4 emitAccelerationMin;
+    float4 emitAccelerationMax;
+    float particleStartScale;
+    float particleEndScale;
+    uint curveSet; // Curve set of the emitter in the curve atlas, see ParticleCurves.hlsli
+};
+
+SHARED_INLINE uint PackParticleTint(float4 color)
+{
+    return (uint)(saturate(color.x) * 255.0f + 0.5f) | ((uint)(saturate(color.y) * 255.0f + 0.5f) << 8) |
+           ((uint)(saturate(color.z) * 255.0f + 0.5f) << 16) | ((uint)(saturate(color.w) * 255.0f + 0.5f) << 24);
+}
+
+SHARED_INLINE float4 UnpackParticleTint(uint tint)
+{
+    return float4((float)(tint & 0xff), (float)((tint >> 8) & 0xff), (float)((tint >> 16) & 0xff), (float)(tint >> 24)) / 255.0f;
+}
+
+SHARED_INLINE float ParticleRandom(float2 p)
+{
+    float2 K1 = float2(
+        23.14069263277926f, // e^pi (Gelfond's constant)
+         2.665144142690225f // 2^sqrt(2) (Gelfond–Schneider constant)
+    );
+    return frac(cos(dot(p, K1)) * 12345.6789f);
+}
+
+// index is the thread's emit slot this frame, particleIndex the dead slot it took
+SHARED_INLINE Particle EmitParticle(uint index, uint particleIndex, uint realEmitCount, EmitterConstants emitter)
+{
+    float randomValue0 = ParticleRandom(float2(index, particleIndex));
+    float randomValue1 = ParticleRandom(float2(particleIndex * emitter.deltaTime, index));
+    float randomValue2 = ParticleRandom(float2(particleIndex + realEmitCount, emitter.deltaTime));
+
+    Particle newParticle;
+
+    newParticle.position = lerp(emitter.emitAABBMin, emitter.emitAABBMax, float4(randomValue0, randomValue1, randomValue2, 0));
+    newParticle.position.w = 1;
+
+    randomValue0 = ParticleRandom(float2(emitter.deltaTime, randomValue2));
+    randomValue1 = ParticleRandom(float2(randomValue0, randomValue1));
+    randomValue2 = ParticleRandom(float2(index * 5, particleIndex));
+
+    newParticle.velocity = lerp(emitter.emitVelocityMin, emitter.emitVelocityMax, float4(randomValue1, randomValue2, randomValue0, 0));
+    newParticle.acceleration = lerp(emitter.emitAccelerationMin, emitter.emitAccelerationMax, float4(randomValue2, randomValue0, randomValue1, 0));
+    newParticle.lifeTimeLeft = emitter.particleLifetime;
+    newParticle.scale = emitter.particleStartScale;
+    newParticle.color = float4(randomValue0, randomValue1, randomValue2, 1);
+    newParticle.rotation = 0;
+    newParticle.tint = PackParticleTint(newParticle.color);
+    newParticle.generation = 1;
+
+    return newParticle;
+}
+
+// One integration step, the caller retires the particle once lifeTimeLeft drops to 0
+SHARED_INLINE Particle SimulateParticle(Particle particle, EmitterConstants emitter)
+{
+    particle.velocity += particle.acceleration * emitter.deltaTime;
+    particle.position += particle.velocity * emitter.deltaTime;
+    particle.lifeTimeLeft -= emitter.deltaTime;
+    particle.scale = lerp(emitter.particleEndScale, emitter.particleStartScale, particle.lifeTimeLeft / emitter.particleLifetime);
+    return particle;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef PARTICLE_ATLAS_HLSLI
+#define PARTICLE_ATLAS_HLSLI
+
+#include "SharedCommon.hlsli"
+
+// Every particle texture and flipbook sheet is packed into one texture array, see ParticleAtlas.h. A flipbook's frames are a
+// Columns x Rows grid over its rect, row by row from the top left, and a still texture is a one frame flipbook.
+#define PARTICLE_ATLAS_NAME_LENGTH 32
+
+// Root constants of the particle draws and the tile raster, the active emitter's entry
+struct ParticleAtlasConstants
+{
+    float4 Rect; // uMin, vMin, uMax, vMax in the slice
+    uint Slice;
+    uint Columns;
+    uint Rows;
+    uint FrameCount; // At most Columns * Rows, the last row can be partial
+    float Lifetime; // The emitter's particle lifetime, a flipbook plays once over it
+    float3 Padding;
+};
+
+// Frame of a particle with lifeTimeLeft seconds to go
+SHARED_INLINE uint ParticleAtlasFrame(float lifeTimeLeft, ParticleAtlasConstants atlas)
+{
+    float age = saturate(1.0f - lifeTimeLeft / atlas.Lifetime);
+    return min((uint)(age * (float)atlas.FrameCount), atlas.FrameCount - 1);
+}
+
+// Atlas UV of a [0, 1] UV over the frame's cell, the slice goes in z for Texture2DArray
+SHARED_INLINE float3 ParticleAtlasUV(float2 uv, uint frame, ParticleAtlasConstants atlas)
+{
+    float u = ((float)(frame % atlas.Columns) + uv.x) / (float)atlas.Columns;
+    float v = ((float)(frame / atlas.Columns) + uv.y) / (float)atlas.Rows;
+    return float3(lerp(atlas.Rect.x, atlas.Rect.z, u), lerp(atlas.Rect.y, atlas.Rect.w, v), (float)atlas.Slice);
+}
+
+#endif
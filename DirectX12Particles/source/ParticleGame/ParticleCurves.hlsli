@@ -0,0 +1,59 @@
+#ifndef PARTICLE_CURVES_HLSLI
+#define PARTICLE_CURVES_HLSLI
+
+#include "Particle.hlsli"
+
+// Over-lifetime curves are baked into a Texture1DArray, every emitter's curve set takes CURVE_ATLAS_SLICES slices.
+// Sampling the atlas replaces walking the curve keys in the shader.
+#define CURVE_ATLAS_WIDTH 64 // Samples over normalized age
+#define CURVE_ATLAS_SLICES 2
+#define CURVE_ATLAS_COLOR_SLICE 0 // Color gradient in rgb, alpha curve in a
+#define CURVE_ATLAS_MOTION_SLICE 1 // Scale, drag and rotation curves in xyz
+
+// All curves of one curve set at one age
+struct ParticleCurveSample
+{
+    float4 Color; // Multiplies the spawn tint
+    float Scale; // Billboard half size
+    float Drag; // Velocity damping per second
+    float Rotation; // Billboard roll in radians
+};
+
+// 0 at spawn, 1 when the particle dies
+SHARED_INLINE float ParticleAge(Particle particle, EmitterConstants emitter)
+{
+    return saturate(1.0f - particle.lifeTimeLeft / emitter.particleLifetime);
+}
+
+// Ages 0 and 1 land on the first and last texel centers, so the curve ends come out exact with linear filtering
+SHARED_INLINE float CurveAtlasU(float age)
+{
+    return (saturate(age) * (CURVE_ATLAS_WIDTH - 1) + 0.5f) / CURVE_ATLAS_WIDTH;
+}
+
+SHARED_INLINE float CurveAtlasSlice(uint curveSet, uint slice)
+{
+    return (float)(curveSet * CURVE_ATLAS_SLICES + slice);
+}
+
+SHARED_INLINE ParticleCurveSample MakeParticleCurveSample(float4 colorTexel, float4 motionTexel)
+{
+    ParticleCurveSample curves;
+    curves.Color = colorTexel;
+    curves.Scale = motionTexel.x;
+    curves.Drag = motionTexel.y;
+    curves.Rotation = motionTexel.z;
+    return curves;
+}
+
+SHARED_INLINE Particle ApplyParticleCurves(Particle particle, ParticleCurveSample curves, float deltaTime)
+{
+    // Implicit damping stays stable for any drag * deltaTime
+    particle.velocity = particle.velocity / (1.0f + curves.Drag * deltaTime);
+    particle.scale = curves.Scale;
+    particle.rotation = curves.Rotation;
+    particle.color = UnpackParticleTint(particle.tint) * curves.Color;
+    return particle;
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "Application.h"
 #include "CommandQueue.h"
+#include "HighResolutionClock.h"
 #include "Window.h"
 
 using namespace DirectX;
@@ -25,6 +26,86 @@ static WORD Indices[6] = {
 	0, 1, 2, 0, 2, 3
 };
 
+// Shader bytecode by content, its pointer changes every run
+static void HashShader(ContentHash& hash, const D3D12_SHADER_BYTECODE& shader)
+{
+	hash.AddValue(static_cast<uint64_t>(shader.BytecodeLength));
+	hash.Add(shader.pShaderBytecode, shader.BytecodeLength);
+}
+
+// Field by field, the render target descs end in padding
+static void HashBlendDesc(ContentHash& hash, const D3D12_BLEND_DESC& blend)
+{
+	hash.AddValue(blend.AlphaToCoverageEnable).AddValue(blend.IndependentBlendEnable);
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& target : blend.RenderTarget)
+	{
+		hash.AddValue(target.BlendEnable).AddValue(target.LogicOpEnable).AddValue(target.SrcBlend).AddValue(target.DestBlend).AddValue(target.BlendOp)
+			.AddValue(target.SrcBlendAlpha).AddValue(target.DestBlendAlpha).AddValue(target.BlendOpAlpha).AddValue(target.LogicOp)
+			.AddValue(target.RenderTargetWriteMask);
+	}
+}
+
+static const D3D12_INPUT_ELEMENT_DESC InputLayout[] =
+{
+	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+};
+
+struct RenderPipelineStateStream
+{
+	CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
+	CD3DX12_PIPELINE_STATE_STREAM_INPUT_LAYOUT InputLayout;
+	CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY PrimitiveTopologyType;
+	CD3DX12_PIPELINE_STATE_STREAM_VS VS;
+	CD3DX12_PIPELINE_STATE_STREAM_PS PS;
+	CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL_FORMAT DSVFormat;
+	CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS RTVFormats;
+	CD3DX12_PIPELINE_STATE_STREAM_RASTERIZER Rasterizer;
+	CD3DX12_PIPELINE_STATE_STREAM_BLEND_DESC BlendMode;
+};
+
+struct ComputePipelineStateStream
+{
+	CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
+	CD3DX12_PIPELINE_STATE_STREAM_CS CS;
+};
+
+// Everything a render PSO is built from, the root signature by the key of its serialized form
+static uint64_t GetRenderPipelineKey(RenderPipelineStateStream& stream, uint64_t rootSignatureKey)
+{
+	ContentHash hash;
+	hash.AddValue(rootSignatureKey);
+	const D3D12_INPUT_LAYOUT_DESC& layout = stream.InputLayout;
+	hash.AddValue(layout.NumElements);
+	for (UINT n = 0; n < layout.NumElements; ++n)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element = layout.pInputElementDescs[n];
+		hash.AddString(element.SemanticName).AddValue(element.SemanticIndex).AddValue(element.Format).AddValue(element.InputSlot)
+			.AddValue(element.AlignedByteOffset).AddValue(element.InputSlotClass).AddValue(element.InstanceDataStepRate);
+	}
+	hash.AddValue(static_cast<D3D12_PRIMITIVE_TOPOLOGY_TYPE&>(stream.PrimitiveTopologyType));
+	HashShader(hash, stream.VS);
+	HashShader(hash, stream.PS);
+	hash.AddValue(static_cast<DXGI_FORMAT&>(stream.DSVFormat));
+	hash.AddValue(static_cast<D3D12_RT_FORMAT_ARRAY&>(stream.RTVFormats));
+	hash.AddValue(static_cast<D3D12_RASTERIZER_DESC&>(static_cast<CD3DX12_RASTERIZER_DESC&>(stream.Rasterizer)));
+	HashBlendDesc(hash, static_cast<CD3DX12_BLEND_DESC&>(stream.BlendMode));
+	return hash.Get();
+}
+
+// Curve sets baked into the curve atlas, emitters pick one by index. The emitter library checks its records against their count.
+static std::vector<ParticleCurves> EmitterCurveSets()
+{
+	// Fades in, grows, cools from orange to grey, fades out and spins once over its life
+	ParticleCurves emitterCurves;
+	emitterCurves.Color = { { 0.0f, float3(1.0f, 0.85f, 0.4f) }, { 0.5f, float3(1.0f, 0.45f, 0.2f) }, { 1.0f, float3(0.35f, 0.35f, 0.4f) } };
+	emitterCurves.Alpha = { { 0.0f, 0.0f }, { 0.1f, 1.0f }, { 0.7f, 1.0f }, { 1.0f, 0.0f } };
+	emitterCurves.Scale = { { 0.0f, 0.05f }, { 0.15f, 0.35f }, { 1.0f, 0.15f } };
+	emitterCurves.Drag = { { 0.0f, 0.0f }, { 1.0f, 0.1f } };
+	emitterCurves.Rotation = { { 0.0f, 0.0f }, { 1.0f, XM_2PI } };
+	return { emitterCurves };
+}
+
 const UINT ParticleGame::ParticleBufferCounterOffset = (sizeof(UINT) * MaxParticleCount + (D3D12_UAV_COUNTER_PLACEMENT_ALIGNMENT - 1)) & ~(D3D12_UAV_COUNTER_PLACEMENT_ALIGNMENT - 1);
 
 ParticleGame::ParticleGame(const std::wstring& name, int width, int height, bool vSync)
@@ -37,6 +118,27 @@ ParticleGame::ParticleGame(const std::wstring& name, int width, int height, bool
 	, UseCompute(false)
 	, UsePostProcess(true)
 	, RenderRoom(false)
+	, UseAlphaBlending(false)
+	, UseTiledRaster(false)
+	, UseSPH(false)
+	, UseCollision(true)
+	, CollisionKillOnHit(false)
+	, UseDepthCollision(false)
+	, UseForceFields(false)
+	, UseCurlNoise(false)
+	, UseVectorFields(false)
+	, UseParticleCurves(true)
+	, UseTrails(false)
+	, UseSubEmitters(false)
+	, TrailHead(0)
+	, TrailRestart(false)
+	, SimulateTrailHead(TRAIL_HEAD_NONE)
+	, SimulateEventMask(0)
+	, VectorFieldSlotCount(0)
+	, ActiveEmitter(0)
+	, EmitterCurveSet(0)
+	, EmitterPollTimer(0)
+	, ForceFieldCount(0)
 	, deltaTime(0)
 	, PressingW(false)
 	, PressingA(false)
@@ -44,475 +146,1194 @@ ParticleGame::ParticleGame(const std::wstring& name, int width, int height, bool
 	, PressingD(false)
 	, PressingQ(false)
 	, PressingE(false)
+	, HiZBuilt(false)
+	, PreviousFrameFenceValue(0)
+	, MappedCullConstants(nullptr)
+	, MappedCollisionConstants(nullptr)
+	, MappedForceFields(nullptr)
+	, MappedCurlNoiseConstants(nullptr)
+	, MappedVectorFieldConstants(nullptr)
+	, MappedVectorFieldUpload(nullptr)
+	, VectorFieldUploadStride(0)
+	, PreviousView(XMMatrixIdentity())
+	, PreviousProjection(XMMatrixIdentity())
+	, CPUParticleSystem(MaxParticleCount, CPUThreadPool)
+	, MappedCPUUpload(nullptr)
+	, TextureBudget(0)
 {
 	CSRootConstants.particleLifetime = 35.0f;
 	CSRootConstants.emitCount = 100;
 	CSRootConstants.maxParticleCount = MaxParticleCount;
-	CSRootConstants.emitAABBMin = XMFLOAT4(-9.0f, -9.0f, -9.0f, 0);
-	CSRootConstants.emitAABBMax = XMFLOAT4( 9.0f,  9.0f,  9.0f, 0);
-	CSRootConstants.emitVelocityMin = XMFLOAT4(-1.0f, -1.0f, -3.0f, 0);
-	CSRootConstants.emitVelocityMax = XMFLOAT4( 1.0f,  1.0f,  3.0f, 0);
-	CSRootConstants.emitAccelerationMin = XMFLOAT4(-0.15f, 3.8f, -0.15f, 0);
-	CSRootConstants.emitAccelerationMax = XMFLOAT4( 0.15f, 4.8f,  0.15f, 0);
+	CSRootConstants.emitAABBMin = float4(-9.0f, -9.0f, -9.0f, 0);
+	CSRootConstants.emitAABBMax = float4( 9.0f,  9.0f,  9.0f, 0);
+	CSRootConstants.emitVelocityMin = float4(-1.0f, -1.0f, -3.0f, 0);
+	CSRootConstants.emitVelocityMax = float4( 1.0f,  1.0f,  3.0f, 0);
+	CSRootConstants.emitAccelerationMin = float4(-0.15f, 3.8f, -0.15f, 0);
+	CSRootConstants.emitAccelerationMax = float4( 0.15f, 4.8f,  0.15f, 0);
 	CSRootConstants.particleStartScale = 0.30f;
 	CSRootConstants.particleEndScale = 0.30f;
-
-	/*CSRootConstants.particleLifetime = 3.0f;
-	CSRootConstants.emitCount = 2;
-	CSRootConstants.maxParticleCount = MaxParticleCount;
-	CSRootConstants.emitAABBMin = XMFLOAT4(-6, 0, -7, 0);
-	CSRootConstants.emitAABBMax = XMFLOAT4(6, 10, 11, 0);
-	CSRootConstants.emitVelocityMin = XMFLOAT4(-1, -1, -1, 0);
-	CSRootConstants.emitVelocityMax = XMFLOAT4(0, 0, 1, 0);
-	CSRootConstants.emitAccelerationMin = XMFLOAT4(0, 0, 0, 0);
-	CSRootConstants.emitAccelerationMax = XMFLOAT4(0, 0, 0, 0);
-	CSRootConstants.particleStartScale = 0.10f;
-	CSRootConstants.particleEndScale = 0.01f;*/
+	CSRootConstants.curveSet = 0;
 
 	PPRootConstants.kernelSize = KernelSize;
 	PPRootConstants.noiseSize = NoiseSize;
 	PPRootConstants.kernelRadius = 1.0f;
 
+	BlurRootConstants.nearPlane = NearPlane;
+	BlurRootConstants.farPlane = FarPlane;
+	BlurRootConstants.sharpness = 4.0f;
+
+	SortRootConstants.pass = 0;
+	SortRootConstants.partitionCount = SortPartitionCount;
+
+	SpatialHashRootConstants.hash.CellSize = 0.5f;
+	SpatialHashRootConstants.hash.TableSize = SpatialHashTableSize;
+	SpatialHashRootConstants.hash.ParticleCount = MaxParticleCount;
+	SpatialHashRootConstants.hash.Padding = 0;
+	SpatialHashRootConstants.phase = SPATIAL_HASH_PHASE_CLEAR;
+
+	SPHRootConstants.fluid.SmoothingRadius = SpatialHashRootConstants.hash.CellSize;
+	SPHRootConstants.fluid.ParticleMass = 0.02f;
+	SPHRootConstants.fluid.RestDensity = 1.0f;
+	SPHRootConstants.fluid.Stiffness = 2.0f;
+	SPHRootConstants.fluid.Viscosity = 0.1f;
+	SPHRootConstants.fluid.MaxAcceleration = 50.0f;
+	SPHRootConstants.fluid.Enabled = 0;
+	SPHRootConstants.fluid.Padding = 0;
+	SPHRootConstants.hash = SpatialHashRootConstants.hash;
+	SPHRootConstants.phase = SPH_PHASE_DENSITY;
+
+	for (const PlaneData& plane : Planes)
+	{
+		CollisionPlanes.push_back(MakeCollisionPlane(float3(plane.position.x, plane.position.y, plane.position.z),
+			float3(plane.axisOfRotation.x, plane.axisOfRotation.y, plane.axisOfRotation.z), float2(plane.scale.x, plane.scale.y), plane.rotation));
+	}
+	FrameCollisionConstants = {};
+	CollisionGrid = BuildCollisionGrid(CollisionPlanes, CollisionMargin, FrameCollisionConstants);
+	FrameCollisionConstants.Restitution = 0.6f;
+	FrameCollisionConstants.Friction = 0.1f;
+	FrameCollisionConstants.RadiusScale = CULL_BILLBOARD_RADIUS;
+	FrameCollisionConstants.DepthThickness = 0.5f;
+	CPUParticleSystem.SetCollisionScene(CollisionPlanes, CollisionGrid);
+
+	// Position, type, axis, strength, extents, radius
+	ForceFields.push_back({ float3(0.0f, 5.0f, 0.0f), FORCE_FIELD_ATTRACTOR, float3(0, 0, 0), 3.0f, float3(0, 0, 0), 6.0f }); // Room center
+	ForceFields.push_back({ float3(0.0f, 5.0f, 5.0f), FORCE_FIELD_VORTEX, float3(0, 1, 0), 4.0f, float3(0, 0, 0), 3.0f }); // Column in front of the back wall
+	ForceFields.push_back({ float3(4.0f, 5.5f, 0.0f), FORCE_FIELD_WIND, float3(-1, 0, 0), 6.0f, float3(1.0f, 1.5f, 10.0f), 0.0f }); // Blowing in through the right window
+	ForceFields.push_back({ float3(0.0f, 1.0f, 0.0f), FORCE_FIELD_DRAG, float3(0, 0, 0), 1.5f, float3(0, 0, 0), 3.0f }); // Above the floor
+
+	FrameCurlNoiseConstants = {};
+	FrameCurlNoiseConstants.Frequency = 0.08f; // About one repeat across the room
+	FrameCurlNoiseConstants.Strength = 3.0f;
+
+	FrameVectorFieldConstants = {};
+
+	FrameTrailConstants = {};
+	FrameTrailConstants.WidthScale = 0.5f;
+	FrameTrailConstants.MaxParticleCount = MaxParticleCount;
+
+	// Fireworks when a particle dies, a small splash off the reflected velocity when it bounces
+	SubEmitterRootConstants = {};
+	SubEmitterRootConstants.DeathBurst = 24;
+	SubEmitterRootConstants.CollisionBurst = 4;
+	SubEmitterRootConstants.Speed = 2.5f;
+	SubEmitterRootConstants.InheritVelocity = 0.5f;
+
 	CameraPosition = XMFLOAT4(0, 0, -15, 1);
 }
 
-void ParticleGame::UpdateBufferResource(ComPtr<ID3D12GraphicsCommandList2> commandList, ID3D12Resource** pDestinationResource, ID3D12Resource** pIntermediateResource,
-	size_t numElements, size_t elementSize, const void* bufferData, D3D12_RESOURCE_FLAGS flags)
+void ParticleGame::UpdateTextureStreaming(UINT frame)
 {
 	auto device = Application::Get().GetDevice();
+	auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	auto copyCommandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
+	StreamedTexture* textures[] = { &TilesTexture, &WallTexture };
+	auto findTexture = [&textures](uint32_t request) -> StreamedTexture*
+	{
+		auto texture = std::find_if(std::begin(textures), std::end(textures), [request](const StreamedTexture* texture) { return texture->Request == request; });
+		assert(texture != std::end(textures) && "Streamed texture request without a StreamedTexture.");
+		return texture != std::end(textures) ? *texture : nullptr;
+	};
 
-	size_t bufferSize = numElements * elementSize;
+	// The copy queue's fence hands finished resources over, the replaced ones wait for the frames already recorded with them
+	while (!TextureUploads.empty() && copyCommandQueue->IsFenceCompleted(TextureUploads.front().FenceValue))
+	{
+		TextureUploadBatch& batch = TextureUploads.front();
+		for (const TextureStreamUpload& upload : batch.Uploads)
+		{
+			Streamer.Complete(upload);
+		}
+		for (const TextureStreamEviction& eviction : batch.Evictions)
+		{
+			Streamer.Complete(eviction);
+		}
+		for (TextureRebuild& rebuild : batch.Rebuilds)
+		{
+			if (rebuild.Texture->Resource)
+			{
+				RetiredTextures.push_back({ commandQueue->Signal(), std::move(rebuild.Texture->Resource) });
+			}
+			rebuild.Texture->Resource = std::move(rebuild.Resource);
+			rebuild.Texture->BaseMip = rebuild.BaseMip;
+		}
+		TextureUploads.pop_front();
+	}
+	while (!RetiredTextures.empty() && commandQueue->IsFenceCompleted(RetiredTextures.front().FenceValue))
+	{
+		RetiredTextures.pop_front();
+	}
 
-	CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize, flags);
+	// The finest mip this frame's draws sample, estimated from the closest point of what they cover
+	const XMVECTOR cameraPosition = XMLoadFloat4(&CameraPosition);
+	if (TilesTexture.Resource)
+	{
+		const DDSTexture& dds = Streamer.GetTexture(TilesTexture.Request);
+		const XMVECTOR closest = XMVectorClamp(cameraPosition, XMVectorSet(CSRootConstants.emitAABBMin.x, CSRootConstants.emitAABBMin.y, CSRootConstants.emitAABBMin.z, 1),
+			XMVectorSet(CSRootConstants.emitAABBMax.x, CSRootConstants.emitAABBMax.y, CSRootConstants.emitAABBMax.z, 1));
+		const float scale = std::max(CSRootConstants.particleStartScale, CSRootConstants.particleEndScale);
+		const float frameWidth = dds.Width * (AtlasConstants.Rect.z - AtlasConstants.Rect.x) / AtlasConstants.Columns;
+		Streamer.Use(TilesTexture.Request, GetFinestMip(frameWidth / (2.0f * scale), XMVectorGetX(XMVector3Length(closest - cameraPosition))));
+	}
+	if (WallTexture.Resource && RenderRoom)
+	{
+		const DDSTexture& dds = Streamer.GetTexture(WallTexture.Request);
+		UINT finestMip = UINT_MAX;
+		for (const PlaneData& plane : Planes)
+		{
+			const float texelsPerUnit = std::max(dds.Width * std::abs(plane.UVMinMax.y - plane.UVMinMax.x) / (2.0f * plane.scale.x),
+				dds.Height * std::abs(plane.UVMinMax.w - plane.UVMinMax.z) / (2.0f * plane.scale.y));
+			const float distance = XMVectorGetX(XMVector3Length(XMLoadFloat4(&plane.position) - cameraPosition)) - std::hypot(plane.scale.x, plane.scale.y);
+			finestMip = std::min(finestMip, GetFinestMip(texelsPerUnit, distance));
+		}
+		Streamer.Use(WallTexture.Request, finestMip);
+	}
+
+	std::vector<uint32_t> parsed;
+	std::vector<TextureStreamUpload> uploads;
+	std::vector<TextureStreamEviction> evictions;
+	Streamer.Update(TextureStreamBudget, TextureBudgets[TextureBudget], parsed, uploads, evictions);
+
+	// A texture's resource holds mips [BaseMip, MipCount), sharpening or evicting moves BaseMip and builds a new one. Nothing is
+	// uploaded for a texture that was just parsed, its first upload builds it.
+	std::vector<TextureRebuild> rebuilds;
+	for (const TextureStreamUpload& upload : uploads)
+	{
+		auto rebuild = std::find_if(rebuilds.begin(), rebuilds.end(), [&upload](const TextureRebuild& r) { return r.Texture->Request == upload.Texture; });
+		if (rebuild != rebuilds.end())
+		{
+			rebuild->BaseMip = std::min<UINT>(rebuild->BaseMip, upload.Mip);
+		}
+		else if (StreamedTexture* texture = findTexture(upload.Texture))
+		{
+			rebuilds.push_back({ texture, nullptr, upload.Mip });
+		}
+	}
+	for (const TextureStreamEviction& eviction : evictions)
+	{
+		if (StreamedTexture* texture = findTexture(eviction.Texture))
+		{
+			rebuilds.push_back({ texture, nullptr, eviction.Mip });
+		}
+	}
+
+	// Created in COMMON, the copy queue promotes them to COPY_DEST and the direct queue to shader resource
+	for (TextureRebuild& rebuild : rebuilds)
+	{
+		const DDSTexture& dds = Streamer.GetTexture(rebuild.Texture->Request);
+		const UINT16 depthOrArraySize = static_cast<UINT16>(dds.Dimension == DDS_DIMENSION_TEXTURE3D ? std::max(dds.Depth >> rebuild.BaseMip, 1u) : dds.ArraySize);
+		CD3DX12_RESOURCE_DESC textureDesc(static_cast<D3D12_RESOURCE_DIMENSION>(dds.Dimension), 0, std::max(dds.Width >> rebuild.BaseMip, 1u),
+			std::max(dds.Height >> rebuild.BaseMip, 1u), depthOrArraySize, static_cast<UINT16>(dds.MipCount - rebuild.BaseMip), static_cast<DXGI_FORMAT>(dds.Format),
+			1, 0, D3D12_TEXTURE_LAYOUT_UNKNOWN, D3D12_RESOURCE_FLAG_NONE);
+		CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&defaultHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&textureDesc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&rebuild.Resource)));
+	}
+
+	// One upload buffer for the batch, UpdateSubresources copies every mip of the new resources straight out of the mapped file into it
+	if (!rebuilds.empty())
+	{
+		std::vector<UINT64> offsets;
+		UINT64 uploadBufferSize = 0;
+		for (const TextureRebuild& rebuild : rebuilds)
+		{
+			const DDSTexture& dds = Streamer.GetTexture(rebuild.Texture->Request);
+			const UINT mipCount = dds.MipCount - rebuild.BaseMip;
+			for (UINT subresource = 0; subresource < mipCount * dds.ArraySize; subresource++)
+			{
+				uploadBufferSize = (uploadBufferSize + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~static_cast<UINT64>(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+				offsets.push_back(uploadBufferSize);
+				uploadBufferSize += GetRequiredIntermediateSize(rebuild.Resource.Get(), subresource, 1);
+			}
+		}
+
+		TextureUploadBatch batch;
+		CD3DX12_HEAP_PROPERTIES uploadHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
+		CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&uploadHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&batch.UploadBuffer)));
+
+		auto copyCommandList = copyCommandQueue->GetCommandList();
+		size_t offsetIndex = 0;
+		for (const TextureRebuild& rebuild : rebuilds)
+		{
+			const DDSTexture& dds = Streamer.GetTexture(rebuild.Texture->Request);
+			const UINT mipCount = dds.MipCount - rebuild.BaseMip;
+			for (UINT item = 0; item < dds.ArraySize; item++)
+			{
+				for (UINT mip = 0; mip < mipCount; mip++)
+				{
+					const DDSSubresource& source = dds.Subresources[D3D12CalcSubresource(rebuild.BaseMip + mip, item, 0, dds.MipCount, dds.ArraySize)];
+					D3D12_SUBRESOURCE_DATA subresourceData = { source.Data, source.RowPitch, source.SlicePitch };
+					UpdateSubresources(copyCommandList.Get(), rebuild.Resource.Get(), batch.UploadBuffer.Get(), offsets[offsetIndex++],
+						D3D12CalcSubresource(mip, item, 0, mipCount, dds.ArraySize), 1, &subresourceData);
+				}
+			}
+		}
+		batch.FenceValue = copyCommandQueue->ExecuteCommandList(copyCommandList);
+		batch.Uploads = std::move(uploads);
+		batch.Evictions = std::move(evictions);
+		batch.Rebuilds = std::move(rebuilds);
+		TextureUploads.push_back(std::move(batch));
+	}
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE descriptorHandle(DescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	for (StreamedTexture* texture : textures)
+	{
+		if (texture->Resource)
+		{
+			const D3D12_RESOURCE_DESC resourceDesc = texture->Resource->GetDesc();
+			srvDesc.Format = resourceDesc.Format;
+			srvDesc.ViewDimension = texture->ViewDimension;
+			if (texture->ViewDimension == D3D12_SRV_DIMENSION_TEXTURE2DARRAY)
+			{
+				srvDesc.Texture2DArray = {};
+				srvDesc.Texture2DArray.MipLevels = static_cast<UINT>(-1);
+				srvDesc.Texture2DArray.ArraySize = resourceDesc.DepthOrArraySize;
+			}
+			else
+			{
+				srvDesc.Texture2D = {};
+				srvDesc.Texture2D.MipLevels = static_cast<UINT>(-1);
+			}
+			device->CreateShaderResourceView(texture->Resource.Get(), &srvDesc, CD3DX12_CPU_DESCRIPTOR_HANDLE(descriptorHandle, texture->FrameDescriptors + frame, DescriptorSize));
+		}
+	}
+}
+
+UINT ParticleGame::GetFinestMip(float texelsPerUnit, float distance) const
+{
+	const float pixelsPerUnit = 0.5f * GetWindowHeight() / (std::tan(XMConvertToRadians(FoV) * 0.5f) * std::max(distance, NearPlane));
+	return static_cast<UINT>(std::max(std::floor(std::log2(texelsPerUnit / pixelsPerUnit)), 0.0f));
+}
+
+// What the tasks of LoadContent's graph share. The Create*Tasks functions add tasks that reference it, so it lives until the
+// graph has run.
+struct ParticleGame::ContentLoader
+{
+	// A shader file read on its own task, Blob holds the bytecode once Task ran
+	struct ShaderRead
+	{
+		TaskGraph::Task Task;
+		const ComPtr<ID3DBlob>* Blob;
+	};
+
+	ContentLoader(ComPtr<ID3D12Device2> device, const std::wstring& assetPath, ID3D12DescriptorHeap* descriptorHeap, UINT descriptorSize);
+
+	void CreateRootSignature(const CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC& description, ComPtr<ID3D12RootSignature>& rootSignature);
+	uint64_t GetRootSignatureKey(ID3D12RootSignature* rootSignature);
+
+	ShaderRead ReadShader(const wchar_t* fileName);
+
+	// Loads the pipeline named after key from the library, or creates it when the library doesn't have it
+	void CreatePipeline(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, uint64_t key, ComPtr<ID3D12PipelineState>& pipelineState);
+
+	// Each call builds its own stream from the additive billboard one, root signatures and shaders are only there once the task runs
+	void CreateRenderPipeline(ID3D12RootSignature* rootSignature, ID3DBlob* vertexShader, ID3DBlob* pixelShader, const CD3DX12_RASTERIZER_DESC& rasterizer,
+		const CD3DX12_BLEND_DESC& blendMode, bool vertexBuffer, ComPtr<ID3D12PipelineState>& pipelineState);
+	void CreateComputePipeline(ID3D12RootSignature* rootSignature, ID3DBlob* computeShader, ComPtr<ID3D12PipelineState>& pipelineState);
+
+	// Entry of the shader visible heap, LoadContent's tasks each fill their fixed entries
+	CD3DX12_CPU_DESCRIPTOR_HANDLE GetDescriptor(UINT entry) const;
+
+	// Create a GPU buffer, it holds data and is in afterState once CommandList ran
+	void CreateBuffer(ComPtr<ID3D12Resource>& buffer, size_t numElements, size_t elementSize, const void* data,
+		D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATES afterState = D3D12_RESOURCE_STATE_COPY_DEST);
+
+	// Copies data into the subresources of a texture created in COPY_DEST, it ends up in afterState once CommandList ran
+	void UploadTexture(ID3D12Resource* texture, UINT subresourceCount, const D3D12_SUBRESOURCE_DATA* data,
+		D3D12_RESOURCE_STATES afterState = D3D12_RESOURCE_STATE_COPY_DEST);
+
+	TaskGraph Graph;
+	ComPtr<ID3D12Device2> Device;
+	std::wstring AssetPath;
+
+	D3D_ROOT_SIGNATURE_VERSION RootSignatureVersion;
+	D3D12_STATIC_SAMPLER_DESC Sampler;
+
+	// Serialized root signatures' ContentHash, part of the keys of the PSOs built on them
+	std::unordered_map<ID3D12RootSignature*, uint64_t> RootSignatureKeys;
+	std::mutex RootSignatureKeyMutex;
+
+	// The PSO tasks wait for the task of their root signature
+	TaskGraph::Task RenderRSTask;
+	TaskGraph::Task AABBRSTask;
+	TaskGraph::Task EmitRSTask;
+	TaskGraph::Task SubEmitterRSTask;
+	TaskGraph::Task SimulateRSTask;
+	TaskGraph::Task PostProcessRSTask;
+	TaskGraph::Task SSAOBlurRSTask;
+	TaskGraph::Task HiZRSTask;
+	TaskGraph::Task TileRasterRSTask;
+	TaskGraph::Task SpatialHashRSTask;
+	TaskGraph::Task SPHRSTask;
+	TaskGraph::Task TrailRSTask;
+	TaskGraph::Task SortRSTask;
+
+	std::deque<ComPtr<ID3DBlob>> Shaders; // Adding to the back keeps the other elements in place for ShaderRead
+
+	// ParticleAtlas.dds, or Particle.dds alone when the atlas can't be built
+	std::wstring ParticleTexturePath;
+	TaskGraph::Task AtlasTask;
+
+	// PSOs come out of PipelineCache.bin's library, named after a ContentHash of everything they're built from. The library
+	// only loads on the driver that wrote it, and D3D also checks each desc against the stored one, so anything that doesn't
+	// match is created as before. The library reads from PipelineCacheData for as long as it's alive.
+	std::filesystem::path PipelineCachePath;
+	std::vector<uint8_t> PipelineCacheData;
+	ComPtr<ID3D12PipelineLibrary1> PipelineLibrary;
+
+	// The library synchronizes itself except for two threads loading the same pipeline, a name that comes up again is created instead
+	std::vector<std::pair<std::wstring, ID3D12PipelineState*>> Pipelines;
+	std::unordered_set<std::wstring> PipelineNames;
+	UINT CreatedPipelineCount;
+	std::mutex PipelineMutex;
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorHeapStart;
+	UINT DescriptorSize;
+
+	// The buffer and volume tasks' copies and barriers, LoadContent executes the list once the graph has run. Resources are created
+	// and upload buffers filled on the tasks' own threads, only recording takes CommandListMutex.
+	ComPtr<ID3D12GraphicsCommandList2> CommandList;
+	std::vector<ComPtr<ID3D12Resource>> UploadBuffers; // Read by the copies, kept until the list ran
+	std::mutex CommandListMutex;
+
+	bool EmittersLoaded;
+};
+
+ParticleGame::ContentLoader::ContentLoader(ComPtr<ID3D12Device2> device, const std::wstring& assetPath, ID3D12DescriptorHeap* descriptorHeap, UINT descriptorSize)
+	: Device(device)
+	, AssetPath(assetPath)
+	, Sampler{}
+	, ParticleTexturePath(assetPath + L"ParticleAtlas.dds")
+	, PipelineCachePath(assetPath + L"PipelineCache.bin")
+	, CreatedPipelineCount(0)
+	, DescriptorHeapStart(descriptorHeap->GetCPUDescriptorHandleForHeapStart())
+	, DescriptorSize(descriptorSize)
+	, EmittersLoaded(false)
+{
+	D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
+	featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+	if (FAILED(Device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
+	{
+		featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+	}
+	RootSignatureVersion = featureData.HighestVersion;
+
+	Sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
+	Sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	Sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	Sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	Sampler.MipLODBias = 0;
+	Sampler.MaxAnisotropy = 0;
+	Sampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+	Sampler.BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
+	Sampler.MinLOD = 0.0f;
+	Sampler.MaxLOD = D3D12_FLOAT32_MAX;
+	Sampler.ShaderRegister = 0;
+	Sampler.RegisterSpace = 0;
+	Sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	if (LoadPipelineCache(PipelineCachePath, PipelineCacheData) &&
+		FAILED(Device->CreatePipelineLibrary(PipelineCacheData.data(), PipelineCacheData.size(), IID_PPV_ARGS(&PipelineLibrary))))
+	{
+		PipelineLibrary.Reset();
+	}
+}
+
+void ParticleGame::ContentLoader::CreateRootSignature(const CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC& description, ComPtr<ID3D12RootSignature>& rootSignature)
+{
+	ComPtr<ID3DBlob> RSBlob;
+	ComPtr<ID3DBlob> errorBlob;
+	ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&description, RootSignatureVersion, &RSBlob, &errorBlob));
+	ThrowIfFailed(Device->CreateRootSignature(0, RSBlob->GetBufferPointer(), RSBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature)));
+
+	const uint64_t key = HashContent(RSBlob->GetBufferPointer(), RSBlob->GetBufferSize());
+	std::lock_guard<std::mutex> lock(RootSignatureKeyMutex);
+	RootSignatureKeys[rootSignature.Get()] = key;
+}
+
+uint64_t ParticleGame::ContentLoader::GetRootSignatureKey(ID3D12RootSignature* rootSignature)
+{
+	std::lock_guard<std::mutex> lock(RootSignatureKeyMutex);
+	return RootSignatureKeys.at(rootSignature);
+}
+
+ParticleGame::ContentLoader::ShaderRead ParticleGame::ContentLoader::ReadShader(const wchar_t* fileName)
+{
+	ComPtr<ID3DBlob>& shader = Shaders.emplace_back();
+	const std::wstring path = AssetPath + fileName;
+	const TaskGraph::Task task = Graph.Add(std::filesystem::path(fileName).string(), [path, &shader]()
+	{
+		ThrowIfFailed(D3DReadFileToBlob(path.c_str(), &shader));
+	});
+	return { task, &shader };
+}
+
+void ParticleGame::ContentLoader::CreatePipeline(const D3D12_PIPELINE_STATE_STREAM_DESC& desc, uint64_t key, ComPtr<ID3D12PipelineState>& pipelineState)
+{
+	std::wstring name = GetPipelineName(key);
+	bool firstName;
+	{
+		std::lock_guard<std::mutex> lock(PipelineMutex);
+		firstName = PipelineNames.insert(name).second;
+	}
+
+	bool created = false;
+	if (!firstName || !PipelineLibrary || FAILED(PipelineLibrary->LoadPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pipelineState))))
+	{
+		ThrowIfFailed(Device->CreatePipelineState(&desc, IID_PPV_ARGS(&pipelineState)));
+		created = true;
+	}
+
+	std::lock_guard<std::mutex> lock(PipelineMutex);
+	CreatedPipelineCount += created ? 1 : 0;
+	Pipelines.push_back({ std::move(name), pipelineState.Get() });
+}
+
+void ParticleGame::ContentLoader::CreateRenderPipeline(ID3D12RootSignature* rootSignature, ID3DBlob* vertexShader, ID3DBlob* pixelShader,
+	const CD3DX12_RASTERIZER_DESC& rasterizer, const CD3DX12_BLEND_DESC& blendMode, bool vertexBuffer, ComPtr<ID3D12PipelineState>& pipelineState)
+{
+	D3D12_RT_FORMAT_ARRAY rtvFormats = {};
+	rtvFormats.NumRenderTargets = 1;
+	rtvFormats.RTFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	RenderPipelineStateStream renderPSS;
+	renderPSS.pRootSignature = rootSignature;
+	renderPSS.InputLayout = vertexBuffer ? D3D12_INPUT_LAYOUT_DESC{ InputLayout, _countof(InputLayout) } : D3D12_INPUT_LAYOUT_DESC{ nullptr, 0 };
+	renderPSS.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	renderPSS.VS = CD3DX12_SHADER_BYTECODE(vertexShader);
+	renderPSS.PS = CD3DX12_SHADER_BYTECODE(pixelShader);
+	renderPSS.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+	renderPSS.RTVFormats = rtvFormats;
+	renderPSS.Rasterizer = rasterizer;
+	renderPSS.BlendMode = blendMode;
+
+	D3D12_PIPELINE_STATE_STREAM_DESC psoDesc =
+	{
+		sizeof(RenderPipelineStateStream), &renderPSS
+	};
+	CreatePipeline(psoDesc, GetRenderPipelineKey(renderPSS, GetRootSignatureKey(rootSignature)), pipelineState);
+}
+
+void ParticleGame::ContentLoader::CreateComputePipeline(ID3D12RootSignature* rootSignature, ID3DBlob* computeShader, ComPtr<ID3D12PipelineState>& pipelineState)
+{
+	ComputePipelineStateStream computePSS;
+	computePSS.pRootSignature = rootSignature;
+	computePSS.CS = CD3DX12_SHADER_BYTECODE(computeShader);
+
+	ContentHash hash;
+	hash.AddValue(GetRootSignatureKey(rootSignature));
+	HashShader(hash, computePSS.CS);
+
+	D3D12_PIPELINE_STATE_STREAM_DESC psoDesc =
+	{
+		sizeof(ComputePipelineStateStream), &computePSS
+	};
+	CreatePipeline(psoDesc, hash.Get(), pipelineState);
+}
+
+CD3DX12_CPU_DESCRIPTOR_HANDLE ParticleGame::ContentLoader::GetDescriptor(UINT entry) const
+{
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(DescriptorHeapStart, entry, DescriptorSize);
+}
 
-	// Create a committed resource in GPU mem
+void ParticleGame::ContentLoader::CreateBuffer(ComPtr<ID3D12Resource>& buffer, size_t numElements, size_t elementSize, const void* data,
+	D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES afterState)
+{
+	const size_t bufferSize = numElements * elementSize;
+	CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize, flags);
 	CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
-	ThrowIfFailed(device->CreateCommittedResource(
+	ThrowIfFailed(Device->CreateCommittedResource(
 		&defaultHeapProperties,
 		D3D12_HEAP_FLAG_NONE,
 		&bufferDesc,
 		D3D12_RESOURCE_STATE_COPY_DEST,
 		nullptr,
-		IID_PPV_ARGS(pDestinationResource)));
+		IID_PPV_ARGS(&buffer)));
+
+	if (!data && afterState == D3D12_RESOURCE_STATE_COPY_DEST)
+	{
+		return;
+	}
 
-	// Create a committed resource for the upload
-	if (bufferData)
+	ComPtr<ID3D12Resource> uploadBuffer;
+	if (data)
 	{
 		bufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
 		CD3DX12_HEAP_PROPERTIES uploadHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
-		ThrowIfFailed(device->CreateCommittedResource(
+		ThrowIfFailed(Device->CreateCommittedResource(
 			&uploadHeapProperties,
 			D3D12_HEAP_FLAG_NONE,
 			&bufferDesc,
 			D3D12_RESOURCE_STATE_GENERIC_READ,
 			nullptr,
-			IID_PPV_ARGS(pIntermediateResource)));
+			IID_PPV_ARGS(&uploadBuffer)));
 
-		D3D12_SUBRESOURCE_DATA subresourceData = {};
-		subresourceData.pData = bufferData;
-		subresourceData.RowPitch = bufferSize;
-		subresourceData.SlicePitch = subresourceData.RowPitch;
+		UINT8* mappedData = nullptr;
+		CD3DX12_RANGE readRange(0, 0);
+		ThrowIfFailed(uploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&mappedData)));
+		memcpy(mappedData, data, bufferSize);
+		uploadBuffer->Unmap(0, nullptr);
+	}
 
-		UpdateSubresources(commandList.Get(), *pDestinationResource, *pIntermediateResource, 0, 0, 1, &subresourceData);
+	std::lock_guard<std::mutex> lock(CommandListMutex);
+	if (uploadBuffer)
+	{
+		CommandList->CopyBufferRegion(buffer.Get(), 0, uploadBuffer.Get(), 0, bufferSize);
+		UploadBuffers.push_back(std::move(uploadBuffer));
+	}
+	if (afterState != D3D12_RESOURCE_STATE_COPY_DEST)
+	{
+		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(buffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, afterState);
+		CommandList->ResourceBarrier(1, &barrier);
 	}
 }
 
-void ParticleGame::UpdateTextureResourceFromFile(ComPtr<ID3D12GraphicsCommandList2> commandList, ID3D12Resource** pDestinationResource, ID3D12Resource** pIntermediateResource, std::wstring fileName)
+void ParticleGame::ContentLoader::UploadTexture(ID3D12Resource* texture, UINT subresourceCount, const D3D12_SUBRESOURCE_DATA* data, D3D12_RESOURCE_STATES afterState)
 {
-	auto device = Application::Get().GetDevice();
-	std::unique_ptr<uint8_t[]> tilesDDSData;
-	std::vector<D3D12_SUBRESOURCE_DATA> tilesSubresources;
-
-	LoadDDSTextureFromFile(device.Get(), fileName.c_str(), pDestinationResource, tilesDDSData, tilesSubresources);
-
-	const UINT64 uploadBufferSize = GetRequiredIntermediateSize(*pDestinationResource, 0, 1);
-
+	ComPtr<ID3D12Resource> uploadBuffer;
 	CD3DX12_HEAP_PROPERTIES uploadHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
-	CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
-	ThrowIfFailed(device->CreateCommittedResource(
+	CD3DX12_RESOURCE_DESC uploadDesc = CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(texture, 0, subresourceCount));
+	ThrowIfFailed(Device->CreateCommittedResource(
 		&uploadHeapProperties,
 		D3D12_HEAP_FLAG_NONE,
-		&bufferDesc,
+		&uploadDesc,
 		D3D12_RESOURCE_STATE_GENERIC_READ,
 		nullptr,
-		IID_PPV_ARGS(pIntermediateResource)));
+		IID_PPV_ARGS(&uploadBuffer)));
 
-	UpdateSubresources(commandList.Get(), *pDestinationResource, *pIntermediateResource, 0, 0, 1, &tilesSubresources[0]);
+	// UpdateSubresources fills the upload buffer and records the copy in one go, so a texture's rows are copied under the lock
+	std::lock_guard<std::mutex> lock(CommandListMutex);
+	UpdateSubresources(CommandList.Get(), texture, uploadBuffer.Get(), 0, 0, subresourceCount, data);
+	if (afterState != D3D12_RESOURCE_STATE_COPY_DEST)
+	{
+		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture, D3D12_RESOURCE_STATE_COPY_DEST, afterState);
+		CommandList->ResourceBarrier(1, &barrier);
+	}
+	UploadBuffers.push_back(std::move(uploadBuffer));
 }
 
-bool ParticleGame::LoadContent()
+void ParticleGame::CreateRootSignatureTasks(ContentLoader& loader)
 {
-	auto device = Application::Get().GetDevice();
+	// Create particle rendering root signature
+	loader.RenderRSTask = loader.Graph.Add("RenderRS", [this, &loader]()
+	{
+		CD3DX12_DESCRIPTOR_RANGE1 renderRanges[1];
+		renderRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
 
-	// Create descriptor heaps
+		// Streaming textures get mips written by the copy queue while frames sample the coarser ones
+		CD3DX12_DESCRIPTOR_RANGE1 textureRanges[1];
+		textureRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+
+		CD3DX12_DESCRIPTOR_RANGE1 visibleRanges[1];
+		visibleRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+
+		CD3DX12_ROOT_PARAMETER1 rootParameters[5];
+		rootParameters[0].InitAsConstants(sizeof(VSRootConstants) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+		rootParameters[1].InitAsDescriptorTable(_countof(renderRanges), renderRanges, D3D12_SHADER_VISIBILITY_VERTEX);
+		rootParameters[2].InitAsDescriptorTable(_countof(textureRanges), textureRanges, D3D12_SHADER_VISIBILITY_PIXEL);
+		rootParameters[3].InitAsDescriptorTable(_countof(visibleRanges), visibleRanges, D3D12_SHADER_VISIBILITY_VERTEX);
+		rootParameters[4].InitAsConstants(sizeof(ParticleAtlasConstants) / 4, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC RSDescription;
+		RSDescription.Init_1_1(_countof(rootParameters), rootParameters, 1, &loader.Sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+		loader.CreateRootSignature(RSDescription, RenderRS);
+	});
+
+	// Create AABB visualizing root signature
+	loader.AABBRSTask = loader.Graph.Add("AABBRS", [this, &loader]()
 	{
-		DSVHeap = Application::Get().CreateDescriptorHeap(2, D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
-		DescriptorHeap = Application::Get().CreateDescriptorHeap(12 + Window::BufferCount, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE);
-		RTVHeap = Application::Get().CreateDescriptorHeap(1, D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-	}
+		CD3DX12_ROOT_PARAMETER1 rootParameters[2];
+		rootParameters[0].InitAsConstants(sizeof(VSRootConstants) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+		rootParameters[1].InitAsConstants(sizeof(CSRootConstants) / 4, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 
-	// Create root signatures
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC RSDescription;
+		RSDescription.Init_1_1(_countof(rootParameters), rootParameters, 1, &loader.Sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+		loader.CreateRootSignature(RSDescription, AABBRS);
+	});
+
+	// Create emitter compute signature
+	loader.EmitRSTask = loader.Graph.Add("EmitRS", [this, &loader]()
 	{
-		D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
-		featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
-		if (FAILED(device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
-		{
-			featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
-		}
+		CD3DX12_DESCRIPTOR_RANGE1 emitRanges[2];
+		emitRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 4, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+		emitRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-		D3D12_STATIC_SAMPLER_DESC sampler = {};
-		sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
-		sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-		sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-		sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-		sampler.MipLODBias = 0;
-		sampler.MaxAnisotropy = 0;
-		sampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
-		sampler.BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
-		sampler.MinLOD = 0.0f;
-		sampler.MaxLOD = D3D12_FLOAT32_MAX;
-		sampler.ShaderRegister = 0;
-		sampler.RegisterSpace = 0;
-		sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-
-		ComPtr<ID3DBlob> RSBlob;
-		ComPtr<ID3DBlob> errorBlob;
-
-		// Create particle rendering root signature
-		{
-			CD3DX12_DESCRIPTOR_RANGE1 renderRanges[1];
-			renderRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
-
-			CD3DX12_ROOT_PARAMETER1 rootParameters[3];
-			rootParameters[0].InitAsConstants(sizeof(VSRootConstants) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
-			rootParameters[1].InitAsDescriptorTable(_countof(renderRanges), renderRanges, D3D12_SHADER_VISIBILITY_VERTEX);
-			rootParameters[2].InitAsDescriptorTable(_countof(renderRanges), renderRanges, D3D12_SHADER_VISIBILITY_PIXEL);
-
-			CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC RSDescription;
-			RSDescription.Init_1_1(_countof(rootParameters), rootParameters, 1, &sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&RSDescription, featureData.HighestVersion, &RSBlob, &errorBlob));
-			ThrowIfFailed(device->CreateRootSignature(0, RSBlob->GetBufferPointer(), RSBlob->GetBufferSize(), IID_PPV_ARGS(&RenderRS)));
-		}
+		CD3DX12_ROOT_PARAMETER1 emitRootParameters[2];
+		emitRootParameters[0].InitAsDescriptorTable(_countof(emitRanges), emitRanges);
+		emitRootParameters[1].InitAsConstants(sizeof(CSRootConstants) / 4, 0);
 
-		// Create AABB visualizing root signature
-		{
-			CD3DX12_ROOT_PARAMETER1 rootParameters[2];
-			rootParameters[0].InitAsConstants(sizeof(VSRootConstants) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
-			rootParameters[1].InitAsConstants(sizeof(CSRootConstants) / 4, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC emitRSDescription;
+		emitRSDescription.Init_1_1(_countof(emitRootParameters), emitRootParameters);
 
-			CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC RSDescription;
-			RSDescription.Init_1_1(_countof(rootParameters), rootParameters, 1, &sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+		loader.CreateRootSignature(emitRSDescription, EmitRS);
+	});
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&RSDescription, featureData.HighestVersion, &RSBlob, &errorBlob));
-			ThrowIfFailed(device->CreateRootSignature(0, RSBlob->GetBufferPointer(), RSBlob->GetBufferSize(), IID_PPV_ARGS(&AABBRS)));
-		}
+	// Create sub-emitter compute signature, shared by the args and spawn passes
+	loader.SubEmitterRSTask = loader.Graph.Add("SubEmitterRS", [this, &loader]()
+	{
+		CD3DX12_DESCRIPTOR_RANGE1 particleRanges[2];
+		particleRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 4, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+		particleRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-		// Create emitter compute signature
-		{
-			CD3DX12_DESCRIPTOR_RANGE1 emitRanges[2];
-			emitRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 4, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-			emitRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+		CD3DX12_DESCRIPTOR_RANGE1 eventRanges[1];
+		eventRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 3, 4, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-			CD3DX12_ROOT_PARAMETER1 emitRootParameters[2];
-			emitRootParameters[0].InitAsDescriptorTable(_countof(emitRanges), emitRanges);
-			emitRootParameters[1].InitAsConstants(sizeof(CSRootConstants) / 4, 0);
+		CD3DX12_ROOT_PARAMETER1 subEmitterRootParameters[4];
+		subEmitterRootParameters[0].InitAsDescriptorTable(_countof(particleRanges), particleRanges);
+		subEmitterRootParameters[1].InitAsConstants(sizeof(CSRootConstants) / 4, 0);
+		subEmitterRootParameters[2].InitAsConstants(sizeof(SubEmitterConstants) / 4, 1);
+		subEmitterRootParameters[3].InitAsDescriptorTable(_countof(eventRanges), eventRanges);
 
-			CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC emitRSDescription;
-			emitRSDescription.Init_1_1(_countof(emitRootParameters), emitRootParameters);
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC subEmitterRSDescription;
+		subEmitterRSDescription.Init_1_1(_countof(subEmitterRootParameters), subEmitterRootParameters);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&emitRSDescription, featureData.HighestVersion, &RSBlob, &errorBlob));
-			ThrowIfFailed(device->CreateRootSignature(0, RSBlob->GetBufferPointer(), RSBlob->GetBufferSize(), IID_PPV_ARGS(&EmitRS)));
-		}
+		loader.CreateRootSignature(subEmitterRSDescription, SubEmitterRS);
+	});
 
-		// Create simulation compute signature
-		{
-			CD3DX12_DESCRIPTOR_RANGE1 simulateRanges[2];
-			simulateRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 4, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-			simulateRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+	// Create simulation compute signature
+	loader.SimulateRSTask = loader.Graph.Add("SimulateRS", [this, &loader]()
+	{
+		CD3DX12_DESCRIPTOR_RANGE1 simulateRanges[2];
+		simulateRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 4, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+		simulateRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+
+		CD3DX12_DESCRIPTOR_RANGE1 visibleRanges[1];
+		visibleRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 4, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+
+		CD3DX12_DESCRIPTOR_RANGE1 hiZRanges[1];
+		hiZRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+
+		CD3DX12_DESCRIPTOR_RANGE1 neighborRanges[1];
+		neighborRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 3, 5, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+
+		CD3DX12_DESCRIPTOR_RANGE1 fluidRanges[1];
+		fluidRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 8, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+
+		CD3DX12_DESCRIPTOR_RANGE1 collisionRanges[1];
+		collisionRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 2, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
+
+		// Curl noise, vector fields and curve atlas sit next to each other in the heap and share one table
+		CD3DX12_DESCRIPTOR_RANGE1 volumeRanges[3];
+		volumeRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 5, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
+		volumeRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, VECTOR_FIELD_MAX_COUNT, 6, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+		volumeRanges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 10, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
+
+		// Trail history at entry 59, the sub-emitter events and counters five entries on at 64-65
+		CD3DX12_DESCRIPTOR_RANGE1 trailRanges[2];
+		trailRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 9, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+		trailRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 10, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE, 5);
+
+		CD3DX12_ROOT_PARAMETER1 simulateRootParameters[18];
+		simulateRootParameters[0].InitAsDescriptorTable(_countof(simulateRanges), simulateRanges);
+		simulateRootParameters[1].InitAsConstants(sizeof(CSRootConstants) / 4, 0);
+		simulateRootParameters[2].InitAsDescriptorTable(_countof(visibleRanges), visibleRanges);
+		simulateRootParameters[3].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+		simulateRootParameters[4].InitAsDescriptorTable(_countof(hiZRanges), hiZRanges);
+		simulateRootParameters[5].InitAsDescriptorTable(_countof(neighborRanges), neighborRanges);
+		simulateRootParameters[6].InitAsConstants(sizeof(SpatialHashConstants) / 4, 2);
+		simulateRootParameters[7].InitAsDescriptorTable(_countof(fluidRanges), fluidRanges);
+		simulateRootParameters[8].InitAsConstants(sizeof(SPHConstants) / 4, 3);
+		simulateRootParameters[9].InitAsDescriptorTable(_countof(collisionRanges), collisionRanges);
+		simulateRootParameters[10].InitAsConstantBufferView(4, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+		simulateRootParameters[11].InitAsShaderResourceView(4, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+		simulateRootParameters[12].InitAsConstants(1, 5);
+		simulateRootParameters[13].InitAsDescriptorTable(_countof(volumeRanges), volumeRanges);
+		simulateRootParameters[14].InitAsConstantBufferView(6, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+		simulateRootParameters[15].InitAsConstantBufferView(7, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+		simulateRootParameters[16].InitAsDescriptorTable(_countof(trailRanges), trailRanges);
+		simulateRootParameters[17].InitAsConstants(2, 8);
+
+		// Trilinear and wrapping for the tiling curl noise volume, clamped for the bounded vector fields and the curve atlas
+		D3D12_STATIC_SAMPLER_DESC simulateSamplers[2] = { loader.Sampler, loader.Sampler };
+		simulateSamplers[0].Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+		simulateSamplers[1].Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+		simulateSamplers[1].AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+		simulateSamplers[1].AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+		simulateSamplers[1].AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+		simulateSamplers[1].ShaderRegister = 1;
+
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC simulateRSDescription;
+		simulateRSDescription.Init_1_1(_countof(simulateRootParameters), simulateRootParameters, _countof(simulateSamplers), simulateSamplers);
+
+		loader.CreateRootSignature(simulateRSDescription, SimulateRS);
+	});
+
+	// Create post-process compute signature
+	loader.PostProcessRSTask = loader.Graph.Add("PostProcessRS", [this, &loader]()
+	{
+		CD3DX12_DESCRIPTOR_RANGE1 postProcessRanges[2];
+		postProcessRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+		postProcessRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-			CD3DX12_ROOT_PARAMETER1 simulateRootParameters[2];
-			simulateRootParameters[0].InitAsDescriptorTable(_countof(simulateRanges), simulateRanges);
-			simulateRootParameters[1].InitAsConstants(sizeof(CSRootConstants) / 4, 0);
+		CD3DX12_DESCRIPTOR_RANGE1 occlusionRanges[1];
+		occlusionRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-			CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC simulateRSDescription;
-			simulateRSDescription.Init_1_1(_countof(simulateRootParameters), simulateRootParameters);
+		CD3DX12_ROOT_PARAMETER1 postProcessRootParameters[3];
+		postProcessRootParameters[0].InitAsDescriptorTable(_countof(postProcessRanges), postProcessRanges);
+		postProcessRootParameters[1].InitAsConstants(sizeof(PPRootConstants) / 4, 0);
+		postProcessRootParameters[2].InitAsDescriptorTable(_countof(occlusionRanges), occlusionRanges);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&simulateRSDescription, featureData.HighestVersion, &RSBlob, &errorBlob));
-			ThrowIfFailed(device->CreateRootSignature(0, RSBlob->GetBufferPointer(), RSBlob->GetBufferSize(), IID_PPV_ARGS(&SimulateRS)));
-		}
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC postProcessRSDescription;
+		postProcessRSDescription.Init_1_1(_countof(postProcessRootParameters), postProcessRootParameters, 1, &loader.Sampler);
 
-		// Create post-process compute signature
-		{
-			CD3DX12_DESCRIPTOR_RANGE1 postProcessRanges[2];
-			postProcessRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
-			postProcessRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+		loader.CreateRootSignature(postProcessRSDescription, PostProcessRS);
+	});
 
-			CD3DX12_ROOT_PARAMETER1 postProcessRootParameters[2];
-			postProcessRootParameters[0].InitAsDescriptorTable(_countof(postProcessRanges), postProcessRanges);
-			postProcessRootParameters[1].InitAsConstants(sizeof(PPRootConstants) / 4, 0);
+	// Create SSAO blur compute signature
+	loader.SSAOBlurRSTask = loader.Graph.Add("SSAOBlurRS", [this, &loader]()
+	{
+		CD3DX12_DESCRIPTOR_RANGE1 sceneRanges[2];
+		sceneRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+		sceneRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-			CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC postProcessRSDescription;
-			postProcessRSDescription.Init_1_1(_countof(postProcessRootParameters), postProcessRootParameters, 1, &sampler);
+		CD3DX12_DESCRIPTOR_RANGE1 occlusionRanges[1];
+		occlusionRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-			ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&postProcessRSDescription, featureData.HighestVersion, &RSBlob, &errorBlob));
-			ThrowIfFailed(device->CreateRootSignature(0, RSBlob->GetBufferPointer(), RSBlob->GetBufferSize(), IID_PPV_ARGS(&PostProcessRS)));
-		}
-	}
+		CD3DX12_ROOT_PARAMETER1 blurRootParameters[3];
+		blurRootParameters[0].InitAsDescriptorTable(_countof(sceneRanges), sceneRanges);
+		blurRootParameters[1].InitAsDescriptorTable(_countof(occlusionRanges), occlusionRanges);
+		blurRootParameters[2].InitAsConstants(sizeof(BlurRootConstants) / 4, 0);
 
-	// Get path to .exe directory (where .cso files are)
-	WCHAR assetsPath[512];
-	GetModuleFileNameW(nullptr, assetsPath, _countof(assetsPath));
-	std::wstring assetPathString = assetsPath;
-	assetPathString = assetPathString.substr(0, assetPathString.find_last_of(L"\\") + 1);
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC blurRSDescription;
+		blurRSDescription.Init_1_1(_countof(blurRootParameters), blurRootParameters);
 
-	// Create PSO's
-	{
-		ComPtr<ID3DBlob> vertexParticleShader;
-		ComPtr<ID3DBlob> vertexPlaneShader;
-		ComPtr<ID3DBlob> vertexAABBShader;
-		ComPtr<ID3DBlob> pixelShader;
-		ComPtr<ID3DBlob> pixelPlaneShader;
-		ComPtr<ID3DBlob> pixelAABBShader;
-		ComPtr<ID3DBlob> computeEmitShader;
-		ComPtr<ID3DBlob> computeSimulateShader;
-		ComPtr<ID3DBlob> computePostProcessShader;
-		ComPtr<ID3DBlob> error;
-
-		ThrowIfFailed(D3DReadFileToBlob((assetPathString + L"VertexParticle.cso").c_str(), &vertexParticleShader));
-		ThrowIfFailed(D3DReadFileToBlob((assetPathString + L"VertexPlane.cso").c_str(), &vertexPlaneShader));
-		ThrowIfFailed(D3DReadFileToBlob((assetPathString + L"VertexAABB.cso").c_str(), &vertexAABBShader));
-		ThrowIfFailed(D3DReadFileToBlob((assetPathString + L"PixelParticle.cso").c_str(), &pixelShader));
-		ThrowIfFailed(D3DReadFileToBlob((assetPathString + L"PixelPlane.cso").c_str(), &pixelPlaneShader));
-		ThrowIfFailed(D3DReadFileToBlob((assetPathString + L"PixelAABB.cso").c_str(), &pixelAABBShader));
-		ThrowIfFailed(D3DReadFileToBlob((assetPathString + L"ComputeEmitter.cso").c_str(), &computeEmitShader));
-		ThrowIfFailed(D3DReadFileToBlob((assetPathString + L"ComputeSimulator.cso").c_str(), &computeSimulateShader));
-		ThrowIfFailed(D3DReadFileToBlob((assetPathString + L"ComputePostProcess.cso").c_str(), &computePostProcessShader));
-
-		D3D12_INPUT_ELEMENT_DESC inputLayout[] =
-		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-		};
+		loader.CreateRootSignature(blurRSDescription, SSAOBlurRS);
+	});
 
-		struct RenderPipelineStateStream
-		{
-			CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
-			CD3DX12_PIPELINE_STATE_STREAM_INPUT_LAYOUT InputLayout;
-			CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY PrimitiveTopologyType;
-			CD3DX12_PIPELINE_STATE_STREAM_VS VS;
-			CD3DX12_PIPELINE_STATE_STREAM_PS PS;
-			CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL_FORMAT DSVFormat;
-			CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS RTVFormats;
-			CD3DX12_PIPELINE_STATE_STREAM_RASTERIZER Rasterizer;
-			CD3DX12_PIPELINE_STATE_STREAM_BLEND_DESC BlendMode;
-		} renderPSS;
-
-		D3D12_RT_FORMAT_ARRAY rtvFormats = {};
-		rtvFormats.NumRenderTargets = 1;
-		rtvFormats.RTFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-
-		CD3DX12_RASTERIZER_DESC rasterizer = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-
-		CD3DX12_BLEND_DESC blendMode = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-		blendMode.RenderTarget[0].BlendEnable = true;
-		blendMode.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
-		blendMode.RenderTarget[0].DestBlend = D3D12_BLEND_ONE;
-		blendMode.RenderTarget[0].SrcBlendAlpha = D3D12_BLEND_SRC_ALPHA;
-		blendMode.RenderTarget[0].DestBlendAlpha = D3D12_BLEND_DEST_ALPHA;
-
-		renderPSS.pRootSignature = RenderRS.Get();
-		renderPSS.InputLayout = { inputLayout, _countof(inputLayout) };
-		renderPSS.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-		renderPSS.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
-		renderPSS.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-		renderPSS.RTVFormats = rtvFormats;
-		renderPSS.Rasterizer = rasterizer;
-		renderPSS.BlendMode = blendMode;
-
-		// Define particle rendering PSO
-		{
-			renderPSS.VS = CD3DX12_SHADER_BYTECODE(vertexParticleShader.Get());
-
-			D3D12_PIPELINE_STATE_STREAM_DESC psoDesc =
-			{
-				sizeof(RenderPipelineStateStream), &renderPSS
-			};
-			ThrowIfFailed(device->CreatePipelineState(&psoDesc, IID_PPV_ARGS(&ParticleRenderPSO)));
-		}
+	// Create Hi-Z generation compute signature
+	loader.HiZRSTask = loader.Graph.Add("HiZRS", [this, &loader]()
+	{
+		CD3DX12_DESCRIPTOR_RANGE1 depthRanges[1];
+		depthRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-		// Define room rendering PSO
-		{
-			blendMode.RenderTarget[0].BlendEnable = false;
-			renderPSS.BlendMode = blendMode;
-			renderPSS.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-			renderPSS.VS = CD3DX12_SHADER_BYTECODE(vertexPlaneShader.Get());
-			renderPSS.PS = CD3DX12_SHADER_BYTECODE(pixelPlaneShader.Get());
+		CD3DX12_DESCRIPTOR_RANGE1 pyramidRanges[1];
+		pyramidRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, HIZ_MAX_MIPS + 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE | D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
 
-			D3D12_PIPELINE_STATE_STREAM_DESC psoDesc =
-			{
-				sizeof(RenderPipelineStateStream), &renderPSS
-			};
-			ThrowIfFailed(device->CreatePipelineState(&psoDesc, IID_PPV_ARGS(&PlaneRenderPSO)));
-		}
+		CD3DX12_ROOT_PARAMETER1 hiZRootParameters[3];
+		hiZRootParameters[0].InitAsDescriptorTable(_countof(depthRanges), depthRanges);
+		hiZRootParameters[1].InitAsDescriptorTable(_countof(pyramidRanges), pyramidRanges);
+		hiZRootParameters[2].InitAsConstants(sizeof(HiZRootConstants) / 4, 0);
 
-		// Define AABB PSO
-		{
-			renderPSS.pRootSignature = AABBRS.Get();
-			renderPSS.VS = CD3DX12_SHADER_BYTECODE(vertexAABBShader.Get());
-			renderPSS.PS = CD3DX12_SHADER_BYTECODE(pixelAABBShader.Get());
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC hiZRSDescription;
+		hiZRSDescription.Init_1_1(_countof(hiZRootParameters), hiZRootParameters);
 
-			rasterizer.CullMode = D3D12_CULL_MODE_NONE;
-			renderPSS.Rasterizer = rasterizer;
+		loader.CreateRootSignature(hiZRSDescription, HiZRS);
+	});
 
-			D3D12_PIPELINE_STATE_STREAM_DESC psoDesc =
-			{
-				sizeof(RenderPipelineStateStream), &renderPSS
-			};
-			ThrowIfFailed(device->CreatePipelineState(&psoDesc, IID_PPV_ARGS(&AABBPSO)));
-		}
+	// Create tiled particle rasterizer signature, shared by the bin and composite passes
+	loader.TileRasterRSTask = loader.Graph.Add("TileRasterRS", [this, &loader]()
+	{
+		CD3DX12_DESCRIPTOR_RANGE1 particleRanges[1];
+		particleRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
 
-		struct ComputePipelineStateStream
-		{
-			CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
-			CD3DX12_PIPELINE_STATE_STREAM_CS CS;
-		} computePSS;
+		CD3DX12_DESCRIPTOR_RANGE1 drawListRanges[1];
+		drawListRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
 
-		// Define emit PSO
-		{
-			computePSS.pRootSignature = EmitRS.Get();
-			computePSS.CS = CD3DX12_SHADER_BYTECODE(computeEmitShader.Get());;
+		CD3DX12_DESCRIPTOR_RANGE1 tileRanges[1];
+		tileRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-			D3D12_PIPELINE_STATE_STREAM_DESC emitPSODesc =
-			{
-				sizeof(ComputePipelineStateStream), &computePSS
-			};
-			ThrowIfFailed(device->CreatePipelineState(&emitPSODesc, IID_PPV_ARGS(&EmitPSO)));
-		}
+		CD3DX12_DESCRIPTOR_RANGE1 sceneRanges[1];
+		sceneRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 2, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-		// Define simulate PSO
-		{
-			computePSS.pRootSignature = SimulateRS.Get();
-			computePSS.CS = CD3DX12_SHADER_BYTECODE(computeSimulateShader.Get());;
+		CD3DX12_DESCRIPTOR_RANGE1 depthRanges[1];
+		depthRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 3, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-			D3D12_PIPELINE_STATE_STREAM_DESC simulatePSODesc =
-			{
-				sizeof(ComputePipelineStateStream), &computePSS
-			};
-			ThrowIfFailed(device->CreatePipelineState(&simulatePSODesc, IID_PPV_ARGS(&SimulatePSO)));
-		}
+		CD3DX12_DESCRIPTOR_RANGE1 textureRanges[1];
+		textureRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 4, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
 
-		// Define post-process PSO
-		{
-			computePSS.pRootSignature = PostProcessRS.Get();
-			computePSS.CS = CD3DX12_SHADER_BYTECODE(computePostProcessShader.Get());;
+		CD3DX12_ROOT_PARAMETER1 rasterRootParameters[9];
+		rasterRootParameters[0].InitAsConstants(sizeof(TileRasterConstants) / 4, 0);
+		rasterRootParameters[1].InitAsDescriptorTable(_countof(particleRanges), particleRanges);
+		rasterRootParameters[2].InitAsDescriptorTable(_countof(drawListRanges), drawListRanges);
+		rasterRootParameters[3].InitAsShaderResourceView(2, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+		rasterRootParameters[4].InitAsDescriptorTable(_countof(tileRanges), tileRanges);
+		rasterRootParameters[5].InitAsDescriptorTable(_countof(sceneRanges), sceneRanges);
+		rasterRootParameters[6].InitAsDescriptorTable(_countof(depthRanges), depthRanges);
+		rasterRootParameters[7].InitAsDescriptorTable(_countof(textureRanges), textureRanges);
+		rasterRootParameters[8].InitAsConstants(sizeof(ParticleAtlasConstants) / 4, 1);
 
-			D3D12_PIPELINE_STATE_STREAM_DESC postProcessPSODesc =
-			{
-				sizeof(ComputePipelineStateStream), &computePSS
-			};
-			ThrowIfFailed(device->CreatePipelineState(&postProcessPSODesc, IID_PPV_ARGS(&PostProcessPSO)));
-		}
-	}
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rasterRSDescription;
+		rasterRSDescription.Init_1_1(_countof(rasterRootParameters), rasterRootParameters);
 
-	auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
-	auto commandList = commandQueue->GetCommandList();
-	ComPtr<ID3D12Resource> intermediateVertexBuffer;
-	ComPtr<ID3D12Resource> intermediateIndexBuffer;
+		loader.CreateRootSignature(rasterRSDescription, TileRasterRS);
+	});
 
-	// Create Vertex/Index Buffer
+	// Create spatial hash build signature, one PSO runs every phase
+	loader.SpatialHashRSTask = loader.Graph.Add("SpatialHashRS", [this, &loader]()
 	{
-		UpdateBufferResource(commandList.Get(), &VertexBuffer, &intermediateVertexBuffer, _countof(Vertices), sizeof(VertexTexCoord), Vertices);
-		TransitionResource(commandList, VertexBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+		CD3DX12_DESCRIPTOR_RANGE1 hashRanges[1];
+		hashRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 6, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-		VertexBufferView.BufferLocation = VertexBuffer->GetGPUVirtualAddress();
-		VertexBufferView.SizeInBytes = sizeof(Vertices);
-		VertexBufferView.StrideInBytes = sizeof(VertexTexCoord);
+		CD3DX12_DESCRIPTOR_RANGE1 particleRanges[1];
+		particleRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 6, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-		UpdateBufferResource(commandList.Get(), &IndexBuffer, &intermediateIndexBuffer, _countof(Indices), sizeof(WORD), Indices);
-		TransitionResource(commandList, IndexBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+		CD3DX12_ROOT_PARAMETER1 hashRootParameters[3];
+		hashRootParameters[0].InitAsDescriptorTable(_countof(hashRanges), hashRanges);
+		hashRootParameters[1].InitAsDescriptorTable(_countof(particleRanges), particleRanges);
+		hashRootParameters[2].InitAsConstants(sizeof(SpatialHashRootConstants) / 4, 0);
 
-		IndexBufferView.BufferLocation = IndexBuffer->GetGPUVirtualAddress();
-		IndexBufferView.Format = DXGI_FORMAT_R16_UINT;
-		IndexBufferView.SizeInBytes = sizeof(Indices);
-	}
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC hashRSDescription;
+		hashRSDescription.Init_1_1(_countof(hashRootParameters), hashRootParameters);
 
-	DescriptorSize = Application::Get().GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-	DescriptorSizeRTV = Application::Get().GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-	DescriptorSizeDSV = Application::Get().GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+		loader.CreateRootSignature(hashRSDescription, SpatialHashRS);
+	});
 
-	ComPtr<ID3D12Resource> intermediateParticleBuffer;
-	ComPtr<ID3D12Resource> intermediateAlive0Buffer;
-	ComPtr<ID3D12Resource> intermediateAlive1Buffer;
-	ComPtr<ID3D12Resource> intermediateDeadBuffer;
-	ComPtr<ID3D12Resource> intermediateDeadBufferCounter;
-	ComPtr<ID3D12Resource> intermediateStagedParticleBuffer;
-	ComPtr<ID3D12Resource> intermediateTilesTextureBuffer;
-	ComPtr<ID3D12Resource> intermediateWallsTextureBuffer;
-	ComPtr<ID3D12Resource> intermediatePlaneBuffer;
-	ComPtr<ID3D12Resource> intermediateSSAOKernelBuffer;
-	ComPtr<ID3D12Resource> intermediateSSAOTexBuffer;
-
-	// Define descriptor heap
-	{
-		// Breaking these up might be a good idea as to not allocate all this space at once
-		Particle particleData[MaxParticleCount];
-		Particle stagedParticleData[MaxParticleCount * Window::BufferCount];
-		UINT particleAliveIndices[MaxParticleCount];
-		UINT particleDeadIndices[MaxParticleCount];
-		UINT deadCounter[1] = { MaxParticleCount };
-		XMFLOAT4 ssaoKernel[KernelSize];
-		XMFLOAT4 ssaoNoise[NoiseSize * NoiseSize];
+	// Create SPH compute signature, reads the neighbor grid and runs both fluid phases
+	loader.SPHRSTask = loader.Graph.Add("SPHRS", [this, &loader]()
+	{
+		CD3DX12_DESCRIPTOR_RANGE1 hashRanges[1];
+		hashRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 3, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-		for (UINT n = 0; n < MaxParticleCount; n++)
-		{
-			particleData[n] = {};
-			//particleData[n].lifeTimeLeft = FLT_MAX;
-			particleAliveIndices[n] = n;
-			particleDeadIndices[n] = n;
-		}
+		CD3DX12_DESCRIPTOR_RANGE1 particleRanges[1];
+		particleRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 3, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-		UINT index = 0;
-		for (UINT frame = 0; frame < Window::BufferCount; frame++)
-		{
-			for (UINT n = 0; n < MaxParticleCount; n++)
-			{
-				stagedParticleData[index] = {};
-				++index;
-			}
-		}
+		CD3DX12_DESCRIPTOR_RANGE1 fluidRanges[1];
+		fluidRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 4, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
 
-		//std::srand(time(NULL)); // Re-seed RNG
-		for (UINT n = 0; n < KernelSize; ++n)
-		{
-			const double x = (static_cast<double>(std::rand()) / RAND_MAX) * 2 - 1;
-			const double y = (static_cast<double>(std::rand()) / RAND_MAX) * 2 - 1;
-			const double z = (static_cast<double>(std::rand()) / RAND_MAX);
-			XMFLOAT4 float4 = XMFLOAT4(x, y, z, 0);
-			XMVECTOR vector = XMLoadFloat4(&float4);
-			vector = XMVector4Normalize(vector);
+		CD3DX12_ROOT_PARAMETER1 fluidRootParameters[4];
+		fluidRootParameters[0].InitAsDescriptorTable(_countof(hashRanges), hashRanges);
+		fluidRootParameters[1].InitAsDescriptorTable(_countof(particleRanges), particleRanges);
+		fluidRootParameters[2].InitAsDescriptorTable(_countof(fluidRanges), fluidRanges);
+		fluidRootParameters[3].InitAsConstants(sizeof(SPHRootConstants) / 4, 0);
 
-			float scale = n / static_cast<float>(KernelSize);
-			scale = std::lerp(0.1f, 1.0f, scale * scale);
-			vector = XMVectorScale(vector, scale);
-			XMStoreFloat4(&ssaoKernel[n], vector);
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC fluidRSDescription;
+		fluidRSDescription.Init_1_1(_countof(fluidRootParameters), fluidRootParameters);
+
+		loader.CreateRootSignature(fluidRSDescription, SPHRS);
+	});
+
+	// Create trail ribbon compute signature, reads the same staged particles and draw list as the billboard pass
+	loader.TrailRSTask = loader.Graph.Add("TrailRS", [this, &loader]()
+	{
+		CD3DX12_DESCRIPTOR_RANGE1 particleRanges[1];
+		particleRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+
+		CD3DX12_DESCRIPTOR_RANGE1 drawListRanges[1];
+		drawListRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+
+		CD3DX12_DESCRIPTOR_RANGE1 historyRanges[1];
+		historyRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 3, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+
+		CD3DX12_DESCRIPTOR_RANGE1 ribbonRanges[1];
+		ribbonRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+
+		CD3DX12_ROOT_PARAMETER1 trailRootParameters[6];
+		trailRootParameters[0].InitAsConstants(sizeof(TrailConstants) / 4, 0);
+		trailRootParameters[1].InitAsDescriptorTable(_countof(particleRanges), particleRanges);
+		trailRootParameters[2].InitAsDescriptorTable(_countof(drawListRanges), drawListRanges);
+		trailRootParameters[3].InitAsShaderResourceView(2, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+		trailRootParameters[4].InitAsDescriptorTable(_countof(historyRanges), historyRanges);
+		trailRootParameters[5].InitAsDescriptorTable(_countof(ribbonRanges), ribbonRanges);
+
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC trailRSDescription;
+		trailRSDescription.Init_1_1(_countof(trailRootParameters), trailRootParameters);
+
+		loader.CreateRootSignature(trailRSDescription, TrailRS);
+	});
+
+	// Create depth sort compute signature, shared by the histogram and onesweep passes
+	loader.SortRSTask = loader.Graph.Add("SortRS", [this, &loader]()
+	{
+		CD3DX12_DESCRIPTOR_RANGE1 sortRanges[1];
+		sortRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 5, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+
+		CD3DX12_DESCRIPTOR_RANGE1 particleRanges[1];
+		particleRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 5, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+
+		CD3DX12_DESCRIPTOR_RANGE1 visibleRanges[1];
+		visibleRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 6, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE);
+
+		CD3DX12_ROOT_PARAMETER1 sortRootParameters[5];
+		sortRootParameters[0].InitAsDescriptorTable(_countof(sortRanges), sortRanges);
+		sortRootParameters[1].InitAsDescriptorTable(_countof(particleRanges), particleRanges);
+		sortRootParameters[2].InitAsDescriptorTable(_countof(visibleRanges), visibleRanges);
+		sortRootParameters[3].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+		sortRootParameters[4].InitAsConstants(sizeof(SortRootConstants) / 4, 0);
+
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC sortRSDescription;
+		sortRSDescription.Init_1_1(_countof(sortRootParameters), sortRootParameters);
+
+		loader.CreateRootSignature(sortRSDescription, SortRS);
+	});
+}
+
+void ParticleGame::CreateTextureTasks(ContentLoader& loader)
+{
+	// Authored PNGs and TGAs are compressed into DDS files next to them first, in Particle.dds's format so the atlas takes them.
+	// One task each, their encodes take turns on CPUThreadPool.
+	uint32_t authoredFormat = 0;
+	MappedFile particleFile;
+	DDSTexture particleTexture;
+	if (particleFile.Open(loader.AssetPath + L"Particle.dds") && ParseDDS(particleFile.GetData(), particleFile.GetSize(), particleTexture))
+	{
+		authoredFormat = particleTexture.Format;
+	}
+	particleFile.Close();
+	if (authoredFormat != BLOCK_FORMAT_BC1 && authoredFormat != BLOCK_FORMAT_BC3 && authoredFormat != BLOCK_FORMAT_BC4 && authoredFormat != BLOCK_FORMAT_BC7)
+	{
+		authoredFormat = BLOCK_FORMAT_BC7;
+	}
+
+	std::vector<TaskGraph::Task> textureTasks;
+	std::error_code code;
+	for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(loader.AssetPath + L"ParticleTextures", code))
+	{
+		const std::filesystem::path extension = file.path().extension();
+		if (extension == L".png" || extension == L".tga")
+		{
+			const std::filesystem::path sourcePath = file.path();
+			textureTasks.push_back(loader.Graph.Add(sourcePath.filename().string(), [this, sourcePath, authoredFormat]()
+			{
+				std::string error;
+				if (!UpdateCompressedTexture(sourcePath, std::filesystem::path(sourcePath).replace_extension(L".dds"), authoredFormat, CPUThreadPool, error))
+				{
+					OutputDebugStringA(("Particle textures: " + error + "\n").c_str());
+				}
+			}));
 		}
+	}
 
-		for (UINT n = 0; n < NoiseSize * NoiseSize; ++n)
+	// ParticleTextures is listed again once every authored texture has its DDS file
+	loader.AtlasTask = loader.Graph.Add("ParticleAtlas", [this, &loader]()
+	{
+		std::vector<std::filesystem::path> atlasSources;
+		std::error_code listError;
+		for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(loader.AssetPath + L"ParticleTextures", listError))
 		{
-			const double x = (static_cast<double>(std::rand()) / RAND_MAX) * 2 - 1;
-			const double y = (static_cast<double>(std::rand()) / RAND_MAX) * 2 - 1;
-			XMFLOAT4 float4 = XMFLOAT4(x, y, 0, 0);
-			XMVECTOR vector = XMLoadFloat4(&float4);
-			vector = XMVector4Normalize(vector);
-			XMStoreFloat4(&ssaoNoise[n], vector);
+			if (file.path().extension() == L".dds")
+			{
+				atlasSources.push_back(file.path());
+			}
 		}
+		std::sort(atlasSources.begin(), atlasSources.end());
+		atlasSources.insert(atlasSources.begin(), loader.AssetPath + L"Particle.dds");
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE descriptorHandle(DescriptorHeap->GetCPUDescriptorHandleForHeapStart(), 0, DescriptorSize);
-		CD3DX12_CPU_DESCRIPTOR_HANDLE descriptorHandleRTV(RTVHeap->GetCPUDescriptorHandleForHeapStart(), 0, DescriptorSizeRTV);
+		std::string error;
+		if (!UpdateParticleAtlas(atlasSources, loader.ParticleTexturePath, loader.AssetPath + L"ParticleAtlas.bin", AtlasEntries, error))
+		{
+			OutputDebugStringA(("Particle atlas: " + error + ", drawing Particle.dds alone\n").c_str());
+			loader.ParticleTexturePath = loader.AssetPath + L"Particle.dds";
+			AtlasEntries = { MakeParticleAtlasEntry("Particle") };
+		}
+		AtlasConstants = MakeParticleAtlasConstants(AtlasEntries[0], CSRootConstants.particleLifetime);
+	}, textureTasks);
+}
+
+void ParticleGame::CreateEmitterTasks(ContentLoader& loader)
+{
+	// Emitters come from Emitters.json, compiled into Emitters.bin whenever the JSON is newer.
+	// Without either file the library starts out as the built-in emitter and a slow drifting preset.
+	loader.Graph.Add("Emitters", [this, &loader]()
+	{
+		const std::filesystem::path emitterJSONPath = loader.AssetPath + L"Emitters.json";
+		const std::filesystem::path emitterBinaryPath = loader.AssetPath + L"Emitters.bin";
+		if (!std::filesystem::exists(emitterJSONPath) && !std::filesystem::exists(emitterBinaryPath))
+		{
+			EmitterConstants drift = CSRootConstants;
+			drift.particleLifetime = 3.0f;
+			drift.emitCount = 2;
+			drift.emitAABBMin = float4(-6, 0, -7, 0);
+			drift.emitAABBMax = float4(6, 10, 11, 0);
+			drift.emitVelocityMin = float4(-1, -1, -1, 0);
+			drift.emitVelocityMax = float4(0, 0, 1, 0);
+			drift.emitAccelerationMin = float4(0, 0, 0, 0);
+			drift.emitAccelerationMax = float4(0, 0, 0, 0);
+			drift.particleStartScale = 0.10f;
+			drift.particleEndScale = 0.01f;
+			drift.curveSet = CURVE_SET_NONE;
+
+			const EmitterRecord presets[] = { MakeEmitterRecord("Rising", CSRootConstants), MakeEmitterRecord("Drift", drift) };
+			SaveEmitterJSON(emitterJSONPath, presets, _countof(presets));
+		}
+
+		std::string error;
+		loader.EmittersLoaded = Emitters.Load(emitterJSONPath, emitterBinaryPath, static_cast<UINT>(EmitterCurveSets().size()), error);
+		if (!loader.EmittersLoaded)
+		{
+			OutputDebugStringA(("Emitter library: " + error + "\n").c_str());
+		}
+	});
+}
+
+void ParticleGame::CreateRenderPSOTasks(ContentLoader& loader)
+{
+	const ContentLoader::ShaderRead vertexParticleShader = loader.ReadShader(L"VertexParticle.cso");
+	const ContentLoader::ShaderRead vertexPlaneShader = loader.ReadShader(L"VertexPlane.cso");
+	const ContentLoader::ShaderRead vertexAABBShader = loader.ReadShader(L"VertexAABB.cso");
+	const ContentLoader::ShaderRead vertexTrailShader = loader.ReadShader(L"VertexTrail.cso");
+	const ContentLoader::ShaderRead pixelShader = loader.ReadShader(L"PixelParticle.cso");
+	const ContentLoader::ShaderRead pixelPlaneShader = loader.ReadShader(L"PixelPlane.cso");
+	const ContentLoader::ShaderRead pixelAABBShader = loader.ReadShader(L"PixelAABB.cso");
+	const ContentLoader::ShaderRead pixelTrailShader = loader.ReadShader(L"PixelTrail.cso");
+
+	CD3DX12_RASTERIZER_DESC rasterizer = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	CD3DX12_RASTERIZER_DESC twoSidedRasterizer = rasterizer;
+	twoSidedRasterizer.CullMode = D3D12_CULL_MODE_NONE;
+
+	CD3DX12_BLEND_DESC blendMode = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	blendMode.RenderTarget[0].BlendEnable = true;
+	blendMode.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+	blendMode.RenderTarget[0].DestBlend = D3D12_BLEND_ONE;
+	blendMode.RenderTarget[0].SrcBlendAlpha = D3D12_BLEND_SRC_ALPHA;
+	blendMode.RenderTarget[0].DestBlendAlpha = D3D12_BLEND_DEST_ALPHA;
+
+	// The pixel shader premultiplies by the texture's alpha
+	CD3DX12_BLEND_DESC alphaBlendMode = blendMode;
+	alphaBlendMode.RenderTarget[0].SrcBlend = D3D12_BLEND_ONE;
+	alphaBlendMode.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+	alphaBlendMode.RenderTarget[0].SrcBlendAlpha = D3D12_BLEND_ONE;
+	alphaBlendMode.RenderTarget[0].DestBlendAlpha = D3D12_BLEND_INV_SRC_ALPHA;
+
+	CD3DX12_BLEND_DESC opaqueBlendMode = blendMode;
+	opaqueBlendMode.RenderTarget[0].BlendEnable = false;
+
+	// The task takes copies of the descs, they go out of scope before the graph runs
+	auto addRenderPipeline = [&loader](const char* name, ComPtr<ID3D12RootSignature>& rootSignature, TaskGraph::Task rootSignatureTask,
+		ContentLoader::ShaderRead vertexShader, ContentLoader::ShaderRead pixelShader, CD3DX12_RASTERIZER_DESC streamRasterizer,
+		CD3DX12_BLEND_DESC streamBlendMode, bool vertexBuffer, ComPtr<ID3D12PipelineState>& pipelineState)
+	{
+		loader.Graph.Add(name, [&loader, &rootSignature, vertexShader, pixelShader, streamRasterizer, streamBlendMode, vertexBuffer, &pipelineState]()
+		{
+			loader.CreateRenderPipeline(rootSignature.Get(), vertexShader.Blob->Get(), pixelShader.Blob->Get(), streamRasterizer, streamBlendMode, vertexBuffer,
+				pipelineState);
+		}, { rootSignatureTask, vertexShader.Task, pixelShader.Task });
+	};
+
+	// Define particle rendering PSOs
+	addRenderPipeline("ParticleRenderPSO", RenderRS, loader.RenderRSTask, vertexParticleShader, pixelShader, rasterizer, blendMode, true, ParticleRenderPSO);
+	addRenderPipeline("ParticleAlphaPSO", RenderRS, loader.RenderRSTask, vertexParticleShader, pixelShader, rasterizer, alphaBlendMode, true, ParticleAlphaPSO);
+
+	// Define trail ribbon PSO, additive like the billboards. Vertices are pulled from the ribbon buffer and both sides are drawn.
+	addRenderPipeline("TrailRenderPSO", RenderRS, loader.RenderRSTask, vertexTrailShader, pixelTrailShader, twoSidedRasterizer, blendMode, false, TrailRenderPSO);
+
+	// Define room rendering PSO
+	addRenderPipeline("PlaneRenderPSO", RenderRS, loader.RenderRSTask, vertexPlaneShader, pixelPlaneShader, rasterizer, opaqueBlendMode, true, PlaneRenderPSO);
+
+	// Define AABB PSO
+	addRenderPipeline("AABBPSO", AABBRS, loader.AABBRSTask, vertexAABBShader, pixelAABBShader, twoSidedRasterizer, opaqueBlendMode, true, AABBPSO);
+}
+
+void ParticleGame::CreateComputePSOTasks(ContentLoader& loader)
+{
+	// Every compute shader belongs to one PSO, its read is added right before it
+	auto addComputePipeline = [&loader](const char* name, ComPtr<ID3D12RootSignature>& rootSignature, TaskGraph::Task rootSignatureTask,
+		const wchar_t* shaderFile, ComPtr<ID3D12PipelineState>& pipelineState)
+	{
+		const ContentLoader::ShaderRead computeShader = loader.ReadShader(shaderFile);
+		loader.Graph.Add(name, [&loader, &rootSignature, computeShader, &pipelineState]()
+		{
+			loader.CreateComputePipeline(rootSignature.Get(), computeShader.Blob->Get(), pipelineState);
+		}, { rootSignatureTask, computeShader.Task });
+	};
+
+	// Define emit PSO
+	addComputePipeline("EmitPSO", EmitRS, loader.EmitRSTask, L"ComputeEmitter.cso", EmitPSO);
+
+	// Define simulate PSO
+	addComputePipeline("SimulatePSO", SimulateRS, loader.SimulateRSTask, L"ComputeSimulator.cso", SimulatePSO);
+
+	// Define post-process PSO
+	addComputePipeline("PostProcessPSO", PostProcessRS, loader.PostProcessRSTask, L"ComputePostProcess.cso", PostProcessPSO);
+
+	// Define SSAO blur PSO
+	addComputePipeline("SSAOBlurPSO", SSAOBlurRS, loader.SSAOBlurRSTask, L"ComputeSSAOBlur.cso", SSAOBlurPSO);
+
+	// Define Hi-Z PSO
+	addComputePipeline("HiZPSO", HiZRS, loader.HiZRSTask, L"ComputeHiZ.cso", HiZPSO);
+
+	// Define depth sort PSOs
+	addComputePipeline("SortHistogramPSO", SortRS, loader.SortRSTask, L"ComputeSortHistogram.cso", SortHistogramPSO);
+	addComputePipeline("SortOnesweepPSO", SortRS, loader.SortRSTask, L"ComputeSortOnesweep.cso", SortOnesweepPSO);
+
+	// Define tiled rasterizer PSOs
+	addComputePipeline("TileBinPSO", TileRasterRS, loader.TileRasterRSTask, L"ComputeTileBin.cso", TileBinPSO);
+	addComputePipeline("TileRasterPSO", TileRasterRS, loader.TileRasterRSTask, L"ComputeTileRaster.cso", TileRasterPSO);
+
+	// Define spatial hash PSO
+	addComputePipeline("SpatialHashPSO", SpatialHashRS, loader.SpatialHashRSTask, L"ComputeSpatialHash.cso", SpatialHashPSO);
+
+	// Define SPH PSO
+	addComputePipeline("SPHPSO", SPHRS, loader.SPHRSTask, L"ComputeSPH.cso", SPHPSO);
+
+	// Define trail ribbon generation PSO
+	addComputePipeline("TrailPSO", TrailRS, loader.TrailRSTask, L"ComputeTrails.cso", TrailPSO);
+
+	// Define sub-emitter args and spawn PSOs
+	addComputePipeline("GenerateArgsPSO", SubEmitterRS, loader.SubEmitterRSTask, L"ComputeGenerateArgs.cso", GenerateArgsPSO);
+	addComputePipeline("SubEmitterPSO", SubEmitterRS, loader.SubEmitterRSTask, L"ComputeSubEmitter.cso", SubEmitterPSO);
+}
+
+void ParticleGame::CreateBufferTasks(ContentLoader& loader)
+{
+	// Vertex/Index Buffer and the indirect draw arguments per frame, only InstanceCount of those is rewritten
+	loader.Graph.Add("MeshBuffers", [this, &loader]()
+	{
+		loader.CreateBuffer(VertexBuffer, _countof(Vertices), sizeof(VertexTexCoord), Vertices, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+		VertexBufferView.BufferLocation = VertexBuffer->GetGPUVirtualAddress();
+		VertexBufferView.SizeInBytes = sizeof(Vertices);
+		VertexBufferView.StrideInBytes = sizeof(VertexTexCoord);
+
+		loader.CreateBuffer(IndexBuffer, _countof(Indices), sizeof(WORD), Indices, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+		IndexBufferView.BufferLocation = IndexBuffer->GetGPUVirtualAddress();
+		IndexBufferView.Format = DXGI_FORMAT_R16_UINT;
+		IndexBufferView.SizeInBytes = sizeof(Indices);
+
+		D3D12_DRAW_INDEXED_ARGUMENTS drawArgs[Window::BufferCount];
+		for (UINT frame = 0; frame < Window::BufferCount; frame++)
+		{
+			drawArgs[frame] = { _countof(Indices), 0, 0, 0, 0 };
+		}
+		loader.CreateBuffer(IndirectDrawArgs, Window::BufferCount, sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), drawArgs);
+	});
+
+	// Entries 0-7, the particle pool, its alive and dead lists, and the staged particle data for rendering
+	loader.Graph.Add("ParticleBuffers", [this, &loader]()
+	{
+		std::vector<Particle> particleData(MaxParticleCount);
+		std::vector<Particle> stagedParticleData(MaxParticleCount * Window::BufferCount);
+		std::vector<UINT> particleDeadIndices(MaxParticleCount);
+		UINT deadCounter[1] = { MaxParticleCount };
+		for (UINT n = 0; n < MaxParticleCount; n++)
+		{
+			particleDeadIndices[n] = n;
+		}
 
 		// Entry 0, Particle buffer for compute shaders
-		UpdateBufferResource(commandList.Get(), &ParticleBuffer, &intermediateParticleBuffer, _countof(particleData), sizeof(Particle), particleData, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		loader.CreateBuffer(ParticleBuffer, particleData.size(), sizeof(Particle), particleData.data(), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
 		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
 		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
@@ -521,45 +1342,41 @@ bool ParticleGame::LoadContent()
 		uavDesc.Buffer.StructureByteStride = sizeof(Particle);
 		uavDesc.Buffer.CounterOffsetInBytes = 0;
 		uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
-		device->CreateUnorderedAccessView(ParticleBuffer.Get(), nullptr, &uavDesc, descriptorHandle);
+		loader.Device->CreateUnorderedAccessView(ParticleBuffer.Get(), nullptr, &uavDesc, loader.GetDescriptor(0));
 
 		// Entry 1, Alive particle index buffer 0
-		descriptorHandle.Offset(1, DescriptorSize);
 		uavDesc.Buffer.StructureByteStride = sizeof(UINT);
 		uavDesc.Buffer.CounterOffsetInBytes = ParticleBufferCounterOffset;
 		CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(ParticleBufferCounterOffset + sizeof(UINT), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 		CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
-		ThrowIfFailed(device->CreateCommittedResource(
+		ThrowIfFailed(loader.Device->CreateCommittedResource(
 			&defaultHeapProperties,
 			D3D12_HEAP_FLAG_NONE,
 			&bufferDesc,
 			D3D12_RESOURCE_STATE_COPY_DEST,
 			nullptr,
 			IID_PPV_ARGS(&AliveIndexList0)));
-		device->CreateUnorderedAccessView(AliveIndexList0.Get(), AliveIndexList0.Get(), &uavDesc, descriptorHandle);
+		loader.Device->CreateUnorderedAccessView(AliveIndexList0.Get(), AliveIndexList0.Get(), &uavDesc, loader.GetDescriptor(1));
 
 		// Entry 2, Alive particle index buffer 1
-		descriptorHandle.Offset(1, DescriptorSize);
-		ThrowIfFailed(device->CreateCommittedResource(
+		ThrowIfFailed(loader.Device->CreateCommittedResource(
 			&defaultHeapProperties,
 			D3D12_HEAP_FLAG_NONE,
 			&bufferDesc,
 			D3D12_RESOURCE_STATE_COPY_SOURCE,
 			nullptr,
 			IID_PPV_ARGS(&AliveIndexList1)));
-		device->CreateUnorderedAccessView(AliveIndexList1.Get(), AliveIndexList1.Get(), &uavDesc, descriptorHandle);
+		loader.Device->CreateUnorderedAccessView(AliveIndexList1.Get(), AliveIndexList1.Get(), &uavDesc, loader.GetDescriptor(2));
 
 		// Create counter resource for DeadIndexList as we want to place the counter on the heap to read from compute shaders as an SRV
-		UpdateBufferResource(commandList.Get(), &DeadIndexListCounter, &intermediateDeadBufferCounter, 1, sizeof(UINT), deadCounter, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		loader.CreateBuffer(DeadIndexListCounter, 1, sizeof(UINT), deadCounter, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 
 		// Entry 3, Dead particle index buffer
-		descriptorHandle.Offset(1, DescriptorSize);
 		uavDesc.Buffer.CounterOffsetInBytes = 0;
-		UpdateBufferResource(commandList.Get(), &DeadIndexList, &intermediateDeadBuffer, MaxParticleCount, sizeof(UINT), particleDeadIndices, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-		device->CreateUnorderedAccessView(DeadIndexList.Get(), DeadIndexListCounter.Get(), &uavDesc, descriptorHandle);
-		
+		loader.CreateBuffer(DeadIndexList, MaxParticleCount, sizeof(UINT), particleDeadIndices.data(), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		loader.Device->CreateUnorderedAccessView(DeadIndexList.Get(), DeadIndexListCounter.Get(), &uavDesc, loader.GetDescriptor(3));
+
 		// Entry 4, Dead particle index buffer counter
-		descriptorHandle.Offset(1, DescriptorSize);
 		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
 		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
@@ -567,130 +1384,687 @@ bool ParticleGame::LoadContent()
 		srvDesc.Buffer.NumElements = 1;
 		srvDesc.Buffer.StructureByteStride = sizeof(UINT);
 		srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
-		device->CreateShaderResourceView(DeadIndexListCounter.Get(), &srvDesc, descriptorHandle);
+		loader.Device->CreateShaderResourceView(DeadIndexListCounter.Get(), &srvDesc, loader.GetDescriptor(4));
 
 		// Entries 5-7, Staged particle data for rendering
-		UpdateBufferResource(commandList.Get(), &StagedParticleBuffers, &intermediateStagedParticleBuffer, _countof(stagedParticleData), sizeof(Particle), stagedParticleData);
+		loader.CreateBuffer(StagedParticleBuffers, stagedParticleData.size(), sizeof(Particle), stagedParticleData.data());
 		srvDesc.Buffer.NumElements = MaxParticleCount;
 		srvDesc.Buffer.StructureByteStride = sizeof(Particle);
 		for (UINT frame = 0; frame < Window::BufferCount; frame++)
 		{
-			descriptorHandle.Offset(1, DescriptorSize);
 			srvDesc.Buffer.FirstElement = frame * MaxParticleCount;
-			device->CreateShaderResourceView(StagedParticleBuffers.Get(), &srvDesc, descriptorHandle);
+			loader.Device->CreateShaderResourceView(StagedParticleBuffers.Get(), &srvDesc, loader.GetDescriptor(5 + frame));
 		}
+	});
 
-		// Entry 8, Particle Texture
-		descriptorHandle.Offset(1, DescriptorSize);
-		UpdateTextureResourceFromFile(commandList.Get(), &TilesTexture, &intermediateTilesTextureBuffer, assetPathString + L"Particle.dds");
-		srvDesc.Format = DXGI_FORMAT_BC3_UNORM;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-		srvDesc.Texture2D.MostDetailedMip = 0;
-		srvDesc.Texture2D.MipLevels = 1;
-		srvDesc.Texture2D.PlaneSlice = 0;
-		device->CreateShaderResourceView(TilesTexture.Get(), &srvDesc, descriptorHandle);
-		TransitionResource(commandList.Get(), TilesTexture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-
-		// Entry 9, Planes Texture
-		descriptorHandle.Offset(1, DescriptorSize);
-		UpdateTextureResourceFromFile(commandList.Get(), &WallTexture, &intermediateWallsTextureBuffer, assetPathString + L"bathroomtile.dds");
-		srvDesc.Format = DXGI_FORMAT_BC3_UNORM;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-		srvDesc.Texture2D.MostDetailedMip = 0;
-		srvDesc.Texture2D.MipLevels = 1;
-		srvDesc.Texture2D.PlaneSlice = 0;
-		device->CreateShaderResourceView(WallTexture.Get(), &srvDesc, descriptorHandle);
-		TransitionResource(commandList.Get(), WallTexture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	// Entries 10 and 51-52, the room's planes for drawing and the collision planes with their broadphase cell masks
+	loader.Graph.Add("SceneBuffers", [this, &loader]()
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
 
 		// Entry 10, Plane orientation buffer
-		descriptorHandle.Offset(1, DescriptorSize);
-		UpdateBufferResource(commandList.Get(), &PlaneBuffer, &intermediatePlaneBuffer, _countof(Planes), sizeof(PlaneData), Planes);
-		D3D12_SHADER_RESOURCE_VIEW_DESC newDesc = {};
-		newDesc.Format = DXGI_FORMAT_UNKNOWN;
-		newDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
-		newDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		newDesc.Buffer.NumElements = _countof(Planes);
-		newDesc.Buffer.StructureByteStride = sizeof(PlaneData);
-		newDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
-		device->CreateShaderResourceView(PlaneBuffer.Get(), &newDesc, descriptorHandle);
+		loader.CreateBuffer(PlaneBuffer, _countof(Planes), sizeof(PlaneData), Planes);
+		srvDesc.Buffer.NumElements = _countof(Planes);
+		srvDesc.Buffer.StructureByteStride = sizeof(PlaneData);
+		loader.Device->CreateShaderResourceView(PlaneBuffer.Get(), &srvDesc, loader.GetDescriptor(10));
+
+		// Entry 51, Collision planes
+		loader.CreateBuffer(CollisionPlaneBuffer, CollisionPlanes.size(), sizeof(CollisionPlane), CollisionPlanes.data());
+		srvDesc.Buffer.NumElements = static_cast<UINT>(CollisionPlanes.size());
+		srvDesc.Buffer.StructureByteStride = sizeof(CollisionPlane);
+		loader.Device->CreateShaderResourceView(CollisionPlaneBuffer.Get(), &srvDesc, loader.GetDescriptor(51));
+
+		// Entry 52, Collision broadphase cell masks
+		loader.CreateBuffer(CollisionGridBuffer, CollisionGrid.size(), sizeof(UINT), CollisionGrid.data());
+		srvDesc.Buffer.NumElements = static_cast<UINT>(CollisionGrid.size());
+		srvDesc.Buffer.StructureByteStride = sizeof(UINT);
+		loader.Device->CreateShaderResourceView(CollisionGridBuffer.Get(), &srvDesc, loader.GetDescriptor(52));
+	});
+
+	// Entries 11 and 13-14, the post-processing target and SSAO's sampling kernel and random rotations
+	loader.Graph.Add("PostProcessBuffers", [this, &loader]()
+	{
+		XMFLOAT4 ssaoKernel[KernelSize];
+		XMFLOAT4 ssaoNoise[NoiseSize * NoiseSize];
+
+		//std::srand(time(NULL)); // Re-seed RNG
+		for (UINT n = 0; n < KernelSize; ++n)
+		{
+			const double x = (static_cast<double>(std::rand()) / RAND_MAX) * 2 - 1;
+			const double y = (static_cast<double>(std::rand()) / RAND_MAX) * 2 - 1;
+			const double z = (static_cast<double>(std::rand()) / RAND_MAX);
+			XMFLOAT4 float4 = XMFLOAT4(x, y, z, 0);
+			XMVECTOR vector = XMLoadFloat4(&float4);
+			vector = XMVector4Normalize(vector);
+
+			float scale = n / static_cast<float>(KernelSize);
+			scale = std::lerp(0.1f, 1.0f, scale * scale);
+			vector = XMVectorScale(vector, scale);
+			XMStoreFloat4(&ssaoKernel[n], vector);
+		}
+
+		for (UINT n = 0; n < NoiseSize * NoiseSize; ++n)
+		{
+			const double x = (static_cast<double>(std::rand()) / RAND_MAX) * 2 - 1;
+			const double y = (static_cast<double>(std::rand()) / RAND_MAX) * 2 - 1;
+			XMFLOAT4 float4 = XMFLOAT4(x, y, 0, 0);
+			XMVECTOR vector = XMLoadFloat4(&float4);
+			vector = XMVector4Normalize(vector);
+			XMStoreFloat4(&ssaoNoise[n], vector);
+		}
 
 		// Entry 11, Post-processing texture
-		descriptorHandle.Offset(1, DescriptorSize);
+		CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
 		CD3DX12_RESOURCE_DESC texDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, pWindow->GetWindowWidth(), pWindow->GetWindowHeight(), 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS | D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
 		uavDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
 		uavDesc.Texture2D.MipSlice = 0;
 		uavDesc.Texture2D.PlaneSlice = 0;
-		device->CreateCommittedResource(
+		loader.Device->CreateCommittedResource(
 			&defaultHeapProperties,
 			D3D12_HEAP_FLAG_NONE,
 			&texDesc,
 			D3D12_RESOURCE_STATE_RENDER_TARGET,
 			nullptr,
 			IID_PPV_ARGS(&RenderTexture));
-		device->CreateUnorderedAccessView(RenderTexture.Get(), nullptr, &uavDesc, descriptorHandle);
-		device->CreateRenderTargetView(RenderTexture.Get(), nullptr, descriptorHandleRTV);
+		loader.Device->CreateUnorderedAccessView(RenderTexture.Get(), nullptr, &uavDesc, loader.GetDescriptor(11));
+		loader.Device->CreateRenderTargetView(RenderTexture.Get(), nullptr, RTVHeap->GetCPUDescriptorHandleForHeapStart());
 
 		// Entry 13, SSAO sampling kernel
-		descriptorHandle.Offset(2, DescriptorSize);
-		newDesc.Buffer.NumElements = KernelSize;
-		newDesc.Buffer.StructureByteStride = sizeof(XMFLOAT4);
-		UpdateBufferResource(commandList.Get(), &KernelTexture, &intermediateSSAOKernelBuffer, KernelSize, sizeof(XMFLOAT4), ssaoKernel);
-		device->CreateShaderResourceView(KernelTexture.Get(), &newDesc, descriptorHandle);
+		D3D12_SHADER_RESOURCE_VIEW_DESC kernelDesc = {};
+		kernelDesc.Format = DXGI_FORMAT_UNKNOWN;
+		kernelDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+		kernelDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		kernelDesc.Buffer.NumElements = KernelSize;
+		kernelDesc.Buffer.StructureByteStride = sizeof(XMFLOAT4);
+		kernelDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+		loader.CreateBuffer(KernelTexture, KernelSize, sizeof(XMFLOAT4), ssaoKernel);
+		loader.Device->CreateShaderResourceView(KernelTexture.Get(), &kernelDesc, loader.GetDescriptor(13));
 
 		// Entry 14, SSAO random tex
-		descriptorHandle.Offset(1, DescriptorSize);
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = 1;
+		srvDesc.Texture2D.PlaneSlice = 0;
+		srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 		CD3DX12_RESOURCE_DESC ssaoRandomDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT, NoiseSize, NoiseSize, 1, 1);
-		ThrowIfFailed(device->CreateCommittedResource(
+		ThrowIfFailed(loader.Device->CreateCommittedResource(
 			&defaultHeapProperties,
 			D3D12_HEAP_FLAG_NONE,
 			&ssaoRandomDesc,
 			D3D12_RESOURCE_STATE_COMMON,
 			nullptr,
 			IID_PPV_ARGS(&NoiseTexture)));
-		const UINT64 uploadBufferSize = GetRequiredIntermediateSize(NoiseTexture.Get(), 0, 1) + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-		CD3DX12_HEAP_PROPERTIES uploadHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
-		CD3DX12_RESOURCE_DESC uploadBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
-		ThrowIfFailed(device->CreateCommittedResource(
-			&uploadHeapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&uploadBufferDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&intermediateSSAOTexBuffer)));
 		D3D12_SUBRESOURCE_DATA textureData = {};
 		textureData.pData = ssaoNoise;
 		textureData.RowPitch = NoiseSize * sizeof(XMFLOAT4);
 		textureData.SlicePitch = textureData.RowPitch * NoiseSize;
-		UpdateSubresources(commandList.Get(), NoiseTexture.Get(), intermediateSSAOTexBuffer.Get(), 0, 0, 1, &textureData);
-		device->CreateShaderResourceView(NoiseTexture.Get(), &srvDesc, descriptorHandle);
+		loader.UploadTexture(NoiseTexture.Get(), 1, &textureData);
+		loader.Device->CreateShaderResourceView(NoiseTexture.Get(), &srvDesc, loader.GetDescriptor(14));
+	});
 
-		// UAV counter reset (For AliveBuffer1)
-		CD3DX12_RESOURCE_DESC counterBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT));
-		ThrowIfFailed(device->CreateCommittedResource(
+	// Entries 31-40 and 43-50, what the simulate stage, the depth sort and the neighbor grid work in.
+	// Entries 41-42 are the screen tile lists, created with the depth buffer.
+	loader.Graph.Add("SimulateBuffers", [this, &loader]()
+	{
+		// Entry 31, Hi-Z finished group counter, the last group of the dispatch resets it
+		UINT hiZCounter[1] = { 0 };
+		loader.CreateBuffer(HiZCounter, 1, sizeof(UINT), hiZCounter, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = 1;
+		uavDesc.Buffer.StructureByteStride = sizeof(UINT);
+		uavDesc.Buffer.CounterOffsetInBytes = 0;
+		uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+		loader.Device->CreateUnorderedAccessView(HiZCounter.Get(), nullptr, &uavDesc, loader.GetDescriptor(31));
+
+		// Entry 32, Visible particle index buffer, the simulate pass appends particles that survive culling
+		CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(ParticleBufferCounterOffset + sizeof(UINT), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+		ThrowIfFailed(loader.Device->CreateCommittedResource(
+			&defaultHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&VisibleIndexList)));
+		uavDesc.Buffer.NumElements = MaxParticleCount;
+		uavDesc.Buffer.CounterOffsetInBytes = ParticleBufferCounterOffset;
+		loader.Device->CreateUnorderedAccessView(VisibleIndexList.Get(), VisibleIndexList.Get(), &uavDesc, loader.GetDescriptor(32));
+
+		// Entries 33-35, Staged draw list per frame, filled before every draw
+		loader.CreateBuffer(StagedVisibleIndices, MaxParticleCount * Window::BufferCount, sizeof(UINT), nullptr);
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Buffer.NumElements = MaxParticleCount;
+		srvDesc.Buffer.StructureByteStride = sizeof(UINT);
+		srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+		for (UINT frame = 0; frame < Window::BufferCount; frame++)
+		{
+			srvDesc.Buffer.FirstElement = frame * MaxParticleCount;
+			loader.Device->CreateShaderResourceView(StagedVisibleIndices.Get(), &srvDesc, loader.GetDescriptor(33 + frame));
+		}
+
+		// Entries 36-40, Depth sort keys, values, digit histograms, lookback status and counters
+		const UINT sortBufferSizes[5] = { 2 * SortPartitionCount * RADIX_TILE_SIZE, 2 * SortPartitionCount * RADIX_TILE_SIZE,
+			RADIX_PASSES * RADIX_BINS, RADIX_PASSES * SortPartitionCount * RADIX_BINS, 1 + RADIX_PASSES };
+		ComPtr<ID3D12Resource>* sortBuffers[5] = { &SortKeys, &SortValues, &SortHistogram, &SortStatus, &SortCounter };
+		uavDesc.Buffer.CounterOffsetInBytes = 0;
+		for (UINT n = 0; n < _countof(sortBuffers); n++)
+		{
+			loader.CreateBuffer(*sortBuffers[n], sortBufferSizes[n], sizeof(UINT), nullptr, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+			uavDesc.Buffer.NumElements = sortBufferSizes[n];
+			loader.Device->CreateUnorderedAccessView(sortBuffers[n]->Get(), nullptr, &uavDesc, loader.GetDescriptor(36 + n));
+		}
+
+		// Zeroes copied over the digit histograms before every sort
+		CD3DX12_HEAP_PROPERTIES uploadHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
+		CD3DX12_RESOURCE_DESC histogramResetDesc = CD3DX12_RESOURCE_DESC::Buffer(RADIX_PASSES * RADIX_BINS * sizeof(UINT));
+		ThrowIfFailed(loader.Device->CreateCommittedResource(
 			&uploadHeapProperties,
 			D3D12_HEAP_FLAG_NONE,
-			&counterBufferDesc,
+			&histogramResetDesc,
 			D3D12_RESOURCE_STATE_GENERIC_READ,
 			nullptr,
-			IID_PPV_ARGS(&UAVCounterReset)));
+			IID_PPV_ARGS(&SortHistogramReset)));
+		UINT8* pMappedHistogramReset = nullptr;
+		CD3DX12_RANGE histogramReadRange(0, 0);
+		ThrowIfFailed(SortHistogramReset->Map(0, &histogramReadRange, reinterpret_cast<void**>(&pMappedHistogramReset)));
+		ZeroMemory(pMappedHistogramReset, RADIX_PASSES * RADIX_BINS * sizeof(UINT));
+		SortHistogramReset->Unmap(0, nullptr);
+
+		// Entries 43-48, spatial hash cell counts, cell starts, sorted particle indices, scan block sums, particle keys and ranks
+		const UINT hashBufferSizes[6] = { SpatialHashTableSize, SpatialHashTableSize, MaxParticleCount,
+			SpatialHashTableSize / SPATIAL_HASH_SCAN_BLOCK, MaxParticleCount, MaxParticleCount };
+		ComPtr<ID3D12Resource>* hashBuffers[6] = { &HashCellCounts, &HashCellStarts, &HashSortedIndices, &HashBlockSums, &HashParticleKeys, &HashParticleRanks };
+		for (UINT n = 0; n < _countof(hashBuffers); n++)
+		{
+			loader.CreateBuffer(*hashBuffers[n], hashBufferSizes[n], sizeof(UINT), nullptr, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+			uavDesc.Buffer.NumElements = hashBufferSizes[n];
+			loader.Device->CreateUnorderedAccessView(hashBuffers[n]->Get(), nullptr, &uavDesc, loader.GetDescriptor(43 + n));
+		}
 
-		UINT8* pMappedCounterReset = nullptr;
+		// Entries 49-50, SPH density and pressure pairs and fluid accelerations
+		const UINT fluidStrides[2] = { 2 * sizeof(float), 4 * sizeof(float) };
+		ComPtr<ID3D12Resource>* fluidBuffers[2] = { &SPHDensityPressure, &SPHAccelerations };
+		uavDesc.Buffer.NumElements = MaxParticleCount;
+		for (UINT n = 0; n < _countof(fluidBuffers); n++)
+		{
+			loader.CreateBuffer(*fluidBuffers[n], MaxParticleCount, fluidStrides[n], nullptr, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+			uavDesc.Buffer.StructureByteStride = fluidStrides[n];
+			loader.Device->CreateUnorderedAccessView(fluidBuffers[n]->Get(), nullptr, &uavDesc, loader.GetDescriptor(49 + n));
+		}
+	});
+
+	// Entries 59-63, Trail history ring as simulate's UAV and the ribbon pass's SRV. It lives in COMMON so the compute queue can
+	// promote it to a UAV and the direct queue to a shader resource without barriers, both decay back when their list is done.
+	loader.Graph.Add("TrailBuffers", [this, &loader]()
+	{
+		const UINT trailSampleCount = MaxParticleCount * TRAIL_LENGTH;
+		CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+		CD3DX12_RESOURCE_DESC trailHistoryDesc = CD3DX12_RESOURCE_DESC::Buffer(trailSampleCount * sizeof(float4), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		ThrowIfFailed(loader.Device->CreateCommittedResource(
+			&defaultHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&trailHistoryDesc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&TrailHistory)));
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = trailSampleCount;
+		uavDesc.Buffer.StructureByteStride = sizeof(float4);
+		uavDesc.Buffer.CounterOffsetInBytes = 0;
+		uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+		loader.Device->CreateUnorderedAccessView(TrailHistory.Get(), nullptr, &uavDesc, loader.GetDescriptor(59));
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Buffer.NumElements = trailSampleCount;
+		srvDesc.Buffer.StructureByteStride = sizeof(float4);
+		srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+		loader.Device->CreateShaderResourceView(TrailHistory.Get(), &srvDesc, loader.GetDescriptor(60));
+
+		// Entries 61-62, Ribbon vertices and their indirect draw arguments, written by the ribbon pass
+		const UINT trailVertexCount = MaxParticleCount * TRAIL_VERTICES_PER_PARTICLE;
+		loader.CreateBuffer(TrailVertices, trailVertexCount, sizeof(TrailVertex), nullptr, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		uavDesc.Buffer.NumElements = trailVertexCount;
+		uavDesc.Buffer.StructureByteStride = sizeof(TrailVertex);
+		loader.Device->CreateUnorderedAccessView(TrailVertices.Get(), nullptr, &uavDesc, loader.GetDescriptor(61));
+
+		loader.CreateBuffer(TrailDrawArgs, 1, sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), nullptr, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		uavDesc.Buffer.NumElements = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS) / sizeof(UINT);
+		uavDesc.Buffer.StructureByteStride = 0;
+		uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_RAW;
+		loader.Device->CreateUnorderedAccessView(TrailDrawArgs.Get(), nullptr, &uavDesc, loader.GetDescriptor(62));
+
+		// Entry 63, Ribbon vertices for the trail vertex shader
+		srvDesc.Buffer.NumElements = trailVertexCount;
+		srvDesc.Buffer.StructureByteStride = sizeof(TrailVertex);
+		loader.Device->CreateShaderResourceView(TrailVertices.Get(), &srvDesc, loader.GetDescriptor(63));
+
+		// Every trail is stitched the same way, so the index buffer is built once for the largest draw list
+		const std::vector<UINT> trailIndices = BuildTrailIndices(MaxParticleCount);
+		loader.CreateBuffer(TrailIndexBuffer, trailIndices.size(), sizeof(UINT), trailIndices.data(), D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+		TrailIndexBufferView.BufferLocation = TrailIndexBuffer->GetGPUVirtualAddress();
+		TrailIndexBufferView.Format = DXGI_FORMAT_R32_UINT;
+		TrailIndexBufferView.SizeInBytes = static_cast<UINT>(trailIndices.size() * sizeof(UINT));
+	});
+
+	// Entries 64-66, Sub-emitter events, counters and spawn dispatch arguments. The counters start at zero and the args pass
+	// zeroes the append counters every frame, see SubEmitter.hlsli for the layout.
+	loader.Graph.Add("SubEmitterBuffers", [this, &loader]()
+	{
+		loader.CreateBuffer(SubEmitterEvents, SUB_EMITTER_EVENT_TYPES * SUB_EMITTER_MAX_EVENTS, sizeof(SubEmitterEvent), nullptr,
+			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = SUB_EMITTER_EVENT_TYPES * SUB_EMITTER_MAX_EVENTS;
+		uavDesc.Buffer.StructureByteStride = sizeof(SubEmitterEvent);
+		uavDesc.Buffer.CounterOffsetInBytes = 0;
+		uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+		loader.Device->CreateUnorderedAccessView(SubEmitterEvents.Get(), nullptr, &uavDesc, loader.GetDescriptor(64));
+
+		const UINT subEmitterCounters[SUB_EMITTER_COUNTER_COUNT] = {};
+		loader.CreateBuffer(SubEmitterCounters, SUB_EMITTER_COUNTER_COUNT, sizeof(UINT), subEmitterCounters, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		uavDesc.Buffer.NumElements = SUB_EMITTER_COUNTER_COUNT;
+		uavDesc.Buffer.StructureByteStride = 0;
+		uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_RAW;
+		loader.Device->CreateUnorderedAccessView(SubEmitterCounters.Get(), nullptr, &uavDesc, loader.GetDescriptor(65));
+
+		loader.CreateBuffer(SubEmitterDispatchArgs, 1, sizeof(D3D12_DISPATCH_ARGUMENTS), nullptr, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		uavDesc.Buffer.NumElements = sizeof(D3D12_DISPATCH_ARGUMENTS) / sizeof(UINT);
+		loader.Device->CreateUnorderedAccessView(SubEmitterDispatchArgs.Get(), nullptr, &uavDesc, loader.GetDescriptor(66));
+	});
+
+	// Upload buffers written every frame, left mapped
+	loader.Graph.Add("FrameUploadBuffers", [this, &loader]()
+	{
+		CD3DX12_HEAP_PROPERTIES uploadHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
 		CD3DX12_RANGE readRange(0, 0);
-		ThrowIfFailed(UAVCounterReset->Map(0, &readRange, reinterpret_cast<void**>(&pMappedCounterReset)));
+		auto createMapped = [&loader, &uploadHeapProperties, &readRange](UINT64 size, ComPtr<ID3D12Resource>& buffer, UINT8** mappedData)
+		{
+			CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+			ThrowIfFailed(loader.Device->CreateCommittedResource(
+				&uploadHeapProperties,
+				D3D12_HEAP_FLAG_NONE,
+				&bufferDesc,
+				D3D12_RESOURCE_STATE_GENERIC_READ,
+				nullptr,
+				IID_PPV_ARGS(&buffer)));
+			ThrowIfFailed(buffer->Map(0, &readRange, reinterpret_cast<void**>(mappedData)));
+		};
+
+		// CPU backend upload ring, particles followed by the draw list for each frame
+		createMapped(static_cast<UINT64>(CPUUploadStride) * Window::BufferCount, CPUUploadBuffer, &MappedCPUUpload);
+
+		// Culling, collision, force field, turbulence and vector field constants per frame
+		createMapped(CullConstantsStride * Window::BufferCount, CullConstantBuffer, &MappedCullConstants);
+		createMapped(CollisionConstantsStride * Window::BufferCount, CollisionConstantBuffer, &MappedCollisionConstants);
+		createMapped(ForceFieldBufferStride * Window::BufferCount, ForceFieldBuffer, &MappedForceFields);
+		createMapped(CurlNoiseConstantsStride * Window::BufferCount, CurlNoiseConstantBuffer, &MappedCurlNoiseConstants);
+		createMapped(VectorFieldConstantsStride * Window::BufferCount, VectorFieldConstantBuffer, &MappedVectorFieldConstants);
+
+		// UAV counter reset (For AliveBuffer1)
+		UINT8* pMappedCounterReset = nullptr;
+		createMapped(sizeof(UINT), UAVCounterReset, &pMappedCounterReset);
 		ZeroMemory(pMappedCounterReset, sizeof(UINT));
 		UAVCounterReset->Unmap(0, nullptr);
+	});
+}
+
+void ParticleGame::CreateVolumeTasks(ContentLoader& loader)
+{
+	// Entry 53, Curl noise turbulence volume, loaded from the cache or baked
+	loader.Graph.Add("CurlNoise", [this, &loader]()
+	{
+		CurlNoiseVolume curlNoise = LoadOrBakeCurlNoise(loader.AssetPath + L"CurlNoise.cache", CurlNoiseSettings(), CPUThreadPool);
+
+		CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+		CD3DX12_RESOURCE_DESC curlNoiseDesc = CD3DX12_RESOURCE_DESC::Tex3D(DXGI_FORMAT_R32G32B32A32_FLOAT, curlNoise.Size, curlNoise.Size, static_cast<UINT16>(curlNoise.Size), 1);
+		ThrowIfFailed(loader.Device->CreateCommittedResource(
+			&defaultHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&curlNoiseDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&CurlNoiseTexture)));
+		D3D12_SUBRESOURCE_DATA curlNoiseData = {};
+		curlNoiseData.pData = curlNoise.Texels.data();
+		curlNoiseData.RowPitch = curlNoise.Size * sizeof(float4);
+		curlNoiseData.SlicePitch = curlNoiseData.RowPitch * curlNoise.Size;
+		loader.UploadTexture(CurlNoiseTexture.Get(), 1, &curlNoiseData, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC curlNoiseSRVDesc = {};
+		curlNoiseSRVDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		curlNoiseSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+		curlNoiseSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		curlNoiseSRVDesc.Texture3D.MipLevels = 1;
+		loader.Device->CreateShaderResourceView(CurlNoiseTexture.Get(), &curlNoiseSRVDesc, loader.GetDescriptor(53));
+
+		CPUParticleSystem.SetCurlNoise(curlNoise);
+	});
+
+	// Entries 54 - 57, Imported vector fields. WindField_0000.fga plays back with the numbered files after it at 30 frames per second,
+	// a lone WindField.fga stays static. Slots without a field get null descriptors.
+	loader.Graph.Add("VectorFields", [this, &loader]()
+	{
+		std::vector<std::filesystem::path> windFrames = VectorFieldStream::FindSequence(loader.AssetPath + L"WindField_0000.fga");
+		if (windFrames.empty())
+		{
+			windFrames = VectorFieldStream::FindSequence(loader.AssetPath + L"WindField.fga");
+		}
+		if (!windFrames.empty())
+		{
+			VectorFieldSlots[0].Stream = std::make_unique<VectorFieldStream>(windFrames, 30.0f);
+		}
+
+		// Field space to world, the wind volume is centered in the room
+		const XMMATRIX fieldToWorld[VECTOR_FIELD_MAX_COUNT] = { XMMatrixTranslation(0.0f, 5.0f, 0.0f), XMMatrixIdentity(), XMMatrixIdentity(), XMMatrixIdentity() };
+		const float fieldStrength[VECTOR_FIELD_MAX_COUNT] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC vectorFieldSRVDesc = {};
+		vectorFieldSRVDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		vectorFieldSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+		vectorFieldSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		vectorFieldSRVDesc.Texture3D.MipLevels = 1;
+
+		CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+		for (UINT n = 0; n < VECTOR_FIELD_MAX_COUNT; n++)
+		{
+			if (!VectorFieldSlots[n].Stream || !VectorFieldSlots[n].Stream->Valid())
+			{
+				VectorFieldSlots[n].Stream.reset();
+				continue;
+			}
+
+			// Filled slots are packed to the front, so the shader loop can stop at the count
+			VectorFieldSlot& slot = VectorFieldSlots[VectorFieldSlotCount];
+			if (VectorFieldSlotCount != n)
+			{
+				slot = std::move(VectorFieldSlots[n]);
+			}
+			const VectorFieldVolume& volume = slot.Stream->Current();
+			VectorFieldInstance& instance = FrameVectorFieldConstants.Fields[VectorFieldSlotCount++];
+			const float3 size = volume.BoundsMax - volume.BoundsMin;
+			const XMMATRIX worldToVolume = XMMatrixInverse(nullptr, fieldToWorld[n]) *
+				XMMatrixTranslation(-volume.BoundsMin.x, -volume.BoundsMin.y, -volume.BoundsMin.z) * XMMatrixScaling(1.0f / size.x, 1.0f / size.y, 1.0f / size.z);
+			XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&instance.WorldToVolume), worldToVolume);
+			instance.Strength = fieldStrength[n];
+			instance.Tightness = 0.0f;
+
+			CD3DX12_RESOURCE_DESC vectorFieldDesc = CD3DX12_RESOURCE_DESC::Tex3D(DXGI_FORMAT_R32G32B32A32_FLOAT,
+				volume.Resolution[0], volume.Resolution[1], static_cast<UINT16>(volume.Resolution[2]), 1);
+			ThrowIfFailed(loader.Device->CreateCommittedResource(
+				&defaultHeapProperties,
+				D3D12_HEAP_FLAG_NONE,
+				&vectorFieldDesc,
+				D3D12_RESOURCE_STATE_COPY_DEST,
+				nullptr,
+				IID_PPV_ARGS(&slot.Texture)));
+			D3D12_SUBRESOURCE_DATA vectorFieldData = {};
+			vectorFieldData.pData = volume.Texels.data();
+			vectorFieldData.RowPitch = volume.Resolution[0] * sizeof(float4);
+			vectorFieldData.SlicePitch = vectorFieldData.RowPitch * volume.Resolution[1];
+			loader.UploadTexture(slot.Texture.Get(), 1, &vectorFieldData, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			loader.Device->CreateShaderResourceView(slot.Texture.Get(), &vectorFieldSRVDesc, loader.GetDescriptor(54 + VectorFieldSlotCount - 1));
+			CPUParticleSystem.SetVectorField(VectorFieldSlotCount - 1, &volume);
+
+			// Animated slots get a place in every slice of the upload ring
+			if (slot.Stream->GetFrameCount() > 1)
+			{
+				UINT64 totalBytes = 0;
+				loader.Device->GetCopyableFootprints(&vectorFieldDesc, 0, 1, VectorFieldUploadStride, &slot.Footprint, &slot.RowCount, &slot.RowSize, &totalBytes);
+				VectorFieldUploadStride = (VectorFieldUploadStride + totalBytes + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~UINT64(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+			}
+			slot.TextureStale = false;
+		}
+		for (UINT n = VectorFieldSlotCount; n < VECTOR_FIELD_MAX_COUNT; n++)
+		{
+			loader.Device->CreateShaderResourceView(nullptr, &vectorFieldSRVDesc, loader.GetDescriptor(54 + n));
+		}
+
+		if (VectorFieldUploadStride > 0)
+		{
+			CD3DX12_HEAP_PROPERTIES uploadHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
+			CD3DX12_RESOURCE_DESC ringDesc = CD3DX12_RESOURCE_DESC::Buffer(VectorFieldUploadStride * Window::BufferCount);
+			ThrowIfFailed(loader.Device->CreateCommittedResource(
+				&uploadHeapProperties,
+				D3D12_HEAP_FLAG_NONE,
+				&ringDesc,
+				D3D12_RESOURCE_STATE_GENERIC_READ,
+				nullptr,
+				IID_PPV_ARGS(&VectorFieldUpload)));
+			CD3DX12_RANGE ringReadRange(0, 0);
+			ThrowIfFailed(VectorFieldUpload->Map(0, &ringReadRange, reinterpret_cast<void**>(&MappedVectorFieldUpload)));
+		}
+	});
+
+	// Entry 58, Curve atlas, one Texture1DArray slice per curve of every curve set
+	loader.Graph.Add("CurveAtlas", [this, &loader]()
+	{
+		const CurveAtlas curveAtlas = BakeCurveAtlas(EmitterCurveSets());
+
+		CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+		CD3DX12_RESOURCE_DESC curveAtlasDesc = CD3DX12_RESOURCE_DESC::Tex1D(DXGI_FORMAT_R32G32B32A32_FLOAT, CURVE_ATLAS_WIDTH, static_cast<UINT16>(curveAtlas.SliceCount), 1);
+		ThrowIfFailed(loader.Device->CreateCommittedResource(
+			&defaultHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&curveAtlasDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&CurveAtlasTexture)));
+		std::vector<D3D12_SUBRESOURCE_DATA> curveAtlasData(curveAtlas.SliceCount);
+		for (UINT n = 0; n < curveAtlas.SliceCount; n++)
+		{
+			curveAtlasData[n].pData = &curveAtlas.Texels[n * CURVE_ATLAS_WIDTH];
+			curveAtlasData[n].RowPitch = CURVE_ATLAS_WIDTH * sizeof(float4);
+			curveAtlasData[n].SlicePitch = curveAtlasData[n].RowPitch;
+		}
+		loader.UploadTexture(CurveAtlasTexture.Get(), curveAtlas.SliceCount, curveAtlasData.data(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC curveAtlasSRVDesc = {};
+		curveAtlasSRVDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		curveAtlasSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE1DARRAY;
+		curveAtlasSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		curveAtlasSRVDesc.Texture1DArray.MipLevels = 1;
+		curveAtlasSRVDesc.Texture1DArray.ArraySize = curveAtlas.SliceCount;
+		loader.Device->CreateShaderResourceView(CurveAtlasTexture.Get(), &curveAtlasSRVDesc, loader.GetDescriptor(58));
+
+		CPUParticleSystem.SetCurveAtlas(curveAtlas);
+	});
+}
+
+void ParticleGame::RunContentLoader(ContentLoader& loader)
+{
+	// The critical path is the chain of tasks nothing but a shorter one of them speeds up
+	TaskGraph& graph = loader.Graph;
+	graph.Run();
+
+	double criticalPathMilliseconds;
+	std::string criticalPath;
+	for (TaskGraph::Task task : graph.GetCriticalPath(criticalPathMilliseconds))
+	{
+		criticalPath += (criticalPath.empty() ? "" : " > ") + graph.GetName(task);
+	}
+	char buffer[512];
+	sprintf_s(buffer, "Load: %u tasks in %.1f ms on %u threads, %.1f ms of work, critical path %.1f ms: ", static_cast<UINT>(graph.GetTaskCount()),
+		graph.GetWallMilliseconds(), std::thread::hardware_concurrency(), graph.GetSerialMilliseconds(), criticalPathMilliseconds);
+	OutputDebugStringA((buffer + criticalPath + "\n").c_str());
+
+	// Whenever a pipeline was created the cache is written anew with exactly this run's pipelines
+	if (loader.CreatedPipelineCount > 0)
+	{
+		// Identical pipelines share a name, storing the second one fails and the first serves both
+		ComPtr<ID3D12PipelineLibrary1> library;
+		if (SUCCEEDED(loader.Device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library))))
+		{
+			for (const std::pair<std::wstring, ID3D12PipelineState*>& pipeline : loader.Pipelines)
+			{
+				library->StorePipeline(pipeline.first.c_str(), pipeline.second);
+			}
+			std::vector<uint8_t> data(library->GetSerializedSize());
+			if (FAILED(library->Serialize(data.data(), data.size())) || !SavePipelineCache(loader.PipelineCachePath, data.data(), data.size()))
+			{
+				OutputDebugStringA("Pipeline cache: can't write PipelineCache.bin\n");
+			}
+		}
+	}
+
+	sprintf_s(buffer, "Pipelines: %u, %u created and %u loaded from PipelineCache.bin\n", static_cast<UINT>(loader.Pipelines.size()),
+		loader.CreatedPipelineCount, static_cast<UINT>(loader.Pipelines.size()) - loader.CreatedPipelineCount);
+	OutputDebugStringA(buffer);
+}
+
+bool ParticleGame::LoadContent()
+{
+	auto device = Application::Get().GetDevice();
+
+	// Create descriptor heaps
+	{
+		DSVHeap = Application::Get().CreateDescriptorHeap(2, D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+		DescriptorHeap = Application::Get().CreateDescriptorHeap(61 + 4 * Window::BufferCount, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE);
+		RTVHeap = Application::Get().CreateDescriptorHeap(1, D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+	}
+
+	DescriptorSize = Application::Get().GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	DescriptorSizeRTV = Application::Get().GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+	DescriptorSizeDSV = Application::Get().GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+
+	// Get path to .exe directory (where .cso files are)
+	WCHAR assetsPath[512];
+	GetModuleFileNameW(nullptr, assetsPath, _countof(assetsPath));
+	std::wstring assetPathString = assetsPath;
+	assetPathString = assetPathString.substr(0, assetPathString.find_last_of(L"\\") + 1);
+
+	SnapshotPath = assetPathString + L"Snapshot.bin";
+
+	// Root signatures, shader reads, PSOs, authored texture builds, buffers and volumes are tasks of loader, which runs once the
+	// last one is added. Each task waits for the ones it reads the results of and nothing else, the device creates from any thread.
+	auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	ContentLoader loader(device, assetPathString, DescriptorHeap.Get(), DescriptorSize);
+	loader.CommandList = commandQueue->GetCommandList();
+	CreateRootSignatureTasks(loader);
+	CreateTextureTasks(loader);
+	CreateEmitterTasks(loader);
+	CreateRenderPSOTasks(loader);
+	CreateComputePSOTasks(loader);
+	CreateBufferTasks(loader);
+	CreateVolumeTasks(loader);
+
+	// Create indirect particle draw signature, the simulate pass writes the instance count
+	{
+		D3D12_INDIRECT_ARGUMENT_DESC drawArgument = {};
+		drawArgument.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+		D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc = {};
+		commandSignatureDesc.ByteStride = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+		commandSignatureDesc.NumArgumentDescs = 1;
+		commandSignatureDesc.pArgumentDescs = &drawArgument;
+		ThrowIfFailed(device->CreateCommandSignature(&commandSignatureDesc, nullptr, IID_PPV_ARGS(&DrawCommandSignature)));
+	}
+
+	// Create indirect sub-emitter spawn signature, ComputeGenerateArgs.hlsl writes the group count
+	{
+		D3D12_INDIRECT_ARGUMENT_DESC dispatchArgument = {};
+		dispatchArgument.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+
+		D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc = {};
+		commandSignatureDesc.ByteStride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+		commandSignatureDesc.NumArgumentDescs = 1;
+		commandSignatureDesc.pArgumentDescs = &dispatchArgument;
+		ThrowIfFailed(device->CreateCommandSignature(&commandSignatureDesc, nullptr, IID_PPV_ARGS(&DispatchCommandSignature)));
+	}
+
+	// Every task added above runs now
+	RunContentLoader(loader);
+
+	// The active emitter is looked up in the atlas, both are there now
+	if (loader.EmittersLoaded)
+	{
+		ApplyActiveEmitter();
+	}
+
+	// Entries 8-9, unused since the particle and planes textures stream in through per frame entries, see UpdateTextureStreaming.
+	// Null views keep the entries after them where they are.
+	D3D12_SHADER_RESOURCE_VIEW_DESC nullTextureDesc = {};
+	nullTextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	nullTextureDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	nullTextureDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	nullTextureDesc.Texture2D.MipLevels = 1;
+
+	TilesTexture.Request = Streamer.Request(loader.ParticleTexturePath, 2.0f);
+	TilesTexture.BaseMip = 0;
+	TilesTexture.FrameDescriptors = 67;
+	TilesTexture.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+	device->CreateShaderResourceView(nullptr, &nullTextureDesc, loader.GetDescriptor(8));
+
+	WallTexture.Request = Streamer.Request(assetPathString + L"bathroomtile.dds", 1.0f);
+	WallTexture.BaseMip = 0;
+	WallTexture.FrameDescriptors = 67 + Window::BufferCount;
+	WallTexture.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	device->CreateShaderResourceView(nullptr, &nullTextureDesc, loader.GetDescriptor(9));
+
+	// Entries 67-72, Per-frame views of the particle atlas and planes texture, null until their first mip lands
+	for (const StreamedTexture* texture : { &TilesTexture, &WallTexture })
+	{
+		nullTextureDesc.ViewDimension = texture->ViewDimension;
+		if (texture->ViewDimension == D3D12_SRV_DIMENSION_TEXTURE2DARRAY)
+		{
+			nullTextureDesc.Texture2DArray = {};
+			nullTextureDesc.Texture2DArray.MipLevels = 1;
+			nullTextureDesc.Texture2DArray.ArraySize = 1;
+		}
+		else
+		{
+			nullTextureDesc.Texture2D = {};
+			nullTextureDesc.Texture2D.MipLevels = 1;
+		}
+		for (UINT frame = 0; frame < Window::BufferCount; frame++)
+		{
+			device->CreateShaderResourceView(nullptr, &nullTextureDesc, loader.GetDescriptor(texture->FrameDescriptors + frame));
+		}
 	}
 
-	auto fenceValue = commandQueue->ExecuteCommandList(commandList);
+	auto fenceValue = commandQueue->ExecuteCommandList(loader.CommandList);
 	commandQueue->WaitForFenceValue(fenceValue);
 
 	ContentLoaded = true;
 
+	// A saved snapshot is the state someone chose to start from, pre-warming only runs without one
+	if (!(std::filesystem::exists(SnapshotPath) && RestoreSnapshot()) && PrewarmLifetimes > 0.0f)
+	{
+		PrewarmPool();
+	}
+
 	ResizeDepthBuffer(GetWindowWidth(), GetWindowHeight());
+	ResizeSSAOTextures(GetWindowWidth(), GetWindowHeight());
 	PPRootConstants.windowWidth = GetWindowWidth();
 	PPRootConstants.windowHeight = GetWindowHeight();
+	BlurRootConstants.windowWidth = GetWindowWidth();
+	BlurRootConstants.windowHeight = GetWindowHeight();
 
 	return true;
 }
@@ -751,7 +2125,295 @@ void ParticleGame::ResizeDepthBuffer(int width, int height)
 		srvDesc.Texture2D.MostDetailedMip = 0;
 		srvDesc.Texture2D.PlaneSlice = 0;
 		device->CreateShaderResourceView(DepthBuffer.Get(), &srvDesc, descriptorHandle);
+
+		// Hi-Z pyramid, kept in NON_PIXEL_SHADER_RESOURCE outside of its own dispatch
+		HiZRootConstants.depthWidth = width;
+		HiZRootConstants.depthHeight = height;
+		HiZRootConstants.mipCount = HiZMipCount(width, height);
+		HiZRootConstants.groupCount = ((width + HiZTileSize - 1) / HiZTileSize) * ((height + HiZTileSize - 1) / HiZTileSize);
+		HiZBuilt = false;
+
+		CD3DX12_RESOURCE_DESC hiZDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32G32_FLOAT, width, height, 1, HiZRootConstants.mipCount, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&defaultHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&hiZDesc,
+			D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+			nullptr,
+			IID_PPV_ARGS(&HiZTexture)
+		));
+
+		// Entry 17, Hi-Z pyramid with all mips
+		descriptorHandle.Offset(5, DescriptorSize);
+		srvDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+		srvDesc.Texture2D.MipLevels = HiZRootConstants.mipCount;
+		device->CreateShaderResourceView(HiZTexture.Get(), &srvDesc, descriptorHandle);
+
+		// Entries 18-30, one UAV per Hi-Z mip, unused mips get null views
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+		uavDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+		uavDesc.Texture2D.PlaneSlice = 0;
+		for (UINT mip = 0; mip < HIZ_MAX_MIPS; ++mip)
+		{
+			descriptorHandle.Offset(1, DescriptorSize);
+			uavDesc.Texture2D.MipSlice = mip < HiZRootConstants.mipCount ? mip : 0;
+			device->CreateUnorderedAccessView(mip < HiZRootConstants.mipCount ? HiZTexture.Get() : nullptr, nullptr, &uavDesc, descriptorHandle);
+		}
+
+		// Screen tile lists of the tiled rasterizer, committed buffers start zeroed so the counts need no clear
+		FrameRasterConstants.Dimensions = uint2(width, height);
+		FrameRasterConstants.TileCount = uint2((width + TILE_RASTER_SIZE - 1) / TILE_RASTER_SIZE, (height + TILE_RASTER_SIZE - 1) / TILE_RASTER_SIZE);
+		const UINT tileCount = FrameRasterConstants.TileCount.x * FrameRasterConstants.TileCount.y;
+
+		CD3DX12_RESOURCE_DESC tileListsDesc = CD3DX12_RESOURCE_DESC::Buffer(TileListSize(tileCount) * sizeof(UINT), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&defaultHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&tileListsDesc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&TileLists)
+		));
+		CD3DX12_RESOURCE_DESC tileEntriesDesc = CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(tileCount) * TILE_RASTER_MAX_ENTRIES * sizeof(UINT), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&defaultHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&tileEntriesDesc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&TileEntries)
+		));
+
+		// Entries 41-42, tile lists and tile entries
+		descriptorHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(DescriptorHeap->GetCPUDescriptorHandleForHeapStart(), 41, DescriptorSize);
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = TileListSize(tileCount);
+		uavDesc.Buffer.StructureByteStride = sizeof(UINT);
+		uavDesc.Buffer.CounterOffsetInBytes = 0;
+		uavDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+		device->CreateUnorderedAccessView(TileLists.Get(), nullptr, &uavDesc, descriptorHandle);
+
+		descriptorHandle.Offset(1, DescriptorSize);
+		uavDesc.Buffer.NumElements = tileCount * TILE_RASTER_MAX_ENTRIES;
+		device->CreateUnorderedAccessView(TileEntries.Get(), nullptr, &uavDesc, descriptorHandle);
+	}
+}
+
+void ParticleGame::ResizeSSAOTextures(int width, int height)
+{
+	if (ContentLoaded)
+	{
+		width = max(1, width);
+		height = max(1, height);
+
+		auto device = Application::Get().GetDevice();
+
+		CD3DX12_RESOURCE_DESC texDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT, width, height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+		CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&defaultHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&texDesc,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			nullptr,
+			IID_PPV_ARGS(&AOTexture)));
+		ThrowIfFailed(device->CreateCommittedResource(
+			&defaultHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&texDesc,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			nullptr,
+			IID_PPV_ARGS(&AOBlurTexture)));
+
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+		uavDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+		uavDesc.Texture2D.MipSlice = 0;
+		uavDesc.Texture2D.PlaneSlice = 0;
+
+		// Entry 15, raw SSAO occlusion
+		CD3DX12_CPU_DESCRIPTOR_HANDLE descriptorHandle(DescriptorHeap->GetCPUDescriptorHandleForHeapStart(), 15, DescriptorSize);
+		device->CreateUnorderedAccessView(AOTexture.Get(), nullptr, &uavDesc, descriptorHandle);
+
+		// Entry 16, horizontally blurred occlusion
+		descriptorHandle.Offset(1, DescriptorSize);
+		device->CreateUnorderedAccessView(AOBlurTexture.Get(), nullptr, &uavDesc, descriptorHandle);
+	}
+}
+
+void ParticleGame::ApplyActiveEmitter()
+{
+	// Emitter settings reach the GPU as root constants recorded into each frame's command lists,
+	// so frames in flight keep what they were recorded with and the next frame picks up the new record without a flush
+	if (ActiveEmitter >= Emitters.GetCount())
+	{
+		return;
+	}
+	const EmitterRecord& record = Emitters.Get(ActiveEmitter);
+	ApplyEmitterRecord(record, CSRootConstants);
+	EmitterCurveSet = record.CurveSet;
+
+	size_t atlasEntry = record.Texture[0] ? FindParticleAtlasEntry(AtlasEntries, record.Texture) : 0;
+	if (atlasEntry == AtlasEntries.size())
+	{
+		char buffer[512];
+		sprintf_s(buffer, "Emitter %s: no particle texture %s in the atlas\n", record.Name, record.Texture);
+		OutputDebugStringA(buffer);
+		atlasEntry = 0;
+	}
+	AtlasConstants = MakeParticleAtlasConstants(AtlasEntries[atlasEntry], record.ParticleLifetime);
+
+	char buffer[512];
+	sprintf_s(buffer, "Emitter: %s (%u of %u)\n", record.Name, ActiveEmitter + 1, Emitters.GetCount());
+	OutputDebugStringA(buffer);
+}
+
+bool ParticleGame::SaveSnapshot()
+{
+	const ParticleSnapshotLayout layout = GetParticleSnapshotLayout(MaxParticleCount);
+	std::vector<uint8_t> image(layout.Size);
+	if (UseCompute)
+	{
+		// The pool lives in the GPU buffers, copied into a readback buffer laid out like the image once every frame in flight is done with them
+		Application::Get().Flush();
+
+		auto device = Application::Get().GetDevice();
+		auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+		auto commandList = commandQueue->GetCommandList();
+
+		ComPtr<ID3D12Resource> readback;
+		CD3DX12_HEAP_PROPERTIES readbackHeapProperties(D3D12_HEAP_TYPE_READBACK);
+		CD3DX12_RESOURCE_DESC readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(layout.Size);
+		ThrowIfFailed(device->CreateCommittedResource(
+			&readbackHeapProperties,
+			D3D12_HEAP_FLAG_NONE,
+			&readbackDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&readback)));
+
+		// Buffers decay to common between frames, the copies promote them. Between frames the alive list is AliveIndexList0.
+		commandList->CopyBufferRegion(readback.Get(), layout.Particles, ParticleBuffer.Get(), 0, sizeof(Particle) * MaxParticleCount);
+		commandList->CopyBufferRegion(readback.Get(), layout.AliveIndices, AliveIndexList0.Get(), 0, sizeof(UINT) * MaxParticleCount);
+		commandList->CopyBufferRegion(readback.Get(), layout.DeadIndices, DeadIndexList.Get(), 0, sizeof(UINT) * MaxParticleCount);
+		commandList->CopyBufferRegion(readback.Get(), offsetof(ParticleSnapshotHeader, AliveCount), AliveIndexList0.Get(), ParticleBufferCounterOffset, sizeof(UINT));
+		commandList->CopyBufferRegion(readback.Get(), offsetof(ParticleSnapshotHeader, DeadCount), DeadIndexListCounter.Get(), 0, sizeof(UINT));
+		commandQueue->WaitForFenceValue(commandQueue->ExecuteCommandList(commandList));
+
+		UINT8* pMappedReadback = nullptr;
+		CD3DX12_RANGE readRange(0, layout.Size);
+		ThrowIfFailed(readback->Map(0, &readRange, reinterpret_cast<void**>(&pMappedReadback)));
+		memcpy(image.data(), pMappedReadback, layout.Size);
+		CD3DX12_RANGE writeRange(0, 0);
+		readback->Unmap(0, &writeRange);
+
+		// The GPU only filled in the counts, the rest of the header is the same for every snapshot of this pool
+		ParticleSnapshotHeader* header = reinterpret_cast<ParticleSnapshotHeader*>(image.data());
+		*header = MakeParticleSnapshotHeader(MaxParticleCount, header->AliveCount, header->DeadCount);
+	}
+	else
+	{
+		CPUParticleSystem.WriteSnapshot(image.data());
+	}
+
+	const ParticleSnapshotHeader* header = reinterpret_cast<const ParticleSnapshotHeader*>(image.data());
+	const bool saved = SaveParticleSnapshot(SnapshotPath, image.data(), image.size(), SnapshotCompression);
+	char buffer[512];
+	sprintf_s(buffer, saved ? "Snapshot saved: %u alive, %ju bytes\n" : "Snapshot save failed: %u alive, %ju bytes\n", header->AliveCount,
+		saved ? static_cast<uintmax_t>(std::filesystem::file_size(SnapshotPath)) : uintmax_t(0));
+	OutputDebugStringA(buffer);
+	return saved;
+}
+
+bool ParticleGame::RestoreSnapshot()
+{
+	// The CPU pool validates every index before taking the snapshot, the GPU only gets snapshots it accepted
+	const ParticleSnapshotLayout layout = GetParticleSnapshotLayout(MaxParticleCount);
+	std::vector<uint8_t> image(layout.Size);
+	ParticleSnapshotView snapshot;
+	if (!LoadParticleSnapshot(SnapshotPath, image.data(), MaxParticleCount) || !ParseParticleSnapshot(image.data(), image.size(), snapshot) ||
+		!CPUParticleSystem.RestoreSnapshot(snapshot))
+	{
+		OutputDebugStringA("Snapshot restore failed, Snapshot.bin is missing, damaged or of a pool with another size\n");
+		return false;
 	}
+
+	UploadSnapshot(image);
+
+	char buffer[512];
+	sprintf_s(buffer, "Snapshot restored: %u alive\n", snapshot.Header->AliveCount);
+	OutputDebugStringA(buffer);
+	return true;
+}
+
+void ParticleGame::UploadSnapshot(const std::vector<uint8_t>& image)
+{
+	// Frames in flight still read and write the pool
+	Application::Get().Flush();
+
+	const ParticleSnapshotLayout layout = GetParticleSnapshotLayout(MaxParticleCount);
+	auto device = Application::Get().GetDevice();
+	auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	auto commandList = commandQueue->GetCommandList();
+
+	// One copy of the whole image into the upload buffer, the GPU copies every section and both counters out of it
+	ComPtr<ID3D12Resource> upload;
+	CD3DX12_HEAP_PROPERTIES uploadHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC uploadDesc = CD3DX12_RESOURCE_DESC::Buffer(layout.Size);
+	ThrowIfFailed(device->CreateCommittedResource(
+		&uploadHeapProperties,
+		D3D12_HEAP_FLAG_NONE,
+		&uploadDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&upload)));
+	UINT8* pMappedUpload = nullptr;
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(upload->Map(0, &readRange, reinterpret_cast<void**>(&pMappedUpload)));
+	memcpy(pMappedUpload, image.data(), layout.Size);
+	upload->Unmap(0, nullptr);
+
+	commandList->CopyBufferRegion(ParticleBuffer.Get(), 0, upload.Get(), layout.Particles, sizeof(Particle) * MaxParticleCount);
+	commandList->CopyBufferRegion(AliveIndexList0.Get(), 0, upload.Get(), layout.AliveIndices, sizeof(UINT) * MaxParticleCount);
+	commandList->CopyBufferRegion(DeadIndexList.Get(), 0, upload.Get(), layout.DeadIndices, sizeof(UINT) * MaxParticleCount);
+	commandList->CopyBufferRegion(AliveIndexList0.Get(), ParticleBufferCounterOffset, upload.Get(), offsetof(ParticleSnapshotHeader, AliveCount), sizeof(UINT));
+	commandList->CopyBufferRegion(DeadIndexListCounter.Get(), 0, upload.Get(), offsetof(ParticleSnapshotHeader, DeadCount), sizeof(UINT));
+	commandQueue->WaitForFenceValue(commandQueue->ExecuteCommandList(commandList));
+
+	// The trail history belongs to the particles that were replaced
+	TrailRestart = true;
+}
+
+void ParticleGame::PrewarmPool()
+{
+	// The settings the first frame will simulate with, minus the passes that don't change where particles end up
+	EmitterConstants emitter = CSRootConstants;
+	emitter.curveSet = UseParticleCurves ? EmitterCurveSet : CURVE_SET_NONE;
+	CollisionConstants collision = FrameCollisionConstants;
+	collision.Enabled = UseCollision;
+	collision.KillOnHit = CollisionKillOnHit;
+	collision.DepthEnabled = 0;
+	CurlNoiseConstants turbulence = FrameCurlNoiseConstants;
+	turbulence.Enabled = UseCurlNoise;
+	VectorFieldConstants vectorFields = FrameVectorFieldConstants;
+	vectorFields.Count = UseVectorFields ? VectorFieldSlotCount : 0;
+	static const std::vector<ForceField> noForceFields;
+
+	HighResolutionClock clock;
+	const float seconds = PrewarmLifetimes * emitter.particleLifetime;
+	CPUParticleSystem.Prewarm(emitter, seconds, PrewarmStepTime, PrewarmFrameTime, collision, UseForceFields ? ForceFields : noForceFields, turbulence, vectorFields);
+
+	std::vector<uint8_t> image(GetParticleSnapshotLayout(MaxParticleCount).Size);
+	CPUParticleSystem.WriteSnapshot(image.data());
+	UploadSnapshot(image);
+	clock.Tick();
+
+	char buffer[512];
+	sprintf_s(buffer, "Pre-warmed %.1f s in %.1f ms: %u alive\n", seconds, clock.GetDeltaMilliseconds(), CPUParticleSystem.GetAliveCount());
+	OutputDebugStringA(buffer);
 }
 
 void ParticleGame::OnResize(ResizeEventArgs& e)
@@ -794,6 +2456,10 @@ void ParticleGame::OnResize(ResizeEventArgs& e)
 
 			PPRootConstants.windowWidth = e.Width;
 			PPRootConstants.windowHeight = e.Height;
+
+			ResizeSSAOTextures(e.Width, e.Height);
+			BlurRootConstants.windowWidth = e.Width;
+			BlurRootConstants.windowHeight = e.Height;
 		}
 	}
 }
@@ -821,6 +2487,25 @@ void ParticleGame::OnUpdate(UpdateEventArgs& e)
 		frameCount = 0;
 		totalTime = 0.0;
 	}
+
+	// Edits to Emitters.json take effect on the next frame. The active emitter is found again by name in case the list was reordered.
+	EmitterPollTimer += deltaTime;
+	if (EmitterPollTimer >= EmitterPollInterval)
+	{
+		EmitterPollTimer = 0.0f;
+		const std::string activeName = ActiveEmitter < Emitters.GetCount() ? Emitters.Get(ActiveEmitter).Name : "";
+		std::string error;
+		if (Emitters.Poll(error))
+		{
+			const UINT index = Emitters.Find(activeName);
+			ActiveEmitter = index < Emitters.GetCount() ? index : 0;
+			ApplyActiveEmitter();
+		}
+		else if (!error.empty())
+		{
+			OutputDebugStringA(("Emitter library: " + error + "\n").c_str());
+		}
+	}
 	
 	// Update constant info
 	{
@@ -834,7 +2519,7 @@ void ParticleGame::OnUpdate(UpdateEventArgs& e)
 		XMMATRIX viewMatrix = DirectX::XMMatrixLookAtLH(eyePos, focusPoint, upDirection);
 
 		float aspectRatio = GetWindowWidth() / static_cast<float>(GetWindowHeight());
-		XMMATRIX projectionMatrix = DirectX::XMMatrixPerspectiveFovLH(XMConvertToRadians(FoV), aspectRatio, 1.0f, 50.0f);
+		XMMATRIX projectionMatrix = DirectX::XMMatrixPerspectiveFovLH(XMConvertToRadians(FoV), aspectRatio, NearPlane, FarPlane);
 
 		VSRootConstants.V = viewMatrix;
 		VSRootConstants.P = projectionMatrix;
@@ -847,6 +2532,12 @@ void ParticleGame::OnUpdate(UpdateEventArgs& e)
 		PPRootConstants.P = projectionMatrix;
 
 		CSRootConstants.deltaTime = deltaTime;
+
+		// Slow drift through the tiling volume, wrapped so the offset keeps its precision
+		FrameCurlNoiseConstants.Offset = float3(
+			fmodf(FrameCurlNoiseConstants.Offset.x + 0.020f * deltaTime, 1.0f),
+			fmodf(FrameCurlNoiseConstants.Offset.y + 0.013f * deltaTime, 1.0f),
+			fmodf(FrameCurlNoiseConstants.Offset.z + 0.017f * deltaTime, 1.0f));
 	}
 }
 
@@ -869,11 +2560,116 @@ void ParticleGame::OnRender(RenderEventArgs& e)
 	auto backBuffer = pWindow->GetCurrentBackBuffer();
 	auto dsv = DSVHeap->GetCPUDescriptorHandleForHeapStart();
 
+	UpdateTextureStreaming(currentBackBufferIndex);
+
 	D3D12_GPU_DESCRIPTOR_HANDLE descriptorHandle = DescriptorHeap->GetGPUDescriptorHandleForHeapStart();
 
+	// Culling constants, frustum from this frame and occlusion against the pyramid built last frame
+	{
+		const XMMATRIX columns = XMMatrixTranspose(XMMatrixMultiply(VSRootConstants.V, VSRootConstants.P));
+		const XMVECTOR planes[6] =
+		{
+			XMVectorAdd(columns.r[3], columns.r[0]), // Left
+			XMVectorSubtract(columns.r[3], columns.r[0]), // Right
+			XMVectorAdd(columns.r[3], columns.r[1]), // Bottom
+			XMVectorSubtract(columns.r[3], columns.r[1]), // Top
+			columns.r[2], // Near
+			XMVectorSubtract(columns.r[3], columns.r[2]) // Far
+		};
+		for (UINT n = 0; n < _countof(planes); n++)
+		{
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&FrameCullConstants.FrustumPlanes[n]), XMPlaneNormalize(planes[n]));
+		}
+
+		XMFLOAT4X4 projection;
+		XMStoreFloat4x4(&projection, PreviousProjection);
+		XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&FrameCullConstants.HiZView), PreviousView);
+		FrameCullConstants.HiZProjection = float4(projection._11, projection._22, projection._33, projection._43);
+		FrameCullConstants.HiZDimensions = uint2(HiZRootConstants.depthWidth, HiZRootConstants.depthHeight);
+		FrameCullConstants.HiZMipCount = HiZRootConstants.mipCount;
+		FrameCullConstants.HiZEnabled = HiZBuilt;
+
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&FrameCullConstants.ViewDepthAxis), XMMatrixTranspose(VSRootConstants.V).r[2]);
+
+		memcpy(MappedCullConstants + currentBackBufferIndex * CullConstantsStride, &FrameCullConstants, sizeof(FrameCullConstants));
+
+		FrameCollisionConstants.Enabled = UseCollision;
+		FrameCollisionConstants.KillOnHit = CollisionKillOnHit;
+		FrameCollisionConstants.DepthEnabled = UseDepthCollision;
+		memcpy(MappedCollisionConstants + currentBackBufferIndex * CollisionConstantsStride, &FrameCollisionConstants, sizeof(FrameCollisionConstants));
+
+		ForceFieldCount = UseForceFields ? (std::min)(static_cast<UINT>(ForceFields.size()), static_cast<UINT>(FORCE_FIELD_MAX_COUNT)) : 0;
+		memcpy(MappedForceFields + currentBackBufferIndex * ForceFieldBufferStride, ForceFields.data(), ForceFieldCount * sizeof(ForceField));
+
+		FrameCurlNoiseConstants.Enabled = UseCurlNoise;
+		memcpy(MappedCurlNoiseConstants + currentBackBufferIndex * CurlNoiseConstantsStride, &FrameCurlNoiseConstants, sizeof(FrameCurlNoiseConstants));
+
+		// Sequences keep playing with the fields off so they don't jump when switched back on
+		for (UINT n = 0; n < VECTOR_FIELD_MAX_COUNT; n++)
+		{
+			if (VectorFieldSlots[n].Stream && VectorFieldSlots[n].Stream->Advance(deltaTime))
+			{
+				VectorFieldSlots[n].TextureStale = true;
+			}
+		}
+		FrameVectorFieldConstants.Count = UseVectorFields ? VectorFieldSlotCount : 0;
+		CSRootConstants.curveSet = UseParticleCurves ? EmitterCurveSet : CURVE_SET_NONE;
+
+		// Simulate writes the next history slot, the ribbon pass starts from it
+		SimulateTrailHead = TRAIL_HEAD_NONE;
+		if (UseTrails)
+		{
+			TrailHead = (TrailHead + 1) % TRAIL_LENGTH;
+			SimulateTrailHead = TrailHead | (TrailRestart ? TRAIL_HEAD_RESET : 0);
+			TrailRestart = false;
+		}
+		SimulateEventMask = UseSubEmitters ? SubEmitterEventMask(SubEmitterRootConstants) : 0;
+		SubEmitterRootConstants.Seed++;
+		FrameTrailConstants.CameraPosition = float3(CameraPosition.x, CameraPosition.y, CameraPosition.z);
+		FrameTrailConstants.Head = TrailHead;
+		memcpy(MappedVectorFieldConstants + currentBackBufferIndex * VectorFieldConstantsStride, &FrameVectorFieldConstants, sizeof(FrameVectorFieldConstants));
+
+		XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&FrameRasterConstants.View), VSRootConstants.V);
+		XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&FrameRasterConstants.Projection), VSRootConstants.P);
+		FrameRasterConstants.DrawArgsOffset = currentBackBufferIndex * sizeof(D3D12_DRAW_INDEXED_ARGUMENTS) + offsetof(D3D12_DRAW_INDEXED_ARGUMENTS, InstanceCount);
+		FrameRasterConstants.AlphaBlend = UseAlphaBlending;
+	}
+
 	// Compute command list
 	if (UseCompute)
 	{
+		// New frames of animated vector fields, copied through this frame's slice of the ring before anything samples them
+		for (UINT n = 0; n < VECTOR_FIELD_MAX_COUNT; n++)
+		{
+			VectorFieldSlot& slot = VectorFieldSlots[n];
+			if (!slot.TextureStale)
+			{
+				continue;
+			}
+
+			// Rows are padded to the footprint's pitch, RowCount rows make up one depth slice
+			const VectorFieldVolume& volume = slot.Stream->Current();
+			const UINT64 sliceOffset = currentBackBufferIndex * VectorFieldUploadStride;
+			const UINT rowPitch = slot.Footprint.Footprint.RowPitch;
+			for (UINT z = 0; z < slot.Footprint.Footprint.Depth; z++)
+			{
+				for (UINT y = 0; y < slot.RowCount; y++)
+				{
+					memcpy(MappedVectorFieldUpload + sliceOffset + slot.Footprint.Offset + (static_cast<UINT64>(z) * slot.RowCount + y) * rowPitch,
+						&volume.Texels[(static_cast<size_t>(z) * volume.Resolution[1] + y) * volume.Resolution[0]], static_cast<size_t>(slot.RowSize));
+				}
+			}
+
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = slot.Footprint;
+			footprint.Offset += sliceOffset;
+			CD3DX12_TEXTURE_COPY_LOCATION destination(slot.Texture.Get(), 0);
+			CD3DX12_TEXTURE_COPY_LOCATION source(VectorFieldUpload.Get(), footprint);
+			TransitionResource(computeCommandList, slot.Texture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+			computeCommandList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+			TransitionResource(computeCommandList, slot.Texture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			slot.TextureStale = false;
+		}
+
 		// Emit
 		computeCommandList->SetPipelineState(EmitPSO.Get());
 		computeCommandList->SetComputeRootSignature(EmitRS.Get());
@@ -889,12 +2685,133 @@ void ParticleGame::OnRender(RenderEventArgs& e)
 		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
 		computeCommandList->ResourceBarrier(1, &barrier);
 
-		// Simulate
+		// Hash live particles into the neighbor grid the simulate pass queries
+		computeCommandList->SetPipelineState(SpatialHashPSO.Get());
+		computeCommandList->SetComputeRootSignature(SpatialHashRS.Get());
+		computeCommandList->SetComputeRootDescriptorTable(0, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 43, DescriptorSize));
+		computeCommandList->SetComputeRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 0, DescriptorSize));
+
+		const UINT hashCellGroups = SpatialHashTableSize / SPATIAL_HASH_THREADS;
+		const UINT hashParticleGroups = (MaxParticleCount + SPATIAL_HASH_THREADS - 1) / SPATIAL_HASH_THREADS;
+		const UINT hashPhaseGroups[6] = { hashCellGroups, hashParticleGroups, SpatialHashTableSize / SPATIAL_HASH_SCAN_BLOCK, 1, hashCellGroups, hashParticleGroups };
+		for (UINT phase = SPATIAL_HASH_PHASE_CLEAR; phase <= SPATIAL_HASH_PHASE_SCATTER; phase++)
+		{
+			SpatialHashRootConstants.phase = phase;
+			computeCommandList->SetComputeRoot32BitConstants(2, sizeof(SpatialHashRootConstants) / 4, reinterpret_cast<void*>(&SpatialHashRootConstants), 0);
+			computeCommandList->Dispatch(hashPhaseGroups[phase], 1, 1);
+			computeCommandList->ResourceBarrier(1, &barrier);
+		}
+
+		// Fluid density then forces over the neighbor grid, simulate applies the accelerations
+		SPHRootConstants.fluid.Enabled = UseSPH ? 1 : 0;
+		if (UseSPH)
+		{
+			computeCommandList->SetPipelineState(SPHPSO.Get());
+			computeCommandList->SetComputeRootSignature(SPHRS.Get());
+			computeCommandList->SetComputeRootDescriptorTable(0, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 43, DescriptorSize));
+			computeCommandList->SetComputeRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 0, DescriptorSize));
+			computeCommandList->SetComputeRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 49, DescriptorSize));
+
+			SPHRootConstants.hash = SpatialHashRootConstants.hash;
+			for (UINT phase = SPH_PHASE_DENSITY; phase <= SPH_PHASE_FORCES; phase++)
+			{
+				SPHRootConstants.phase = phase;
+				computeCommandList->SetComputeRoot32BitConstants(3, sizeof(SPHRootConstants) / 4, reinterpret_cast<void*>(&SPHRootConstants), 0);
+				computeCommandList->Dispatch(hashParticleGroups, 1, 1);
+				computeCommandList->ResourceBarrier(1, &barrier);
+			}
+		}
+
+		// Simulate and cull
 		computeCommandList->SetPipelineState(SimulatePSO.Get());
 		computeCommandList->SetComputeRootSignature(SimulateRS.Get());
+		computeCommandList->SetComputeRootDescriptorTable(0, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 0, DescriptorSize));
+		computeCommandList->SetComputeRoot32BitConstants(1, sizeof(CSRootConstants) / 4, reinterpret_cast<void*>(&CSRootConstants), 0);
+		computeCommandList->SetComputeRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 32, DescriptorSize));
+		computeCommandList->SetComputeRootConstantBufferView(3, CullConstantBuffer->GetGPUVirtualAddress() + currentBackBufferIndex * CullConstantsStride);
+		computeCommandList->SetComputeRootDescriptorTable(4, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 17, DescriptorSize));
+		computeCommandList->SetComputeRootDescriptorTable(5, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 43, DescriptorSize));
+		computeCommandList->SetComputeRoot32BitConstants(6, sizeof(SpatialHashConstants) / 4, reinterpret_cast<void*>(&SpatialHashRootConstants.hash), 0);
+		computeCommandList->SetComputeRootDescriptorTable(7, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 50, DescriptorSize));
+		computeCommandList->SetComputeRoot32BitConstants(8, sizeof(SPHConstants) / 4, reinterpret_cast<void*>(&SPHRootConstants.fluid), 0);
+		computeCommandList->SetComputeRootDescriptorTable(9, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 51, DescriptorSize));
+		computeCommandList->SetComputeRootConstantBufferView(10, CollisionConstantBuffer->GetGPUVirtualAddress() + currentBackBufferIndex * CollisionConstantsStride);
+		computeCommandList->SetComputeRootShaderResourceView(11, ForceFieldBuffer->GetGPUVirtualAddress() + currentBackBufferIndex * ForceFieldBufferStride);
+		computeCommandList->SetComputeRoot32BitConstants(12, 1, &ForceFieldCount, 0);
+		computeCommandList->SetComputeRootDescriptorTable(13, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 53, DescriptorSize));
+		computeCommandList->SetComputeRootConstantBufferView(14, CurlNoiseConstantBuffer->GetGPUVirtualAddress() + currentBackBufferIndex * CurlNoiseConstantsStride);
+		computeCommandList->SetComputeRootConstantBufferView(15, VectorFieldConstantBuffer->GetGPUVirtualAddress() + currentBackBufferIndex * VectorFieldConstantsStride);
+		computeCommandList->SetComputeRootDescriptorTable(16, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 59, DescriptorSize));
+		computeCommandList->SetComputeRoot32BitConstants(17, 1, &SimulateTrailHead, 0);
+		computeCommandList->SetComputeRoot32BitConstants(17, 1, &SimulateEventMask, 1);
 
 		computeCommandList->Dispatch(static_cast<UINT>(ceil(MaxParticleCount / float(ComputeThreadGroupSize))), 1, 1);
 
+		// Children of this frame's deaths and collisions join the alive list simulate just filled
+		if (SimulateEventMask)
+		{
+			computeCommandList->ResourceBarrier(1, &barrier);
+			computeCommandList->SetPipelineState(GenerateArgsPSO.Get());
+			computeCommandList->SetComputeRootSignature(SubEmitterRS.Get());
+			computeCommandList->SetComputeRootDescriptorTable(0, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 0, DescriptorSize));
+			computeCommandList->SetComputeRoot32BitConstants(1, sizeof(CSRootConstants) / 4, reinterpret_cast<void*>(&CSRootConstants), 0);
+			computeCommandList->SetComputeRoot32BitConstants(2, sizeof(SubEmitterConstants) / 4, reinterpret_cast<void*>(&SubEmitterRootConstants), 0);
+			computeCommandList->SetComputeRootDescriptorTable(3, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 64, DescriptorSize));
+			computeCommandList->Dispatch(1, 1, 1);
+			computeCommandList->ResourceBarrier(1, &barrier);
+
+			TransitionResource(computeCommandList, SubEmitterDispatchArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+			computeCommandList->SetPipelineState(SubEmitterPSO.Get());
+			computeCommandList->ExecuteIndirect(DispatchCommandSignature.Get(), 1, SubEmitterDispatchArgs.Get(), 0, nullptr, 0);
+			TransitionResource(computeCommandList, SubEmitterDispatchArgs, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		}
+
+		// The visible count becomes this frame's instance count
+		TransitionResource(computeCommandList, VisibleIndexList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		computeCommandList->CopyBufferRegion(IndirectDrawArgs.Get(), currentBackBufferIndex * sizeof(D3D12_DRAW_INDEXED_ARGUMENTS) + offsetof(D3D12_DRAW_INDEXED_ARGUMENTS, InstanceCount),
+			VisibleIndexList.Get(), ParticleBufferCounterOffset, sizeof(UINT));
+
+		if (UseAlphaBlending)
+		{
+			// Sort the visible list back to front, the count is the key count and the histograms start from zero
+			computeCommandList->CopyBufferRegion(SortCounter.Get(), 0, VisibleIndexList.Get(), ParticleBufferCounterOffset, sizeof(UINT));
+			computeCommandList->CopyBufferRegion(SortHistogram.Get(), 0, SortHistogramReset.Get(), 0, RADIX_PASSES * RADIX_BINS * sizeof(UINT));
+			TransitionResource(computeCommandList, VisibleIndexList, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+			TransitionResource(computeCommandList, SortCounter, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+			TransitionResource(computeCommandList, SortHistogram, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+			computeCommandList->SetPipelineState(SortHistogramPSO.Get());
+			computeCommandList->SetComputeRootSignature(SortRS.Get());
+			computeCommandList->SetComputeRootDescriptorTable(0, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 36, DescriptorSize));
+			computeCommandList->SetComputeRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 0, DescriptorSize));
+			computeCommandList->SetComputeRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 32, DescriptorSize));
+			computeCommandList->SetComputeRootConstantBufferView(3, CullConstantBuffer->GetGPUVirtualAddress() + currentBackBufferIndex * CullConstantsStride);
+			SortRootConstants.pass = 0;
+			computeCommandList->SetComputeRoot32BitConstants(4, sizeof(SortRootConstants) / 4, reinterpret_cast<void*>(&SortRootConstants), 0);
+			computeCommandList->Dispatch(SortPartitionCount, 1, 1);
+			computeCommandList->ResourceBarrier(1, &barrier);
+
+			// One onesweep dispatch per 8 bit digit, the result ping-pongs back into the first half
+			computeCommandList->SetPipelineState(SortOnesweepPSO.Get());
+			for (UINT pass = 0; pass < RADIX_PASSES; pass++)
+			{
+				SortRootConstants.pass = pass;
+				computeCommandList->SetComputeRoot32BitConstants(4, sizeof(SortRootConstants) / 4, reinterpret_cast<void*>(&SortRootConstants), 0);
+				computeCommandList->Dispatch(SortPartitionCount, 1, 1);
+				computeCommandList->ResourceBarrier(1, &barrier);
+			}
+
+			TransitionResource(computeCommandList, SortValues, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+			computeCommandList->CopyBufferRegion(StagedVisibleIndices.Get(), currentBackBufferIndex * sizeof(UINT) * MaxParticleCount, SortValues.Get(), 0, sizeof(UINT) * MaxParticleCount);
+			TransitionResource(computeCommandList, VisibleIndexList, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST);
+		}
+		else
+		{
+			computeCommandList->CopyBufferRegion(StagedVisibleIndices.Get(), currentBackBufferIndex * sizeof(UINT) * MaxParticleCount, VisibleIndexList.Get(), 0, sizeof(UINT) * MaxParticleCount);
+			TransitionResource(computeCommandList, VisibleIndexList, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+		}
+		computeCommandList->CopyBufferRegion(VisibleIndexList.Get(), ParticleBufferCounterOffset, UAVCounterReset.Get(), 0, sizeof(UINT));
+
 		computeCommandList->CopyBufferRegion(StagedParticleBuffers.Get(), currentBackBufferIndex * sizeof(Particle) * MaxParticleCount, ParticleBuffer.Get(), 0, sizeof(Particle) * MaxParticleCount);
 		computeCommandList->CopyResource(AliveIndexList0.Get(), AliveIndexList1.Get());
 		
@@ -902,6 +2819,47 @@ void ParticleGame::OnRender(RenderEventArgs& e)
 		computeCommandList->CopyBufferRegion(AliveIndexList1.Get(), ParticleBufferCounterOffset, UAVCounterReset.Get(), 0, sizeof(UINT));
 		TransitionResource(computeCommandList, AliveIndexList1, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE);
 	}
+	else
+	{
+		// CPU backend, upload the particles and the draw list through this frame's slot of the ring
+		SPHRootConstants.fluid.Enabled = UseSPH ? 1 : 0;
+		static const std::vector<ForceField> noForceFields;
+		CPUParticleSystem.Update(CSRootConstants, FrameCullConstants, SPHRootConstants.fluid, SpatialHashRootConstants.hash, FrameCollisionConstants,
+			UseForceFields ? ForceFields : noForceFields, FrameCurlNoiseConstants, FrameVectorFieldConstants, SimulateTrailHead,
+			UseSubEmitters ? SubEmitterRootConstants : SubEmitterConstants{}, UseAlphaBlending);
+
+		const std::vector<Particle>& particles = CPUParticleSystem.GetParticles();
+		const std::vector<UINT>& drawIndices = CPUParticleSystem.GetDrawIndices();
+		UINT8* uploadSlot = MappedCPUUpload + currentBackBufferIndex * CPUUploadStride;
+		memcpy(uploadSlot, particles.data(), sizeof(Particle) * MaxParticleCount);
+		memcpy(uploadSlot + sizeof(Particle) * MaxParticleCount, drawIndices.data(), sizeof(UINT) * drawIndices.size());
+
+		const UINT64 uploadOffset = static_cast<UINT64>(currentBackBufferIndex) * CPUUploadStride;
+		commandList->CopyBufferRegion(StagedParticleBuffers.Get(), currentBackBufferIndex * sizeof(Particle) * MaxParticleCount, CPUUploadBuffer.Get(), uploadOffset, sizeof(Particle) * MaxParticleCount);
+		if (!drawIndices.empty())
+		{
+			commandList->CopyBufferRegion(StagedVisibleIndices.Get(), currentBackBufferIndex * sizeof(UINT) * MaxParticleCount, CPUUploadBuffer.Get(),
+				uploadOffset + sizeof(Particle) * MaxParticleCount, sizeof(UINT) * drawIndices.size());
+			TransitionResource(commandList, StagedVisibleIndices, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		}
+
+		// The whole history ring follows the draw list, restarts and new particles touch every slot
+		if (UseTrails)
+		{
+			const std::vector<float4>& trailHistory = CPUParticleSystem.GetTrailHistory();
+			const UINT64 trailOffset = (sizeof(Particle) + sizeof(UINT)) * MaxParticleCount;
+			memcpy(uploadSlot + trailOffset, trailHistory.data(), sizeof(float4) * trailHistory.size());
+			commandList->CopyBufferRegion(TrailHistory.Get(), 0, CPUUploadBuffer.Get(), uploadOffset + trailOffset, sizeof(float4) * trailHistory.size());
+			TransitionResource(commandList, TrailHistory, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		}
+
+		// Same indirect arguments the compute path fills, so both paths draw and bin the same way
+		D3D12_WRITEBUFFERIMMEDIATE_PARAMETER instanceCount = { IndirectDrawArgs->GetGPUVirtualAddress() + FrameRasterConstants.DrawArgsOffset, static_cast<UINT>(drawIndices.size()) };
+		commandList->WriteBufferImmediate(1, &instanceCount, nullptr);
+
+		TransitionResource(commandList, StagedParticleBuffers, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		TransitionResource(commandList, IndirectDrawArgs, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+	}
 
 	// Rendering command list
 	{
@@ -926,7 +2884,7 @@ void ParticleGame::OnRender(RenderEventArgs& e)
 		commandList->SetGraphicsRootSignature(RenderRS.Get());
 		commandList->SetGraphicsRoot32BitConstants(0, sizeof(VSRootConstants) / 4, reinterpret_cast<void*>(&VSRootConstants), 0);
 		commandList->SetGraphicsRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 10, DescriptorSize));
-		commandList->SetGraphicsRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 9, DescriptorSize));
+		commandList->SetGraphicsRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, WallTexture.FrameDescriptors + currentBackBufferIndex, DescriptorSize));
 
 		// Render Room
 		if (RenderRoom)
@@ -934,6 +2892,24 @@ void ParticleGame::OnRender(RenderEventArgs& e)
 			commandList->DrawIndexedInstanced(6, _countof(Planes), 0, 0, 0);
 		}
 
+		// Depth is read-only from here on, the particle pass uses the read-only DSV
+		TransitionResource(commandList, DepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+		// Build the Hi-Z pyramid from the room's depth in a single dispatch
+		{
+			TransitionResource(commandList, HiZTexture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+			commandList->SetPipelineState(HiZPSO.Get());
+			commandList->SetComputeRootSignature(HiZRS.Get());
+			commandList->SetComputeRootDescriptorTable(0, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 12, DescriptorSize));
+			commandList->SetComputeRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 18, DescriptorSize));
+			commandList->SetComputeRoot32BitConstants(2, sizeof(HiZRootConstants) / 4, reinterpret_cast<void*>(&HiZRootConstants), 0);
+			commandList->Dispatch((HiZRootConstants.depthWidth + HiZTileSize - 1) / HiZTileSize, (HiZRootConstants.depthHeight + HiZTileSize - 1) / HiZTileSize, 1);
+
+			TransitionResource(commandList, HiZTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			HiZBuilt = true;
+		}
+
 		// SSAO Post-processing on room
 		if (UsePostProcess)
 		{
@@ -941,16 +2917,104 @@ void ParticleGame::OnRender(RenderEventArgs& e)
 			commandList->SetComputeRootSignature(PostProcessRS.Get());
 			commandList->SetComputeRootDescriptorTable(0, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 11, DescriptorSize));
 			commandList->SetComputeRoot32BitConstants(1, sizeof(PPRootConstants) / 4, reinterpret_cast<void*>(&PPRootConstants), 0);
+			commandList->SetComputeRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 15, DescriptorSize));
 			commandList->Dispatch(static_cast<UINT>(ceil(PPRootConstants.windowWidth / 8.0f)), static_cast<UINT>(ceil(PPRootConstants.windowHeight / 8.0f)), 1);
+
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+			commandList->ResourceBarrier(1, &barrier);
+
+			// Separable bilateral blur of the occlusion, the vertical pass applies it to the scene
+			commandList->SetPipelineState(SSAOBlurPSO.Get());
+			commandList->SetComputeRootSignature(SSAOBlurRS.Get());
+			commandList->SetComputeRootDescriptorTable(0, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 11, DescriptorSize));
+			commandList->SetComputeRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 15, DescriptorSize));
+
+			BlurRootConstants.vertical = 0;
+			commandList->SetComputeRoot32BitConstants(2, sizeof(BlurRootConstants) / 4, reinterpret_cast<void*>(&BlurRootConstants), 0);
+			commandList->Dispatch(static_cast<UINT>(ceil(BlurRootConstants.windowWidth / float(SSAOBlurTileSize))), BlurRootConstants.windowHeight, 1);
+			commandList->ResourceBarrier(1, &barrier);
+
+			BlurRootConstants.vertical = 1;
+			commandList->SetComputeRoot32BitConstants(2, sizeof(BlurRootConstants) / 4, reinterpret_cast<void*>(&BlurRootConstants), 0);
+			commandList->Dispatch(static_cast<UINT>(ceil(BlurRootConstants.windowHeight / float(SSAOBlurTileSize))), BlurRootConstants.windowWidth, 1);
 		}
 
 		// Render Particles
-		CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(dsv, 1, DescriptorSizeDSV);
-		commandList->OMSetRenderTargets(1, &descriptorHandleRTV, FALSE, &dsvHandle);
-		commandList->SetPipelineState(ParticleRenderPSO.Get());
-		commandList->SetGraphicsRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, UseCompute ? 5 + currentBackBufferIndex : 5, DescriptorSize));
-		commandList->SetGraphicsRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 8, DescriptorSize));
-		commandList->DrawIndexedInstanced(6, MaxParticleCount, 0, 0, 0);
+		if (UseTiledRaster)
+		{
+			// Bin the draw list into exact screen tile lists, then composite every tile over the scene in one group
+			TransitionResource(commandList, RenderTexture, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+			commandList->SetPipelineState(TileBinPSO.Get());
+			commandList->SetComputeRootSignature(TileRasterRS.Get());
+			commandList->SetComputeRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 5 + currentBackBufferIndex, DescriptorSize));
+			commandList->SetComputeRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 33 + currentBackBufferIndex, DescriptorSize));
+			commandList->SetComputeRootShaderResourceView(3, IndirectDrawArgs->GetGPUVirtualAddress());
+			commandList->SetComputeRootDescriptorTable(4, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 41, DescriptorSize));
+			commandList->SetComputeRootDescriptorTable(5, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 11, DescriptorSize));
+			commandList->SetComputeRootDescriptorTable(6, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 12, DescriptorSize));
+			commandList->SetComputeRootDescriptorTable(7, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, TilesTexture.FrameDescriptors + currentBackBufferIndex, DescriptorSize));
+			commandList->SetComputeRoot32BitConstants(8, sizeof(AtlasConstants) / 4, reinterpret_cast<void*>(&AtlasConstants), 0);
+
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+			const UINT tileCount = FrameRasterConstants.TileCount.x * FrameRasterConstants.TileCount.y;
+			const UINT binParticleGroups = (MaxParticleCount + TILE_RASTER_THREADS - 1) / TILE_RASTER_THREADS;
+			const UINT binPhaseGroups[5] = { binParticleGroups, (tileCount + TILE_RASTER_SCAN_BLOCK - 1) / TILE_RASTER_SCAN_BLOCK, 1,
+				(tileCount + TILE_RASTER_THREADS - 1) / TILE_RASTER_THREADS, binParticleGroups };
+			for (UINT phase = TILE_RASTER_PHASE_COUNT; phase <= TILE_RASTER_PHASE_SCATTER; phase++)
+			{
+				FrameRasterConstants.Phase = phase;
+				commandList->SetComputeRoot32BitConstants(0, sizeof(FrameRasterConstants) / 4, reinterpret_cast<void*>(&FrameRasterConstants), 0);
+				commandList->Dispatch(binPhaseGroups[phase], 1, 1);
+				commandList->ResourceBarrier(1, &barrier);
+			}
+
+			commandList->SetPipelineState(TileRasterPSO.Get());
+			commandList->Dispatch(FrameRasterConstants.TileCount.x, FrameRasterConstants.TileCount.y, 1);
+
+			TransitionResource(commandList, RenderTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		}
+		else
+		{
+			CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(dsv, 1, DescriptorSizeDSV);
+			commandList->OMSetRenderTargets(1, &descriptorHandleRTV, FALSE, &dsvHandle);
+			commandList->SetPipelineState(UseAlphaBlending ? ParticleAlphaPSO.Get() : ParticleRenderPSO.Get());
+			commandList->SetGraphicsRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 5 + currentBackBufferIndex, DescriptorSize));
+			commandList->SetGraphicsRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, TilesTexture.FrameDescriptors + currentBackBufferIndex, DescriptorSize));
+			commandList->SetGraphicsRootDescriptorTable(3, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 33 + currentBackBufferIndex, DescriptorSize));
+			commandList->SetGraphicsRoot32BitConstants(4, sizeof(AtlasConstants) / 4, reinterpret_cast<void*>(&AtlasConstants), 0);
+			commandList->ExecuteIndirect(DrawCommandSignature.Get(), 1, IndirectDrawArgs.Get(), currentBackBufferIndex * sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), nullptr, 0);
+		}
+
+		// Render Trails, ribbons for the same draw list, built on the GPU for either backend
+		if (UseTrails)
+		{
+			commandList->SetPipelineState(TrailPSO.Get());
+			commandList->SetComputeRootSignature(TrailRS.Get());
+			FrameTrailConstants.DrawArgsOffset = FrameRasterConstants.DrawArgsOffset;
+			commandList->SetComputeRoot32BitConstants(0, sizeof(FrameTrailConstants) / 4, reinterpret_cast<void*>(&FrameTrailConstants), 0);
+			commandList->SetComputeRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 5 + currentBackBufferIndex, DescriptorSize));
+			commandList->SetComputeRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 33 + currentBackBufferIndex, DescriptorSize));
+			commandList->SetComputeRootShaderResourceView(3, IndirectDrawArgs->GetGPUVirtualAddress());
+			commandList->SetComputeRootDescriptorTable(4, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 60, DescriptorSize));
+			commandList->SetComputeRootDescriptorTable(5, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 61, DescriptorSize));
+			commandList->Dispatch((MaxParticleCount + TRAIL_THREADS - 1) / TRAIL_THREADS, 1, 1);
+
+			TransitionResource(commandList, TrailVertices, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			TransitionResource(commandList, TrailDrawArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+
+			CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(dsv, 1, DescriptorSizeDSV);
+			commandList->OMSetRenderTargets(1, &descriptorHandleRTV, FALSE, &dsvHandle);
+			commandList->SetPipelineState(TrailRenderPSO.Get());
+			commandList->SetGraphicsRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(descriptorHandle, 63, DescriptorSize));
+			commandList->IASetIndexBuffer(&TrailIndexBufferView);
+			commandList->ExecuteIndirect(DrawCommandSignature.Get(), 1, TrailDrawArgs.Get(), 0, nullptr, 0);
+
+			TransitionResource(commandList, TrailVertices, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+			TransitionResource(commandList, TrailDrawArgs, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		}
+
+		TransitionResource(commandList, DepthBuffer, D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
 		// Render AABB of particle sim
 		/*commandList->SetPipelineState(AABBPSO.Get());
@@ -970,6 +3034,8 @@ void ParticleGame::OnRender(RenderEventArgs& e)
 	{
 		if (UseCompute)
 		{
+			// Culling reads the Hi-Z pyramid written by the previous frame's direct list
+			computeCommandQueue->Wait(commandQueue->GetD3D12Fence(), PreviousFrameFenceValue);
 			uint64_t computeFence = computeCommandQueue->ExecuteCommandList(computeCommandList);
 			commandQueue->Wait(computeCommandQueue->GetD3D12Fence(), computeFence);
 		}
@@ -980,6 +3046,9 @@ void ParticleGame::OnRender(RenderEventArgs& e)
 		}
 
 		FenceValues[currentBackBufferIndex] = commandQueue->ExecuteCommandList(commandList);
+		PreviousFrameFenceValue = FenceValues[currentBackBufferIndex];
+		PreviousView = VSRootConstants.V;
+		PreviousProjection = VSRootConstants.P;
 		currentBackBufferIndex = pWindow->Present();
 		commandQueue->WaitForFenceValue(FenceValues[currentBackBufferIndex]);
 	}
@@ -1045,6 +3114,109 @@ void ParticleGame::OnKeyPressed(KeyEventArgs& e)
 	case KeyCode::R:
 		RenderRoom = !RenderRoom;
 		break;
+	case KeyCode::B:
+		UseAlphaBlending = !UseAlphaBlending;
+		char buffer3[512];
+		sprintf_s(buffer3, "Depth sorted alpha blending?: %d\n", UseAlphaBlending);
+		OutputDebugStringA(buffer3);
+		break;
+	case KeyCode::T:
+		UseTiledRaster = !UseTiledRaster;
+		char buffer4[512];
+		sprintf_s(buffer4, "Tiled compute rasterizer?: %d\n", UseTiledRaster);
+		OutputDebugStringA(buffer4);
+		break;
+	case KeyCode::H:
+		UseSPH = !UseSPH;
+		char buffer5[512];
+		sprintf_s(buffer5, "SPH fluid?: %d\n", UseSPH);
+		OutputDebugStringA(buffer5);
+		break;
+	case KeyCode::C:
+		UseCollision = !UseCollision;
+		char buffer6[512];
+		sprintf_s(buffer6, "Plane collision?: %d\n", UseCollision);
+		OutputDebugStringA(buffer6);
+		break;
+	case KeyCode::K:
+		CollisionKillOnHit = !CollisionKillOnHit;
+		char buffer7[512];
+		sprintf_s(buffer7, "Kill particles on collision?: %d\n", CollisionKillOnHit);
+		OutputDebugStringA(buffer7);
+		break;
+	case KeyCode::Z:
+		UseDepthCollision = !UseDepthCollision;
+		char buffer8[512];
+		sprintf_s(buffer8, "Depth buffer collision?: %d\n", UseDepthCollision);
+		OutputDebugStringA(buffer8);
+		break;
+	case KeyCode::G:
+		UseForceFields = !UseForceFields;
+		char buffer9[512];
+		sprintf_s(buffer9, "Force fields?: %d\n", UseForceFields);
+		OutputDebugStringA(buffer9);
+		break;
+	case KeyCode::N:
+		UseCurlNoise = !UseCurlNoise;
+		char buffer10[512];
+		sprintf_s(buffer10, "Curl noise turbulence?: %d\n", UseCurlNoise);
+		OutputDebugStringA(buffer10);
+		break;
+	case KeyCode::I:
+		UseVectorFields = !UseVectorFields;
+		char buffer11[512];
+		sprintf_s(buffer11, "Imported vector fields?: %d (%u loaded)\n", UseVectorFields, VectorFieldSlotCount);
+		OutputDebugStringA(buffer11);
+		break;
+	case KeyCode::L:
+		UseParticleCurves = !UseParticleCurves;
+		char buffer12[512];
+		sprintf_s(buffer12, "Curves over lifetime?: %d\n", UseParticleCurves);
+		OutputDebugStringA(buffer12);
+		break;
+	case KeyCode::J:
+		UseTrails = !UseTrails;
+		TrailRestart = UseTrails;
+		char buffer13[512];
+		sprintf_s(buffer13, "Particle trails?: %d\n", UseTrails);
+		OutputDebugStringA(buffer13);
+		break;
+	case KeyCode::U:
+		UseSubEmitters = !UseSubEmitters;
+		char buffer14[512];
+		sprintf_s(buffer14, "Sub-emitter bursts on death and collision?: %d\n", UseSubEmitters);
+		OutputDebugStringA(buffer14);
+		break;
+	case KeyCode::M:
+		TextureBudget = (TextureBudget + 1) % _countof(TextureBudgets);
+		char buffer15[512];
+		if (TextureBudgets[TextureBudget] == SIZE_MAX)
+		{
+			sprintf_s(buffer15, "Texture residency budget: unlimited\n");
+		}
+		else
+		{
+			sprintf_s(buffer15, "Texture residency budget: %zu KB\n", TextureBudgets[TextureBudget] / 1024);
+		}
+		OutputDebugStringA(buffer15);
+		break;
+	case KeyCode::O:
+		if (Emitters.GetCount() > 0)
+		{
+			ActiveEmitter = (ActiveEmitter + 1) % Emitters.GetCount();
+			ApplyActiveEmitter();
+		}
+		break;
+	case KeyCode::P:
+		if (e.Shift)
+		{
+			RestoreSnapshot();
+		}
+		else
+		{
+			SaveSnapshot();
+		}
+		break;
 	}
 }
 
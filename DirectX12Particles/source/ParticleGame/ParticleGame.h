@@ -3,6 +3,32 @@
 #include "Game.h"
 #include "Window.h"
 
+#include "Particle.hlsli"
+#include "Culling.hlsli"
+#include "RadixSort.hlsli"
+#include "TiledRaster.hlsli"
+#include "SpatialHash.hlsli"
+#include "SPH.hlsli"
+#include "Collision.hlsli"
+#include "ForceField.hlsli"
+#include "CurlNoise.hlsli"
+#include "VectorField.hlsli"
+#include "ParticleCurves.hlsli"
+#include "Trail.hlsli"
+#include "SubEmitter.hlsli"
+#include "../ParticleCPU/ParticleSystemCPU.h"
+#include "../ParticleCPU/EmitterLibrary.h"
+#include "../ParticleCPU/TextureStreaming.h"
+#include "../ParticleCPU/ParticleAtlas.h"
+#include "../ParticleCPU/BlockCompression.h"
+#include "../ParticleCPU/PipelineCache.h"
+#include "../ParticleCPU/TaskGraph.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
 using namespace DirectX;
 
 class ParticleGame : public Game
@@ -29,23 +55,57 @@ private:
 	// Transition a resource's state
 	void TransitionResource(ComPtr<ID3D12GraphicsCommandList2> commandList, ComPtr<ID3D12Resource> resource, D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState);
 
-	// Create a GPU buffer
-	void UpdateBufferResource(ComPtr<ID3D12GraphicsCommandList2> commandList, ID3D12Resource** pDestinationResource, ID3D12Resource** pIntermediateResource, 
-		size_t numElements, size_t elementSize, const void* bufferData, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
-	void UpdateTextureResourceFromFile(ComPtr<ID3D12GraphicsCommandList2> commandList, ID3D12Resource** pDestinationResource, ID3D12Resource** pIntermediateResource, std::wstring fileName);
+	// Retire finished copies, report this frame's texture use, record the uploads and evictions on the copy queue
+	// and point the frame's texture descriptors at the current resources
+	void UpdateTextureStreaming(UINT frame);
+
+	// Finest mip a surface with texelsPerUnit texels per world unit needs at distance, about one texel per pixel
+	UINT GetFinestMip(float texelsPerUnit, float distance) const;
 
-	// Resize the depth buffer to match the window area
+	// Resize the depth buffer and its Hi-Z pyramid to match the window area
 	void ResizeDepthBuffer(int width, int height);
 
-	struct Particle
-	{
-		XMFLOAT4 position;
-		XMFLOAT4 velocity;
-		XMFLOAT4 acceleration;
-		XMFLOAT4 color;
-		float lifeTimeLeft;
-		float size;
-	};
+	// Resize the SSAO occlusion and blur targets to match the window area
+	void ResizeSSAOTextures(int width, int height);
+
+	// Copy the active emitter of the library into the emitter root constants
+	void ApplyActiveEmitter();
+
+	// Write the pool of the active backend to SnapshotPath, and replace the pools of both backends with the snapshot there
+	bool SaveSnapshot();
+	bool RestoreSnapshot();
+
+	// Copy a snapshot image into the GPU pool, both backends agree on it afterwards as long as the CPU pool holds the same image
+	void UploadSnapshot(const std::vector<uint8_t>& image);
+
+	// Fast-forward the active emitter on the CPU backend and upload the result, so the pool starts out in its steady state
+	void PrewarmPool();
+
+	// LoadContent's task graph and what its tasks share
+	struct ContentLoader;
+
+	// Each adds the tasks of one part of the content to loader.Graph, waiting for the tasks they read the results of
+	void CreateRootSignatureTasks(ContentLoader& loader);
+
+	// Authored PNGs and TGAs are compressed into DDS files next to them, then Particle.dds and every DDS in ParticleTextures
+	// are packed into ParticleAtlas.dds whenever one of them is newer
+	void CreateTextureTasks(ContentLoader& loader);
+
+	// Emitters.json or Emitters.bin, LoadContent applies the active emitter once the atlas is there too
+	void CreateEmitterTasks(ContentLoader& loader);
+
+	// Shader reads and PSOs, each PSO once its shaders and root signature are there
+	void CreateRenderPSOTasks(ContentLoader& loader);
+	void CreateComputePSOTasks(ContentLoader& loader);
+
+	// Buffers and their views, one task per group of heap entries. Copies into them are recorded into loader.CommandList.
+	void CreateBufferTasks(ContentLoader& loader);
+
+	// The curl noise volume, loaded from its cache or baked, the imported vector fields and the curve atlas
+	void CreateVolumeTasks(ContentLoader& loader);
+
+	// Run the graph, report its critical path and write PipelineCache.bin anew when a PSO had to be created
+	void RunContentLoader(ContentLoader& loader);
 
 	struct PlaneData
 	{
@@ -66,22 +126,6 @@ private:
 		XMMATRIX P;
 	};
 
-	struct CSRootConstants
-	{
-		float deltaTime;
-		float particleLifetime;
-		UINT emitCount;
-		UINT maxParticleCount;
-		XMFLOAT4 emitAABBMin;
-		XMFLOAT4 emitAABBMax;
-		XMFLOAT4 emitVelocityMin;
-		XMFLOAT4 emitVelocityMax;
-		XMFLOAT4 emitAccelerationMin;
-		XMFLOAT4 emitAccelerationMax;
-		float particleStartScale;
-		float particleEndScale;
-	};
-
 	struct PPRootConstants
 	{
 		int windowWidth;
@@ -94,13 +138,81 @@ private:
 		float kernelRadius;
 	};
 
+	struct BlurRootConstants
+	{
+		int windowWidth;
+		int windowHeight;
+		float nearPlane;
+		float farPlane;
+		float sharpness;
+		UINT vertical;
+	};
+
+	struct HiZRootConstants
+	{
+		UINT depthWidth;
+		UINT depthHeight;
+		UINT mipCount;
+		UINT groupCount;
+	};
+
+	struct SortRootConstants
+	{
+		UINT pass;
+		UINT partitionCount;
+	};
+
+	struct SpatialHashRootConstants
+	{
+		SpatialHashConstants hash;
+		UINT phase;
+	};
+
+	struct SPHRootConstants
+	{
+		SPHConstants fluid;
+		SpatialHashConstants hash;
+		UINT phase;
+	};
+
+	// One imported vector field, the stream owns the CPU frames and the texture holds the frame on screen
+	struct VectorFieldSlot
+	{
+		std::unique_ptr<VectorFieldStream> Stream;
+		ComPtr<ID3D12Resource> Texture;
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT Footprint; // Where the slot's frame goes in each ring slice of VectorFieldUpload
+		UINT RowCount;
+		UINT64 RowSize;
+		bool TextureStale; // The stream moved on since the texture was last written
+	};
+
 	static const UINT ComputeThreadGroupSize = 128;
+	static const UINT SSAOBlurTileSize = 64; // SSAO_BLUR_TILE in SSAOBlur.hlsli
+	static const UINT HiZTileSize = 64; // HIZ_TILE_SIZE in HiZ.hlsli
+	static const UINT CullConstantsStride = (sizeof(CullConstants) + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+	static const UINT CollisionConstantsStride = (sizeof(CollisionConstants) + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+	static const UINT ForceFieldBufferStride = FORCE_FIELD_MAX_COUNT * sizeof(ForceField);
+	static const UINT CurlNoiseConstantsStride = (sizeof(CurlNoiseConstants) + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+	static const UINT VectorFieldConstantsStride = (sizeof(VectorFieldConstants) + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
 
 	VSRootConstants VSRootConstants;
-	CSRootConstants CSRootConstants;
+	EmitterConstants CSRootConstants;
 	PPRootConstants PPRootConstants;
+	BlurRootConstants BlurRootConstants;
+	HiZRootConstants HiZRootConstants;
+	SortRootConstants SortRootConstants;
+	SpatialHashRootConstants SpatialHashRootConstants;
+	SPHRootConstants SPHRootConstants;
+	CullConstants FrameCullConstants;
+	TileRasterConstants FrameRasterConstants;
+	CollisionConstants FrameCollisionConstants;
+	CurlNoiseConstants FrameCurlNoiseConstants;
+	VectorFieldConstants FrameVectorFieldConstants;
+	TrailConstants FrameTrailConstants;
+	SubEmitterConstants SubEmitterRootConstants;
 
 	uint64_t FenceValues[Window::BufferCount] = {};
+	uint64_t PreviousFrameFenceValue;
 
 	ComPtr<ID3D12DescriptorHeap> RTVHeap; // Used for post-processing, RTVHeap for rendering exists in Window class
 	ComPtr<ID3D12DescriptorHeap> DSVHeap;
@@ -112,6 +224,11 @@ private:
 	ComPtr<ID3D12Resource> VertexBuffer;
 	ComPtr<ID3D12Resource> IndexBuffer;
 	ComPtr<ID3D12Resource> DepthBuffer;
+	ComPtr<ID3D12Resource> HiZTexture; // Min/max depth pyramid rebuilt from DepthBuffer after the room pass
+	ComPtr<ID3D12Resource> HiZCounter;
+	bool HiZBuilt; // False until the pyramid has been built for the current depth buffer
+	ComPtr<ID3D12Resource> TileLists; // Per screen tile count, start and scatter cursor, then the scan's block sums
+	ComPtr<ID3D12Resource> TileEntries; // Draw list positions of every tile list, TILE_RASTER_MAX_ENTRIES per screen tile on average
 	D3D12_VERTEX_BUFFER_VIEW VertexBufferView;
 	D3D12_INDEX_BUFFER_VIEW IndexBufferView;
 
@@ -120,18 +237,44 @@ private:
 	ComPtr<ID3D12RootSignature> EmitRS;
 	ComPtr<ID3D12RootSignature> SimulateRS;
 	ComPtr<ID3D12RootSignature> PostProcessRS;
+	ComPtr<ID3D12RootSignature> SSAOBlurRS;
+	ComPtr<ID3D12RootSignature> HiZRS;
+	ComPtr<ID3D12RootSignature> SortRS;
+	ComPtr<ID3D12RootSignature> TileRasterRS;
+	ComPtr<ID3D12RootSignature> SpatialHashRS;
+	ComPtr<ID3D12RootSignature> SPHRS;
+	ComPtr<ID3D12RootSignature> TrailRS;
+	ComPtr<ID3D12RootSignature> SubEmitterRS;
 
 	ComPtr<ID3D12PipelineState> ParticleRenderPSO;
+	ComPtr<ID3D12PipelineState> ParticleAlphaPSO; // Premultiplied alpha blending, needs the back to front draw list
 	ComPtr<ID3D12PipelineState> AABBPSO;
 	ComPtr<ID3D12PipelineState> PlaneRenderPSO;
 	ComPtr<ID3D12PipelineState> EmitPSO;
 	ComPtr<ID3D12PipelineState> SimulatePSO;
 	ComPtr<ID3D12PipelineState> PostProcessPSO;
+	ComPtr<ID3D12PipelineState> SSAOBlurPSO;
+	ComPtr<ID3D12PipelineState> HiZPSO;
+	ComPtr<ID3D12PipelineState> SortHistogramPSO;
+	ComPtr<ID3D12PipelineState> SortOnesweepPSO;
+	ComPtr<ID3D12PipelineState> TileBinPSO;
+	ComPtr<ID3D12PipelineState> TileRasterPSO;
+	ComPtr<ID3D12PipelineState> SpatialHashPSO;
+	ComPtr<ID3D12PipelineState> SPHPSO;
+	ComPtr<ID3D12PipelineState> TrailPSO;
+	ComPtr<ID3D12PipelineState> TrailRenderPSO;
+	ComPtr<ID3D12PipelineState> GenerateArgsPSO;
+	ComPtr<ID3D12PipelineState> SubEmitterPSO;
+
+	ComPtr<ID3D12CommandSignature> DrawCommandSignature;
+	ComPtr<ID3D12CommandSignature> DispatchCommandSignature;
 
 	D3D12_VIEWPORT Viewport;
 	D3D12_RECT ScissorRect;
 
 	float FoV;
+	static constexpr float NearPlane = 1.0f;
+	static constexpr float FarPlane = 50.0f;
 	float drawOffset;
 	float deltaTime;
 
@@ -139,6 +282,18 @@ private:
 	bool UseCompute;
 	bool UsePostProcess;
 	bool RenderRoom;
+	bool UseAlphaBlending;
+	bool UseTiledRaster; // Composite particles per screen tile in compute instead of drawing billboards
+	bool UseSPH; // Particles push on each other as a fluid, the neighbor grid cell size must cover the smoothing radius
+	bool UseCollision; // Particles bounce off the room planes
+	bool CollisionKillOnHit; // Colliding particles die instead of bouncing
+	bool UseDepthCollision; // Particles also bounce off last frame's depth buffer, GPU simulate only
+	bool UseForceFields; // Attractors, vortices, wind and drag from ForceFields act on the particles
+	bool UseCurlNoise; // Particles drift with the baked curl noise turbulence
+	bool UseVectorFields; // Particles follow the vector fields imported into VectorFieldSlots
+	bool UseParticleCurves; // Color, alpha, scale, drag and rotation follow the emitter's curves over lifetime
+	bool UseTrails; // Visible particles draw a ribbon through their last TRAIL_LENGTH positions
+	bool UseSubEmitters; // Dying and colliding particles spawn bursts of children
 
 	static const UINT MaxParticleCount = 10000;
 	static const UINT ParticleResourceCount = MaxParticleCount * Window::BufferCount;
@@ -149,8 +304,111 @@ private:
 	ComPtr<ID3D12Resource> DeadIndexListCounter;
 	ComPtr<ID3D12Resource> StagedParticleBuffers;
 	ComPtr<ID3D12Resource> UAVCounterReset;
+
+	// Culling vars
+	ComPtr<ID3D12Resource> VisibleIndexList;
+	ComPtr<ID3D12Resource> StagedVisibleIndices;
+	ComPtr<ID3D12Resource> IndirectDrawArgs;
+	ComPtr<ID3D12Resource> CullConstantBuffer;
+	UINT8* MappedCullConstants;
+	XMMATRIX PreviousView; // Matrices the current Hi-Z pyramid was rendered with
+	XMMATRIX PreviousProjection;
 	static const UINT ParticleBufferCounterOffset;
 
+	// Depth sort vars, keys and values hold two ping-pong halves of SortPartitionCount tiles each
+	static const UINT SortPartitionCount = (MaxParticleCount + RADIX_TILE_SIZE - 1) / RADIX_TILE_SIZE;
+	ComPtr<ID3D12Resource> SortKeys;
+	ComPtr<ID3D12Resource> SortValues;
+	ComPtr<ID3D12Resource> SortHistogram;
+	ComPtr<ID3D12Resource> SortStatus;
+	ComPtr<ID3D12Resource> SortCounter;
+	ComPtr<ID3D12Resource> SortHistogramReset;
+
+	// Neighbor grid vars, rebuilt from the particle buffer between emit and simulate
+	static const UINT SpatialHashTableSize = GetSpatialHashTableSize(MaxParticleCount);
+	ComPtr<ID3D12Resource> HashCellCounts;
+	ComPtr<ID3D12Resource> HashCellStarts;
+	ComPtr<ID3D12Resource> HashSortedIndices;
+	ComPtr<ID3D12Resource> HashBlockSums;
+	ComPtr<ID3D12Resource> HashParticleKeys;
+	ComPtr<ID3D12Resource> HashParticleRanks;
+
+	// SPH vars, per particle slot and only written for live particles
+	ComPtr<ID3D12Resource> SPHDensityPressure;
+	ComPtr<ID3D12Resource> SPHAccelerations;
+
+	// Plane collision vars, the planes and broadphase grid are built from Planes once and shared with the CPU backend
+	static constexpr float CollisionMargin = 1.0f; // Largest particle radius plus the furthest a particle moves in a frame
+	std::vector<CollisionPlane> CollisionPlanes;
+	std::vector<UINT> CollisionGrid;
+	ComPtr<ID3D12Resource> CollisionPlaneBuffer;
+	ComPtr<ID3D12Resource> CollisionGridBuffer;
+	ComPtr<ID3D12Resource> CollisionConstantBuffer;
+	UINT8* MappedCollisionConstants;
+
+	// Force field vars, the list is copied into a per-frame slice of an upload buffer the simulate pass reads as a root SRV
+	std::vector<ForceField> ForceFields;
+	UINT ForceFieldCount;
+	ComPtr<ID3D12Resource> ForceFieldBuffer;
+	UINT8* MappedForceFields;
+
+	// Turbulence vars, the volume is baked on CPUThreadPool at load and cached next to the executable
+	ComPtr<ID3D12Resource> CurlNoiseTexture;
+	ComPtr<ID3D12Resource> CurlNoiseConstantBuffer;
+	UINT8* MappedCurlNoiseConstants;
+
+	// Over-lifetime curves of the emitter, baked once at load
+	ComPtr<ID3D12Resource> CurveAtlasTexture;
+
+	// Trail vars, simulate writes the history ring and the ribbon pass builds vertices and draw arguments from this frame's draw list
+	UINT TrailHead; // History slot the next step writes to, advances every frame trails are on
+	bool TrailRestart; // Set when trails get switched on, the history is stale by then
+	UINT SimulateTrailHead; // TrailHead with TRAIL_HEAD_RESET, or TRAIL_HEAD_NONE with trails off
+	ComPtr<ID3D12Resource> TrailHistory;
+	ComPtr<ID3D12Resource> TrailVertices;
+	ComPtr<ID3D12Resource> TrailDrawArgs;
+	ComPtr<ID3D12Resource> TrailIndexBuffer;
+	D3D12_INDEX_BUFFER_VIEW TrailIndexBufferView;
+
+	// Sub-emitter vars, simulate appends events and the spawn pass is dispatched with the group count the args pass writes
+	UINT SimulateEventMask; // Event types simulate raises, 0 with sub-emitters off
+	ComPtr<ID3D12Resource> SubEmitterEvents;
+	ComPtr<ID3D12Resource> SubEmitterCounters;
+	ComPtr<ID3D12Resource> SubEmitterDispatchArgs;
+
+	// Imported vector field vars, animated slots copy their new frames through a per-frame upload ring
+	VectorFieldSlot VectorFieldSlots[VECTOR_FIELD_MAX_COUNT];
+	UINT VectorFieldSlotCount;
+	ComPtr<ID3D12Resource> VectorFieldConstantBuffer;
+	UINT8* MappedVectorFieldConstants;
+	ComPtr<ID3D12Resource> VectorFieldUpload;
+	UINT8* MappedVectorFieldUpload;
+	UINT64 VectorFieldUploadStride;
+
+	// Emitter library vars, Emitters.json next to the executable is compiled to Emitters.bin and polled for edits
+	static constexpr float EmitterPollInterval = 0.5f;
+	EmitterLibrary Emitters;
+	UINT ActiveEmitter;
+	UINT EmitterCurveSet; // The active emitter's curve set, UseParticleCurves switches between it and CURVE_SET_NONE
+	float EmitterPollTimer;
+
+	// Pre-warm vars, an emitter reaches its steady state after one particle lifetime.
+	// emitCount is per frame, so the big steps emit PrewarmStepTime / PrewarmFrameTime frames worth each.
+	static constexpr float PrewarmLifetimes = 1.0f; // 0 starts the pool empty
+	static constexpr float PrewarmStepTime = 0.1f;
+	static constexpr float PrewarmFrameTime = 1.0f / 60.0f;
+
+	// Snapshot vars, P saves Snapshot.bin next to the executable, Shift+P restores it and a snapshot found at load warm starts the pool
+	static constexpr bool SnapshotCompression = true;
+	std::filesystem::path SnapshotPath;
+
+	// CPU backend, simulates when compute is off and uploads through a per-frame ring
+	ThreadPool CPUThreadPool;
+	ParticleSystemCPU CPUParticleSystem;
+	ComPtr<ID3D12Resource> CPUUploadBuffer;
+	UINT8* MappedCPUUpload;
+	static const UINT CPUUploadStride = MaxParticleCount * (sizeof(Particle) + sizeof(UINT) + TRAIL_LENGTH * sizeof(float4));
+
 	// Camera vars
 	bool PressingW;
 	bool PressingA;
@@ -162,14 +420,65 @@ private:
 	XMFLOAT4 CameraPosition;
 	const float CameraMoveSpeed = 8;
 
-	ComPtr<ID3D12Resource> TilesTexture;
-	ComPtr<ID3D12Resource> WallTexture;
 	ComPtr<ID3D12Resource> RenderTexture;
 	ComPtr<ID3D12Resource> PlaneBuffer;
 
+	// Texture streaming vars, the particle and wall textures are parsed off the main thread and their mips uploaded on the copy queue,
+	// coarsest first under TextureStreamBudget bytes a frame, down to the mip the residency budget allows for what the frame samples.
+	// A texture's resource holds its resident mips only, from BaseMip down, so a finer mip or an eviction rebuilds it on the copy queue
+	// from the mapped file. The new resource is sampled once the copy queue's fence passed and the old one released once the frames
+	// that sampled it finished. Every frame gets its own SRV, a descriptor a frame in flight reads is never rewritten.
+	struct StreamedTexture
+	{
+		uint32_t Request;
+		ComPtr<ID3D12Resource> Resource;
+		UINT BaseMip; // The file's mip the resource's mip 0 is
+		UINT FrameDescriptors; // First of Window::BufferCount entries
+		D3D12_SRV_DIMENSION ViewDimension;
+	};
+
+	struct TextureRebuild
+	{
+		StreamedTexture* Texture;
+		ComPtr<ID3D12Resource> Resource;
+		UINT BaseMip;
+	};
+
+	struct TextureUploadBatch
+	{
+		uint64_t FenceValue; // Copy queue
+		ComPtr<ID3D12Resource> UploadBuffer;
+		std::vector<TextureStreamUpload> Uploads;
+		std::vector<TextureStreamEviction> Evictions;
+		std::vector<TextureRebuild> Rebuilds;
+	};
+
+	struct RetiredTexture
+	{
+		uint64_t FenceValue; // Direct queue
+		ComPtr<ID3D12Resource> Resource;
+	};
+
+	// M cycles the residency budget
+	static constexpr size_t TextureStreamBudget = 4 * 1024 * 1024;
+	static constexpr size_t TextureBudgets[] = { SIZE_MAX, 1024 * 1024, 256 * 1024, 64 * 1024 };
+	UINT TextureBudget;
+	TextureStreamer Streamer;
+	StreamedTexture TilesTexture;
+	StreamedTexture WallTexture;
+	std::deque<TextureUploadBatch> TextureUploads;
+	std::deque<RetiredTexture> RetiredTextures;
+
+	// Particle atlas vars, TilesTexture is ParticleAtlas.dds, packed from Particle.dds and ParticleTextures\*.dds at load,
+	// or Particle.dds alone when the atlas can't be built. The active emitter's entry goes to the draws as root constants.
+	std::vector<ParticleAtlasEntry> AtlasEntries;
+	ParticleAtlasConstants AtlasConstants;
+
 	// SSAO vars
 	ComPtr<ID3D12Resource> KernelTexture;
 	ComPtr<ID3D12Resource> NoiseTexture;
+	ComPtr<ID3D12Resource> AOTexture;
+	ComPtr<ID3D12Resource> AOBlurTexture;
 	static const UINT KernelSize = 32;
 	static const UINT NoiseSize = 4;
 
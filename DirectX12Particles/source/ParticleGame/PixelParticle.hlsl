@@ -1,9 +1,9 @@
-Texture2D Texture : register(t0);
+Texture2DArray Texture : register(t0);
 SamplerState PointSampler : register(s0);
 
 struct v2f
 {
-    float2 UV : TEXCOORD0;
+    float3 UV : TEXCOORD0;
     float4 color : TEXCOORD1;
 };
 
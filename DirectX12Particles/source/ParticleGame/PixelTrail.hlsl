@@ -0,0 +1,12 @@
+struct v2f
+{
+    float2 UV : TEXCOORD0;
+    float4 color : TEXCOORD1;
+};
+
+// Soft edges across the ribbon, the length fade is already in the vertex alpha
+float4 PSMain(v2f i) : SV_Target
+{
+    float edge = 1.0f - abs(i.UV.x * 2.0f - 1.0f);
+    return float4(i.color.rgb, i.color.a * edge);
+}
@@ -0,0 +1,35 @@
+#ifndef RADIX_SORT_HLSLI
+#define RADIX_SORT_HLSLI
+
+#include "SharedCommon.hlsli"
+
+// 32 bit keys sorted 8 bits per pass, least significant digit first
+#define RADIX_BITS 8
+#define RADIX_BINS 256
+#define RADIX_PASSES 4
+
+// Each onesweep group ranks a tile of RADIX_THREADS * RADIX_KEYS_PER_THREAD keys, RADIX_THREADS must equal RADIX_BINS
+#define RADIX_THREADS 256
+#define RADIX_KEYS_PER_THREAD 4
+#define RADIX_TILE_SIZE 1024
+
+// Partition status words for the decoupled lookback, the top two bits say what the low 30 hold
+#define RADIX_STATUS_AGGREGATE 0x40000000u
+#define RADIX_STATUS_INCLUSIVE 0x80000000u
+#define RADIX_STATUS_FLAGS 0xC0000000u
+#define RADIX_STATUS_COUNT 0x3FFFFFFFu
+
+SHARED_INLINE uint RadixDigit(uint key, uint pass)
+{
+    return (key >> (pass * RADIX_BITS)) & (RADIX_BINS - 1u);
+}
+
+// Orders view depth back to front, furthest particles get the smallest keys so they're drawn first
+SHARED_INLINE uint DepthSortKey(float viewDepth)
+{
+    uint bits = asuint(viewDepth);
+    uint ascending = (bits & 0x80000000u) != 0u ? ~bits : (bits | 0x80000000u);
+    return ~ascending;
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef SPH_HLSLI
+#define SPH_HLSLI
+
+#include "Particle.hlsli"
+
+#define SPH_PI 3.14159265f
+
+// Density and force passes of ComputeSPH.hlsl, dispatched in this order after the spatial hash build
+#define SPH_PHASE_DENSITY 0
+#define SPH_PHASE_FORCES 1
+
+struct SPHConstants
+{
+    float SmoothingRadius; // Kernel support h, the spatial hash cell size has to be at least this
+    float ParticleMass;
+    float RestDensity;
+    float Stiffness; // Pressure = Stiffness * (density - RestDensity), clamped at 0 so the fluid never pulls together
+    float Viscosity;
+    float MaxAcceleration; // Keeps sparse, badly conditioned neighborhoods from exploding
+    uint Enabled;
+    float Padding;
+};
+
+// Müller et al. 2003 kernels, each 0 outside the support radius
+
+SHARED_INLINE float SPHPoly6(float distanceSquared, float h)
+{
+    float h2 = h * h;
+    if (distanceSquared >= h2)
+    {
+        return 0.0f;
+    }
+    float difference = h2 - distanceSquared;
+    float h3 = h2 * h;
+    return 315.0f / (64.0f * SPH_PI * h3 * h3 * h3) * difference * difference * difference;
+}
+
+// Magnitude of the spiky kernel's gradient along the offset, the gradient points away from the neighbor
+SHARED_INLINE float SPHSpikyGradient(float distance, float h)
+{
+    if (distance >= h)
+    {
+        return 0.0f;
+    }
+    float difference = h - distance;
+    float h3 = h * h * h;
+    return -45.0f / (SPH_PI * h3 * h3) * difference * difference;
+}
+
+SHARED_INLINE float SPHViscosityLaplacian(float distance, float h)
+{
+    if (distance >= h)
+    {
+        return 0.0f;
+    }
+    float h3 = h * h * h;
+    return 45.0f / (SPH_PI * h3 * h3) * (h - distance);
+}
+
+// Contribution of a neighbor offset away to the density sum, the particle itself contributes with a zero offset
+SHARED_INLINE float SPHDensityTerm(float3 offset, SPHConstants constants)
+{
+    return constants.ParticleMass * SPHPoly6(dot(offset, offset), constants.SmoothingRadius);
+}
+
+SHARED_INLINE float SPHPressure(float density, SPHConstants constants)
+{
+    return max(constants.Stiffness * (density - constants.RestDensity), 0.0f);
+}
+
+// Pressure and viscosity force density from neighbor j, offset = position i - position j.
+// densityPressure holds (density, pressure) of each particle.
+SHARED_INLINE float3 SPHForceTerm(float3 offset, float3 velocityDelta, float2 densityPressureI, float2 densityPressureJ, SPHConstants constants)
+{
+    float distance = length(offset);
+    if (distance <= 0.0f || distance >= constants.SmoothingRadius)
+    {
+        return float3(0, 0, 0);
+    }
+
+    float3 direction = offset / distance;
+    float pressure = -constants.ParticleMass * (densityPressureI.y + densityPressureJ.y) / (2.0f * densityPressureJ.x)
+        * SPHSpikyGradient(distance, constants.SmoothingRadius);
+    float viscosity = constants.Viscosity * constants.ParticleMass / densityPressureJ.x
+        * SPHViscosityLaplacian(distance, constants.SmoothingRadius);
+    return direction * pressure + velocityDelta * viscosity;
+}
+
+// Turns the summed force density into an acceleration, clamped to MaxAcceleration
+SHARED_INLINE float3 SPHAcceleration(float3 forceDensity, float density, SPHConstants constants)
+{
+    float3 acceleration = forceDensity / max(density, 1e-6f);
+    float magnitude = length(acceleration);
+    if (magnitude > constants.MaxAcceleration)
+    {
+        acceleration = acceleration * (constants.MaxAcceleration / magnitude);
+    }
+    return acceleration;
+}
+
+// Applied before SimulateParticle, which then integrates the emitter acceleration and position as usual
+SHARED_INLINE Particle ApplySPHAcceleration(Particle particle, float3 acceleration, float deltaTime)
+{
+    particle.velocity += float4(acceleration, 0) * deltaTime;
+    return particle;
+}
+
+#endif
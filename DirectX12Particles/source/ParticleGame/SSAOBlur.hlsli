@@ -0,0 +1,19 @@
+#ifndef SSAO_BLUR_HLSLI
+#define SSAO_BLUR_HLSLI
+
+#include "SharedCommon.hlsli"
+
+// Pixels processed per blur thread group, the tile loaded into groupshared is padded by the radius on both sides
+#define SSAO_BLUR_TILE 64
+#define SSAO_BLUR_RADIUS 4
+
+// Bilateral weight of a tap offset pixels away, falls off with the view space depth difference so AO doesn't bleed over edges
+SHARED_INLINE float SSAOBlurWeight(int offset, float centerDepth, float sampleDepth, float sharpness)
+{
+    const float sigma = SSAO_BLUR_RADIUS * 0.5f;
+    float spatial = exp(-(offset * offset) / (2.0f * sigma * sigma));
+    float range = exp(-abs(sampleDepth - centerDepth) * sharpness);
+    return spatial * range;
+}
+
+#endif
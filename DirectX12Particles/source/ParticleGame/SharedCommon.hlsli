@@ -0,0 +1,27 @@
+#ifndef SHARED_COMMON_HLSLI
+#define SHARED_COMMON_HLSLI
+
+// Included first by every header that is shared between the shaders and the CPU code in ParticleCPU.
+// Shared code sticks to constructors and functions from HLSLMath.h, no swizzles or out params.
+#ifdef __cplusplus
+#include "../ParticleCPU/HLSLMath.h"
+#define SHARED_INLINE inline
+
+// Windows.h min/max macros would swallow the vector overloads, HLSLMath.h has scalar versions of both
+#ifdef min
+#undef min
+#endif
+#ifdef max
+#undef max
+#endif
+#else
+#define SHARED_INLINE
+#endif
+
+// Converts a [0, 1] D3D depth value from XMMatrixPerspectiveFovLH into view space distance
+SHARED_INLINE float LinearizeDepth(float z, float nearPlane, float farPlane)
+{
+    return (nearPlane * farPlane) / (farPlane - z * (farPlane - nearPlane));
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef SPATIAL_HASH_HLSLI
+#define SPATIAL_HASH_HLSLI
+
+#include "SharedCommon.hlsli"
+
+// Cell counts are scanned in blocks of SPATIAL_HASH_SCAN_BLOCK, one group then scans the block sums,
+// so the table holds at most SPATIAL_HASH_SCAN_BLOCK * SPATIAL_HASH_SCAN_BLOCK buckets
+#define SPATIAL_HASH_THREADS 256
+#define SPATIAL_HASH_SCAN_BLOCK 1024
+#define SPATIAL_HASH_MAX_TABLE_SIZE (SPATIAL_HASH_SCAN_BLOCK * SPATIAL_HASH_SCAN_BLOCK)
+
+// The 3x3x3 block of cells around a query point
+#define SPATIAL_HASH_NEIGHBOR_CELLS 27
+
+#define SPATIAL_HASH_INVALID_KEY 0xFFFFFFFFu
+
+// Build phases of ComputeSpatialHash.hlsl, dispatched in this order every step
+#define SPATIAL_HASH_PHASE_CLEAR 0
+#define SPATIAL_HASH_PHASE_COUNT 1
+#define SPATIAL_HASH_PHASE_SCAN_CELLS 2
+#define SPATIAL_HASH_PHASE_SCAN_BLOCKS 3
+#define SPATIAL_HASH_PHASE_ADD_BLOCKS 4
+#define SPATIAL_HASH_PHASE_SCATTER 5
+
+struct SpatialHashConstants
+{
+    float CellSize; // At least the query radius, so the 27 cells around a point cover it
+    uint TableSize; // Power of two between SPATIAL_HASH_SCAN_BLOCK and SPATIAL_HASH_MAX_TABLE_SIZE
+    uint ParticleCount; // Particle slots the build scans, dead slots are skipped
+    uint Padding;
+};
+
+SHARED_INLINE int3 SpatialHashCell(float3 position, float cellSize)
+{
+    return int3((int)floor(position.x / cellSize), (int)floor(position.y / cellSize), (int)floor(position.z / cellSize));
+}
+
+// Teschner et al. prime hash, wraps the same way in HLSL and C++ since it's done on uints
+SHARED_INLINE uint SpatialHashKey(int3 cell, uint tableSize)
+{
+    return (((uint)cell.x * 73856093u) ^ ((uint)cell.y * 19349663u) ^ ((uint)cell.z * 83492791u)) & (tableSize - 1u);
+}
+
+// Bucket of neighbor cell n in [0, SPATIAL_HASH_NEIGHBOR_CELLS) around position.
+// Buckets can repeat when two of the cells collide, callers filter neighbors by distance anyway.
+//
+//  for (uint n = 0; n < SPATIAL_HASH_NEIGHBOR_CELLS; ++n)
+//  {
+//      uint key = SpatialHashNeighborKey(position, n, Hash);
+//      for (uint slot = CellStarts[key]; slot < CellStarts[key] + CellCounts[key]; ++slot)
+//      {
+//          uint neighbor = SortedIndices[slot];
+//      }
+//  }
+SHARED_INLINE uint SpatialHashNeighborKey(float3 position, uint n, SpatialHashConstants constants)
+{
+    int3 cell = SpatialHashCell(position, constants.CellSize);
+    return SpatialHashKey(int3(cell.x + (int)(n % 3u) - 1, cell.y + (int)(n / 3u % 3u) - 1, cell.z + (int)(n / 9u) - 1), constants.TableSize);
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef SUB_EMITTER_HLSLI
+#define SUB_EMITTER_HLSLI
+
+#include "Particle.hlsli"
+
+// Simulate appends one event per particle that dies or collides, a follow-up pass spawns a burst of children from each.
+// Every event type owns SUB_EMITTER_MAX_EVENTS slots of the event buffer. Appending claims a slot with an atomic add on
+// the type's counter and only writes when the slot is in range, so it never blocks and events past the end are dropped.
+#define SUB_EMITTER_EVENT_DEATH 0
+#define SUB_EMITTER_EVENT_COLLISION 1
+#define SUB_EMITTER_EVENT_TYPES 2
+#define SUB_EMITTER_MAX_EVENTS 1024
+#define SUB_EMITTER_THREADS 64
+
+// Emitters spawn generation 1 and a child is one more than its parent, position.w stays 1 for the view transforms and sort keys.
+// Only generations up to this raise events, children of children would otherwise chain until every dead slot is taken.
+#define SUB_EMITTER_MAX_GENERATION 1
+
+// Uints of the counter buffer. Simulate adds to the append counters, ComputeGenerateArgs.hlsl clamps them
+// into the spawn counters the spawn pass reads and zeroes them for the next frame.
+#define SUB_EMITTER_COUNTER_DEATH 0
+#define SUB_EMITTER_COUNTER_COLLISION 1
+#define SUB_EMITTER_COUNTER_DEATH_EVENTS 2 // Death events this frame, at most SUB_EMITTER_MAX_EVENTS
+#define SUB_EMITTER_COUNTER_SPAWNS 3 // Children this frame, at most the dead particle count
+#define SUB_EMITTER_COUNTER_COUNT 4
+
+struct SubEmitterEvent
+{
+    float3 Position; // Where the particle died or its contact point after the bounce
+    uint Generation;
+    float3 Velocity; // After the bounce for collisions, so splashes follow the reflection
+    uint Tint;
+    float3 Acceleration;
+};
+
+// Root constants of the args and spawn passes
+struct SubEmitterConstants
+{
+    uint DeathBurst; // Children per death event, 0 turns death events off
+    uint CollisionBurst; // Children per collision event, 0 turns collision events off
+    float Speed; // Children fly out in random directions at up to this speed
+    float InheritVelocity; // Fraction of the event's velocity the children keep
+    uint Seed; // Changes every frame so events at the same spot don't spawn the same burst
+};
+
+// Bit per event type simulate raises, 0 when sub-emitters are off
+SHARED_INLINE uint SubEmitterEventMask(SubEmitterConstants constants)
+{
+    return (constants.DeathBurst > 0 ? 1u << SUB_EMITTER_EVENT_DEATH : 0u) | (constants.CollisionBurst > 0 ? 1u << SUB_EMITTER_EVENT_COLLISION : 0u);
+}
+
+SHARED_INLINE uint SubEmitterEventIndex(uint type, uint slot)
+{
+    return type * SUB_EMITTER_MAX_EVENTS + slot;
+}
+
+SHARED_INLINE uint ParticleGeneration(Particle particle)
+{
+    return particle.generation;
+}
+
+SHARED_INLINE bool SubEmitterRaisesEvents(Particle particle)
+{
+    return ParticleGeneration(particle) <= SUB_EMITTER_MAX_GENERATION;
+}
+
+// Collision responses always change the velocity, or kill the particle with KillOnHit
+SHARED_INLINE bool SubEmitterCollided(Particle before, Particle after)
+{
+    return after.velocity.x != before.velocity.x || after.velocity.y != before.velocity.y || after.velocity.z != before.velocity.z ||
+           after.lifeTimeLeft != before.lifeTimeLeft;
+}
+
+SHARED_INLINE SubEmitterEvent MakeSubEmitterEvent(Particle particle)
+{
+    SubEmitterEvent event;
+    event.Position = float3(particle.position.x, particle.position.y, particle.position.z);
+    event.Generation = ParticleGeneration(particle);
+    event.Velocity = float3(particle.velocity.x, particle.velocity.y, particle.velocity.z);
+    event.Tint = particle.tint;
+    event.Acceleration = float3(particle.acceleration.x, particle.acceleration.y, particle.acceleration.z);
+    return event;
+}
+
+// Children of this frame's events, cut short when there aren't enough dead particles. Death bursts come first.
+SHARED_INLINE uint SubEmitterSpawnCount(uint deathEvents, uint collisionEvents, uint deadCount, SubEmitterConstants constants)
+{
+    return min(deathEvents * constants.DeathBurst + collisionEvents * constants.CollisionBurst, deadCount);
+}
+
+// Event buffer index and child number of the spawn thread at spawnIndex
+SHARED_INLINE uint2 SubEmitterLocateChild(uint spawnIndex, uint deathEvents, SubEmitterConstants constants)
+{
+    uint deathSpawns = deathEvents * constants.DeathBurst;
+    if (spawnIndex < deathSpawns)
+    {
+        return uint2(SubEmitterEventIndex(SUB_EMITTER_EVENT_DEATH, spawnIndex / constants.DeathBurst), spawnIndex % constants.DeathBurst);
+    }
+    spawnIndex -= deathSpawns;
+    return uint2(SubEmitterEventIndex(SUB_EMITTER_EVENT_COLLISION, spawnIndex / constants.CollisionBurst), spawnIndex % constants.CollisionBurst);
+}
+
+// Children start a full emitter lifetime like emitted particles, so the scale, curves and trails treat them the same
+SHARED_INLINE Particle SpawnSubEmitterParticle(SubEmitterEvent event, uint eventIndex, uint child, SubEmitterConstants constants, EmitterConstants emitter)
+{
+    float randomValue0 = ParticleRandom(float2(eventIndex + constants.Seed, child));
+    float randomValue1 = ParticleRandom(float2(child * 7 + constants.Seed, randomValue0));
+    float randomValue2 = ParticleRandom(float2(randomValue1, eventIndex * 3 + child));
+
+    // Uniform direction on the sphere, the speed keeps some spread so bursts aren't a hollow shell
+    float z = randomValue0 * 2.0f - 1.0f;
+    float ring = sqrt(saturate(1.0f - z * z));
+    float angle = randomValue1 * 6.28318530718f;
+    float3 direction = float3(ring * cos(angle), ring * sin(angle), z);
+    float3 velocity = event.Velocity * constants.InheritVelocity + direction * (constants.Speed * lerp(0.5f, 1.0f, randomValue2));
+
+    Particle particle;
+    particle.position = float4(event.Position, 1);
+    particle.velocity = float4(velocity, 0);
+    particle.acceleration = float4(event.Acceleration, 0);
+    particle.color = UnpackParticleTint(event.Tint);
+    particle.lifeTimeLeft = emitter.particleLifetime;
+    particle.scale = emitter.particleStartScale;
+    particle.rotation = 0;
+    particle.tint = event.Tint;
+    particle.generation = event.Generation + 1;
+    return particle;
+}
+
+#endif
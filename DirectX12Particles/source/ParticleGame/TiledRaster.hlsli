@@ -0,0 +1,172 @@
+#ifndef TILED_RASTER_HLSLI
+#define TILED_RASTER_HLSLI
+
+#include "Particle.hlsli"
+
+// Screen tiles are composited by one 16x16 group each. A tile draws at most TILE_RASTER_MAX_ENTRIES particles, the ones
+// lowest in the draw list, and TileEntries holds TILE_RASTER_MAX_ENTRIES per tile on average.
+#define TILE_RASTER_SIZE 16
+#define TILE_RASTER_THREADS 256
+#define TILE_RASTER_MAX_ENTRIES 512
+
+// Tile counts are scanned in blocks of TILE_RASTER_SCAN_BLOCK, one group then scans the block sums,
+// so a screen holds at most TILE_RASTER_SCAN_BLOCK * TILE_RASTER_SCAN_BLOCK tiles
+#define TILE_RASTER_SCAN_BLOCK (TILE_RASTER_THREADS * 4)
+
+// Bin phases of ComputeTileBin.hlsl, dispatched in this order every frame. Every tile gets an exact list of the draw positions
+// covering it, counted, scanned into starts and scattered like the spatial hash build.
+#define TILE_RASTER_PHASE_COUNT 0
+#define TILE_RASTER_PHASE_SCAN_TILES 1
+#define TILE_RASTER_PHASE_SCAN_BLOCKS 2
+#define TILE_RASTER_PHASE_ADD_BLOCKS 3
+#define TILE_RASTER_PHASE_SCATTER 4
+
+// Sections of the TileLists buffer, each one uint per tile but the block sums
+#define TILE_LIST_COUNT 0 // The composite pass zeroes it for the next frame
+#define TILE_LIST_START 1
+#define TILE_LIST_CURSOR 2 // Scatter slots taken so far, zeroed when the starts are done
+#define TILE_LIST_BLOCK_SUMS 3
+
+// Root constants shared by the bin and composite passes
+struct TileRasterConstants
+{
+    float4x4 View;
+    float4x4 Projection;
+    uint2 Dimensions;
+    uint2 TileCount;
+    uint DrawArgsOffset; // Byte offset of this frame's instance count in IndirectDrawArgs
+    uint AlphaBlend; // 0 matches ParticleRenderPSO's additive blend, 1 ParticleAlphaPSO's premultiplied blend
+    uint Phase; // TILE_RASTER_PHASE_* of the bin pass
+};
+
+SHARED_INLINE uint TileListIndex(uint section, uint tile, TileRasterConstants constants)
+{
+    return section * constants.TileCount.x * constants.TileCount.y + tile;
+}
+
+// Uints of the TileLists buffer for tileCount tiles
+SHARED_INLINE uint TileListSize(uint tileCount)
+{
+    return TILE_LIST_BLOCK_SUMS * tileCount + (tileCount + TILE_RASTER_SCAN_BLOCK - 1) / TILE_RASTER_SCAN_BLOCK;
+}
+
+// Whether a tile's list lies within TileEntries. A tile past the end keeps none of its entries rather than whichever scattered first.
+SHARED_INLINE bool TileListFits(uint start, uint count, TileRasterConstants constants)
+{
+    return start + count <= constants.TileCount.x * constants.TileCount.y * TILE_RASTER_MAX_ENTRIES;
+}
+
+// Screen space footprint of a billboard. Rect is the bounding rect (minX, minY, maxX, maxY) of the rolled quad in pixels,
+// UVAxes the inverse of its pixel half-axes, rows x and y map a pixel's offset from Center to the quad's [-1, 1] coordinates.
+struct ParticleFootprint
+{
+    float4 Rect;
+    float4 UVAxes;
+    float2 Center;
+    float Depth;
+    uint Valid;
+};
+
+SHARED_INLINE float2 ClipToPixel(float4 clip, float width, float height)
+{
+    // NDC y points up, pixel y down
+    return float2((clip.x / clip.w * 0.5f + 0.5f) * width, (0.5f - clip.y / clip.w * 0.5f) * height);
+}
+
+// Projects the same camera facing quad VertexParticle.hlsl draws, corners at +-scale in view space rolled by the rotation.
+// The quad is parallel to the near plane, so its projection is the affine image of the square and inverts exactly.
+SHARED_INLINE ParticleFootprint ProjectParticle(Particle particle, TileRasterConstants constants)
+{
+    ParticleFootprint footprint;
+    footprint.Rect = float4(0, 0, 0, 0);
+    footprint.UVAxes = float4(0, 0, 0, 0);
+    footprint.Center = float2(0, 0);
+    footprint.Depth = 1.0f;
+    footprint.Valid = 0;
+
+    float4 viewPosition = mul(constants.View, particle.position);
+    float4 center = mul(constants.Projection, viewPosition);
+    if (particle.lifeTimeLeft <= 0 || center.w <= 0 || center.z < 0)
+    {
+        return footprint;
+    }
+
+    float s = sin(particle.rotation);
+    float c = cos(particle.rotation);
+    float width = (float)constants.Dimensions.x;
+    float height = (float)constants.Dimensions.y;
+    footprint.Center = ClipToPixel(center, width, height);
+    float2 axisU = ClipToPixel(mul(constants.Projection, viewPosition + float4(c, s, 0, 0) * particle.scale), width, height) - footprint.Center;
+    float2 axisV = ClipToPixel(mul(constants.Projection, viewPosition + float4(-s, c, 0, 0) * particle.scale), width, height) - footprint.Center;
+    float determinant = axisU.x * axisV.y - axisU.y * axisV.x;
+    if (determinant == 0)
+    {
+        return footprint;
+    }
+
+    float2 extent = abs(axisU) + abs(axisV);
+    footprint.Rect = float4(footprint.Center.x - extent.x, footprint.Center.y - extent.y, footprint.Center.x + extent.x, footprint.Center.y + extent.y);
+    footprint.UVAxes = float4(axisV.y, -axisV.x, -axisU.y, axisU.x) / determinant;
+    footprint.Depth = center.z / center.w;
+    footprint.Valid = footprint.Rect.z > 0 && footprint.Rect.w > 0 && footprint.Rect.x < width && footprint.Rect.y < height && footprint.Depth <= 1.0f;
+    return footprint;
+}
+
+// Inclusive tile range (minX, minY, maxX, maxY) the footprint's pixel centers can fall in
+SHARED_INLINE uint4 FootprintTiles(ParticleFootprint footprint, TileRasterConstants constants)
+{
+    float maxX = (float)(constants.Dimensions.x - 1);
+    float maxY = (float)(constants.Dimensions.y - 1);
+    return uint4(
+        (uint)clamp(footprint.Rect.x, 0.0f, maxX) / TILE_RASTER_SIZE,
+        (uint)clamp(footprint.Rect.y, 0.0f, maxY) / TILE_RASTER_SIZE,
+        (uint)clamp(footprint.Rect.z, 0.0f, maxX) / TILE_RASTER_SIZE,
+        (uint)clamp(footprint.Rect.w, 0.0f, maxY) / TILE_RASTER_SIZE);
+}
+
+// Quad UV under a pixel center, v = 0 at the bottom edge like the vertices VertexParticle.hlsl draws
+SHARED_INLINE float2 FootprintUV(ParticleFootprint footprint, float2 pixelCenter)
+{
+    float2 offset = pixelCenter - footprint.Center;
+    float2 corner = float2(
+        footprint.UVAxes.x * offset.x + footprint.UVAxes.y * offset.y,
+        footprint.UVAxes.z * offset.x + footprint.UVAxes.w * offset.y);
+    return corner * 0.5f + float2(0.5f, 0.5f);
+}
+
+// Texel of a size sized texture at a UV, matches the point sampler
+SHARED_INLINE int2 UVTexel(float2 uv, uint2 size)
+{
+    return int2(
+        clamp((int)floor(uv.x * size.x), 0, (int)size.x - 1),
+        clamp((int)floor(uv.y * size.y), 0, (int)size.y - 1));
+}
+
+// Texel of a size sized texture under a pixel center, matches the point sampled quad UVs
+SHARED_INLINE int2 FootprintTexel(ParticleFootprint footprint, float2 pixelCenter, uint2 size)
+{
+    return UVTexel(FootprintUV(footprint, pixelCenter), size);
+}
+
+// Whether a pixel center lies on the quad, left and top edges included like the unrolled rect
+SHARED_INLINE bool FootprintCovers(ParticleFootprint footprint, float2 pixelCenter)
+{
+    float2 uv = FootprintUV(footprint, pixelCenter);
+    return uv.x >= 0 && uv.x < 1 && uv.y > 0 && uv.y <= 1;
+}
+
+// Output merger equivalent of the particle PSOs, source is the pixel shader's texture alpha * color
+SHARED_INLINE float4 TileRasterBlend(float4 destination, float4 source, uint alphaBlend)
+{
+    if (alphaBlend)
+    {
+        return source + destination * (1.0f - source.w);
+    }
+    return float4(
+        source.x * source.w + destination.x,
+        source.y * source.w + destination.y,
+        source.z * source.w + destination.z,
+        source.w * source.w + destination.w * destination.w);
+}
+
+#endif
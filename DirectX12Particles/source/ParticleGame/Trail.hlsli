@@ -0,0 +1,76 @@
+#ifndef TRAIL_HLSLI
+#define TRAIL_HLSLI
+
+#include "Particle.hlsli"
+
+// Every particle keeps its last TRAIL_LENGTH positions in a ring. Slot s of particle p is element s * maxParticleCount + p,
+// so the simulate threads writing one slot touch neighboring elements.
+#define TRAIL_LENGTH 8
+#define TRAIL_VERTICES_PER_PARTICLE (2 * TRAIL_LENGTH)
+#define TRAIL_INDICES_PER_PARTICLE (6 * (TRAIL_LENGTH - 1))
+#define TRAIL_THREADS 64
+#define TRAIL_HEAD_NONE 0xffffffff // Simulate leaves the history alone
+#define TRAIL_HEAD_RESET 0x80000000 // Or'd into the head, every slot of every particle restarts at its position
+
+// One ribbon vertex, two per history sample
+struct TrailVertex
+{
+    float3 Position;
+    uint Color; // RGBA8 like Particle.tint
+    float2 UV; // x across the ribbon, y from the particle (0) to its oldest sample (1)
+};
+
+// Root constants of the ribbon pass
+struct TrailConstants
+{
+    float3 CameraPosition;
+    uint Head; // Slot simulate wrote this frame
+    float WidthScale; // Ribbon half width = particle scale at the sample * WidthScale
+    uint MaxParticleCount;
+    uint DrawArgsOffset; // Byte offset of this frame's visible count in IndirectDrawArgs
+    uint Padding;
+};
+
+SHARED_INLINE uint TrailHistoryIndex(uint slot, uint particleIndex, uint maxParticleCount)
+{
+    return slot * maxParticleCount + particleIndex;
+}
+
+// Slot of the sample written age frames before head
+SHARED_INLINE uint TrailSlot(uint head, uint age)
+{
+    return (head + TRAIL_LENGTH - age) % TRAIL_LENGTH;
+}
+
+// What simulate stores per sample, the scale lets the ribbon follow the particle's size over its life
+SHARED_INLINE float4 TrailSample(Particle particle)
+{
+    return float4(particle.position.x, particle.position.y, particle.position.z, particle.scale);
+}
+
+// Trail direction at a sample, from its older neighbor to its newer one. The end samples use themselves as the missing neighbor.
+SHARED_INLINE float3 TrailTangent(float4 newer, float4 older)
+{
+    return float3(newer.x - older.x, newer.y - older.y, newer.z - older.z);
+}
+
+// One side of the ribbon at a history sample. The ribbon is widened across both the trail and the view ray, so it faces the camera.
+// A collapsed trail, like the one of a particle that just spawned, gets zero width.
+SHARED_INLINE TrailVertex MakeTrailVertex(float4 trailSample, float3 tangent, float side, uint age, float4 color, TrailConstants constants)
+{
+    float3 position = float3(trailSample.x, trailSample.y, trailSample.z);
+    float3 across = cross(tangent, constants.CameraPosition - position);
+    float acrossLength = length(across);
+    across = acrossLength > 0.000001f ? across / acrossLength : float3(0, 0, 0);
+
+    // Fades out towards the oldest sample
+    float fade = (float)age / (float)(TRAIL_LENGTH - 1);
+
+    TrailVertex vertex;
+    vertex.Position = position + across * (side * trailSample.w * constants.WidthScale);
+    vertex.Color = PackParticleTint(float4(color.x, color.y, color.z, color.w * (1.0f - fade)));
+    vertex.UV = float2(side * 0.5f + 0.5f, fade);
+    return vertex;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef VECTOR_FIELD_HLSLI
+#define VECTOR_FIELD_HLSLI
+
+#include "SharedCommon.hlsli"
+
+// Imported vector field volumes bound at once, one Texture3D each
+#define VECTOR_FIELD_MAX_COUNT 4
+
+struct VectorFieldInstance
+{
+    float4x4 WorldToVolume; // World position to [0, 1] texture coordinates over the field's bounds, uploaded like CullConstants.HiZView
+    float Strength; // Scales the sampled vectors
+    float Tightness; // 0 adds the field as an acceleration, 1 sets the particle velocity to the field's
+    uint2 Padding;
+};
+
+struct VectorFieldConstants
+{
+    VectorFieldInstance Fields[VECTOR_FIELD_MAX_COUNT];
+    uint Count;
+    float3 Padding;
+};
+
+SHARED_INLINE float3 VectorFieldCoordinates(float3 position, VectorFieldInstance field)
+{
+    float4 uvw = mul(field.WorldToVolume, float4(position, 1.0f));
+    return float3(uvw.x, uvw.y, uvw.z);
+}
+
+// Fields only act inside their bounds, the sampler clamps so edge texels would otherwise stretch out forever
+SHARED_INLINE bool VectorFieldInside(float3 uvw)
+{
+    return uvw.x >= 0.0f && uvw.y >= 0.0f && uvw.z >= 0.0f && uvw.x <= 1.0f && uvw.y <= 1.0f && uvw.z <= 1.0f;
+}
+
+// New particle velocity after one step inside a field that sampled value at the particle
+SHARED_INLINE float3 VectorFieldApply(float3 value, float3 velocity, VectorFieldInstance field, float deltaTime)
+{
+    float3 fieldVector = value * field.Strength;
+    float3 accelerated = velocity + fieldVector * deltaTime;
+    return lerp(accelerated, fieldVector, saturate(field.Tightness));
+}
+
+#endif
@@ -18,6 +18,7 @@ cbuffer RootConstants : register(b1)
     float4 emitAccelerationMax;
     float particleStartScale;
     float particleEndScale;
+    uint curveSet;
 };
 
 struct appdata
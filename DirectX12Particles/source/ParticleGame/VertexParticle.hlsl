@@ -1,14 +1,8 @@
-struct ParticleData
-{
-    float4 position;
-    float4 velocity;
-    float4 acceleration;
-    float4 color;
-    float lifeTimeLeft;
-    float scale;
-};
+#include "Particle.hlsli"
+#include "ParticleAtlas.hlsli"
 
-StructuredBuffer<ParticleData> Particles : register(t0);
+StructuredBuffer<Particle> Particles : register(t0);
+StructuredBuffer<uint> VisibleIndices : register(t1);
 
 cbuffer RootConstants : register(b0)
 {
@@ -16,6 +10,8 @@ cbuffer RootConstants : register(b0)
     matrix P;
 };
 
+ConstantBuffer<ParticleAtlasConstants> Atlas : register(b1);
+
 struct appdata
 {
     float3 Position : POSITION;
@@ -24,7 +20,7 @@ struct appdata
 
 struct v2f
 {
-    float2 UV: TEXCOORD0;
+    float3 UV : TEXCOORD0; // z is the atlas slice
     float4 color : TEXCOORD1;
     float4 Position : SV_Position;
 };
@@ -32,10 +28,14 @@ struct v2f
 v2f VSMain(appdata i, uint instanceID : SV_InstanceID)
 {
     v2f o;
-    ParticleData data = Particles[instanceID];
+    Particle data = Particles[VisibleIndices[instanceID]];
     
-    o.Position = mul(P, mul(V, data.position) + float4(i.Position.x, i.Position.y, 0, 0) * float4(data.scale, data.scale, 1, 1));
-    o.UV = i.UV;
+    // Roll the corner around the view axis so rotation over lifetime spins the billboard in screen space
+    float s = sin(data.rotation);
+    float c = cos(data.rotation);
+    float2 corner = float2(i.Position.x * c - i.Position.y * s, i.Position.x * s + i.Position.y * c);
+    o.Position = mul(P, mul(V, data.position) + float4(corner.x, corner.y, 0, 0) * float4(data.scale, data.scale, 1, 1));
+    o.UV = ParticleAtlasUV(i.UV, ParticleAtlasFrame(data.lifeTimeLeft, Atlas), Atlas);
     o.color = data.color;
     
     if (data.lifeTimeLeft <= 0) o.Position = float4(0, 0, 0, 0);
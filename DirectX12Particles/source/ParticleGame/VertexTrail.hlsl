@@ -0,0 +1,28 @@
+#include "Trail.hlsli"
+
+StructuredBuffer<TrailVertex> TrailVertices : register(t0);
+
+cbuffer RootConstants : register(b0)
+{
+    matrix V;
+    matrix P;
+};
+
+struct v2f
+{
+    float2 UV : TEXCOORD0;
+    float4 color : TEXCOORD1;
+    float4 Position : SV_Position;
+};
+
+// Pulls the ribbon vertices ComputeTrails.hlsl wrote, the index buffer stitches every trail into quads
+v2f VSMain(uint vertexID : SV_VertexID)
+{
+    TrailVertex vertex = TrailVertices[vertexID];
+
+    v2f o;
+    o.Position = mul(P, mul(V, float4(vertex.Position, 1)));
+    o.UV = vertex.UV;
+    o.color = UnpackParticleTint(vertex.Color);
+    return o;
+}
@@ -0,0 +1,296 @@
+// BC1/BC3/BC4/BC7 round trips against PSNR floors, hand built blocks, scalar against SSE2 against threads, and the DDS mip chain
+#include "Check.h"
+#include "BlockCompression.h"
+#include "DDSFile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Soft round sprite with alpha, a smooth color gradient and a gray ramp, the kinds of particle texture each format is picked for
+static Image MakeImage(uint32_t kind, uint32_t size)
+{
+	Image image;
+	image.Width = size;
+	image.Height = size;
+	image.Pixels.resize(static_cast<size_t>(size) * size * 4);
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			uint8_t* pixel = image.Pixels.data() + (static_cast<size_t>(y) * size + x) * 4;
+			const float u = (x + 0.5f) / size;
+			const float v = (y + 0.5f) / size;
+			if (kind == 0)
+			{
+				const float falloff = std::fmax(0.0f, 1.0f - std::sqrt((u * 2 - 1) * (u * 2 - 1) + (v * 2 - 1) * (v * 2 - 1)));
+				pixel[0] = 255;
+				pixel[1] = static_cast<uint8_t>(120 + 135 * falloff);
+				pixel[2] = static_cast<uint8_t>(40 + 200 * falloff * falloff);
+				pixel[3] = static_cast<uint8_t>(255 * falloff * falloff);
+			}
+			else if (kind == 1)
+			{
+				pixel[0] = static_cast<uint8_t>(255 * u);
+				pixel[1] = static_cast<uint8_t>(255 * v);
+				pixel[2] = static_cast<uint8_t>(128 + 127 * std::sin(6.0f * (u + v)));
+				pixel[3] = 255;
+			}
+			else
+			{
+				pixel[0] = pixel[1] = pixel[2] = static_cast<uint8_t>((x + y) * 255 / (2 * size - 2));
+				pixel[3] = 255;
+			}
+		}
+	}
+	return image;
+}
+
+static double RoundTripPSNR(const Image& image, uint32_t format, ThreadPool& pool)
+{
+	std::vector<uint8_t> blocks;
+	CompressImage(image, format, pool, true, blocks);
+	Image decoded;
+	DecompressImage(blocks.data(), format, image.Width, image.Height, decoded);
+	return ComputePSNR(image, decoded, GetBlockFormatChannels(format));
+}
+
+// Floors sit about 1.5 dB under what the encoder reaches today, a drop past them is a regression in the endpoint fit
+static void TestPSNR()
+{
+	ThreadPool pool(1);
+	const Image sprite = MakeImage(0, 64);
+	const Image gradient = MakeImage(1, 64);
+	const Image ramp = MakeImage(2, 64);
+	CHECK(RoundTripPSNR(gradient, BLOCK_FORMAT_BC1, pool) > 35.0);
+	CHECK(RoundTripPSNR(ramp, BLOCK_FORMAT_BC1, pool) > 44.0);
+	CHECK(RoundTripPSNR(sprite, BLOCK_FORMAT_BC3, pool) > 44.0);
+	CHECK(RoundTripPSNR(ramp, BLOCK_FORMAT_BC4, pool) > 51.0);
+	CHECK(RoundTripPSNR(sprite, BLOCK_FORMAT_BC7, pool) > 52.0);
+	CHECK(RoundTripPSNR(gradient, BLOCK_FORMAT_BC7, pool) > 39.0);
+
+	CHECK(std::isinf(ComputePSNR(sprite, sprite, 4)));
+	Image brighter = ramp;
+	for (size_t n = 0; n < brighter.Pixels.size(); n += 4)
+	{
+		brighter.Pixels[n] = static_cast<uint8_t>(brighter.Pixels[n] ^ 1);
+	}
+	// Off by one in every red texel: 10 log10(255^2)
+	CHECK_NEAR(ComputePSNR(ramp, brighter, 1), 48.1308, 1e-3);
+}
+
+// Every texel of a 4x4 block the same color
+static void SolidBlock(uint8_t r, uint8_t g, uint8_t b, uint8_t a, uint8_t* pixels)
+{
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		pixels[n * 4 + 0] = r;
+		pixels[n * 4 + 1] = g;
+		pixels[n * 4 + 2] = b;
+		pixels[n * 4 + 3] = a;
+	}
+}
+
+static int MaxDifference(const uint8_t* a, const uint8_t* b, uint32_t channelCount)
+{
+	int largest = 0;
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			largest = (std::max)(largest, std::abs(a[n * 4 + c] - b[n * 4 + c]));
+		}
+	}
+	return largest;
+}
+
+static void TestSolidBlocks()
+{
+	uint8_t pixels[64];
+	uint8_t decoded[64];
+	uint8_t block[16];
+	bool bc1 = true;
+	bool bc4 = true;
+	bool bc7 = true;
+	for (uint32_t value = 0; value < 256; value += 5)
+	{
+		const uint8_t r = static_cast<uint8_t>(value);
+		const uint8_t g = static_cast<uint8_t>(255 - value);
+		const uint8_t b = static_cast<uint8_t>(value * 7);
+		SolidBlock(r, g, b, static_cast<uint8_t>(value / 2), pixels);
+
+		// 565 endpoints are within half a step of 8 or 4 levels, a one color block still has to decode opaque
+		EncodeBC1Block(pixels, block, true);
+		DecodeBC1Block(block, decoded);
+		bc1 &= MaxDifference(pixels, decoded, 3) <= 4 && decoded[3] == 255 && decoded[63] == 255;
+
+		EncodeBC4Block(pixels, block, true);
+		DecodeBC4Block(block, decoded);
+		bc4 &= decoded[0] == r && decoded[1] == 0 && decoded[2] == 0 && decoded[3] == 255 && MaxDifference(pixels, decoded, 1) == 0;
+
+		// 7 bit endpoints and a p-bit reach every 8 bit value through the palette
+		EncodeBC7Block(pixels, block, true);
+		DecodeBC7Block(block, decoded);
+		bc7 &= (block[0] & 0x7f) == 0x40 && MaxDifference(pixels, decoded, 4) <= 1;
+	}
+	CHECK(bc1);
+	CHECK(bc4);
+	CHECK(bc7);
+
+	// BC4 keeps 0 and 255 exact next to midtones, the six level mode has them as fixed levels
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		pixels[n * 4] = static_cast<uint8_t>(n % 4 == 0 ? 0 : n % 4 == 1 ? 255 : 100 + n);
+	}
+	EncodeBC4Block(pixels, block, true);
+	DecodeBC4Block(block, decoded);
+	CHECK(decoded[0] == 0 && decoded[4] == 255 && decoded[16] == 0 && decoded[20] == 255);
+	CHECK(MaxDifference(pixels, decoded, 1) <= 4);
+
+	// BC3 is BC4 alpha then BC1 color
+	SolidBlock(200, 100, 50, 77, pixels);
+	EncodeBC3Block(pixels, block, true);
+	DecodeBC3Block(block, decoded);
+	CHECK(decoded[3] == 77 && decoded[63] == 77);
+	CHECK(MaxDifference(pixels, decoded, 3) <= 4);
+}
+
+static void PutBits(uint8_t* block, uint32_t& offset, uint32_t value, uint32_t count)
+{
+	for (uint32_t n = 0; n < count; ++n, ++offset)
+	{
+		block[offset / 8] |= static_cast<uint8_t>(((value >> n) & 1) << (offset % 8));
+	}
+}
+
+static void TestHandBlocks()
+{
+	uint8_t decoded[64];
+
+	// BC1 four color mode: c0 = pure red 0xf800 > c1 = pure blue 0x001f, texel n takes index n % 4
+	// Index 2 is (2 * 255 + 0 + 1) / 3 = 170 red and 85 blue, index 3 the other way round
+	const uint8_t bc1[8] = { 0x00, 0xf8, 0x1f, 0x00, 0xe4, 0xe4, 0xe4, 0xe4 };
+	DecodeBC1Block(bc1, decoded);
+	CHECK(decoded[0] == 255 && decoded[1] == 0 && decoded[2] == 0 && decoded[3] == 255);
+	CHECK(decoded[4] == 0 && decoded[5] == 0 && decoded[6] == 255);
+	CHECK(decoded[8] == 170 && decoded[10] == 85);
+	CHECK(decoded[12] == 85 && decoded[14] == 170 && decoded[15] == 255);
+
+	// Swapped endpoints select three color mode: index 2 is the average, index 3 transparent black
+	const uint8_t bc1Alpha[8] = { 0x1f, 0x00, 0x00, 0xf8, 0xe4, 0xe4, 0xe4, 0xe4 };
+	DecodeBC1Block(bc1Alpha, decoded);
+	CHECK(decoded[8] == 127 && decoded[10] == 127 && decoded[11] == 255);
+	CHECK(decoded[12] == 0 && decoded[13] == 0 && decoded[14] == 0 && decoded[15] == 0);
+
+	// BC4 eight levels: r0 = 210 > r1 = 70, index 2 is (6 * 210 + 70 + 3) / 7 = 190. Texel n takes index n % 8.
+	const uint8_t bc4[8] = { 210, 70, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa };
+	DecodeBC4Block(bc4, decoded);
+	CHECK(decoded[0] == 210 && decoded[4] == 70 && decoded[8] == 190 && decoded[28] == 90);
+	CHECK(decoded[32] == 210 && decoded[60] == 90 && decoded[1] == 0 && decoded[3] == 255);
+
+	// BC7 mode 6 with endpoints 0 and 127 * 2 + 1 = 255 on every channel, texel n takes index n, texel 0's index has 3 bits.
+	// Index i decodes to (w[i] * 255 + 32) >> 6: 0, 16, 36 ... 255.
+	uint8_t bc7[16] = {};
+	uint32_t offset = 0;
+	PutBits(bc7, offset, 1 << 6, 7);
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		PutBits(bc7, offset, 0, 7);
+		PutBits(bc7, offset, 127, 7);
+	}
+	PutBits(bc7, offset, 0, 1);
+	PutBits(bc7, offset, 1, 1);
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		PutBits(bc7, offset, n, n == 0 ? 3 : 4);
+	}
+	CHECK(offset == 128);
+	DecodeBC7Block(bc7, decoded);
+	static const uint8_t expected[16] = { 0, 16, 36, 52, 68, 84, 104, 120, 135, 151, 171, 187, 203, 219, 239, 255 };
+	bool matches = true;
+	for (uint32_t n = 0; n < 16; ++n)
+	{
+		matches &= decoded[n * 4] == expected[n] && decoded[n * 4 + 1] == expected[n] && decoded[n * 4 + 3] == expected[n];
+	}
+	CHECK(matches);
+
+	// Only mode 6 is written, any other mode decodes to zero rather than garbage
+	memset(decoded, 0xcc, sizeof(decoded));
+	uint8_t mode5[16] = { 0x20, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	DecodeBC7Block(mode5, decoded);
+	CHECK(MaxDifference(decoded, std::vector<uint8_t>(64, 0).data(), 4) == 0);
+}
+
+static void TestSameBytes()
+{
+	// The scalar and SSE2 index searches and any thread count give the same blocks
+	ThreadPool single(1);
+	ThreadPool pool(4);
+	const Image images[3] = { MakeImage(0, 36), MakeImage(1, 36), MakeImage(2, 36) };
+	for (const Image& image : images)
+	{
+		for (uint32_t format : { BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC3, BLOCK_FORMAT_BC4, BLOCK_FORMAT_BC7 })
+		{
+			std::vector<uint8_t> scalar;
+			std::vector<uint8_t> simd;
+			std::vector<uint8_t> threaded;
+			CompressImage(image, format, single, false, scalar);
+			CompressImage(image, format, single, true, simd);
+			CompressImage(image, format, pool, true, threaded);
+			CHECK(scalar.size() == GetDDSSurfaceSize(format, image.Width, image.Height));
+			CHECK(scalar == simd);
+			CHECK(simd == threaded);
+		}
+	}
+}
+
+static void TestImages()
+{
+	CHECK(ChooseBlockFormat(MakeImage(0, 8)) == BLOCK_FORMAT_BC7);
+	CHECK(ChooseBlockFormat(MakeImage(1, 8)) == BLOCK_FORMAT_BC1);
+	CHECK(ChooseBlockFormat(MakeImage(2, 8)) == BLOCK_FORMAT_BC4);
+	CHECK(GetBlockFormatChannels(BLOCK_FORMAT_BC1) == 3 && GetBlockFormatChannels(BLOCK_FORMAT_BC4) == 1 && GetBlockFormatChannels(BLOCK_FORMAT_BC7) == 4);
+	CHECK(GetFullMipCount(1, 1) == 1 && GetFullMipCount(16, 4) == 5 && GetFullMipCount(5, 3) == 3);
+
+	// 3x3 to 1x1 averages the top left 2x2 rounded to nearest: (10 + 20 + 40 + 51 + 2) / 4
+	Image source;
+	source.Width = 3;
+	source.Height = 3;
+	source.Pixels.assign(36, 0);
+	const uint8_t values[4] = { 10, 20, 40, 51 };
+	const size_t corners[4] = { 0, 1, 3, 4 };
+	for (uint32_t n = 0; n < 4; ++n)
+	{
+		source.Pixels[corners[n] * 4] = values[n];
+	}
+	Image half;
+	DownsampleImage(source, half);
+	CHECK(half.Width == 1 && half.Height == 1 && half.Pixels[0] == 30);
+
+	// Full chain of a 16x8 down to 1x1, each level at GetDDSSurfaceSize's size
+	ThreadPool pool(2);
+	std::vector<uint8_t> dds;
+	std::string error;
+	CHECK(BuildCompressedDDS(MakeImage(1, 16), BLOCK_FORMAT_BC1, 0, pool, true, dds, error));
+	DDSTexture texture;
+	CHECK(ParseDDS(dds.data(), dds.size(), texture));
+	CHECK(texture.Format == BLOCK_FORMAT_BC1 && texture.Width == 16 && texture.MipCount == 5 && texture.Subresources.size() == 5);
+	CHECK(static_cast<const uint8_t*>(texture.Subresources[4].Data) + 8 == dds.data() + dds.size());
+	CHECK(BuildCompressedDDS(MakeImage(0, 16), BLOCK_FORMAT_BC7, 2, pool, true, dds, error));
+	CHECK(ParseDDS(dds.data(), dds.size(), texture) && texture.MipCount == 2);
+
+	Image odd = MakeImage(1, 16);
+	odd.Width = 15;
+	CHECK(!BuildCompressedDDS(odd, BLOCK_FORMAT_BC1, 0, pool, true, dds, error) && !error.empty());
+}
+
+int main()
+{
+	TestPSNR();
+	TestSolidBlocks();
+	TestHandBlocks();
+	TestSameBytes();
+	TestImages();
+	return CheckResult("BlockCompressionTests");
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+// Checks for the headless tests. A failed check prints where it failed and carries on, main returns CheckResult() so
+// ctest sees every failure of a run at once.
+inline int& CheckFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition)                                                                  \
+	do                                                                                    \
+	{                                                                                     \
+		if (!(condition))                                                                 \
+		{                                                                                 \
+			std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition);    \
+			++CheckFailures();                                                            \
+		}                                                                                 \
+	} while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                                                    \
+	do                                                                                                             \
+	{                                                                                                              \
+		const double checkActual = (actual);                                                                       \
+		const double checkExpected = (expected);                                                                   \
+		if (!(std::fabs(checkActual - checkExpected) <= (tolerance)))                                              \
+		{                                                                                                          \
+			std::printf("%s(%d): CHECK_NEAR(%s, %s) failed, %.9g vs %.9g\n", __FILE__, __LINE__, #actual, #expected, \
+				checkActual, checkExpected);                                                                       \
+			++CheckFailures();                                                                                     \
+		}                                                                                                          \
+	} while (0)
+
+inline int CheckResult(const char* name)
+{
+	std::printf("%s: %s\n", name, CheckFailures() == 0 ? "passed" : "FAILED");
+	return CheckFailures() == 0 ? 0 : 1;
+}
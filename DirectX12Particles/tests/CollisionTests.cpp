@@ -0,0 +1,177 @@
+// Plane collision against hand computed contacts, the broadphase grid against testing every plane, and SIMD against scalar
+#include "Check.h"
+#include "Collision.h"
+
+#include <cstring>
+#include <random>
+
+static const float HalfPi = 1.57079633f;
+
+// A floor at y = 0 over x in [-5, 5] and z in [-10, 10], and a back wall at z = 10
+static std::vector<CollisionPlane> Room()
+{
+	return { MakeCollisionPlane(float3(0, 0, 0), float3(1, 0, 0), float2(5, 10), HalfPi),
+		MakeCollisionPlane(float3(0, 5, 10), float3(0, 0, 0), float2(5, 5), 0) };
+}
+
+static void Push(CollideParticlesSoA& particles, float3 from, float3 to, float3 velocity, float scale)
+{
+	particles.previousX.push_back(from.x);
+	particles.previousY.push_back(from.y);
+	particles.previousZ.push_back(from.z);
+	particles.positionX.push_back(to.x);
+	particles.positionY.push_back(to.y);
+	particles.positionZ.push_back(to.z);
+	particles.velocityX.push_back(velocity.x);
+	particles.velocityY.push_back(velocity.y);
+	particles.velocityZ.push_back(velocity.z);
+	particles.scale.push_back(scale);
+	particles.lifeTimeLeft.push_back(1.0f);
+}
+
+static float3 Position(const CollideParticlesSoA& particles, size_t n)
+{
+	return float3(particles.positionX[n], particles.positionY[n], particles.positionZ[n]);
+}
+
+static float3 Velocity(const CollideParticlesSoA& particles, size_t n)
+{
+	return float3(particles.velocityX[n], particles.velocityY[n], particles.velocityZ[n]);
+}
+
+static bool Near(float3 a, float3 b)
+{
+	return length(a - b) <= 1e-5f;
+}
+
+static void TestPlanes()
+{
+	const std::vector<CollisionPlane> planes = Room();
+	CHECK(Near(CollisionPlaneNormal(planes[0]), float3(0, -1, 0)));
+	CHECK(Near(CollisionPlaneNormal(planes[1]), float3(0, 0, 1)));
+	CHECK_NEAR(planes[1].Plane.w, -10.0, 1e-6);
+}
+
+static void TestResponse()
+{
+	const std::vector<CollisionPlane> planes = Room();
+	CollisionConstants constants = {};
+	constants.Restitution = 0.5f;
+	constants.Friction = 0.25f;
+	constants.RadiusScale = 0.5f;
+	const std::vector<uint> grid = BuildCollisionGrid(planes, 1.0f, constants);
+	CHECK(constants.PlaneCount == 2);
+
+	CollideParticlesSoA particles;
+	Push(particles, float3(1, 0.5f, 2), float3(2, -0.5f, 2), float3(4, -4, 0), 0.0f); // Through the floor halfway
+	Push(particles, float3(1, 0.5f, 2), float3(2, -0.5f, 2), float3(4, -4, 0), 0.4f); // The same with a 0.2 radius
+	Push(particles, float3(1, 0.5f, 12), float3(1, -0.5f, 12), float3(0, -4, 0), 0.0f); // Past the floor's far edge
+	Push(particles, float3(0, 5, 9.5f), float3(0, 5, 10.5f), float3(0, 0, 3), 0.0f); // Into the back wall
+	Push(particles, float3(0, 0.1f, 0), float3(0, -0.5f, 0), float3(0, -4, 0), 0.4f); // Starts touching, passes through
+	Push(particles, float3(0, 0.25f, 9.5f), float3(0, -0.75f, 10.5f), float3(0, -4, 3), 0.0f); // Floor first, then the wall
+	CollideParticles(particles, planes, grid, constants);
+
+	// The tangential part keeps 1 - friction, the normal part flips and keeps restitution
+	CHECK(Near(Position(particles, 0), float3(1.5f, 0, 2)));
+	CHECK(Near(Velocity(particles, 0), float3(3, 2, 0)));
+	CHECK(Near(Position(particles, 1), float3(1.3f, 0.2f, 2)));
+	CHECK(Near(Velocity(particles, 1), float3(3, 2, 0)));
+	CHECK(Near(Position(particles, 2), float3(1, -0.5f, 12)));
+	CHECK(Near(Velocity(particles, 2), float3(0, -4, 0)));
+	CHECK(Near(Position(particles, 3), float3(0, 5, 10)));
+	CHECK(Near(Velocity(particles, 3), float3(0, 0, -1.5f)));
+	CHECK(Near(Position(particles, 4), float3(0, -0.5f, 0)));
+	CHECK(Near(Position(particles, 5), float3(0, 0, 9.75f)));
+	CHECK(Near(Velocity(particles, 5), float3(0, 2, 2.25f)));
+
+	uint hitPlane = 99;
+	CHECK_NEAR(FindCollision(planes, grid, constants, float3(0, 0.25f, 9.5f), float3(0, -0.75f, 10.5f), 0.0f, hitPlane), 0.25, 1e-6);
+	CHECK(hitPlane == 0);
+	CHECK(FindCollision(planes, grid, constants, float3(20, 20, 20), float3(21, 21, 21), 0.0f, hitPlane) == COLLISION_NO_HIT);
+
+	// Killing particles leaves them where they are
+	constants.KillOnHit = 1;
+	CollideParticlesSoA killed;
+	Push(killed, float3(1, 0.5f, 2), float3(2, -0.5f, 2), float3(4, -4, 0), 0.0f);
+	Push(killed, float3(1, 0.5f, 12), float3(1, -0.5f, 12), float3(0, -4, 0), 0.0f);
+	CollideParticles(killed, planes, grid, constants);
+	CHECK(killed.lifeTimeLeft[0] == 0.0f && killed.lifeTimeLeft[1] == 1.0f);
+	CHECK(Near(Position(killed, 0), float3(2, -0.5f, 2)));
+}
+
+// Random steps of up to 0.4 per axis around and through the room
+static CollideParticlesSoA RandomSteps(size_t count, uint32_t seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> position(-7.0f, 13.0f);
+	std::uniform_real_distribution<float> step(-0.4f, 0.4f);
+	std::uniform_real_distribution<float> scale(0.0f, 0.3f);
+	CollideParticlesSoA particles;
+	for (size_t n = 0; n < count; ++n)
+	{
+		const float3 from(position(random) * 0.5f, position(random) * 0.5f, position(random));
+		const float3 velocity(step(random), step(random), step(random));
+		Push(particles, from, from + velocity, velocity * 60.0f, scale(random));
+	}
+	return particles;
+}
+
+static bool SameParticles(const CollideParticlesSoA& a, const CollideParticlesSoA& b)
+{
+	const std::vector<float> CollideParticlesSoA::* fields[] = { &CollideParticlesSoA::positionX, &CollideParticlesSoA::positionY,
+		&CollideParticlesSoA::positionZ, &CollideParticlesSoA::velocityX, &CollideParticlesSoA::velocityY, &CollideParticlesSoA::velocityZ,
+		&CollideParticlesSoA::lifeTimeLeft };
+	for (auto field : fields)
+	{
+		if ((a.*field).size() != (b.*field).size() || memcmp((a.*field).data(), (b.*field).data(), sizeof(float) * (a.*field).size()) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void TestBroadphaseAndSIMD()
+{
+	const std::vector<CollisionPlane> planes = Room();
+	CollisionConstants constants = {};
+	constants.Restitution = 0.6f;
+	constants.Friction = 0.1f;
+	constants.RadiusScale = 1.0f;
+
+	// The margin covers the largest radius plus the longest step, so the grid never hides a hit testing every plane would find
+	const std::vector<uint> grid = BuildCollisionGrid(planes, 0.3f + 0.7f, constants);
+	const std::vector<uint> everyPlane(grid.size(), (1u << planes.size()) - 1);
+	const CollideParticlesSoA start = RandomSteps(100003, 3);
+	CollideParticlesSoA scalar = start;
+	CollideParticlesSoA brute = start;
+	CollideParticlesSoA simd = start;
+	CollideParticles(scalar, planes, grid, constants);
+	CollideParticles(brute, planes, everyPlane, constants);
+	CollideParticlesSIMD(simd, planes, grid, constants);
+
+	size_t hits = 0;
+	for (size_t n = 0; n < start.Size(); ++n)
+	{
+		hits += scalar.velocityX[n] != start.velocityX[n] ? 1 : 0;
+	}
+	CHECK(hits > 1000);
+	CHECK(SameParticles(scalar, brute));
+	CHECK(SameParticles(scalar, simd));
+
+	// Cells far from every plane are empty
+	size_t emptyCells = 0;
+	for (uint mask : grid)
+	{
+		emptyCells += mask == 0 ? 1 : 0;
+	}
+	CHECK(emptyCells > 0 && emptyCells < grid.size());
+}
+
+int main()
+{
+	TestPlanes();
+	TestResponse();
+	TestBroadphaseAndSIMD();
+	return CheckResult("CollisionTests");
+}
@@ -0,0 +1,169 @@
+// Frustum and Hi-Z cull decisions for hand placed particles, conservativeness against the full resolution depth, and SIMD against scalar
+#include "Check.h"
+#include "Culling.h"
+
+#include <algorithm>
+#include <random>
+
+static const float Near = 1.0f;
+static const float Far = 100.0f;
+static const uint DepthSize = 64;
+
+// Depth of view distance z with the projection the constants carry
+static float DepthAt(float z)
+{
+	return Far / (Far - Near) - Near * Far / (Far - Near) / z;
+}
+
+// Camera at the origin looking down +z with a 90 degree field of view, the previous frame's view the same.
+// The depth buffer has a wall at z = 10 over its left half and nothing over the right half.
+static CullConstants MakeConstants(std::vector<HiZLevel>& hiZ)
+{
+	const float diagonal = 0.70710678f;
+	CullConstants cull = {};
+	cull.FrustumPlanes[0] = float4(0, 0, 1, -Near);
+	cull.FrustumPlanes[1] = float4(0, 0, -1, Far);
+	cull.FrustumPlanes[2] = float4(diagonal, 0, diagonal, 0);
+	cull.FrustumPlanes[3] = float4(-diagonal, 0, diagonal, 0);
+	cull.FrustumPlanes[4] = float4(0, diagonal, diagonal, 0);
+	cull.FrustumPlanes[5] = float4(0, -diagonal, diagonal, 0);
+	cull.ViewDepthAxis = float4(0, 0, 1, 0);
+	cull.HiZView.r[0] = float4(1, 0, 0, 0);
+	cull.HiZView.r[1] = float4(0, 1, 0, 0);
+	cull.HiZView.r[2] = float4(0, 0, 1, 0);
+	cull.HiZView.r[3] = float4(0, 0, 0, 1);
+	cull.HiZProjection = float4(1.0f, 1.0f, Far / (Far - Near), -Near * Far / (Far - Near));
+
+	std::vector<float> depth(DepthSize * DepthSize);
+	for (uint y = 0; y < DepthSize; ++y)
+	{
+		for (uint x = 0; x < DepthSize; ++x)
+		{
+			depth[y * DepthSize + x] = x < DepthSize / 2 ? DepthAt(10.0f) : 1.0f;
+		}
+	}
+	hiZ = BuildHiZ(depth, DepthSize, DepthSize);
+	cull.HiZDimensions = uint2(DepthSize, DepthSize);
+	cull.HiZMipCount = static_cast<uint>(hiZ.size());
+	cull.HiZEnabled = 1;
+	return cull;
+}
+
+static void Push(CullParticlesSoA& particles, float3 position, float scale)
+{
+	particles.positionX.push_back(position.x);
+	particles.positionY.push_back(position.y);
+	particles.positionZ.push_back(position.z);
+	particles.scale.push_back(scale);
+}
+
+static bool Contains(const std::vector<uint>& visible, uint index)
+{
+	return std::find(visible.begin(), visible.end(), index) != visible.end();
+}
+
+static void TestDecisions()
+{
+	std::vector<HiZLevel> hiZ;
+	CullConstants cull = MakeConstants(hiZ);
+	CullParticlesSoA particles;
+	Push(particles, float3(-3, 0, 20), 0.5f); // 0: behind the wall
+	Push(particles, float3(-3, 0, 5), 0.5f); // 1: in front of the wall
+	Push(particles, float3(3, 0, 20), 0.5f); // 2: beside the wall
+	Push(particles, float3(-0.3f, 0, 20), 0.5f); // 3: behind the wall's edge, its rect reaches the open half
+	Push(particles, float3(50, 0, 20), 0.5f); // 4: right of the frustum
+	Push(particles, float3(0, 0, 150), 0.5f); // 5: past the far plane
+	Push(particles, float3(0, -30, 20), 1.0f); // 6: below the frustum
+	Push(particles, float3(21, 0, 20), 1.0f); // 7: center outside the right plane by 0.71, radius 1.41 still reaches in
+	Push(particles, float3(-2, 0, 0.5f), 1.0f); // 8: crosses the camera plane, never occluded
+
+	std::vector<uint> visible;
+	CullParticles(particles, cull, hiZ, visible);
+	CHECK(!Contains(visible, 0));
+	CHECK(Contains(visible, 1));
+	CHECK(Contains(visible, 2));
+	CHECK(Contains(visible, 3));
+	CHECK(!Contains(visible, 4));
+	CHECK(!Contains(visible, 5));
+	CHECK(!Contains(visible, 6));
+	CHECK(Contains(visible, 7));
+	CHECK(Contains(visible, 8));
+	CHECK(std::is_sorted(visible.begin(), visible.end()));
+
+	// The hidden particle's rect sits in the wall's half, and its closest point is further than the wall
+	const HiZBounds hidden = ProjectSphereToHiZ(float3(-3, 0, 20), 0.5f * CULL_BILLBOARD_RADIUS, cull);
+	CHECK(hidden.Valid == 1 && hidden.Rect.z < 0.5f && hidden.NearestDepth > DepthAt(10.0f));
+	const HiZBounds crossing = ProjectSphereToHiZ(float3(-2, 0, 0.5f), CULL_BILLBOARD_RADIUS, cull);
+	CHECK(crossing.Valid == 0);
+
+	// Without a pyramid only the frustum culls
+	cull.HiZEnabled = 0;
+	visible.clear();
+	CullParticles(particles, cull, hiZ, visible);
+	CHECK(visible == std::vector<uint>({ 0, 1, 2, 3, 7, 8 }));
+}
+
+static void TestConservative()
+{
+	std::vector<HiZLevel> hiZ;
+	const CullConstants cull = MakeConstants(hiZ);
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> lateral(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> distance(-5.0f, 110.0f);
+	std::uniform_real_distribution<float> size(0.01f, 3.0f);
+	CullParticlesSoA particles;
+	for (uint n = 0; n < 4003; ++n)
+	{
+		Push(particles, float3(lateral(random), lateral(random), distance(random)), size(random));
+	}
+
+	std::vector<uint> visible;
+	CullParticles(particles, cull, hiZ, visible);
+	std::vector<uint> simd;
+	CullParticlesSIMD(particles, cull, hiZ, simd);
+	CHECK(simd == visible);
+
+	// A particle inside every plane is only culled when every mip 0 depth under its rect is closer than its closest point
+	uint occluded = 0;
+	bool frustum = true;
+	bool conservative = true;
+	for (uint n = 0; n < particles.Size(); ++n)
+	{
+		const float3 center(particles.positionX[n], particles.positionY[n], particles.positionZ[n]);
+		const float radius = particles.scale[n] * CULL_BILLBOARD_RADIUS;
+		bool inside = true;
+		for (const float4& plane : cull.FrustumPlanes)
+		{
+			inside &= static_cast<double>(plane.x) * center.x + static_cast<double>(plane.y) * center.y + static_cast<double>(plane.z) * center.z + plane.w >= -radius - 1e-4;
+		}
+		if (Contains(visible, n))
+		{
+			frustum &= inside;
+			continue;
+		}
+		if (!inside)
+		{
+			continue;
+		}
+		++occluded;
+		const HiZBounds bounds = ProjectSphereToHiZ(center, radius, cull);
+		const uint4 texels = HiZCullTexels(bounds, cull, 0);
+		for (uint y = texels.y; y <= texels.w; ++y)
+		{
+			for (uint x = texels.x; x <= texels.z; ++x)
+			{
+				conservative &= bounds.Valid && hiZ[0].Load(x, y).y < bounds.NearestDepth;
+			}
+		}
+	}
+	CHECK(frustum);
+	CHECK(conservative);
+	CHECK(occluded > 50);
+}
+
+int main()
+{
+	TestDecisions();
+	TestConservative();
+	return CheckResult("CullingTests");
+}
@@ -0,0 +1,158 @@
+// Curl noise bake: discrete divergence, RMS scale, determinism and tiling, the wrap sampler, and the bake cache file
+#include "Check.h"
+#include "CurlNoise.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static float3 Texel(const CurlNoiseVolume& volume, uint x, uint y, uint z)
+{
+	const uint size = volume.Size;
+	const float4& texel = volume.Texels[((static_cast<size_t>(z % size) * size) + y % size) * size + x % size];
+	return float3(texel.x, texel.y, texel.z);
+}
+
+static bool SameTexels(const CurlNoiseVolume& a, const CurlNoiseVolume& b)
+{
+	return a.Size == b.Size && a.Texels.size() == b.Texels.size() &&
+		std::memcmp(a.Texels.data(), b.Texels.data(), a.Texels.size() * sizeof(float4)) == 0;
+}
+
+static void TestDivergence()
+{
+	CurlNoiseSettings settings;
+	settings.Size = 32;
+	ThreadPool pool(4);
+	const CurlNoiseVolume volume = BakeCurlNoise(settings, pool);
+	CHECK(volume.Size == 32 && volume.Texels.size() == 32u * 32u * 32u);
+
+	// The same wrapped central differences the curl was taken with cancel exactly, up to float rounding.
+	// Each term on its own is about as big as the field's gradient.
+	const uint size = volume.Size;
+	double divergence = 0.0;
+	double terms = 0.0;
+	double energy = 0.0;
+	for (uint z = 0; z < size; ++z)
+	{
+		for (uint y = 0; y < size; ++y)
+		{
+			for (uint x = 0; x < size; ++x)
+			{
+				const float dx = Texel(volume, x + 1, y, z).x - Texel(volume, x + size - 1, y, z).x;
+				const float dy = Texel(volume, x, y + 1, z).y - Texel(volume, x, y + size - 1, z).y;
+				const float dz = Texel(volume, x, y, z + 1).z - Texel(volume, x, y, z + size - 1).z;
+				divergence = (std::max)(divergence, static_cast<double>(std::fabs(dx + dy + dz)));
+				terms += std::fabs(dx) + std::fabs(dy) + std::fabs(dz);
+				const float3 value = Texel(volume, x, y, z);
+				energy += dot(value, value);
+			}
+		}
+	}
+	terms /= 3.0 * volume.Texels.size();
+	CHECK(terms > 0.1);
+	CHECK(divergence < 1e-4 * terms);
+
+	// Scaled to an RMS length of one
+	CHECK_NEAR(std::sqrt(energy / volume.Texels.size()), 1.0, 1e-4);
+}
+
+static void TestDeterminism()
+{
+	CurlNoiseSettings settings;
+	settings.Size = 16;
+	settings.Period = 2;
+	ThreadPool single(1);
+	ThreadPool pool(3);
+	const CurlNoiseVolume a = BakeCurlNoise(settings, single);
+	const CurlNoiseVolume b = BakeCurlNoise(settings, pool);
+	CHECK(SameTexels(a, b));
+
+	settings.Seed = 2;
+	CHECK(!SameTexels(a, BakeCurlNoise(settings, pool)));
+}
+
+static void TestSampling()
+{
+	CurlNoiseSettings settings;
+	settings.Size = 16;
+	ThreadPool pool(2);
+	const CurlNoiseVolume volume = BakeCurlNoise(settings, pool);
+	const float size = static_cast<float>(volume.Size);
+
+	// Texel centers return the texel, halfway between two centers their average
+	bool centers = true;
+	for (uint n = 0; n < 40; ++n)
+	{
+		const uint x = n * 7 % volume.Size;
+		const uint y = n * 3 % volume.Size;
+		const uint z = n * 11 % volume.Size;
+		const float3 sample = SampleCurlNoise(volume, float3((x + 0.5f) / size, (y + 0.5f) / size, (z + 0.5f) / size));
+		centers &= length(sample - Texel(volume, x, y, z)) <= 1e-5f;
+	}
+	CHECK(centers);
+	const float3 halfway = SampleCurlNoise(volume, float3(2.0f / size, 0.5f / size, 0.5f / size));
+	CHECK(length(halfway - (Texel(volume, 1, 0, 0) + Texel(volume, 2, 0, 0)) * 0.5f) <= 1e-5f);
+
+	// Wrap addressing, the edge blends the last texel with the first, and whole tiles away samples repeat
+	const float3 edge = SampleCurlNoise(volume, float3(0, 0.5f / size, 0.5f / size));
+	CHECK(length(edge - (Texel(volume, volume.Size - 1, 0, 0) + Texel(volume, 0, 0, 0)) * 0.5f) <= 1e-5f);
+	bool tiles = true;
+	for (uint n = 0; n < 40; ++n)
+	{
+		const float3 uvw(0.013f * n, 0.37f - 0.021f * n, 0.5f + 0.007f * n);
+		const float3 sample = SampleCurlNoise(volume, uvw);
+		tiles &= length(SampleCurlNoise(volume, uvw + float3(2, 0, 0)) - sample) <= 1e-4f;
+		tiles &= length(SampleCurlNoise(volume, uvw + float3(0, -1, 0)) - sample) <= 1e-4f;
+		tiles &= length(SampleCurlNoise(volume, uvw + float3(-3, 1, -1)) - sample) <= 1e-4f;
+	}
+	CHECK(tiles);
+}
+
+static void TestCache()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "CurlNoiseTests.bin";
+	std::filesystem::remove(path);
+	CurlNoiseSettings settings;
+	settings.Size = 8;
+	settings.Period = 2;
+	ThreadPool pool(2);
+	const CurlNoiseVolume baked = BakeCurlNoise(settings, pool);
+
+	// The first load bakes and writes the file, the second reads it back
+	CHECK(SameTexels(LoadOrBakeCurlNoise(path, settings, pool), baked));
+	const uintmax_t fileSize = std::filesystem::file_size(path);
+	CHECK(fileSize == 6 * sizeof(uint) + baked.Texels.size() * sizeof(float4));
+	{
+		// Poison the texels, a load that reads the file returns the poison
+		std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(6 * sizeof(uint));
+		const float4 poison(7, 7, 7, 7);
+		file.write(reinterpret_cast<const char*>(&poison), sizeof(poison));
+	}
+	const CurlNoiseVolume cached = LoadOrBakeCurlNoise(path, settings, pool);
+	CHECK(cached.Texels[0].x == 7.0f);
+
+	// Other settings rebake and replace the file
+	settings.Octaves = 2;
+	const CurlNoiseVolume rebaked = LoadOrBakeCurlNoise(path, settings, pool);
+	CHECK(SameTexels(rebaked, BakeCurlNoise(settings, pool)));
+	CHECK(SameTexels(LoadOrBakeCurlNoise(path, settings, pool), rebaked));
+
+	// A truncated file rebakes too
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 16);
+	CHECK(SameTexels(LoadOrBakeCurlNoise(path, settings, pool), rebaked));
+	CHECK(std::filesystem::file_size(path) == fileSize);
+	std::filesystem::remove(path);
+}
+
+int main()
+{
+	TestDivergence();
+	TestDeterminism();
+	TestSampling();
+	TestCache();
+	return CheckResult("CurlNoiseTests");
+}
@@ -0,0 +1,323 @@
+// DDS parsing of DX10 and legacy headers against hand computed subresource offsets, damaged files, and MappedFile
+#include "Check.h"
+#include "DDSFile.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+static const uint32_t FormatRGBA8 = 28; // DXGI_FORMAT_R8G8B8A8_UNORM
+static const uint32_t FormatBGRA8 = 87; // DXGI_FORMAT_B8G8R8A8_UNORM
+static const uint32_t FormatBC1 = 71; // DXGI_FORMAT_BC1_UNORM
+static const uint32_t FormatBC3 = 77; // DXGI_FORMAT_BC3_UNORM
+static const uint32_t FormatBC7 = 98; // DXGI_FORMAT_BC7_UNORM
+
+// Byte offsets into a file of the magic and the legacy header, see DDS_HEADER
+static const size_t HeaderSizeOffset = 4;
+static const size_t FlagsOffset = 8;
+static const size_t HeightOffset = 12;
+static const size_t WidthOffset = 16;
+static const size_t DepthOffset = 24;
+static const size_t MipCountOffset = 28;
+static const size_t PixelFormatFlagsOffset = 80;
+static const size_t FourCCOffset = 84;
+static const size_t BitCountOffset = 88;
+static const size_t MasksOffset = 92;
+static const size_t Caps2Offset = 112;
+static const size_t LegacyHeaderBytes = 128;
+static const size_t DX10HeaderBytes = 148;
+static const size_t DX10ArraySizeOffset = 140;
+
+static void Put(std::vector<uint8_t>& file, size_t offset, uint32_t value)
+{
+	memcpy(file.data() + offset, &value, sizeof(value));
+}
+
+// Magic and a header without the DX10 extension, the caller fills in the pixel format
+static std::vector<uint8_t> LegacyHeader(uint32_t width, uint32_t height, uint32_t mipCount)
+{
+	std::vector<uint8_t> file(LegacyHeaderBytes, 0);
+	memcpy(file.data(), "DDS ", 4);
+	Put(file, HeaderSizeOffset, 124);
+	Put(file, FlagsOffset, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000);
+	Put(file, HeightOffset, height);
+	Put(file, WidthOffset, width);
+	Put(file, MipCountOffset, mipCount);
+	Put(file, 76, 32); // DDS_PIXELFORMAT size
+	return file;
+}
+
+static void PutFourCC(std::vector<uint8_t>& file, const char* fourCC)
+{
+	Put(file, PixelFormatFlagsOffset, 0x4);
+	memcpy(file.data() + FourCCOffset, fourCC, 4);
+}
+
+static void PutMasks(std::vector<uint8_t>& file, uint32_t bitCount, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+	Put(file, PixelFormatFlagsOffset, 0x40 | (a ? 0x1 : 0));
+	Put(file, BitCountOffset, bitCount);
+	Put(file, MasksOffset, r);
+	Put(file, MasksOffset + 4, g);
+	Put(file, MasksOffset + 8, b);
+	Put(file, MasksOffset + 12, a);
+}
+
+static size_t Offset(const std::vector<uint8_t>& file, const DDSSubresource& subresource)
+{
+	return static_cast<const uint8_t*>(subresource.Data) - file.data();
+}
+
+static void TestSurfaceSize()
+{
+	size_t rowPitch = 0;
+	uint32_t rowCount = 0;
+	// 5x3 RGBA8: 20 byte rows
+	CHECK(GetDDSSurfaceSize(FormatRGBA8, 5, 3, &rowPitch, &rowCount) == 60);
+	CHECK(rowPitch == 20 && rowCount == 3);
+	// BC rows are rows of 4x4 blocks, rounded up: 2x1 blocks of 8 bytes
+	CHECK(GetDDSSurfaceSize(FormatBC1, 5, 3, &rowPitch, &rowCount) == 16);
+	CHECK(rowPitch == 16 && rowCount == 1);
+	// The 1x1 tail of a chain is still a whole block
+	CHECK(GetDDSSurfaceSize(FormatBC7, 1, 1, &rowPitch, &rowCount) == 16);
+	CHECK(rowPitch == 16 && rowCount == 1);
+	CHECK(GetDDSSurfaceSize(0, 4, 4) == 0);
+	CHECK(GetDDSSurfaceSize(200, 4, 4) == 0);
+	CHECK(IsDDSBlockCompressed(FormatBC1) && IsDDSBlockCompressed(FormatBC7) && !IsDDSBlockCompressed(FormatRGBA8));
+}
+
+static void TestDX10()
+{
+	// 16x8 BC1 array of 2 with 3 mips: 64 + 16 + 8 bytes per slice
+	std::vector<uint8_t> file;
+	WriteDDSHeader(FormatBC1, 16, 8, 2, 3, file);
+	CHECK(file.size() == DX10HeaderBytes);
+	file.resize(DX10HeaderBytes + 2 * 88);
+
+	DDSTexture texture;
+	CHECK(ParseDDS(file.data(), file.size(), texture));
+	CHECK(texture.Format == FormatBC1 && texture.Dimension == DDS_DIMENSION_TEXTURE2D);
+	CHECK(texture.Width == 16 && texture.Height == 8 && texture.Depth == 1);
+	CHECK(texture.ArraySize == 2 && texture.MipCount == 3 && !texture.Cube);
+	CHECK(texture.Subresources.size() == 6);
+	if (texture.Subresources.size() == 6)
+	{
+		// All mips of slice 0, then all of slice 1
+		const size_t offsets[6] = { 0, 64, 80, 88, 152, 168 };
+		const intptr_t rowPitches[3] = { 32, 16, 8 };
+		const intptr_t slicePitches[3] = { 64, 16, 8 };
+		for (int n = 0; n < 6; ++n)
+		{
+			CHECK(Offset(file, texture.Subresources[n]) == DX10HeaderBytes + offsets[n]);
+			CHECK(texture.Subresources[n].RowPitch == rowPitches[n % 3]);
+			CHECK(texture.Subresources[n].SlicePitch == slicePitches[n % 3]);
+		}
+	}
+
+	// 5x3 RGBA8 with 3 mips: 5x3, 2x1, 1x1
+	file.clear();
+	WriteDDSHeader(FormatRGBA8, 5, 3, 1, 3, file);
+	file.resize(DX10HeaderBytes + 60 + 8 + 4);
+	CHECK(ParseDDS(file.data(), file.size(), texture));
+	CHECK(texture.Subresources.size() == 3);
+	if (texture.Subresources.size() == 3)
+	{
+		CHECK(Offset(file, texture.Subresources[1]) == DX10HeaderBytes + 60 && texture.Subresources[1].RowPitch == 8);
+		CHECK(Offset(file, texture.Subresources[2]) == DX10HeaderBytes + 68 && texture.Subresources[2].RowPitch == 4);
+	}
+
+	// A cube flag makes six faces per array slice
+	file.clear();
+	WriteDDSHeader(FormatRGBA8, 4, 4, 1, 1, file);
+	Put(file, DX10ArraySizeOffset - 4, 0x4);
+	file.resize(DX10HeaderBytes + 6 * 64);
+	CHECK(ParseDDS(file.data(), file.size(), texture));
+	CHECK(texture.Cube && texture.ArraySize == 6 && texture.Subresources.size() == 6);
+	if (texture.Subresources.size() == 6)
+	{
+		CHECK(Offset(file, texture.Subresources[5]) == DX10HeaderBytes + 5 * 64);
+	}
+
+	// A zero array size and formats the parser can't slice
+	file.clear();
+	WriteDDSHeader(FormatRGBA8, 4, 4, 0, 1, file);
+	file.resize(DX10HeaderBytes + 64);
+	CHECK(!ParseDDS(file.data(), file.size(), texture));
+	for (uint32_t format : { 0u, 100u, 200u })
+	{
+		file.clear();
+		WriteDDSHeader(format, 4, 4, 1, 1, file);
+		file.resize(DX10HeaderBytes + 256);
+		CHECK(!ParseDDS(file.data(), file.size(), texture));
+	}
+}
+
+static void TestLegacy()
+{
+	// DXT5 8x8 with 4 mips, BC3 blocks are 16 bytes: 64 + 16 + 16 + 16
+	std::vector<uint8_t> file = LegacyHeader(8, 8, 4);
+	PutFourCC(file, "DXT5");
+	file.resize(LegacyHeaderBytes + 112);
+	DDSTexture texture;
+	CHECK(ParseDDS(file.data(), file.size(), texture));
+	CHECK(texture.Format == FormatBC3 && texture.Dimension == DDS_DIMENSION_TEXTURE2D);
+	CHECK(texture.ArraySize == 1 && texture.MipCount == 4 && texture.Subresources.size() == 4);
+	if (texture.Subresources.size() == 4)
+	{
+		CHECK(Offset(file, texture.Subresources[0]) == LegacyHeaderBytes);
+		CHECK(Offset(file, texture.Subresources[1]) == LegacyHeaderBytes + 64);
+		CHECK(Offset(file, texture.Subresources[3]) == LegacyHeaderBytes + 96);
+		CHECK(texture.Subresources[0].RowPitch == 32 && texture.Subresources[3].RowPitch == 16);
+	}
+
+	// Masks pick the channel order, a zero mip count is one mip
+	file = LegacyHeader(2, 2, 0);
+	PutMasks(file, 32, 0xff0000, 0xff00, 0xff, 0xff000000);
+	file.resize(LegacyHeaderBytes + 16);
+	CHECK(ParseDDS(file.data(), file.size(), texture));
+	CHECK(texture.Format == FormatBGRA8 && texture.MipCount == 1 && texture.Subresources.size() == 1);
+	PutMasks(file, 32, 0xff, 0xff00, 0xff0000, 0xff000000);
+	CHECK(ParseDDS(file.data(), file.size(), texture) && texture.Format == FormatRGBA8);
+	PutMasks(file, 24, 0xff0000, 0xff00, 0xff, 0);
+	CHECK(!ParseDDS(file.data(), file.size(), texture));
+
+	// A volume stores each mip's depth slices back to back: 4 slices of 64 bytes, then 2 of 16
+	file = LegacyHeader(4, 4, 2);
+	PutMasks(file, 32, 0xff, 0xff00, 0xff0000, 0xff000000);
+	Put(file, FlagsOffset, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x800000);
+	Put(file, DepthOffset, 4);
+	file.resize(LegacyHeaderBytes + 256 + 32);
+	CHECK(ParseDDS(file.data(), file.size(), texture));
+	CHECK(texture.Dimension == DDS_DIMENSION_TEXTURE3D && texture.Depth == 4 && texture.Subresources.size() == 2);
+	if (texture.Subresources.size() == 2)
+	{
+		CHECK(texture.Subresources[0].SlicePitch == 64 && texture.Subresources[1].SlicePitch == 16);
+		CHECK(Offset(file, texture.Subresources[1]) == LegacyHeaderBytes + 256);
+	}
+	CHECK(!ParseDDS(file.data(), file.size() - 1, texture));
+
+	// All six cube faces, and a partial cube D3D12 can't make
+	file = LegacyHeader(4, 4, 1);
+	PutFourCC(file, "DXT1");
+	Put(file, Caps2Offset, 0x200 | 0xfc00);
+	file.resize(LegacyHeaderBytes + 6 * 32);
+	CHECK(ParseDDS(file.data(), file.size(), texture));
+	CHECK(texture.Format == FormatBC1 && texture.Cube && texture.ArraySize == 6 && texture.Subresources.size() == 6);
+	Put(file, Caps2Offset, 0x200 | 0x400);
+	CHECK(!ParseDDS(file.data(), file.size(), texture));
+
+	// FourCCs without a mapping
+	file = LegacyHeader(4, 4, 1);
+	PutFourCC(file, "RXGB");
+	file.resize(LegacyHeaderBytes + 64);
+	CHECK(!ParseDDS(file.data(), file.size(), texture));
+}
+
+static void TestDamaged()
+{
+	std::vector<uint8_t> file;
+	WriteDDSHeader(FormatBC1, 16, 8, 2, 3, file);
+	file.resize(DX10HeaderBytes + 2 * 88);
+	DDSTexture texture;
+	CHECK(ParseDDS(file.data(), file.size(), texture));
+
+	// Every shorter prefix is cut inside a header or a subresource
+	bool rejected = true;
+	for (size_t size = 0; size < file.size(); ++size)
+	{
+		rejected &= !ParseDDS(file.data(), size, texture) && texture.Subresources.empty();
+	}
+	CHECK(rejected);
+
+	// Bytes past the last subresource are ignored
+	std::vector<uint8_t> longer = file;
+	longer.resize(file.size() + 100);
+	CHECK(ParseDDS(longer.data(), longer.size(), texture) && texture.Subresources.size() == 6);
+
+	std::vector<uint8_t> damaged = file;
+	damaged[0] = 'X';
+	CHECK(!ParseDDS(damaged.data(), damaged.size(), texture));
+	damaged = file;
+	Put(damaged, HeaderSizeOffset, 128);
+	CHECK(!ParseDDS(damaged.data(), damaged.size(), texture));
+	damaged = file;
+	Put(damaged, 76, 0);
+	CHECK(!ParseDDS(damaged.data(), damaged.size(), texture));
+	damaged = file;
+	Put(damaged, WidthOffset, 0);
+	CHECK(!ParseDDS(damaged.data(), damaged.size(), texture));
+	damaged = file;
+	Put(damaged, MipCountOffset, 16);
+	CHECK(!ParseDDS(damaged.data(), damaged.size(), texture));
+	damaged = file;
+	Put(damaged, WidthOffset, 32768);
+	CHECK(!ParseDDS(damaged.data(), damaged.size(), texture));
+}
+
+static void TestMappedFile()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "DDSFileTests.dds";
+	std::filesystem::remove(path);
+
+	MappedFile mapped;
+	CHECK(!mapped.Open(path));
+	CHECK(mapped.GetData() == nullptr && mapped.GetSize() == 0);
+
+	// Nothing to map in an empty file
+	{
+		std::ofstream empty(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	}
+	CHECK(!mapped.Open(path));
+	CHECK(mapped.GetData() == nullptr);
+
+	std::vector<uint8_t> file;
+	WriteDDSHeader(FormatRGBA8, 4, 4, 1, 3, file);
+	for (size_t n = 0; n < 64 + 16 + 4; ++n)
+	{
+		file.push_back(static_cast<uint8_t>(n));
+	}
+	{
+		std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(file.data()), file.size());
+	}
+	CHECK(mapped.Open(path));
+	CHECK(mapped.GetSize() == file.size());
+	CHECK(mapped.GetData() && memcmp(mapped.GetData(), file.data(), file.size()) == 0);
+
+	// Subresources point into the mapping itself
+	DDSTexture texture;
+	CHECK(ParseDDS(mapped.GetData(), mapped.GetSize(), texture));
+	CHECK(texture.Subresources.size() == 3);
+	if (texture.Subresources.size() == 3)
+	{
+		CHECK(texture.Subresources[2].Data == mapped.GetData() + DX10HeaderBytes + 80);
+		CHECK(*static_cast<const uint8_t*>(texture.Subresources[2].Data) == 80);
+	}
+
+	// Moves hand the view over, a failed Open drops what was mapped before
+	MappedFile moved(std::move(mapped));
+	CHECK(mapped.GetData() == nullptr && mapped.GetSize() == 0);
+	CHECK(moved.GetSize() == file.size());
+	MappedFile assigned;
+	assigned = std::move(moved);
+	CHECK(moved.GetData() == nullptr && assigned.GetSize() == file.size());
+	CHECK(!assigned.Open(path.string() + ".missing"));
+	CHECK(assigned.GetData() == nullptr && assigned.GetSize() == 0);
+
+	CHECK(mapped.Open(path));
+	mapped.Close();
+	CHECK(mapped.GetData() == nullptr && mapped.GetSize() == 0);
+	std::filesystem::remove(path);
+}
+
+int main()
+{
+	TestSurfaceSize();
+	TestDX10();
+	TestLegacy();
+	TestDamaged();
+	TestMappedFile();
+	return CheckResult("DDSFileTests");
+}
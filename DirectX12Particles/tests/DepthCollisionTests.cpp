@@ -0,0 +1,165 @@
+// Depth buffer collision against synthetic depth maps of surfaces with known normals
+#include "Check.h"
+#include "DepthCollision.h"
+
+#include <cstring>
+#include <functional>
+
+static const uint Width = 128;
+static const uint Height = 96;
+static const float NearPlane = 0.1f;
+static const float FarPlane = 100.0f;
+
+// Camera at the origin looking down view +z, yawed by yaw radians, with a 90 degree horizontal field of view
+static CullConstants MakeCull(float yaw)
+{
+	const float s = sin(yaw);
+	const float c = cos(yaw);
+	CullConstants cull = {};
+	cull.HiZView.r[0] = float4(c, 0, -s, 0);
+	cull.HiZView.r[1] = float4(0, 1, 0, 0);
+	cull.HiZView.r[2] = float4(s, 0, c, 0);
+	cull.HiZView.r[3] = float4(0, 0, 0, 1);
+	cull.HiZProjection = float4(1.0f, static_cast<float>(Width) / Height, FarPlane / (FarPlane - NearPlane), -NearPlane * FarPlane / (FarPlane - NearPlane));
+	cull.HiZDimensions = uint2(Width, Height);
+	cull.HiZMipCount = 1;
+	cull.HiZEnabled = 1;
+	return cull;
+}
+
+static float ProjectDepth(float viewZ, const CullConstants& cull)
+{
+	return cull.HiZProjection.z + cull.HiZProjection.w / viewZ;
+}
+
+// Depth image of the view space distance along each texel center's ray, 0 or less is sky
+static HiZLevel RenderDepth(const CullConstants& cull, const std::function<float(float3 ray)>& distance)
+{
+	std::vector<float> depth(Width * Height);
+	for (uint y = 0; y < Height; ++y)
+	{
+		for (uint x = 0; x < Width; ++x)
+		{
+			const float3 ray(((x + 0.5f) / Width * 2.0f - 1.0f) / cull.HiZProjection.x, (1.0f - (y + 0.5f) / Height * 2.0f) / cull.HiZProjection.y, 1.0f);
+			const float viewZ = distance(ray);
+			depth[y * Width + x] = viewZ > 0.0f ? ProjectDepth(viewZ, cull) : 1.0f;
+		}
+	}
+	return BuildHiZ(depth, Width, Height)[0];
+}
+
+// World position of a view space position, the view is a rotation
+static float3 ToWorld(float3 view, const CullConstants& cull)
+{
+	return float3(dot(view, float3(cull.HiZView.r[0].x, cull.HiZView.r[0].y, cull.HiZView.r[0].z)),
+		dot(view, float3(cull.HiZView.r[1].x, cull.HiZView.r[1].y, cull.HiZView.r[1].z)),
+		dot(view, float3(cull.HiZView.r[2].x, cull.HiZView.r[2].y, cull.HiZView.r[2].z)));
+}
+
+static Particle MakeParticle(float3 position, float3 velocity)
+{
+	Particle particle = {};
+	particle.position = float4(position, 1);
+	particle.velocity = float4(velocity, 0);
+	particle.scale = 0.1f;
+	particle.lifeTimeLeft = 1.0f;
+	return particle;
+}
+
+static bool Near(float3 a, float3 b, float tolerance)
+{
+	return length(a - b) <= tolerance;
+}
+
+static CollisionConstants Bouncy()
+{
+	CollisionConstants collision = {};
+	collision.Restitution = 0.5f;
+	collision.Friction = 0.25f;
+	collision.RadiusScale = 1.0f;
+	collision.DepthEnabled = 1;
+	collision.DepthThickness = 0.5f;
+	return collision;
+}
+
+static void TestProjection()
+{
+	const CullConstants cull = MakeCull(0.0f);
+	CHECK_NEAR(DepthCollisionViewZ(ProjectDepth(7.25f, cull), cull), 7.25, 1e-3);
+	CHECK_NEAR(ProjectDepth(NearPlane, cull), 0.0, 1e-6);
+
+	// The screen center and the corners, and everything that isn't on screen
+	const DepthCollisionSample center = DepthCollisionProject(float3(0.01f, -0.01f, 5), cull);
+	CHECK(center.Valid && center.Texel.x == Width / 2 && center.Texel.y == Height / 2 && center.ViewZ == 5.0f);
+	const DepthCollisionSample corner = DepthCollisionProject(float3(4.99f, -4.99f * Height / Width, 5), cull);
+	CHECK(corner.Valid && corner.Texel.x == Width - 2 && corner.Texel.y == Height - 2);
+	CHECK(!DepthCollisionProject(float3(0, 0, -1), cull).Valid);
+	CHECK(!DepthCollisionProject(float3(6, 0, 5), cull).Valid);
+
+	// Texel centers reproject onto the surface they were rendered from
+	const float3 position = DepthCollisionViewPosition(uint2(10, 20), ProjectDepth(3.0f, cull), cull);
+	CHECK_NEAR(position.z, 3.0, 1e-3);
+	CHECK_NEAR(position.x, ((10.5f / Width) * 2.0f - 1.0f) * 3.0f, 1e-3);
+}
+
+static void TestWall(float yaw)
+{
+	// A wall 5 in front of the yawed camera faces it, its world normal is the view's -z
+	const CullConstants cull = MakeCull(yaw);
+	const HiZLevel depth = RenderDepth(cull, [](float3) { return 5.0f; });
+	const CollisionConstants collision = Bouncy();
+	const float3 normal = ToWorld(float3(0, 0, -1), cull);
+	CHECK(Near(DepthCollisionNormal(uint2(40, 30), float3(depth.Load(40, 30).y, depth.Load(41, 30).y, depth.Load(40, 31).y), cull), normal, 1e-3f));
+
+	// Moving into the wall within its radius bounces back to where the step started
+	const float3 from = ToWorld(float3(0.3f, 0.2f, 4.9f), cull);
+	const float3 into = ToWorld(float3(0.5f, 0.2f, 5.05f), cull);
+	const float3 velocity = ToWorld(float3(2, 0, 4), cull);
+	const Particle bounced = CollideDepth(MakeParticle(into, velocity), from, depth, cull, collision);
+	CHECK(Near(float3(bounced.position.x, bounced.position.y, bounced.position.z), from, 1e-5f));
+	CHECK(Near(float3(bounced.velocity.x, bounced.velocity.y, bounced.velocity.z), ToWorld(float3(1.5f, 0, -2), cull), 1e-3f));
+
+	// Moving away, in front of the wall, behind its thickness and under sky nothing happens
+	const Particle away = MakeParticle(into, ToWorld(float3(0, 0, -4), cull));
+	const Particle unchanged = CollideDepth(away, from, depth, cull, collision);
+	CHECK(memcmp(&away, &unchanged, sizeof(Particle)) == 0);
+	const Particle front = MakeParticle(ToWorld(float3(0.5f, 0.2f, 4.8f), cull), velocity);
+	CHECK(CollideDepth(front, from, depth, cull, collision).velocity.z == front.velocity.z);
+	const Particle behind = MakeParticle(ToWorld(float3(0.5f, 0.2f, 5.7f), cull), velocity);
+	CHECK(CollideDepth(behind, from, depth, cull, collision).velocity.z == behind.velocity.z);
+	const HiZLevel sky = RenderDepth(cull, [](float3) { return 0.0f; });
+	CHECK(CollideDepth(MakeParticle(into, velocity), from, sky, cull, collision).velocity.z == MakeParticle(into, velocity).velocity.z);
+
+	// Killing particles on a hit
+	CollisionConstants kill = collision;
+	kill.KillOnHit = 1;
+	CHECK(CollideDepth(MakeParticle(into, velocity), from, depth, cull, kill).lifeTimeLeft == 0.0f);
+}
+
+static void TestFloor()
+{
+	// A floor 1 below the camera fills the bottom half, sky the top. Its normal points up from the depth gradients alone.
+	const CullConstants cull = MakeCull(0.4f);
+	const HiZLevel depth = RenderDepth(cull, [](float3 ray) { return ray.y < 0.0f ? -1.0f / ray.y : 0.0f; });
+	const uint2 texel(Width / 3, Height * 3 / 4);
+	const float3 normal = DepthCollisionNormal(texel, float3(depth.Load(texel.x, texel.y).y, depth.Load(texel.x + 1, texel.y).y,
+		depth.Load(texel.x, texel.y + 1).y), cull);
+	CHECK(Near(normal, float3(0, 1, 0), 1e-3f));
+
+	// Falling onto it keeps 1 - friction of the sliding velocity and restitution of the fall
+	const CollisionConstants collision = Bouncy();
+	const float3 from = ToWorld(float3(-0.5f, -0.85f, 2.0f), cull);
+	const float3 into = ToWorld(float3(-0.5f, -1.02f, 2.0f), cull);
+	const Particle bounced = CollideDepth(MakeParticle(into, float3(2, -4, 0)), from, depth, cull, collision);
+	CHECK(Near(float3(bounced.velocity.x, bounced.velocity.y, bounced.velocity.z), float3(1.5f, 2, 0), 1e-2f));
+	CHECK(Near(float3(bounced.position.x, bounced.position.y, bounced.position.z), from, 1e-5f));
+}
+
+int main()
+{
+	TestProjection();
+	TestWall(0.0f);
+	TestWall(0.6f);
+	TestFloor();
+	return CheckResult("DepthCollisionTests");
+}
@@ -0,0 +1,101 @@
+// Emitter JSON compiling and round tripping, and the same record checks on JSON and on damaged binaries
+#include "Check.h"
+#include "EmitterLibrary.h"
+
+#include <cstring>
+
+static const char* LibraryJSON = R"({
+	"emitters": [
+		{ "name": "Rising", "lifetime": 2.5, "emitCount": 40, "curveSet": 1, "aabbMin": [-1, 0, -1], "aabbMax": [1, 2, 1] },
+		{ "name": "Drift", "texture": "Smoke", "curveSet": null }
+	]
+})";
+
+static std::string Emitter(const char* keys)
+{
+	return std::string("{ \"emitters\": [\n{ \"name\": \"A\", ") + keys + " }\n] }";
+}
+
+// Whether text fails to compile with an error that contains expected
+static bool Fails(const std::string& text, uint curveSetCount, const char* expected)
+{
+	std::vector<uint8_t> binary;
+	std::string error;
+	return !CompileEmitterJSON(text, curveSetCount, binary, error) && error.find(expected) != std::string::npos;
+}
+
+static void TestCompile()
+{
+	std::vector<uint8_t> binary;
+	std::string error;
+	CHECK(CompileEmitterJSON(LibraryJSON, 2, binary, error) && error.empty());
+	EmitterLibraryView view;
+	CHECK(ParseEmitterBinary(binary.data(), binary.size(), 2, view) && view.Count == 2);
+	CHECK(strcmp(view.Records[0].Name, "Rising") == 0 && view.Records[0].ParticleLifetime == 2.5f && view.Records[0].EmitCount == 40);
+	CHECK(view.Records[0].CurveSet == 1 && view.Records[0].AABBMax.y == 2.0f);
+	CHECK(strcmp(view.Records[1].Texture, "Smoke") == 0 && view.Records[1].CurveSet == CURVE_SET_NONE && view.Records[1].ParticleLifetime == 1.0f);
+
+	// Written back out it compiles to the same bytes
+	std::vector<uint8_t> again;
+	CHECK(CompileEmitterJSON(WriteEmitterJSON(view.Records, view.Count), 2, again, error) && again == binary);
+}
+
+static void TestInvalidJSON()
+{
+	CHECK(Fails(Emitter("\"curveSet\": 1"), 1, "line 2: curveSet 1 is past the 1 baked curve sets"));
+	CHECK(Fails(Emitter("\"curveSet\": 0"), 0, "past the 0 baked curve sets"));
+	CHECK(Fails(Emitter("\"curveSet\": -1"), 4, "curve set index or null"));
+	CHECK(Fails(Emitter("\"curveSet\": 0.5"), 4, "curve set index or null"));
+	CHECK(Fails(Emitter("\"lifetime\": 0"), 1, "lifetime has to be positive"));
+	CHECK(Fails(Emitter("\"name\": \"\""), 1, "names need 1 to 31 characters"));
+	CHECK(Fails(Emitter("\"name\": \"ThirtyTwoCharactersLongNameHere!\""), 1, "names need 1 to 31 characters"));
+	CHECK(Fails("{ \"emitters\": [ { \"lifetime\": 1 } ] }", 1, "emitter without a name"));
+	CHECK(Fails("{ \"emitters\": [ { \"name\": \"A\" }, { \"name\": \"A\" } ] }", 1, "duplicate emitter name \"A\""));
+
+	std::vector<uint8_t> binary;
+	std::string error;
+	CHECK(CompileEmitterJSON(Emitter("\"curveSet\": 0"), 1, binary, error));
+	CHECK(CompileEmitterJSON(Emitter("\"curveSet\": null"), 0, binary, error));
+}
+
+static void TestInvalidBinary()
+{
+	std::vector<uint8_t> binary;
+	std::string error;
+	CHECK(CompileEmitterJSON(LibraryJSON, 2, binary, error));
+	EmitterLibraryView view;
+	const size_t headerSize = binary.size() - 2 * sizeof(EmitterRecord);
+
+	// Records are checked against the atlas the binary is loaded with, not the one it was compiled with
+	CHECK(!ParseEmitterBinary(binary.data(), binary.size(), 1, view));
+
+	// Every damaged record is refused, whichever field and record it is in
+	auto damaged = [&](uint index, auto damage)
+	{
+		std::vector<uint8_t> copy = binary;
+		EmitterRecord* records = reinterpret_cast<EmitterRecord*>(copy.data() + headerSize);
+		damage(records[index]);
+		EmitterLibraryView damagedView;
+		return !ParseEmitterBinary(copy.data(), copy.size(), 2, damagedView) && damagedView.Records == nullptr;
+	};
+	CHECK(damaged(1, [](EmitterRecord& record) { memset(record.Name, 'x', EMITTER_NAME_LENGTH); }));
+	CHECK(damaged(0, [](EmitterRecord& record) { memset(record.Name, 0, EMITTER_NAME_LENGTH); }));
+	CHECK(damaged(1, [](EmitterRecord& record) { memset(record.Texture, 'x', EMITTER_NAME_LENGTH); }));
+	CHECK(damaged(0, [](EmitterRecord& record) { record.ParticleLifetime = 0.0f; }));
+	CHECK(damaged(1, [](EmitterRecord& record) { record.ParticleLifetime = -1.0f; }));
+	CHECK(damaged(0, [](EmitterRecord& record) { memset(&record.ParticleLifetime, 0xff, sizeof(float)); }));
+	CHECK(damaged(0, [](EmitterRecord& record) { record.CurveSet = 2; }));
+	CHECK(!damaged(1, [](EmitterRecord& record) { record.CurveSet = 1; }));
+
+	// Truncated or from another layout
+	CHECK(!ParseEmitterBinary(binary.data(), binary.size() - 1, 2, view));
+	CHECK(!ParseEmitterBinary(binary.data(), 3, 2, view));
+}
+
+int main()
+{
+	TestCompile();
+	TestInvalidJSON();
+	TestInvalidBinary();
+	return CheckResult("EmitterLibraryTests");
+}
@@ -0,0 +1,206 @@
+// Force field falloffs and directions at hand picked points, culling against an unculled sum, and the SSE evaluation against the scalar one
+#include "Check.h"
+#include "ForceField.h"
+
+#include <random>
+
+static ForceField MakeField(uint type, float3 position, float strength, float radius)
+{
+	ForceField field = {};
+	field.Position = position;
+	field.Type = type;
+	field.Axis = float3(0, 1, 0);
+	field.Strength = strength;
+	field.Radius = radius;
+	return field;
+}
+
+static void TestFalloff()
+{
+	CHECK(ForceFieldFalloff(0.0f, 4.0f) == 1.0f);
+	CHECK(ForceFieldFalloff(1.0f, 4.0f) == 0.75f);
+	CHECK(ForceFieldFalloff(2.0f, 4.0f) == 0.5f);
+	CHECK(ForceFieldFalloff(4.0f, 4.0f) == 0.0f);
+	CHECK(ForceFieldFalloff(9.0f, 4.0f) == 0.0f);
+}
+
+static void TestAttractor()
+{
+	const ForceField field = MakeField(FORCE_FIELD_ATTRACTOR, float3(1, 2, 3), 8.0f, 4.0f);
+	const float3 still(0, 0, 0);
+
+	// Strength times the linear falloff, towards the center
+	const float3 near = ForceFieldAcceleration(field, float3(2, 2, 3), still);
+	CHECK_NEAR(near.x, -6.0f, 1e-5f);
+	CHECK(near.y == 0.0f && near.z == 0.0f);
+	const float3 far = ForceFieldAcceleration(field, float3(1, 2, 0), still);
+	CHECK_NEAR(far.z, 2.0f, 1e-5f);
+	CHECK(far.x == 0.0f && far.y == 0.0f);
+	const float3 diagonal = ForceFieldAcceleration(field, float3(3, 4, 3), still);
+	CHECK_NEAR(length(diagonal), 8.0f * (1.0f - std::sqrt(8.0f) / 4.0f), 1e-5f);
+	CHECK_NEAR(diagonal.x, diagonal.y, 1e-6f);
+
+	// Nothing at the center, on the rim or past it
+	CHECK(length(ForceFieldAcceleration(field, float3(1, 2, 3), still)) == 0.0f);
+	CHECK(length(ForceFieldAcceleration(field, float3(5, 2, 3), still)) == 0.0f);
+	CHECK(length(ForceFieldAcceleration(field, float3(1, 9, 3), still)) == 0.0f);
+
+	// A negative strength repels, velocity plays no part
+	const ForceField repeller = MakeField(FORCE_FIELD_ATTRACTOR, float3(1, 2, 3), -8.0f, 4.0f);
+	const float3 pushed = ForceFieldAcceleration(repeller, float3(2, 2, 3), float3(5, 5, 5));
+	CHECK_NEAR(pushed.x, 6.0f, 1e-5f);
+}
+
+static void TestVortex()
+{
+	const ForceField field = MakeField(FORCE_FIELD_VORTEX, float3(0, 0, 0), 6.0f, 3.0f);
+
+	// Axis y cross the direction to the axis, fading with the distance to the axis and not along it, up to the column's ends
+	const float3 low = ForceFieldAcceleration(field, float3(1, 0, 0), float3(0, 0, 0));
+	const float3 high = ForceFieldAcceleration(field, float3(1, -2.9f, 0), float3(0, 0, 0));
+	CHECK_NEAR(low.z, 4.0f, 1e-5f);
+	CHECK(low.x == 0.0f && low.y == 0.0f);
+	CHECK_NEAR(high.z, low.z, 1e-5f);
+	CHECK(length(ForceFieldAcceleration(field, float3(1, 3.1f, 0), float3(0, 0, 0))) == 0.0f);
+	CHECK(length(ForceFieldAcceleration(field, float3(1, 50, 0), float3(0, 0, 0))) == 0.0f);
+	const float3 side = ForceFieldAcceleration(field, float3(0, 0, 2), float3(0, 0, 0));
+	CHECK_NEAR(side.x, -2.0f, 1e-5f);
+
+	// Tangential everywhere in the column and nothing outside it
+	std::mt19937 random(2);
+	std::uniform_real_distribution<float> coordinate(-4.0f, 4.0f);
+	bool tangential = true;
+	for (uint n = 0; n < 200; ++n)
+	{
+		const float3 position(coordinate(random), coordinate(random), coordinate(random));
+		const float3 acceleration = ForceFieldAcceleration(field, position, float3(0, 0, 0));
+		const float3 radial(position.x, 0, position.z);
+		tangential &= std::fabs(dot(acceleration, radial)) <= 1e-4f && acceleration.y == 0.0f;
+		tangential &= (length(radial) < 3.0f && std::fabs(position.y) <= 3.0f) || length(acceleration) == 0.0f;
+	}
+	CHECK(tangential);
+	CHECK(length(ForceFieldAcceleration(field, float3(0, 2, 0), float3(0, 0, 0))) == 0.0f);
+}
+
+static void TestWind()
+{
+	ForceField field = MakeField(FORCE_FIELD_WIND, float3(0, 0, 0), 5.0f, 0.0f);
+	field.Axis = float3(1, 0, 0);
+	field.Extents = float3(2, 1, 3);
+
+	// Full strength anywhere in the box, faces included, nothing outside it
+	const float3 center = ForceFieldAcceleration(field, float3(0, 0, 0), float3(0, 0, 0));
+	const float3 corner = ForceFieldAcceleration(field, float3(-2, 1, 3), float3(0, 0, 0));
+	CHECK(center.x == 5.0f && center.y == 0.0f && center.z == 0.0f);
+	CHECK(corner.x == 5.0f);
+	CHECK(length(ForceFieldAcceleration(field, float3(2.01f, 0, 0), float3(0, 0, 0))) == 0.0f);
+	CHECK(length(ForceFieldAcceleration(field, float3(0, 0, -3.01f), float3(0, 0, 0))) == 0.0f);
+
+	CHECK(ForceFieldBoundsMin(field).x == -2.0f && ForceFieldBoundsMax(field).z == 3.0f);
+}
+
+static void TestDrag()
+{
+	const ForceField field = MakeField(FORCE_FIELD_DRAG, float3(0, 0, 0), 2.0f, 4.0f);
+
+	// Against the velocity, strength times falloff per second, at the center too
+	const float3 velocity(3, -1, 0.5f);
+	const float3 center = ForceFieldAcceleration(field, float3(0, 0, 0), velocity);
+	CHECK_NEAR(center.x, -6.0f, 1e-5f);
+	CHECK_NEAR(center.y, 2.0f, 1e-5f);
+	const float3 half = ForceFieldAcceleration(field, float3(0, 0, 2), velocity);
+	CHECK_NEAR(half.x, -3.0f, 1e-5f);
+	CHECK_NEAR(half.z, -0.5f, 1e-5f);
+	CHECK(length(ForceFieldAcceleration(field, float3(0, 5, 0), velocity)) == 0.0f);
+	CHECK(length(ForceFieldAcceleration(field, float3(0, 1, 0), float3(0, 0, 0))) == 0.0f);
+}
+
+static void TestCulling()
+{
+	std::vector<ForceField> fields;
+	fields.push_back(MakeField(FORCE_FIELD_ATTRACTOR, float3(0, 0, 0), 1.0f, 1.0f));
+	fields.push_back(MakeField(FORCE_FIELD_DRAG, float3(10, 0, 0), 1.0f, 2.0f));
+	ForceField wind = MakeField(FORCE_FIELD_WIND, float3(0, 20, 0), 1.0f, 100.0f);
+	wind.Extents = float3(1, 1, 1);
+	fields.push_back(wind);
+
+	// Touching counts, wind culls by its box and not its radius
+	std::vector<uint> culled;
+	CullForceFields(fields, float3(1, -1, -1), float3(8, 1, 1), culled);
+	CHECK(culled == std::vector<uint>({ 0, 1 }));
+	culled.clear();
+	CullForceFields(fields, float3(3, 3, 3), float3(4, 4, 4), culled);
+	CHECK(culled.empty());
+	CullForceFields(fields, float3(-0.5f, 18.5f, 0), float3(0.5f, 19.5f, 0), culled);
+	CHECK(culled == std::vector<uint>({ 2 }));
+}
+
+static void TestEvaluate()
+{
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> size(0.5f, 6.0f);
+	std::vector<ForceField> fields;
+	for (uint n = 0; n < 24; ++n)
+	{
+		ForceField field = MakeField(n % 4, float3(coordinate(random), coordinate(random), coordinate(random)), 10.0f * unit(random), size(random));
+		field.Axis = normalize(float3(unit(random), unit(random), unit(random)));
+		field.Extents = float3(size(random), size(random), size(random));
+		fields.push_back(field);
+	}
+
+	// Sorted along x so the blocks are compact and the culling drops fields, with a partial last block and a partial SSE tail
+	ForceFieldSoA particles;
+	const uint count = 3 * FORCE_FIELD_BLOCK_SIZE + 7;
+	for (uint n = 0; n < count; ++n)
+	{
+		particles.positionX.push_back(-12.0f + 24.0f * n / count);
+		particles.positionY.push_back(coordinate(random));
+		particles.positionZ.push_back(coordinate(random));
+		particles.velocityX.push_back(unit(random));
+		particles.velocityY.push_back(unit(random));
+		particles.velocityZ.push_back(unit(random));
+	}
+	particles.accelerationX.resize(count);
+	particles.accelerationY.resize(count);
+	particles.accelerationZ.resize(count);
+
+	ForceFieldSoA simd = particles;
+	EvaluateForceFields(particles, fields);
+	EvaluateForceFieldsSIMD(simd, fields);
+
+	bool culledMatches = true;
+	bool simdMatches = true;
+	uint pushed = 0;
+	for (uint n = 0; n < count; ++n)
+	{
+		const float3 position(particles.positionX[n], particles.positionY[n], particles.positionZ[n]);
+		const float3 velocity(particles.velocityX[n], particles.velocityY[n], particles.velocityZ[n]);
+		float3 expected;
+		for (const ForceField& field : fields)
+		{
+			expected += ForceFieldAcceleration(field, position, velocity);
+		}
+		const float3 scalar(particles.accelerationX[n], particles.accelerationY[n], particles.accelerationZ[n]);
+		const float3 sse(simd.accelerationX[n], simd.accelerationY[n], simd.accelerationZ[n]);
+		culledMatches &= length(scalar - expected) <= 1e-4f * (1.0f + length(expected));
+		simdMatches &= length(sse - scalar) <= 1e-4f * (1.0f + length(scalar));
+		pushed += length(expected) > 0.0f ? 1 : 0;
+	}
+	CHECK(culledMatches);
+	CHECK(simdMatches);
+	CHECK(pushed > count / 4);
+}
+
+int main()
+{
+	TestFalloff();
+	TestAttractor();
+	TestVortex();
+	TestWind();
+	TestDrag();
+	TestCulling();
+	TestEvaluate();
+	return CheckResult("ForceFieldTests");
+}
@@ -0,0 +1,95 @@
+// Hi-Z pyramid levels against the min and max of the depth pixels each texel covers, for even, odd and clamped sizes
+#include "Check.h"
+#include "HiZ.h"
+
+#include <algorithm>
+#include <random>
+
+static std::vector<float> RandomDepth(uint width, uint height, uint seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+	std::vector<float> pixels(static_cast<size_t>(width) * height);
+	for (float& pixel : pixels)
+	{
+		pixel = depth(random);
+	}
+	return pixels;
+}
+
+static void TestMipCount()
+{
+	CHECK(HiZMipCount(1, 1) == 1);
+	CHECK(HiZMipCount(2, 1) == 2);
+	CHECK(HiZMipCount(3, 3) == 3);
+	CHECK(HiZMipCount(1920, 1080) == 12);
+	CHECK(HiZMipCount(4096, 2160) == 13);
+	CHECK(HiZMipCount(8192, 8192) == HIZ_MAX_MIPS);
+
+	// Dimensions round up, 5 texels go 5, 3, 2, 1
+	CHECK(HiZMipDimension(5, 1) == 3 && HiZMipDimension(5, 2) == 2 && HiZMipDimension(5, 3) == 1 && HiZMipDimension(5, 8) == 1);
+}
+
+static void TestHandPyramid()
+{
+	// 3x2: the second mip's texel (1, 0) only covers the last column, Load clamps the missing one onto it
+	const std::vector<float> depth = { 0.5f, 0.2f, 0.9f, 0.4f, 0.7f, 0.1f };
+	const std::vector<HiZLevel> levels = BuildHiZ(depth, 3, 2);
+	CHECK(levels.size() == 3);
+	CHECK(levels[1].width == 2 && levels[1].height == 1);
+	CHECK(levels[1].texels[0].x == 0.2f && levels[1].texels[0].y == 0.7f);
+	CHECK(levels[1].texels[1].x == 0.1f && levels[1].texels[1].y == 0.9f);
+	CHECK(levels[2].width == 1 && levels[2].height == 1);
+	CHECK(levels[2].texels[0].x == 0.1f && levels[2].texels[0].y == 0.9f);
+	CHECK(levels[0].Load(-3, 7).x == 0.4f && levels[0].Load(5, -1).x == 0.9f);
+}
+
+static void TestAgainstBruteForce()
+{
+	const uint sizes[][2] = { { 64, 64 }, { 37, 23 }, { 1, 17 }, { 160, 90 }, { 33, 1 } };
+	uint seed = 1;
+	for (const auto& size : sizes)
+	{
+		const uint width = size[0];
+		const uint height = size[1];
+		const std::vector<float> depth = RandomDepth(width, height, seed++);
+		const std::vector<HiZLevel> levels = BuildHiZ(depth, width, height);
+		CHECK(levels.size() == HiZMipCount(width, height));
+		CHECK(levels.back().width == 1 && levels.back().height == 1);
+
+		// Texel i of a mip covers mip 0 pixels [i << mip, (i + 1) << mip), cut off at the image edge
+		bool matches = true;
+		for (uint mip = 0; mip < levels.size(); ++mip)
+		{
+			const HiZLevel& level = levels[mip];
+			matches &= level.width == HiZMipDimension(width, mip) && level.height == HiZMipDimension(height, mip);
+			for (uint y = 0; y < level.height; ++y)
+			{
+				for (uint x = 0; x < level.width; ++x)
+				{
+					float closest = 1e30f;
+					float furthest = -1e30f;
+					for (uint py = y << mip; py < (std::min)((y + 1) << mip, height); ++py)
+					{
+						for (uint px = x << mip; px < (std::min)((x + 1) << mip, width); ++px)
+						{
+							closest = (std::min)(closest, depth[py * width + px]);
+							furthest = (std::max)(furthest, depth[py * width + px]);
+						}
+					}
+					const float2 texel = level.texels[y * level.width + x];
+					matches &= texel.x == closest && texel.y == furthest;
+				}
+			}
+		}
+		CHECK(matches);
+	}
+}
+
+int main()
+{
+	TestMipCount();
+	TestHandPyramid();
+	TestAgainstBruteForce();
+	return CheckResult("HiZTests");
+}
@@ -0,0 +1,376 @@
+// Inflate on stored, fixed and dynamic Huffman streams, PNG and TGA decoding against hand built files, and their parse errors
+#include "Check.h"
+#include "ImageFile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// zlib.compress(b"smoke smoke smoke spark", 9), one fixed Huffman block with back references
+static const uint8_t FixedStream[] = { 0x78, 0xda, 0x2b, 0xce, 0xcd, 0xcf, 0x4e, 0x55, 0x28, 0x46, 0x26, 0x0b, 0x12, 0x8b, 0xb2, 0x01, 0x6a, 0xd5,
+	0x08, 0xdf };
+
+// zlib.compress of DynamicText(), one dynamic Huffman block
+static const uint8_t DynamicStream[] = { 0x78, 0xda, 0x9d, 0xc5, 0x01, 0x09, 0x00, 0x30, 0x10, 0x03, 0x31, 0xad, 0xed, 0x5d, 0xfd, 0x5b, 0xd8,
+	0x34, 0x3c, 0x04, 0x12, 0x3b, 0x62, 0x73, 0x9d, 0xca, 0xcc, 0x79, 0x07, 0xe9, 0xce, 0xb3, 0x7e, 0x3e, 0x51, 0x72, 0x4d, 0x42 };
+
+static std::vector<uint8_t> DynamicText()
+{
+	std::vector<uint8_t> text(200);
+	for (uint32_t n = 0; n < 200; ++n)
+	{
+		text[n] = static_cast<uint8_t>('a' + ((n * 8) ^ (n >> 3)) % 5);
+	}
+	return text;
+}
+
+static void PutBigEndian32(std::vector<uint8_t>& bytes, uint32_t value)
+{
+	bytes.insert(bytes.end(), { static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) });
+}
+
+// zlib stream of stored blocks, the simplest one Inflate takes
+static std::vector<uint8_t> StoredStream(const std::vector<uint8_t>& data, size_t blockSize = 65535)
+{
+	std::vector<uint8_t> stream = { 0x78, 0x01 };
+	size_t offset = 0;
+	do
+	{
+		const size_t length = (std::min)(blockSize, data.size() - offset);
+		stream.push_back(offset + length == data.size() ? 1 : 0);
+		stream.insert(stream.end(), { static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(~length), static_cast<uint8_t>(~length >> 8) });
+		stream.insert(stream.end(), data.begin() + offset, data.begin() + offset + length);
+		offset += length;
+	} while (offset < data.size());
+	uint32_t a = 1;
+	uint32_t b = 0;
+	for (uint8_t value : data)
+	{
+		a = (a + value) % 65521;
+		b = (b + a) % 65521;
+	}
+	PutBigEndian32(stream, (b << 16) | a);
+	return stream;
+}
+
+static uint32_t Crc32(const uint8_t* data, size_t size)
+{
+	uint32_t crc = 0xffffffff;
+	for (size_t n = 0; n < size; ++n)
+	{
+		crc ^= data[n];
+		for (int bit = 0; bit < 8; ++bit)
+		{
+			crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+		}
+	}
+	return ~crc;
+}
+
+static void PutChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& body)
+{
+	PutBigEndian32(png, static_cast<uint32_t>(body.size()));
+	const size_t start = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), body.begin(), body.end());
+	PutBigEndian32(png, Crc32(png.data() + start, png.size() - start));
+}
+
+// PNG of scanlines that already carry their filter bytes, extra chunks go between IHDR and IDAT
+static std::vector<uint8_t> MakePNG(uint32_t width, uint32_t height, uint8_t bitDepth, uint8_t colorType, const std::vector<uint8_t>& scanlines,
+	const std::vector<std::pair<const char*, std::vector<uint8_t>>>& chunks = {}, uint8_t interlace = 0)
+{
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	std::vector<uint8_t> header;
+	PutBigEndian32(header, width);
+	PutBigEndian32(header, height);
+	header.insert(header.end(), { bitDepth, colorType, 0, 0, interlace });
+	PutChunk(png, "IHDR", header);
+	for (const auto& chunk : chunks)
+	{
+		PutChunk(png, chunk.first, chunk.second);
+	}
+	PutChunk(png, "IDAT", StoredStream(scanlines));
+	PutChunk(png, "IEND", {});
+	return png;
+}
+
+static int Paeth(int a, int b, int c)
+{
+	const int p = a + b - c;
+	const int pa = std::abs(p - a);
+	const int pb = std::abs(p - b);
+	const int pc = std::abs(p - c);
+	return pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+}
+
+// Filters each row of 8 bit RGBA with filter row % 5, so one image runs None, Sub, Up, Average and Paeth
+static std::vector<uint8_t> FilterRows(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height)
+{
+	const size_t rowBytes = static_cast<size_t>(width) * 4;
+	std::vector<uint8_t> scanlines;
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t filter = static_cast<uint8_t>(y % 5);
+		scanlines.push_back(filter);
+		for (size_t n = 0; n < rowBytes; ++n)
+		{
+			const int a = n >= 4 ? pixels[y * rowBytes + n - 4] : 0;
+			const int b = y > 0 ? pixels[(y - 1) * rowBytes + n] : 0;
+			const int c = n >= 4 && y > 0 ? pixels[(y - 1) * rowBytes + n - 4] : 0;
+			const int predictor = filter == 1 ? a : filter == 2 ? b : filter == 3 ? (a + b) / 2 : filter == 4 ? Paeth(a, b, c) : 0;
+			scanlines.push_back(static_cast<uint8_t>(pixels[y * rowBytes + n] - predictor));
+		}
+	}
+	return scanlines;
+}
+
+static bool PixelIs(const Image& image, uint32_t x, uint32_t y, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+	const uint8_t* pixel = image.Pixels.data() + (static_cast<size_t>(y) * image.Width + x) * 4;
+	return pixel[0] == r && pixel[1] == g && pixel[2] == b && pixel[3] == a;
+}
+
+static void TestInflate()
+{
+	std::vector<uint8_t> output(23);
+	CHECK(Inflate(FixedStream, sizeof(FixedStream), output));
+	CHECK(memcmp(output.data(), "smoke smoke smoke spark", 23) == 0);
+
+	const std::vector<uint8_t> text = DynamicText();
+	output.assign(text.size(), 0);
+	CHECK(Inflate(DynamicStream, sizeof(DynamicStream), output));
+	CHECK(output == text);
+
+	// Stored blocks, split over several
+	const std::vector<uint8_t> stored = StoredStream(text, 64);
+	output.assign(text.size(), 0);
+	CHECK(Inflate(stored.data(), stored.size(), output) && output == text);
+
+	// The output has to come out exactly the expected size, and the Adler-32 trailer has to match
+	output.assign(text.size() - 1, 0);
+	CHECK(!Inflate(DynamicStream, sizeof(DynamicStream), output));
+	output.assign(text.size() + 1, 0);
+	CHECK(!Inflate(DynamicStream, sizeof(DynamicStream), output));
+	std::vector<uint8_t> damaged(DynamicStream, DynamicStream + sizeof(DynamicStream));
+	damaged.back() ^= 1;
+	output.assign(text.size(), 0);
+	CHECK(!Inflate(damaged.data(), damaged.size(), output));
+
+	// Every cut of the stream fails rather than reading past the end
+	bool rejected = true;
+	for (size_t size = 0; size < sizeof(DynamicStream); ++size)
+	{
+		output.assign(text.size(), 0);
+		rejected &= !Inflate(DynamicStream, size, output);
+	}
+	CHECK(rejected);
+
+	// A reserved block type and a bad zlib header
+	damaged.assign(stored.begin(), stored.end());
+	damaged[2] = 0x07;
+	CHECK(!Inflate(damaged.data(), damaged.size(), output));
+	damaged.assign(stored.begin(), stored.end());
+	damaged[1] ^= 1;
+	CHECK(!Inflate(damaged.data(), damaged.size(), output));
+}
+
+static void TestPNG()
+{
+	// 3x5 RGBA with every filter type, values that wrap when filtered
+	std::vector<uint8_t> pixels(3 * 5 * 4);
+	for (size_t n = 0; n < pixels.size(); ++n)
+	{
+		pixels[n] = static_cast<uint8_t>(n * 37 + (n / 12) * 101);
+	}
+	Image image;
+	std::string error;
+	std::vector<uint8_t> png = MakePNG(3, 5, 8, 6, FilterRows(pixels, 3, 5));
+	CHECK(DecodePNG(png.data(), png.size(), image, error));
+	CHECK(image.Width == 3 && image.Height == 5 && image.Pixels == pixels);
+
+	// 1 bit gray: 0b10110000 is white, black, white, white
+	png = MakePNG(4, 1, 1, 0, { 0, 0xb0 });
+	CHECK(DecodePNG(png.data(), png.size(), image, error));
+	CHECK(PixelIs(image, 0, 0, 255, 255, 255, 255) && PixelIs(image, 1, 0, 0, 0, 0, 255) && PixelIs(image, 3, 0, 255, 255, 255, 255));
+
+	// 2 bit palette with tRNS alpha for the first two entries: indices 0, 1, 2, 1
+	const std::vector<std::pair<const char*, std::vector<uint8_t>>> palette = { { "PLTE", { 255, 0, 0, 0, 255, 0, 0, 0, 255 } }, { "tRNS", { 0, 128 } } };
+	png = MakePNG(4, 1, 2, 3, { 0, 0x19 }, palette);
+	CHECK(DecodePNG(png.data(), png.size(), image, error));
+	CHECK(PixelIs(image, 0, 0, 255, 0, 0, 0) && PixelIs(image, 1, 0, 0, 255, 0, 128) && PixelIs(image, 2, 0, 0, 0, 255, 255) &&
+		PixelIs(image, 3, 0, 0, 255, 0, 128));
+
+	// 16 bit RGB keeps the high byte, a tRNS key makes its exact color transparent
+	png = MakePNG(2, 1, 16, 2, { 0, 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xff, 0xff, 0x00, 0x01, 0x00, 0x02 }, { { "tRNS", { 0xff, 0xff, 0x00, 0x01, 0x00, 0x02 } } });
+	CHECK(DecodePNG(png.data(), png.size(), image, error));
+	CHECK(PixelIs(image, 0, 0, 0x12, 0x56, 0x9a, 255) && PixelIs(image, 1, 0, 255, 0, 0, 0));
+
+	// 8 bit gray with alpha, and an ancillary chunk that is skipped
+	png = MakePNG(1, 2, 8, 4, { 0, 200, 50, 2, 10, 10 }, { { "tEXt", { 'a', 0, 'b' } } });
+	CHECK(DecodePNG(png.data(), png.size(), image, error));
+	CHECK(PixelIs(image, 0, 0, 200, 200, 200, 50) && PixelIs(image, 0, 1, 210, 210, 210, 60));
+}
+
+static void TestPNGErrors()
+{
+	Image image;
+	std::string error;
+	const std::vector<uint8_t> valid = MakePNG(2, 2, 8, 2, { 0, 1, 2, 3, 4, 5, 6, 0, 7, 8, 9, 10, 11, 12 });
+	CHECK(DecodePNG(valid.data(), valid.size(), image, error));
+
+	auto fails = [&](const std::vector<uint8_t>& png, const char* expected)
+	{
+		error.clear();
+		return !DecodePNG(png.data(), png.size(), image, error) && error == expected;
+	};
+
+	std::vector<uint8_t> damaged = valid;
+	damaged[1] = 'Q';
+	CHECK(fails(damaged, "not a PNG"));
+	CHECK(fails({}, "not a PNG"));
+
+	// Cut anywhere before IEND
+	bool truncated = true;
+	for (size_t size = 8; size < valid.size() - 12; ++size)
+	{
+		truncated &= !DecodePNG(valid.data(), size, image, error);
+	}
+	CHECK(truncated);
+	CHECK(fails(std::vector<uint8_t>(valid.begin(), valid.begin() + 20), "truncated PNG"));
+
+	CHECK(fails(MakePNG(2, 2, 8, 2, std::vector<uint8_t>(14, 0), {}, 1), "interlaced PNGs aren't supported"));
+	CHECK(fails(MakePNG(2, 2, 4, 2, std::vector<uint8_t>(14, 0)), "unsupported PNG size, color type or bit depth"));
+	CHECK(fails(MakePNG(2, 2, 16, 3, std::vector<uint8_t>(14, 0)), "unsupported PNG size, color type or bit depth"));
+	CHECK(fails(MakePNG(0, 2, 8, 2, { 0, 0 }), "unsupported PNG size, color type or bit depth"));
+	CHECK(fails(MakePNG(2, 1, 8, 3, { 0, 0, 0 }), "PNG without header or palette"));
+	CHECK(fails(MakePNG(2, 1, 8, 3, { 0, 0, 5 }, { { "PLTE", { 1, 2, 3, 4, 5, 6 } } }), "PNG palette index out of range"));
+	CHECK(fails(MakePNG(2, 1, 8, 3, { 0, 0, 0 }, { { "PLTE", { 1, 2, 3, 4 } } }), "bad PNG palette"));
+	CHECK(fails(MakePNG(2, 1, 8, 2, { 5, 0, 0, 0, 0, 0, 0 }), "bad PNG filter"));
+	CHECK(fails(MakePNG(2, 1, 8, 2, { 0, 0, 0, 0, 0, 0 }), "corrupt PNG image data"));
+	CHECK(fails(MakePNG(2, 1, 8, 2, { 0, 0, 0, 0, 0, 0, 0 }, { { "ABCD", {} } }), "unknown critical PNG chunk"));
+
+	damaged = valid;
+	damaged[8 + 8 + 11] = 1;
+	CHECK(fails(damaged, "unknown PNG compression or filter method"));
+}
+
+// 18 byte TGA header followed by data
+static std::vector<uint8_t> MakeTGA(uint8_t imageType, uint16_t width, uint16_t height, uint8_t pixelDepth, uint8_t descriptor, const std::vector<uint8_t>& data)
+{
+	std::vector<uint8_t> tga(18, 0);
+	tga[2] = imageType;
+	tga[12] = static_cast<uint8_t>(width);
+	tga[13] = static_cast<uint8_t>(width >> 8);
+	tga[14] = static_cast<uint8_t>(height);
+	tga[15] = static_cast<uint8_t>(height >> 8);
+	tga[16] = pixelDepth;
+	tga[17] = descriptor;
+	tga.insert(tga.end(), data.begin(), data.end());
+	return tga;
+}
+
+static void TestTGA()
+{
+	Image image;
+	std::string error;
+
+	// 24 bit BGR, bottom row first
+	std::vector<uint8_t> tga = MakeTGA(2, 2, 2, 24, 0, { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 });
+	CHECK(DecodeTGA(tga.data(), tga.size(), image, error));
+	CHECK(image.Width == 2 && image.Height == 2);
+	CHECK(PixelIs(image, 0, 1, 3, 2, 1, 255) && PixelIs(image, 1, 1, 6, 5, 4, 255) && PixelIs(image, 0, 0, 9, 8, 7, 255));
+
+	// 32 bit BGRA, top row first and right to left
+	tga = MakeTGA(2, 2, 1, 32, 0x20 | 0x10 | 8, { 1, 2, 3, 4, 5, 6, 7, 8 });
+	CHECK(DecodeTGA(tga.data(), tga.size(), image, error));
+	CHECK(PixelIs(image, 1, 0, 3, 2, 1, 4) && PixelIs(image, 0, 0, 7, 6, 5, 8));
+
+	// RLE: a run of 3 then 2 raw texels, across rows of 5 x 1
+	tga = MakeTGA(10, 5, 1, 24, 0x20, { 0x82, 10, 20, 30, 0x01, 1, 2, 3, 4, 5, 6 });
+	CHECK(DecodeTGA(tga.data(), tga.size(), image, error));
+	CHECK(PixelIs(image, 0, 0, 30, 20, 10, 255) && PixelIs(image, 2, 0, 30, 20, 10, 255) && PixelIs(image, 3, 0, 3, 2, 1, 255) &&
+		PixelIs(image, 4, 0, 6, 5, 4, 255));
+
+	// RLE gray, and 16 bit with an alpha bit: 0x7c00 is red without the attribute bit, so transparent
+	tga = MakeTGA(11, 3, 1, 8, 0x20, { 0x81, 77, 0x00, 99 });
+	CHECK(DecodeTGA(tga.data(), tga.size(), image, error));
+	CHECK(PixelIs(image, 1, 0, 77, 77, 77, 255) && PixelIs(image, 2, 0, 99, 99, 99, 255));
+	tga = MakeTGA(2, 2, 1, 16, 0x20 | 1, { 0x00, 0x7c, 0xe0, 0x83 });
+	CHECK(DecodeTGA(tga.data(), tga.size(), image, error));
+	CHECK(PixelIs(image, 0, 0, 255, 0, 0, 0) && PixelIs(image, 1, 0, 0, 255, 0, 255));
+}
+
+static void TestTGAErrors()
+{
+	Image image;
+	std::string error;
+	auto fails = [&](const std::vector<uint8_t>& tga, const char* expected)
+	{
+		error.clear();
+		return !DecodeTGA(tga.data(), tga.size(), image, error) && error == expected;
+	};
+
+	const std::vector<uint8_t> valid = MakeTGA(2, 2, 2, 24, 0, std::vector<uint8_t>(12, 1));
+	CHECK(fails(std::vector<uint8_t>(valid.begin(), valid.begin() + 17), "truncated TGA"));
+	bool truncated = true;
+	for (size_t size = 18; size < valid.size(); ++size)
+	{
+		truncated &= fails(std::vector<uint8_t>(valid.begin(), valid.begin() + size), "truncated TGA");
+	}
+	CHECK(truncated);
+
+	std::vector<uint8_t> mapped = valid;
+	mapped[1] = 1;
+	CHECK(fails(mapped, "only true color and grayscale TGAs are supported"));
+	CHECK(fails(MakeTGA(1, 2, 2, 8, 0, std::vector<uint8_t>(4, 0)), "only true color and grayscale TGAs are supported"));
+	CHECK(fails(MakeTGA(2, 2, 2, 8, 0, std::vector<uint8_t>(4, 0)), "unsupported TGA size or pixel depth"));
+	CHECK(fails(MakeTGA(3, 2, 2, 16, 0, std::vector<uint8_t>(8, 0)), "unsupported TGA size or pixel depth"));
+	CHECK(fails(MakeTGA(2, 0, 2, 24, 0, {}), "unsupported TGA size or pixel depth"));
+
+	// An image ID longer than the file, and RLE packets cut off in the header byte, a repeated texel and raw texels
+	std::vector<uint8_t> id = valid;
+	id[0] = 200;
+	CHECK(fails(id, "truncated TGA"));
+	CHECK(fails(MakeTGA(10, 4, 1, 24, 0, { 0x81, 1, 2, 3 }), "truncated TGA"));
+	CHECK(fails(MakeTGA(10, 2, 1, 24, 0, { 0x81, 1, 2 }), "truncated TGA"));
+	CHECK(fails(MakeTGA(10, 2, 1, 24, 0, { 0x01, 1, 2, 3, 4 }), "truncated TGA"));
+}
+
+static void TestLoadImageFile()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "ImageFileTests.img";
+	Image image;
+	std::string error;
+	std::filesystem::remove(path);
+	CHECK(!LoadImageFile(path, image, error) && error == "can't open the file");
+
+	// The signature picks the decoder, not the extension
+	const std::vector<std::vector<uint8_t>> files = { MakePNG(1, 1, 8, 6, { 0, 1, 2, 3, 4 }), MakeTGA(2, 1, 1, 32, 8, { 3, 2, 1, 4 }) };
+	for (const std::vector<uint8_t>& file : files)
+	{
+		{
+			std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<const char*>(file.data()), file.size());
+		}
+		CHECK(LoadImageFile(path, image, error));
+		CHECK(image.Width == 1 && PixelIs(image, 0, 0, 1, 2, 3, 4));
+	}
+	std::filesystem::remove(path);
+}
+
+int main()
+{
+	TestInflate();
+	TestPNG();
+	TestPNGErrors();
+	TestTGA();
+	TestTGAErrors();
+	TestLoadImageFile();
+	return CheckResult("ImageFileTests");
+}
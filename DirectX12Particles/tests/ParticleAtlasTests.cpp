@@ -0,0 +1,326 @@
+// Skyline packing against hand placed rects, no overlap over random sizes, byte identical rebuilds, texel copies and flipbook frame order
+#include "Check.h"
+#include "ParticleAtlas.h"
+
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+static const uint32_t FormatRGBA8 = 28; // DXGI_FORMAT_R8G8B8A8_UNORM
+static const uint32_t FormatBC1 = 71; // DXGI_FORMAT_BC1_UNORM
+
+// DDS image of a 2D texture whose texels are (source + 1, mip, x, y) for RGBA8, and seeded noise for BC formats
+static std::vector<uint8_t> MakeSourceFile(uint32_t format, uint width, uint height, uint mipCount, uint source)
+{
+	std::vector<uint8_t> file;
+	WriteDDSHeader(format, width, height, 1, mipCount, file);
+	std::minstd_rand random(source + 1);
+	for (uint mip = 0; mip < mipCount; ++mip)
+	{
+		const uint mipWidth = (std::max)(width >> mip, 1u);
+		const uint mipHeight = (std::max)(height >> mip, 1u);
+		if (format == FormatRGBA8)
+		{
+			for (uint y = 0; y < mipHeight; ++y)
+			{
+				for (uint x = 0; x < mipWidth; ++x)
+				{
+					file.insert(file.end(), { static_cast<uint8_t>(source + 1), static_cast<uint8_t>(mip), static_cast<uint8_t>(x), static_cast<uint8_t>(y) });
+				}
+			}
+		}
+		else
+		{
+			const size_t size = GetDDSSurfaceSize(format, mipWidth, mipHeight);
+			for (size_t n = 0; n < size; ++n)
+			{
+				file.push_back(static_cast<uint8_t>(random()));
+			}
+		}
+	}
+	return file;
+}
+
+// Sources over files, which have to stay where they are while the sources are in use
+static std::vector<ParticleAtlasSource> MakeSources(const std::vector<std::vector<uint8_t>>& files, std::vector<DDSTexture>& textures)
+{
+	textures.resize(files.size());
+	std::vector<ParticleAtlasSource> sources(files.size());
+	for (size_t n = 0; n < files.size(); ++n)
+	{
+		CHECK(ParseDDS(files[n].data(), files[n].size(), textures[n]));
+		sources[n] = { "Source" + std::to_string(n), &textures[n], 1, 1, 1 };
+	}
+	return sources;
+}
+
+static bool Overlap(const AtlasPlacement& a, uint2 aSize, const AtlasPlacement& b, uint2 bSize)
+{
+	return a.Slice == b.Slice && a.X < b.X + bSize.x && b.X < a.X + aSize.x && a.Y < b.Y + bSize.y && b.Y < a.Y + aSize.y;
+}
+
+static void TestSkyline()
+{
+	// Each rect goes as high as it fits, the leftmost spot of those
+	SkylinePacker packer(8);
+	uint x = 99;
+	uint y = 99;
+	CHECK(packer.Insert(4, 4, x, y) && x == 0 && y == 0);
+	CHECK(packer.Insert(4, 2, x, y) && x == 4 && y == 0);
+	CHECK(packer.Insert(4, 2, x, y) && x == 4 && y == 2);
+	CHECK(packer.Insert(2, 1, x, y) && x == 0 && y == 4);
+	CHECK(packer.Insert(8, 1, x, y) && x == 0 && y == 5);
+	CHECK(packer.Insert(6, 2, x, y) && x == 0 && y == 6);
+	CHECK(packer.Insert(2, 2, x, y) && x == 6 && y == 6);
+	CHECK(!packer.Insert(1, 1, x, y));
+
+	SkylinePacker tight(4);
+	CHECK(!tight.Insert(5, 1, x, y));
+	CHECK(!tight.Insert(1, 5, x, y));
+	CHECK(tight.Insert(4, 4, x, y) && x == 0 && y == 0);
+}
+
+static void TestPackNoOverlap()
+{
+	std::mt19937 random(7);
+	for (uint round = 0; round < 20; ++round)
+	{
+		std::vector<uint2> sizes(1 + random() % 200);
+		for (uint2& size : sizes)
+		{
+			size = uint2(4 * (1 + random() % 64), 4 * (1 + random() % 64));
+		}
+		// Small slices in every other round so rects spill into more of them
+		const uint maxSize = round % 2 ? 512 : 4096;
+		uint size;
+		uint sliceCount;
+		std::vector<AtlasPlacement> placements;
+		CHECK(PackAtlas(sizes.data(), static_cast<uint>(sizes.size()), 4, maxSize, size, sliceCount, placements));
+		CHECK(placements.size() == sizes.size());
+		CHECK(size >= 4 && size <= maxSize && (size & (size - 1)) == 0);
+		CHECK(sliceCount >= 1 && (sliceCount == 1 || size == maxSize));
+
+		bool inside = true;
+		bool separate = true;
+		for (size_t a = 0; a < sizes.size(); ++a)
+		{
+			inside &= placements[a].Slice < sliceCount && placements[a].X + sizes[a].x <= size && placements[a].Y + sizes[a].y <= size;
+			for (size_t b = a + 1; b < sizes.size(); ++b)
+			{
+				separate &= !Overlap(placements[a], sizes[a], placements[b], sizes[b]);
+			}
+		}
+		CHECK(inside);
+		CHECK(separate);
+	}
+
+	// Four 64x64 rects fill a 128 slice, a fifth spills into a second one at the maximum size
+	std::vector<uint2> sizes(4, uint2(64, 64));
+	uint size;
+	uint sliceCount;
+	std::vector<AtlasPlacement> placements;
+	CHECK(PackAtlas(sizes.data(), 4, 4, 4096, size, sliceCount, placements) && size == 128 && sliceCount == 1);
+	sizes.push_back(uint2(64, 64));
+	CHECK(PackAtlas(sizes.data(), 5, 4, 128, size, sliceCount, placements) && size == 128 && sliceCount == 2);
+	CHECK(placements[4].Slice == 1 && placements[4].X == 0 && placements[4].Y == 0);
+	sizes.push_back(uint2(256, 4));
+	CHECK(!PackAtlas(sizes.data(), 6, 4, 128, size, sliceCount, placements));
+}
+
+static void TestDeterministic()
+{
+	std::vector<std::vector<uint8_t>> files;
+	std::mt19937 random(11);
+	for (uint n = 0; n < 24; ++n)
+	{
+		files.push_back(MakeSourceFile(FormatBC1, 4 * (1 + random() % 40), 4 * (1 + random() % 40), 1 + random() % 5, n));
+	}
+	std::vector<DDSTexture> textures;
+	const std::vector<ParticleAtlasSource> sources = MakeSources(files, textures);
+
+	std::vector<uint8_t> first;
+	std::vector<uint8_t> second;
+	std::vector<ParticleAtlasEntry> firstEntries;
+	std::vector<ParticleAtlasEntry> secondEntries;
+	std::string error;
+	CHECK(BuildParticleAtlas(sources.data(), static_cast<uint>(sources.size()), first, firstEntries, error));
+	CHECK(BuildParticleAtlas(sources.data(), static_cast<uint>(sources.size()), second, secondEntries, error));
+	CHECK(!first.empty() && first == second);
+	CHECK(firstEntries.size() == sources.size() && secondEntries.size() == sources.size());
+	CHECK(memcmp(firstEntries.data(), secondEntries.data(), sizeof(ParticleAtlasEntry) * firstEntries.size()) == 0);
+
+	// Names come through in source order, and the rects of the placed sources never share a texel
+	DDSTexture atlas;
+	CHECK(ParseDDS(first.data(), first.size(), atlas));
+	bool named = true;
+	bool separate = true;
+	for (size_t a = 0; a < firstEntries.size(); ++a)
+	{
+		named &= sources[a].Name == firstEntries[a].Name;
+		for (size_t b = a + 1; b < firstEntries.size(); ++b)
+		{
+			const float4& ra = firstEntries[a].Rect;
+			const float4& rb = firstEntries[b].Rect;
+			separate &= firstEntries[a].Slice != firstEntries[b].Slice || ra.x >= rb.z || rb.x >= ra.z || ra.y >= rb.w || rb.y >= ra.w;
+		}
+	}
+	CHECK(named);
+	CHECK(separate);
+
+	// A table written and read back is the same bytes
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "ParticleAtlasTests.bin";
+	std::vector<ParticleAtlasEntry> loaded;
+	CHECK(SaveParticleAtlasTable(path, firstEntries));
+	CHECK(LoadParticleAtlasTable(path, loaded));
+	CHECK(loaded.size() == firstEntries.size() && memcmp(loaded.data(), firstEntries.data(), sizeof(ParticleAtlasEntry) * loaded.size()) == 0);
+	std::filesystem::remove(path);
+	CHECK(!LoadParticleAtlasTable(path, loaded));
+}
+
+static void TestCopies()
+{
+	// 3 mips everywhere pads rects to multiples of 4, the 33x5 source takes a 36x8 rect
+	const uint2 sizes[3] = { uint2(20, 12), uint2(8, 8), uint2(33, 5) };
+	std::vector<std::vector<uint8_t>> files;
+	for (uint n = 0; n < 3; ++n)
+	{
+		files.push_back(MakeSourceFile(FormatRGBA8, sizes[n].x, sizes[n].y, n == 1 ? 4 : 3, n));
+	}
+	std::vector<DDSTexture> textures;
+	const std::vector<ParticleAtlasSource> sources = MakeSources(files, textures);
+	std::vector<uint8_t> dds;
+	std::vector<ParticleAtlasEntry> entries;
+	std::string error;
+	CHECK(BuildParticleAtlas(sources.data(), 3, dds, entries, error));
+	DDSTexture atlas;
+	CHECK(ParseDDS(dds.data(), dds.size(), atlas));
+	CHECK(atlas.MipCount == 3 && atlas.ArraySize == 1 && atlas.Width == 64 && atlas.Width == atlas.Height);
+	if (entries.size() != 3 || atlas.Subresources.size() != 3)
+	{
+		CHECK(false);
+		return;
+	}
+
+	// Every texel of every mip lands at the rect's origin shifted down by the mip, the rest of the atlas stays zero
+	std::vector<uint> owner(static_cast<size_t>(atlas.Width) * atlas.Height, 0);
+	for (uint n = 0; n < 3; ++n)
+	{
+		const uint left = static_cast<uint>(entries[n].Rect.x * atlas.Width);
+		const uint top = static_cast<uint>(entries[n].Rect.y * atlas.Height);
+		CHECK(left % 4 == 0 && top % 4 == 0);
+		CHECK_NEAR(entries[n].Rect.z - entries[n].Rect.x, static_cast<double>(sizes[n].x) / atlas.Width, 1e-6);
+		CHECK_NEAR(entries[n].Rect.w - entries[n].Rect.y, static_cast<double>(sizes[n].y) / atlas.Height, 1e-6);
+		bool copied = true;
+		for (uint mip = 0; mip < 3; ++mip)
+		{
+			const DDSSubresource& subresource = atlas.Subresources[mip];
+			for (uint y = 0; y < (std::max)(sizes[n].y >> mip, 1u); ++y)
+			{
+				for (uint x = 0; x < (std::max)(sizes[n].x >> mip, 1u); ++x)
+				{
+					const uint8_t* texel = static_cast<const uint8_t*>(subresource.Data) + ((top >> mip) + y) * subresource.RowPitch + ((left >> mip) + x) * 4;
+					copied &= texel[0] == n + 1 && texel[1] == mip && texel[2] == x && texel[3] == y;
+					if (mip == 0)
+					{
+						owner[(top + y) * atlas.Width + left + x] = n + 1;
+					}
+				}
+			}
+		}
+		CHECK(copied);
+	}
+	bool zero = true;
+	const uint8_t* top = static_cast<const uint8_t*>(atlas.Subresources[0].Data);
+	for (size_t texel = 0; texel < owner.size(); ++texel)
+	{
+		zero &= owner[texel] != 0 || memcmp(top + texel * 4, "\0\0\0\0", 4) == 0;
+	}
+	CHECK(zero);
+
+	// Sources in another format, with array slices, or with a grid the frame count doesn't fit are refused by name
+	std::vector<std::vector<uint8_t>> mixed = { files[0], MakeSourceFile(FormatBC1, 8, 8, 1, 1) };
+	std::vector<DDSTexture> mixedTextures;
+	const std::vector<ParticleAtlasSource> mixedSources = MakeSources(mixed, mixedTextures);
+	CHECK(!BuildParticleAtlas(mixedSources.data(), 2, dds, entries, error) && error.find("Source1") != std::string::npos);
+	CHECK(dds.empty() && entries.empty());
+	std::vector<ParticleAtlasSource> badGrid = sources;
+	badGrid[2].Columns = 2;
+	badGrid[2].FrameCount = 3;
+	CHECK(!BuildParticleAtlas(badGrid.data(), 3, dds, entries, error) && error.find("Source2") != std::string::npos);
+	CHECK(!BuildParticleAtlas(sources.data(), 0, dds, entries, error));
+}
+
+static void TestFlipbook()
+{
+	std::string name;
+	uint columns;
+	uint rows;
+	ParseParticleAtlasName("Textures/Smoke_8x4.dds", name, columns, rows);
+	CHECK(name == "Smoke" && columns == 8 && rows == 4);
+	ParseParticleAtlasName("Spark.dds", name, columns, rows);
+	CHECK(name == "Spark" && columns == 1 && rows == 1);
+	ParseParticleAtlasName("Fire_Big_4x2.dds", name, columns, rows);
+	CHECK(name == "Fire_Big" && columns == 4 && rows == 2);
+	ParseParticleAtlasName("Dust_0x4.dds", name, columns, rows);
+	CHECK(name == "Dust_0x4" && columns == 1 && rows == 1);
+	ParseParticleAtlasName("Dust_4x.dds", name, columns, rows);
+	CHECK(name == "Dust_4x" && columns == 1 && rows == 1);
+
+	// 4x2 grid with 7 frames over rect (0.25, 0.5) - (0.75, 1.0), played once over a 2 second lifetime
+	ParticleAtlasEntry entry = MakeParticleAtlasEntry("Smoke");
+	entry.Rect = float4(0.25f, 0.5f, 0.75f, 1.0f);
+	entry.Slice = 3;
+	entry.Columns = 4;
+	entry.Rows = 2;
+	entry.FrameCount = 7;
+	const ParticleAtlasConstants atlas = MakeParticleAtlasConstants(entry, 2.0f);
+	CHECK(atlas.Slice == 3 && atlas.FrameCount == 7 && atlas.Lifetime == 2.0f);
+
+	// Frames advance with age and hold the last one at death: age * 7 rounded down
+	CHECK(ParticleAtlasFrame(2.0f, atlas) == 0);
+	CHECK(ParticleAtlasFrame(1.75f, atlas) == 0);
+	CHECK(ParticleAtlasFrame(1.5f, atlas) == 1);
+	CHECK(ParticleAtlasFrame(1.0f, atlas) == 3);
+	CHECK(ParticleAtlasFrame(0.25f, atlas) == 6);
+	CHECK(ParticleAtlasFrame(0.0f, atlas) == 6);
+	CHECK(ParticleAtlasFrame(5.0f, atlas) == 0);
+	uint previous = 0;
+	bool ordered = true;
+	for (float left = 2.0f; left >= 0.0f; left -= 0.01f)
+	{
+		const uint frame = ParticleAtlasFrame(left, atlas);
+		ordered &= frame >= previous && frame <= previous + 1;
+		previous = frame;
+	}
+	CHECK(ordered && previous == 6);
+
+	// Frames go row by row from the top left, each cell is an eighth of the rect
+	float3 uv = ParticleAtlasUV(float2(0, 0), 0, atlas);
+	CHECK_NEAR(uv.x, 0.25, 1e-6);
+	CHECK_NEAR(uv.y, 0.5, 1e-6);
+	CHECK_NEAR(uv.z, 3.0, 1e-6);
+	uv = ParticleAtlasUV(float2(1, 1), 3, atlas);
+	CHECK_NEAR(uv.x, 0.75, 1e-6);
+	CHECK_NEAR(uv.y, 0.75, 1e-6);
+	uv = ParticleAtlasUV(float2(0, 0), 5, atlas);
+	CHECK_NEAR(uv.x, 0.375, 1e-6);
+	CHECK_NEAR(uv.y, 0.75, 1e-6);
+	uv = ParticleAtlasUV(float2(0.5f, 0.5f), 6, atlas);
+	CHECK_NEAR(uv.x, 0.5625, 1e-6);
+	CHECK_NEAR(uv.y, 0.875, 1e-6);
+
+	std::vector<ParticleAtlasEntry> entries = { MakeParticleAtlasEntry("Spark"), entry };
+	CHECK(FindParticleAtlasEntry(entries, "Smoke") == 1);
+	CHECK(FindParticleAtlasEntry(entries, "Spark") == 0);
+	CHECK(FindParticleAtlasEntry(entries, "Smok") == 2);
+}
+
+int main()
+{
+	TestSkyline();
+	TestPackNoOverlap();
+	TestDeterministic();
+	TestCopies();
+	TestFlipbook();
+	return CheckResult("ParticleAtlasTests");
+}
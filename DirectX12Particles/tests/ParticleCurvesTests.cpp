@@ -0,0 +1,118 @@
+// Curve atlas against the exact curves it bakes, and the packed spawn tint the curves multiply
+#include "Check.h"
+#include "ParticleCurves.h"
+
+static ParticleCurves FireCurves()
+{
+	ParticleCurves curves;
+	curves.Color = { { 0.0f, float3(1.0f, 0.9f, 0.2f) }, { 0.35f, float3(1.0f, 0.3f, 0.0f) }, { 1.0f, float3(0.2f, 0.2f, 0.2f) } };
+	curves.Alpha = { { 0.0f, 0.0f }, { 0.1f, 1.0f }, { 0.8f, 1.0f }, { 1.0f, 0.0f } };
+	curves.Scale = { { 0.0f, 0.2f }, { 0.5f, 1.5f }, { 1.0f, 0.5f } };
+	curves.Drag = { { 0.2f, 0.0f }, { 0.9f, 3.0f } };
+	curves.Rotation = { { 0.0f, 0.0f }, { 1.0f, 6.0f } };
+	return curves;
+}
+
+// Largest difference over the sample's components
+static float SampleError(const ParticleCurveSample& a, const ParticleCurveSample& b)
+{
+	const float4 color = abs(a.Color - b.Color);
+	float error = (max)((max)(color.x, color.y), (max)(color.z, color.w));
+	error = (max)(error, std::fabs(a.Scale - b.Scale));
+	error = (max)(error, std::fabs(a.Drag - b.Drag));
+	return (max)(error, std::fabs(a.Rotation - b.Rotation));
+}
+
+static void TestAtlasError()
+{
+	const ParticleCurves fire = FireCurves();
+	ParticleCurves linear;
+	linear.Scale = { { 0.0f, 1.0f }, { 1.0f, 3.0f } };
+	const CurveAtlas atlas = BakeCurveAtlas({ fire, linear, ParticleCurves() });
+	CHECK(atlas.SliceCount == 3 * CURVE_ATLAS_SLICES);
+
+	// Linear filtering only misses near keys between texel centers, by at most the slope change over a quarter texel.
+	// The sharpest kink is the alpha ramp at 0.1, 10 per age either way of it.
+	const float kinkBound = 10.0f / (4.0f * (CURVE_ATLAS_WIDTH - 1));
+	float fireError = 0.0f;
+	float linearError = 0.0f;
+	float emptyError = 0.0f;
+	for (int n = 0; n <= 1000; ++n)
+	{
+		const float age = n / 1000.0f;
+		fireError = (max)(fireError, SampleError(SampleCurveAtlas(atlas, 0, age), EvaluateParticleCurves(fire, age)));
+		linearError = (max)(linearError, SampleError(SampleCurveAtlas(atlas, 1, age), EvaluateParticleCurves(linear, age)));
+		emptyError = (max)(emptyError, SampleError(SampleCurveAtlas(atlas, 2, age), EvaluateParticleCurves(ParticleCurves(), age)));
+	}
+	CHECK(fireError <= kinkBound);
+	CHECK(fireError > 0.0f); // Keys off the texel centers can't all be hit, or the test isn't sampling between them
+	CHECK_NEAR(linearError, 0.0, 1e-5);
+	CHECK_NEAR(emptyError, 0.0, 1e-6);
+
+	// Ages outside [0, 1] clamp like the sampler
+	CHECK_NEAR(SampleError(SampleCurveAtlas(atlas, 0, -0.5f), SampleCurveAtlas(atlas, 0, 0.0f)), 0.0, 0.0);
+	CHECK_NEAR(SampleError(SampleCurveAtlas(atlas, 0, 1.5f), SampleCurveAtlas(atlas, 0, 1.0f)), 0.0, 0.0);
+}
+
+static void TestEndPoints()
+{
+	const ParticleCurves fire = FireCurves();
+	const CurveAtlas atlas = BakeCurveAtlas({ ParticleCurves(), fire });
+	for (float age : { 0.0f, 1.0f })
+	{
+		const ParticleCurveSample exact = EvaluateParticleCurves(fire, age);
+		const ParticleCurveSample sampled = SampleCurveAtlas(atlas, 1, age);
+		CHECK(sampled.Color.x == exact.Color.x && sampled.Color.y == exact.Color.y && sampled.Color.z == exact.Color.z);
+		CHECK(sampled.Color.w == exact.Color.w);
+		CHECK(sampled.Scale == exact.Scale);
+		CHECK(sampled.Drag == exact.Drag);
+		CHECK(sampled.Rotation == exact.Rotation);
+	}
+
+	// Values are held flat outside the keys
+	CHECK(EvaluateCurve(fire.Drag, 0.0f, -1.0f) == 0.0f);
+	CHECK(EvaluateCurve(fire.Drag, 1.0f, -1.0f) == 3.0f);
+	CHECK(EvaluateCurve({}, 0.5f, -1.0f) == -1.0f);
+}
+
+static void TestTintRoundTrip()
+{
+	// Every 8 bit value comes back exactly, the packed tint is what the curve color multiplies
+	for (uint value = 0; value < 256; ++value)
+	{
+		const float f = value / 255.0f;
+		const uint tint = PackParticleTint(float4(f, 1.0f - f, f, f));
+		CHECK((tint & 0xff) == value && ((tint >> 8) & 0xff) == 255 - value && ((tint >> 16) & 0xff) == value && (tint >> 24) == value);
+		const float4 color = UnpackParticleTint(tint);
+		CHECK(color.x == f && color.z == f && color.w == f);
+		CHECK_NEAR(color.y, 1.0f - f, 1e-6);
+	}
+
+	// Anything else is off by at most half a step, out of range values saturate
+	float error = 0.0f;
+	for (int n = 0; n <= 997; ++n)
+	{
+		const float f = n / 997.0f;
+		error = (max)(error, std::fabs(UnpackParticleTint(PackParticleTint(float4(f, f, f, f))).x - f));
+	}
+	CHECK(error <= 0.5f / 255.0f + 1e-6f);
+	CHECK(PackParticleTint(float4(-1.0f, 2.0f, 0.0f, 1.0f)) == 0xff00ff00);
+
+	Particle particle = {};
+	particle.tint = PackParticleTint(float4(1.0f, 0.5f, 0.0f, 1.0f));
+	ParticleCurveSample curves = EvaluateParticleCurves(FireCurves(), 0.5f);
+	particle = ApplyParticleCurves(particle, curves, 1.0f / 60.0f);
+	CHECK_NEAR(particle.color.x, curves.Color.x, 1e-6);
+	CHECK_NEAR(particle.color.y, 128.0f / 255.0f * curves.Color.y, 1e-6);
+	CHECK(particle.color.z == 0.0f);
+	CHECK_NEAR(particle.color.w, curves.Color.w, 1e-6);
+	CHECK(particle.scale == curves.Scale && particle.rotation == curves.Rotation);
+}
+
+int main()
+{
+	TestAtlasError();
+	TestEndPoints();
+	TestTintRoundTrip();
+	return CheckResult("ParticleCurvesTests");
+}
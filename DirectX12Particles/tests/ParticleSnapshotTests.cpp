@@ -0,0 +1,260 @@
+// Snapshot save, load and restore against a pool that kept running, and the LZ4 codec and snapshot loader on damaged input
+#include "Check.h"
+#include "LZ4.h"
+#include "ParticleSystemCPU.h"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+
+static const uint Capacity = 2000;
+
+static EmitterConstants TorchEmitter()
+{
+	EmitterConstants emitter = {};
+	emitter.deltaTime = 1.0f / 60.0f;
+	emitter.particleLifetime = 2.0f;
+	emitter.emitCount = 10;
+	emitter.maxParticleCount = Capacity;
+	emitter.emitAABBMin = float4(-1, 0, -1, 0);
+	emitter.emitAABBMax = float4(1, 1, 1, 0);
+	emitter.emitVelocityMin = float4(-0.2f, 0.5f, -0.2f, 0);
+	emitter.emitVelocityMax = float4(0.2f, 1, 0.2f, 0);
+	emitter.emitAccelerationMax = float4(0.15f, 4.8f, 0.15f, 0);
+	emitter.particleStartScale = 0.3f;
+	emitter.particleEndScale = 0.1f;
+	emitter.curveSet = CURVE_SET_NONE;
+	return emitter;
+}
+
+static void Step(ParticleSystemCPU& system, const EmitterConstants& emitter, int steps)
+{
+	const CullConstants cull = {};
+	const SPHConstants fluid = {};
+	const SpatialHashConstants hash = {};
+	const CollisionConstants collision = {};
+	const CurlNoiseConstants turbulence = {};
+	const VectorFieldConstants vectorFields = {};
+	const SubEmitterConstants subEmitter = {};
+	for (int n = 0; n < steps; ++n)
+	{
+		system.Update(emitter, cull, fluid, hash, collision, {}, turbulence, vectorFields, TRAIL_HEAD_NONE, subEmitter, false);
+	}
+}
+
+static bool SamePool(const ParticleSystemCPU& a, const ParticleSystemCPU& b)
+{
+	return a.GetAliveCount() == b.GetAliveCount() && a.GetDrawIndices() == b.GetDrawIndices() &&
+		memcmp(a.GetParticles().data(), b.GetParticles().data(), sizeof(Particle) * a.GetParticles().size()) == 0;
+}
+
+static std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& bytes)
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+static void TestRoundTrip(ThreadPool& pool)
+{
+	const EmitterConstants emitter = TorchEmitter();
+	ParticleSystemCPU system(Capacity, pool);
+	Step(system, emitter, 600);
+	CHECK(system.GetAliveCount() > 0 && system.GetAliveCount() < Capacity);
+
+	const ParticleSnapshotLayout layout = GetParticleSnapshotLayout(Capacity);
+	std::vector<uint8_t> image(layout.Size);
+	system.WriteSnapshot(image.data());
+
+	for (bool compress : { false, true })
+	{
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / (compress ? "ParticleSnapshotTests_lz4.bin" : "ParticleSnapshotTests_raw.bin");
+		CHECK(SaveParticleSnapshot(path, image.data(), image.size(), compress));
+		const size_t fileSize = static_cast<size_t>(std::filesystem::file_size(path));
+		CHECK(compress ? fileSize < layout.Size : fileSize == layout.Size);
+
+		std::vector<uint8_t> loaded(layout.Size);
+		CHECK(LoadParticleSnapshot(path, loaded.data(), Capacity));
+		CHECK(loaded == image);
+
+		// A restored pool carries on exactly like the one that was saved, stepping is deterministic so that one is stepped up again
+		ParticleSystemCPU restored(Capacity, pool);
+		ParticleSnapshotView view;
+		CHECK(ParseParticleSnapshot(loaded.data(), loaded.size(), view));
+		CHECK(restored.RestoreSnapshot(view));
+		CHECK(restored.GetAliveCount() == system.GetAliveCount());
+		ParticleSystemCPU original(Capacity, pool);
+		Step(original, emitter, 600);
+		CHECK(SamePool(original, system));
+		Step(original, emitter, 300);
+		Step(restored, emitter, 300);
+		CHECK(SamePool(original, restored));
+
+		// Another capacity is rejected on load and on restore
+		ParticleSystemCPU small(Capacity / 2, pool);
+		CHECK(!small.RestoreSnapshot(view));
+		std::vector<uint8_t> smallImage(GetParticleSnapshotLayout(Capacity / 2).Size);
+		CHECK(!LoadParticleSnapshot(path, smallImage.data(), Capacity / 2));
+		std::filesystem::remove(path);
+	}
+
+	// An index past the pool leaves the pool as it was
+	std::vector<uint8_t> corrupt = image;
+	reinterpret_cast<uint*>(corrupt.data() + layout.AliveIndices)[3] = Capacity + 5;
+	ParticleSnapshotView view;
+	CHECK(ParseParticleSnapshot(corrupt.data(), corrupt.size(), view));
+	ParticleSystemCPU before(Capacity, pool);
+	ParticleSystemCPU target(Capacity, pool);
+	CHECK(!target.RestoreSnapshot(view));
+	CHECK(SamePool(before, target));
+}
+
+static void TestDamagedSnapshots()
+{
+	std::vector<Particle> particles(Capacity);
+	std::vector<uint> alive(Capacity / 4);
+	std::vector<uint> dead(Capacity - alive.size());
+	for (uint n = 0; n < Capacity; ++n)
+	{
+		particles[n].position = float4(static_cast<float>(n % 17), 0, 0, 1);
+		particles[n].lifeTimeLeft = n < alive.size() ? 1.0f : 0.0f;
+		(n < alive.size() ? alive[n] : dead[n - alive.size()]) = n;
+	}
+	const ParticleSnapshotLayout layout = GetParticleSnapshotLayout(Capacity);
+	std::vector<uint8_t> image(layout.Size);
+	WriteParticleSnapshotImage(image.data(), Capacity, particles.data(), alive.data(), static_cast<uint>(alive.size()), dead.data(),
+		static_cast<uint>(dead.size()));
+
+	ParticleSnapshotView view;
+	CHECK(ParseParticleSnapshot(image.data(), image.size(), view));
+	CHECK(!ParseParticleSnapshot(image.data(), image.size() - 1, view));
+	CHECK(!ParseParticleSnapshot(image.data(), sizeof(ParticleSnapshotHeader) - 1, view));
+
+	// Every header field that has to match is checked
+	const size_t fields[] = { offsetof(ParticleSnapshotHeader, Magic), offsetof(ParticleSnapshotHeader, Version),
+		offsetof(ParticleSnapshotHeader, ParticleSize), offsetof(ParticleSnapshotHeader, AliveCount),
+		offsetof(ParticleSnapshotHeader, DeadCount), offsetof(ParticleSnapshotHeader, Compression) };
+	for (size_t field : fields)
+	{
+		std::vector<uint8_t> bad = image;
+		reinterpret_cast<uint*>(bad.data() + field)[0] += Capacity + 1;
+		CHECK(!ParseParticleSnapshot(bad.data(), bad.size(), view));
+	}
+
+	std::vector<uint8_t> loaded(layout.Size);
+	for (bool compress : { false, true })
+	{
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / "ParticleSnapshotTests_damaged.bin";
+		CHECK(SaveParticleSnapshot(path, image.data(), image.size(), compress));
+		const std::vector<uint8_t> file = ReadFile(path);
+		CHECK(reinterpret_cast<const ParticleSnapshotHeader*>(file.data())->Compression ==
+			(compress ? PARTICLE_SNAPSHOT_COMPRESSION_LZ4 : PARTICLE_SNAPSHOT_COMPRESSION_NONE));
+
+		// Cut anywhere, in the header or the payload
+		for (size_t size : { static_cast<size_t>(0), sizeof(ParticleSnapshotHeader) - 1, sizeof(ParticleSnapshotHeader), file.size() / 2, file.size() - 1 })
+		{
+			WriteFile(path, std::vector<uint8_t>(file.begin(), file.begin() + size));
+			CHECK(!LoadParticleSnapshot(path, loaded.data(), Capacity));
+		}
+
+		// A stored size that disagrees with the file, and an unknown compression
+		std::vector<uint8_t> bad = file;
+		reinterpret_cast<ParticleSnapshotHeader*>(bad.data())->StoredSize += 1;
+		WriteFile(path, bad);
+		CHECK(!LoadParticleSnapshot(path, loaded.data(), Capacity));
+		bad = file;
+		reinterpret_cast<ParticleSnapshotHeader*>(bad.data())->Compression = 7;
+		WriteFile(path, bad);
+		CHECK(!LoadParticleSnapshot(path, loaded.data(), Capacity));
+
+		WriteFile(path, file);
+		CHECK(LoadParticleSnapshot(path, loaded.data(), Capacity));
+		CHECK(loaded == image);
+		std::filesystem::remove(path);
+	}
+	CHECK(!LoadParticleSnapshot(std::filesystem::temp_directory_path() / "ParticleSnapshotTests_missing.bin", loaded.data(), Capacity));
+}
+
+static void TestLZ4()
+{
+	std::mt19937 random(7);
+	const size_t guard = 64;
+	for (int test = 0; test < 300; ++test)
+	{
+		// Random bytes, a small alphabet and repeated phrases with noise in between
+		const size_t size = random() % 5000;
+		std::vector<uint8_t> data(size);
+		for (size_t n = 0; n < size; ++n)
+		{
+			const int mode = test % 3;
+			data[n] = static_cast<uint8_t>(mode == 0 ? random() : mode == 1 ? random() % 4 : n % 37 < 20 ? 'a' + n % 5 : random());
+		}
+
+		std::vector<uint8_t> block(LZ4CompressBound(size));
+		const size_t blockSize = LZ4CompressBlock(data.data(), size, block.data(), block.size());
+		CHECK(blockSize > 0 && blockSize <= block.size());
+		block.resize(blockSize);
+		std::vector<uint8_t> decoded(size);
+		CHECK(LZ4DecompressBlock(block.data(), block.size(), decoded.data(), size));
+		CHECK(decoded == data);
+
+		// A block that doesn't fit isn't written, and the exact size is needed to decode one
+		if (blockSize > 1)
+		{
+			std::vector<uint8_t> small(blockSize - 1);
+			CHECK(LZ4CompressBlock(data.data(), size, small.data(), small.size()) == 0);
+		}
+		std::vector<uint8_t> larger(size + 1);
+		CHECK(!LZ4DecompressBlock(block.data(), block.size(), larger.data(), larger.size()));
+		if (size > 0)
+		{
+			CHECK(!LZ4DecompressBlock(block.data(), block.size(), decoded.data(), size - 1));
+		}
+
+		// Every truncation fails
+		for (size_t cut = 0; cut < blockSize; cut += 1 + blockSize / 16)
+		{
+			CHECK(!LZ4DecompressBlock(block.data(), cut, decoded.data(), size));
+		}
+
+		// Flipped bits may still decode, but never write past the destination
+		for (int flip = 0; flip < 4 && blockSize > 0; ++flip)
+		{
+			std::vector<uint8_t> damaged = block;
+			damaged[random() % blockSize] ^= static_cast<uint8_t>(1 << (random() % 8));
+			std::vector<uint8_t> guarded(size + guard, 0xcd);
+			LZ4DecompressBlock(damaged.data(), damaged.size(), guarded.data(), size);
+			bool intact = true;
+			for (size_t n = size; n < guarded.size(); ++n)
+			{
+				intact &= guarded[n] == 0xcd;
+			}
+			CHECK(intact);
+		}
+	}
+
+	// A match reaching back before the start of the output, and one running past its end
+	uint8_t out[16];
+	const uint8_t beforeStart[] = { 0x10, 'a', 0x02, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a' };
+	CHECK(!LZ4DecompressBlock(beforeStart, sizeof(beforeStart), out, 10));
+	const uint8_t pastEnd[] = { 0x1f, 'a', 0x01, 0x00, 0x40, 0x00 };
+	CHECK(!LZ4DecompressBlock(pastEnd, sizeof(pastEnd), out, sizeof(out)));
+	const uint8_t zeroOffset[] = { 0x10, 'a', 0x00, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a' };
+	CHECK(!LZ4DecompressBlock(zeroOffset, sizeof(zeroOffset), out, 10));
+	const uint8_t valid[] = { 0x10, 'a', 0x01, 0x00, 0x50, 'b', 'c', 'd', 'e', 'f' };
+	CHECK(LZ4DecompressBlock(valid, sizeof(valid), out, 10) && memcmp(out, "aaaaabcdef", 10) == 0);
+}
+
+int main()
+{
+	ThreadPool pool(4);
+	TestRoundTrip(pool);
+	TestDamagedSnapshots();
+	TestLZ4();
+	return CheckResult("ParticleSnapshotTests");
+}
@@ -0,0 +1,137 @@
+// XXH64 against the reference vectors, piecewise hashing, and the pipeline cache file on damaged input
+#include "Check.h"
+#include "PipelineCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+
+static std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& bytes)
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+static void TestVectors()
+{
+	// The reference implementation's XXH64 with seed 0
+	CHECK(HashContent("", 0) == 0xef46db3751d8e999ull);
+	CHECK(HashContent("a", 1) == 0xd24ec4f1a98c6e5bull);
+	CHECK(HashContent("abc", 3) == 0x44bc2cf5ad770999ull);
+	CHECK(ContentHash().AddString("abc").Get() == HashContent("abc", 4));
+	CHECK(HashContent("abc", 3, 1) != HashContent("abc", 3));
+
+	CHECK(GetPipelineName(0x0123456789abcdefull) == L"0123456789abcdef");
+	CHECK(GetPipelineName(0) == L"0000000000000000");
+}
+
+static void TestPiecewise()
+{
+	// Every length through a few stripes, split at every point and in random pieces
+	std::mt19937 random(11);
+	std::vector<uint8_t> data(200);
+	for (uint8_t& byte : data)
+	{
+		byte = static_cast<uint8_t>(random());
+	}
+	for (size_t size = 0; size <= data.size(); ++size)
+	{
+		const uint64_t expected = HashContent(data.data(), size);
+		for (size_t split = 0; split <= size; ++split)
+		{
+			CHECK(ContentHash().Add(data.data(), split).Add(data.data() + split, size - split).Get() == expected);
+		}
+
+		ContentHash pieces;
+		for (size_t offset = 0; offset < size;)
+		{
+			const size_t piece = (std::min)(static_cast<size_t>(random() % 40), size - offset);
+			pieces.Add(data.data() + offset, piece);
+			offset += piece;
+		}
+		CHECK(pieces.Get() == expected);
+
+		// Get doesn't end the hash
+		ContentHash bytewise;
+		for (size_t n = 0; n < size; ++n)
+		{
+			bytewise.Add(&data[n], 1);
+			bytewise.Get();
+		}
+		CHECK(bytewise.Get() == expected);
+	}
+
+	const uint32_t words[2] = { 1, 2 };
+	CHECK(ContentHash().AddValue(words).Get() == HashContent(words, sizeof(words)));
+	CHECK(ContentHash().AddString("ab").AddString("c").Get() != ContentHash().AddString("a").AddString("bc").Get());
+}
+
+static void TestCacheFile()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "PipelineCacheTests.bin";
+	std::vector<uint8_t> library(300);
+	for (size_t n = 0; n < library.size(); ++n)
+	{
+		library[n] = static_cast<uint8_t>(n * 7 + 3);
+	}
+	CHECK(SavePipelineCache(path, library.data(), library.size()));
+	std::vector<uint8_t> loaded;
+	CHECK(LoadPipelineCache(path, loaded));
+	CHECK(loaded == library);
+
+	// The header is little endian whatever the host: magic, version, library size, library hash
+	const std::vector<uint8_t> file = ReadFile(path);
+	CHECK(file.size() == 24 + library.size());
+	const uint8_t header[16] = { 'P', 'S', 'O', 'L', 1, 0, 0, 0, 44, 1, 0, 0, 0, 0, 0, 0 };
+	CHECK(memcmp(file.data(), header, sizeof(header)) == 0);
+	uint64_t hash = 0;
+	for (uint32_t n = 0; n < 8; ++n)
+	{
+		hash |= static_cast<uint64_t>(file[16 + n]) << (n * 8);
+	}
+	CHECK(hash == HashContent(library.data(), library.size()));
+
+	// Any flipped byte, header or library, is caught
+	bool rejected = true;
+	for (size_t n = 0; n < file.size(); ++n)
+	{
+		std::vector<uint8_t> damaged = file;
+		damaged[n] ^= 0x20;
+		WriteFile(path, damaged);
+		rejected &= !LoadPipelineCache(path, loaded) && loaded.empty();
+	}
+	CHECK(rejected);
+
+	// So is any truncation and a longer file
+	rejected = true;
+	for (size_t size = 0; size < file.size(); ++size)
+	{
+		WriteFile(path, std::vector<uint8_t>(file.begin(), file.begin() + size));
+		rejected &= !LoadPipelineCache(path, loaded) && loaded.empty();
+	}
+	CHECK(rejected);
+	std::vector<uint8_t> longer = file;
+	longer.push_back(0);
+	WriteFile(path, longer);
+	CHECK(!LoadPipelineCache(path, loaded));
+
+	// An empty library round trips, a missing file doesn't load
+	CHECK(SavePipelineCache(path, library.data(), 0));
+	CHECK(LoadPipelineCache(path, loaded) && loaded.empty());
+	std::filesystem::remove(path);
+	CHECK(!LoadPipelineCache(path, loaded));
+}
+
+int main()
+{
+	TestVectors();
+	TestPiecewise();
+	TestCacheFile();
+	return CheckResult("PipelineCacheTests");
+}
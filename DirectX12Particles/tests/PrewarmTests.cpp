@@ -0,0 +1,123 @@
+// Pre-warm reaches the steady state a running emitter settles into: its alive count, its spread of ages, and staying there once stepped
+#include "Check.h"
+#include "ParticleSystemCPU.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+static const uint Capacity = 5000;
+static const float FrameTime = 1.0f / 60.0f;
+static const float Lifetime = 2.0f;
+
+static EmitterConstants Emitter(uint emitCount)
+{
+	EmitterConstants emitter = {};
+	emitter.deltaTime = FrameTime;
+	emitter.particleLifetime = Lifetime;
+	emitter.emitCount = emitCount;
+	emitter.maxParticleCount = Capacity;
+	emitter.emitAABBMin = float4(-1, 0, -1, 0);
+	emitter.emitAABBMax = float4(1, 1, 1, 0);
+	emitter.emitVelocityMin = float4(-0.5f, 1, -0.5f, 0);
+	emitter.emitVelocityMax = float4(0.5f, 2, 0.5f, 0);
+	emitter.particleStartScale = 0.3f;
+	emitter.particleEndScale = 0.1f;
+	emitter.curveSet = CURVE_SET_NONE;
+	return emitter;
+}
+
+static void Prewarm(ParticleSystemCPU& system, const EmitterConstants& emitter, float seconds, float stepTime)
+{
+	system.Prewarm(emitter, seconds, stepTime, FrameTime, {}, {}, {}, {});
+}
+
+static void Step(ParticleSystemCPU& system, const EmitterConstants& emitter)
+{
+	system.Update(emitter, {}, {}, {}, {}, {}, {}, {}, TRAIL_HEAD_NONE, {}, false);
+}
+
+// Fraction of the alive particles in each tenth of the lifetime, by time left
+static std::vector<float> AgeHistogram(const ParticleSystemCPU& system)
+{
+	std::vector<float> bins(10, 0.0f);
+	for (uint index : system.GetDrawIndices())
+	{
+		const float left = system.GetParticles()[index].lifeTimeLeft;
+		bins[(std::min)(static_cast<uint>(left / Lifetime * 10.0f), 9u)] += 1.0f / system.GetAliveCount();
+	}
+	return bins;
+}
+
+static void TestSteadyCount()
+{
+	// A lifetime of pre-warm holds emitCount per frame times a lifetime of frames, whether the steps are
+	// a frame, many frames or a fractional number of frames long. Fractional frames carry over in floats, the last one can round away.
+	ThreadPool pool(2);
+	const uint emitCounts[] = { 10, 7, 7, 10 };
+	const float stepTimes[] = { 0.1f, 0.025f, FrameTime, 0.04f };
+	for (uint n = 0; n < 4; ++n)
+	{
+		ParticleSystemCPU system(Capacity, pool);
+		Prewarm(system, Emitter(emitCounts[n]), Lifetime, stepTimes[n]);
+		CHECK(std::abs(static_cast<int>(system.GetAliveCount()) - static_cast<int>(emitCounts[n] * 120)) <= 1);
+	}
+
+	// Less than a lifetime holds only what was emitted so far, a small pool fills up
+	ParticleSystemCPU partial(Capacity, pool);
+	Prewarm(partial, Emitter(10), 1.0f, 0.1f);
+	CHECK(partial.GetAliveCount() == 600);
+	ParticleSystemCPU small(500, pool);
+	Prewarm(small, Emitter(10), Lifetime, 0.1f);
+	CHECK(small.GetAliveCount() == 500);
+
+	// Pre-warming for several lifetimes ends up in the same place as one
+	ParticleSystemCPU longer(Capacity, pool);
+	Prewarm(longer, Emitter(10), 3.0f * Lifetime, 0.1f);
+	CHECK(longer.GetAliveCount() >= 1190 && longer.GetAliveCount() <= 1200);
+}
+
+static void TestMatchesRunning()
+{
+	// Against an emitter stepped frame by frame for a lifetime, the pre-warmed pool has the same count and the same even spread of ages
+	ThreadPool pool(3);
+	const EmitterConstants emitter = Emitter(10);
+	ParticleSystemCPU running(Capacity, pool);
+	for (uint frame = 0; frame < 120; ++frame)
+	{
+		Step(running, emitter);
+	}
+	ParticleSystemCPU prewarmed(Capacity, pool);
+	Prewarm(prewarmed, emitter, Lifetime, 0.1f);
+
+	// Update builds the draw list the histogram walks, a frame with nothing emitted leaves the ages as they were
+	Step(prewarmed, Emitter(0));
+	Step(running, Emitter(0));
+	CHECK(std::abs(static_cast<int>(prewarmed.GetAliveCount()) - static_cast<int>(running.GetAliveCount())) <= 20);
+	const std::vector<float> prewarmedBins = AgeHistogram(prewarmed);
+	const std::vector<float> runningBins = AgeHistogram(running);
+	bool even = true;
+	for (uint bin = 0; bin < 10; ++bin)
+	{
+		even &= prewarmedBins[bin] > 0.08f && prewarmedBins[bin] < 0.12f;
+		even &= runningBins[bin] > 0.08f && runningBins[bin] < 0.12f;
+	}
+	CHECK(even);
+
+	// Running on from the pre-warm, the count stays within a frame's emission of where it started
+	uint lowest = Capacity;
+	uint highest = 0;
+	for (uint frame = 0; frame < 240; ++frame)
+	{
+		Step(prewarmed, emitter);
+		lowest = (std::min)(lowest, prewarmed.GetAliveCount());
+		highest = (std::max)(highest, prewarmed.GetAliveCount());
+	}
+	CHECK(lowest >= 1180 && highest <= 1200);
+}
+
+int main()
+{
+	TestSteadyCount();
+	TestMatchesRunning();
+	return CheckResult("PrewarmTests");
+}
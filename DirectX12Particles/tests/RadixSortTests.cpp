@@ -0,0 +1,147 @@
+// The CPU radix sort against std::stable_sort, and the back to front order of the depth keys and the CPU draw list
+#include "Check.h"
+#include "ParticleSystemCPU.h"
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <random>
+
+// keys and values sorted by a comparison sort that keeps equal keys in input order, what the radix sort has to match
+static void ReferenceSort(std::vector<uint>& keys, std::vector<uint>& values)
+{
+	std::vector<size_t> order(keys.size());
+	for (size_t n = 0; n < order.size(); ++n)
+	{
+		order[n] = n;
+	}
+	std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+	std::vector<uint> sortedKeys(keys.size());
+	std::vector<uint> sortedValues(values.size());
+	for (size_t n = 0; n < order.size(); ++n)
+	{
+		sortedKeys[n] = keys[order[n]];
+		sortedValues[n] = values[order[n]];
+	}
+	keys.swap(sortedKeys);
+	values.swap(sortedValues);
+}
+
+static void TestAgainstStableSort()
+{
+	std::mt19937 random(5);
+	for (uint32_t threadCount : { 1u, 3u, 8u })
+	{
+		ThreadPool pool(threadCount);
+		for (size_t count : { 0, 1, 2, 255, RADIX_TILE_SIZE, RADIX_TILE_SIZE + 1, 100003 })
+		{
+			// Full range keys, then few distinct ones in every byte so stability shows in every pass
+			for (uint mask : { 0xffffffffu, 0x03030303u })
+			{
+				std::vector<uint> keys(count);
+				std::vector<uint> values(count);
+				for (size_t n = 0; n < count; ++n)
+				{
+					keys[n] = static_cast<uint>(random()) & mask;
+					values[n] = static_cast<uint>(n);
+				}
+				std::vector<uint> expectedKeys = keys;
+				std::vector<uint> expectedValues = values;
+				ReferenceSort(expectedKeys, expectedValues);
+				RadixSortPairs(keys, values, pool);
+				CHECK(keys == expectedKeys);
+				CHECK(values == expectedValues);
+			}
+		}
+	}
+}
+
+static void TestDepthKeys()
+{
+	// Every key orders its depth back to front: deeper is smaller, across signs. -0 sorts in front of +0, like the bits order them.
+	const float depths[] = { -1e30f, -250.0f, -1.0f, -1e-30f, -0.0f, 0.0f, 1e-30f, 0.5f, 1.0f, 1.0000001f, 3.5f, 250.0f, 1e30f };
+	for (size_t n = 1; n < sizeof(depths) / sizeof(depths[0]); ++n)
+	{
+		CHECK(DepthSortKey(depths[n]) < DepthSortKey(depths[n - 1]));
+	}
+
+	// Sorting by key draws the particles furthest first
+	ThreadPool pool(4);
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> distribution(-50.0f, 200.0f);
+	std::vector<float> viewDepths(5000);
+	std::vector<uint> keys(viewDepths.size());
+	std::vector<uint> values(viewDepths.size());
+	for (size_t n = 0; n < viewDepths.size(); ++n)
+	{
+		viewDepths[n] = distribution(random);
+		keys[n] = DepthSortKey(viewDepths[n]);
+		values[n] = static_cast<uint>(n);
+	}
+	RadixSortPairs(keys, values, pool);
+	bool backToFront = true;
+	for (size_t n = 1; n < values.size(); ++n)
+	{
+		backToFront &= viewDepths[values[n - 1]] >= viewDepths[values[n]];
+	}
+	CHECK(backToFront);
+}
+
+static void TestDrawList()
+{
+	// The CPU backend's draw list: every live particle in front of the one culling plane, back to front along the depth axis
+	ThreadPool pool(4);
+	const uint capacity = 4000;
+	ParticleSystemCPU system(capacity, pool);
+	EmitterConstants emitter = {};
+	emitter.deltaTime = 1.0f / 60.0f;
+	emitter.particleLifetime = 1.5f;
+	emitter.emitCount = 40;
+	emitter.maxParticleCount = capacity;
+	emitter.emitAABBMin = float4(-4, -4, -4, 0);
+	emitter.emitAABBMax = float4(4, 4, 4, 0);
+	emitter.emitVelocityMin = float4(-1, -1, -1, 0);
+	emitter.emitVelocityMax = float4(1, 1, 1, 0);
+	emitter.particleStartScale = 0.2f;
+	emitter.particleEndScale = 0.05f;
+	emitter.curveSet = CURVE_SET_NONE;
+
+	// All planes but the first are zero and pass everything
+	CullConstants cull = {};
+	cull.FrustumPlanes[0] = float4(1, 0, 0, -0.5f);
+	cull.ViewDepthAxis = float4(0.3f, 0.1f, 0.9f, 0);
+	for (int step = 0; step < 120; ++step)
+	{
+		system.Update(emitter, cull, {}, {}, {}, {}, {}, {}, TRAIL_HEAD_NONE, {}, true);
+	}
+
+	const std::vector<Particle>& particles = system.GetParticles();
+	const std::vector<uint>& drawIndices = system.GetDrawIndices();
+	std::vector<uint> expected;
+	for (uint n = 0; n < capacity; ++n)
+	{
+		const Particle& particle = particles[n];
+		if (particle.lifeTimeLeft > 0 && particle.position.x - 0.5f >= -particle.scale * CULL_BILLBOARD_RADIUS)
+		{
+			expected.push_back(n);
+		}
+	}
+	std::vector<uint> drawn = drawIndices;
+	std::sort(drawn.begin(), drawn.end());
+	CHECK(!expected.empty() && expected.size() < system.GetAliveCount());
+	CHECK(drawn == expected);
+
+	bool backToFront = true;
+	for (size_t n = 1; n < drawIndices.size(); ++n)
+	{
+		backToFront &= dot(particles[drawIndices[n - 1]].position, cull.ViewDepthAxis) >= dot(particles[drawIndices[n]].position, cull.ViewDepthAxis);
+	}
+	CHECK(backToFront);
+}
+
+int main()
+{
+	TestAgainstStableSort();
+	TestDepthKeys();
+	TestDrawList();
+	return CheckResult("RadixSortTests");
+}
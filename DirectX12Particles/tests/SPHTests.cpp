@@ -0,0 +1,199 @@
+// SPH kernels, the density of a uniform lattice against its mass per volume, and the fluid step's forces on a lattice at rest
+#include "Check.h"
+#include "ParticleSystemCPU.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static const uint Side = 12;
+static const float Spacing = 0.1f;
+static const float SmoothingRadius = 0.25f;
+
+static uint LatticeIndex(uint x, uint y, uint z)
+{
+	return (z * Side + y) * Side + x;
+}
+
+static std::vector<Particle> Lattice()
+{
+	std::vector<Particle> particles(Side * Side * Side);
+	for (uint z = 0; z < Side; ++z)
+	{
+		for (uint y = 0; y < Side; ++y)
+		{
+			for (uint x = 0; x < Side; ++x)
+			{
+				Particle& particle = particles[LatticeIndex(x, y, z)];
+				particle.position = float4(x * Spacing, y * Spacing, z * Spacing, 1.0f);
+				particle.color = float4(1, 1, 1, 1);
+				particle.lifeTimeLeft = 10.0f;
+				particle.scale = 0.05f;
+			}
+		}
+	}
+	return particles;
+}
+
+// Water, one particle per lattice cell carries the cell's mass
+static SPHConstants Fluid()
+{
+	SPHConstants fluid = {};
+	fluid.SmoothingRadius = SmoothingRadius;
+	fluid.ParticleMass = 1000.0f * Spacing * Spacing * Spacing;
+	fluid.RestDensity = 1000.0f;
+	fluid.Stiffness = 3.0f;
+	fluid.MaxAcceleration = 1e6f;
+	fluid.Enabled = 1;
+	return fluid;
+}
+
+static void TestTableSize()
+{
+	CHECK(GetSpatialHashTableSize(1) == SPATIAL_HASH_SCAN_BLOCK);
+	CHECK(GetSpatialHashTableSize(10000) == 32768);
+	CHECK(GetSpatialHashTableSize(250000) == SPATIAL_HASH_MAX_TABLE_SIZE);
+	CHECK(GetSpatialHashTableSize(1000000) == SPATIAL_HASH_MAX_TABLE_SIZE);
+}
+
+static void TestKernels()
+{
+	// Poly6 integrates to one over its support
+	const float h = SmoothingRadius;
+	const uint steps = 4000;
+	double integral = 0.0;
+	for (uint n = 0; n < steps; ++n)
+	{
+		const double r = (n + 0.5) * h / steps;
+		integral += 4.0 * 3.14159265358979 * r * r * SPHPoly6(static_cast<float>(r * r), h) * h / steps;
+	}
+	CHECK_NEAR(integral, 1.0, 1e-4);
+
+	CHECK(SPHPoly6(h * h, h) == 0.0f && SPHSpikyGradient(h, h) == 0.0f && SPHViscosityLaplacian(h, h) == 0.0f);
+	CHECK(SPHSpikyGradient(0.5f * h, h) < 0.0f && SPHViscosityLaplacian(0.5f * h, h) > 0.0f);
+
+	const SPHConstants fluid = Fluid();
+	CHECK(SPHPressure(900.0f, fluid) == 0.0f);
+	CHECK_NEAR(SPHPressure(1100.0f, fluid), 300.0f, 1e-3f);
+	CHECK(SPHForceTerm(float3(0, 0, 0), float3(1, 0, 0), float2(1000, 10), float2(1000, 10), fluid).x == 0.0f);
+
+	// Pressure pushes i away from j, viscosity drags i along j's velocity
+	const float3 push = SPHForceTerm(float3(0.1f, 0, 0), float3(0, 0, 0), float2(1000, 10), float2(1000, 10), fluid);
+	CHECK(push.x > 0.0f && push.y == 0.0f && push.z == 0.0f);
+	SPHConstants viscous = fluid;
+	viscous.Viscosity = 1.0f;
+	const float3 drag = SPHForceTerm(float3(0.1f, 0, 0), float3(0, 1, 0), float2(1000, 0), float2(1000, 0), viscous);
+	CHECK(drag.x == 0.0f && drag.y > 0.0f);
+
+	const float3 clamped = SPHAcceleration(float3(3e6f, 4e6f, 0), 1000.0f, { h, 1, 1000, 1, 0, 50.0f, 1, 0 });
+	CHECK_NEAR(length(clamped), 50.0f, 1e-3f);
+}
+
+static void TestLatticeDensity()
+{
+	// Summed over the hash neighbors like the density pass, a particle deep inside the lattice sees the mass per volume
+	const std::vector<Particle> particles = Lattice();
+	std::vector<uint> all(particles.size());
+	for (uint n = 0; n < all.size(); ++n)
+	{
+		all[n] = n;
+	}
+	ThreadPool pool(2);
+	SpatialHashCPU hash(pool);
+	hash.Build(particles, all, { SmoothingRadius, GetSpatialHashTableSize(static_cast<uint>(particles.size())), static_cast<uint>(particles.size()), 0 });
+
+	const SPHConstants fluid = Fluid();
+	auto density = [&](uint index)
+	{
+		const float3 center(particles[index].position.x, particles[index].position.y, particles[index].position.z);
+		float sum = 0.0f;
+		hash.ForEachNeighbor(center, [&](uint neighbor)
+		{
+			sum += SPHDensityTerm(center - float3(particles[neighbor].position.x, particles[neighbor].position.y, particles[neighbor].position.z), fluid);
+		});
+		return sum;
+	};
+
+	const float inside = density(LatticeIndex(5, 6, 5));
+	CHECK_NEAR(inside, fluid.RestDensity, 0.03f * fluid.RestDensity);
+	CHECK_NEAR(density(LatticeIndex(3, 3, 8)), inside, 1e-3f * inside);
+
+	// A face particle keeps half its neighborhood plus the layer it sits in, a corner particle an eighth plus its edges and faces
+	const float face = density(LatticeIndex(0, 6, 5));
+	const float corner = density(LatticeIndex(0, 0, Side - 1));
+	CHECK(face > 0.5f * inside && face < 0.8f * inside);
+	CHECK(corner > 0.125f * inside && corner < face);
+}
+
+static void TestLatticeForces()
+{
+	// A lattice at rest, squeezed past the rest density so every particle has pressure. Symmetry cancels the forces deep inside,
+	// at the surface the pressure pushes outwards.
+	const std::vector<Particle> lattice = Lattice();
+	const uint capacity = static_cast<uint>(lattice.size());
+	std::vector<uint> alive(capacity);
+	for (uint n = 0; n < capacity; ++n)
+	{
+		alive[n] = n;
+	}
+	std::vector<uint8_t> image(GetParticleSnapshotLayout(capacity).Size);
+	WriteParticleSnapshotImage(image.data(), capacity, lattice.data(), alive.data(), capacity, nullptr, 0);
+	ParticleSnapshotView view;
+	CHECK(ParseParticleSnapshot(image.data(), image.size(), view));
+
+	EmitterConstants emitter = {};
+	emitter.deltaTime = 1.0f / 240.0f;
+	emitter.particleLifetime = 10.0f;
+	emitter.maxParticleCount = capacity;
+	emitter.particleStartScale = 0.05f;
+	emitter.particleEndScale = 0.05f;
+	emitter.curveSet = CURVE_SET_NONE;
+	SPHConstants fluid = Fluid();
+	fluid.RestDensity = 500.0f;
+	const SpatialHashConstants hash = { SmoothingRadius, GetSpatialHashTableSize(capacity), capacity, 0 };
+
+	ThreadPool pool(3);
+	ParticleSystemCPU system(capacity, pool);
+	CHECK(system.RestoreSnapshot(view));
+	system.Update(emitter, {}, fluid, hash, {}, {}, {}, {}, TRAIL_HEAD_NONE, {}, false);
+	CHECK(system.GetAliveCount() == capacity);
+
+	// Four layers in, the particle and every neighbor of it has a full neighborhood
+	const float middle = (Side - 1) * Spacing * 0.5f;
+	float coreSpeed = 0.0f;
+	float surfaceSpeed = 1e30f;
+	bool outwards = true;
+	for (uint z = 0; z < Side; ++z)
+	{
+		for (uint y = 0; y < Side; ++y)
+		{
+			for (uint x = 0; x < Side; ++x)
+			{
+				const Particle& particle = system.GetParticles()[LatticeIndex(x, y, z)];
+				const float3 velocity(particle.velocity.x, particle.velocity.y, particle.velocity.z);
+				const float3 offset = float3(x * Spacing, y * Spacing, z * Spacing) - float3(middle, middle, middle);
+				if (x >= 4 && x < Side - 4 && y >= 4 && y < Side - 4 && z >= 4 && z < Side - 4)
+				{
+					coreSpeed = (std::max)(coreSpeed, length(velocity));
+				}
+				else if (x == 0 || y == 0 || z == 0 || x == Side - 1 || y == Side - 1 || z == Side - 1)
+				{
+					surfaceSpeed = (std::min)(surfaceSpeed, length(velocity));
+					outwards &= dot(velocity, offset) > 0.0f;
+				}
+			}
+		}
+	}
+	CHECK(surfaceSpeed > 0.0f);
+	CHECK(coreSpeed < 1e-3f * surfaceSpeed);
+	CHECK(outwards);
+}
+
+int main()
+{
+	TestTableSize();
+	TestKernels();
+	TestLatticeDensity();
+	TestLatticeForces();
+	return CheckResult("SPHTests");
+}
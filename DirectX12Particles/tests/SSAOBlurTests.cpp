@@ -0,0 +1,142 @@
+// The bilateral blur against its analytic kernel on flat depth, and its edge stopping across depth steps
+#include "Check.h"
+#include "SSAOBlur.h"
+
+#include "../ParticleGame/SSAOBlur.hlsli"
+
+static const int Width = 48;
+static const int Height = 32;
+static const float NearPlane = 0.1f;
+static const float FarPlane = 100.0f;
+
+static void TestLinearizeDepth()
+{
+	CHECK_NEAR(LinearizeDepth(0.0f, NearPlane, FarPlane), NearPlane, 1e-6);
+	CHECK_NEAR(LinearizeDepth(1.0f, NearPlane, FarPlane), FarPlane, 1e-2);
+
+	// The inverse of a D3D perspective projection's depth
+	const float viewDepth = 7.5f;
+	const float z = FarPlane / (FarPlane - NearPlane) * (1.0f - NearPlane / viewDepth);
+	CHECK_NEAR(LinearizeDepth(z, NearPlane, FarPlane), viewDepth, 1e-4 * viewDepth);
+}
+
+static void TestFlatDepthKernel()
+{
+	// On flat depth the blur is the separable Gaussian, an impulse away from the edges comes out as the product of the
+	// normalized 1D weights
+	const std::vector<float> depth(Width * Height, 0.9f);
+	std::vector<float> ao(Width * Height, 0.0f);
+	const int centerX = 20;
+	const int centerY = 15;
+	ao[centerY * Width + centerX] = 1.0f;
+	const std::vector<float> blurred = BlurAmbientOcclusion(ao, depth, Width, Height, NearPlane, FarPlane, 10.0f);
+
+	float weightSum = 0.0f;
+	for (int offset = -SSAO_BLUR_RADIUS; offset <= SSAO_BLUR_RADIUS; ++offset)
+	{
+		weightSum += SSAOBlurWeight(offset, 0.0f, 0.0f, 1.0f);
+	}
+	float total = 0.0f;
+	bool outsideZero = true;
+	for (int y = 0; y < Height; ++y)
+	{
+		for (int x = 0; x < Width; ++x)
+		{
+			const int dx = x - centerX;
+			const int dy = y - centerY;
+			const float value = blurred[y * Width + x];
+			total += value;
+			if (abs(dx) > SSAO_BLUR_RADIUS || abs(dy) > SSAO_BLUR_RADIUS)
+			{
+				outsideZero &= value == 0.0f;
+				continue;
+			}
+			const float expected = SSAOBlurWeight(dx, 0.0f, 0.0f, 1.0f) * SSAOBlurWeight(dy, 0.0f, 0.0f, 1.0f) / (weightSum * weightSum);
+			CHECK_NEAR(value, expected, 1e-6);
+		}
+	}
+	CHECK(outsideZero);
+	CHECK_NEAR(total, 1.0, 1e-5);
+	CHECK_NEAR(SSAOBlurWeight(0, 0.0f, 0.0f, 1.0f), 1.0, 0.0);
+}
+
+static void TestConstantAndMirror()
+{
+	// Constant occlusion stays constant whatever the depth, the weights are normalized per pixel
+	std::vector<float> depth(Width * Height);
+	for (int y = 0; y < Height; ++y)
+	{
+		for (int x = 0; x < Width; ++x)
+		{
+			depth[y * Width + x] = 0.5f + 0.49f * ((x * 7 + y * 13) % 17) / 17.0f;
+		}
+	}
+	const std::vector<float> constant = BlurAmbientOcclusion(std::vector<float>(Width * Height, 0.625f), depth, Width, Height, NearPlane, FarPlane, 4.0f);
+	float error = 0.0f;
+	for (float value : constant)
+	{
+		error = (std::max)(error, std::fabs(value - 0.625f));
+	}
+	CHECK(error <= 1e-6f);
+
+	// Mirroring the input mirrors the output, the taps clamp at the edges the same on both sides
+	std::vector<float> ao(Width * Height);
+	for (int n = 0; n < Width * Height; ++n)
+	{
+		ao[n] = static_cast<float>((n * 37) % 101) / 100.0f;
+	}
+	std::vector<float> mirroredAO(Width * Height);
+	std::vector<float> mirroredDepth(Width * Height);
+	for (int y = 0; y < Height; ++y)
+	{
+		for (int x = 0; x < Width; ++x)
+		{
+			mirroredAO[y * Width + x] = ao[y * Width + Width - 1 - x];
+			mirroredDepth[y * Width + x] = depth[y * Width + Width - 1 - x];
+		}
+	}
+	const std::vector<float> blurred = BlurAmbientOcclusion(ao, depth, Width, Height, NearPlane, FarPlane, 4.0f);
+	const std::vector<float> mirrored = BlurAmbientOcclusion(mirroredAO, mirroredDepth, Width, Height, NearPlane, FarPlane, 4.0f);
+	error = 0.0f;
+	for (int y = 0; y < Height; ++y)
+	{
+		for (int x = 0; x < Width; ++x)
+		{
+			error = (std::max)(error, std::fabs(blurred[y * Width + x] - mirrored[y * Width + Width - 1 - x]));
+		}
+	}
+	CHECK(error <= 1e-6f);
+}
+
+static void TestDepthEdge()
+{
+	// A near wall on the left, occluded, against a far background on the right, open. The step stops the blur on both
+	// sides, while the same step at zero sharpness bleeds across.
+	std::vector<float> depth(Width * Height);
+	std::vector<float> ao(Width * Height);
+	const int edge = Width / 2;
+	for (int y = 0; y < Height; ++y)
+	{
+		for (int x = 0; x < Width; ++x)
+		{
+			depth[y * Width + x] = x < edge ? 0.9f : 0.999f;
+			ao[y * Width + x] = x < edge ? 0.0f : 1.0f;
+		}
+	}
+	const std::vector<float> sharp = BlurAmbientOcclusion(ao, depth, Width, Height, NearPlane, FarPlane, 16.0f);
+	const std::vector<float> soft = BlurAmbientOcclusion(ao, depth, Width, Height, NearPlane, FarPlane, 0.0f);
+	const int y = Height / 2;
+	CHECK(sharp[y * Width + edge - 1] < 1e-3f);
+	CHECK(sharp[y * Width + edge] > 1.0f - 1e-3f);
+	CHECK(soft[y * Width + edge - 1] > 0.2f && soft[y * Width + edge - 1] < 0.5f);
+	CHECK(soft[y * Width + edge] > 0.5f && soft[y * Width + edge] < 0.8f);
+}
+
+int main()
+{
+	TestLinearizeDepth();
+	TestFlatDepthKernel();
+	TestConstantAndMirror();
+	TestDepthEdge();
+	return CheckResult("SSAOBlurTests");
+}
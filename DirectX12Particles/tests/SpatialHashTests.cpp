@@ -0,0 +1,153 @@
+// Spatial hash build against the scalar key of every particle, and neighbor queries against a brute force radius search
+#include "Check.h"
+#include "SpatialHash.h"
+
+#include <algorithm>
+#include <random>
+
+static std::vector<Particle> RandomParticles(uint count, float extent, uint seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> coordinate(-extent, extent);
+	std::vector<Particle> particles(count);
+	for (Particle& particle : particles)
+	{
+		particle.position = float4(coordinate(random), coordinate(random), coordinate(random), 1.0f);
+	}
+	return particles;
+}
+
+static uint Key(const Particle& particle, const SpatialHashConstants& constants)
+{
+	return SpatialHashKey(SpatialHashCell(float3(particle.position.x, particle.position.y, particle.position.z), constants.CellSize), constants.TableSize);
+}
+
+// The sorted indices are the given ones ordered by bucket, keyed like the shaders key them
+static bool SortedByKey(const SpatialHashCPU& hash, const std::vector<Particle>& particles, std::vector<uint> particleIndices)
+{
+	const std::vector<uint>& sorted = hash.GetSortedIndices();
+	bool ordered = sorted.size() == particleIndices.size();
+	for (size_t n = 1; ordered && n < sorted.size(); ++n)
+	{
+		ordered = Key(particles[sorted[n - 1]], hash.GetConstants()) <= Key(particles[sorted[n]], hash.GetConstants());
+	}
+	std::vector<uint> permutation = sorted;
+	std::sort(permutation.begin(), permutation.end());
+	std::sort(particleIndices.begin(), particleIndices.end());
+	return ordered && permutation == particleIndices;
+}
+
+static void TestBuild()
+{
+	// Positions on and around cell boundaries on both sides of zero, where the SSE floor has to round down
+	std::vector<Particle> particles;
+	for (float x : { -2.0f, -1.0f, -0.5f, -0.0f, 0.0f, 0.5f, 1.0f, 1.5f, -1e-7f, 0.9999999f })
+	{
+		for (float y : { -1.0f, 0.25f, 3.0f })
+		{
+			Particle particle = {};
+			particle.position = float4(x, y, -x, 1.0f);
+			particles.push_back(particle);
+		}
+	}
+	std::vector<uint> all(particles.size());
+	for (uint n = 0; n < all.size(); ++n)
+	{
+		all[n] = n;
+	}
+	ThreadPool pool(3);
+	SpatialHashCPU hash(pool);
+	hash.Build(particles, all, { 1.0f, SPATIAL_HASH_SCAN_BLOCK, static_cast<uint>(particles.size()), 0 });
+	CHECK(SortedByKey(hash, particles, all));
+
+	// Many particles per bucket, then a bigger table and a subset of live particles on the same object
+	particles = RandomParticles(20000, 50.0f, 7);
+	all.resize(particles.size());
+	for (uint n = 0; n < all.size(); ++n)
+	{
+		all[n] = n;
+	}
+	hash.Build(particles, all, { 0.5f, SPATIAL_HASH_SCAN_BLOCK, static_cast<uint>(particles.size()), 0 });
+	CHECK(SortedByKey(hash, particles, all));
+
+	std::vector<uint> live;
+	for (uint n = 0; n < particles.size(); n += 3)
+	{
+		live.push_back(n);
+	}
+	std::reverse(live.begin(), live.end());
+	hash.Build(particles, live, { 2.0f, GetSpatialHashTableSize(static_cast<uint>(live.size())), static_cast<uint>(particles.size()), 0 });
+	CHECK(SortedByKey(hash, particles, live));
+
+	hash.Build(particles, {}, { 2.0f, SPATIAL_HASH_SCAN_BLOCK, 0, 0 });
+	CHECK(hash.GetSortedIndices().empty());
+}
+
+static void TestNeighbors()
+{
+	const float radius = 1.5f;
+	const std::vector<Particle> particles = RandomParticles(8000, 12.0f, 11);
+	std::vector<uint> all(particles.size());
+	for (uint n = 0; n < all.size(); ++n)
+	{
+		all[n] = n;
+	}
+
+	std::mt19937 random(13);
+	std::uniform_real_distribution<float> coordinate(-13.0f, 13.0f);
+	for (uint threadCount : { 1u, 4u })
+	{
+		ThreadPool pool(threadCount);
+		SpatialHashCPU hash(pool);
+		hash.Build(particles, all, { radius, GetSpatialHashTableSize(static_cast<uint>(particles.size())), static_cast<uint>(particles.size()), 0 });
+
+		bool matches = true;
+		uint found = 0;
+		for (uint query = 0; query < 300; ++query)
+		{
+			// Half the queries sit on a particle, half anywhere
+			const float3 position = query % 2 ? float3(particles[query].position.x, particles[query].position.y, particles[query].position.z)
+				: float3(coordinate(random), coordinate(random), coordinate(random));
+			std::vector<uint> expected;
+			for (uint n = 0; n < particles.size(); ++n)
+			{
+				const float3 offset = float3(particles[n].position.x, particles[n].position.y, particles[n].position.z) - position;
+				if (dot(offset, offset) <= radius * radius)
+				{
+					expected.push_back(n);
+				}
+			}
+
+			// Buckets of colliding neighbor cells come back more than once, so compare the distinct indices
+			std::vector<uint> visited;
+			hash.ForEachNeighbor(position, [&](uint index)
+			{
+				const float3 offset = float3(particles[index].position.x, particles[index].position.y, particles[index].position.z) - position;
+				if (dot(offset, offset) <= radius * radius)
+				{
+					visited.push_back(index);
+				}
+			});
+			std::sort(visited.begin(), visited.end());
+			visited.erase(std::unique(visited.begin(), visited.end()), visited.end());
+			matches &= visited == expected;
+			found += static_cast<uint>(expected.size());
+		}
+		CHECK(matches);
+		CHECK(found > 300);
+
+		// The slot walk visits the same particles through the sorted order
+		std::vector<uint> byIndex;
+		std::vector<uint> bySlot;
+		hash.ForEachNeighbor(float3(0, 0, 0), [&](uint index) { byIndex.push_back(index); });
+		hash.ForEachNeighborSlot(float3(0, 0, 0), [&](uint slot) { bySlot.push_back(hash.GetSortedIndices()[slot]); });
+		CHECK(!byIndex.empty() && bySlot == byIndex);
+	}
+}
+
+int main()
+{
+	TestBuild();
+	TestNeighbors();
+	return CheckResult("SpatialHashTests");
+}
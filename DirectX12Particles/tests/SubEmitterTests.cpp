@@ -0,0 +1,237 @@
+// Sub-emitter event appends and spawn mapping, and death and collision bursts through the CPU backend with the generation limit
+#include "Check.h"
+#include "Collision.h"
+#include "ParticleSystemCPU.h"
+
+#include <vector>
+
+static void TestEventBuffer()
+{
+	// Any number of threads appending at once fill exactly the type's slots, the rest are dropped
+	ThreadPool pool(8);
+	SubEmitterEventBuffer events;
+	std::atomic<uint> accepted(0);
+	pool.ParallelFor(100000, [&](size_t begin, size_t end, uint32_t)
+	{
+		uint appended = 0;
+		for (size_t n = begin; n < end; ++n)
+		{
+			SubEmitterEvent event = {};
+			event.Generation = static_cast<uint>(n);
+			appended += events.Append(SUB_EMITTER_EVENT_DEATH, event) ? 1 : 0;
+		}
+		accepted += appended;
+	});
+	CHECK(accepted == SUB_EMITTER_MAX_EVENTS);
+	CHECK(events.GetCounter(SUB_EMITTER_COUNTER_DEATH) == 100000);
+
+	std::vector<bool> seen(100000, false);
+	bool unique = true;
+	for (uint slot = 0; slot < SUB_EMITTER_MAX_EVENTS; ++slot)
+	{
+		const uint generation = events.GetEvent(SubEmitterEventIndex(SUB_EMITTER_EVENT_DEATH, slot)).Generation;
+		unique &= generation < seen.size() && !seen[generation];
+		seen[generation] = true;
+	}
+	CHECK(unique);
+
+	// The args clamp the counters to the slots and the spawns to the dead particles, and zero the append counters
+	SubEmitterEvent event = {};
+	for (int n = 0; n < 5; ++n)
+	{
+		CHECK(events.Append(SUB_EMITTER_EVENT_COLLISION, event));
+	}
+	SubEmitterConstants constants = {};
+	constants.DeathBurst = 3;
+	constants.CollisionBurst = 2;
+	CHECK(events.GenerateArgs(1000000, constants) == SUB_EMITTER_MAX_EVENTS * 3 + 5 * 2);
+	CHECK(events.GetCounter(SUB_EMITTER_COUNTER_DEATH_EVENTS) == SUB_EMITTER_MAX_EVENTS);
+	CHECK(events.GetCounter(SUB_EMITTER_COUNTER_DEATH) == 0 && events.GetCounter(SUB_EMITTER_COUNTER_COLLISION) == 0);
+	CHECK(events.GenerateArgs(1000000, constants) == 0);
+
+	CHECK(events.Append(SUB_EMITTER_EVENT_DEATH, event));
+	CHECK(events.GenerateArgs(2, constants) == 2);
+	CHECK(events.GetCounter(SUB_EMITTER_COUNTER_SPAWNS) == 2);
+
+	CHECK(SubEmitterEventMask(SubEmitterConstants{}) == 0);
+	CHECK(SubEmitterEventMask(constants) == 3);
+}
+
+static void TestLocateChild()
+{
+	// Every child of every event is spawned exactly once, death bursts first
+	SubEmitterConstants constants = {};
+	constants.DeathBurst = 5;
+	constants.CollisionBurst = 3;
+	const uint deathEvents = 7;
+	const uint collisionEvents = 4;
+	std::vector<uint> children(SUB_EMITTER_EVENT_TYPES * SUB_EMITTER_MAX_EVENTS, 0);
+	bool deathFirst = true;
+	for (uint spawnIndex = 0; spawnIndex < deathEvents * 5 + collisionEvents * 3; ++spawnIndex)
+	{
+		const uint2 child = SubEmitterLocateChild(spawnIndex, deathEvents, constants);
+		const bool death = child.x < SUB_EMITTER_MAX_EVENTS;
+		deathFirst &= death == (spawnIndex < deathEvents * 5);
+		CHECK(child.y < (death ? 5u : 3u));
+		children[child.x] |= 1u << child.y;
+	}
+	CHECK(deathFirst);
+	for (uint event = 0; event < deathEvents; ++event)
+	{
+		CHECK(children[SubEmitterEventIndex(SUB_EMITTER_EVENT_DEATH, event)] == 0x1f);
+	}
+	for (uint event = 0; event < collisionEvents; ++event)
+	{
+		CHECK(children[SubEmitterEventIndex(SUB_EMITTER_EVENT_COLLISION, event)] == 0x7);
+	}
+}
+
+static void TestSpawn()
+{
+	// Children are one generation past the event, keep w = 1, and fly at half to full speed around the inherited velocity
+	SubEmitterConstants constants = {};
+	constants.DeathBurst = 24;
+	constants.Speed = 2.0f;
+	constants.InheritVelocity = 0.5f;
+	constants.Seed = 17;
+	EmitterConstants emitter = {};
+	emitter.particleLifetime = 1.5f;
+	emitter.particleStartScale = 0.3f;
+	SubEmitterEvent event = {};
+	event.Position = float3(1, 2, 3);
+	event.Generation = 1;
+	event.Velocity = float3(4, 0, 0);
+	event.Tint = 0x80ff4020;
+	event.Acceleration = float3(0, -9.8f, 0);
+
+	bool inRange = true;
+	float3 mean;
+	for (uint n = 0; n < 2400; ++n)
+	{
+		const Particle child = SpawnSubEmitterParticle(event, n / 24, n % 24, constants, emitter);
+		CHECK(child.generation == 2 && child.position.w == 1.0f && child.velocity.w == 0.0f);
+		CHECK(child.position.x == 1.0f && child.position.y == 2.0f && child.position.z == 3.0f);
+		CHECK(child.tint == event.Tint && child.lifeTimeLeft == 1.5f && child.scale == 0.3f && child.acceleration.y == -9.8f);
+		const float3 spread = float3(child.velocity.x - 2.0f, child.velocity.y, child.velocity.z);
+		inRange &= length(spread) >= 1.0f - 1e-4f && length(spread) <= 2.0f + 1e-4f;
+		mean += spread / 2400.0f;
+	}
+	CHECK(inRange);
+	CHECK(length(mean) < 0.1f);
+
+	Particle particle = {};
+	particle.generation = SUB_EMITTER_MAX_GENERATION;
+	CHECK(SubEmitterRaisesEvents(particle));
+	particle.generation = SUB_EMITTER_MAX_GENERATION + 1;
+	CHECK(!SubEmitterRaisesEvents(particle));
+}
+
+static EmitterConstants Burst(uint capacity, uint emitCount)
+{
+	EmitterConstants emitter = {};
+	emitter.deltaTime = 0.125f;
+	emitter.particleLifetime = 1.0f;
+	emitter.emitCount = emitCount;
+	emitter.maxParticleCount = capacity;
+	emitter.emitAABBMin = float4(-1, 1, -1, 0);
+	emitter.emitAABBMax = float4(1, 1, 1, 0);
+	emitter.particleStartScale = 0.1f;
+	emitter.particleEndScale = 0.1f;
+	emitter.curveSet = CURVE_SET_NONE;
+	return emitter;
+}
+
+static uint CountGeneration(const ParticleSystemCPU& system, uint generation)
+{
+	uint count = 0;
+	for (const Particle& particle : system.GetParticles())
+	{
+		count += particle.lifeTimeLeft > 0 && particle.generation == generation && particle.position.w == 1.0f ? 1 : 0;
+	}
+	return count;
+}
+
+static void TestDeathBursts()
+{
+	// One volley dies on the eighth step and bursts into four children each. The children are past the generation limit,
+	// so their deaths end the effect.
+	ThreadPool pool(4);
+	SubEmitterConstants subEmitter = {};
+	subEmitter.DeathBurst = 4;
+	subEmitter.Speed = 1.0f;
+	ParticleSystemCPU system(1000, pool);
+	ParticleSystemCPU small(120, pool);
+	for (uint step = 0; step < 20; ++step)
+	{
+		subEmitter.Seed = step;
+		system.Update(Burst(1000, step == 0 ? 50 : 0), {}, {}, {}, {}, {}, {}, {}, TRAIL_HEAD_NONE, subEmitter, false);
+		small.Update(Burst(120, step == 0 ? 50 : 0), {}, {}, {}, {}, {}, {}, {}, TRAIL_HEAD_NONE, subEmitter, false);
+		if (step == 6)
+		{
+			CHECK(system.GetAliveCount() == 50 && CountGeneration(system, 1) == 50);
+		}
+		if (step == 7)
+		{
+			CHECK(system.GetAliveCount() == 200 && CountGeneration(system, 2) == 200);
+
+			// Not enough dead particles cuts the bursts short, the volley's own slots are free again by then
+			CHECK(small.GetAliveCount() == 120 && CountGeneration(small, 2) == 120);
+		}
+	}
+	CHECK(system.GetAliveCount() == 0 && small.GetAliveCount() == 0);
+}
+
+static void TestCollisionBursts()
+{
+	// Ten particles fall onto a floor on the third step. Each hit splashes three children where the bounce leaves it, one
+	// radius above the floor, that carry the bounced velocity and don't splash again.
+	ThreadPool pool(4);
+	const std::vector<CollisionPlane> planes = { MakeCollisionPlane(float3(0, 0, 0), float3(1, 0, 0), float2(5, 5), 1.57079633f) };
+	CollisionConstants collision = {};
+	collision.Restitution = 0.5f;
+	collision.RadiusScale = 1.0f;
+	collision.Enabled = 1;
+	const std::vector<uint> grid = BuildCollisionGrid(planes, 1.0f, collision);
+
+	SubEmitterConstants subEmitter = {};
+	subEmitter.CollisionBurst = 3;
+	subEmitter.InheritVelocity = 1.0f;
+	ParticleSystemCPU system(1000, pool);
+	system.SetCollisionScene(planes, grid);
+	for (uint step = 0; step < 6; ++step)
+	{
+		EmitterConstants emitter = Burst(1000, step == 0 ? 10 : 0);
+		emitter.particleLifetime = 2.0f;
+		emitter.emitVelocityMin = float4(0, -3, 0, 0);
+		emitter.emitVelocityMax = float4(0, -3, 0, 0);
+		system.Update(emitter, {}, {}, {}, collision, {}, {}, {}, TRAIL_HEAD_NONE, subEmitter, false);
+		if (step == 1)
+		{
+			CHECK(system.GetAliveCount() == 10);
+		}
+		if (step == 2)
+		{
+			CHECK(system.GetAliveCount() == 40 && CountGeneration(system, 2) == 30);
+			bool splashed = true;
+			for (const Particle& particle : system.GetParticles())
+			{
+				if (particle.lifeTimeLeft > 0 && particle.generation == 2)
+				{
+					splashed &= fabs(particle.position.y - 0.1f) < 1e-5f && fabs(particle.velocity.y - 1.5f) < 1e-5f && particle.lifeTimeLeft == 2.0f;
+				}
+			}
+			CHECK(splashed);
+		}
+	}
+	CHECK(system.GetAliveCount() == 40);
+}
+
+int main()
+{
+	TestEventBuffer();
+	TestLocateChild();
+	TestSpawn();
+	TestDeathBursts();
+	TestCollisionBursts();
+	return CheckResult("SubEmitterTests");
+}
@@ -0,0 +1,180 @@
+// Task graph ordering, exception propagation, the critical path, dependencies that aren't added yet, and tasks sharing a thread pool
+#include "Check.h"
+#include "TaskGraph.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+
+static void Sleep(int milliseconds)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+static void TestOrdering()
+{
+	// A diamond under a wide fan, every task starts after its dependencies ended, whatever the thread count
+	for (uint32_t threadCount : { 1u, 2u, 8u })
+	{
+		TaskGraph graph;
+		std::mutex mutex;
+		std::vector<TaskGraph::Task> finished;
+		auto record = [&](TaskGraph::Task task) { return [&, task]() { std::lock_guard<std::mutex> lock(mutex); finished.push_back(task); }; };
+		std::vector<std::vector<TaskGraph::Task>> dependencies;
+		for (TaskGraph::Task task = 0; task < 40; ++task)
+		{
+			std::vector<TaskGraph::Task> depends;
+			if (task > 0)
+			{
+				depends.push_back(task < 3 ? 0 : task == 3 ? 1 : (task * 7) % task);
+			}
+			if (task == 3)
+			{
+				depends.push_back(2);
+				depends.push_back(2);
+			}
+			dependencies.push_back(depends);
+			CHECK(graph.Add("Task" + std::to_string(task), record(task), depends) == task);
+		}
+		graph.Run(threadCount);
+
+		CHECK(finished.size() == 40);
+		std::vector<size_t> position(40);
+		for (size_t n = 0; n < finished.size(); ++n)
+		{
+			position[finished[n]] = n;
+		}
+		bool ordered = true;
+		for (TaskGraph::Task task = 0; task < 40; ++task)
+		{
+			for (TaskGraph::Task dependency : dependencies[task])
+			{
+				ordered &= position[dependency] < position[task] && graph.GetStartMilliseconds(task) >= graph.GetStartMilliseconds(dependency) + graph.GetMilliseconds(dependency);
+			}
+		}
+		CHECK(ordered);
+		CHECK(graph.GetName(7) == "Task7" && graph.GetTaskCount() == 40);
+	}
+}
+
+static void TestInvalidDependency()
+{
+	// A dependency on itself or on a later task throws and leaves the graph as it was
+	TaskGraph graph;
+	std::atomic<int> runs(0);
+	const TaskGraph::Task first = graph.Add("First", [&]() { ++runs; });
+	bool threw = false;
+	try
+	{
+		graph.Add("Self", [&]() { ++runs; }, { first, 1 });
+	}
+	catch (const std::invalid_argument&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+	threw = false;
+	try
+	{
+		graph.Add("Later", [&]() { ++runs; }, { 5 });
+	}
+	catch (const std::invalid_argument&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK(graph.GetTaskCount() == 1);
+
+	const TaskGraph::Task second = graph.Add("Second", [&]() { ++runs; }, { first });
+	CHECK(second == 1);
+	graph.Run(4);
+	CHECK(runs == 2);
+}
+
+static void TestException()
+{
+	// The first exception comes out of Run, nothing waiting on it or started after it runs
+	TaskGraph graph;
+	std::atomic<int> runs(0);
+	const TaskGraph::Task fails = graph.Add("Fails", []() { throw std::runtime_error("Fails"); });
+	graph.Add("Dependent", [&]() { ++runs; }, { fails });
+	std::string message;
+	try
+	{
+		graph.Run(1);
+	}
+	catch (const std::runtime_error& exception)
+	{
+		message = exception.what();
+	}
+	CHECK(message == "Fails");
+	CHECK(runs == 0);
+	CHECK(graph.GetMilliseconds(1) == 0.0);
+}
+
+static void TestCriticalPath()
+{
+	// Two chains next to each other, the longer one sets the wall time however many threads run them
+	TaskGraph graph;
+	const TaskGraph::Task a = graph.Add("A", []() { Sleep(20); });
+	const TaskGraph::Task b = graph.Add("B", []() { Sleep(5); });
+	const TaskGraph::Task c = graph.Add("C", []() { Sleep(30); }, { a });
+	const TaskGraph::Task d = graph.Add("D", []() { Sleep(5); }, { b });
+	const TaskGraph::Task e = graph.Add("E", []() { Sleep(5); }, { c, d });
+	graph.Run(4);
+
+	double milliseconds = 0.0;
+	const std::vector<TaskGraph::Task> path = graph.GetCriticalPath(milliseconds);
+	CHECK(path == std::vector<TaskGraph::Task>({ a, c, e }));
+	CHECK(milliseconds >= 55.0 && milliseconds <= graph.GetWallMilliseconds() + 1e-6);
+	CHECK(graph.GetSerialMilliseconds() >= 65.0);
+	CHECK(graph.GetWallMilliseconds() < graph.GetSerialMilliseconds());
+
+	TaskGraph empty;
+	empty.Run();
+	CHECK(empty.GetCriticalPath(milliseconds).empty() && milliseconds == 0.0);
+}
+
+static void TestSharedThreadPool()
+{
+	// Like LoadContent's texture tasks, every task runs its own ParallelFor on the same pool
+	ThreadPool pool(4);
+	TaskGraph graph;
+	std::vector<uint64_t> sums(16, 0);
+	for (size_t task = 0; task < sums.size(); ++task)
+	{
+		graph.Add("Sum" + std::to_string(task), [&pool, &sums, task]()
+		{
+			std::vector<uint64_t> chunkSums(pool.GetThreadCount(), 0);
+			pool.ParallelFor(1000 + task, [&](size_t begin, size_t end, uint32_t chunk)
+			{
+				for (size_t n = begin; n < end; ++n)
+				{
+					chunkSums[chunk] += n;
+				}
+			});
+			for (uint64_t sum : chunkSums)
+			{
+				sums[task] += sum;
+			}
+		});
+	}
+	graph.Run(8);
+	for (size_t task = 0; task < sums.size(); ++task)
+	{
+		const uint64_t count = 1000 + task;
+		CHECK(sums[task] == count * (count - 1) / 2);
+	}
+}
+
+int main()
+{
+	TestOrdering();
+	TestInvalidDependency();
+	TestException();
+	TestCriticalPath();
+	TestSharedThreadPool();
+	return CheckResult("TaskGraphTests");
+}
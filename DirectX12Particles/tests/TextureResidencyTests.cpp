@@ -0,0 +1,250 @@
+// Residency targets under a budget, and the stream scheduler's busy textures and evictions
+#include "Check.h"
+#include "TextureStreaming.h"
+
+#include <algorithm>
+
+// Each level a quarter of the one above, down to 16 bytes
+static std::vector<size_t> MipChain(size_t top, uint32_t mipCount)
+{
+	std::vector<size_t> sizes;
+	for (uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		sizes.push_back((std::max)(top >> (2 * mip), static_cast<size_t>(16)));
+	}
+	return sizes;
+}
+
+static const size_t Unlimited = size_t(1) << 40;
+
+static void TestTargets()
+{
+	TextureResidency residency;
+	const uint32_t a = residency.Add();
+	const uint32_t b = residency.Add();
+	const uint32_t c = residency.Add();
+	const uint32_t unknown = residency.Add();
+	const std::vector<size_t> chain = MipChain(65536, 5); // 65536 16384 4096 1024 256
+	const std::vector<size_t> small = MipChain(16384, 4);
+	residency.SetMipSizes(a, chain.data(), 5);
+	residency.SetMipSizes(b, chain.data(), 5);
+	residency.SetMipSizes(c, small.data(), 4);
+
+	// Nothing used, the coarsest mip only. A texture without a mip chain ignores uses.
+	residency.Use(unknown, 0);
+	residency.Update(Unlimited);
+	CHECK(residency.GetTargetMip(a) == 4 && residency.GetTargetMip(b) == 4 && residency.GetTargetMip(c) == 3);
+	CHECK(residency.GetTargetBytes() == 256 + 256 + 256);
+
+	// The finest use of a frame wins, past the end clamps to the coarsest
+	residency.Use(a, 0);
+	residency.Use(b, 3);
+	residency.Use(b, 1);
+	residency.Use(c, 99);
+	residency.Update(Unlimited);
+	CHECK(residency.GetTargetMip(a) == 0 && residency.GetTargetMip(b) == 1 && residency.GetTargetMip(c) == 3);
+
+	// Coarser uses without pressure keep what's there
+	residency.Use(a, 2);
+	residency.Update(Unlimited);
+	CHECK(residency.GetTargetMip(a) == 0 && residency.GetTargetMip(b) == 1);
+}
+
+static void TestSurplusFirst()
+{
+	TextureResidency residency;
+	const uint32_t a = residency.Add();
+	const uint32_t b = residency.Add();
+	const std::vector<size_t> chain = MipChain(65536, 5);
+	residency.SetMipSizes(a, chain.data(), 5);
+	residency.SetMipSizes(b, chain.data(), 5);
+	residency.Use(a, 0);
+	residency.Use(b, 1);
+	residency.Update(Unlimited);
+	const size_t all = residency.GetTargetBytes();
+	CHECK(all == (65536 + 16384 + 4096 + 1024 + 256) + (16384 + 4096 + 1024 + 256));
+
+	// a now samples from mip 2 down, its mips 0 and 1 are surplus and go before b's needed mip 1, one at a time
+	residency.Use(a, 2);
+	residency.Use(b, 1);
+	residency.Update(all - 1);
+	CHECK(residency.GetTargetMip(a) == 1 && residency.GetTargetMip(b) == 1);
+	residency.Use(a, 2);
+	residency.Use(b, 1);
+	residency.Update(all - 65536 - 1);
+	CHECK(residency.GetTargetMip(a) == 2 && residency.GetTargetMip(b) == 1);
+
+	// With the surplus gone, the largest needed top mip goes next: b's 16384 before a's 4096
+	residency.Use(a, 2);
+	residency.Use(b, 1);
+	residency.Update(residency.GetTargetBytes() - 1);
+	CHECK(residency.GetTargetMip(a) == 2 && residency.GetTargetMip(b) == 2);
+	residency.Use(a, 2);
+	residency.Use(b, 1);
+	residency.Update(residency.GetTargetBytes() - 1);
+	CHECK(residency.GetTargetMip(a) == 3 && residency.GetTargetMip(b) == 2);
+
+	// Pressure gone, the targets come back to what's sampled
+	residency.Use(a, 2);
+	residency.Use(b, 1);
+	residency.Update(Unlimited);
+	CHECK(residency.GetTargetMip(a) == 2 && residency.GetTargetMip(b) == 1);
+}
+
+static void TestLeastRecentlyUsed()
+{
+	TextureResidency residency;
+	const uint32_t a = residency.Add();
+	const uint32_t b = residency.Add();
+	const uint32_t c = residency.Add();
+	const std::vector<size_t> chain = MipChain(65536, 5);
+	for (uint32_t texture : { a, b, c })
+	{
+		residency.SetMipSizes(texture, chain.data(), 5);
+		residency.Use(texture, 0);
+	}
+	residency.Update(Unlimited);
+
+	// b was used a frame later than a, c is used now. Unused textures go before used ones, the least recently used first.
+	residency.Use(b, 0);
+	residency.Use(c, 0);
+	residency.Update(Unlimited);
+	residency.Use(c, 0);
+	residency.Update(residency.GetTargetBytes() - 1);
+	CHECK(residency.GetTargetMip(a) == 1 && residency.GetTargetMip(b) == 0 && residency.GetTargetMip(c) == 0);
+
+	// a drains all the way to its coarsest mip before b, also unused now, loses anything
+	residency.Use(c, 0);
+	residency.Update(residency.GetTargetBytes() - 16384 - 4096 - 1024);
+	CHECK(residency.GetTargetMip(a) == 4 && residency.GetTargetMip(b) == 0 && residency.GetTargetMip(c) == 0);
+	residency.Use(c, 0);
+	residency.Update(residency.GetTargetBytes() - 1);
+	CHECK(residency.GetTargetMip(a) == 4 && residency.GetTargetMip(b) == 1 && residency.GetTargetMip(c) == 0);
+}
+
+static void TestKeepCoarsest()
+{
+	TextureResidency residency;
+	const std::vector<size_t> chain = MipChain(65536, 5);
+	const std::vector<size_t> single = { 4096 };
+	const uint32_t a = residency.Add();
+	const uint32_t b = residency.Add();
+	residency.SetMipSizes(a, chain.data(), 5);
+	residency.SetMipSizes(b, single.data(), 1);
+	residency.Use(a, 0);
+	residency.Use(b, 0);
+	residency.Update(Unlimited);
+	CHECK(residency.GetTargetMip(a) == 0 && residency.GetTargetMip(b) == 0);
+
+	// No budget at all still leaves every coarsest mip, and that's the only time the targets go over budget
+	residency.Use(a, 0);
+	residency.Use(b, 0);
+	residency.Update(0);
+	CHECK(residency.GetTargetMip(a) == 4 && residency.GetTargetMip(b) == 0);
+	CHECK(residency.GetTargetBytes() == 256 + 4096);
+}
+
+static void TestScheduler()
+{
+	TextureStreamScheduler scheduler;
+	const uint32_t texture = scheduler.Add(1.0f);
+	const size_t mipSizes[4] = { 4096, 1024, 256, 64 };
+	scheduler.SetMipSizes(texture, mipSizes, 4);
+	CHECK(scheduler.GetResidentMip(texture) == 4);
+	scheduler.SetTargetMip(texture, 2);
+	CHECK(scheduler.GetPendingBytes() == 64 + 256);
+
+	// Coarsest first, down to the target
+	std::vector<TextureStreamUpload> uploads;
+	scheduler.Schedule(Unlimited, uploads);
+	CHECK(uploads.size() == 2 && uploads[0].Mip == 3 && uploads[1].Mip == 2 && uploads[1].Size == 256);
+	CHECK(scheduler.GetPendingBytes() == 0);
+
+	// A finer target waits while the uploads are in flight
+	std::vector<TextureStreamUpload> more;
+	scheduler.SetTargetMip(texture, 0);
+	scheduler.Schedule(Unlimited, more);
+	CHECK(more.empty());
+	scheduler.Complete(uploads[0]);
+	CHECK(scheduler.GetResidentMip(texture) == 3);
+	scheduler.Schedule(Unlimited, more);
+	CHECK(more.empty());
+	scheduler.Complete(uploads[1]);
+	CHECK(scheduler.GetResidentMip(texture) == 2);
+
+	// The first upload of a call goes however large, the next one waits for budget
+	scheduler.Schedule(1, more);
+	CHECK(more.size() == 1 && more[0].Mip == 1);
+	scheduler.Complete(more[0]);
+	more.clear();
+	scheduler.Schedule(Unlimited, more);
+	CHECK(more.size() == 1 && more[0].Mip == 0);
+
+	// No eviction while busy, then one down to the coarser target, and no uploads while it's in flight
+	std::vector<TextureStreamEviction> evictions;
+	scheduler.SetTargetMip(texture, 2);
+	scheduler.ScheduleEvictions(evictions);
+	CHECK(evictions.empty());
+	scheduler.Complete(more[0]);
+	CHECK(scheduler.GetResidentMip(texture) == 0);
+	scheduler.ScheduleEvictions(evictions);
+	CHECK(evictions.size() == 1 && evictions[0].Texture == texture && evictions[0].Mip == 2);
+	scheduler.SetTargetMip(texture, 1);
+	uploads.clear();
+	scheduler.Schedule(Unlimited, uploads);
+	CHECK(uploads.empty());
+	scheduler.Complete(evictions[0]);
+	CHECK(scheduler.GetResidentMip(texture) == 2);
+
+	// Evicted mips stream back in when the target asks for them again
+	CHECK(scheduler.GetPendingBytes() == 1024);
+	scheduler.Schedule(Unlimited, uploads);
+	CHECK(uploads.size() == 1 && uploads[0].Mip == 1);
+	evictions.clear();
+	scheduler.ScheduleEvictions(evictions);
+	CHECK(evictions.empty());
+}
+
+static void TestSchedulerOrder()
+{
+	TextureStreamScheduler scheduler;
+	const size_t mipSizes[3] = { 1024, 256, 64 };
+	const uint32_t low = scheduler.Add(1.0f);
+	const uint32_t high = scheduler.Add(5.0f);
+	const uint32_t unknown = scheduler.Add(9.0f);
+	scheduler.SetMipSizes(low, mipSizes, 3);
+	scheduler.SetMipSizes(high, mipSizes, 3);
+	CHECK(scheduler.GetMipCount(unknown) == 0);
+
+	// Every texture gets its first mip before any gets a second, then priority decides
+	std::vector<TextureStreamUpload> uploads;
+	scheduler.Schedule(Unlimited, uploads);
+	const uint32_t order[6][2] = { { high, 2 }, { low, 2 }, { high, 1 }, { high, 0 }, { low, 1 }, { low, 0 } };
+	CHECK(uploads.size() == 6);
+	for (size_t n = 0; n < (std::min)(uploads.size(), static_cast<size_t>(6)); ++n)
+	{
+		CHECK(uploads[n].Texture == order[n][0] && uploads[n].Mip == order[n][1]);
+	}
+
+	// Among equal priorities the cheaper upload goes first
+	TextureStreamScheduler equal;
+	const size_t smallSizes[3] = { 512, 128, 32 };
+	const uint32_t large = equal.Add(1.0f);
+	const uint32_t cheap = equal.Add(1.0f);
+	equal.SetMipSizes(large, mipSizes, 3);
+	equal.SetMipSizes(cheap, smallSizes, 3);
+	uploads.clear();
+	equal.Schedule(Unlimited, uploads);
+	CHECK(uploads.size() == 6 && uploads[0].Texture == cheap && uploads[1].Texture == large && uploads[2].Texture == cheap);
+}
+
+int main()
+{
+	TestTargets();
+	TestSurplusFirst();
+	TestLeastRecentlyUsed();
+	TestKeepCoarsest();
+	TestScheduler();
+	TestSchedulerOrder();
+	return CheckResult("TextureResidencyTests");
+}
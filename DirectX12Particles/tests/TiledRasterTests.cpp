@@ -0,0 +1,223 @@
+// Tile lists of the tiled raster binning against brute force footprint tests, their draw order, the per tile cap and the capacity cut-off
+#include "Check.h"
+#include "TiledRaster.h"
+
+#include <algorithm>
+#include <random>
+
+// Identity view, 90 degree field of view, near 1 and far 100
+static TileRasterConstants MakeConstants(uint width, uint height)
+{
+	const float nearZ = 1.0f;
+	const float farZ = 100.0f;
+	TileRasterConstants constants = {};
+	constants.View.r[0] = float4(1, 0, 0, 0);
+	constants.View.r[1] = float4(0, 1, 0, 0);
+	constants.View.r[2] = float4(0, 0, 1, 0);
+	constants.View.r[3] = float4(0, 0, 0, 1);
+	constants.Projection.r[0] = float4(1, 0, 0, 0);
+	constants.Projection.r[1] = float4(0, 1, 0, 0);
+	constants.Projection.r[2] = float4(0, 0, farZ / (farZ - nearZ), 1);
+	constants.Projection.r[3] = float4(0, 0, -nearZ * farZ / (farZ - nearZ), 0);
+	constants.Dimensions = uint2(width, height);
+	constants.TileCount = uint2((width + TILE_RASTER_SIZE - 1) / TILE_RASTER_SIZE, (height + TILE_RASTER_SIZE - 1) / TILE_RASTER_SIZE);
+	return constants;
+}
+
+static Particle MakeParticle(float3 position, float scale, float rotation = 0.0f, float lifeTimeLeft = 1.0f)
+{
+	Particle particle = {};
+	particle.position = float4(position.x, position.y, position.z, 1.0f);
+	particle.color = float4(1, 1, 1, 1);
+	particle.lifeTimeLeft = lifeTimeLeft;
+	particle.scale = scale;
+	particle.rotation = rotation;
+	return particle;
+}
+
+static std::vector<uint> TileList(const TiledRasterCPU& raster, uint tile)
+{
+	const uint* entries = raster.GetTileEntries(tile);
+	return std::vector<uint>(entries, entries + raster.GetTileEntryCount(tile));
+}
+
+static void TestHandPlacement()
+{
+	// 96x64 pixels are 6x4 tiles. A unit particle 10 away projects to a 9.6x6.4 pixel rect around (48, 32),
+	// which reaches into tiles 2 and 3 across and 1 and 2 down.
+	ThreadPool pool(2);
+	TiledRasterCPU raster(pool);
+	const TileRasterConstants constants = MakeConstants(96, 64);
+	const std::vector<Particle> particles = {
+		MakeParticle(float3(0, 0, 10), 1.0f),
+		MakeParticle(float3(0, 0, 10), 1.0f, 0.0f, 0.0f), // Dead
+		MakeParticle(float3(0, 0, -10), 1.0f), // Behind the camera
+		MakeParticle(float3(30, 0, 10), 1.0f), // Off the right edge
+		MakeParticle(float3(0, 0, 150), 1.0f), // Past the far plane
+		MakeParticle(float3(-9.5f, 9.5f, 10), 0.2f), // Top left corner
+	};
+	const std::vector<uint> drawList = { 5, 4, 3, 2, 1, 0 };
+
+	const ParticleFootprint footprint = ProjectParticle(particles[0], constants);
+	CHECK(footprint.Valid == 1);
+	CHECK_NEAR(footprint.Rect.x, 43.2f, 1e-4f);
+	CHECK_NEAR(footprint.Rect.y, 28.8f, 1e-4f);
+	CHECK_NEAR(footprint.Rect.z, 52.8f, 1e-4f);
+	CHECK_NEAR(footprint.Rect.w, 35.2f, 1e-4f);
+
+	CHECK(raster.Bin(particles, drawList, constants) == 5);
+	for (uint tile = 0; tile < 24; ++tile)
+	{
+		if (tile == 8 || tile == 9 || tile == 14 || tile == 15)
+		{
+			CHECK(TileList(raster, tile) == std::vector<uint>({ 5 }));
+		}
+		else if (tile == 0)
+		{
+			CHECK(TileList(raster, tile) == std::vector<uint>({ 0 }));
+		}
+		else
+		{
+			CHECK(raster.GetTileEntryCount(tile) == 0);
+		}
+	}
+}
+
+static void TestAgainstBruteForce()
+{
+	// 200x120 pixels leave partial tiles on the right and bottom
+	const TileRasterConstants constants = MakeConstants(200, 120);
+	const uint tileCount = constants.TileCount.x * constants.TileCount.y;
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> lateral(-15.0f, 15.0f);
+	std::uniform_real_distribution<float> distance(-2.0f, 120.0f);
+	std::uniform_real_distribution<float> size(0.05f, 3.0f);
+	std::uniform_real_distribution<float> angle(-3.2f, 3.2f);
+	std::uniform_real_distribution<float> life(-0.2f, 1.0f);
+	std::vector<Particle> particles;
+	for (uint n = 0; n < 3000; ++n)
+	{
+		particles.push_back(MakeParticle(float3(lateral(random), lateral(random), distance(random)), size(random), angle(random), life(random)));
+	}
+
+	// A shuffled draw list that leaves some particles out
+	std::vector<uint> drawList;
+	for (uint n = 0; n < particles.size(); ++n)
+	{
+		if (n % 7 != 3)
+		{
+			drawList.push_back(n);
+		}
+	}
+	std::shuffle(drawList.begin(), drawList.end(), random);
+
+	std::vector<std::vector<uint>> expected(tileCount);
+	for (uint n = 0; n < drawList.size(); ++n)
+	{
+		const ParticleFootprint footprint = ProjectParticle(particles[drawList[n]], constants);
+		if (!footprint.Valid)
+		{
+			continue;
+		}
+		const uint4 tiles = FootprintTiles(footprint, constants);
+		for (uint y = tiles.y; y <= tiles.w; ++y)
+		{
+			for (uint x = tiles.x; x <= tiles.z; ++x)
+			{
+				expected[y * constants.TileCount.x + x].push_back(n);
+			}
+		}
+	}
+	size_t total = 0;
+	for (const std::vector<uint>& list : expected)
+	{
+		total += list.size();
+	}
+
+	for (uint threadCount : { 1u, 3u, 8u })
+	{
+		ThreadPool pool(threadCount);
+		TiledRasterCPU raster(pool);
+		CHECK(raster.Bin(particles, drawList, constants) == total);
+		bool matches = true;
+		for (uint tile = 0; tile < tileCount; ++tile)
+		{
+			const size_t kept = (std::min)(expected[tile].size(), static_cast<size_t>(TILE_RASTER_MAX_ENTRIES));
+			matches &= TileList(raster, tile) == std::vector<uint>(expected[tile].begin(), expected[tile].begin() + kept);
+		}
+		CHECK(matches);
+	}
+
+	// The tile ranges cover every pixel center the quad does
+	bool covered = true;
+	for (uint n = 0; n < 200; ++n)
+	{
+		const ParticleFootprint footprint = ProjectParticle(particles[n], constants);
+		if (!footprint.Valid)
+		{
+			continue;
+		}
+		const uint4 tiles = FootprintTiles(footprint, constants);
+		for (uint y = 0; y < constants.Dimensions.y; ++y)
+		{
+			for (uint x = 0; x < constants.Dimensions.x; ++x)
+			{
+				if (FootprintCovers(footprint, float2(x + 0.5f, y + 0.5f)))
+				{
+					const uint tileX = x / TILE_RASTER_SIZE;
+					const uint tileY = y / TILE_RASTER_SIZE;
+					covered &= tileX >= tiles.x && tileX <= tiles.z && tileY >= tiles.y && tileY <= tiles.w;
+				}
+			}
+		}
+	}
+	CHECK(covered);
+}
+
+static void TestCapacity()
+{
+	// 32x16 pixels are two tiles holding 1024 entries together. Small particles sit at the center of one tile or the other.
+	ThreadPool pool(4);
+	TiledRasterCPU raster(pool);
+	const TileRasterConstants constants = MakeConstants(32, 16);
+	const Particle left = MakeParticle(float3(-5, 0, 10), 0.1f);
+	const Particle right = MakeParticle(float3(5, 0, 10), 0.1f);
+
+	// Drawn in reverse, the 600 on the left keep their first 512 draw positions and the 10 on the right still fit behind them
+	std::vector<Particle> particles(600, left);
+	particles.resize(610, right);
+	std::vector<uint> drawList(particles.size());
+	for (uint n = 0; n < drawList.size(); ++n)
+	{
+		drawList[n] = static_cast<uint>(drawList.size()) - 1 - n;
+	}
+	CHECK(raster.Bin(particles, drawList, constants) == 610);
+	std::vector<uint> first;
+	for (uint n = 10; n < 10 + TILE_RASTER_MAX_ENTRIES; ++n)
+	{
+		first.push_back(n);
+	}
+	CHECK(TileList(raster, 0) == first);
+	CHECK(TileList(raster, 1) == std::vector<uint>({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }));
+
+	// 1020 on the left push the right tile's list past the end of TileEntries, it keeps nothing
+	particles.assign(1020, left);
+	particles.resize(1030, right);
+	drawList.resize(particles.size());
+	for (uint n = 0; n < drawList.size(); ++n)
+	{
+		drawList[n] = n;
+	}
+	CHECK(raster.Bin(particles, drawList, constants) == 1030);
+	CHECK(raster.GetTileEntryCount(0) == TILE_RASTER_MAX_ENTRIES);
+	CHECK(raster.GetTileEntries(0)[TILE_RASTER_MAX_ENTRIES - 1] == TILE_RASTER_MAX_ENTRIES - 1);
+	CHECK(raster.GetTileEntryCount(1) == 0);
+}
+
+int main()
+{
+	TestHandPlacement();
+	TestAgainstBruteForce();
+	TestCapacity();
+	return CheckResult("TiledRasterTests");
+}
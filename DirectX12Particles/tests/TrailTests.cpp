@@ -0,0 +1,180 @@
+// Trail history ring: slot wrap, restarts, the ribbons built from it over many frames, and the ribbon index buffer
+#include "Check.h"
+#include "ParticleSystemCPU.h"
+#include "Trail.h"
+
+#include <algorithm>
+
+static float3 Position(float4 value)
+{
+	return float3(value.x, value.y, value.z);
+}
+
+static bool Same(float4 a, float4 b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+}
+
+static void TestSlots()
+{
+	// Age 0 is the head, older samples walk backwards and wrap below slot 0
+	CHECK(TrailSlot(0, 0) == 0);
+	CHECK(TrailSlot(0, 1) == TRAIL_LENGTH - 1);
+	CHECK(TrailSlot(3, 3) == 0);
+	CHECK(TrailSlot(3, 4) == TRAIL_LENGTH - 1);
+	CHECK(TrailSlot(TRAIL_LENGTH - 1, TRAIL_LENGTH - 1) == 0);
+	bool permutation = true;
+	for (uint head = 0; head < TRAIL_LENGTH; ++head)
+	{
+		uint seen = 0;
+		for (uint age = 0; age < TRAIL_LENGTH; ++age)
+		{
+			seen |= 1u << TrailSlot(head, age);
+		}
+		permutation &= seen == (1u << TRAIL_LENGTH) - 1;
+	}
+	CHECK(permutation);
+	CHECK(TrailHistoryIndex(2, 5, 100) == 205);
+}
+
+static void TestWrite()
+{
+	const uint capacity = 3;
+	std::vector<float4> history(capacity * TRAIL_LENGTH);
+	Particle particle = {};
+	particle.position = float4(1, 2, 3, 1);
+	particle.scale = 0.5f;
+
+	// A restart fills the particle's whole ring and nobody else's, a normal write only the head
+	WriteTrailHistory(history, 4, 1, capacity, particle, true);
+	bool filled = true;
+	for (uint slot = 0; slot < TRAIL_LENGTH; ++slot)
+	{
+		filled &= Same(history[TrailHistoryIndex(slot, 1, capacity)], float4(1, 2, 3, 0.5f));
+		filled &= Same(history[TrailHistoryIndex(slot, 0, capacity)], float4(0, 0, 0, 0));
+		filled &= Same(history[TrailHistoryIndex(slot, 2, capacity)], float4(0, 0, 0, 0));
+	}
+	CHECK(filled);
+	particle.position = float4(4, 5, 6, 1);
+	WriteTrailHistory(history, 6, 1, capacity, particle, false);
+	CHECK(Same(history[TrailHistoryIndex(6, 1, capacity)], float4(4, 5, 6, 0.5f)));
+	CHECK(Same(history[TrailHistoryIndex(5, 1, capacity)], float4(1, 2, 3, 0.5f)));
+	CHECK(Same(history[TrailHistoryIndex(7, 1, capacity)], float4(1, 2, 3, 0.5f)));
+}
+
+static void TestIndices()
+{
+	const uint trailCount = 3;
+	const std::vector<uint> indices = BuildTrailIndices(trailCount);
+	CHECK(indices.size() == trailCount * TRAIL_INDICES_PER_PARTICLE);
+
+	// Every segment joins the two sides of one sample to the two sides of the next, within its own trail
+	bool joined = true;
+	for (size_t triangle = 0; triangle < indices.size() / 3; ++triangle)
+	{
+		const uint trail = static_cast<uint>(triangle * 3 / TRAIL_INDICES_PER_PARTICLE);
+		const uint segment = static_cast<uint>(triangle / 2 % (TRAIL_LENGTH - 1));
+		const uint first = trail * TRAIL_VERTICES_PER_PARTICLE + 2 * segment;
+		for (uint corner = 0; corner < 3; ++corner)
+		{
+			const uint index = indices[triangle * 3 + corner];
+			joined &= index >= first && index < first + 4;
+		}
+		joined &= indices[triangle * 3] != indices[triangle * 3 + 1] && indices[triangle * 3 + 1] != indices[triangle * 3 + 2] &&
+			indices[triangle * 3] != indices[triangle * 3 + 2];
+	}
+	CHECK(joined);
+	CHECK(BuildTrailIndices(0).empty());
+}
+
+static EmitterConstants Emitter(uint capacity, float3 position, uint emitCount)
+{
+	EmitterConstants emitter = {};
+	emitter.deltaTime = 1.0f / 60.0f;
+	emitter.particleLifetime = 10.0f;
+	emitter.emitCount = emitCount;
+	emitter.maxParticleCount = capacity;
+	emitter.emitAABBMin = float4(position.x, position.y, position.z, 0);
+	emitter.emitAABBMax = float4(position.x, position.y, position.z, 0);
+	emitter.emitVelocityMin = float4(1, 2, 0, 0);
+	emitter.emitVelocityMax = float4(1, 2, 0, 0);
+	emitter.particleStartScale = 0.2f;
+	emitter.particleEndScale = 0.2f;
+	emitter.curveSet = CURVE_SET_NONE;
+	return emitter;
+}
+
+static void TestRing()
+{
+	// Particles emitted on frames 0 and 5 run for 30 frames, long enough for the ring to wrap a few times.
+	// The history is reset on frame 17. Age a of a trail on frame f is the position after frame max(f - a, spawn or reset frame).
+	const uint capacity = 4;
+	ThreadPool pool(2);
+	ParticleSystemCPU system(capacity, pool);
+	TrailConstants constants = {};
+	constants.CameraPosition = float3(0, 0, -10);
+	constants.WidthScale = 1.5f;
+	constants.MaxParticleCount = capacity;
+
+	std::vector<std::vector<float3>> positions(capacity);
+	std::vector<uint> restart(capacity, 0);
+	bool ring = true;
+	bool ribbons = true;
+	for (uint frame = 0; frame < 30; ++frame)
+	{
+		const EmitterConstants emitter = Emitter(capacity, frame == 5 ? float3(0, 0, 5) : float3(0, 0, 0), frame == 0 || frame == 5 ? 1 : 0);
+		const uint head = frame % TRAIL_LENGTH;
+		system.Update(emitter, {}, {}, {}, {}, {}, {}, {}, frame == 17 ? head | TRAIL_HEAD_RESET : head, {}, false);
+
+		const std::vector<uint>& drawIndices = system.GetDrawIndices();
+		for (uint particleIndex : drawIndices)
+		{
+			if (positions[particleIndex].empty() || frame == 17)
+			{
+				restart[particleIndex] = frame;
+			}
+			positions[particleIndex].resize(frame + 1);
+			positions[particleIndex][frame] = Position(system.GetParticles()[particleIndex].position);
+		}
+
+		constants.Head = head;
+		std::vector<TrailVertex> vertices;
+		GenerateTrailStrips(system.GetParticles(), drawIndices, system.GetTrailHistory(), constants, vertices);
+		ring &= vertices.size() == drawIndices.size() * TRAIL_VERTICES_PER_PARTICLE;
+		for (size_t n = 0; n < drawIndices.size() && ring; ++n)
+		{
+			const uint particleIndex = drawIndices[n];
+			const std::vector<float3>& path = positions[particleIndex];
+			const uint first = restart[particleIndex];
+			for (uint age = 0; age < TRAIL_LENGTH; ++age)
+			{
+				const float3 expected = path[(std::max)(static_cast<int>(frame) - static_cast<int>(age), static_cast<int>(first))];
+				const TrailVertex& left = vertices[n * TRAIL_VERTICES_PER_PARTICLE + 2 * age];
+				const TrailVertex& right = vertices[n * TRAIL_VERTICES_PER_PARTICLE + 2 * age + 1];
+				ring &= length((left.Position + right.Position) * 0.5f - expected) <= 1e-5f;
+
+				// Sides are the sample's scale times WidthScale apart, or together where the neighbors the tangent comes from
+				// are the same collapsed sample
+				const int newer = (std::max)(static_cast<int>(frame) - static_cast<int>(age == 0 ? 0 : age - 1), static_cast<int>(first));
+				const int older = (std::max)(static_cast<int>(frame) - static_cast<int>((std::min)(age + 1, static_cast<uint>(TRAIL_LENGTH - 1))), static_cast<int>(first));
+				const float width = length(right.Position - left.Position);
+				ribbons &= newer > older ? std::fabs(width - 2.0f * 0.2f * constants.WidthScale) <= 1e-4f : width == 0.0f;
+				ribbons &= left.UV.x == 0.0f && right.UV.x == 1.0f && left.UV.y == static_cast<float>(age) / (TRAIL_LENGTH - 1);
+				ribbons &= age != 0 || left.Color == PackParticleTint(system.GetParticles()[particleIndex].color);
+				ribbons &= age != TRAIL_LENGTH - 1 || (left.Color >> 24) == 0;
+			}
+		}
+	}
+	CHECK(ring);
+	CHECK(ribbons);
+	CHECK(system.GetAliveCount() == 2);
+}
+
+int main()
+{
+	TestSlots();
+	TestWrite();
+	TestIndices();
+	TestRing();
+	return CheckResult("TrailTests");
+}
@@ -0,0 +1,253 @@
+// Trilinear clamp sampling of vector field volumes against hand computed values, FGA parsing, and the looping frame stream
+#include "Check.h"
+#include "VectorField.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+// 2x2x2 volume whose x channel is x + 10y + 100z and y channel is x * y * z at texel (x, y, z). Trilinear filtering
+// reproduces both exactly, so samples between texel centers have closed form values.
+static VectorFieldVolume Cube()
+{
+	VectorFieldVolume volume;
+	volume.Resolution[0] = volume.Resolution[1] = volume.Resolution[2] = 2;
+	volume.BoundsMin = float3(-1, -1, -1);
+	volume.BoundsMax = float3(1, 1, 1);
+	for (uint z = 0; z < 2; ++z)
+	{
+		for (uint y = 0; y < 2; ++y)
+		{
+			for (uint x = 0; x < 2; ++x)
+			{
+				volume.Texels.push_back(float4(x + 10.0f * y + 100.0f * z, static_cast<float>(x * y * z), 7.0f, 0.0f));
+			}
+		}
+	}
+	return volume;
+}
+
+static void TestTrilinear()
+{
+	const VectorFieldVolume volume = Cube();
+
+	// Texel centers sit at 0.25 and 0.75 on every axis
+	float3 value = SampleVectorField(volume, float3(0.25f, 0.25f, 0.25f));
+	CHECK_NEAR(value.x, 0.0, 1e-5);
+	CHECK_NEAR(value.y, 0.0, 1e-5);
+	CHECK_NEAR(value.z, 7.0, 1e-5);
+	value = SampleVectorField(volume, float3(0.75f, 0.75f, 0.75f));
+	CHECK_NEAR(value.x, 111.0, 1e-4);
+	CHECK_NEAR(value.y, 1.0, 1e-5);
+
+	// Halfway between all eight: 0.5 + 5 + 50 and 0.5^3
+	value = SampleVectorField(volume, float3(0.5f, 0.5f, 0.5f));
+	CHECK_NEAR(value.x, 55.5, 1e-4);
+	CHECK_NEAR(value.y, 0.125, 1e-5);
+	CHECK_NEAR(value.z, 7.0, 1e-5);
+
+	// Texel coordinates (0.25, 0.75, 1): 0.25 + 7.5 + 100 and 0.25 * 0.75 * 1
+	value = SampleVectorField(volume, float3(0.375f, 0.625f, 0.75f));
+	CHECK_NEAR(value.x, 107.75, 1e-4);
+	CHECK_NEAR(value.y, 0.1875, 1e-5);
+
+	// 3x1x2 with each texel holding its own index, the far corner is x + (z * 1 + y) * 3 = 5
+	VectorFieldVolume strip;
+	strip.Resolution[0] = 3;
+	strip.Resolution[1] = 1;
+	strip.Resolution[2] = 2;
+	for (int n = 0; n < 6; ++n)
+	{
+		strip.Texels.push_back(float4(static_cast<float>(n), 0, 0, 0));
+	}
+	CHECK_NEAR(SampleVectorField(strip, float3(5.0f / 6.0f, 0.5f, 0.75f)).x, 5.0, 1e-5);
+	CHECK_NEAR(SampleVectorField(strip, float3(0.5f, 0.5f, 0.25f)).x, 1.0, 1e-5);
+	// Halfway between texels 1 and 2 on x and between the two z slices: (1 + 2 + 4 + 5) / 4
+	CHECK_NEAR(SampleVectorField(strip, float3(2.0f / 3.0f, 0.5f, 0.5f)).x, 3.0, 1e-5);
+}
+
+static void TestClamp()
+{
+	const VectorFieldVolume volume = Cube();
+
+	// Outside the texel centers the edge texels repeat, so the border half texel and anything past the bounds are flat
+	CHECK_NEAR(SampleVectorField(volume, float3(0.1f, 0.25f, 0.25f)).x, 0.0, 1e-5);
+	CHECK_NEAR(SampleVectorField(volume, float3(0.0f, 0.0f, 0.0f)).x, 0.0, 1e-5);
+	CHECK_NEAR(SampleVectorField(volume, float3(0.9f, 0.25f, 0.25f)).x, 1.0, 1e-5);
+	CHECK_NEAR(SampleVectorField(volume, float3(1.0f, 1.0f, 1.0f)).x, 111.0, 1e-4);
+
+	// Texel coordinates clamp to (0, 0, 1) per axis: 100, and the product term is 0
+	float3 value = SampleVectorField(volume, float3(-1.0f, 0.1f, 2.0f));
+	CHECK_NEAR(value.x, 100.0, 1e-4);
+	CHECK_NEAR(value.y, 0.0, 1e-5);
+
+	// Clamped on x only, y and z still filter: 1 + 5 + 50
+	CHECK_NEAR(SampleVectorField(volume, float3(5.0f, 0.5f, 0.5f)).x, 56.0, 1e-4);
+
+	// The simulate stage skips particles outside the bounds instead of taking the clamped edge
+	CHECK(VectorFieldInside(float3(0.0f, 0.0f, 0.0f)));
+	CHECK(VectorFieldInside(float3(1.0f, 1.0f, 1.0f)));
+	CHECK(VectorFieldInside(float3(0.5f, 0.2f, 0.9f)));
+	CHECK(!VectorFieldInside(float3(-0.001f, 0.5f, 0.5f)));
+	CHECK(!VectorFieldInside(float3(0.5f, 1.001f, 0.5f)));
+	CHECK(!VectorFieldInside(float3(0.5f, 0.5f, 2.0f)));
+}
+
+static void TestApply()
+{
+	VectorFieldInstance field = {};
+	field.Strength = 2.0f;
+
+	// Tightness 0 adds value * Strength as an acceleration: (1, 0, 0) + (4, -2, 0) * 0.5
+	field.Tightness = 0.0f;
+	float3 velocity = VectorFieldApply(float3(2, -1, 0), float3(1, 0, 0), field, 0.5f);
+	CHECK_NEAR(velocity.x, 3.0, 1e-6);
+	CHECK_NEAR(velocity.y, -1.0, 1e-6);
+	CHECK_NEAR(velocity.z, 0.0, 1e-6);
+
+	// Tightness 1 takes the field's velocity outright, 0.25 is a quarter of the way from the accelerated velocity to it
+	field.Tightness = 1.0f;
+	velocity = VectorFieldApply(float3(2, -1, 0), float3(1, 0, 0), field, 0.5f);
+	CHECK_NEAR(velocity.x, 4.0, 1e-6);
+	CHECK_NEAR(velocity.y, -2.0, 1e-6);
+	field.Tightness = 0.25f;
+	velocity = VectorFieldApply(float3(2, -1, 0), float3(1, 0, 0), field, 0.5f);
+	CHECK_NEAR(velocity.x, 3.25, 1e-6);
+	CHECK_NEAR(velocity.y, -1.25, 1e-6);
+}
+
+static void TestFGA()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "VectorFieldTests.fga";
+	{
+		std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		file << "2,1,1,\n-1,-2,-3,\n1,2,3,\n0.5,0,-1,\n2,3,4,\n";
+	}
+	VectorFieldVolume volume;
+	CHECK(LoadFGA(path, volume));
+	CHECK(volume.Resolution[0] == 2 && volume.Resolution[1] == 1 && volume.Resolution[2] == 1);
+	CHECK(volume.BoundsMin.x == -1.0f && volume.BoundsMin.y == -2.0f && volume.BoundsMin.z == -3.0f);
+	CHECK(volume.BoundsMax.x == 1.0f && volume.BoundsMax.y == 2.0f && volume.BoundsMax.z == 3.0f);
+	CHECK(volume.Texels.size() == 2);
+	CHECK(volume.Texels[0].x == 0.5f && volume.Texels[0].y == 0.0f && volume.Texels[0].z == -1.0f);
+	CHECK(volume.Texels[1].x == 2.0f && volume.Texels[1].y == 3.0f && volume.Texels[1].z == 4.0f);
+
+	// One vector short
+	{
+		std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		file << "2,1,1,\n-1,-2,-3,\n1,2,3,\n0.5,0,-1,\n";
+	}
+	CHECK(!LoadFGA(path, volume));
+	CHECK(volume.Empty());
+
+	// A zero resolution
+	{
+		std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		file << "0,1,1,\n-1,-2,-3,\n1,2,3,\n";
+	}
+	CHECK(!LoadFGA(path, volume));
+	std::filesystem::remove(path);
+	CHECK(!LoadFGA(path, volume));
+}
+
+// Frames are named by their number, the loader makes a 1x1x1 volume holding it so Current shows which frame is up.
+// Names in failing don't load, names in resized load at a different resolution than frame 0.
+static VectorFieldStream::Loader NumberedLoader(std::string failing = "", std::string resized = "")
+{
+	return [failing, resized](const std::filesystem::path& path, VectorFieldVolume& volume)
+	{
+		const std::string name = path.string();
+		if (name == failing)
+		{
+			return false;
+		}
+		volume.Resolution[0] = name == resized ? 2 : 1;
+		volume.Resolution[1] = volume.Resolution[2] = 1;
+		volume.Texels.assign(volume.Resolution[0], float4(std::stof(name), 0, 0, 0));
+		return true;
+	};
+}
+
+static std::vector<std::filesystem::path> Numbered(int count)
+{
+	std::vector<std::filesystem::path> frames;
+	for (int n = 0; n < count; ++n)
+	{
+		frames.push_back(std::to_string(n));
+	}
+	return frames;
+}
+
+static float Shown(const VectorFieldStream& stream)
+{
+	return stream.Current().Empty() ? -1.0f : stream.Current().Texels[0].x;
+}
+
+// The worker loads ahead on its own schedule, so a step retries with Advance(0) until the frame it wants is up
+static bool StepTo(VectorFieldStream& stream, float deltaTime, float frame, int milliseconds = 2000)
+{
+	stream.Advance(deltaTime);
+	for (int attempt = 0; attempt < milliseconds && Shown(stream) != frame; ++attempt)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		stream.Advance(0.0f);
+	}
+	return Shown(stream) == frame;
+}
+
+static void TestStream()
+{
+	// 4 frames at 4 per second, quarter second steps move one frame and wrap from the last back to the first
+	VectorFieldStream stream(Numbered(4), 4.0f, NumberedLoader());
+	CHECK(stream.Valid());
+	CHECK(stream.GetFrameCount() == 4);
+	CHECK(Shown(stream) == 0.0f);
+	CHECK(StepTo(stream, 0.25f, 1.0f));
+	CHECK(StepTo(stream, 0.25f, 2.0f));
+	CHECK(StepTo(stream, 0.25f, 3.0f));
+	CHECK(StepTo(stream, 0.25f, 0.0f));
+
+	// Half a second skips a frame, more than a whole loop lands where the remainder puts it: (0.5 + 1.25) mod 1 = 0.75
+	CHECK(StepTo(stream, 0.5f, 2.0f));
+	CHECK(StepTo(stream, 1.25f, 3.0f));
+
+	// Less than a frame keeps the frame up
+	CHECK(!stream.Advance(0.1f));
+	CHECK(Shown(stream) == 3.0f);
+	CHECK(StepTo(stream, 0.15f, 0.0f));
+}
+
+static void TestStreamHolds()
+{
+	// Frame 2 fails to load and frame 3 has the wrong resolution, frame 1 stays up over both
+	VectorFieldStream stream(Numbered(5), 4.0f, NumberedLoader("2", "3"));
+	CHECK(StepTo(stream, 0.25f, 1.0f));
+	CHECK(!StepTo(stream, 0.25f, 2.0f, 200));
+	CHECK(Shown(stream) == 1.0f);
+	CHECK(!StepTo(stream, 0.25f, 3.0f, 200));
+	CHECK(Shown(stream) == 1.0f);
+	CHECK(stream.Current().Resolution[0] == 1);
+	CHECK(StepTo(stream, 0.25f, 4.0f));
+	CHECK(StepTo(stream, 0.25f, 0.0f));
+
+	// A single frame never moves, and a sequence whose first frame fails has nothing to show
+	VectorFieldStream single(Numbered(1), 4.0f, NumberedLoader());
+	CHECK(single.Valid());
+	CHECK(!single.Advance(1.0f));
+	CHECK(Shown(single) == 0.0f);
+	VectorFieldStream broken(Numbered(3), 4.0f, NumberedLoader("0"));
+	CHECK(!broken.Valid());
+}
+
+int main()
+{
+	TestTrilinear();
+	TestClamp();
+	TestApply();
+	TestFGA();
+	TestStream();
+	TestStreamHolds();
+	return CheckResult("VectorFieldTests");
+}
@@ -0,0 +1,166 @@
+// Times the particle atlas packer and builder on generated sources, and checks that rebuilding gives the same bytes.
+// Builds on Windows and Linux from this directory:
+//   g++ -std=c++20 -O2 -I../source/ParticleCPU AtlasBenchmark.cpp ../source/ParticleCPU/ParticleAtlas.cpp ../source/ParticleCPU/DDSFile.cpp
+//       ../source/ParticleCPU/MappedFile.cpp -o AtlasBenchmark
+//   cl /std:c++20 /O2 /EHsc /I..\source\ParticleCPU AtlasBenchmark.cpp ..\source\ParticleCPU\ParticleAtlas.cpp ...
+// or as the AtlasBenchmark target of tests/CMakeLists.txt.
+//
+// AtlasBenchmark [--count N] [--seed N] [--format bc1|bc7|rgba8]
+//   Packs N sources, 256 by default, with sizes from 4 to 256 texels and 1 to 5 mips. Reports the packer's and the
+//   builder's time, the atlas size and how much of it the sources cover.
+
+#include "ParticleAtlas.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Format
+{
+	const char* Name;
+	uint32_t Value;
+};
+
+static const Format Formats[] = { { "bc1", 71 }, { "bc7", 98 }, { "rgba8", 28 } };
+
+// Random texel bytes, the builder copies blocks without looking at them
+static std::vector<uint8_t> MakeSourceFile(uint32_t format, uint width, uint height, uint mipCount, std::mt19937& random)
+{
+	std::vector<uint8_t> file;
+	WriteDDSHeader(format, width, height, 1, mipCount, file);
+	size_t size = 0;
+	for (uint mip = 0; mip < mipCount; ++mip)
+	{
+		size += GetDDSSurfaceSize(format, (std::max)(width >> mip, 1u), (std::max)(height >> mip, 1u));
+	}
+	const size_t header = file.size();
+	file.resize(header + size);
+	for (size_t n = header; n < file.size(); ++n)
+	{
+		file[n] = static_cast<uint8_t>(random());
+	}
+	return file;
+}
+
+// Best of three, the first run also warms the caches
+template <typename Function>
+static double Time(Function function)
+{
+	double best = 1e30;
+	for (uint run = 0; run < 3; ++run)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		best = std::fmin(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+int main(int argc, char** argv)
+{
+	uint count = 256;
+	uint seed = 1;
+	uint32_t format = Formats[0].Value;
+	for (int n = 1; n < argc; ++n)
+	{
+		if (strcmp(argv[n], "--count") == 0 && n + 1 < argc)
+		{
+			count = static_cast<uint>(std::max(1, atoi(argv[++n])));
+		}
+		else if (strcmp(argv[n], "--seed") == 0 && n + 1 < argc)
+		{
+			seed = static_cast<uint>(atoi(argv[++n]));
+		}
+		else if (strcmp(argv[n], "--format") == 0 && n + 1 < argc)
+		{
+			const char* name = argv[++n];
+			format = 0;
+			for (const Format& entry : Formats)
+			{
+				format = strcmp(entry.Name, name) == 0 ? entry.Value : format;
+			}
+			if (format == 0)
+			{
+				fprintf(stderr, "unknown format %s\n", name);
+				return 1;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "usage: AtlasBenchmark [--count N] [--seed N] [--format bc1|bc7|rgba8]\n");
+			return 1;
+		}
+	}
+
+	std::mt19937 random(seed);
+	std::vector<std::vector<uint8_t>> files(count);
+	for (std::vector<uint8_t>& file : files)
+	{
+		file = MakeSourceFile(format, 4 + random() % 253, 4 + random() % 253, 1 + random() % 5, random);
+	}
+	std::vector<DDSTexture> textures(count);
+	std::vector<ParticleAtlasSource> sources(count);
+	size_t sourceBytes = 0;
+	for (uint n = 0; n < count; ++n)
+	{
+		ParseDDS(files[n].data(), files[n].size(), textures[n]);
+		sources[n] = { "Source" + std::to_string(n), &textures[n], 1, 1, 1 };
+		sourceBytes += files[n].size();
+	}
+
+	// The packer alone, on the padded sizes BuildParticleAtlas gives it
+	uint mipCount = PARTICLE_ATLAS_MAX_MIPS;
+	for (const DDSTexture& texture : textures)
+	{
+		mipCount = (std::min)(mipCount, texture.MipCount);
+	}
+	const uint alignment = (IsDDSBlockCompressed(format) ? 4 : 1) << (mipCount - 1);
+	std::vector<uint2> sizes(count);
+	for (uint n = 0; n < count; ++n)
+	{
+		sizes[n] = uint2((textures[n].Width + alignment - 1) / alignment * alignment, (textures[n].Height + alignment - 1) / alignment * alignment);
+	}
+	uint size = 0;
+	uint sliceCount = 0;
+	std::vector<AtlasPlacement> placements;
+	const double packTime = Time([&]() { PackAtlas(sizes.data(), count, alignment, PARTICLE_ATLAS_MAX_SIZE, size, sliceCount, placements); });
+
+	std::vector<uint8_t> dds;
+	std::vector<ParticleAtlasEntry> entries;
+	std::string error;
+	if (!BuildParticleAtlas(sources.data(), count, dds, entries, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	const std::vector<uint8_t> firstDDS = dds;
+	const std::vector<ParticleAtlasEntry> firstEntries = entries;
+	const double buildTime = Time([&]() { BuildParticleAtlas(sources.data(), count, dds, entries, error); });
+	if (dds != firstDDS || entries.size() != firstEntries.size() ||
+		memcmp(entries.data(), firstEntries.data(), sizeof(ParticleAtlasEntry) * entries.size()) != 0)
+	{
+		fprintf(stderr, "rebuilding the same sources gave different bytes\n");
+		return 1;
+	}
+
+	DDSTexture atlas;
+	ParseDDS(dds.data(), dds.size(), atlas);
+	double covered = 0;
+	for (uint n = 0; n < count; ++n)
+	{
+		covered += static_cast<double>(textures[n].Width) * textures[n].Height;
+	}
+	const double area = static_cast<double>(atlas.Width) * atlas.Height * atlas.ArraySize;
+	printf("%u sources, %.2f MB\n", count, sourceBytes / 1e6);
+	printf("pack  %10.3f ms %12.0f rects/s\n", packTime * 1e3, count / packTime);
+	printf("build %10.3f ms %12.2f MB/s\n", buildTime * 1e3, dds.size() / 1e6 / buildTime);
+	printf("atlas %ux%u x %u slices, %u mips, %.2f MB, %.1f%% covered\n", atlas.Width, atlas.Height, atlas.ArraySize, atlas.MipCount,
+		dds.size() / 1e6, 100.0 * covered / area);
+	return 0;
+}
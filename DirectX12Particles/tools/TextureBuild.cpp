@@ -0,0 +1,254 @@
+// Compresses authored PNG and TGA textures into block compressed DDS files with mips, and benchmarks the encoder.
+// Builds on Windows and Linux from this directory:
+//   g++ -std=c++20 -O2 -I../source/ParticleCPU TextureBuild.cpp ../source/ParticleCPU/BlockCompression.cpp ../source/ParticleCPU/DDSFile.cpp
+//       ../source/ParticleCPU/ImageFile.cpp ../source/ParticleCPU/MappedFile.cpp ../source/ParticleCPU/ThreadPool.cpp -lpthread -o TextureBuild
+//   cl /std:c++20 /O2 /EHsc /I..\source\ParticleCPU TextureBuild.cpp ..\source\ParticleCPU\BlockCompression.cpp ...
+// or as the TextureBuild target of tests/CMakeLists.txt.
+//
+// TextureBuild [--format auto|bc1|bc3|bc4|bc7] [--threads N] [--no-mips] [--scalar] input.png ...
+//   Writes input.dds next to every input. auto picks BC1, BC4 or BC7 per image, particle textures that go into the atlas
+//   need the same format as Particle.dds.
+// TextureBuild --benchmark [input.png ...]
+//   Times every format with the scalar and SSE2 index search on one thread and with SSE2 on all of them, and reports the
+//   PSNR of the top mip. Without inputs it runs on generated 1024x1024 images.
+
+#include "BlockCompression.h"
+#include "DDSFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Format
+{
+	const char* Name;
+	uint32_t Value;
+};
+
+static const Format Formats[] = { { "bc1", BLOCK_FORMAT_BC1 }, { "bc3", BLOCK_FORMAT_BC3 }, { "bc4", BLOCK_FORMAT_BC4 }, { "bc7", BLOCK_FORMAT_BC7 } };
+
+static const char* GetFormatName(uint32_t format)
+{
+	for (const Format& entry : Formats)
+	{
+		if (entry.Value == format)
+		{
+			return entry.Name;
+		}
+	}
+	return "?";
+}
+
+// Soft particle sprite with alpha, colored value noise and a gray ramp, what the three formats are each picked for
+static std::vector<Image> MakeBenchmarkImages(uint32_t size)
+{
+	std::vector<Image> images(3);
+	uint32_t seed = 12345;
+	std::vector<uint8_t> noise(static_cast<size_t>(size / 8 + 2) * (size / 8 + 2) * 3);
+	for (uint8_t& value : noise)
+	{
+		seed = seed * 1664525 + 1013904223;
+		value = static_cast<uint8_t>(seed >> 24);
+	}
+
+	for (Image& image : images)
+	{
+		image.Width = size;
+		image.Height = size;
+		image.Pixels.resize(static_cast<size_t>(size) * size * 4);
+	}
+	const uint32_t cells = size / 8 + 2;
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			const size_t n = (static_cast<size_t>(y) * size + x) * 4;
+
+			const float dx = (x + 0.5f) / size * 2.0f - 1.0f;
+			const float dy = (y + 0.5f) / size * 2.0f - 1.0f;
+			const float falloff = std::fmax(0.0f, 1.0f - std::sqrt(dx * dx + dy * dy));
+			uint8_t* sprite = images[0].Pixels.data() + n;
+			sprite[0] = 255;
+			sprite[1] = static_cast<uint8_t>(120 + 135 * falloff);
+			sprite[2] = static_cast<uint8_t>(40 + 200 * falloff * falloff);
+			sprite[3] = static_cast<uint8_t>(255 * falloff * falloff);
+
+			// Bilinear value noise over 8x8 cells
+			const float fx = (x % 8) / 8.0f;
+			const float fy = (y % 8) / 8.0f;
+			const size_t cell = (static_cast<size_t>(y / 8) * cells + x / 8) * 3;
+			uint8_t* color = images[1].Pixels.data() + n;
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const float top = noise[cell + c] * (1.0f - fx) + noise[cell + 3 + c] * fx;
+				const float bottom = noise[cell + cells * 3 + c] * (1.0f - fx) + noise[cell + cells * 3 + 3 + c] * fx;
+				color[c] = static_cast<uint8_t>(top * (1.0f - fy) + bottom * fy);
+			}
+			color[3] = 255;
+
+			uint8_t* gray = images[2].Pixels.data() + n;
+			gray[0] = gray[1] = gray[2] = static_cast<uint8_t>((x + y) * 255 / (2 * size - 2));
+			gray[3] = 255;
+		}
+	}
+	return images;
+}
+
+static double TimeCompression(const Image& image, uint32_t format, ThreadPool& pool, bool simd, std::vector<uint8_t>& blocks)
+{
+	// Best of three, the first run also warms the caches and the pool
+	double best = 1e30;
+	for (uint32_t run = 0; run < 3; ++run)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		CompressImage(image, format, pool, simd, blocks);
+		best = std::fmin(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+static int Benchmark(const std::vector<std::string>& inputs, uint32_t threadCount)
+{
+	std::vector<Image> images;
+	std::vector<std::string> names;
+	if (inputs.empty())
+	{
+		images = MakeBenchmarkImages(1024);
+		names = { "sprite", "noise", "ramp" };
+	}
+	for (const std::string& input : inputs)
+	{
+		Image image;
+		std::string error;
+		if (!LoadImageFile(input, image, error))
+		{
+			fprintf(stderr, "%s: %s\n", input.c_str(), error.c_str());
+			return 1;
+		}
+		images.push_back(std::move(image));
+		names.push_back(input);
+	}
+
+	ThreadPool single(1);
+	ThreadPool pool(threadCount);
+	printf("%-12s %-4s %14s %14s %14s %9s\n", "image", "fmt", "scalar MPix/s", "SSE2 MPix/s", "MT MPix/s", "PSNR dB");
+	for (size_t n = 0; n < images.size(); ++n)
+	{
+		const Image& image = images[n];
+		const double megapixels = static_cast<double>(image.Width) * image.Height / 1e6;
+		for (const Format& format : Formats)
+		{
+			std::vector<uint8_t> scalar;
+			std::vector<uint8_t> simd;
+			std::vector<uint8_t> threaded;
+			const double scalarTime = TimeCompression(image, format.Value, single, false, scalar);
+			const double simdTime = TimeCompression(image, format.Value, single, true, simd);
+			const double threadedTime = TimeCompression(image, format.Value, pool, true, threaded);
+			if (scalar != simd || simd != threaded)
+			{
+				fprintf(stderr, "%s %s: the scalar, SSE2 and threaded blocks differ\n", names[n].c_str(), format.Name);
+				return 1;
+			}
+
+			Image decoded;
+			DecompressImage(simd.data(), format.Value, image.Width, image.Height, decoded);
+			printf("%-12s %-4s %14.2f %14.2f %14.2f %9.2f\n", names[n].c_str(), format.Name, megapixels / scalarTime, megapixels / simdTime,
+				megapixels / threadedTime, ComputePSNR(image, decoded, GetBlockFormatChannels(format.Value)));
+		}
+	}
+	printf("%u threads, PSNR over the channels each format stores\n", pool.GetThreadCount());
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t format = 0;
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	uint32_t mipCount = 0;
+	bool simd = true;
+	bool benchmark = false;
+	std::vector<std::string> inputs;
+	for (int n = 1; n < argc; ++n)
+	{
+		if (strcmp(argv[n], "--format") == 0 && n + 1 < argc)
+		{
+			const char* name = argv[++n];
+			format = 0;
+			for (const Format& entry : Formats)
+			{
+				format = strcmp(entry.Name, name) == 0 ? entry.Value : format;
+			}
+			if (format == 0 && strcmp(name, "auto") != 0)
+			{
+				fprintf(stderr, "unknown format %s\n", name);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[n], "--threads") == 0 && n + 1 < argc)
+		{
+			threadCount = static_cast<uint32_t>(std::max(1, atoi(argv[++n])));
+		}
+		else if (strcmp(argv[n], "--no-mips") == 0)
+		{
+			mipCount = 1;
+		}
+		else if (strcmp(argv[n], "--scalar") == 0)
+		{
+			simd = false;
+		}
+		else if (strcmp(argv[n], "--benchmark") == 0)
+		{
+			benchmark = true;
+		}
+		else
+		{
+			inputs.push_back(argv[n]);
+		}
+	}
+
+	if (benchmark)
+	{
+		return Benchmark(inputs, threadCount);
+	}
+	if (inputs.empty())
+	{
+		fprintf(stderr, "usage: TextureBuild [--format auto|bc1|bc3|bc4|bc7] [--threads N] [--no-mips] [--scalar] input.png ...\n"
+			"       TextureBuild --benchmark [input.png ...]\n");
+		return 1;
+	}
+
+	ThreadPool pool(threadCount);
+	for (const std::string& input : inputs)
+	{
+		Image image;
+		std::string error;
+		std::vector<uint8_t> dds;
+		if (!LoadImageFile(input, image, error) || !BuildCompressedDDS(image, format == 0 ? ChooseBlockFormat(image) : format, mipCount, pool, simd, dds, error))
+		{
+			fprintf(stderr, "%s: %s\n", input.c_str(), error.c_str());
+			return 1;
+		}
+
+		const std::filesystem::path output = std::filesystem::path(input).replace_extension(".dds");
+		std::ofstream file(output, std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(dds.data()), dds.size());
+		file.close();
+		if (!file)
+		{
+			fprintf(stderr, "can't write %s\n", output.string().c_str());
+			return 1;
+		}
+
+		DDSTexture texture;
+		ParseDDS(dds.data(), dds.size(), texture);
+		printf("%s: %ux%u %s, %u mips\n", output.string().c_str(), image.Width, image.Height, GetFormatName(texture.Format), texture.MipCount);
+	}
+	return 0;
+}